@@ -45,11 +45,8 @@
  * Input Parameter:
  *   filename  - Name of the linked-in binary to be started.
  *   argv      - Argument list
- *   redirfile - If output is redirected, this parameter will be non-NULL
- *               and will provide the full path to the file.
- *   oflags    - If output is redirected, this parameter will provide the
- *               open flags to use.  This will support file replacement
- *               of appending to an existing file.
+ *   actions   - The file actions, such as redirection of the standard
+ *               input and output, to apply to the new task.  May be NULL.
  *
  * Returned Value:
  *   This is an end-user function, so it follows the normal convention:
@@ -59,11 +56,10 @@
  ****************************************************************************/
 
 int exec_builtin(FAR const char *appname, FAR char * const *argv,
-                 FAR const char *redirfile, int oflags)
+                 FAR const posix_spawn_file_actions_t *actions)
 {
   FAR const struct builtin_s *builtin;
   posix_spawnattr_t attr;
-  posix_spawn_file_actions_t file_actions;
   struct sched_param param;
   pid_t pid;
   int index;
@@ -95,25 +91,19 @@ int exec_builtin(FAR const char *appname, FAR char * const *argv,
       goto errout_with_errno;
     }
 
-  ret = posix_spawn_file_actions_init(&file_actions);
-  if (ret != 0)
-    {
-      goto errout_with_attrs;
-    }
-
   /* Set the correct task size and priority */
 
   param.sched_priority = builtin->priority;
   ret = posix_spawnattr_setschedparam(&attr, &param);
   if (ret != 0)
     {
-      goto errout_with_actions;
+      goto errout_with_attrs;
     }
 
   ret = posix_spawnattr_setstacksize(&attr, builtin->stacksize);
   if (ret != 0)
     {
-      goto errout_with_actions;
+      goto errout_with_attrs;
     }
 
   /* If robin robin scheduling is enabled, then set the scheduling policy
@@ -124,7 +114,7 @@ int exec_builtin(FAR const char *appname, FAR char * const *argv,
   ret = posix_spawnattr_setschedpolicy(&attr, SCHED_RR);
   if (ret != 0)
     {
-      goto errout_with_actions;
+      goto errout_with_attrs;
     }
 
   ret = posix_spawnattr_setflags(&attr,
@@ -132,43 +122,28 @@ int exec_builtin(FAR const char *appname, FAR char * const *argv,
                                  POSIX_SPAWN_SETSCHEDULER);
   if (ret != 0)
     {
-      goto errout_with_actions;
+      goto errout_with_attrs;
     }
 
 #else
   ret = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSCHEDPARAM);
   if (ret != 0)
     {
-      goto errout_with_actions;
+      goto errout_with_attrs;
     }
 
 #endif
 
-  /* Is output being redirected? */
-
-  if (redirfile)
-    {
-      /* Set up to close open redirfile and set to stdout (1) */
-
-      ret = posix_spawn_file_actions_addopen(&file_actions, 1,
-                                             redirfile, oflags, 0644);
-      if (ret != 0)
-        {
-          serr("ERROR: posix_spawn_file_actions_addopen failed: %d\n", ret);
-          goto errout_with_actions;
-        }
-    }
-
 #ifdef CONFIG_LIBC_EXECFUNCS
   /* Load and execute the application. */
 
-  ret = posix_spawn(&pid, builtin->name, &file_actions, &attr, argv, NULL);
+  ret = posix_spawn(&pid, builtin->name, actions, &attr, argv, NULL);
   if (ret != 0 && builtin->main != NULL)
 #endif
     {
       /* Start the built-in */
 
-      pid = task_spawn(builtin->name, builtin->main, &file_actions,
+      pid = task_spawn(builtin->name, builtin->main, actions,
                        &attr, argv ? &argv[1] : NULL, NULL);
       ret = pid < 0 ? -pid : 0;
     }
@@ -176,25 +151,19 @@ int exec_builtin(FAR const char *appname, FAR char * const *argv,
   if (ret != 0)
     {
       serr("ERROR: task_spawn failed: %d\n", ret);
-      goto errout_with_actions;
+      goto errout_with_attrs;
     }
 
-  /* Free attributes and file actions.  Ignoring return values in the case
-   * of an error.
-   */
+  /* Free attributes.  Ignoring return values in the case of an error. */
 
   /* Return the task ID of the new task if the task was successfully
    * started.  Otherwise, ret will be ERROR (and the errno value will
    * be set appropriately).
    */
 
-  posix_spawn_file_actions_destroy(&file_actions);
   posix_spawnattr_destroy(&attr);
   return pid;
 
-errout_with_actions:
-  posix_spawn_file_actions_destroy(&file_actions);
-
 errout_with_attrs:
   posix_spawnattr_destroy(&attr);
 
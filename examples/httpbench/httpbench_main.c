@@ -0,0 +1,452 @@
+/****************************************************************************
+ * apps/examples/httpbench/httpbench_main.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_EXAMPLES_HTTPBENCH_MAXIDLE
+#  define CONFIG_EXAMPLES_HTTPBENCH_MAXIDLE 32
+#endif
+
+#define HTTPBENCH_DEFAULT_PORT     80
+#define HTTPBENCH_DEFAULT_REQUESTS 100
+#define HTTPBENCH_DEFAULT_PATH     "/"
+#define HTTPBENCH_BUFSIZE          512
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct httpbench_args_s
+{
+  struct sockaddr_in server;   /* Server address */
+  FAR const char *path;        /* Path of the resource to request */
+  int nidle;                   /* Number of idle connections to hold open */
+  int nrequests;               /* Number of timed requests */
+  bool keepalive;              /* Reuse one HTTP/1.1 connection */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname)
+{
+  fprintf(stderr,
+          "USAGE: %s [-k] [-n <idle>] [-r <requests>] [-p <port>] "
+          "[-u <path>] <server-ip>\n", progname);
+  fprintf(stderr,
+          "  -k: Send HTTP/1.1 requests on one persistent connection\n");
+  fprintf(stderr,
+          "  -n: Idle connections held open during the test (default 0, "
+          "max %d)\n", CONFIG_EXAMPLES_HTTPBENCH_MAXIDLE);
+  fprintf(stderr,
+          "  -r: Number of timed requests (default %d)\n",
+          HTTPBENCH_DEFAULT_REQUESTS);
+  fprintf(stderr,
+          "  -p: Server port (default %d)\n", HTTPBENCH_DEFAULT_PORT);
+  fprintf(stderr,
+          "  -u: Path of the resource to request (default \"%s\")\n",
+          HTTPBENCH_DEFAULT_PATH);
+}
+
+static uint32_t elapsed_us(FAR const struct timespec *start)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)((now.tv_sec - start->tv_sec) * 1000000 +
+                    (now.tv_nsec - start->tv_nsec) / 1000);
+}
+
+static int compare_u32(FAR const void *a, FAR const void *b)
+{
+  uint32_t ua = *(FAR const uint32_t *)a;
+  uint32_t ub = *(FAR const uint32_t *)b;
+
+  return ua < ub ? -1 : ua > ub ? 1 : 0;
+}
+
+static int connect_server(FAR const struct sockaddr_in *server)
+{
+  int sockfd;
+
+  sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  if (sockfd < 0)
+    {
+      fprintf(stderr, "ERROR: socket failed: %d\n", errno);
+      return -1;
+    }
+
+  if (connect(sockfd, (FAR const struct sockaddr *)server,
+              sizeof(struct sockaddr_in)) < 0)
+    {
+      fprintf(stderr, "ERROR: connect failed: %d\n", errno);
+      close(sockfd);
+      return -1;
+    }
+
+  return sockfd;
+}
+
+/* Perform one request on a new connection and read the response until the
+ * server closes the connection.  Returns the number of response bytes or
+ * -1 on failure.
+ */
+
+static ssize_t do_request(FAR struct httpbench_args_s *args,
+                          FAR char *buffer)
+{
+  ssize_t total = 0;
+  ssize_t nbytes;
+  int sockfd;
+  int len;
+
+  sockfd = connect_server(&args->server);
+  if (sockfd < 0)
+    {
+      return -1;
+    }
+
+  len = snprintf(buffer, HTTPBENCH_BUFSIZE,
+                 "GET %s HTTP/1.0\r\nHost: %s\r\n\r\n",
+                 args->path, inet_ntoa(args->server.sin_addr));
+
+  if (send(sockfd, buffer, len, 0) != len)
+    {
+      fprintf(stderr, "ERROR: send failed: %d\n", errno);
+      close(sockfd);
+      return -1;
+    }
+
+  while ((nbytes = recv(sockfd, buffer, HTTPBENCH_BUFSIZE, 0)) > 0)
+    {
+      total += nbytes;
+    }
+
+  close(sockfd);
+
+  if (nbytes < 0)
+    {
+      fprintf(stderr, "ERROR: recv failed: %d\n", errno);
+      return -1;
+    }
+
+  return total;
+}
+
+/* Perform one HTTP/1.1 request on the persistent connection *sockfd,
+ * opening it first if necessary, and read exactly one response.  The
+ * connection is closed if the server does not keep it alive.  Returns the
+ * number of response bytes or -1 on failure.
+ */
+
+static ssize_t do_request_keepalive(FAR struct httpbench_args_s *args,
+                                    FAR char *buffer, FAR int *sockfd)
+{
+  FAR char *hdrend;
+  FAR char *cp;
+  ssize_t total = 0;
+  ssize_t nbytes;
+  ssize_t remaining;
+  bool close_conn;
+  int len;
+
+  if (*sockfd < 0)
+    {
+      *sockfd = connect_server(&args->server);
+      if (*sockfd < 0)
+        {
+          return -1;
+        }
+    }
+
+  len = snprintf(buffer, HTTPBENCH_BUFSIZE,
+                 "GET %s HTTP/1.1\r\nHost: %s\r\n\r\n",
+                 args->path, inet_ntoa(args->server.sin_addr));
+
+  if (send(*sockfd, buffer, len, 0) != len)
+    {
+      fprintf(stderr, "ERROR: send failed: %d\n", errno);
+      goto errout;
+    }
+
+  /* Read until the whole header has been received.  The header must fit
+   * in the buffer.
+   */
+
+  for (; ; )
+    {
+      nbytes = recv(*sockfd, &buffer[total], HTTPBENCH_BUFSIZE - 1 - total,
+                    0);
+      if (nbytes <= 0)
+        {
+          fprintf(stderr, "ERROR: recv failed: %d\n", errno);
+          goto errout;
+        }
+
+      total        += nbytes;
+      buffer[total] = '\0';
+
+      hdrend = strstr(buffer, "\r\n\r\n");
+      if (hdrend != NULL)
+        {
+          break;
+        }
+
+      if (total >= HTTPBENCH_BUFSIZE - 1)
+        {
+          fprintf(stderr, "ERROR: Response header too large\n");
+          goto errout;
+        }
+    }
+
+  hdrend    += 4;
+  close_conn = strstr(buffer, "Connection: close") != NULL;
+
+  cp = strstr(buffer, "Content-Length:");
+  if (cp == NULL || cp > hdrend)
+    {
+      fprintf(stderr, "ERROR: No Content-Length in response\n");
+      goto errout;
+    }
+
+  /* Then discard the rest of the body */
+
+  remaining = atol(cp + 15) - (total - (hdrend - buffer));
+  while (remaining > 0)
+    {
+      nbytes = recv(*sockfd, buffer, HTTPBENCH_BUFSIZE, 0);
+      if (nbytes <= 0)
+        {
+          fprintf(stderr, "ERROR: recv failed: %d\n", errno);
+          goto errout;
+        }
+
+      total     += nbytes;
+      remaining -= nbytes;
+    }
+
+  if (close_conn)
+    {
+      close(*sockfd);
+      *sockfd = -1;
+    }
+
+  return total;
+
+errout:
+  close(*sockfd);
+  *sockfd = -1;
+  return -1;
+}
+
+static int parse_args(int argc, FAR char *argv[],
+                      FAR struct httpbench_args_s *args)
+{
+  int port = HTTPBENCH_DEFAULT_PORT;
+  int opt;
+
+  memset(args, 0, sizeof(*args));
+  args->path      = HTTPBENCH_DEFAULT_PATH;
+  args->nrequests = HTTPBENCH_DEFAULT_REQUESTS;
+
+  while ((opt = getopt(argc, argv, "kn:r:p:u:h")) != -1)
+    {
+      switch (opt)
+        {
+          case 'k':
+            args->keepalive = true;
+            break;
+
+          case 'n':
+            args->nidle = atoi(optarg);
+            break;
+
+          case 'r':
+            args->nrequests = atoi(optarg);
+            break;
+
+          case 'p':
+            port = atoi(optarg);
+            break;
+
+          case 'u':
+            args->path = optarg;
+            break;
+
+          default:
+            return -1;
+        }
+    }
+
+  if (optind != argc - 1 || args->nrequests <= 0 || args->nidle < 0 ||
+      args->nidle > CONFIG_EXAMPLES_HTTPBENCH_MAXIDLE)
+    {
+      return -1;
+    }
+
+  args->server.sin_family = AF_INET;
+  args->server.sin_port   = htons(port);
+  if (inet_pton(AF_INET, argv[optind], &args->server.sin_addr) != 1)
+    {
+      fprintf(stderr, "ERROR: Bad server address: %s\n", argv[optind]);
+      return -1;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * httpbench_main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct httpbench_args_s args;
+  struct timespec start;
+  FAR uint32_t *latency;
+  FAR char *buffer;
+  uint64_t sum = 0;
+  ssize_t nbytes;
+  ssize_t size = 0;
+  int idlefds[CONFIG_EXAMPLES_HTTPBENCH_MAXIDLE];
+  int sockfd = -1;
+  int nopen = 0;
+  int nok = 0;
+  int ret = EXIT_FAILURE;
+  int i;
+
+  if (parse_args(argc, argv, &args) < 0)
+    {
+      show_usage(argv[0]);
+      return EXIT_FAILURE;
+    }
+
+  latency = malloc(sizeof(uint32_t) * args.nrequests);
+  buffer  = malloc(HTTPBENCH_BUFSIZE);
+  if (latency == NULL || buffer == NULL)
+    {
+      fprintf(stderr, "ERROR: Failed to allocate buffers\n");
+      goto errout;
+    }
+
+  /* Open the idle connections.  They are never used for requests, but the
+   * server has to keep watching them.
+   */
+
+  for (nopen = 0; nopen < args.nidle; nopen++)
+    {
+      idlefds[nopen] = connect_server(&args.server);
+      if (idlefds[nopen] < 0)
+        {
+          fprintf(stderr, "ERROR: Only %d idle connections opened\n", nopen);
+          goto errout_with_idle;
+        }
+    }
+
+  printf("Idle connections: %d, requests: %d, path: %s, %s\n",
+         nopen, args.nrequests, args.path,
+         args.keepalive ? "keep-alive" : "one connection per request");
+
+  /* Then time the requests made on the active connection */
+
+  for (i = 0; i < args.nrequests; i++)
+    {
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      if (args.keepalive)
+        {
+          nbytes = do_request_keepalive(&args, buffer, &sockfd);
+        }
+      else
+        {
+          nbytes = do_request(&args, buffer);
+        }
+
+      if (nbytes < 0)
+        {
+          continue;
+        }
+
+      latency[nok] = elapsed_us(&start);
+      sum         += latency[nok];
+      size         = nbytes;
+      nok++;
+    }
+
+  if (nok == 0)
+    {
+      fprintf(stderr, "ERROR: All requests failed\n");
+      goto errout_with_idle;
+    }
+
+  qsort(latency, nok, sizeof(uint32_t), compare_u32);
+
+  printf("Completed: %d/%d, response size: %zd bytes\n",
+         nok, args.nrequests, size);
+  printf("Latency (usec): min %" PRIu32 " avg %" PRIu32 " p50 %" PRIu32
+         " p90 %" PRIu32 " p99 %" PRIu32 " max %" PRIu32 "\n",
+         latency[0], (uint32_t)(sum / nok), latency[nok / 2],
+         latency[(nok * 90) / 100], latency[(nok * 99) / 100],
+         latency[nok - 1]);
+
+  ret = EXIT_SUCCESS;
+
+errout_with_idle:
+  if (sockfd >= 0)
+    {
+      close(sockfd);
+    }
+
+  while (nopen > 0)
+    {
+      close(idlefds[--nopen]);
+    }
+
+errout:
+  free(buffer);
+  free(latency);
+  return ret;
+}
@@ -28,6 +28,7 @@
 #include <nuttx/config.h>
 
 #include <sys/types.h>
+#include <spawn.h>
 
 #include <nuttx/lib/builtin.h>
 
@@ -66,11 +67,8 @@ extern "C"
  * Input Parameter:
  *   filename  - Name of the linked-in binary to be started.
  *   argv      - Argument list
- *   redirfile - If output is redirected, this parameter will be non-NULL
- *               and will provide the full path to the file.
- *   oflags    - If output is redirected, this parameter will provide the
- *               open flags to use.  This will support file replacement
- *               of appending to an existing file.
+ *   actions   - The file actions, such as redirection of the standard
+ *               input and output, to apply to the new task.  May be NULL.
  *
  * Returned Value:
  *   This is an end-user function, so it follows the normal convention:
@@ -80,7 +78,7 @@ extern "C"
  ****************************************************************************/
 
 int exec_builtin(FAR const char *appname, FAR char * const *argv,
-                 FAR const char *redirfile, int oflags);
+                 FAR const posix_spawn_file_actions_t *actions);
 
 #undef EXTERN
 #if defined(__cplusplus)
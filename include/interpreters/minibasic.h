@@ -69,4 +69,25 @@
 
 int basic(FAR const char *script, FILE *in, FILE *out, FILE *err);
 
+#ifdef CONFIG_INTERPRETER_MINIBASIC_BYTECODE
+/****************************************************************************
+ * Name: basic_bytecode
+ *
+ * Description:
+ *   Compile a BASIC script to bytecode and run it
+ *
+ * Input Parameters:
+ *   script - the script to run
+ *   in     - input stream
+ *   out    - output stream
+ *   err    - error stream
+ *
+ * Returned Value:
+ *   Returns: 0 on success, 1 on error condition.
+ *
+ ****************************************************************************/
+
+int basic_bytecode(FAR const char *script, FILE *in, FILE *out, FILE *err);
+#endif
+
 #endif
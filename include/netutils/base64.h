@@ -58,6 +58,35 @@
 
 #include <nuttx/config.h>
 
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* The most output that one update call can produce for 'len' bytes of
+ * input, including whatever was held over from the previous call.
+ */
+
+#define BASE64_ENCODE_UPDATE_MAX(len)  (((len) + 2) / 3 * 4)
+#define BASE64_DECODE_UPDATE_MAX(len)  (((len) + 3) / 4 * 3)
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* State for encoding or decoding a stream in pieces of any size */
+
+struct base64_context_s
+{
+  uint32_t word;   /* Bits held over for the next call */
+  uint8_t count;   /* Bytes (encoding) or digits (decoding) in word */
+  bool websafe;    /* Use the base64w_*() alphabet and padding */
+  bool done;       /* Decoding: padding was seen, ignore the rest */
+};
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -78,6 +107,27 @@ FAR void *base64w_encode(FAR const void *src, size_t len, FAR void *dst,
                          FAR size_t *out_len);
 FAR void *base64w_decode(FAR const void *src, size_t len, FAR void *dst,
                          FAR size_t *out_len);
+
+/* Incremental interfaces.  The update calls accept any amount of input
+ * and write at most BASE64_*_UPDATE_MAX(len) bytes to dst, returning the
+ * number written.  Output is not NUL terminated.  base64_encode_final()
+ * writes at most 4 characters, base64_decode_final() at most 2 bytes.
+ *
+ * Unlike base64_decode(), the incremental decoder skips characters that
+ * are not part of the alphabet, such as line breaks, and stops at the
+ * first padding character.  base64_decode_final() returns -EINVAL if the
+ * input ended with a single leftover digit.
+ */
+
+void base64_encode_init(FAR struct base64_context_s *ctx, bool websafe);
+size_t base64_encode_update(FAR struct base64_context_s *ctx,
+                            FAR const void *src, size_t len, FAR void *dst);
+size_t base64_encode_final(FAR struct base64_context_s *ctx, FAR void *dst);
+void base64_decode_init(FAR struct base64_context_s *ctx, bool websafe);
+size_t base64_decode_update(FAR struct base64_context_s *ctx,
+                            FAR const void *src, size_t len, FAR void *dst);
+ssize_t base64_decode_final(FAR struct base64_context_s *ctx,
+                            FAR void *dst);
 #endif /* CONFIG_CODECS_BASE64 */
 
 #ifdef __cplusplus
@@ -52,8 +52,17 @@
  *     128 bytes.
  *   CONFIG_FTPD_DATABUFFERSIZE - The size of the I/O buffer for data
  *     transfers.  Default: 512 bytes.
+ *   CONFIG_FTPD_STORBUFFERSIZE - The size of the buffer used to batch
+ *     received data into large file writes on binary uploads.  Zero
+ *     disables batching.  Default: 4096 bytes.
  *   CONFIG_FTPD_WORKERSTACKSIZE - The stacksize to allocate for each
  *     FTP daemon worker thread.  Default:  2048 bytes.
+ *   CONFIG_FTPD_WORKERPOOL - Serve sessions from a fixed pool of
+ *     pre-spawned worker threads instead of creating a thread per
+ *     connection.
+ *   CONFIG_FTPD_NWORKERS - The number of workers in the pool.  Default: 2
+ *   CONFIG_FTPD_ACCEPTBACKLOG - The number of accepted connections that
+ *     may wait for a free worker.  Default: 4
  */
 
 #ifdef CONFIG_DISABLE_PTHREAD
@@ -76,10 +85,24 @@
 #  define CONFIG_FTPD_DATABUFFERSIZE 512
 #endif
 
+#ifndef CONFIG_FTPD_STORBUFFERSIZE
+#  define CONFIG_FTPD_STORBUFFERSIZE 4096
+#endif
+
 #ifndef CONFIG_FTPD_WORKERSTACKSIZE
 #  define CONFIG_FTPD_WORKERSTACKSIZE 2048
 #endif
 
+#ifdef CONFIG_FTPD_WORKERPOOL
+#  ifndef CONFIG_FTPD_NWORKERS
+#    define CONFIG_FTPD_NWORKERS 2
+#  endif
+
+#  ifndef CONFIG_FTPD_ACCEPTBACKLOG
+#    define CONFIG_FTPD_ACCEPTBACKLOG 4
+#  endif
+#endif
+
 /* Interface definitions ****************************************************/
 
 #define FTPD_ACCOUNTFLAG_NONE    (0)
@@ -95,6 +118,20 @@
 
 typedef FAR void *FTPD_SESSION;
 
+#ifdef CONFIG_FTPD_WORKERPOOL
+/* Statistics of the session worker pool returned by ftpd_getstats() */
+
+struct ftpd_stats_s
+{
+  uint32_t accepted;   /* Connections handed to the pool */
+  uint32_t rejected;   /* Connections refused because the queue was full */
+  uint16_t nworkers;   /* Number of workers in the pool */
+  uint16_t busy;       /* Workers currently serving a session */
+  uint16_t qdepth;     /* Connections currently waiting for a worker */
+  uint16_t maxqdepth;  /* High-water mark of qdepth */
+};
+#endif
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -181,6 +218,26 @@ int ftpd_adduser(FTPD_SESSION handle, uint8_t accountflags,
 
 int ftpd_session(FTPD_SESSION handle, int timeout);
 
+/****************************************************************************
+ * Name: ftpd_getstats
+ *
+ * Description:
+ *   Return a snapshot of the session worker pool statistics.
+ *
+ * Input Parameters:
+ *   handle - A handle previously returned by ftpd_open
+ *   stats - Location to return the statistics
+ *
+ * Returned Value:
+ *   Zero is returned on success.  A negated errno value is return on
+ *   failure.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTPD_WORKERPOOL
+int ftpd_getstats(FTPD_SESSION handle, FAR struct ftpd_stats_s *stats);
+#endif
+
 /****************************************************************************
  * Name: ftpd_close
  *
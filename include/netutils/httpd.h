@@ -47,9 +47,11 @@
 
 #include <nuttx/net/tcp.h>
 
+#include <sys/types.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <limits.h>
+#include <time.h>
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -108,6 +110,7 @@ struct httpd_fs_file
 #endif
 #ifdef CONFIG_NETUTILS_HTTPD_SENDFILE
   char path[PATH_MAX];
+  off_t offset;                             /* Bytes already sent */
 #endif
 };
 
@@ -126,6 +129,20 @@ struct httpd_state
   char    *ht_scriptptr;
   uint16_t ht_scriptlen;
   uint16_t ht_sndlen;
+#ifdef CONFIG_NETUTILS_HTTPD_POLL
+  uint8_t  ht_connstate;                    /* Connection state (poll mode) */
+  uint8_t  ht_parsestate;                   /* Request parser state */
+  bool     ht_fileopen;                     /* ht_file is part of the response */
+  bool     ht_sendfile;                     /* ht_file follows the queued data */
+  uint16_t ht_rcvlen;                       /* Request bytes in ht_buffer */
+  time_t   ht_active;                       /* Time of last progress */
+  FAR char *ht_pend;                        /* Data the socket would not take */
+  size_t   ht_pendoff;                      /* Start of the data in ht_pend */
+  size_t   ht_pendlen;                      /* Bytes waiting in ht_pend */
+  size_t   ht_pendsize;                     /* Allocated size of ht_pend */
+  FAR const char *ht_dataptr;               /* File data still to send */
+  int      ht_datalen;
+#endif
 };
 
 struct httpd_fsdata_file
@@ -246,6 +263,10 @@ void httpd_cgi_register(struct httpd_cgi_call *cgi_call);
  *   On success, returns >=0. On failure, returns a negative number
  *   indicating the failure code.
  *
+ *   Partial sends are continued.  In CONFIG_NETUTILS_HTTPD_POLL mode the
+ *   socket is non-blocking, and whatever it will not take is kept with the
+ *   connection and sent by the server loop once the socket is writable.
+ *
  ****************************************************************************/
 
 int httpd_send_datachunk(int sockfd, void *data, int len, bool chunked);
@@ -0,0 +1,229 @@
+/****************************************************************************
+ * apps/include/system/lzf_stream.h
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_INCLUDE_SYSTEM_LZF_STREAM_H
+#define __APPS_INCLUDE_SYSTEM_LZF_STREAM_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef CONFIG_SYSTEM_LZF
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Flags for lzf_stream_init() */
+
+#define LZF_STREAM_INDEX      (1 << 0) /* Append a block index when done */
+
+/* Limits */
+
+#define LZF_STREAM_MAXBLOCK   0xffff   /* Block lengths are 16-bit */
+#define LZF_STREAM_MAXWORKERS 8
+
+/* The block index trailer.  It follows the optional EOF marker, so tools
+ * that do not know about it stop reading before they get there:
+ *
+ * \x00                        EOF
+ * N x 4-byte-offset 4-byte-uoffset
+ *                             File offset of the header of block n and
+ *                             the uncompressed offset of its first byte
+ * "ZVI" 2-byte-blocksize 4-byte-nblocks
+ *                             Fixed size footer at the end of the file
+ *
+ * All values are big-endian, like the block headers.
+ */
+
+#define LZF_INDEX_ENTRY_SIZE  8
+#define LZF_INDEX_FOOTER_SIZE 9
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* Called in order with each compressed block, and with the EOF marker and
+ * the index when the stream is finished.  Returns zero on success or a
+ * negated errno value, which is then returned by the failing call.
+ */
+
+typedef CODE int (*lzf_stream_write_t)(FAR void *arg, FAR const void *buf,
+                                       size_t len);
+
+struct lzf_worker_s;
+
+/* The state of one compressed stream.  Callers allocate it, but all
+ * fields are private to the library.
+ */
+
+struct lzf_stream_s
+{
+  lzf_stream_write_t write;            /* Output callback */
+  FAR void *arg;                       /* Argument of the output callback */
+  FAR struct lzf_worker_s *workers;    /* Block buffers, one per thread */
+  FAR uint8_t *index;                  /* Index entries, if requested */
+  size_t indexsize;                    /* Allocated size of the index */
+  size_t fill;                         /* Bytes in the current block */
+  off_t nin;                           /* Uncompressed bytes written */
+  off_t nout;                          /* Compressed bytes written */
+  uint32_t nblocks;                    /* Blocks written */
+  uint16_t blocksize;                  /* Uncompressed size of a block */
+  uint8_t flags;                       /* LZF_STREAM_* flags */
+  uint8_t nworkers;                    /* Number of entries in workers[] */
+  uint8_t current;                     /* The block being filled */
+  bool finished;                       /* The final flush was done */
+  int error;                           /* First error, sticky */
+};
+
+/* What lzf_index_load() found at the end of a file */
+
+struct lzf_index_s
+{
+  off_t base;                          /* File offset of the entries */
+  uint32_t nblocks;                    /* Number of blocks */
+  uint16_t blocksize;                  /* Largest uncompressed block */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: lzf_stream_init
+ *
+ * Description:
+ *   Prepare a stream for compression.  The output is in the same format
+ *   that 'lzf' writes, so 'lzf -d' can decompress it.
+ *
+ * Input Parameters:
+ *   stream    - The stream to initialize
+ *   blocksize - Uncompressed size of a block, at most LZF_STREAM_MAXBLOCK
+ *   nworkers  - Number of blocks compressed at the same time.  With more
+ *               than one, each block is compressed on its own thread,
+ *               which is only worthwhile on SMP parts.
+ *   flags     - LZF_STREAM_* flags
+ *   write     - Called with the compressed data
+ *   arg       - Passed to the write callback
+ *
+ * Returned Value:
+ *   Zero on success or a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int lzf_stream_init(FAR struct lzf_stream_s *stream, size_t blocksize,
+                    int nworkers, int flags, lzf_stream_write_t write,
+                    FAR void *arg);
+
+/****************************************************************************
+ * Name: lzf_stream_feed
+ *
+ * Description:
+ *   Add uncompressed data to the stream.  Complete blocks are compressed
+ *   and passed to the write callback, possibly after this call returns if
+ *   there are several workers.
+ *
+ * Returned Value:
+ *   Zero on success or a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int lzf_stream_feed(FAR struct lzf_stream_s *stream, FAR const void *buf,
+                    size_t len);
+
+/****************************************************************************
+ * Name: lzf_stream_flush
+ *
+ * Description:
+ *   Compress any partial block and wait until everything fed so far has
+ *   been passed to the write callback.  If 'final' is true, also write the
+ *   EOF marker and the index (if requested); no more data may be fed
+ *   after that.
+ *
+ * Returned Value:
+ *   Zero on success or a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+int lzf_stream_flush(FAR struct lzf_stream_s *stream, bool final);
+
+/****************************************************************************
+ * Name: lzf_stream_deinit
+ *
+ * Description:
+ *   Stop the workers and free all resources.  Data that has not been
+ *   flushed is discarded.
+ *
+ ****************************************************************************/
+
+void lzf_stream_deinit(FAR struct lzf_stream_s *stream);
+
+/****************************************************************************
+ * Name: lzf_index_load
+ *
+ * Description:
+ *   Read the index footer from a file written with LZF_STREAM_INDEX.
+ *
+ * Returned Value:
+ *   Zero on success, -ENOENT if the file has no index, or another negated
+ *   errno value on failure.
+ *
+ ****************************************************************************/
+
+int lzf_index_load(int fd, FAR struct lzf_index_s *index);
+
+/****************************************************************************
+ * Name: lzf_block_read
+ *
+ * Description:
+ *   Decompress a single block of an indexed file.  'buf' must hold at
+ *   least index->blocksize bytes.  If 'uoffset' is not NULL, it receives
+ *   the uncompressed offset of the first byte of the block.
+ *
+ * Returned Value:
+ *   The uncompressed length of the block or a negated errno value.
+ *
+ ****************************************************************************/
+
+ssize_t lzf_block_read(int fd, FAR const struct lzf_index_s *index,
+                       uint32_t block, FAR void *buf, size_t buflen,
+                       FAR off_t *uoffset);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_SYSTEM_LZF */
+#endif /* __APPS_INCLUDE_SYSTEM_LZF_STREAM_H */
@@ -79,6 +79,14 @@
 #  define CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE 512
 #endif
 
+/* Maximum number of unacknowledged bytes when streaming to a full-duplex
+ * receiver.  Zero disables streaming.
+ */
+
+#ifndef CONFIG_SYSTEM_ZMODEM_SNDWINDOW
+#  define CONFIG_SYSTEM_ZMODEM_SNDWINDOW 0
+#endif
+
 /* Absolute paths are not accepted.  This configuration value must be
  * set to provide the path to the file storage directory (such as a
  * mountpoint directory).
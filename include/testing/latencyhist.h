@@ -0,0 +1,115 @@
+/****************************************************************************
+ * apps/include/testing/latencyhist.h
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_INCLUDE_TESTING_LATENCYHIST_H
+#define __APPS_INCLUDE_TESTING_LATENCYHIST_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Latencies are kept in a log-linear histogram: exact below 8, then four
+ * buckets per power of two up to 2^32.  That bounds the error of a
+ * percentile to 25% with a fixed, small table and no per-sample storage.
+ * The unit is up to the caller.
+ */
+
+#define LATENCYHIST_NBUCKETS (8 + 29 * 4)
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+struct latencyhist_s
+{
+  uint32_t count;
+  uint32_t max;
+  uint32_t bucket[LATENCYHIST_NBUCKETS];
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+#ifdef __cplusplus
+#define EXTERN extern "C"
+extern "C"
+{
+#else
+#define EXTERN extern
+#endif
+
+/****************************************************************************
+ * Name: latencyhist_record
+ *
+ * Description:
+ *   Add one sample to a histogram.
+ *
+ ****************************************************************************/
+
+void latencyhist_record(FAR struct latencyhist_s *hist, uint32_t value);
+
+/****************************************************************************
+ * Name: latencyhist_add
+ *
+ * Description:
+ *   Add the samples of 'from' to 'to', e.g. to total per-thread results.
+ *
+ ****************************************************************************/
+
+void latencyhist_add(FAR struct latencyhist_s *to,
+                     FAR const struct latencyhist_s *from);
+
+/****************************************************************************
+ * Name: latencyhist_bound
+ *
+ * Description:
+ *   Return the largest value that falls in bucket 'index'.
+ *
+ ****************************************************************************/
+
+uint32_t latencyhist_bound(int index);
+
+/****************************************************************************
+ * Name: latencyhist_percentile
+ *
+ * Description:
+ *   Return the upper bound of the bucket that holds the given percentile,
+ *   in tenths of a percent, limited to the largest sample recorded.
+ *
+ ****************************************************************************/
+
+uint32_t latencyhist_percentile(FAR const struct latencyhist_s *hist,
+                                uint32_t permille);
+
+#undef EXTERN
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __APPS_INCLUDE_TESTING_LATENCYHIST_H */
@@ -51,6 +51,7 @@
 #include "bas_error.h"
 #include "bas_fs.h"
 #include "bas_global.h"
+#include "bas_pool.h"
 #include "bas_program.h"
 #include "bas_value.h"
 #include "bas_var.h"
@@ -206,13 +207,12 @@ static struct Value *lvalue(struct Value *value)
               int *more;
 
               more =
-                realloc(idx,
-                        sizeof(unsigned int) *
-                        (capacity ? (capacity *= 2) : (capacity = 3)));
+                Pool_scratch(idx,
+                             sizeof(unsigned int) *
+                             (capacity ? (capacity *= 2) : (capacity = 3)));
               if (!more)
                 {
-                  if (capacity)
-                    free(idx);
+                  Pool_scratchFree(idx);
                   return Value_new_ERROR(value, OUTOFMEMORY);
                 }
 
@@ -223,11 +223,7 @@ static struct Value *lvalue(struct Value *value)
           if (eval(value, _("index"))->type == V_ERROR ||
               VALUE_RETYPE(value, V_INTEGER)->type == V_ERROR)
             {
-              if (capacity)
-                {
-                  free(idx);
-                }
-
+              Pool_scratchFree(idx);
               g_pc = idxpc;
               return value;
             }
@@ -269,7 +265,7 @@ static struct Value *lvalue(struct Value *value)
                 g_pc = lvpc;
               }
 
-            free(idx);
+            Pool_scratchFree(idx);
             return value;
           }
 
@@ -698,7 +694,8 @@ static struct Value *eval(struct Value *value, const char *desc)
       char state;
     };
 
-  struct Pdastack *pdastack = malloc(capacity * sizeof(struct Pdastack));
+  struct Pdastack *pdastack =
+    Pool_scratch(NULL, capacity * sizeof(struct Pdastack));
   struct Pdastack *sp = pdastack;
   struct Pdastack *stackEnd = pdastack + capacity - 1;
   enum TokenType ip;
@@ -709,7 +706,8 @@ static struct Value *eval(struct Value *value, const char *desc)
       if (sp == stackEnd)
         {
           pdastack =
-            realloc(pdastack, (capacity + 10) * sizeof(struct Pdastack));
+            Pool_scratch(pdastack,
+                         (capacity + 10) * sizeof(struct Pdastack));
           sp = pdastack + capacity - 1;
           capacity += 10;
           stackEnd = pdastack + capacity - 1;
@@ -884,7 +882,7 @@ static struct Value *eval(struct Value *value, const char *desc)
               {
                 assert(sp == pdastack + 1);
                 *value = sp->u.value;
-                free(pdastack);
+                Pool_scratchFree(pdastack);
                 return value;
               }
 
@@ -1136,7 +1134,7 @@ error:
       --sp;
     }
 
-  free(pdastack);
+  Pool_scratchFree(pdastack);
   return value;
 }
 
@@ -1799,7 +1797,12 @@ static struct Value *assign(struct Value *value)
               struct Value **more;
 
               capacity = capacity ? 2 * capacity : 2;
-              more = realloc(l, capacity * sizeof(*l));
+              if ((more = Pool_scratch(l, capacity * sizeof(*l))) == NULL)
+                {
+                  Pool_scratchFree(l);
+                  return Value_new_ERROR(value, OUTOFMEMORY);
+                }
+
               l = more;
             }
 
@@ -1812,17 +1815,14 @@ static struct Value *assign(struct Value *value)
                                   (g_pc.token + 1)->type ==
                                   T_OP ? GLOBALARRAY : GLOBALVAR, 0) == 0)
                 {
-                  if (capacity)
-                    {
-                      free(l);
-                    }
-
+                  Pool_scratchFree(l);
                   return Value_new_ERROR(value, REDECLARATION);
                 }
             }
 
           if ((l[used] = lvalue(value))->type == V_ERROR)
             {
+              Pool_scratchFree(l);
               return value;
             }
 
@@ -1839,6 +1839,7 @@ static struct Value *assign(struct Value *value)
 
       if (g_pc.token->type != T_EQ)
         {
+          Pool_scratchFree(l);
           return Value_new_ERROR(value, MISSINGEQ);
         }
 
@@ -1846,6 +1847,7 @@ static struct Value *assign(struct Value *value)
       expr = g_pc;
       if (eval(value, _("rhs"))->type == V_ERROR)
         {
+          Pool_scratchFree(l);
           return value;
         }
 
@@ -1856,7 +1858,7 @@ static struct Value *assign(struct Value *value)
               VALUE_RETYPE(&retyped_value, (l[i])->type)->type == V_ERROR)
             {
               g_pc = expr;
-              free(l);
+              Pool_scratchFree(l);
               Value_destroy(value);
               *value = retyped_value;
               return value;
@@ -1869,7 +1871,7 @@ static struct Value *assign(struct Value *value)
             }
         }
 
-      free(l);
+      Pool_scratchFree(l);
       Value_destroy(value);
       *value = retyped_value;   /* for status only */
     }
@@ -1982,6 +1984,7 @@ static void runline(struct Token *line)
       g_pc.token = line;
       g_optionbase = 0;
       g_stopped = 0;
+      Pool_scratchReset();
       statements(&value);
       if (value.type != V_ERROR && g_pc.token->type != T_EOL)
         {
@@ -2029,7 +2032,10 @@ static void runline(struct Token *line)
 
   do
     {
+      /* Nothing outlives a top level statement in the scratch arena */
+
       assert(g_pass == INTERPRET);
+      Pool_scratchReset();
       statements(&value);
       assert(g_pass == INTERPRET);
       if (value.type == V_ERROR)
@@ -2481,4 +2487,5 @@ void bas_exit(void)
   FS_closefiles();
   FS_close(LPCHANNEL);
   FS_close(STDCHANNEL);
+  Pool_destroy();
 }
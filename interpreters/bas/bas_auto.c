@@ -44,6 +44,22 @@
 #define INCREASE_STACK 16
 #define _(String) String
 
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/* Double the slot stack, so deep recursion copies it a logarithmic number
+ * of times instead of once every INCREASE_STACK calls.
+ */
+
+static void growStack(struct Auto *this)
+{
+  this->stackCapacity = this->stackCapacity ? this->stackCapacity * 2 :
+                        INCREASE_STACK;
+  this->slot = realloc(this->slot,
+                       sizeof(this->slot[0]) * this->stackCapacity);
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -92,14 +108,7 @@ struct Var *Auto_pushArg(struct Auto *this)
 {
   if ((this->stackPointer + 1) >= this->stackCapacity)
     {
-      this->slot =
-        realloc(this->slot,
-                sizeof(this->slot[0]) *
-                (this->
-                 stackCapacity ? (this->stackCapacity =
-                                  this->stackPointer +
-                                  INCREASE_STACK) : (this->stackCapacity =
-                                                     INCREASE_STACK)));
+      growStack(this);
     }
 
   return &this->slot[this->stackPointer++].var;
@@ -109,14 +118,7 @@ void Auto_pushFuncRet(struct Auto *this, int firstarg, struct Pc *pc)
 {
   if (this->stackPointer + 2 >= this->stackCapacity)
     {
-      this->slot =
-        realloc(this->slot,
-                sizeof(this->slot[0]) *
-                (this->
-                 stackCapacity ? (this->stackCapacity =
-                                  this->stackCapacity +
-                                  INCREASE_STACK) : (this->stackCapacity =
-                                                     INCREASE_STACK)));
+      growStack(this);
     }
 
   this->slot[this->stackPointer].retException.onerror = this->onerror;
@@ -135,14 +137,7 @@ void Auto_pushGosubRet(struct Auto *this, struct Pc *pc)
 {
   if ((this->stackPointer + 1) >= this->stackCapacity)
     {
-      this->slot =
-        realloc(this->slot,
-                sizeof(this->slot[0]) *
-                (this->
-                 stackCapacity ? (this->stackCapacity =
-                                  this->stackPointer +
-                                  INCREASE_STACK) : (this->stackCapacity =
-                                                     INCREASE_STACK)));
+      growStack(this);
     }
 
   this->slot[this->stackPointer].retFrame.pc = *pc;
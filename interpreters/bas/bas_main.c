@@ -35,8 +35,10 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "bas_fs.h"
+#include "bas_pool.h"
 #include "bas.h"
 
 /****************************************************************************
@@ -58,11 +60,14 @@ int main(int argc, FAR char *argv[])
   int backslash_colon = 0;
   int uppercase = 0;
   int restricted = 0;
+  int stats = 0;
+  struct timespec start;
+  struct timespec end;
   int lpfd;
 
   /* parse arguments */
 
-  while ((o = getopt(argc, argv, ":bl:ruVh")) != EOF)
+  while ((o = getopt(argc, argv, ":bl:rsuVh")) != EOF)
     {
       switch (o)
         {
@@ -82,6 +87,10 @@ int main(int argc, FAR char *argv[])
           restricted = 1;
           break;
 
+        case 's':
+          stats = 1;
+          break;
+
         case 'V':
           printf("bas %s\n", CONFIG_INTERPRETER_BAS_VERSION);
           exit(0);
@@ -104,8 +113,8 @@ int main(int argc, FAR char *argv[])
 
   if (usage == 1)
     {
-      fputs(_("Usage: bas [-b] [-l file] [-r] [-u] [program [argument ...]]\n"),
-            stderr);
+      fputs(_("Usage: bas [-b] [-l file] [-r] [-s] [-u] "
+              "[program [argument ...]]\n"), stderr);
       fputs(_("       bas -h\n"), stderr);
       fputs(_("       bas -V\n"), stderr);
       fputs("\n", stderr);
@@ -115,8 +124,8 @@ int main(int argc, FAR char *argv[])
 
   if (usage == 2)
     {
-      fputs(_("Usage: bas [-b] [-l file] [-u] [program [argument ...]]\n"),
-            stdout);
+      fputs(_("Usage: bas [-b] [-l file] [-r] [-s] [-u] "
+              "[program [argument ...]]\n"), stdout);
       fputs(_("       bas -h\n"), stdout);
       fputs(_("       bas -V\n"), stdout);
       fputs("\n", stdout);
@@ -125,6 +134,7 @@ int main(int argc, FAR char *argv[])
       fputs(_("-b  Convert backslashes to colons\n"), stdout);
       fputs(_("-l  Write LPRINT output to file\n"), stdout);
       fputs(_("-r  Forbid SHELL\n"), stdout);
+      fputs(_("-s  Report allocation statistics on exit\n"), stdout);
       fputs(_("-u  Output all tokens in uppercase\n"),
             stdout);
       fputs(_("-h  Display this help and exit\n"), stdout);
@@ -146,6 +156,8 @@ int main(int argc, FAR char *argv[])
   g_bas_argv0 = runFile;
   g_bas_end   = false;
 
+  Pool_resetStats(stats);
+  clock_gettime(CLOCK_MONOTONIC, &start);
   bas_init(backslash_colon, restricted, uppercase, lpfd);
   if (runFile)
     {
@@ -163,5 +175,14 @@ int main(int argc, FAR char *argv[])
   /* Release resources and close files and devices */
 
   bas_exit();
+  if (stats)
+    {
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      Pool_report(stderr);
+      fprintf(stderr, "Run time:    %ld ms\n",
+              (long)((end.tv_sec - start.tv_sec) * 1000 +
+                     (end.tv_nsec - start.tv_nsec) / 1000000));
+    }
+
   return 0;
 }
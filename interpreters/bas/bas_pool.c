@@ -0,0 +1,505 @@
+/****************************************************************************
+ * apps/interpreters/bas/bas_pool.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <assert.h>
+
+#include "bas_pool.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_INTERPRETER_BAS_SCRATCHSIZE
+#  define CONFIG_INTERPRETER_BAS_SCRATCHSIZE 512
+#endif
+
+/* Size classes are 16, 32, 64, 128 and 256 bytes.  Blocks of a class are
+ * carved from POOL_CHUNKSIZE heap chunks that are only given back by
+ * Pool_destroy(), larger blocks come straight from the heap.
+ */
+
+#define POOL_CLASSES     5
+#define POOL_MINSIZE     16
+#define POOL_MAXSIZE     (POOL_MINSIZE << (POOL_CLASSES - 1))
+#define POOL_CHUNKSIZE   1024
+
+#define POOL_ALIGN(n)    (((n) + sizeof(union PoolHead) - 1) & \
+                          ~(sizeof(union PoolHead) - 1))
+
+#define SCRATCH_NONE     ((size_t)-1)
+#define SCRATCH_FREE     ((size_t)1)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* Every pool block is preceded by its capacity.  A capacity of at most
+ * POOL_MAXSIZE means the block belongs to a size class, anything larger
+ * is a heap block.  While a block sits on a free list, the head links it
+ * to the next free block of its class.
+ */
+
+union PoolHead
+{
+  size_t size;
+  void *next;
+  double align;
+};
+
+/* Scratch blocks are stacked in the arena.  Each knows where the block
+ * below it starts, so releasing the top block can also drop any block
+ * below it that was released out of order.
+ */
+
+struct ScratchHead
+{
+  size_t prev;                  /* Offset of the block below */
+  size_t size;                  /* Payload size, SCRATCH_FREE if released */
+};
+
+struct PoolStats
+{
+  unsigned long requests;       /* Allocations and resizes asked for */
+  unsigned long cached;         /* ... that did not need the heap */
+  unsigned long releases;       /* Blocks given back */
+  unsigned long mallocs;        /* Heap calls made */
+  unsigned long reallocs;
+  unsigned long frees;
+  uint64_t nsec;                /* Time spent in the heap calls */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct PoolStats g_poolstats;
+static int g_pooltimed;
+
+#ifdef CONFIG_INTERPRETER_BAS_POOL
+static union PoolHead *g_freelist[POOL_CLASSES];
+static union PoolHead *g_chunks;
+
+static union
+{
+  double align;
+  char buf[CONFIG_INTERPRETER_BAS_SCRATCHSIZE];
+} g_scratch;
+
+static size_t g_scratchtop;
+static size_t g_scratchlast = SCRATCH_NONE;
+#endif
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void heap_start(struct timespec *ts)
+{
+  if (g_pooltimed)
+    {
+      clock_gettime(CLOCK_MONOTONIC, ts);
+    }
+}
+
+static void heap_stop(const struct timespec *ts)
+{
+  struct timespec now;
+
+  if (g_pooltimed)
+    {
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      g_poolstats.nsec += (uint64_t)(now.tv_sec - ts->tv_sec) * 1000000000 +
+                          now.tv_nsec - ts->tv_nsec;
+    }
+}
+
+static void *heap_malloc(size_t size)
+{
+  struct timespec ts;
+  void *ptr;
+
+  heap_start(&ts);
+  ptr = malloc(size);
+  heap_stop(&ts);
+  ++g_poolstats.mallocs;
+  return ptr;
+}
+
+static void *heap_realloc(void *ptr, size_t size)
+{
+  struct timespec ts;
+
+  if (ptr == NULL)
+    {
+      return heap_malloc(size);
+    }
+
+  heap_start(&ts);
+  ptr = realloc(ptr, size);
+  heap_stop(&ts);
+  ++g_poolstats.reallocs;
+  return ptr;
+}
+
+static void heap_free(void *ptr)
+{
+  struct timespec ts;
+
+  if (ptr != NULL)
+    {
+      heap_start(&ts);
+      free(ptr);
+      heap_stop(&ts);
+      ++g_poolstats.frees;
+    }
+}
+
+#ifdef CONFIG_INTERPRETER_BAS_POOL
+static int pool_class(size_t size)
+{
+  size_t capacity = POOL_MINSIZE;
+  int cls = 0;
+
+  while (capacity < size)
+    {
+      capacity <<= 1;
+      ++cls;
+    }
+
+  return cls;
+}
+
+static int pool_refill(int cls)
+{
+  union PoolHead *chunk;
+  union PoolHead *head;
+  size_t step;
+  size_t n;
+
+  if ((chunk = heap_malloc(POOL_CHUNKSIZE)) == NULL)
+    {
+      return -1;
+    }
+
+  chunk->next = g_chunks;
+  g_chunks = chunk;
+
+  step = sizeof(union PoolHead) + (POOL_MINSIZE << cls);
+  head = chunk + 1;
+  for (n = (POOL_CHUNKSIZE - sizeof(union PoolHead)) / step; n > 0; --n)
+    {
+      head->next = g_freelist[cls];
+      g_freelist[cls] = head;
+      head = (union PoolHead *)((char *)head + step);
+    }
+
+  return 0;
+}
+
+static void pool_release(union PoolHead *head)
+{
+  int cls;
+
+  if (head->size > POOL_MAXSIZE)
+    {
+      heap_free(head);
+      return;
+    }
+
+  /* Only blocks carved for a class may go on its free list */
+
+  cls = pool_class(head->size);
+  assert(head->size == POOL_MINSIZE << cls);
+  head->next = g_freelist[cls];
+  g_freelist[cls] = head;
+}
+
+static int scratch_contains(const void *ptr)
+{
+  return (const char *)ptr >= g_scratch.buf &&
+         (const char *)ptr < g_scratch.buf + sizeof(g_scratch.buf);
+}
+
+static void scratch_pop(void)
+{
+  struct ScratchHead *head;
+
+  while (g_scratchlast != SCRATCH_NONE)
+    {
+      head = (struct ScratchHead *)(g_scratch.buf + g_scratchlast);
+      if ((head->size & SCRATCH_FREE) == 0)
+        {
+          break;
+        }
+
+      g_scratchtop = g_scratchlast;
+      g_scratchlast = head->prev;
+    }
+}
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+void *Pool_alloc(size_t size)
+{
+#ifdef CONFIG_INTERPRETER_BAS_POOL
+  union PoolHead *head;
+  int cls;
+
+  ++g_poolstats.requests;
+  cls = pool_class(size);
+  if (cls < POOL_CLASSES)
+    {
+      if (g_freelist[cls] == NULL && pool_refill(cls) == -1)
+        {
+          return NULL;
+        }
+
+      head = g_freelist[cls];
+      g_freelist[cls] = head->next;
+      head->size = POOL_MINSIZE << cls;
+      ++g_poolstats.cached;
+      return head + 1;
+    }
+
+  if ((head = heap_malloc(sizeof(union PoolHead) + size)) == NULL)
+    {
+      return NULL;
+    }
+
+  head->size = size;
+  return head + 1;
+#else
+  ++g_poolstats.requests;
+  return heap_malloc(size);
+#endif
+}
+
+void *Pool_realloc(void *ptr, size_t size)
+{
+#ifdef CONFIG_INTERPRETER_BAS_POOL
+  union PoolHead *head;
+  void *n;
+
+  if (ptr == NULL)
+    {
+      return Pool_alloc(size);
+    }
+
+  head = (union PoolHead *)ptr - 1;
+  if (head->size > POOL_MAXSIZE)
+    {
+      /* Heap blocks stay heap blocks: one that would shrink keeps its
+       * capacity, as a capacity of POOL_MAXSIZE or less would make
+       * pool_release() put it on a size class free list.
+       */
+
+      ++g_poolstats.requests;
+      if (size <= head->size)
+        {
+          ++g_poolstats.cached;
+          return ptr;
+        }
+
+      if ((head = heap_realloc(head, sizeof(union PoolHead) + size)) == NULL)
+        {
+          return NULL;
+        }
+
+      head->size = size;
+      return head + 1;
+    }
+
+  if (size <= head->size)
+    {
+      ++g_poolstats.requests;
+      ++g_poolstats.cached;
+      return ptr;
+    }
+
+  if ((n = Pool_alloc(size)) == NULL)
+    {
+      return NULL;
+    }
+
+  memcpy(n, ptr, head->size);
+  pool_release(head);
+  return n;
+#else
+  ++g_poolstats.requests;
+  return heap_realloc(ptr, size);
+#endif
+}
+
+void Pool_free(void *ptr)
+{
+  if (ptr != NULL)
+    {
+      ++g_poolstats.releases;
+#ifdef CONFIG_INTERPRETER_BAS_POOL
+      pool_release((union PoolHead *)ptr - 1);
+#else
+      heap_free(ptr);
+#endif
+    }
+}
+
+void *Pool_scratch(void *ptr, size_t size)
+{
+#ifdef CONFIG_INTERPRETER_BAS_POOL
+  struct ScratchHead *head;
+  void *n;
+
+  ++g_poolstats.requests;
+  if (ptr != NULL && !scratch_contains(ptr))
+    {
+      return heap_realloc(ptr, size);
+    }
+
+  size = POOL_ALIGN(size);
+  if (ptr != NULL)
+    {
+      /* Grow the block in place if it is on top of the arena */
+
+      head = (struct ScratchHead *)ptr - 1;
+      if (size <= head->size)
+        {
+          ++g_poolstats.cached;
+          return ptr;
+        }
+
+      if (g_scratchlast == (size_t)((char *)head - g_scratch.buf) &&
+          g_scratchlast + sizeof(*head) + size <= sizeof(g_scratch.buf))
+        {
+          head->size = size;
+          g_scratchtop = g_scratchlast + sizeof(*head) + size;
+          ++g_poolstats.cached;
+          return ptr;
+        }
+    }
+
+  if (g_scratchtop + sizeof(*head) + size <= sizeof(g_scratch.buf))
+    {
+      head = (struct ScratchHead *)(g_scratch.buf + g_scratchtop);
+      head->prev = g_scratchlast;
+      head->size = size;
+      g_scratchlast = g_scratchtop;
+      g_scratchtop += sizeof(*head) + size;
+      ++g_poolstats.cached;
+      n = head + 1;
+    }
+  else if ((n = heap_malloc(size)) == NULL)
+    {
+      return NULL;
+    }
+
+  if (ptr != NULL)
+    {
+      head = (struct ScratchHead *)ptr - 1;
+      memcpy(n, ptr, head->size);
+      head->size |= SCRATCH_FREE;
+      scratch_pop();
+    }
+
+  return n;
+#else
+  ++g_poolstats.requests;
+  return heap_realloc(ptr, size);
+#endif
+}
+
+void Pool_scratchFree(void *ptr)
+{
+  if (ptr == NULL)
+    {
+      return;
+    }
+
+  ++g_poolstats.releases;
+#ifdef CONFIG_INTERPRETER_BAS_POOL
+  if (scratch_contains(ptr))
+    {
+      ((struct ScratchHead *)ptr - 1)->size |= SCRATCH_FREE;
+      scratch_pop();
+      return;
+    }
+#endif
+
+  heap_free(ptr);
+}
+
+void Pool_scratchReset(void)
+{
+#ifdef CONFIG_INTERPRETER_BAS_POOL
+  g_scratchtop = 0;
+  g_scratchlast = SCRATCH_NONE;
+#endif
+}
+
+void Pool_destroy(void)
+{
+#ifdef CONFIG_INTERPRETER_BAS_POOL
+  union PoolHead *chunk;
+
+  while ((chunk = g_chunks) != NULL)
+    {
+      g_chunks = chunk->next;
+      heap_free(chunk);
+    }
+
+  memset(g_freelist, 0, sizeof(g_freelist));
+  Pool_scratchReset();
+#endif
+}
+
+void Pool_resetStats(int timed)
+{
+  memset(&g_poolstats, 0, sizeof(g_poolstats));
+  g_pooltimed = timed;
+}
+
+void Pool_report(FILE *stream)
+{
+  fprintf(stream, "Allocations: %lu requested, %lu without heap, "
+          "%lu released\n", g_poolstats.requests, g_poolstats.cached,
+          g_poolstats.releases);
+  fprintf(stream, "Heap calls:  %lu malloc, %lu realloc, %lu free",
+          g_poolstats.mallocs, g_poolstats.reallocs, g_poolstats.frees);
+  if (g_pooltimed)
+    {
+      fprintf(stream, ", %lu.%03lu ms",
+              (unsigned long)(g_poolstats.nsec / 1000000),
+              (unsigned long)(g_poolstats.nsec / 1000 % 1000));
+    }
+
+  fputc('\n', stream);
+}
@@ -0,0 +1,64 @@
+/****************************************************************************
+ * apps/interpreters/bas/bas_pool.h
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_EXAMPLES_BAS_BAS_POOL_H
+#define __APPS_EXAMPLES_BAS_BAS_POOL_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdio.h>
+#include <sys/types.h>
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/* Size-class allocator for string characters, variable values and error
+ * messages.  Blocks must be released with Pool_free(), never with free().
+ */
+
+void *Pool_alloc(size_t size);
+void *Pool_realloc(void *ptr, size_t size);
+void Pool_free(void *ptr);
+
+/* Scratch arena for buffers that live no longer than the statement that
+ * allocates them.  Pool_scratch() allocates (ptr == NULL) or resizes a
+ * block, Pool_scratchFree() releases one and Pool_scratchReset() drops
+ * everything.  The latter must only be called between statements.
+ */
+
+void *Pool_scratch(void *ptr, size_t size);
+void Pool_scratchFree(void *ptr);
+void Pool_scratchReset(void);
+
+/* Give all cached memory back to the heap */
+
+void Pool_destroy(void);
+
+/* Allocation statistics: Pool_resetStats() starts counting afresh and
+ * optionally times every heap call, Pool_report() prints the counters.
+ */
+
+void Pool_resetStats(int timed);
+void Pool_report(FILE *stream);
+
+#endif /* __APPS_EXAMPLES_BAS_BAS_POOL_H */
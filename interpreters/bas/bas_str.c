@@ -38,6 +38,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "bas_pool.h"
 #include "bas_str.h"
 
 /****************************************************************************
@@ -76,7 +77,7 @@ void String_destroy(struct String *this)
 
   if (this->length)
     {
-      free(this->character);
+      Pool_free(this->character);
     }
 }
 
@@ -106,7 +107,7 @@ int String_joinField(struct String *this, struct StringField *field,
   ++field->refCount;
   if (this->length)
     {
-      free(this->character);
+      Pool_free(this->character);
     }
 
   this->character = character;
@@ -166,7 +167,7 @@ int String_size(struct String *this, size_t length)
     {
       if (length > this->length)
         {
-          if ((n = realloc(this->character, length + 1)) == (char *)0)
+          if ((n = Pool_realloc(this->character, length + 1)) == (char *)0)
             {
               return -1;
             }
@@ -180,7 +181,7 @@ int String_size(struct String *this, size_t length)
     {
       if (this->length)
         {
-          free(this->character);
+          Pool_free(this->character);
         }
 
       this->character = (char *)0;
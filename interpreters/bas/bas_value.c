@@ -41,6 +41,7 @@
 #include <string.h>
 
 #include "bas_error.h"
+#include "bas_pool.h"
 #include "bas_value.h"
 
 /****************************************************************************
@@ -234,7 +235,7 @@ struct Value *Value_new_ERROR(struct Value *this, int code, const char *error,
   va_end(ap);
   this->type = V_ERROR;
   this->u.error.code = code;
-  this->u.error.msg = strcpy(malloc(strlen(buf) + 1), buf);
+  this->u.error.msg = strcpy(Pool_alloc(strlen(buf) + 1), buf);
   return this;
 }
 
@@ -334,7 +335,7 @@ void Value_destroy(struct Value *this)
   switch (this->type)
     {
     case V_ERROR:
-      free(this->u.error.msg);
+      Pool_free(this->u.error.msg);
       break;
 
     case V_INTEGER:
@@ -369,7 +370,7 @@ struct Value *Value_clone(struct Value *this, const struct Value *original)
     case V_ERROR:
       {
         strcpy(this->u.error.msg =
-               malloc(strlen(original->u.error.msg) + 1),
+               Pool_alloc(strlen(original->u.error.msg) + 1),
                original->u.error.msg);
         this->u.error.code = original->u.error.code;
         break;
@@ -1389,7 +1390,8 @@ void Value_errorPrefix(struct Value *this, const char *prefix)
   assert(this->type == V_ERROR);
   prefixlen = strlen(prefix);
   msglen = strlen(this->u.error.msg);
-  this->u.error.msg = realloc(this->u.error.msg, prefixlen + msglen + 1);
+  this->u.error.msg = Pool_realloc(this->u.error.msg,
+                                   prefixlen + msglen + 1);
   memmove(this->u.error.msg + prefixlen, this->u.error.msg, msglen);
   memcpy(this->u.error.msg, prefix, prefixlen);
 }
@@ -1401,7 +1403,8 @@ void Value_errorSuffix(struct Value *this, const char *suffix)
   assert(this->type == V_ERROR);
   suffixlen = strlen(suffix);
   msglen = strlen(this->u.error.msg);
-  this->u.error.msg = realloc(this->u.error.msg, suffixlen + msglen + 1);
+  this->u.error.msg = Pool_realloc(this->u.error.msg,
+                                   suffixlen + msglen + 1);
   memcpy(this->u.error.msg + msglen, suffix, suffixlen + 1);
 }
 
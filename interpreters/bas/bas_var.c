@@ -34,6 +34,7 @@
 #include <stdlib.h>
 
 #include "bas_error.h"
+#include "bas_pool.h"
 #include "bas_var.h"
 
 /****************************************************************************
@@ -67,14 +68,14 @@ struct Var *Var_new(struct Var *this, enum ValueType type, unsigned int dim,
       return (struct Var *)0;
     }
 
-  if ((this->value = malloc(newsize)) == (struct Value *)0)
+  if ((this->value = Pool_alloc(newsize)) == (struct Value *)0)
     {
       return (struct Var *)0;
     }
 
   if (dim)
     {
-      this->geometry = malloc(sizeof(unsigned int) * dim);
+      this->geometry = Pool_alloc(sizeof(unsigned int) * dim);
       for (i = 0; i < dim; ++i)
         {
           this->geometry[i] = geometry[i];
@@ -98,7 +99,7 @@ struct Var *Var_new_scalar(struct Var *this)
   this->dim = 0;
   this->size = 1;
   this->geometry = (unsigned int *)0;
-  this->value = malloc(sizeof(struct Value));
+  this->value = Pool_alloc(sizeof(struct Value));
   return this;
 }
 
@@ -109,13 +110,13 @@ void Var_destroy(struct Var *this)
       Value_destroy(&(this->value[this->size]));
     }
 
-  free(this->value);
+  Pool_free(this->value);
   this->value = (struct Value *)0;
   this->size = 0;
   this->dim = 0;
   if (this->geometry)
     {
-      free(this->geometry);
+      Pool_free(this->geometry);
       this->geometry = (unsigned int *)0;
     }
 }
@@ -168,7 +169,7 @@ void Var_clear(struct Var *this)
 
   if (this->geometry)
     {
-      free(this->geometry);
+      Pool_free(this->geometry);
       this->geometry = (unsigned int *)0;
       this->size = 1;
       this->dim = 0;
@@ -639,7 +640,7 @@ struct Value *Var_mat_redim(struct Var *this, unsigned int dim,
       size *= geometry[i];
     }
 
-  value = malloc(sizeof(struct Value) * size);
+  value = Pool_alloc(sizeof(struct Value) * size);
   g0 = geometry[0];
   g1 = dim == 1 ? 1 : geometry[1];
   for (i = 0; i < g0; ++i)
@@ -666,10 +667,10 @@ struct Value *Var_mat_redim(struct Var *this, unsigned int dim,
       Value_destroy(&this->value[i]);
     }
 
-  free(this->value);
+  Pool_free(this->value);
   if (this->geometry == (unsigned int *)0)
     {
-      this->geometry = malloc(sizeof(unsigned int) * dim);
+      this->geometry = Pool_alloc(sizeof(unsigned int) * dim);
     }
 
   for (i = 0; i < dim; ++i)
@@ -49,6 +49,7 @@
 #include <limits.h>
 #include <ctype.h>
 #include <assert.h>
+#include <stdint.h>
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -167,6 +168,84 @@
 
 #define MAXFORS 32              /* Maximum number of nested fors */
 
+#ifdef CONFIG_INTERPRETER_MINIBASIC_BYTECODE
+
+/* Bytecode op codes.  The code is an array of 16-bit units, an op code
+ * followed by its operands.  Jump targets take two units, low half first.
+ * Values are kept on a numeric and a string stack.
+ */
+
+#define OP_END 0                /* End of program */
+#define OP_ERROR 1              /* err: line failed to compile */
+#define OP_NUM 2                /* idx: push constant */
+#define OP_LOAD 3               /* slot: push real variable */
+#define OP_STORE 4              /* slot: pop into real variable */
+#define OP_SSTORE 5             /* slot: pop into string variable */
+#define OP_LOADDIM 6            /* slot n: pop n subscripts, push element */
+#define OP_SLOADDIM 7           /* slot n: as OP_LOADDIM, string array */
+#define OP_LVDIM 8              /* slot n: pop n subscripts, select element */
+#define OP_LV 9                 /* slot: select variable */
+#define OP_ASSIGN 10            /* pop real into selection */
+#define OP_SASSIGN 11           /* pop string into selection */
+#define OP_ADD 12
+#define OP_SUB 13
+#define OP_MUL 14
+#define OP_DIV 15
+#define OP_MOD 16
+#define OP_NEG 17
+#define OP_FACT 18
+#define OP_SIN 19
+#define OP_COS 20
+#define OP_TAN 21
+#define OP_LN 22
+#define OP_POW 23
+#define OP_SQRT 24
+#define OP_ABS 25
+#define OP_ASIN 26
+#define OP_ACOS 27
+#define OP_ATAN 28
+#define OP_INT 29
+#define OP_RND 30
+#define OP_LEN 31
+#define OP_ASCII 32
+#define OP_VAL 33
+#define OP_VALLEN 34
+#define OP_INSTR 35
+#define OP_CMP 36               /* rop: compare reals */
+#define OP_SCMP 37              /* rop: compare strings */
+#define OP_AND 38
+#define OP_OR 39
+#define OP_STR 40               /* idx: push string literal */
+#define OP_SLOAD 41             /* slot: push string variable */
+#define OP_CONCAT 42
+#define OP_CHR 43
+#define OP_STRS 44
+#define OP_LEFT 45
+#define OP_RIGHT 46
+#define OP_MID 47
+#define OP_STRING 48
+#define OP_PRINT 49
+#define OP_SPRINT 50
+#define OP_PRINTSP 51
+#define OP_PRINTNL 52
+#define OP_FLUSH 53
+#define OP_DIM 54               /* slot n: pop n dimensions */
+#define OP_DIMSET 55            /* slot i: pop real into element i */
+#define OP_SDIMSET 56           /* slot i: pop string into element i */
+#define OP_INPUT 57             /* type: read into selection */
+#define OP_GOTO 58              /* target */
+#define OP_GOTOX 59             /* pop line number */
+#define OP_JNZ 60               /* target: pop condition */
+#define OP_IFGOTO 61            /* pop line number and condition */
+#define OP_FOR 62               /* loop skip: pop init, to and step */
+#define OP_NEXT 63
+
+#define BC_TARGET(pc) ((uint32_t)(pc)[0] | ((uint32_t)(pc)[1] << 16))
+
+#define MB_HASHSIZE 64          /* Buckets in the symbol hash table */
+
+#endif
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -182,6 +261,7 @@ struct mb_variable_s
   char id[32];                  /* Id of variable */
   double dval;                  /* Its value if a real */
   FAR char *sval;               /* Its value if a string (malloced) */
+  int set;                      /* Assigned yet (bytecode only) */
 };
 
 struct mb_dimvar_s
@@ -209,6 +289,27 @@ struct mb_forloop_s
   double step;                  /* Step size */
 };
 
+#ifdef CONFIG_INTERPRETER_MINIBASIC_BYTECODE
+struct mb_symbol_s
+{
+  int next;                     /* Next symbol in the hash chain, or -1 */
+  int slot;                     /* Index in g_variables or g_dimvariables */
+  int dim;                      /* Nonzero if an array */
+};
+
+struct mb_fixup_s
+{
+  int offset;                   /* Code offset of the jump target */
+  int lineidx;                  /* Line the target refers to */
+};
+
+struct mb_bclvalue_s
+{
+  int type;                     /* FLTID or STRID or SYNTAX_ERROR */
+  int slot;                     /* Scalar slot, -1 if an array element */
+};
+#endif
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -244,6 +345,25 @@ static int g_token;                             /* Current token (lookahead) */
 static int g_errorflag;                         /* Set when error in input encountered */
 static char g_iobuffer[IOBUFSIZE];              /* I/O buffer */
 
+#ifdef CONFIG_INTERPRETER_MINIBASIC_BYTECODE
+static FAR uint16_t *g_code;                    /* Compiled program */
+static int g_ncode;                             /* Units of code used */
+static int g_codesize;                          /* Units of code allocated */
+static FAR int *g_linepc;                       /* Code offset of each line */
+static FAR double *g_consts;                    /* Numeric constants */
+static int g_nconsts;                           /* Number of constants */
+static FAR char **g_literals;                   /* String literals */
+static int g_nliterals;                         /* Number of literals */
+static FAR struct mb_fixup_s *g_fixups;         /* Unresolved jumps */
+static int g_nfixups;                           /* Number of fixups */
+static FAR struct mb_symbol_s *g_symbols;       /* Symbol table entries */
+static int g_nsymbols;                          /* Number of symbols */
+static int g_symhash[MB_HASHSIZE];              /* Symbol hash chains */
+static FAR double *g_numstack;                  /* VM numeric stack */
+static FAR char **g_strstack;                   /* VM string stack */
+static int g_bcnomem;                           /* Out of memory compiling */
+#endif
+
 /****************************************************************************
  * Private Function Prototypes
  ****************************************************************************/
@@ -261,6 +381,7 @@ static void dodim(void);
 static int doif(void);
 static int dogoto(void);
 static void doinput(void);
+static void inputvalue(FAR struct mb_lvalue_s *lv);
 static void dorem(void);
 static int dofor(void);
 static int donext(void);
@@ -281,6 +402,9 @@ static double dimvariable(void);
 static FAR struct mb_variable_s *findvariable(FAR const char *id);
 static FAR struct mb_dimvar_s *finddimvar(FAR const char *id);
 static FAR struct mb_dimvar_s *dimension(FAR const char *id, int ndims, ...);
+static FAR struct mb_dimvar_s *redimension(FAR struct mb_dimvar_s *dv,
+                                           int ndims,
+                                           FAR const int *dimensions);
 static FAR void *getdimvar(FAR struct mb_dimvar_s *dv, ...);
 static FAR struct mb_variable_s *addfloat(FAR const char *id);
 static FAR struct mb_variable_s *addstring(FAR const char *id);
@@ -316,6 +440,44 @@ static FAR char *mystrdup(FAR const char *str);
 static FAR char *mystrconcat(FAR const char *str, FAR const char *cat);
 static double factorial(double x);
 
+#ifdef CONFIG_INTERPRETER_MINIBASIC_BYTECODE
+static void emit(int unit);
+static void emitjump(int lineidx);
+static void emitnum(double x);
+static void emitstr(FAR char *str);
+static unsigned int bchash(FAR const char *id);
+static int bcsymbol(FAR const char *id, int dim);
+static int bcconstline(void);
+static int bcfindnext(int lineidx, FAR const char *id);
+
+static void bcline(int lineidx);
+static void bcprint(void);
+static void bclet(void);
+static void bcdim(void);
+static void bcif(void);
+static void bcgoto(void);
+static void bcinput(void);
+static void bcfor(int lineidx);
+static void bcnext(void);
+static void bclvalue(FAR struct mb_bclvalue_s *lv);
+static void bcsubscripts(int op, int slot);
+
+static void bcboolexpr(void);
+static void bcboolfactor(void);
+static void bcexpr(void);
+static void bcterm(void);
+static void bcfunction(int op, int str);
+static void bcfactor(void);
+static void bcstringexpr(void);
+
+static int bccompile(void);
+static FAR void *bcelement(FAR struct mb_dimvar_s *dv,
+                           FAR const double *index, int n);
+static int bcerrorline(int offset);
+static int bcrun(void);
+static void bccleanup(void);
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -1164,12 +1326,25 @@ static int donext(void)
 static void doinput(void)
 {
   struct mb_lvalue_s lv;
-  FAR char *end;
 
   match(INPUT);
   lvalue(&lv);
+  inputvalue(&lv);
+}
 
-  switch (lv.type)
+/****************************************************************************
+ * Name: inputvalue
+ *
+ * Description:
+ *   Read a value from the input stream into an lvalue
+ *
+ ****************************************************************************/
+
+static void inputvalue(FAR struct mb_lvalue_s *lv)
+{
+  FAR char *end;
+
+  switch (lv->type)
     {
     case FLTID:
       {
@@ -1203,7 +1378,7 @@ static void doinput(void)
          * in g_iobuffer.
          */
 
-        *lv.dval = strtod(g_iobuffer, &ptr);
+        *lv->dval = strtod(g_iobuffer, &ptr);
         if (ptr == g_iobuffer)
           {
             seterror(ERR_SYNTAX);
@@ -1214,10 +1389,10 @@ static void doinput(void)
 
     case STRID:
       {
-        if (*lv.sval)
+        if (*lv->sval)
           {
-            free(*lv.sval);
-            *lv.sval = NULL;
+            free(*lv->sval);
+            *lv->sval = NULL;
           }
 
         if (fgets(g_iobuffer, IOBUFSIZE, g_fpin) == 0)
@@ -1234,8 +1409,8 @@ static void doinput(void)
           }
 
         *end = 0;
-        *lv.sval = mystrdup(g_iobuffer);
-        if (!*lv.sval)
+        *lv->sval = mystrdup(g_iobuffer);
+        if (!*lv->sval)
           {
             seterror(ERR_OUTOFMEMORY);
             return;
@@ -2266,12 +2441,8 @@ static FAR struct mb_dimvar_s *dimension(FAR const char *id, int ndims, ...)
 {
   FAR struct mb_dimvar_s *dv;
   va_list vargs;
-  int size = 1;
-  int oldsize = 1;
-  int i;
   int dimensions[5];
-  FAR double *dtemp;
-  FAR char **stemp;
+  int i;
 
   assert(ndims <= 5);
   if (ndims > 5)
@@ -2291,6 +2462,39 @@ static FAR struct mb_dimvar_s *dimension(FAR const char *id, int ndims, ...)
       return 0;
     }
 
+  va_start(vargs, ndims);
+  for (i = 0; i < ndims; i++)
+    {
+      dimensions[i] = va_arg(vargs, int);
+    }
+
+  va_end(vargs);
+
+  return redimension(dv, ndims, dimensions);
+}
+
+/****************************************************************************
+ * Name: redimension
+ *
+ * Description:
+ *   Resize the storage of an array.
+ *   Params: dv - the array's entry in variable list
+ *           ndims - number of dimension (1-5)
+ *           dimensions - dimension sizes
+ *   Returns: dv, or 0 on fail
+ *
+ ****************************************************************************/
+
+static FAR struct mb_dimvar_s *redimension(FAR struct mb_dimvar_s *dv,
+                                           int ndims,
+                                           FAR const int *dimensions)
+{
+  int size = 1;
+  int oldsize = 1;
+  int i;
+  FAR double *dtemp;
+  FAR char **stemp;
+
   if (dv->ndims)
     {
       for (i = 0; i < dv->ndims; i++)
@@ -2303,15 +2507,11 @@ static FAR struct mb_dimvar_s *dimension(FAR const char *id, int ndims, ...)
       oldsize = 0;
     }
 
-  va_start(vargs, ndims);
   for (i = 0; i < ndims; i++)
     {
-      dimensions[i] = va_arg(vargs, int);
       size *= dimensions[i];
     }
 
-  va_end(vargs);
-
   switch (dv->type)
     {
     case FLTID:
@@ -2369,7 +2569,7 @@ static FAR struct mb_dimvar_s *dimension(FAR const char *id, int ndims, ...)
       assert(0);
     }
 
-  for (i = 0; i < 5; i++)
+  for (i = 0; i < ndims; i++)
     {
       dv->dim[i] = dimensions[i];
     }
@@ -2510,6 +2710,7 @@ static FAR struct mb_variable_s *addfloat(FAR const char *id)
       strcpy(g_variables[g_nvariables].id, id);
       g_variables[g_nvariables].dval = 0.0;
       g_variables[g_nvariables].sval = NULL;
+      g_variables[g_nvariables].set = 0;
       g_nvariables++;
       return &g_variables[g_nvariables - 1];
     }
@@ -2543,6 +2744,7 @@ static FAR struct mb_variable_s *addstring(FAR const char *id)
       strcpy(g_variables[g_nvariables].id, id);
       g_variables[g_nvariables].sval = NULL;
       g_variables[g_nvariables].dval = 0.0;
+      g_variables[g_nvariables].set = 0;
       g_nvariables++;
       return &g_variables[g_nvariables - 1];
     }
@@ -4073,83 +4275,2323 @@ static double factorial(double x)
   return answer;
 }
 
+#ifdef CONFIG_INTERPRETER_MINIBASIC_BYTECODE
+
 /****************************************************************************
- * Public Functions
+ * Name: emit
+ *
+ * Description:
+ *   Append one unit to the bytecode.
+ *
  ****************************************************************************/
 
+static void emit(int unit)
+{
+  FAR uint16_t *code;
+  int size;
+
+  if (g_ncode == g_codesize)
+    {
+      size = g_codesize ? g_codesize * 2 : 256;
+      code = realloc(g_code, size * sizeof(uint16_t));
+      if (!code)
+        {
+          g_bcnomem = 1;
+          return;
+        }
+
+      g_code = code;
+      g_codesize = size;
+    }
+
+  g_code[g_ncode++] = (uint16_t)unit;
+}
+
 /****************************************************************************
- * Name: basic
+ * Name: emitjump
  *
  * Description:
- *   Interpret a BASIC script
+ *   Append a two unit jump target that will be set to the start of the
+ *   given program line once all lines are compiled.
+ *   Params: lineidx - index in g_lines, or nlines for the end of program
  *
- * Input Parameters:
- *   script - the script to run
- *   in     - input stream
- *   out    - output stream
- *   err    - error stream
+ ****************************************************************************/
+
+static void emitjump(int lineidx)
+{
+  FAR struct mb_fixup_s *fixups;
+
+  fixups = realloc(g_fixups, (g_nfixups + 1) * sizeof(struct mb_fixup_s));
+  if (!fixups)
+    {
+      g_bcnomem = 1;
+      return;
+    }
+
+  g_fixups = fixups;
+  g_fixups[g_nfixups].offset = g_ncode;
+  g_fixups[g_nfixups].lineidx = lineidx;
+  g_nfixups++;
+
+  emit(0);
+  emit(0);
+}
+
+/****************************************************************************
+ * Name: emitnum
  *
- * Returned Value:
- *   Returns: 0 on success, 1 on error condition.
+ * Description:
+ *   Emit code that pushes a numeric constant.
  *
  ****************************************************************************/
 
-int basic(FAR const char *script, FILE * in, FILE * out, FILE * err)
+static void emitnum(double x)
 {
-  int curline = 0;
-  int nextline;
-  int answer = 0;
+  FAR double *consts;
 
-  g_fpin = in;
-  g_fpout = out;
-  g_fperr = err;
+  if (g_nconsts > UINT16_MAX)
+    {
+      g_bcnomem = 1;
+      return;
+    }
 
-  if (setup(script) == -1)
+  consts = realloc(g_consts, (g_nconsts + 1) * sizeof(double));
+  if (!consts)
     {
-      return 1;
+      g_bcnomem = 1;
+      return;
     }
 
-  while (curline != -1)
+  g_consts = consts;
+  g_consts[g_nconsts] = x;
+  emit(OP_NUM);
+  emit(g_nconsts++);
+}
+
+/****************************************************************************
+ * Name: emitstr
+ *
+ * Description:
+ *   Emit code that pushes a copy of a string literal.
+ *   Params: str - malloced literal, owned by the literal table from now on
+ *
+ ****************************************************************************/
+
+static void emitstr(FAR char *str)
+{
+  FAR char **literals;
+
+  literals = NULL;
+  if (g_nliterals <= UINT16_MAX)
     {
-      g_string = g_lines[curline].str;
-      g_token = gettoken(g_string);
-      g_errorflag = 0;
+      literals = realloc(g_literals,
+                         (g_nliterals + 1) * sizeof(FAR char *));
+    }
 
-      nextline = line();
-      if (g_errorflag)
+  if (!literals)
+    {
+      free(str);
+      g_bcnomem = 1;
+      return;
+    }
+
+  g_literals = literals;
+  g_literals[g_nliterals] = str;
+  emit(OP_STR);
+  emit(g_nliterals++);
+}
+
+/****************************************************************************
+ * Name: bchash
+ *
+ * Description:
+ *   Hash an identifier into the symbol table.
+ *
+ ****************************************************************************/
+
+static unsigned int bchash(FAR const char *id)
+{
+  unsigned int hash = 5381;
+
+  while (*id)
+    {
+      hash = hash * 33 + (unsigned char)*id++;
+    }
+
+  return hash & (MB_HASHSIZE - 1);
+}
+
+/****************************************************************************
+ * Name: bcsymbol
+ *
+ * Description:
+ *   Resolve a scalar or array identifier to its slot, adding it to the
+ *   variable tables if this is the first reference.  Names are only
+ *   looked up while compiling, the bytecode refers to slots.
+ *   Params: id - id of the variable (arrays include the leading ()
+ *           dim - nonzero for an array
+ *   Returns: slot number, or -1 on fail
+ *
+ ****************************************************************************/
+
+static int bcsymbol(FAR const char *id, int dim)
+{
+  FAR struct mb_symbol_s *symbols;
+  FAR const char *name;
+  unsigned int hash;
+  int slot;
+  int i;
+
+  hash = bchash(id);
+  for (i = g_symhash[hash]; i >= 0; i = g_symbols[i].next)
+    {
+      if (g_symbols[i].dim != dim)
         {
-          reporterror(g_lines[curline].no);
-          answer = 1;
-          break;
+          continue;
         }
 
-      if (nextline == -1)
+      slot = g_symbols[i].slot;
+      name = dim ? g_dimvariables[slot].id : g_variables[slot].id;
+      if (!strcmp(name, id))
         {
-          break;
+          return slot;
         }
+    }
 
-      if (nextline == 0)
+  /* Running out of slots or memory here is fatal for the compile */
+
+  symbols = NULL;
+  if (g_nvariables < UINT16_MAX && g_ndimvariables < UINT16_MAX)
+    {
+      symbols = realloc(g_symbols, (g_nsymbols + 1) * sizeof(*symbols));
+    }
+
+  if (!symbols)
+    {
+      g_bcnomem = 1;
+      return -1;
+    }
+
+  g_symbols = symbols;
+
+  slot = dim ? g_ndimvariables : g_nvariables;
+  if (!(dim ? (FAR void *)adddimvar(id) : (FAR void *)addfloat(id)))
+    {
+      g_bcnomem = 1;
+      return -1;
+    }
+
+  g_symbols[g_nsymbols].next = g_symhash[hash];
+  g_symbols[g_nsymbols].slot = slot;
+  g_symbols[g_nsymbols].dim = dim;
+  g_symhash[hash] = g_nsymbols++;
+  return slot;
+}
+
+/****************************************************************************
+ * Name: bcconstline
+ *
+ * Description:
+ *   Check if a jump target is a plain line number of an existing line.
+ *   If so the number is consumed, otherwise the parser is left untouched
+ *   and the target is compiled as an expression.
+ *   Returns: index of the target line, or -1
+ *
+ ****************************************************************************/
+
+static int bcconstline(void)
+{
+  FAR const char *savestring = g_string;
+  int savetoken = g_token;
+  int saveerror = g_errorflag;
+  double value;
+  int len;
+  int idx;
+
+  if (g_token != VALUE)
+    {
+      return -1;
+    }
+
+  value = getvalue(g_string, &len);
+  match(VALUE);
+  if ((g_token == EOL || g_token == EOS) && g_errorflag == saveerror &&
+      value >= INT_MIN && value <= INT_MAX && value == floor(value))
+    {
+      idx = findline((int)value);
+      if (idx >= 0)
         {
-          curline++;
-          if (curline == nlines)
-            break;
+          return idx;
         }
-      else
+    }
+
+  g_string = savestring;
+  g_token = savetoken;
+  g_errorflag = saveerror;
+  return -1;
+}
+
+/****************************************************************************
+ * Name: bcfindnext
+ *
+ * Description:
+ *   Find the NEXT that closes a FOR, for loops that run zero times.
+ *   Params: lineidx - index of the line with the FOR
+ *           id - id of the control variable
+ *   Returns: index of the line after that NEXT, nlines if the NEXT is the
+ *            last line, or -1 if there is none.
+ *
+ ****************************************************************************/
+
+static int bcfindnext(int lineidx, FAR const char *id)
+{
+  FAR const char *savestring = g_string;
+  int savetoken = g_token;
+  int saveerror = g_errorflag;
+  char nextid[32];
+  int answer = -1;
+  int len;
+  int i;
+
+  for (i = lineidx + 1; i < nlines && answer < 0; i++)
+    {
+      g_string = g_lines[i].str;
+      g_token = gettoken(g_string);
+      match(VALUE);
+      if (g_token == NEXT)
         {
-          curline = findline(nextline);
-          if (curline == -1)
+          match(NEXT);
+          if (g_token == FLTID || g_token == DIMFLTID)
             {
-              if (g_fperr)
+              getid(g_string, nextid, &len);
+              if (!strcmp(id, nextid))
                 {
-                  fprintf(g_fperr, "line %d not found\n", nextline);
+                  answer = i + 1;
                 }
-
-              answer = 1;
-              break;
             }
         }
     }
 
-  cleanup();
+  g_string = savestring;
+  g_token = savetoken;
+  g_errorflag = saveerror;
   return answer;
 }
+
+/****************************************************************************
+ * Name: bcline
+ *
+ * Description:
+ *   Compile one program line.  A line that does not parse is replaced by
+ *   code that reports the error, so it only fails if it is reached.
+ *
+ ****************************************************************************/
+
+static void bcline(int lineidx)
+{
+  int start = g_ncode;
+  int nfixups = g_nfixups;
+  FAR const char *str;
+
+  g_string = g_lines[lineidx].str;
+  g_token = gettoken(g_string);
+  g_errorflag = 0;
+
+  match(VALUE);
+
+  switch (g_token)
+    {
+    case PRINT:
+      bcprint();
+      break;
+
+    case LET:
+      bclet();
+      break;
+
+    case DIM:
+      bcdim();
+      break;
+
+    case IF:
+      bcif();
+      break;
+
+    case GOTO:
+      bcgoto();
+      break;
+
+    case INPUT:
+      bcinput();
+      break;
+
+    case REM:
+      return;
+
+    case FOR:
+      bcfor(lineidx);
+      break;
+
+    case NEXT:
+      bcnext();
+      break;
+
+    default:
+      seterror(ERR_SYNTAX);
+      break;
+    }
+
+  if (g_token != EOS)
+    {
+      str = g_string;
+      while (isspace(*str))
+        {
+          if (*str == '\n')
+            {
+              break;
+            }
+
+          str++;
+        }
+
+      if (*str != '\n')
+        {
+          seterror(ERR_SYNTAX);
+        }
+    }
+
+  if (g_errorflag)
+    {
+      g_ncode = start;
+      g_nfixups = nfixups;
+      emit(OP_ERROR);
+      emit(g_errorflag);
+    }
+}
+
+/****************************************************************************
+ * Name: bcprint
+ *
+ * Description:
+ *   Compile the PRINT statement
+ *
+ ****************************************************************************/
+
+static void bcprint(void)
+{
+  match(PRINT);
+
+  while (1)
+    {
+      if (isstring(g_token))
+        {
+          bcstringexpr();
+          emit(OP_SPRINT);
+        }
+      else
+        {
+          bcexpr();
+          emit(OP_PRINT);
+        }
+
+      if (g_token == COMMA)
+        {
+          emit(OP_PRINTSP);
+          match(COMMA);
+        }
+      else
+        {
+          break;
+        }
+    }
+
+  if (g_token == SEMICOLON)
+    {
+      match(SEMICOLON);
+      emit(OP_FLUSH);
+    }
+  else
+    {
+      emit(OP_PRINTNL);
+    }
+}
+
+/****************************************************************************
+ * Name: bclet
+ *
+ * Description:
+ *   Compile the LET statement
+ *
+ ****************************************************************************/
+
+static void bclet(void)
+{
+  struct mb_bclvalue_s lv;
+
+  match(LET);
+  bclvalue(&lv);
+  match(EQUALS);
+
+  switch (lv.type)
+    {
+    case FLTID:
+      bcexpr();
+      if (lv.slot >= 0)
+        {
+          emit(OP_STORE);
+          emit(lv.slot);
+        }
+      else
+        {
+          emit(OP_ASSIGN);
+        }
+      break;
+
+    case STRID:
+      bcstringexpr();
+      if (lv.slot >= 0)
+        {
+          emit(OP_SSTORE);
+          emit(lv.slot);
+        }
+      else
+        {
+          emit(OP_SASSIGN);
+        }
+      break;
+
+    default:
+      break;
+    }
+}
+
+/****************************************************************************
+ * Name: bcdim
+ *
+ * Description:
+ *   Compile the DIM statement
+ *
+ ****************************************************************************/
+
+static void bcdim(void)
+{
+  char name[32];
+  int ndims = 0;
+  int type;
+  int slot;
+  int len;
+  int i;
+
+  match(DIM);
+
+  switch (g_token)
+    {
+    case DIMFLTID:
+    case DIMSTRID:
+      type = (g_token == DIMFLTID) ? FLTID : STRID;
+      getid(g_string, name, &len);
+      match(g_token);
+      slot = bcsymbol(name, 1);
+      bcexpr();
+      ndims++;
+      while (g_token == COMMA)
+        {
+          match(COMMA);
+          bcexpr();
+          if (++ndims > 5)
+            {
+              seterror(ERR_TOOMANYDIMS);
+              return;
+            }
+        }
+
+      match(CPAREN);
+      emit(OP_DIM);
+      emit(slot);
+      emit(ndims);
+      break;
+
+    default:
+      seterror(ERR_SYNTAX);
+      return;
+    }
+
+  if (g_token == EQUALS)
+    {
+      match(EQUALS);
+
+      i = 0;
+      do
+        {
+          if (i > 0)
+            {
+              match(COMMA);
+            }
+
+          if (type == FLTID)
+            {
+              bcexpr();
+              emit(OP_DIMSET);
+            }
+          else
+            {
+              bcstringexpr();
+              emit(OP_SDIMSET);
+            }
+
+          emit(slot);
+          emit(i++);
+        }
+      while (g_token == COMMA && i <= UINT16_MAX && !g_errorflag);
+    }
+}
+
+/****************************************************************************
+ * Name: bcif
+ *
+ * Description:
+ *   Compile the IF statement
+ *
+ ****************************************************************************/
+
+static void bcif(void)
+{
+  int target;
+
+  match(IF);
+  bcboolexpr();
+  match(THEN);
+
+  target = bcconstline();
+  if (target >= 0)
+    {
+      emit(OP_JNZ);
+      emitjump(target);
+    }
+  else
+    {
+      bcexpr();
+      emit(OP_IFGOTO);
+    }
+}
+
+/****************************************************************************
+ * Name: bcgoto
+ *
+ * Description:
+ *   Compile the GOTO statement
+ *
+ ****************************************************************************/
+
+static void bcgoto(void)
+{
+  int target;
+
+  match(GOTO);
+
+  target = bcconstline();
+  if (target >= 0)
+    {
+      emit(OP_GOTO);
+      emitjump(target);
+    }
+  else
+    {
+      bcexpr();
+      emit(OP_GOTOX);
+    }
+}
+
+/****************************************************************************
+ * Name: bcinput
+ *
+ * Description:
+ *   Compile the INPUT statement
+ *
+ ****************************************************************************/
+
+static void bcinput(void)
+{
+  struct mb_bclvalue_s lv;
+
+  match(INPUT);
+  bclvalue(&lv);
+  if (lv.type == SYNTAX_ERROR)
+    {
+      return;
+    }
+
+  if (lv.slot >= 0)
+    {
+      emit(OP_LV);
+      emit(lv.slot);
+    }
+
+  emit(OP_INPUT);
+  emit(lv.type);
+}
+
+/****************************************************************************
+ * Name: bcfor
+ *
+ * Description:
+ *   Compile the FOR statement.
+ *   The FOR loop is resolved here: it jumps back to the line after the
+ *   FOR, or past the matching NEXT when the loop runs zero times.
+ *
+ ****************************************************************************/
+
+static void bcfor(int lineidx)
+{
+  struct mb_bclvalue_s lv;
+  char id[32];
+  int skip;
+  int len;
+
+  match(FOR);
+  if (g_token == FLTID || g_token == DIMFLTID ||
+      g_token == STRID || g_token == DIMSTRID)
+    {
+      getid(g_string, id, &len);
+    }
+
+  bclvalue(&lv);
+  if (lv.type != FLTID)
+    {
+      seterror(ERR_BADTYPE);
+      return;
+    }
+
+  match(EQUALS);
+  bcexpr();
+  match(TO);
+  bcexpr();
+
+  if (g_token == STEP)
+    {
+      match(STEP);
+      bcexpr();
+    }
+  else
+    {
+      emitnum(1.0);
+    }
+
+  if (lv.slot >= 0)
+    {
+      emit(OP_LV);
+      emit(lv.slot);
+    }
+
+  emit(OP_FOR);
+  emitjump(lineidx + 1);
+
+  skip = bcfindnext(lineidx, id);
+  if (skip >= 0)
+    {
+      emitjump(skip);
+    }
+  else
+    {
+      emit(UINT16_MAX);
+      emit(UINT16_MAX);
+    }
+}
+
+/****************************************************************************
+ * Name: bcnext
+ *
+ * Description:
+ *   Compile the NEXT statement
+ *
+ ****************************************************************************/
+
+static void bcnext(void)
+{
+  struct mb_bclvalue_s lv;
+
+  match(NEXT);
+  bclvalue(&lv);
+  if (lv.type != FLTID)
+    {
+      seterror(ERR_BADTYPE);
+      return;
+    }
+
+  if (lv.slot >= 0)
+    {
+      emit(OP_LV);
+      emit(lv.slot);
+    }
+
+  emit(OP_NEXT);
+}
+
+/****************************************************************************
+ * Name: bclvalue
+ *
+ * Description:
+ *   Compile an lvalue.
+ *   Scalars are returned as a slot for the caller to store to directly;
+ *   array elements are selected as the VM lvalue before the right hand
+ *   side is evaluated, as lvalue() does.
+ *
+ ****************************************************************************/
+
+static void bclvalue(FAR struct mb_bclvalue_s *lv)
+{
+  char name[32];
+  int len;
+
+  lv->type = SYNTAX_ERROR;
+  lv->slot = -1;
+
+  switch (g_token)
+    {
+    case FLTID:
+    case STRID:
+      lv->type = g_token;
+      getid(g_string, name, &len);
+      match(g_token);
+      lv->slot = bcsymbol(name, 0);
+      break;
+
+    case DIMFLTID:
+    case DIMSTRID:
+      lv->type = (g_token == DIMFLTID) ? FLTID : STRID;
+      getid(g_string, name, &len);
+      match(g_token);
+      bcsubscripts(OP_LVDIM, bcsymbol(name, 1));
+      break;
+
+    default:
+      seterror(ERR_SYNTAX);
+      break;
+    }
+}
+
+/****************************************************************************
+ * Name: bcsubscripts
+ *
+ * Description:
+ *   Compile the subscripts of an array reference and the op that uses
+ *   them.  The opening parenthesis has already been matched with the id.
+ *
+ ****************************************************************************/
+
+static void bcsubscripts(int op, int slot)
+{
+  int n = 1;
+
+  bcexpr();
+  while (g_token == COMMA)
+    {
+      match(COMMA);
+      bcexpr();
+      if (++n > 5)
+        {
+          seterror(ERR_SYNTAX);
+          return;
+        }
+    }
+
+  match(CPAREN);
+  emit(op);
+  emit(slot);
+  emit(n);
+}
+
+/****************************************************************************
+ * Name: bcboolexpr
+ *
+ * Description:
+ *   Compile a boolean expression
+ *
+ ****************************************************************************/
+
+static void bcboolexpr(void)
+{
+  bcboolfactor();
+
+  switch (g_token)
+    {
+    case AND:
+      match(AND);
+      bcboolexpr();
+      emit(OP_AND);
+      break;
+
+    case OR:
+      match(OR);
+      bcboolexpr();
+      emit(OP_OR);
+      break;
+
+    default:
+      break;
+    }
+}
+
+/****************************************************************************
+ * Name: bcboolfactor
+ *
+ * Description:
+ *   Compile a boolean factor
+ *
+ ****************************************************************************/
+
+static void bcboolfactor(void)
+{
+  int op;
+
+  if (g_token == OPAREN)
+    {
+      match(OPAREN);
+      bcboolexpr();
+      match(CPAREN);
+    }
+  else if (isstring(g_token))
+    {
+      bcstringexpr();
+      op = relop();
+      bcstringexpr();
+      emit(OP_SCMP);
+      emit(op);
+    }
+  else
+    {
+      bcexpr();
+      op = relop();
+      bcexpr();
+      emit(OP_CMP);
+      emit(op);
+    }
+}
+
+/****************************************************************************
+ * Name: bcexpr
+ *
+ * Description:
+ *   Compile an expression
+ *
+ ****************************************************************************/
+
+static void bcexpr(void)
+{
+  bcterm();
+
+  while (1)
+    {
+      switch (g_token)
+        {
+        case PLUS:
+          match(PLUS);
+          bcterm();
+          emit(OP_ADD);
+          break;
+
+        case MINUS:
+          match(MINUS);
+          bcterm();
+          emit(OP_SUB);
+          break;
+
+        default:
+          return;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: bcterm
+ *
+ * Description:
+ *   Compile a term
+ *
+ ****************************************************************************/
+
+static void bcterm(void)
+{
+  bcfactor();
+
+  while (1)
+    {
+      switch (g_token)
+        {
+        case MULT:
+          match(MULT);
+          bcfactor();
+          emit(OP_MUL);
+          break;
+
+        case DIV:
+          match(DIV);
+          bcfactor();
+          emit(OP_DIV);
+          break;
+
+        case MOD:
+          match(MOD);
+          bcfactor();
+          emit(OP_MOD);
+          break;
+
+        default:
+          return;
+        }
+    }
+}
+
+/****************************************************************************
+ * Name: bcfunction
+ *
+ * Description:
+ *   Compile a built in function that takes one argument
+ *   Params: op - op code that computes the function
+ *           str - nonzero if the argument is a string
+ *
+ ****************************************************************************/
+
+static void bcfunction(int op, int str)
+{
+  match(g_token);
+  match(OPAREN);
+  if (str)
+    {
+      bcstringexpr();
+    }
+  else
+    {
+      bcexpr();
+    }
+
+  match(CPAREN);
+  emit(op);
+}
+
+/****************************************************************************
+ * Name: bcfactor
+ *
+ * Description:
+ *   Compile a factor
+ *
+ ****************************************************************************/
+
+static void bcfactor(void)
+{
+  char name[32];
+  int len;
+
+  switch (g_token)
+    {
+    case OPAREN:
+      match(OPAREN);
+      bcexpr();
+      match(CPAREN);
+      break;
+
+    case VALUE:
+      emitnum(getvalue(g_string, &len));
+      match(VALUE);
+      break;
+
+    case MINUS:
+      match(MINUS);
+      bcfactor();
+      emit(OP_NEG);
+      break;
+
+    case FLTID:
+      getid(g_string, name, &len);
+      match(FLTID);
+      emit(OP_LOAD);
+      emit(bcsymbol(name, 0));
+      break;
+
+    case DIMFLTID:
+      getid(g_string, name, &len);
+      match(DIMFLTID);
+      bcsubscripts(OP_LOADDIM, bcsymbol(name, 1));
+      break;
+
+    case E:
+      emitnum(exp(1.0));
+      match(E);
+      break;
+
+    case PI:
+      emitnum(acos(0.0) * 2.0);
+      match(PI);
+      break;
+
+    case SIN:
+      bcfunction(OP_SIN, 0);
+      break;
+
+    case COS:
+      bcfunction(OP_COS, 0);
+      break;
+
+    case TAN:
+      bcfunction(OP_TAN, 0);
+      break;
+
+    case LN:
+      bcfunction(OP_LN, 0);
+      break;
+
+    case POW:
+      match(POW);
+      match(OPAREN);
+      bcexpr();
+      match(COMMA);
+      bcexpr();
+      match(CPAREN);
+      emit(OP_POW);
+      break;
+
+    case SQRT:
+      bcfunction(OP_SQRT, 0);
+      break;
+
+    case ABS:
+      bcfunction(OP_ABS, 0);
+      break;
+
+    case LEN:
+      bcfunction(OP_LEN, 1);
+      break;
+
+    case ASCII:
+      bcfunction(OP_ASCII, 1);
+      break;
+
+    case ASIN:
+      bcfunction(OP_ASIN, 0);
+      break;
+
+    case ACOS:
+      bcfunction(OP_ACOS, 0);
+      break;
+
+    case ATAN:
+      bcfunction(OP_ATAN, 0);
+      break;
+
+    case INT:
+      bcfunction(OP_INT, 0);
+      break;
+
+    case RND:
+      bcfunction(OP_RND, 0);
+      break;
+
+    case VAL:
+      bcfunction(OP_VAL, 1);
+      break;
+
+    case VALLEN:
+      bcfunction(OP_VALLEN, 1);
+      break;
+
+    case INSTR:
+      match(INSTR);
+      match(OPAREN);
+      bcstringexpr();
+      match(COMMA);
+      bcstringexpr();
+      match(COMMA);
+      bcexpr();
+      match(CPAREN);
+      emit(OP_INSTR);
+      break;
+
+    default:
+      if (isstring(g_token))
+        {
+          seterror(ERR_TYPEMISMATCH);
+        }
+      else
+        {
+          seterror(ERR_SYNTAX);
+        }
+      break;
+    }
+
+  while (g_token == SHRIEK)
+    {
+      match(SHRIEK);
+      emit(OP_FACT);
+    }
+}
+
+/****************************************************************************
+ * Name: bcstringexpr
+ *
+ * Description:
+ *   Compile a string expression
+ *
+ ****************************************************************************/
+
+static void bcstringexpr(void)
+{
+  FAR char *str;
+  char name[32];
+  int len;
+
+  switch (g_token)
+    {
+    case DIMSTRID:
+      getid(g_string, name, &len);
+      match(DIMSTRID);
+      bcsubscripts(OP_SLOADDIM, bcsymbol(name, 1));
+      break;
+
+    case STRID:
+      getid(g_string, name, &len);
+      match(STRID);
+      emit(OP_SLOAD);
+      emit(bcsymbol(name, 0));
+      break;
+
+    case QUOTE:
+      str = stringliteral();
+      if (!str)
+        {
+          seterror(ERR_OUTOFMEMORY);
+          return;
+        }
+
+      emitstr(str);
+      break;
+
+    case CHRSTRING:
+      bcfunction(OP_CHR, 0);
+      break;
+
+    case STRSTRING:
+      bcfunction(OP_STRS, 0);
+      break;
+
+    case LEFTSTRING:
+    case RIGHTSTRING:
+      len = g_token;
+      match(g_token);
+      match(OPAREN);
+      bcstringexpr();
+      match(COMMA);
+      bcexpr();
+      match(CPAREN);
+      emit(len == LEFTSTRING ? OP_LEFT : OP_RIGHT);
+      break;
+
+    case MIDSTRING:
+      match(MIDSTRING);
+      match(OPAREN);
+      bcstringexpr();
+      match(COMMA);
+      bcexpr();
+      match(COMMA);
+      bcexpr();
+      match(CPAREN);
+      emit(OP_MID);
+      break;
+
+    case STRINGSTRING:
+      match(STRINGSTRING);
+      match(OPAREN);
+      bcexpr();
+      match(COMMA);
+      bcstringexpr();
+      match(CPAREN);
+      emit(OP_STRING);
+      break;
+
+    default:
+      if (!isstring(g_token))
+        {
+          seterror(ERR_TYPEMISMATCH);
+        }
+      else
+        {
+          seterror(ERR_SYNTAX);
+        }
+
+      return;
+    }
+
+  if (g_token == PLUS)
+    {
+      match(PLUS);
+      bcstringexpr();
+      emit(OP_CONCAT);
+    }
+}
+
+/****************************************************************************
+ * Name: bccompile
+ *
+ * Description:
+ *   Compile the whole program to bytecode and resolve the jump targets.
+ *   Returns: 0 on success, -1 when out of memory
+ *
+ ****************************************************************************/
+
+static int bccompile(void)
+{
+  uint32_t target;
+  int depth = 0;
+  int i;
+
+  g_linepc = malloc((nlines + 1) * sizeof(int));
+  if (!g_linepc)
+    {
+      return -1;
+    }
+
+  for (i = 0; i < MB_HASHSIZE; i++)
+    {
+      g_symhash[i] = -1;
+    }
+
+  for (i = 0; i < nlines && !g_bcnomem; i++)
+    {
+      g_linepc[i] = g_ncode;
+      bcline(i);
+
+      /* Every op pushes at most one value, and every statement leaves the
+       * stacks empty, so no line needs more stack than it has code.
+       */
+
+      if (g_ncode - g_linepc[i] > depth)
+        {
+          depth = g_ncode - g_linepc[i];
+        }
+    }
+
+  g_linepc[nlines] = g_ncode;
+  emit(OP_END);
+
+  if (g_bcnomem)
+    {
+      return -1;
+    }
+
+  for (i = 0; i < g_nfixups; i++)
+    {
+      target = g_linepc[g_fixups[i].lineidx];
+      g_code[g_fixups[i].offset] = target & 0xffff;
+      g_code[g_fixups[i].offset + 1] = target >> 16;
+    }
+
+  g_numstack = malloc((depth + 1) * sizeof(double));
+  g_strstack = malloc((depth + 1) * sizeof(FAR char *));
+  if (!g_numstack || !g_strstack)
+    {
+      return -1;
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: bcelement
+ *
+ * Description:
+ *   Get the address of an array element from bytecode subscripts.
+ *   Params: dv - the array's entry in variable list
+ *           index - 1 based subscripts, x first
+ *           n - number of subscripts
+ *   Returns: the address of that element, 0 on fail
+ *
+ ****************************************************************************/
+
+static FAR void *bcelement(FAR struct mb_dimvar_s *dv,
+                           FAR const double *index, int n)
+{
+  int offset = 0;
+  int stride = 1;
+  int idx;
+  int i;
+
+  if (dv->ndims == 0)
+    {
+      seterror(ERR_NOSUCHVARIABLE);
+      return 0;
+    }
+
+  if (n != dv->ndims)
+    {
+      seterror(ERR_SYNTAX);
+      return 0;
+    }
+
+  for (i = 0; i < n; i++)
+    {
+      idx = integer(index[i]) - 1;
+      if (g_errorflag)
+        {
+          return 0;
+        }
+
+      if (idx < 0 || idx >= dv->dim[i])
+        {
+          seterror(ERR_BADSUBSCRIPT);
+          return 0;
+        }
+
+      offset += idx * stride;
+      stride *= dv->dim[i];
+    }
+
+  if (dv->type == FLTID)
+    {
+      return &dv->dval[offset];
+    }
+
+  return &dv->str[offset];
+}
+
+/****************************************************************************
+ * Name: bcerrorline
+ *
+ * Description:
+ *   Map a bytecode offset back to the number of its program line.
+ *
+ ****************************************************************************/
+
+static int bcerrorline(int offset)
+{
+  int high = nlines - 1;
+  int low = 0;
+  int mid;
+
+  while (low < high)
+    {
+      mid = (low + high + 1) / 2;
+      if (g_linepc[mid] <= offset)
+        {
+          low = mid;
+        }
+      else
+        {
+          high = mid - 1;
+        }
+    }
+
+  return g_lines[low].no;
+}
+
+/****************************************************************************
+ * Name: bcrun
+ *
+ * Description:
+ *   Run the compiled program.
+ *   Returns: 0 on success, 1 on error condition.
+ *
+ ****************************************************************************/
+
+static int bcrun(void)
+{
+  FAR const uint16_t *code = g_code;
+  FAR const uint16_t *pc = code;
+  FAR struct mb_variable_s *var;
+  FAR struct mb_dimvar_s *dv;
+  FAR struct mb_forloop_s *loop;
+  struct mb_lvalue_s lv;
+  FAR double *ns = g_numstack;
+  FAR char **ss = g_strstack;
+  FAR char *str;
+  FAR char *end;
+  FAR void *ptr;
+  double left;
+  double right;
+  int answer = 0;
+  int cmp;
+  int len;
+  int n = 0;
+  int s = 0;
+  int x;
+  int i;
+
+  lv.type = SYNTAX_ERROR;
+  lv.dval = NULL;
+  lv.sval = NULL;
+  nfors = 0;
+  g_errorflag = 0;
+
+  for (; ; )
+    {
+      switch (*pc++)
+        {
+        case OP_END:
+          goto done;
+
+        case OP_ERROR:
+          seterror(*pc++);
+          goto errout;
+
+        case OP_NUM:
+          ns[n++] = g_consts[*pc++];
+          break;
+
+        case OP_LOAD:
+          var = &g_variables[*pc++];
+          if (!var->set)
+            {
+              seterror(ERR_NOSUCHVARIABLE);
+              goto errout;
+            }
+
+          ns[n++] = var->dval;
+          break;
+
+        case OP_STORE:
+          var = &g_variables[*pc++];
+          var->dval = ns[--n];
+          var->set = 1;
+          break;
+
+        case OP_SSTORE:
+          var = &g_variables[*pc++];
+          free(var->sval);
+          var->sval = ss[--s];
+          var->set = 1;
+          break;
+
+        case OP_LOADDIM:
+        case OP_SLOADDIM:
+        case OP_LVDIM:
+          dv = &g_dimvariables[pc[0]];
+          ptr = bcelement(dv, &ns[n - pc[1]], pc[1]);
+          n -= pc[1];
+          if (!ptr)
+            {
+              goto errout;
+            }
+
+          if (pc[-1] == OP_LOADDIM)
+            {
+              ns[n++] = *(FAR double *)ptr;
+            }
+          else if (pc[-1] == OP_SLOADDIM)
+            {
+              str = *(FAR char **)ptr;
+              ss[s] = mystrdup(str ? str : "");
+              if (!ss[s++])
+                {
+                  s--;
+                  seterror(ERR_OUTOFMEMORY);
+                  goto errout;
+                }
+            }
+          else
+            {
+              lv.type = dv->type;
+              lv.dval = ptr;
+              lv.sval = ptr;
+            }
+
+          pc += 2;
+          break;
+
+        case OP_LV:
+          var = &g_variables[*pc++];
+          var->set = 1;
+          lv.dval = &var->dval;
+          lv.sval = &var->sval;
+          break;
+
+        case OP_ASSIGN:
+          *lv.dval = ns[--n];
+          break;
+
+        case OP_SASSIGN:
+          free(*lv.sval);
+          *lv.sval = ss[--s];
+          break;
+
+        case OP_ADD:
+          n--;
+          ns[n - 1] += ns[n];
+          break;
+
+        case OP_SUB:
+          n--;
+          ns[n - 1] -= ns[n];
+          break;
+
+        case OP_MUL:
+          n--;
+          ns[n - 1] *= ns[n];
+          break;
+
+        case OP_DIV:
+          n--;
+          if (ns[n] == 0.0)
+            {
+              seterror(ERR_DIVIDEBYZERO);
+              goto errout;
+            }
+
+          ns[n - 1] /= ns[n];
+          break;
+
+        case OP_MOD:
+          n--;
+          ns[n - 1] = fmod(ns[n - 1], ns[n]);
+          break;
+
+        case OP_NEG:
+          ns[n - 1] = -ns[n - 1];
+          break;
+
+        case OP_FACT:
+          ns[n - 1] = factorial(ns[n - 1]);
+          break;
+
+        case OP_SIN:
+          ns[n - 1] = sin(ns[n - 1]);
+          break;
+
+        case OP_COS:
+          ns[n - 1] = cos(ns[n - 1]);
+          break;
+
+        case OP_TAN:
+          ns[n - 1] = tan(ns[n - 1]);
+          break;
+
+        case OP_LN:
+          if (ns[n - 1] <= 0)
+            {
+              seterror(ERR_NEGLOG);
+              goto errout;
+            }
+
+          ns[n - 1] = log(ns[n - 1]);
+          break;
+
+        case OP_POW:
+          n--;
+          ns[n - 1] = pow(ns[n - 1], ns[n]);
+          break;
+
+        case OP_SQRT:
+          if (ns[n - 1] < 0.0)
+            {
+              seterror(ERR_NEGSQRT);
+              goto errout;
+            }
+
+          ns[n - 1] = sqrt(ns[n - 1]);
+          break;
+
+        case OP_ABS:
+          ns[n - 1] = fabs(ns[n - 1]);
+          break;
+
+        case OP_ASIN:
+        case OP_ACOS:
+          if (ns[n - 1] < -1 || ns[n - 1] > 1)
+            {
+              seterror(ERR_BADSINCOS);
+              goto errout;
+            }
+
+          ns[n - 1] = pc[-1] == OP_ASIN ? asin(ns[n - 1]) : acos(ns[n - 1]);
+          break;
+
+        case OP_ATAN:
+          ns[n - 1] = atan(ns[n - 1]);
+          break;
+
+        case OP_INT:
+          ns[n - 1] = floor(ns[n - 1]);
+          break;
+
+        case OP_RND:
+          left = integer(ns[n - 1]);
+          if (g_errorflag)
+            {
+              goto errout;
+            }
+
+          if (left > 1)
+            {
+              left = floor(rand() / (RAND_MAX + 1.0) * left);
+            }
+          else if (left == 1)
+            {
+              left = rand() / (RAND_MAX + 1.0);
+            }
+          else
+            {
+              if (left < 0)
+                {
+                  srand((unsigned)-left);
+                }
+
+              left = 0;
+            }
+
+          ns[n - 1] = left;
+          break;
+
+        case OP_LEN:
+        case OP_ASCII:
+        case OP_VAL:
+        case OP_VALLEN:
+          str = ss[--s];
+          switch (pc[-1])
+            {
+            case OP_LEN:
+              ns[n++] = strlen(str);
+              break;
+
+            case OP_ASCII:
+              ns[n++] = *str;
+              break;
+
+            case OP_VAL:
+              ns[n++] = strtod(str, 0);
+              break;
+
+            default:
+              strtod(str, &end);
+              ns[n++] = end - str;
+              break;
+            }
+
+          free(str);
+          break;
+
+        case OP_INSTR:
+          x = integer(ns[--n]) - 1;
+          str = ss[s - 2];
+          end = NULL;
+          if (!g_errorflag && x >= 0 && x < (int)strlen(str))
+            {
+              end = strstr(str + x, ss[s - 1]);
+            }
+
+          ns[n++] = end ? end - str + 1.0 : 0;
+          free(ss[--s]);
+          free(ss[--s]);
+          if (g_errorflag)
+            {
+              goto errout;
+            }
+          break;
+
+        case OP_CMP:
+          n--;
+          left = ns[n - 1];
+          right = ns[n];
+          switch (*pc++)
+            {
+            case ROP_EQ:
+              ns[n - 1] = (left == right) ? 1 : 0;
+              break;
+
+            case ROP_NEQ:
+              ns[n - 1] = (left != right) ? 1 : 0;
+              break;
+
+            case ROP_LT:
+              ns[n - 1] = (left < right) ? 1 : 0;
+              break;
+
+            case ROP_LTE:
+              ns[n - 1] = (left <= right) ? 1 : 0;
+              break;
+
+            case ROP_GT:
+              ns[n - 1] = (left > right) ? 1 : 0;
+              break;
+
+            default:
+              ns[n - 1] = (left >= right) ? 1 : 0;
+              break;
+            }
+          break;
+
+        case OP_SCMP:
+          cmp = strcmp(ss[s - 2], ss[s - 1]);
+          free(ss[--s]);
+          free(ss[--s]);
+          switch (*pc++)
+            {
+            case ROP_EQ:
+              ns[n++] = cmp == 0 ? 1 : 0;
+              break;
+
+            case ROP_NEQ:
+              ns[n++] = cmp == 0 ? 0 : 1;
+              break;
+
+            case ROP_LT:
+              ns[n++] = cmp < 0 ? 1 : 0;
+              break;
+
+            case ROP_LTE:
+              ns[n++] = cmp <= 0 ? 1 : 0;
+              break;
+
+            case ROP_GT:
+              ns[n++] = cmp > 0 ? 1 : 0;
+              break;
+
+            default:
+              ns[n++] = cmp >= 0 ? 1 : 0;
+              break;
+            }
+          break;
+
+        case OP_AND:
+          n--;
+          ns[n - 1] = (ns[n - 1] != 0 && ns[n] != 0) ? 1 : 0;
+          break;
+
+        case OP_OR:
+          n--;
+          ns[n - 1] = (ns[n - 1] != 0 || ns[n] != 0) ? 1 : 0;
+          break;
+
+        case OP_STR:
+        case OP_SLOAD:
+          if (pc[-1] == OP_STR)
+            {
+              str = g_literals[*pc++];
+            }
+          else
+            {
+              var = &g_variables[*pc++];
+              if (!var->set)
+                {
+                  seterror(ERR_NOSUCHVARIABLE);
+                  goto errout;
+                }
+
+              str = var->sval ? var->sval : "";
+            }
+
+          ss[s] = mystrdup(str);
+          if (!ss[s])
+            {
+              seterror(ERR_OUTOFMEMORY);
+              goto errout;
+            }
+
+          s++;
+          break;
+
+        case OP_CONCAT:
+          str = mystrconcat(ss[s - 2], ss[s - 1]);
+          free(ss[--s]);
+          if (!str)
+            {
+              seterror(ERR_OUTOFMEMORY);
+              goto errout;
+            }
+
+          free(ss[s - 1]);
+          ss[s - 1] = str;
+          break;
+
+        case OP_CHR:
+        case OP_STRS:
+          if (pc[-1] == OP_CHR)
+            {
+              g_iobuffer[0] = (char)integer(ns[--n]);
+              g_iobuffer[1] = 0;
+            }
+          else
+            {
+              sprintf(g_iobuffer, "%g", ns[--n]);
+            }
+
+          ss[s] = mystrdup(g_iobuffer);
+          if (!ss[s])
+            {
+              seterror(ERR_OUTOFMEMORY);
+            }
+          else
+            {
+              s++;
+            }
+
+          if (g_errorflag)
+            {
+              goto errout;
+            }
+          break;
+
+        case OP_LEFT:
+        case OP_RIGHT:
+          x = integer(ns[--n]);
+          str = ss[s - 1];
+          len = strlen(str);
+          if (g_errorflag)
+            {
+              goto errout;
+            }
+
+          if (x > len)
+            {
+              break;
+            }
+
+          if (x < 0)
+            {
+              seterror(ERR_ILLEGALOFFSET);
+              goto errout;
+            }
+
+          if (pc[-1] == OP_LEFT)
+            {
+              str[x] = 0;
+            }
+          else
+            {
+              memmove(str, str + len - x, x + 1);
+            }
+          break;
+
+        case OP_MID:
+          right = ns[--n];
+          x = integer(ns[--n]);
+          i = integer(right);
+          str = ss[s - 1];
+          len = strlen(str);
+          if (g_errorflag)
+            {
+              goto errout;
+            }
+
+          if (i == -1)
+            {
+              i = len - x + 1;
+            }
+
+          if (x > len || i < 1)
+            {
+              str[0] = 0;
+              break;
+            }
+
+          if (x < 1)
+            {
+              seterror(ERR_ILLEGALOFFSET);
+              goto errout;
+            }
+
+          if (i > len - x + 1)
+            {
+              i = len - x + 1;
+            }
+
+          memmove(str, str + x - 1, i);
+          str[i] = 0;
+          break;
+
+        case OP_STRING:
+          x = integer(ns[--n]);
+          if (g_errorflag)
+            {
+              goto errout;
+            }
+
+          len = strlen(ss[s - 1]);
+          str = malloc(x < 1 ? 1 : x * len + 1);
+          if (!str)
+            {
+              seterror(ERR_OUTOFMEMORY);
+              goto errout;
+            }
+
+          str[0] = 0;
+          for (i = 0; i < x; i++)
+            {
+              strcpy(str + len * i, ss[s - 1]);
+            }
+
+          free(ss[s - 1]);
+          ss[s - 1] = str;
+          break;
+
+        case OP_PRINT:
+          fprintf(g_fpout, "%g", ns[--n]);
+          break;
+
+        case OP_SPRINT:
+          fputs(ss[--s], g_fpout);
+          free(ss[s]);
+          break;
+
+        case OP_PRINTSP:
+          fputc(' ', g_fpout);
+          break;
+
+        case OP_PRINTNL:
+          fputc('\n', g_fpout);
+          break;
+
+        case OP_FLUSH:
+          fflush(g_fpout);
+          break;
+
+        case OP_DIM:
+          {
+            int dims[5];
+
+            x = pc[1];
+            n -= x;
+            for (i = 0; i < x; i++)
+              {
+                if (ns[n + i] < 0 || ns[n + i] != (int)ns[n + i])
+                  {
+                    seterror(ERR_BADSUBSCRIPT);
+                    goto errout;
+                  }
+
+                dims[i] = (int)ns[n + i];
+              }
+
+            if (!redimension(&g_dimvariables[pc[0]], x, dims))
+              {
+                goto errout;
+              }
+
+            pc += 2;
+          }
+          break;
+
+        case OP_DIMSET:
+        case OP_SDIMSET:
+          dv = &g_dimvariables[pc[0]];
+          for (len = 1, i = 0; i < dv->ndims; i++)
+            {
+              len *= dv->dim[i];
+            }
+
+          if (pc[1] >= len)
+            {
+              seterror(ERR_TOOMANYINITS);
+              goto errout;
+            }
+
+          if (pc[-1] == OP_DIMSET)
+            {
+              dv->dval[pc[1]] = ns[--n];
+            }
+          else
+            {
+              free(dv->str[pc[1]]);
+              dv->str[pc[1]] = ss[--s];
+            }
+
+          pc += 2;
+          break;
+
+        case OP_INPUT:
+          lv.type = *pc++;
+          inputvalue(&lv);
+          if (g_errorflag)
+            {
+              goto errout;
+            }
+          break;
+
+        case OP_GOTO:
+          pc = code + BC_TARGET(pc);
+          break;
+
+        case OP_JNZ:
+          if (ns[--n] != 0)
+            {
+              pc = code + BC_TARGET(pc);
+            }
+          else
+            {
+              pc += 2;
+            }
+          break;
+
+        case OP_GOTOX:
+        case OP_IFGOTO:
+          x = integer(ns[--n]);
+          if (g_errorflag)
+            {
+              goto errout;
+            }
+
+          if (pc[-1] == OP_IFGOTO && ns[--n] == 0)
+            {
+              break;
+            }
+
+          i = findline(x);
+          if (i == -1)
+            {
+              if (g_fperr)
+                {
+                  fprintf(g_fperr, "line %d not found\n", x);
+                }
+
+              answer = 1;
+              goto done;
+            }
+
+          pc = code + g_linepc[i];
+          break;
+
+        case OP_FOR:
+          right = ns[--n];
+          left = ns[--n];
+          *lv.dval = ns[--n];
+
+          if (nfors > MAXFORS - 1)
+            {
+              seterror(ERR_TOOMANYFORS);
+              goto errout;
+            }
+
+          if ((right < 0 && *lv.dval < left) ||
+              (right > 0 && *lv.dval > left))
+            {
+              if (pc[2] == UINT16_MAX && pc[3] == UINT16_MAX)
+                {
+                  seterror(ERR_NONEXT);
+                  goto errout;
+                }
+
+              pc = code + BC_TARGET(pc + 2);
+              break;
+            }
+
+          loop = &g_forstack[nfors++];
+          loop->nextline = BC_TARGET(pc);
+          loop->toval = left;
+          loop->step = right;
+          pc += 4;
+          break;
+
+        case OP_NEXT:
+          if (nfors == 0)
+            {
+              seterror(ERR_NOFOR);
+              goto errout;
+            }
+
+          loop = &g_forstack[nfors - 1];
+          *lv.dval += loop->step;
+          if ((loop->step < 0 && *lv.dval < loop->toval) ||
+              (loop->step > 0 && *lv.dval > loop->toval))
+            {
+              nfors--;
+            }
+          else
+            {
+              pc = code + loop->nextline;
+            }
+          break;
+
+        default:
+          assert(0);
+          goto done;
+        }
+    }
+
+errout:
+  reporterror(bcerrorline(pc - 1 - code));
+  answer = 1;
+
+done:
+  while (s > 0)
+    {
+      free(ss[--s]);
+    }
+
+  return answer;
+}
+
+/****************************************************************************
+ * Name: bccleanup
+ *
+ * Description:
+ *   Frees the bytecode and the compiler state
+ *
+ ****************************************************************************/
+
+static void bccleanup(void)
+{
+  int i;
+
+  for (i = 0; i < g_nliterals; i++)
+    {
+      free(g_literals[i]);
+    }
+
+  free(g_literals);
+  free(g_consts);
+  free(g_fixups);
+  free(g_symbols);
+  free(g_linepc);
+  free(g_code);
+  free(g_numstack);
+  free(g_strstack);
+
+  g_literals = NULL;
+  g_nliterals = 0;
+  g_consts = NULL;
+  g_nconsts = 0;
+  g_fixups = NULL;
+  g_nfixups = 0;
+  g_symbols = NULL;
+  g_nsymbols = 0;
+  g_linepc = NULL;
+  g_code = NULL;
+  g_ncode = 0;
+  g_codesize = 0;
+  g_numstack = NULL;
+  g_strstack = NULL;
+  g_bcnomem = 0;
+}
+
+#endif /* CONFIG_INTERPRETER_MINIBASIC_BYTECODE */
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: basic
+ *
+ * Description:
+ *   Interpret a BASIC script
+ *
+ * Input Parameters:
+ *   script - the script to run
+ *   in     - input stream
+ *   out    - output stream
+ *   err    - error stream
+ *
+ * Returned Value:
+ *   Returns: 0 on success, 1 on error condition.
+ *
+ ****************************************************************************/
+
+int basic(FAR const char *script, FILE * in, FILE * out, FILE * err)
+{
+  int curline = 0;
+  int nextline;
+  int answer = 0;
+
+  g_fpin = in;
+  g_fpout = out;
+  g_fperr = err;
+
+  if (setup(script) == -1)
+    {
+      return 1;
+    }
+
+  while (curline != -1)
+    {
+      g_string = g_lines[curline].str;
+      g_token = gettoken(g_string);
+      g_errorflag = 0;
+
+      nextline = line();
+      if (g_errorflag)
+        {
+          reporterror(g_lines[curline].no);
+          answer = 1;
+          break;
+        }
+
+      if (nextline == -1)
+        {
+          break;
+        }
+
+      if (nextline == 0)
+        {
+          curline++;
+          if (curline == nlines)
+            break;
+        }
+      else
+        {
+          curline = findline(nextline);
+          if (curline == -1)
+            {
+              if (g_fperr)
+                {
+                  fprintf(g_fperr, "line %d not found\n", nextline);
+                }
+
+              answer = 1;
+              break;
+            }
+        }
+    }
+
+  cleanup();
+  return answer;
+}
+
+#ifdef CONFIG_INTERPRETER_MINIBASIC_BYTECODE
+/****************************************************************************
+ * Name: basic_bytecode
+ *
+ * Description:
+ *   Compile a BASIC script to bytecode and run it.  The script behaves as
+ *   it does under basic(), but is only parsed once: variables and jump
+ *   targets are resolved while compiling, and the loop runs on the
+ *   compiled code.
+ *
+ * Input Parameters:
+ *   script - the script to run
+ *   in     - input stream
+ *   out    - output stream
+ *   err    - error stream
+ *
+ * Returned Value:
+ *   Returns: 0 on success, 1 on error condition.
+ *
+ ****************************************************************************/
+
+int basic_bytecode(FAR const char *script, FILE *in, FILE *out, FILE *err)
+{
+  int answer;
+
+  g_fpin = in;
+  g_fpout = out;
+  g_fperr = err;
+
+  if (setup(script) == -1)
+    {
+      return 1;
+    }
+
+  if (bccompile() < 0)
+    {
+      if (g_fperr)
+        {
+          fprintf(g_fperr, "Out of memory\n");
+        }
+
+      answer = 1;
+    }
+  else
+    {
+      answer = bcrun();
+    }
+
+  bccleanup();
+  cleanup();
+  return answer;
+}
+#endif
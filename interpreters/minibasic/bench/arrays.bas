@@ -0,0 +1,16 @@
+10 REM Fill a 2D array and sum it
+20 DIM a(50, 50)
+30 FOR k = 1 TO 20
+40 FOR i = 1 TO 50
+50 FOR j = 1 TO 50
+60 LET a(i, j) = i * j + k
+70 NEXT j
+80 NEXT i
+90 NEXT k
+100 LET s = 0
+110 FOR i = 1 TO 50
+120 FOR j = 1 TO 50
+130 LET s = s + a(i, j)
+140 NEXT j
+150 NEXT i
+160 PRINT "arrays", s
@@ -0,0 +1,17 @@
+# MiniBasic benchmarks
+#
+# Runs every script with the tree-walking interpreter (-i) and with the
+# bytecode compiler, and reports the run time of each on stderr.  Both
+# runs of a script print the same result line.  Copy this directory to
+# the target, change to it and run: sh bench.sh
+
+basic -t -i forloop.bas
+basic -t forloop.bas
+basic -t -i gotoloop.bas
+basic -t gotoloop.bas
+basic -t -i arrays.bas
+basic -t arrays.bas
+basic -t -i filter.bas
+basic -t filter.bas
+basic -t -i strings.bas
+basic -t strings.bas
@@ -0,0 +1,18 @@
+10 REM Moving average and RMS over a synthetic sensor trace
+20 DIM x(1000)
+30 FOR i = 1 TO 1000
+40 LET x(i) = SIN(i / 25) * 100 + (i MOD 13) - 6
+50 NEXT i
+60 LET w = 16
+70 LET t = 0
+80 FOR r = 1 TO 10
+90 LET m = 0
+100 FOR i = 1 TO w
+110 LET m = m + x(i)
+120 NEXT i
+130 FOR i = w + 1 TO 1000
+140 LET m = m + x(i) - x(i - w)
+150 LET t = t + (m / w) * (m / w)
+160 NEXT i
+170 NEXT r
+180 PRINT "filter", SQRT(t / (10 * (1000 - w)))
@@ -0,0 +1,8 @@
+10 REM Nested FOR/NEXT loops with scalar arithmetic
+20 LET s = 0
+30 FOR i = 1 TO 200
+40 FOR j = 1 TO 500
+50 LET s = s + i * j MOD 7
+60 NEXT j
+70 NEXT i
+80 PRINT "forloop", s
@@ -0,0 +1,7 @@
+10 REM IF/GOTO loop with a countdown
+20 LET n = 100000
+30 LET s = 0
+40 LET s = s + n / 2
+50 LET n = n - 1
+60 IF n > 0 THEN 40
+70 PRINT "gotoloop", s
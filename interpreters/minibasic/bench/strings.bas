@@ -0,0 +1,10 @@
+10 REM String building and slicing
+20 LET n = 0
+30 FOR i = 1 TO 2000
+40 LET a$ = "sample" + STR$(i)
+50 LET b$ = MID$(a$, 3, 4) + RIGHT$(a$, 2)
+60 IF LEFT$(b$, 2) = "mp" THEN 80
+70 GOTO 90
+80 LET n = n + LEN(b$)
+90 NEXT i
+100 PRINT "strings", n
@@ -45,9 +45,12 @@
 
 #include <nuttx/config.h>
 
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "interpreters/minibasic.h"
 
@@ -134,7 +137,11 @@ static void usage(void)
 {
   fprintf(stderr, "MiniBasic: a BASIC interpreter\n");
   fprintf(stderr, "usage:\n");
-  fprintf(stderr, "Basic <script>\n");
+  fprintf(stderr, "Basic [-i] [-t] <script>\n");
+#ifdef CONFIG_INTERPRETER_MINIBASIC_BYTECODE
+  fprintf(stderr, "  -i  Interpret the source instead of compiling it\n");
+#endif
+  fprintf(stderr, "  -t  Report the run time on stderr\n");
   fprintf(stderr, "See documentation for BASIC syntax.\n");
   exit(EXIT_FAILURE);
 }
@@ -153,24 +160,50 @@ static void usage(void)
 
 int main(int argc, FAR char *argv[])
 {
-  FAR char *scr;
+  int (*run)(FAR const char *, FILE *, FILE *, FILE *) = basic;
+  struct timespec start;
+  struct timespec end;
+  FAR char *scr = NULL;
+  bool timing = false;
+  long usec;
+  int ch;
+
+#ifdef CONFIG_INTERPRETER_MINIBASIC_BYTECODE
+  run = basic_bytecode;
+#endif
+
+  while ((ch = getopt(argc, argv, "it")) != EOF)
+    {
+      switch (ch)
+        {
+          case 'i':
+            run = basic;
+            break;
+
+          case 't':
+            timing = true;
+            break;
+
+          default:
+            usage();
+        }
+    }
 
-  if (argc == 1)
+  if (optind == argc)
     {
 #ifdef CONFIG_INTERPRETER_MINIBASIC_TESTSCRIPT
-      basic(script, stdin, stdout, stderr);
+      scr = script;
 #else
       fprintf(stderr, "ERROR: Missing argument.\n");
       usage();
 #endif
     }
-  else if (argc == 2)
+  else if (optind + 1 == argc)
     {
-      scr = loadfile(argv[1]);
-      if (scr)
+      scr = loadfile(argv[optind]);
+      if (!scr)
         {
-          basic(scr, stdin, stdout, stderr);
-          free(scr);
+          return 0;
         }
     }
   else
@@ -179,5 +212,25 @@ int main(int argc, FAR char *argv[])
       usage();
     }
 
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  run(scr, stdin, stdout, stderr);
+  clock_gettime(CLOCK_MONOTONIC, &end);
+
+  if (timing)
+    {
+      usec = (end.tv_sec - start.tv_sec) * 1000000 +
+             (end.tv_nsec - start.tv_nsec) / 1000;
+      fprintf(stderr, "%s: %ld.%03ld ms\n",
+              run == basic ? "interpreted" : "bytecode",
+              usec / 1000, usec % 1000);
+    }
+
+#ifdef CONFIG_INTERPRETER_MINIBASIC_TESTSCRIPT
+  if (scr != script)
+#endif
+    {
+      free(scr);
+    }
+
   return 0;
 }
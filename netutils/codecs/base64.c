@@ -53,14 +53,112 @@
  * Included Files
  ****************************************************************************/
 
+#include <sys/types.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
 #include <string.h>
+#include <errno.h>
 
 #include "netutils/base64.h"
 
 #ifdef CONFIG_CODECS_BASE64
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Values in the decoding tables that are not 6-bit digits */
+
+#define BASE64_PAD      0xfe  /* The padding character */
+#define BASE64_INVALID  0xff  /* Not part of the encoding */
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static const char g_base64_tab[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+static const char g_base64w_tab[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789__";
+
+/* Character to 6-bit digit.  A table lookup per character replaces the
+ * strchr() search through the alphabet.  The web-safe alphabet has '_'
+ * twice, which always decodes as 62.
+ */
+
+static const uint8_t g_base64_dec[256] =
+{
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0x3e, 0xff, 0xff, 0xff, 0x3f,
+  0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b,
+  0x3c, 0x3d, 0xff, 0xff, 0xff, 0xfe, 0xff, 0xff,
+  0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+  0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+  0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16,
+  0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20,
+  0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+  0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
+  0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
+static const uint8_t g_base64w_dec[256] =
+{
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfe, 0xff,
+  0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x3b,
+  0x3c, 0x3d, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+  0x07, 0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e,
+  0x0f, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16,
+  0x17, 0x18, 0x19, 0xff, 0xff, 0xff, 0xff, 0x3e,
+  0xff, 0x1a, 0x1b, 0x1c, 0x1d, 0x1e, 0x1f, 0x20,
+  0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+  0x29, 0x2a, 0x2b, 0x2c, 0x2d, 0x2e, 0x2f, 0x30,
+  0x31, 0x32, 0x33, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+  0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff
+};
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -71,12 +169,124 @@
 
 static FAR const char *base64_tab(bool websafe)
 {
-  static FAR const char *_tab =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
-  static FAR const char *_tab_w =
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789__";
+  return websafe ? g_base64w_tab : g_base64_tab;
+}
+
+/****************************************************************************
+ * Name: base64_dectab
+ ****************************************************************************/
+
+static FAR const uint8_t *base64_dectab(bool websafe)
+{
+  return websafe ? g_base64w_dec : g_base64_dec;
+}
+
+/****************************************************************************
+ * Name: base64_encode_groups
+ *
+ * Description:
+ *   Encode 'ngroups' complete 3-byte groups.  Each group is loaded into
+ *   one word and split into four 6-bit digits.
+ *
+ ****************************************************************************/
+
+static FAR unsigned char *
+base64_encode_groups(FAR const char *table, FAR const unsigned char *in,
+                     size_t ngroups, FAR unsigned char *pos)
+{
+  uint32_t word;
+
+  while (ngroups-- > 0)
+    {
+      word   = (uint32_t)in[0] << 16 | (uint32_t)in[1] << 8 | in[2];
+      pos[0] = table[word >> 18];
+      pos[1] = table[(word >> 12) & 0x3f];
+      pos[2] = table[(word >> 6) & 0x3f];
+      pos[3] = table[word & 0x3f];
+      in    += 3;
+      pos   += 4;
+    }
+
+  return pos;
+}
+
+/****************************************************************************
+ * Name: base64_encode_tail
+ *
+ * Description:
+ *   Encode the last one or two bytes, held in the low bits of 'word', and
+ *   the padding.
+ *
+ ****************************************************************************/
+
+static FAR unsigned char *
+base64_encode_tail(FAR const char *table, uint32_t word, size_t count,
+                   char ch, FAR unsigned char *pos)
+{
+  if (count == 1)
+    {
+      *pos++ = table[word >> 2];
+      *pos++ = table[(word & 0x03) << 4];
+      *pos++ = ch;
+    }
+  else
+    {
+      *pos++ = table[word >> 10];
+      *pos++ = table[(word >> 4) & 0x3f];
+      *pos++ = table[(word & 0x0f) << 2];
+    }
 
-  return websafe ? _tab_w : _tab;
+  *pos++ = ch;
+  return pos;
+}
+
+/****************************************************************************
+ * Name: base64_decode_groups
+ *
+ * Description:
+ *   Decode complete 4-character groups, combining each into one 24-bit
+ *   word.  Stops at the first group that holds anything other than four
+ *   digits, so that the caller can deal with padding and invalid
+ *   characters.
+ *
+ * Returned Value:
+ *   The number of characters consumed, a multiple of 4.
+ *
+ ****************************************************************************/
+
+static size_t base64_decode_groups(FAR const uint8_t *table,
+                                   FAR const unsigned char *src, size_t len,
+                                   FAR unsigned char **dst)
+{
+  FAR const unsigned char *in = src;
+  FAR unsigned char *pos = *dst;
+  uint32_t a;
+  uint32_t b;
+  uint32_t c;
+  uint32_t d;
+
+  while (len >= 4)
+    {
+      a = table[in[0]];
+      b = table[in[1]];
+      c = table[in[2]];
+      d = table[in[3]];
+      if (((a | b | c | d) & 0xc0) != 0)
+        {
+          break;
+        }
+
+      a      = a << 18 | b << 12 | c << 6 | d;
+      pos[0] = a >> 16;
+      pos[1] = a >> 8;
+      pos[2] = a;
+      pos   += 3;
+      in    += 4;
+      len   -= 4;
+    }
+
+  *dst = pos;
+  return in - src;
 }
 
 /****************************************************************************
@@ -108,9 +318,8 @@ static FAR unsigned char *_base64_encode(FAR const unsigned char *src,
 {
   FAR unsigned char *out;
   FAR unsigned char *pos;
-  FAR const unsigned char *end;
-  FAR const unsigned char *in;
   FAR const char *base64_table;
+  size_t rem;
   char ch = '=';
   size_t olen;
 
@@ -122,9 +331,6 @@ static FAR unsigned char *_base64_encode(FAR const unsigned char *src,
   base64_table = base64_tab(websafe);
   olen = (len + 2) / 3 * 4 + 1; /* 3-byte blocks to 4-byte */
 
-  end = src + len;
-  in = src;
-
   if (dst)
     {
       pos = out = dst;
@@ -138,30 +344,18 @@ static FAR unsigned char *_base64_encode(FAR const unsigned char *src,
         }
     }
 
-  while (end - in >= 3)
+  pos = base64_encode_groups(base64_table, src, len / 3, pos);
+
+  rem = len % 3;
+  if (rem == 1)
     {
-      *pos++ = base64_table[in[0] >> 2];
-      *pos++ = base64_table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
-      *pos++ = base64_table[((in[1] & 0x0f) << 2) | (in[2] >> 6)];
-      *pos++ = base64_table[in[2] & 0x3f];
-      in += 3;
+      pos = base64_encode_tail(base64_table, src[len - 1], 1, ch, pos);
     }
-
-  if (end - in != 0)
+  else if (rem == 2)
     {
-      *pos++ = base64_table[in[0] >> 2];
-      if (end - in == 1)
-        {
-          *pos++ = base64_table[(in[0] & 0x03) << 4];
-          *pos++ = ch;          /* *pos++ = '='; */
-        }
-      else
-        {
-          *pos++ = base64_table[((in[0] & 0x03) << 4) | (in[1] >> 4)];
-          *pos++ = base64_table[(in[1] & 0x0f) << 2];
-        }
-
-      *pos++ = ch;              /* *pos++ = '='; */
+      pos = base64_encode_tail(base64_table,
+                               (uint32_t)src[len - 2] << 8 | src[len - 1],
+                               2, ch, pos);
     }
 
   *pos = '\0';
@@ -198,10 +392,10 @@ static unsigned char *_base64_decode(FAR const unsigned char *src,
 {
   FAR unsigned char *out;
   FAR unsigned char *pos;
-  FAR unsigned char block[4];
-  FAR const char *base64_table;
+  FAR const uint8_t *table;
   char ch = '=';
-  FAR char *tmp;
+  uint32_t word;
+  uint8_t digit;
   size_t count;
   size_t i;
 
@@ -210,7 +404,7 @@ static unsigned char *_base64_decode(FAR const unsigned char *src,
       ch = '.';
     }
 
-  base64_table = base64_tab(websafe);
+  table = base64_dectab(websafe);
 
   if (dst)
     {
@@ -225,28 +419,36 @@ static unsigned char *_base64_decode(FAR const unsigned char *src,
         }
     }
 
+  /* Plain groups first, then one character at a time from the first group
+   * with padding or other characters.  Those decode as zero bits, as they
+   * always have.
+   */
+
+  i     = base64_decode_groups(table, src, len, &pos);
   count = 0;
-  for (i = 0; i < len; i++)
+  word  = 0;
+
+  for (; i < len; i++)
     {
-      tmp = strchr(base64_table, src[i]);
-      block[count] = tmp ? tmp - base64_table : 0;
+      digit = table[src[i]];
+      word  = word << 6 | (digit < 64 ? digit : 0);
       count++;
 
       if (count == 4)
         {
-          *pos++ = (block[0] << 2) | (block[1] >> 4);
+          *pos++ = word >> 16;
           if (src[i - 1] == ch)
             {
               break;
             }
 
-          *pos++ = (block[1] << 4) | (block[2] >> 2);
+          *pos++ = word >> 8;
           if (src[i] == ch)
             {
               break;
             }
 
-          *pos++ = (block[2] << 6) | block[3];
+          *pos++ = word;
           count = 0;
         }
     }
@@ -317,4 +519,197 @@ FAR void *base64w_decode(FAR const void *src, size_t len, FAR void *dst,
   return _base64_decode(src, len, dst, out_len, true);
 }
 
+/****************************************************************************
+ * Name: base64_encode_init
+ ****************************************************************************/
+
+void base64_encode_init(FAR struct base64_context_s *ctx, bool websafe)
+{
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->websafe = websafe;
+}
+
+/****************************************************************************
+ * Name: base64_encode_update
+ ****************************************************************************/
+
+size_t base64_encode_update(FAR struct base64_context_s *ctx,
+                            FAR const void *src, size_t len, FAR void *dst)
+{
+  FAR const char *table = base64_tab(ctx->websafe);
+  FAR const unsigned char *in = src;
+  FAR unsigned char *pos = dst;
+  size_t ngroups;
+
+  /* Complete the group left over from the last call */
+
+  if (ctx->count > 0)
+    {
+      while (ctx->count < 3 && len > 0)
+        {
+          ctx->word = ctx->word << 8 | *in++;
+          ctx->count++;
+          len--;
+        }
+
+      if (ctx->count < 3)
+        {
+          return 0;
+        }
+
+      pos[0] = table[ctx->word >> 18];
+      pos[1] = table[(ctx->word >> 12) & 0x3f];
+      pos[2] = table[(ctx->word >> 6) & 0x3f];
+      pos[3] = table[ctx->word & 0x3f];
+      pos   += 4;
+
+      ctx->word  = 0;
+      ctx->count = 0;
+    }
+
+  ngroups = len / 3;
+  pos     = base64_encode_groups(table, in, ngroups, pos);
+  in     += ngroups * 3;
+  len    -= ngroups * 3;
+
+  /* Keep up to two bytes for the next call */
+
+  while (len-- > 0)
+    {
+      ctx->word = ctx->word << 8 | *in++;
+      ctx->count++;
+    }
+
+  return pos - (FAR unsigned char *)dst;
+}
+
+/****************************************************************************
+ * Name: base64_encode_final
+ ****************************************************************************/
+
+size_t base64_encode_final(FAR struct base64_context_s *ctx, FAR void *dst)
+{
+  FAR unsigned char *pos = dst;
+
+  if (ctx->count > 0)
+    {
+      pos = base64_encode_tail(base64_tab(ctx->websafe), ctx->word,
+                               ctx->count, ctx->websafe ? '.' : '=', pos);
+    }
+
+  ctx->word  = 0;
+  ctx->count = 0;
+  return pos - (FAR unsigned char *)dst;
+}
+
+/****************************************************************************
+ * Name: base64_decode_init
+ ****************************************************************************/
+
+void base64_decode_init(FAR struct base64_context_s *ctx, bool websafe)
+{
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->websafe = websafe;
+}
+
+/****************************************************************************
+ * Name: base64_decode_update
+ ****************************************************************************/
+
+size_t base64_decode_update(FAR struct base64_context_s *ctx,
+                            FAR const void *src, size_t len, FAR void *dst)
+{
+  FAR const uint8_t *table = base64_dectab(ctx->websafe);
+  FAR const unsigned char *in = src;
+  FAR unsigned char *pos = dst;
+  size_t used;
+  uint8_t digit;
+
+  while (len > 0 && !ctx->done)
+    {
+      if (ctx->count == 0)
+        {
+          used = base64_decode_groups(table, in, len, &pos);
+          in  += used;
+          len -= used;
+          if (len == 0)
+            {
+              break;
+            }
+        }
+
+      digit = table[*in++];
+      len--;
+
+      if (digit < 64)
+        {
+          ctx->word = ctx->word << 6 | digit;
+          if (++ctx->count == 4)
+            {
+              *pos++ = ctx->word >> 16;
+              *pos++ = ctx->word >> 8;
+              *pos++ = ctx->word;
+              ctx->word  = 0;
+              ctx->count = 0;
+            }
+        }
+      else if (digit == BASE64_PAD && ctx->count >= 2)
+        {
+          /* The first padding character ends the data */
+
+          if (ctx->count == 2)
+            {
+              *pos++ = ctx->word >> 4;
+            }
+          else
+            {
+              *pos++ = ctx->word >> 10;
+              *pos++ = ctx->word >> 2;
+            }
+
+          ctx->word  = 0;
+          ctx->count = 0;
+          ctx->done  = true;
+        }
+
+      /* Anything else, such as line breaks, is skipped */
+    }
+
+  return pos - (FAR unsigned char *)dst;
+}
+
+/****************************************************************************
+ * Name: base64_decode_final
+ ****************************************************************************/
+
+ssize_t base64_decode_final(FAR struct base64_context_s *ctx, FAR void *dst)
+{
+  FAR unsigned char *pos = dst;
+
+  /* Input without padding may end with a partial group */
+
+  switch (ctx->count)
+    {
+      case 0:
+        break;
+
+      case 2:
+        *pos++ = ctx->word >> 4;
+        break;
+
+      case 3:
+        *pos++ = ctx->word >> 10;
+        *pos++ = ctx->word >> 2;
+        break;
+
+      default:
+        return -EINVAL;
+    }
+
+  ctx->word  = 0;
+  ctx->count = 0;
+  ctx->done  = true;
+  return pos - (FAR unsigned char *)dst;
+}
+
 #endif /* CONFIG_CODECS_BASE64 */
@@ -86,34 +86,62 @@
 #  define MD5STEP(f, w, x, y, z, data, s) \
         (w += f(x, y, z) + data,  w = w<<s | w>>(32-s),  w += x)
 
+/* MD5 words are little-endian */
+
+#  define MD5_GETLE32(p) \
+        ((uint32_t)(p)[0] | (uint32_t)(p)[1] << 8 | \
+         (uint32_t)(p)[2] << 16 | (uint32_t)(p)[3] << 24)
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
 
 /****************************************************************************
- * Name: byte_reverse
+ * Name: md5_putle32
  ****************************************************************************/
 
-#ifndef CONFIG_ENDIAN_BIG
-#  define byte_reverse(buf, len)
-#else
-static void byte_reverse(FAR unsigned char *buf, unsigned longs)
+static void md5_putle32(FAR unsigned char *p, uint32_t value)
 {
-  uint32_t t;
-  do
-    {
-      t = ((uint32_t)buf[3] << 24) |
-          ((uint32_t)buf[2] << 16) |
-          ((uint32_t)buf[1] << 8)  |
-           (uint32_t)buf[0];
+  p[0] = value;
+  p[1] = value >> 8;
+  p[2] = value >> 16;
+  p[3] = value >> 24;
+}
+
+/****************************************************************************
+ * Name: md5_block
+ *
+ * Description:
+ *   Transform one 64-byte block of the message.  On little-endian CPUs an
+ *   aligned block is transformed where it is, without a copy.  Otherwise
+ *   the words are loaded once into a local buffer, rather than copying
+ *   the block and then reversing it in place.
+ *
+ ****************************************************************************/
 
-      *(uint32_t *)buf = t;
-      buf += 4;
+static void md5_block(uint32_t buf[4], FAR const unsigned char *p)
+{
+  uint32_t in[16];
+#ifdef CONFIG_ENDIAN_BIG
+  int i;
+
+  for (i = 0; i < 16; i++, p += 4)
+    {
+      in[i] = MD5_GETLE32(p);
     }
-  while (--longs);
-}
+#else
+  if (((uintptr_t)p & 3) == 0)
+    {
+      md5_transform(buf, (FAR const uint32_t *)p);
+      return;
+    }
+
+  memcpy(in, p, 64);
 #endif
 
+  md5_transform(buf, in);
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -182,19 +210,16 @@ void md5_update(struct md5_context_s *ctx, unsigned char const *buf,
         }
 
       memcpy(p, buf, t);
-      byte_reverse(ctx->in, 16);
-      md5_transform(ctx->buf, (uint32_t *)ctx->in);
+      md5_block(ctx->buf, ctx->in);
       buf += t;
       len -= t;
     }
 
-  /* Process data in 64-byte chunks */
+  /* Process data in 64-byte chunks directly from the caller's buffer */
 
   while (len >= 64)
     {
-      memcpy(ctx->in, buf, 64);
-      byte_reverse(ctx->in, 16);
-      md5_transform(ctx->buf, (uint32_t *)ctx->in);
+      md5_block(ctx->buf, buf);
       buf += 64;
       len -= 64;
     }
@@ -240,8 +265,7 @@ void md5_final(unsigned char digest[16], struct md5_context_s *ctx)
       /* Two lots of padding: Pad the first block to 64 bytes */
 
       memset(p, 0, count);
-      byte_reverse(ctx->in, 16);
-      md5_transform(ctx->buf, (uint32_t *)ctx->in);
+      md5_block(ctx->buf, ctx->in);
 
       /* Now fill the next block with 56 bytes */
 
@@ -254,16 +278,17 @@ void md5_final(unsigned char digest[16], struct md5_context_s *ctx)
       memset(p, 0, count - 8);
     }
 
-  byte_reverse(ctx->in, 14);
-
   /* Append length in bits and transform */
 
-  ((uint32_t *)ctx->in)[14] = ctx->bits[0];
-  ((uint32_t *)ctx->in)[15] = ctx->bits[1];
+  md5_putle32(&ctx->in[56], ctx->bits[0]);
+  md5_putle32(&ctx->in[60], ctx->bits[1]);
+  md5_block(ctx->buf, ctx->in);
+
+  for (count = 0; count < 4; count++)
+    {
+      md5_putle32(&digest[4 * count], ctx->buf[count]);
+    }
 
-  md5_transform(ctx->buf, (uint32_t *)ctx->in);
-  byte_reverse((unsigned char *)ctx->buf, 4);
-  memcpy(digest, ctx->buf, 16);
   memset(ctx, 0, sizeof(struct md5_context_s));  /* In case it's sensitive */
 }
 
@@ -47,6 +47,9 @@
 
 #include <sys/socket.h>
 #include <sys/stat.h>
+#ifdef CONFIG_FTPD_SENDFILE
+#  include <sys/sendfile.h>
+#endif
 
 #include <stdint.h>
 #include <stdio.h>
@@ -57,6 +60,7 @@
 #include <ctype.h>
 #include <fcntl.h>
 #include <poll.h>
+#include <time.h>
 #include <libgen.h>
 #include <assert.h>
 #include <errno.h>
@@ -137,6 +141,21 @@ static int ftpd_getpath(FAR struct ftpd_session_s *session,
 static int ftpd_changedir(FAR struct ftpd_session_s *session,
                           FAR const char *rempath);
 static off_t ftpd_offsatoi(FAR const char *filename, off_t offset);
+static uint32_t ftpd_elapsed(FAR const struct timespec *start);
+static int ftpd_xfrcomplete(FAR struct ftpd_session_s *session,
+                            uintmax_t nbytes,
+                            FAR const struct timespec *start);
+static int ftpd_writeall(int fd, FAR const char *buffer, size_t buflen);
+#ifdef CONFIG_FTPD_SENDFILE
+static int ftpd_sendfile(FAR struct ftpd_session_s *session,
+                         FAR uintmax_t *nbytes);
+#endif
+#if CONFIG_FTPD_STORBUFFERSIZE > 0
+static int ftpd_storbatch(FAR struct ftpd_session_s *session,
+                          FAR uintmax_t *nbytes);
+#endif
+static int ftpd_streamcopy(FAR struct ftpd_session_s *session, int cmdtype,
+                           FAR uintmax_t *nbytes);
 static int ftpd_stream(FAR struct ftpd_session_s *session, int cmdtype);
 static uint8_t ftpd_listoption(FAR char **param);
 static int ftpd_listbuffer(FAR struct ftpd_session_s *session,
@@ -189,10 +208,23 @@ static int ftpd_command(FAR struct ftpd_session_s *session);
 /* Worker thread */
 
 static int ftpd_startworker(pthread_startroutine_t handler, FAR void *arg,
-                            size_t stacksize);
+                            size_t stacksize, FAR pthread_t *thread);
+static void ftpd_initsession(FAR struct ftpd_session_s *session,
+                             FAR const struct ftpd_server_s *server);
+static FAR struct ftpd_session_s *
+ftpd_allocsession(FAR const struct ftpd_server_s *server);
+static void ftpd_releasesession(FAR struct ftpd_session_s *session);
 static void ftpd_freesession(FAR struct ftpd_session_s *session);
 static void ftpd_workersetup(FAR struct ftpd_session_s *session);
+static void ftpd_serve(FAR struct ftpd_session_s *session);
 static FAR void *ftpd_worker(FAR void *arg);
+#ifdef CONFIG_FTPD_WORKERPOOL
+static FAR void *ftpd_poolworker(FAR void *arg);
+static void ftpd_poolstop(FAR struct ftpd_server_s *server);
+static int ftpd_poolstart(FAR struct ftpd_server_s *server);
+static int ftpd_poolqueue(FAR struct ftpd_server_s *server,
+                          FAR struct ftpd_pending_s *conn);
+#endif
 
 /****************************************************************************
  * Private Data
@@ -252,6 +284,7 @@ static const struct ftpd_cmd_s g_ftpdcmdtab[] =
 static const char g_cdup[]      = "..";
 static const char g_respfmt1[]  = "%03u%c%s\r\n";   /* Integer, character, string */
 static const char g_respfmt2[]  = "%03u%c%s%s\r\n"; /* Integer, character, two strings */
+static const char g_respfmt3[]  = "%03u%c%s (%ju bytes, %lu.%03lu sec, %ju B/s)\r\n";
 
 static const char *g_monthtab[] =
 {
@@ -1756,159 +1789,276 @@ static off_t ftpd_offsatoi(FAR const char *filename, off_t offset)
 }
 
 /****************************************************************************
- * Name: ftpd_stream
+ * Name: ftpd_elapsed
+ *
+ * Description:
+ *   Return the number of milliseconds elapsed since 'start'.
+ *
  ****************************************************************************/
 
-static int ftpd_stream(FAR struct ftpd_session_s *session, int cmdtype)
+static uint32_t ftpd_elapsed(FAR const struct timespec *start)
 {
-  FAR char *abspath;
-  FAR char *path;
-  bool isnew;
-  int oflags;
-  FAR char *buffer;
-  size_t buflen;
-  size_t wantsize;
-  ssize_t rdbytes;
-  ssize_t wrbytes;
-  int errval = 0;
-  int ret;
+  struct timespec now;
 
-  ret = ftpd_getpath(session, session->param, &abspath, NULL);
-  if (ret < 0)
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)((now.tv_sec - start->tv_sec) * 1000 +
+                    (now.tv_nsec - start->tv_nsec) / 1000000);
+}
+
+/****************************************************************************
+ * Name: ftpd_xfrcomplete
+ *
+ * Description:
+ *   Send the 226 transfer complete reply including the size of the
+ *   transfer, the elapsed time and the resulting throughput.
+ *
+ ****************************************************************************/
+
+static int ftpd_xfrcomplete(FAR struct ftpd_session_s *session,
+                            uintmax_t nbytes,
+                            FAR const struct timespec *start)
+{
+  uint32_t elapsed = ftpd_elapsed(start);
+  uintmax_t rate = nbytes;
+
+  /* Divide before scaling so that nbytes * 1000 cannot overflow */
+
+  if (elapsed > 0)
     {
-      ftpd_response(session->cmd.sd, session->txtimeout,
-                    g_respfmt1, 550, ' ', "Stream error !");
-      goto errout;
+      rate = nbytes / elapsed * 1000 + nbytes % elapsed * 1000 / elapsed;
     }
 
-  path = abspath;
+  return ftpd_response(session->cmd.sd, session->txtimeout,
+                       g_respfmt3, 226, ' ', "Transfer complete",
+                       nbytes, (unsigned long)(elapsed / 1000),
+                       (unsigned long)(elapsed % 1000), rate);
+}
 
-  ret = ftpd_dataopen(session);
-  if (ret < 0)
+/****************************************************************************
+ * Name: ftpd_writeall
+ *
+ * Description:
+ *   Write the entire buffer to the file, retrying on short writes.
+ *
+ * Returned Value:
+ *   Zero on success; a negated errno value on failure.
+ *
+ ****************************************************************************/
+
+static int ftpd_writeall(int fd, FAR const char *buffer, size_t buflen)
+{
+  ssize_t nwritten;
+
+  while (buflen > 0)
     {
-      goto errout_with_path;
+      nwritten = write(fd, buffer, buflen);
+      if (nwritten < 0)
+        {
+          int errval = errno;
+          nerr("ERROR: write() failed: %d\n", errval);
+          return -errval;
+        }
+
+      buflen -= nwritten;
+      buffer += nwritten;
     }
 
-  switch (cmdtype)
-    {
-      case 0: /* retr */
-        oflags = O_RDONLY;
-        break;
+  return OK;
+}
 
-      case 1: /* stor */
-        oflags = O_CREAT | O_WRONLY;
-         break;
+/****************************************************************************
+ * Name: ftpd_sendfile
+ *
+ * Description:
+ *   Send the remainder of the open file (from the current file position)
+ *   on the data connection using sendfile().
+ *
+ * Returned Value:
+ *   Zero on success.  -ENOSYS is returned if nothing was sent because
+ *   sendfile() is not usable with this file or socket; the caller should
+ *   then fall back to ftpd_streamcopy().  Any other negated errno value
+ *   indicates a failed transfer that has already been reported to the
+ *   client.
+ *
+ ****************************************************************************/
 
-      case 2: /* appe */
-        oflags = O_CREAT | O_WRONLY | O_APPEND;
-        break;
+#ifdef CONFIG_FTPD_SENDFILE
+static int ftpd_sendfile(FAR struct ftpd_session_s *session,
+                         FAR uintmax_t *nbytes)
+{
+  struct stat st;
+  off_t offset;
+  off_t remaining;
+  ssize_t nsent;
+  int errval;
+  int ret;
 
-      default:
-        oflags = O_RDONLY;
-        break;
+  if (fstat(session->fd, &st) < 0 || !S_ISREG(st.st_mode))
+    {
+      return -ENOSYS;
     }
 
-#if defined(O_LARGEFILE)
-  oflags |= O_LARGEFILE;
-#endif
-
-  /* Are we creating the file? */
+  offset = lseek(session->fd, 0, SEEK_CUR);
+  if (offset < 0)
+    {
+      return -ENOSYS;
+    }
 
-  if ((oflags & O_CREAT) != 0)
+  remaining = st.st_size - offset;
+  while (remaining > 0)
     {
-      int mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH;
+      if (session->txtimeout >= 0)
+        {
+          ret = ftpd_txpoll(session->data.sd, session->txtimeout);
+          if (ret < 0)
+            {
+              errval = -ret;
+              goto errout;
+            }
+        }
 
-      if (session->restartpos <= 0)
+      nsent = sendfile(session->data.sd, session->fd, &offset, remaining);
+      if (nsent < 0)
         {
-          oflags |= O_TRUNC;
+          errval = errno;
+          if (errval == EAGAIN || errval == EINTR)
+            {
+              continue;
+            }
+
+          /* Fall back to read()/send() if sendfile() is not supported on
+           * this socket or file system and nothing has been sent yet.
+           */
+
+          if (*nbytes == 0 &&
+              (errval == ENOSYS || errval == EINVAL || errval == EOPNOTSUPP))
+            {
+              ninfo("sendfile() not supported: %d\n", errval);
+              return -ENOSYS;
+            }
+
+          goto errout;
         }
 
-      isnew = true;
-      session->fd = open(path, oflags | O_EXCL, mode);
-      if (session->fd < 0)
+      /* The file was truncated while we were sending it */
+
+      if (nsent == 0)
         {
-          isnew = false;
-          session->fd = open(path, oflags, mode);
+          break;
         }
-    }
-  else
-    {
-      /* No.. we are opening an existing file */
 
-      isnew = false;
-      session->fd = open(path, oflags);
+      remaining -= nsent;
+      *nbytes   += nsent;
     }
 
-  if (session->fd < 0)
-    {
-      ret = -errno;
-      ftpd_response(session->cmd.sd, session->txtimeout,
-                    g_respfmt1, 550, ' ', "Can not open file !");
-      goto errout_with_data;
-    }
+  return OK;
 
-  /* Restart position */
+errout:
+  nerr("ERROR: sendfile() failed: %d\n", errval);
+  ftpd_response(session->cmd.sd, session->txtimeout,
+                g_respfmt1, 550, ' ', "Data send error !");
+  return -errval;
+}
+#endif
 
-  if (session->restartpos > 0)
-    {
-      off_t seekoffs = (off_t)-1;
-      off_t seekpos;
+/****************************************************************************
+ * Name: ftpd_storbatch
+ *
+ * Description:
+ *   Receive a binary upload, accumulating data from the connection in the
+ *   session's batch buffer so that the file system sees large writes.
+ *
+ * Returned Value:
+ *   Zero on success.  -ENOSYS is returned if batching is not available (the
+ *   caller should then fall back to ftpd_streamcopy()).  Any other negated
+ *   errno value indicates a failed transfer that has already been reported
+ *   to the client.
+ *
+ ****************************************************************************/
 
-      /* Get the seek position */
+#if CONFIG_FTPD_STORBUFFERSIZE > 0
+static int ftpd_storbatch(FAR struct ftpd_session_s *session,
+                          FAR uintmax_t *nbytes)
+{
+  ssize_t rdbytes;
+  size_t fill;
+  bool eof = false;
+  int ret;
 
-      if (session->type == FTPD_SESSIONTYPE_A)
+  if (session->storbuffer == NULL)
+    {
+      session->storbuffer = (FAR char *)malloc(CONFIG_FTPD_STORBUFFERSIZE);
+      if (session->storbuffer == NULL)
         {
-          seekpos = ftpd_offsatoi(path, session->restartpos);
-          if (seekpos < 0)
-            {
-              nerr("ERROR: ftpd_offsatoi failed: %jd\n", (intmax_t)seekpos);
-              errval = -seekpos;
-            }
+          nwarn("WARNING: No batch buffer, using direct writes\n");
+          return -ENOSYS;
         }
-      else
+    }
+
+  while (!eof)
+    {
+      /* Fill the batch buffer from the data connection */
+
+      fill = 0;
+      while (fill < CONFIG_FTPD_STORBUFFERSIZE)
         {
-          seekpos = session->restartpos;
-          if (seekpos < 0)
+          rdbytes = ftpd_recv(session->data.sd, &session->storbuffer[fill],
+                              CONFIG_FTPD_STORBUFFERSIZE - fill,
+                              session->rxtimeout);
+          if (rdbytes < 0)
             {
-              nerr("ERROR: Bad restartpos: %jd\n", (intmax_t)seekpos);
-              errval = EINVAL;
+              nerr("ERROR: ftpd_recv failed: %zd\n", rdbytes);
+              ftpd_response(session->cmd.sd, session->txtimeout,
+                            g_respfmt1, 550, ' ', "Data read error !");
+              return (int)rdbytes;
             }
-        }
-
-      /* Seek to the request position */
 
-      if (seekpos >= 0)
-        {
-          seekoffs = lseek(session->fd, seekpos, SEEK_SET);
-          if (seekoffs < 0)
+          if (rdbytes == 0)
             {
-              errval = errno;
-              nerr("ERROR: lseek failed: %d\n", errval);
+              eof = true;
+              break;
             }
+
+          fill += rdbytes;
         }
 
-      /* Report errors.  If an error occurred, seekoffs will be negative and
-       * errval will hold the (positive) error code.
-       */
+      /* Then write it to the file in one go */
 
-      if (seekoffs < 0)
+      ret = ftpd_writeall(session->fd, session->storbuffer, fill);
+      if (ret < 0)
         {
           ftpd_response(session->cmd.sd, session->txtimeout,
-                        g_respfmt1, 550, ' ', "Can not seek file !");
-          ret = -errval;
-          goto errout_with_session;
+                        g_respfmt1, 550, ' ', "Data send error !");
+          return ret;
         }
+
+      *nbytes += fill;
     }
 
-  /* Send success message */
+  return OK;
+}
+#endif
 
-  ret = ftpd_response(session->cmd.sd, session->txtimeout,
-                      g_respfmt1, 150, ' ', "Opening data connection");
-  if (ret < 0)
-    {
-      nerr("ERROR: ftpd_response failed: %d\n", ret);
-      goto errout_with_session;
-    }
+/****************************************************************************
+ * Name: ftpd_streamcopy
+ *
+ * Description:
+ *   Copy data between the file and the data connection through the session
+ *   data buffer.  This handles ASCII conversion and is the fallback path
+ *   for binary transfers.
+ *
+ ****************************************************************************/
+
+static int ftpd_streamcopy(FAR struct ftpd_session_s *session, int cmdtype,
+                           FAR uintmax_t *nbytes)
+{
+  FAR char *buffer;
+  size_t buflen;
+  size_t wantsize;
+  ssize_t rdbytes;
+  ssize_t wrbytes;
+  int errval = 0;
+  int ret;
 
   for (; ; )
     {
@@ -1969,12 +2119,7 @@ static int ftpd_stream(FAR struct ftpd_session_s *session, int cmdtype)
 
       if (rdbytes == 0)
         {
-          /* End-of-file */
-
-          ftpd_response(session->cmd.sd, session->txtimeout,
-                        g_respfmt1, 226, ' ', "Transfer complete");
-
-          /* Return success */
+          /* End-of-file.  Return success */
 
           ret = 0;
           break;
@@ -2018,31 +2163,18 @@ static int ftpd_stream(FAR struct ftpd_session_s *session, int cmdtype)
         }
       else
         {
-          int remaining;
-          int nwritten;
-          FAR char *next;
-
-          remaining = buflen;
-          next = buffer;
-
           /* Write to the file */
 
-          do
+          ret = ftpd_writeall(session->fd, buffer, buflen);
+          if (ret < 0)
             {
-              nwritten = write(session->fd, next, remaining);
-              if (nwritten < 0)
-                {
-                  errval = errno;
-                  nerr("ERROR: write() failed: %d\n", errval);
-                  break;
-                }
-
-              remaining -= nwritten;
-              next += nwritten;
+              errval = -ret;
+              wrbytes = ret;
+            }
+          else
+            {
+              wrbytes = buflen;
             }
-          while (remaining > 0);
-
-          wrbytes = next - buffer;
         }
 
       /* If the number of bytes returned by the write is not equal to the
@@ -2060,37 +2192,229 @@ static int ftpd_stream(FAR struct ftpd_session_s *session, int cmdtype)
           ret = -errval;
           break;
         }
-    }
-
-errout_with_session:;
-    close(session->fd);
-    session->fd = -1;
-
-    if (isnew && ret < 0)
-      {
-        unlink(path);
-      }
-
-errout_with_data:;
-    ftpd_dataclose(session);
 
-errout_with_path:
-    free(abspath);
+      *nbytes += rdbytes;
+    }
 
-errout:
-    return ret;
+  return ret;
 }
 
 /****************************************************************************
- * Name: ftpd_listoption
+ * Name: ftpd_stream
  ****************************************************************************/
 
-static uint8_t ftpd_listoption(FAR char **param)
+static int ftpd_stream(FAR struct ftpd_session_s *session, int cmdtype)
 {
-  FAR char *ptr = *param;
-  uint8_t ret = 0;
-
-  while (*ptr == '-')
+  FAR char *abspath;
+  FAR char *path;
+  struct timespec start;
+  uintmax_t nbytes;
+  bool isnew;
+  int oflags;
+  int errval = 0;
+  int ret;
+
+  ret = ftpd_getpath(session, session->param, &abspath, NULL);
+  if (ret < 0)
+    {
+      ftpd_response(session->cmd.sd, session->txtimeout,
+                    g_respfmt1, 550, ' ', "Stream error !");
+      goto errout;
+    }
+
+  path = abspath;
+
+  ret = ftpd_dataopen(session);
+  if (ret < 0)
+    {
+      goto errout_with_path;
+    }
+
+  switch (cmdtype)
+    {
+      case 0: /* retr */
+        oflags = O_RDONLY;
+        break;
+
+      case 1: /* stor */
+        oflags = O_CREAT | O_WRONLY;
+         break;
+
+      case 2: /* appe */
+        oflags = O_CREAT | O_WRONLY | O_APPEND;
+        break;
+
+      default:
+        oflags = O_RDONLY;
+        break;
+    }
+
+#if defined(O_LARGEFILE)
+  oflags |= O_LARGEFILE;
+#endif
+
+  /* Are we creating the file? */
+
+  if ((oflags & O_CREAT) != 0)
+    {
+      int mode = S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH;
+
+      if (session->restartpos <= 0)
+        {
+          oflags |= O_TRUNC;
+        }
+
+      isnew = true;
+      session->fd = open(path, oflags | O_EXCL, mode);
+      if (session->fd < 0)
+        {
+          isnew = false;
+          session->fd = open(path, oflags, mode);
+        }
+    }
+  else
+    {
+      /* No.. we are opening an existing file */
+
+      isnew = false;
+      session->fd = open(path, oflags);
+    }
+
+  if (session->fd < 0)
+    {
+      ret = -errno;
+      ftpd_response(session->cmd.sd, session->txtimeout,
+                    g_respfmt1, 550, ' ', "Can not open file !");
+      goto errout_with_data;
+    }
+
+  /* Restart position */
+
+  if (session->restartpos > 0)
+    {
+      off_t seekoffs = (off_t)-1;
+      off_t seekpos;
+
+      /* Get the seek position */
+
+      if (session->type == FTPD_SESSIONTYPE_A)
+        {
+          seekpos = ftpd_offsatoi(path, session->restartpos);
+          if (seekpos < 0)
+            {
+              nerr("ERROR: ftpd_offsatoi failed: %jd\n", (intmax_t)seekpos);
+              errval = -seekpos;
+            }
+        }
+      else
+        {
+          seekpos = session->restartpos;
+          if (seekpos < 0)
+            {
+              nerr("ERROR: Bad restartpos: %jd\n", (intmax_t)seekpos);
+              errval = EINVAL;
+            }
+        }
+
+      /* Seek to the request position */
+
+      if (seekpos >= 0)
+        {
+          seekoffs = lseek(session->fd, seekpos, SEEK_SET);
+          if (seekoffs < 0)
+            {
+              errval = errno;
+              nerr("ERROR: lseek failed: %d\n", errval);
+            }
+        }
+
+      /* Report errors.  If an error occurred, seekoffs will be negative and
+       * errval will hold the (positive) error code.
+       */
+
+      if (seekoffs < 0)
+        {
+          ftpd_response(session->cmd.sd, session->txtimeout,
+                        g_respfmt1, 550, ' ', "Can not seek file !");
+          ret = -errval;
+          goto errout_with_session;
+        }
+    }
+
+  /* Send success message */
+
+  ret = ftpd_response(session->cmd.sd, session->txtimeout,
+                      g_respfmt1, 150, ' ', "Opening data connection");
+  if (ret < 0)
+    {
+      nerr("ERROR: ftpd_response failed: %d\n", ret);
+      goto errout_with_session;
+    }
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  nbytes = 0;
+  ret    = -ENOSYS;
+
+  /* Use the zero-copy or batched paths for binary transfers when they are
+   * available, falling back to copying through the data buffer.
+   */
+
+  if (session->type != FTPD_SESSIONTYPE_A)
+    {
+#ifdef CONFIG_FTPD_SENDFILE
+      if (cmdtype == 0)
+        {
+          ret = ftpd_sendfile(session, &nbytes);
+        }
+#endif
+
+#if CONFIG_FTPD_STORBUFFERSIZE > 0
+      if (cmdtype != 0)
+        {
+          ret = ftpd_storbatch(session, &nbytes);
+        }
+#endif
+    }
+
+  if (ret == -ENOSYS)
+    {
+      ret = ftpd_streamcopy(session, cmdtype, &nbytes);
+    }
+
+  if (ret == 0)
+    {
+      ftpd_xfrcomplete(session, nbytes, &start);
+    }
+
+errout_with_session:;
+    close(session->fd);
+    session->fd = -1;
+
+    if (isnew && ret < 0)
+      {
+        unlink(path);
+      }
+
+errout_with_data:;
+    ftpd_dataclose(session);
+
+errout_with_path:
+    free(abspath);
+
+errout:
+    return ret;
+}
+
+/****************************************************************************
+ * Name: ftpd_listoption
+ ****************************************************************************/
+
+static uint8_t ftpd_listoption(FAR char **param)
+{
+  FAR char *ptr = *param;
+  uint8_t ret = 0;
+
+  while (*ptr == '-')
     {
       while (*ptr != '\0' && !isspace(*ptr))
         {
@@ -3983,7 +4307,7 @@ static int ftpd_command(FAR struct ftpd_session_s *session)
  ****************************************************************************/
 
 static int ftpd_startworker(pthread_startroutine_t handler, FAR void *arg,
-                            size_t stacksize)
+                            size_t stacksize, FAR pthread_t *thread)
 {
   pthread_t threadid;
   pthread_attr_t attr;
@@ -4016,12 +4340,21 @@ static int ftpd_startworker(pthread_startroutine_t handler, FAR void *arg,
       goto errout_with_attr;
     }
 
-  /* Put the thread in the detached stated */
+  /* Return the thread ID if the caller will join the thread.  Otherwise,
+   * put the thread in the detached stated.
+   */
 
-  ret = pthread_detach(threadid);
-  if (ret != 0)
+  if (thread != NULL)
     {
-      nerr("ERROR: pthread_detach() failed: %d\n", ret);
+      *thread = threadid;
+    }
+  else
+    {
+      ret = pthread_detach(threadid);
+      if (ret != 0)
+        {
+          nerr("ERROR: pthread_detach() failed: %d\n", ret);
+        }
     }
 
 errout_with_attr:
@@ -4031,53 +4364,163 @@ errout:
 }
 
 /****************************************************************************
- * Name: ftpd_freesession
+ * Name: ftpd_initsession
+ *
+ * Description:
+ *   Set the per-connection state of a session to its initial values.  The
+ *   session buffers are not touched.
+ *
  ****************************************************************************/
 
-static void ftpd_freesession(FAR struct ftpd_session_s *session)
+static void ftpd_initsession(FAR struct ftpd_session_s *session,
+                             FAR const struct ftpd_server_s *server)
 {
-  /* Free resources */
+  session->server       = server;
+  session->head         = server->head;
+  session->loggedin     = false;
+  session->flags        = 0;
+  session->txtimeout    = -1;
+  session->rxtimeout    = -1;
+  session->cmd.sd       = -1;
+  session->cmd.addrlen  = sizeof(session->cmd.addr);
+  session->command      = NULL;
+  session->param        = NULL;
+  session->data.sd      = -1;
+  session->data.addrlen = sizeof(session->data.addr);
+  session->restartpos   = 0;
+  session->fd           = -1;
+  session->user         = NULL;
+  session->type         = FTPD_SESSIONTYPE_NONE;
+  session->home         = NULL;
+  session->work         = NULL;
+  session->renamefrom   = NULL;
+}
 
-  if (session->renamefrom != NULL)
-    {
-      free(session->renamefrom);
-    }
+/****************************************************************************
+ * Name: ftpd_allocsession
+ *
+ * Description:
+ *   Allocate and initialize a session and its command and data buffers.
+ *
+ ****************************************************************************/
 
-  if (session->work != NULL)
+static FAR struct ftpd_session_s *
+ftpd_allocsession(FAR const struct ftpd_server_s *server)
+{
+  FAR struct ftpd_session_s *session;
+
+  session = (FAR struct ftpd_session_s *)
+    zalloc(sizeof(struct ftpd_session_s));
+  if (session == NULL)
     {
-      free(session->work);
+      nerr("ERROR: Failed to allocate session\n");
+      return NULL;
     }
 
-  if (session->home != NULL)
+  ftpd_initsession(session, server);
+
+  /* Allocate a command buffer */
+
+  session->cmd.buflen = CONFIG_FTPD_CMDBUFFERSIZE;
+  session->cmd.buffer = (FAR char *)malloc(session->cmd.buflen);
+  if (session->cmd.buffer == NULL)
     {
-      free(session->home);
+      nerr("ERROR: Failed to allocate command buffer\n");
+      goto errout_with_session;
     }
 
-  if (session->user != NULL)
+  /* Allocate a data buffer */
+
+  session->data.buflen = CONFIG_FTPD_DATABUFFERSIZE;
+  session->data.buffer = (FAR char *)malloc(session->data.buflen);
+  if (session->data.buffer == NULL)
+    {
+      nerr("ERROR: Failed to allocate data buffer\n");
+      goto errout_with_session;
+    }
+
+  return session;
+
+errout_with_session:
+  ftpd_freesession(session);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: ftpd_releasesession
+ *
+ * Description:
+ *   Close the sockets and file of a session and free the per-connection
+ *   state, leaving the session buffers allocated for re-use.
+ *
+ ****************************************************************************/
+
+static void ftpd_releasesession(FAR struct ftpd_session_s *session)
+{
+  if (session->renamefrom != NULL)
+    {
+      free(session->renamefrom);
+      session->renamefrom = NULL;
+    }
+
+  if (session->work != NULL)
+    {
+      free(session->work);
+      session->work = NULL;
+    }
+
+  if (session->home != NULL)
+    {
+      free(session->home);
+      session->home = NULL;
+    }
+
+  if (session->user != NULL)
     {
       free(session->user);
+      session->user = NULL;
     }
 
   if (session->fd >= 0)
     {
       close(session->fd);
+      session->fd = -1;
+    }
+
+  ftpd_dataclose(session);
+
+  if (session->cmd.sd >= 0)
+    {
+      close(session->cmd.sd);
+      session->cmd.sd = -1;
     }
+}
+
+/****************************************************************************
+ * Name: ftpd_freesession
+ ****************************************************************************/
+
+static void ftpd_freesession(FAR struct ftpd_session_s *session)
+{
+  /* Free resources */
+
+  ftpd_releasesession(session);
 
   if (session->data.buffer != NULL)
     {
       free(session->data.buffer);
     }
 
-  ftpd_dataclose(session);
-
-  if (session->cmd.buffer != NULL)
+#if CONFIG_FTPD_STORBUFFERSIZE > 0
+  if (session->storbuffer != NULL)
     {
-      free(session->cmd.buffer);
+      free(session->storbuffer);
     }
+#endif
 
-  if (session->cmd.sd >= 0)
+  if (session->cmd.buffer != NULL)
     {
-      close(session->cmd.sd);
+      free(session->cmd.buffer);
     }
 
   free(session);
@@ -4117,20 +4560,21 @@ static void ftpd_workersetup(FAR struct ftpd_session_s *session)
 }
 
 /****************************************************************************
- * Name: ftpd_worker
+ * Name: ftpd_serve
+ *
+ * Description:
+ *   Process FTP commands on the session's control connection until the
+ *   client disconnects or an error occurs.
+ *
  ****************************************************************************/
 
-static FAR void *ftpd_worker(FAR void *arg)
+static void ftpd_serve(FAR struct ftpd_session_s *session)
 {
-  FAR struct ftpd_session_s *session = (FAR struct ftpd_session_s *)arg;
   ssize_t recvbytes;
   size_t offset;
   uint8_t ch;
   int ret;
 
-  ninfo("Worker started\n");
-  DEBUGASSERT(session);
-
   /* Configure the session sockets */
 
   ftpd_workersetup(session);
@@ -4142,8 +4586,7 @@ static FAR void *ftpd_worker(FAR void *arg)
   if (ret < 0)
     {
       nerr("ERROR: ftpd_response() failed: %d\n", ret);
-      ftpd_freesession(session);
-      return NULL;
+      return;
     }
 
   /* Then loop processing FTP commands */
@@ -4238,11 +4681,266 @@ static FAR void *ftpd_worker(FAR void *arg)
           break;
         }
     }
+}
+
+/****************************************************************************
+ * Name: ftpd_worker
+ ****************************************************************************/
+
+static FAR void *ftpd_worker(FAR void *arg)
+{
+  FAR struct ftpd_session_s *session = (FAR struct ftpd_session_s *)arg;
 
+  ninfo("Worker started\n");
+  DEBUGASSERT(session);
+
+  ftpd_serve(session);
   ftpd_freesession(session);
   return NULL;
 }
 
+#ifdef CONFIG_FTPD_WORKERPOOL
+/****************************************************************************
+ * Name: ftpd_poolworker
+ *
+ * Description:
+ *   A pre-spawned session worker.  Each worker owns one pre-allocated
+ *   session and serves queued connections with it until the pool is
+ *   stopped.
+ *
+ ****************************************************************************/
+
+static FAR void *ftpd_poolworker(FAR void *arg)
+{
+  FAR struct ftpd_session_s *session = (FAR struct ftpd_session_s *)arg;
+  FAR struct ftpd_pool_s *pool;
+  FAR struct ftpd_pending_s *pending;
+  int sd;
+
+  DEBUGASSERT(session != NULL && session->server != NULL);
+  pool = session->server->pool;
+
+  ninfo("Pool worker started\n");
+
+  pthread_mutex_lock(&pool->lock);
+  for (; ; )
+    {
+      /* Wait for a connection to be queued */
+
+      while (pool->qdepth == 0 && !pool->stop)
+        {
+          pthread_cond_wait(&pool->cond, &pool->lock);
+        }
+
+      if (pool->stop)
+        {
+          break;
+        }
+
+      /* Take the oldest connection from the queue */
+
+      pending    = &pool->queue[pool->head];
+      pool->head = (pool->head + 1) % CONFIG_FTPD_ACCEPTBACKLOG;
+      pool->qdepth--;
+      pool->busy++;
+
+      ftpd_initsession(session, session->server);
+      memcpy(&session->cmd.addr, &pending->addr, pending->addrlen);
+      session->cmd.addrlen = pending->addrlen;
+      session->cmd.sd      = pending->sd;
+      pthread_mutex_unlock(&pool->lock);
+
+      ftpd_serve(session);
+
+      /* Detach the control socket under the lock so that ftpd_close() never
+       * sees a descriptor that is being closed.
+       */
+
+      pthread_mutex_lock(&pool->lock);
+      sd              = session->cmd.sd;
+      session->cmd.sd = -1;
+      pool->busy--;
+      pthread_mutex_unlock(&pool->lock);
+
+      close(sd);
+      ftpd_releasesession(session);
+
+      pthread_mutex_lock(&pool->lock);
+    }
+
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: ftpd_poolstop
+ *
+ * Description:
+ *   Stop the session workers, close any queued connections and free the
+ *   pool.
+ *
+ ****************************************************************************/
+
+static void ftpd_poolstop(FAR struct ftpd_server_s *server)
+{
+  FAR struct ftpd_pool_s *pool = server->pool;
+  int i;
+
+  /* Ask the workers to stop and break any active sessions */
+
+  pthread_mutex_lock(&pool->lock);
+  pool->stop = true;
+
+  for (i = 0; i < pool->nstarted; i++)
+    {
+      if (pool->sessions[i]->cmd.sd >= 0)
+        {
+          shutdown(pool->sessions[i]->cmd.sd, SHUT_RDWR);
+        }
+    }
+
+  pthread_cond_broadcast(&pool->cond);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (i = 0; i < pool->nstarted; i++)
+    {
+      pthread_join(pool->threads[i], NULL);
+    }
+
+  /* Refuse connections that were still waiting for a worker */
+
+  while (pool->qdepth > 0)
+    {
+      close(pool->queue[pool->head].sd);
+      pool->head = (pool->head + 1) % CONFIG_FTPD_ACCEPTBACKLOG;
+      pool->qdepth--;
+    }
+
+  for (i = 0; i < CONFIG_FTPD_NWORKERS; i++)
+    {
+      if (pool->sessions[i] != NULL)
+        {
+          ftpd_freesession(pool->sessions[i]);
+        }
+    }
+
+  pthread_cond_destroy(&pool->cond);
+  pthread_mutex_destroy(&pool->lock);
+  free(pool);
+  server->pool = NULL;
+}
+
+/****************************************************************************
+ * Name: ftpd_poolstart
+ *
+ * Description:
+ *   Allocate the sessions and their buffers for all workers up front and
+ *   start the worker threads.
+ *
+ ****************************************************************************/
+
+static int ftpd_poolstart(FAR struct ftpd_server_s *server)
+{
+  FAR struct ftpd_pool_s *pool;
+  int ret;
+  int i;
+
+  pool = (FAR struct ftpd_pool_s *)zalloc(sizeof(struct ftpd_pool_s));
+  if (pool == NULL)
+    {
+      nerr("ERROR: Failed to allocate worker pool\n");
+      return -ENOMEM;
+    }
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->cond, NULL);
+  server->pool = pool;
+
+  for (i = 0; i < CONFIG_FTPD_NWORKERS; i++)
+    {
+      pool->sessions[i] = ftpd_allocsession(server);
+      if (pool->sessions[i] == NULL)
+        {
+          ret = -ENOMEM;
+          goto errout_with_pool;
+        }
+
+#if CONFIG_FTPD_STORBUFFERSIZE > 0
+      pool->sessions[i]->storbuffer =
+        (FAR char *)malloc(CONFIG_FTPD_STORBUFFERSIZE);
+      if (pool->sessions[i]->storbuffer == NULL)
+        {
+          ret = -ENOMEM;
+          goto errout_with_pool;
+        }
+#endif
+    }
+
+  for (i = 0; i < CONFIG_FTPD_NWORKERS; i++)
+    {
+      ret = ftpd_startworker(ftpd_poolworker, (FAR void *)pool->sessions[i],
+                             CONFIG_FTPD_WORKERSTACKSIZE,
+                             &pool->threads[i]);
+      if (ret < 0)
+        {
+          nerr("ERROR: ftpd_startworker() failed: %d\n", ret);
+          goto errout_with_pool;
+        }
+
+      pool->nstarted++;
+    }
+
+  return OK;
+
+errout_with_pool:
+  ftpd_poolstop(server);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: ftpd_poolqueue
+ *
+ * Description:
+ *   Hand an accepted control connection to the worker pool, refusing it if
+ *   the backlog queue is full.
+ *
+ ****************************************************************************/
+
+static int ftpd_poolqueue(FAR struct ftpd_server_s *server,
+                          FAR struct ftpd_pending_s *conn)
+{
+  FAR struct ftpd_pool_s *pool = server->pool;
+  uint8_t tail;
+
+  pthread_mutex_lock(&pool->lock);
+  if (pool->qdepth >= CONFIG_FTPD_ACCEPTBACKLOG)
+    {
+      pool->rejected++;
+      pthread_mutex_unlock(&pool->lock);
+
+      nwarn("WARNING: Backlog full, refusing connection\n");
+      ftpd_response(conn->sd, 0, g_respfmt1, 421, ' ',
+                    "Too many connections, try again later");
+      close(conn->sd);
+      return -EBUSY;
+    }
+
+  tail = (pool->head + pool->qdepth) % CONFIG_FTPD_ACCEPTBACKLOG;
+  memcpy(&pool->queue[tail], conn, sizeof(struct ftpd_pending_s));
+
+  pool->qdepth++;
+  if (pool->qdepth > pool->maxqdepth)
+    {
+      pool->maxqdepth = pool->qdepth;
+    }
+
+  pool->accepted++;
+  pthread_cond_signal(&pool->cond);
+  pthread_mutex_unlock(&pool->lock);
+  return OK;
+}
+#endif /* CONFIG_FTPD_WORKERPOOL */
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -4271,6 +4969,14 @@ FTPD_SESSION ftpd_open(int port, sa_family_t family)
 
   server = ftpd_openserver(port, family);
 
+#ifdef CONFIG_FTPD_WORKERPOOL
+  if (server != NULL && ftpd_poolstart(server) < 0)
+    {
+      ftpd_close((FTPD_SESSION)server);
+      server = NULL;
+    }
+#endif
+
   return (FTPD_SESSION)server;
 }
 
@@ -4370,68 +5076,48 @@ errout:
 int ftpd_session(FTPD_SESSION handle, int timeout)
 {
   FAR struct ftpd_server_s  *server;
+#ifdef CONFIG_FTPD_WORKERPOOL
+  struct ftpd_pending_s      conn;
+#else
   FAR struct ftpd_session_s *session;
   int ret;
+#endif
 
   DEBUGASSERT(handle);
 
   server = (FAR struct ftpd_server_s *)handle;
 
-  /* Allocate a session */
+#ifdef CONFIG_FTPD_WORKERPOOL
+  /* Accept a connection and queue it for the next free worker */
 
-  session = (FAR struct ftpd_session_s *)
-    zalloc(sizeof(struct ftpd_session_s));
-  if (session == NULL)
+  conn.addrlen = sizeof(conn.addr);
+  conn.sd = ftpd_accept(server->sd, (FAR void *)&conn.addr,
+                        &conn.addrlen, timeout);
+  if (conn.sd < 0)
     {
-      nerr("ERROR: Failed to allocate session\n");
-      ret = -ENOMEM;
-      goto errout;
-    }
-
-  /* Initialize the session */
-
-  session->server       = server;
-  session->head         = server->head;
-  session->loggedin     = false;
-  session->flags        = 0;
-  session->txtimeout    = -1;
-  session->rxtimeout    = -1;
-  session->cmd.sd       = -1;
-  session->cmd.addrlen  = sizeof(session->cmd.addr);
-  session->cmd.buflen   = CONFIG_FTPD_CMDBUFFERSIZE;
-  session->cmd.buffer   = NULL;
-  session->command      = NULL;
-  session->param        = NULL;
-  session->data.sd      = -1;
-  session->data.addrlen = sizeof(session->data.addr);
-  session->data.buflen  = CONFIG_FTPD_DATABUFFERSIZE;
-  session->data.buffer  = NULL;
-  session->restartpos   = 0;
-  session->fd           = -1;
-  session->user         = NULL;
-  session->type         = FTPD_SESSIONTYPE_NONE;
-  session->home         = NULL;
-  session->work         = NULL;
-  session->renamefrom   = NULL;
+      /* Only report interesting,
+       * infrequent errors (not the common timeout)
+       */
 
-  /* Allocate a command buffer */
+#ifdef CONFIG_DEBUG_NET
+      if (conn.sd != -ETIMEDOUT)
+        {
+          nerr("ERROR: ftpd_accept() failed: %d\n", conn.sd);
+        }
+#endif
 
-  session->cmd.buffer = (FAR char *)malloc(session->cmd.buflen);
-  if (session->cmd.buffer == NULL)
-    {
-      nerr("ERROR: Failed to allocate command buffer\n");
-      ret = -ENOMEM;
-      goto errout_with_session;
+      return conn.sd;
     }
 
-  /* Allocate a data buffer */
+  return ftpd_poolqueue(server, &conn);
+#else
+  /* Allocate a session */
 
-  session->data.buffer = (FAR char *)malloc(session->data.buflen);
-  if (session->data.buffer == NULL)
+  session = ftpd_allocsession(server);
+  if (session == NULL)
     {
-      nerr("ERROR: Failed to allocate data buffer\n");
       ret = -ENOMEM;
-      goto errout_with_session;
+      goto errout;
     }
 
   /* Accept a connection */
@@ -4458,7 +5144,7 @@ int ftpd_session(FTPD_SESSION handle, int timeout)
   /* And create a worker thread to service the session */
 
   ret = ftpd_startworker(ftpd_worker, (FAR void *)session,
-                         CONFIG_FTPD_WORKERSTACKSIZE);
+                         CONFIG_FTPD_WORKERSTACKSIZE, NULL);
   if (ret < 0)
     {
       nerr("ERROR: ftpd_startworker() failed: %d\n", ret);
@@ -4473,8 +5159,51 @@ errout_with_session:
   ftpd_freesession(session);
 errout:
   return ret;
+#endif
 }
 
+/****************************************************************************
+ * Name: ftpd_getstats
+ *
+ * Description:
+ *   Return a snapshot of the session worker pool statistics.
+ *
+ * Input Parameters:
+ *   handle - A handle previously returned by ftpd_open
+ *   stats - Location to return the statistics
+ *
+ * Returned Value:
+ *   Zero is returned on success.  A negated errno value is return on
+ *   failure.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_FTPD_WORKERPOOL
+int ftpd_getstats(FTPD_SESSION handle, FAR struct ftpd_stats_s *stats)
+{
+  FAR struct ftpd_server_s *server = (FAR struct ftpd_server_s *)handle;
+  FAR struct ftpd_pool_s *pool;
+
+  if (server == NULL || server->pool == NULL || stats == NULL)
+    {
+      return -EINVAL;
+    }
+
+  pool = server->pool;
+
+  pthread_mutex_lock(&pool->lock);
+  stats->accepted  = pool->accepted;
+  stats->rejected  = pool->rejected;
+  stats->nworkers  = pool->nstarted;
+  stats->busy      = pool->busy;
+  stats->qdepth    = pool->qdepth;
+  stats->maxqdepth = pool->maxqdepth;
+  pthread_mutex_unlock(&pool->lock);
+
+  return OK;
+}
+#endif
+
 /****************************************************************************
  * Name: ftpd_close
  *
@@ -4495,6 +5224,14 @@ void ftpd_close(FTPD_SESSION handle)
   DEBUGASSERT(handle);
 
   server = (struct ftpd_server_s *)handle;
+
+#ifdef CONFIG_FTPD_WORKERPOOL
+  if (server->pool != NULL)
+    {
+      ftpd_poolstop(server);
+    }
+#endif
+
   if (server->head != NULL)
     {
       ftpd_account_free(server->head);
@@ -32,6 +32,10 @@
 
 #include <netinet/in.h>
 
+#ifdef CONFIG_FTPD_WORKERPOOL
+#  include <pthread.h>
+#endif
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -97,6 +101,36 @@ struct ftpd_account_s
   FAR char                  *home;     /* Home directory path */
 };
 
+#ifdef CONFIG_FTPD_WORKERPOOL
+/* An accepted control connection waiting for a free worker */
+
+struct ftpd_pending_s
+{
+  int                        sd;      /* Control socket descriptor */
+  union ftpd_sockaddr_u      addr;    /* Peer address */
+  socklen_t                  addrlen; /* Length of the address */
+};
+
+/* The pool of pre-spawned session workers */
+
+struct ftpd_pool_s
+{
+  pthread_mutex_t            lock;      /* Protects the pool state */
+  pthread_cond_t             cond;      /* Signals new connections or stop */
+  bool                       stop;      /* Workers should terminate */
+  uint8_t                    nstarted;  /* Number of workers started */
+  uint8_t                    head;      /* Index of the oldest entry */
+  uint16_t                   busy;      /* Workers serving a session */
+  uint16_t                   qdepth;    /* Number of queued connections */
+  uint16_t                   maxqdepth; /* High-water mark of qdepth */
+  uint32_t                   accepted;  /* Connections handed to the pool */
+  uint32_t                   rejected;  /* Connections refused */
+  struct ftpd_pending_s      queue[CONFIG_FTPD_ACCEPTBACKLOG];
+  pthread_t                  threads[CONFIG_FTPD_NWORKERS];
+  FAR struct ftpd_session_s *sessions[CONFIG_FTPD_NWORKERS];
+};
+#endif
+
 /* This structures describes an FTP session a list of associated accounts */
 
 struct ftpd_server_s
@@ -105,6 +139,9 @@ struct ftpd_server_s
   union ftpd_sockaddr_u      addr;   /* Listen address */
   FAR struct ftpd_account_s *head;   /* Head of a list of accounts */
   FAR struct ftpd_account_s *tail;   /* Tail of a list of accounts */
+#ifdef CONFIG_FTPD_WORKERPOOL
+  FAR struct ftpd_pool_s    *pool;   /* Session worker pool */
+#endif
 };
 
 struct ftpd_stream_s
@@ -135,6 +172,9 @@ struct ftpd_session_s
 
   struct ftpd_stream_s       data;
   off_t                      restartpos;
+#if CONFIG_FTPD_STORBUFFERSIZE > 0
+  FAR char                  *storbuffer; /* Upload write batch buffer */
+#endif
 
   /* File */
 
@@ -22,13 +22,23 @@
  * Included Files
  ****************************************************************************/
 
+#include <nuttx/config.h>
+
 #include <sys/prctl.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/time.h>
 #include <net/if.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
 #include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
 #include <stdbool.h>
 #include "iperf.h"
 
@@ -50,20 +60,124 @@
 
 #define IPERF_MAX_DELAY              64
 #define IPERF_SOCKET_RX_TIMEOUT      10
+#define IPERF_ACCEPT_POLL_MS         1000
+
+/* UDP datagrams with id 0 introduce a receiving client to the server and
+ * a negative id ends a stream, as in iperf 2.  Both are sent a few times
+ * in case they are lost.
+ */
+
+#define IPERF_UDP_CTRL_REPEAT        3
+
+/* UDP receive histograms.  Bucket 0 of the jitter histogram counts
+ * transit time variations under IPERF_JITTER_HIST_BASE seconds and each
+ * further bucket doubles the bound.  Loss bursts are bucketed as 1, 2,
+ * 3-4, 5-8 and so on lost datagrams.  The last buckets are open ended.
+ */
+
+#define IPERF_HIST_BUCKETS           8
+#define IPERF_JITTER_HIST_BASE       100e-6
+
+/* The traffic thread keeps UDP receive statistics to itself and hands them
+ * to the report thread this often, rather than locking for each datagram.
+ */
+
+#define IPERF_UDP_PUBLISH_SEC        0.1
 
 /****************************************************************************
  * Private Types
  ****************************************************************************/
 
-struct iperf_ctrl_t
+enum iperf_dir_e
 {
-  FAR struct iperf_ctrl_t *flink;
-  struct iperf_cfg_t cfg;
-  bool finish;
+  IPERF_RX = 0,
+  IPERF_TX = 1
+};
+
+/* UDP receive statistics, for one interval or the whole test */
+
+struct iperf_udp_stats_t
+{
+  uint32_t packets;
+  uint32_t lost;
+  uint32_t outoforder;
+  uint32_t jitter_hist[IPERF_HIST_BUCKETS];
+  uint32_t loss_hist[IPERF_HIST_BUCKETS];
+};
+
+/* One direction of one stream.  Its traffic thread counts the bytes moved
+ * and, for UDP reception, gathers the statistics in 'batch' and adds them
+ * to 'udp' under the lock from time to time; the report thread takes them
+ * every interval.
+ */
+
+struct iperf_flow_t
+{
+  FAR struct iperf_ctrl_t *ctrl;
+  FAR struct iperf_stream_t *stream;
+  enum iperf_dir_e dir;
+  bool active;                        /* Part of the test */
+  bool has_thread;                    /* thread must be joined */
+  volatile bool done;                 /* Stop this flow only */
+  pthread_t thread;
   uintmax_t total_len;
+  uintmax_t last_len;                 /* total_len at the last report */
   uint32_t buffer_len;
   FAR uint8_t *buffer;
-  uint32_t sockfd;
+  int32_t last_id;                    /* Last UDP datagram sent */
+
+  /* Only used by the traffic thread */
+
+  bool seen;                          /* A UDP datagram has arrived */
+  int32_t next_id;                    /* UDP datagram expected next */
+  double transit;                     /* Transit time of the last one */
+  double jitter;                      /* RFC 3550 interarrival jitter */
+  double publish;                     /* When to next publish 'batch' */
+  struct iperf_udp_stats_t batch;     /* Not yet published */
+
+  /* Shared with the report thread */
+
+  pthread_mutex_t lock;
+  double udp_jitter;                  /* Last published jitter */
+  struct iperf_udp_stats_t udp;       /* This interval */
+  struct iperf_udp_stats_t udp_total; /* Earlier intervals */
+};
+
+/* One connection (TCP) or peer (UDP), moving data in one or both
+ * directions.
+ */
+
+struct iperf_stream_t
+{
+  int id;
+  int sockfd;
+  struct sockaddr_in peer;
+  struct iperf_flow_t flow[2];        /* Indexed by enum iperf_dir_e */
+};
+
+struct iperf_ctrl_t
+{
+  FAR struct iperf_ctrl_t *flink;
+  struct iperf_cfg_t cfg;
+  volatile bool finish;
+  pthread_mutex_t lock;
+  int sockfd;                         /* Listening or shared UDP socket */
+  int nstreams;                       /* Streams started so far */
+  FAR struct iperf_stream_t *streams;
+  bool report_started;
+  pthread_t report_thread;
+};
+
+/* One line of a report */
+
+struct iperf_row_t
+{
+  int id;                             /* Stream number, -1 for a sum */
+  enum iperf_dir_e dir;
+  uintmax_t bytes;
+  bool udp;                           /* The UDP statistics are valid */
+  double jitter;
+  struct iperf_udp_stats_t stats;
 };
 
 struct iperf_udp_pkt_t
@@ -90,14 +204,18 @@ inline static bool iperf_is_tcp_client(FAR struct iperf_ctrl_t *ctrl);
 inline static bool iperf_is_tcp_server(FAR struct iperf_ctrl_t *ctrl);
 static int iperf_get_socket_error_code(int sockfd);
 static int iperf_show_socket_error_reason(FAR const char *str, int sockfd);
-static void iperf_report_task(FAR void *arg);
+static FAR void *iperf_report_task(FAR void *arg);
 static int iperf_start_report(FAR struct iperf_ctrl_t *ctrl);
+static int iperf_start_stream(FAR struct iperf_ctrl_t *ctrl,
+                              FAR struct iperf_stream_t *stream);
 static int iperf_run_tcp_server(FAR struct iperf_ctrl_t *ctrl);
 static int iperf_run_udp_server(FAR struct iperf_ctrl_t *ctrl);
 static int iperf_run_udp_client(FAR struct iperf_ctrl_t *ctrl);
 static int iperf_run_tcp_client(FAR struct iperf_ctrl_t *ctrl);
-static void iperf_task_traffic(FAR void *arg);
-static uint32_t iperf_get_buffer_len(FAR struct iperf_ctrl_t *ctrl);
+static FAR void *iperf_task_traffic(FAR void *arg);
+static FAR void *iperf_task_udp_server(FAR void *arg);
+static uint32_t iperf_get_buffer_len(FAR struct iperf_ctrl_t *ctrl,
+                                     enum iperf_dir_e dir);
 
 /****************************************************************************
  * Private Functions
@@ -219,362 +337,1302 @@ static double ts_diff(const struct timespec *a, const struct timespec *b)
 }
 
 /****************************************************************************
- * Name: iperf_report_task
+ * Name: iperf_sends / iperf_receives
  *
  * Description:
- *   Start iperf report task
+ *   Which directions this end moves data in.  Normally the client sends;
+ *   -R turns that round and -d does both at once.
  *
  ****************************************************************************/
 
-static void iperf_report_task(FAR void *arg)
+static bool iperf_sends(FAR struct iperf_ctrl_t *ctrl)
 {
-  FAR struct iperf_ctrl_t *ctrl = arg;
-  uint32_t interval = ctrl->cfg.interval;
-  uint32_t time = ctrl->cfg.time;
-  struct timespec now;
-  struct timespec start;
-  uintmax_t now_len;
-  int ret;
+  bool client = (ctrl->cfg.flag & IPERF_FLAG_CLIENT) != 0;
 
-  prctl(PR_SET_NAME, IPERF_REPORT_TASK_NAME);
-
-  now_len = ctrl->total_len;
-  ret = clock_gettime(CLOCK_MONOTONIC, &now);
-  if (ret != 0)
+  if (ctrl->cfg.flag & IPERF_FLAG_BIDIR)
     {
-      fprintf(stderr, "clock_gettime failed\n");
-      exit(EXIT_FAILURE);
+      return true;
     }
 
-  start = now;
-  printf("\n%19s %16s %18s\n", "Interval", "Transfer", "Bandwidth\n");
-  while (!ctrl->finish)
-    {
-      uintmax_t last_len;
-      struct timespec last;
+  return client != ((ctrl->cfg.flag & IPERF_FLAG_REVERSE) != 0);
+}
 
-      sleep(interval);
-      last_len = now_len;
-      last = now;
-      now_len = ctrl->total_len;
-      ret = clock_gettime(CLOCK_MONOTONIC, &now);
-      if (ret != 0)
-        {
-          fprintf(stderr, "clock_gettime failed\n");
-          exit(EXIT_FAILURE);
-        }
+static bool iperf_receives(FAR struct iperf_ctrl_t *ctrl)
+{
+  return (ctrl->cfg.flag & IPERF_FLAG_BIDIR) != 0 || !iperf_sends(ctrl);
+}
 
-      printf("%7.2lf-%7.2lf sec %10ju Bytes %7.2f Mbits/sec\n",
-             ts_diff(&last, &start),
-             ts_diff(&now, &start),
-             now_len -last_len,
-             (double)((now_len - last_len) * 8 / 1000000) /
-             (double)ts_diff(&now, &last)
-             );
-      if (time != 0 && ts_diff(&now, &start) >= time)
-        {
-          break;
-        }
+/****************************************************************************
+ * Name: iperf_hist_log2 / iperf_jitter_bucket
+ *
+ * Description:
+ *   Return the histogram bucket for a loss burst (0 for 1 datagram, then
+ *   one bucket per power of two) or for a transit time variation.
+ *
+ ****************************************************************************/
+
+static int iperf_hist_log2(uint32_t value)
+{
+  int bucket = 0;
+
+  while (value > 1 && bucket < IPERF_HIST_BUCKETS - 1)
+    {
+      value = (value + 1) >> 1;
+      bucket++;
     }
 
-  if (ts_diff(&now, &start) > 0)
+  return bucket;
+}
+
+static int iperf_jitter_bucket(double jitter)
+{
+  uint32_t value = (uint32_t)(jitter / IPERF_JITTER_HIST_BASE);
+  int bucket = 0;
+
+  while (value > 0 && bucket < IPERF_HIST_BUCKETS - 1)
     {
-      printf("%7.2lf-%7.2lf sec %10ju Bytes %7.2f Mbits/sec\n",
-             ts_diff(&start, &start),
-             ts_diff(&now, &start),
-             now_len,
-             (double)(now_len * 8 / 1000000) /
-             (double)ts_diff(&now, &start)
-             );
+      value >>= 1;
+      bucket++;
     }
 
-  ctrl->finish = true;
+  return bucket;
+}
+
+static void iperf_udp_stats_add(FAR struct iperf_udp_stats_t *to,
+                                FAR const struct iperf_udp_stats_t *from)
+{
+  int i;
+
+  to->packets    += from->packets;
+  to->lost       += from->lost;
+  to->outoforder += from->outoforder;
 
-  pthread_exit(NULL);
+  for (i = 0; i < IPERF_HIST_BUCKETS; i++)
+    {
+      to->jitter_hist[i] += from->jitter_hist[i];
+      to->loss_hist[i]   += from->loss_hist[i];
+    }
 }
 
 /****************************************************************************
- * Name: iperf_start_report
+ * Name: iperf_udp_publish
  *
  * Description:
- *   Start iperf report
+ *   Hand the statistics gathered by the traffic thread to the report
+ *   thread.
  *
  ****************************************************************************/
 
-static int iperf_start_report(FAR struct iperf_ctrl_t *ctrl)
+static void iperf_udp_publish(FAR struct iperf_flow_t *flow)
 {
-  struct sched_param param;
-  pthread_attr_t attr;
-  pthread_t thread;
-  int ret;
-
-  pthread_attr_init(&attr);
-  param.sched_priority = IPERF_REPORT_TASK_PRIORITY;
-  pthread_attr_setschedparam(&attr, &param);
-  pthread_attr_setstacksize(&attr, IPERF_REPORT_TASK_STACK);
-
-  ret = pthread_create(&thread, &attr, (FAR void *)iperf_report_task,
-                       ctrl);
-  if (ret != 0)
-    {
-      printf("iperf_thread: pthread_create failed: %d, %s\n",
-             ret, IPERF_REPORT_TASK_NAME);
-      return -1;
-    }
+  pthread_mutex_lock(&flow->lock);
+  iperf_udp_stats_add(&flow->udp, &flow->batch);
+  flow->udp_jitter = flow->jitter;
+  pthread_mutex_unlock(&flow->lock);
 
-  pthread_detach(thread);
-
-  return 0;
+  memset(&flow->batch, 0, sizeof(flow->batch));
 }
 
 /****************************************************************************
- * Name: iperf_run_tcp_server
+ * Name: iperf_udp_account
  *
  * Description:
- *   Start tcp server
+ *   Account for a received UDP datagram: jitter as in RFC 3550 from the
+ *   sender's timestamp, and loss and reordering from the id sequence.
  *
  ****************************************************************************/
 
-static int iperf_run_tcp_server(FAR struct iperf_ctrl_t *ctrl)
+static void iperf_udp_account(FAR struct iperf_flow_t *flow,
+                              FAR const struct iperf_udp_pkt_t *pkt)
 {
-  socklen_t addr_len = sizeof(struct sockaddr);
-  struct sockaddr_in remote_addr;
-  struct sockaddr_in addr;
-  int actual_recv = 0;
-  int want_recv = 0;
-  FAR uint8_t *buffer;
-  int listen_socket;
-  struct timeval t;
-  int sockfd;
-  int opt;
+  struct timespec ts;
+  double transit;
+  double now;
+  double d;
+  int32_t id;
 
-  listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-  if (listen_socket < 0)
-    {
-      iperf_show_socket_error_reason("tcp server create", listen_socket);
-      return -1;
-    }
+  clock_gettime(CLOCK_REALTIME, &ts);
+  now     = ts_sec(&ts);
+  id      = ntohl(pkt->id);
+  transit = now - ((double)ntohl(pkt->sec) +
+                   (double)ntohl(pkt->usec) / 1e6);
 
-  setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-  addr.sin_family = AF_INET;
-  addr.sin_port = htons(ctrl->cfg.sport);
-  addr.sin_addr.s_addr = ctrl->cfg.sip;
-  if (bind(listen_socket, (FAR struct sockaddr *)&addr, sizeof(addr)) != 0)
+  flow->batch.packets++;
+  if (flow->seen)
     {
-      iperf_show_socket_error_reason("tcp server bind", listen_socket);
-      close(listen_socket);
-      return -1;
-    }
+      d = transit - flow->transit;
+      if (d < 0)
+        {
+          d = -d;
+        }
 
-  if (listen(listen_socket, 5) < 0)
+      flow->jitter += (d - flow->jitter) / 16.0;
+      flow->batch.jitter_hist[iperf_jitter_bucket(d)]++;
+    }
+  else
     {
-      iperf_show_socket_error_reason("tcp server listen", listen_socket);
-      close(listen_socket);
-      return -1;
+      flow->seen    = true;
+      flow->next_id = 1;
+      flow->publish = now + IPERF_UDP_PUBLISH_SEC;
     }
 
-  buffer = ctrl->buffer;
-  want_recv = ctrl->buffer_len;
-  while (!ctrl->finish)
-    {
-      /* TODO need to change to non-block mode */
+  flow->transit = transit;
 
-      sockfd = accept(listen_socket, (FAR struct sockaddr *)&remote_addr,
-                      &addr_len);
-      if (sockfd < 0)
+  if (id >= flow->next_id)
+    {
+      if (id > flow->next_id)
         {
-          iperf_show_socket_error_reason("tcp server listen", listen_socket);
-          close(listen_socket);
-          return -1;
+          flow->batch.lost += id - flow->next_id;
+          flow->batch.loss_hist[iperf_hist_log2(id - flow->next_id)]++;
         }
-      else
-        {
-          char inetaddr[INET_ADDRSTRLEN];
-
-          printf("accept: %s,%d\n",
-                 inet_ntoa_r(remote_addr.sin_addr, inetaddr,
-                             sizeof(inetaddr)),
-                 htons(remote_addr.sin_port));
-          iperf_start_report(ctrl);
 
-          t.tv_sec = IPERF_SOCKET_RX_TIMEOUT;
-          t.tv_usec = 0;
-          setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &t, sizeof(t));
-        }
+      flow->next_id = id + 1;
+    }
+  else
+    {
+      /* A late datagram was counted as lost when the gap was seen */
 
-      while (!ctrl->finish)
+      flow->batch.outoforder++;
+      if (flow->batch.lost > 0)
         {
-          actual_recv = recv(sockfd, buffer, want_recv, 0);
-          if (actual_recv == 0)
-            {
-              char inetaddr[INET_ADDRSTRLEN];
-              printf("closed by the peer: %s,%d\n",
-                     inet_ntoa_r(remote_addr.sin_addr, inetaddr,
-                                 sizeof(inetaddr)),
-                     htons(remote_addr.sin_port));
-
-              /* Note: unlike the original iperf, this implementation
-               * exits after finishing a single connection.
-               */
-
-              ctrl->finish = true;
-              break;
-            }
-          else if (actual_recv < 0)
-            {
-              iperf_show_socket_error_reason("tcp server recv",
-                                             listen_socket);
-              ctrl->finish = true;
-              break;
-            }
-          else
-            {
-              ctrl->total_len += actual_recv;
-            }
+          flow->batch.lost--;
         }
-
-      close(sockfd);
     }
 
-  ctrl->finish = true;
-  close(listen_socket);
-
-  return 0;
+  if (now >= flow->publish)
+    {
+      iperf_udp_publish(flow);
+      flow->publish = now + IPERF_UDP_PUBLISH_SEC;
+    }
 }
 
 /****************************************************************************
- * Name: iperf_run_udp_server
+ * Name: iperf_create_thread
  *
  * Description:
- *   Start udp server
+ *   Create a thread, pinned to a CPU unless cpu is negative.
  *
  ****************************************************************************/
 
-static int iperf_run_udp_server(FAR struct iperf_ctrl_t *ctrl)
+static int iperf_create_thread(FAR pthread_t *thread,
+                               pthread_startroutine_t entry, FAR void *arg,
+                               int priority, int stacksize, int cpu)
 {
-  socklen_t addr_len = sizeof(struct sockaddr_in);
-  struct sockaddr_in addr;
-  int actual_recv = 0;
-  struct timeval t;
-  int want_recv = 0;
-  FAR uint8_t *buffer;
-  int sockfd;
-  int opt;
-  bool udp_recv_start = true;
+  struct sched_param param;
+  pthread_attr_t attr;
+  int ret;
 
-  sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-  if (sockfd < 0)
+  pthread_attr_init(&attr);
+  param.sched_priority = priority;
+  pthread_attr_setschedparam(&attr, &param);
+  pthread_attr_setstacksize(&attr, stacksize);
+
+#ifdef CONFIG_SMP
+  if (cpu >= 0)
     {
-      iperf_show_socket_error_reason("udp server create", sockfd);
-      return -1;
+      cpu_set_t cpuset;
+
+      CPU_ZERO(&cpuset);
+      CPU_SET(cpu % CONFIG_SMP_NCPUS, &cpuset);
+      pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
     }
+#endif
 
-  setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+  ret = pthread_create(thread, &attr, entry, arg);
+  pthread_attr_destroy(&attr);
+  return ret;
+}
 
-  addr.sin_family = AF_INET;
-  addr.sin_port = htons(ctrl->cfg.sport);
-  addr.sin_addr.s_addr = ctrl->cfg.sip;
-  if (bind(sockfd, (FAR struct sockaddr *)&addr, sizeof(addr)) != 0)
+static int iperf_stream_cpu(FAR struct iperf_ctrl_t *ctrl,
+                            FAR struct iperf_stream_t *stream)
+{
+  if (ctrl->cfg.affinity == IPERF_NO_AFFINITY)
     {
-      iperf_show_socket_error_reason("udp server bind", sockfd);
       return -1;
     }
 
-  addr.sin_family = AF_INET;
-  addr.sin_port = htons(ctrl->cfg.sport);
-  addr.sin_addr.s_addr = ctrl->cfg.sip;
+  return ctrl->cfg.affinity + stream->id;
+}
 
-  buffer = ctrl->buffer;
-  want_recv = ctrl->buffer_len;
-  printf("want recv=%d\n", want_recv);
+/****************************************************************************
+ * Name: iperf_flow_take
+ *
+ * Description:
+ *   Take what a flow has moved since the last report, or in total.
+ *
+ ****************************************************************************/
 
-  t.tv_sec = IPERF_SOCKET_RX_TIMEOUT;
-  t.tv_usec = 0;
-  setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &t, sizeof(t));
+static void iperf_flow_take(FAR struct iperf_flow_t *flow, bool total,
+                            FAR struct iperf_row_t *row)
+{
+  uintmax_t len = flow->total_len;
 
-  while (!ctrl->finish)
+  memset(row, 0, sizeof(*row));
+  row->id    = flow->stream->id;
+  row->dir   = flow->dir;
+  row->bytes = total ? len : len - flow->last_len;
+  flow->last_len = len;
+
+  row->udp = (flow->ctrl->cfg.flag & IPERF_FLAG_UDP) != 0 &&
+             flow->dir == IPERF_RX;
+  if (row->udp)
     {
-      actual_recv = recvfrom(sockfd, buffer, want_recv, 0,
-                             (FAR struct sockaddr *)&addr, &addr_len);
-      if (actual_recv < 0)
+      pthread_mutex_lock(&flow->lock);
+      row->stats = flow->udp;
+      iperf_udp_stats_add(&flow->udp_total, &flow->udp);
+      memset(&flow->udp, 0, sizeof(flow->udp));
+      if (total)
         {
-          iperf_show_socket_error_reason("udp server recv", sockfd);
+          row->stats = flow->udp_total;
         }
-      else
-        {
-          if (udp_recv_start == true)
-            {
-              iperf_start_report(ctrl);
-              udp_recv_start = false;
-            }
 
-          ctrl->total_len += actual_recv;
-        }
+      row->jitter = flow->udp_jitter;
+      pthread_mutex_unlock(&flow->lock);
     }
-
-  ctrl->finish = true;
-  close(sockfd);
-
-  return 0;
 }
 
 /****************************************************************************
- * Name: iperf_run_udp_client
+ * Name: iperf_print_header
  *
  * Description:
- *   Start udp client
+ *   Print the heading of the report.
  *
  ****************************************************************************/
 
-static int iperf_run_udp_client(FAR struct iperf_ctrl_t *ctrl)
+static void iperf_print_header(FAR struct iperf_ctrl_t *ctrl)
 {
-  FAR struct iperf_udp_pkt_t *udp;
-  struct sockaddr_in addr;
-  int actual_send = 0;
-  bool retry = false;
-  uint32_t delay = 1;
-  int want_send = 0;
-  uint8_t *buffer;
-  int sockfd;
-  int opt;
-  int err;
-  int id;
+  int i;
 
-  sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-  if (sockfd < 0)
+  switch (ctrl->cfg.output)
     {
-      iperf_show_socket_error_reason("udp client create", sockfd);
-      return -1;
+      case IPERF_OUTPUT_CSV:
+        printf("start,end,stream,dir,bytes,bits_per_second,"
+               "jitter_ms,lost,packets,outoforder");
+        if (ctrl->cfg.histogram)
+          {
+            for (i = 0; i < IPERF_HIST_BUCKETS; i++)
+              {
+                printf(",jitter_hist%d", i);
+              }
+
+            for (i = 0; i < IPERF_HIST_BUCKETS; i++)
+              {
+                printf(",loss_hist%d", i);
+              }
+          }
+
+        printf("\n");
+        break;
+
+      case IPERF_OUTPUT_JSON:
+        break;
+
+      default:
+        printf("\n%26s %16s %18s\n", "Interval", "Transfer", "Bandwidth\n");
+        break;
     }
+}
 
-  setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-
-  addr.sin_family = AF_INET;
-  addr.sin_port = htons(ctrl->cfg.dport);
-  addr.sin_addr.s_addr = ctrl->cfg.dip;
+/****************************************************************************
+ * Name: iperf_print_row
+ *
+ * Description:
+ *   Print one line of a report in the selected output format.
+ *
+ ****************************************************************************/
 
-  iperf_start_report(ctrl);
-  buffer = ctrl->buffer;
-  udp = (FAR struct iperf_udp_pkt_t *)buffer;
-  want_send = ctrl->buffer_len;
-  id = 0;
+static void iperf_print_row(FAR struct iperf_ctrl_t *ctrl,
+                            double t0, double t1,
+                            FAR const struct iperf_row_t *row, bool first)
+{
+  FAR const char *dir = row->dir == IPERF_TX ? "tx" : "rx";
+  uint32_t total = row->stats.lost + row->stats.packets;
+  double bps = t1 > t0 ? (double)row->bytes * 8 / (t1 - t0) : 0;
+  char label[8];
+  int i;
 
-  while (!ctrl->finish)
+  switch (ctrl->cfg.output)
+    {
+      case IPERF_OUTPUT_CSV:
+        printf("%.2f,%.2f,%d,%s,%ju,%.0f", t0, t1, row->id, dir,
+               row->bytes, bps);
+        if (row->udp)
+          {
+            printf(",%.3f,%" PRIu32 ",%" PRIu32 ",%" PRIu32,
+                   row->jitter * 1000, row->stats.lost, total,
+                   row->stats.outoforder);
+          }
+        else
+          {
+            printf(",,,,");
+          }
+
+        if (ctrl->cfg.histogram)
+          {
+            for (i = 0; i < IPERF_HIST_BUCKETS; i++)
+              {
+                printf(",%" PRIu32, row->stats.jitter_hist[i]);
+              }
+
+            for (i = 0; i < IPERF_HIST_BUCKETS; i++)
+              {
+                printf(",%" PRIu32, row->stats.loss_hist[i]);
+              }
+          }
+
+        printf("\n");
+        break;
+
+      case IPERF_OUTPUT_JSON:
+        printf("%s{\"id\":%d,\"dir\":\"%s\",\"bytes\":%ju,"
+               "\"bits_per_second\":%.0f",
+               first ? "" : ",", row->id, dir, row->bytes, bps);
+        if (row->udp)
+          {
+            printf(",\"jitter_ms\":%.3f,\"lost\":%" PRIu32
+                   ",\"packets\":%" PRIu32 ",\"outoforder\":%" PRIu32,
+                   row->jitter * 1000, row->stats.lost, total,
+                   row->stats.outoforder);
+            if (ctrl->cfg.histogram)
+              {
+                printf(",\"jitter_hist\":[");
+                for (i = 0; i < IPERF_HIST_BUCKETS; i++)
+                  {
+                    printf("%s%" PRIu32, i ? "," : "",
+                           row->stats.jitter_hist[i]);
+                  }
+
+                printf("],\"loss_hist\":[");
+                for (i = 0; i < IPERF_HIST_BUCKETS; i++)
+                  {
+                    printf("%s%" PRIu32, i ? "," : "",
+                           row->stats.loss_hist[i]);
+                  }
+
+                printf("]");
+              }
+          }
+
+        printf("}");
+        break;
+
+      default:
+        if (row->id < 0)
+          {
+            strcpy(label, "SUM");
+          }
+        else
+          {
+            snprintf(label, sizeof(label), "%3d", row->id);
+          }
+
+        printf("[%s%s%s] %7.2lf-%7.2lf sec %10ju Bytes %7.2f Mbits/sec",
+               label, ctrl->cfg.flag & IPERF_FLAG_BIDIR ? " " : "",
+               ctrl->cfg.flag & IPERF_FLAG_BIDIR ? dir : "",
+               t0, t1, row->bytes, bps / 1e6);
+        if (row->udp)
+          {
+            printf(" %7.3f ms %6" PRIu32 "/%6" PRIu32 " (%.2g%%)",
+                   row->jitter * 1000, row->stats.lost, total,
+                   total ? 100.0 * row->stats.lost / total : 0.0);
+          }
+
+        printf("\n");
+
+        if (row->udp && ctrl->cfg.histogram)
+          {
+            printf("      jitter  <0.1ms");
+            for (i = 1; i < IPERF_HIST_BUCKETS; i++)
+              {
+                printf(" %s%.1fms", i < IPERF_HIST_BUCKETS - 1 ? "<" : ">=",
+                       IPERF_JITTER_HIST_BASE * 1000 *
+                       (1 << (i < IPERF_HIST_BUCKETS - 1 ? i : i - 1)));
+              }
+
+            printf("\n             ");
+            for (i = 0; i < IPERF_HIST_BUCKETS; i++)
+              {
+                printf(" %7" PRIu32, row->stats.jitter_hist[i]);
+              }
+
+            printf("\n      lost in a row:  1, 2, <=4, ... >%d\n             ",
+                   1 << (IPERF_HIST_BUCKETS - 2));
+            for (i = 0; i < IPERF_HIST_BUCKETS; i++)
+              {
+                printf(" %7" PRIu32, row->stats.loss_hist[i]);
+              }
+
+            printf("\n");
+          }
+        break;
+    }
+}
+
+/****************************************************************************
+ * Name: iperf_report
+ *
+ * Description:
+ *   Report every flow for one interval, or in total, followed by a sum for
+ *   each direction.  Returns the bytes moved in both directions.
+ *
+ ****************************************************************************/
+
+static uintmax_t iperf_report(FAR struct iperf_ctrl_t *ctrl, double t0,
+                              double t1, bool total)
+{
+  FAR struct iperf_flow_t *flow;
+  struct iperf_row_t sum[2];
+  struct iperf_row_t row;
+  int nflows[2];
+  int nrows = 0;
+  int nstreams;
+  int dir;
+  int i;
+
+  memset(sum, 0, sizeof(sum));
+  memset(nflows, 0, sizeof(nflows));
+
+  pthread_mutex_lock(&ctrl->lock);
+  nstreams = ctrl->nstreams;
+  pthread_mutex_unlock(&ctrl->lock);
+
+  if (ctrl->cfg.output == IPERF_OUTPUT_JSON)
+    {
+      printf("{\"start\":%.2f,\"end\":%.2f,\"total\":%s,\"streams\":[",
+             t0, t1, total ? "true" : "false");
+    }
+
+  for (i = 0; i < nstreams; i++)
+    {
+      for (dir = IPERF_RX; dir <= IPERF_TX; dir++)
+        {
+          flow = &ctrl->streams[i].flow[dir];
+          if (!flow->active)
+            {
+              continue;
+            }
+
+          iperf_flow_take(flow, total, &row);
+          iperf_print_row(ctrl, t0, t1, &row, nrows++ == 0);
+
+          sum[dir].bytes  += row.bytes;
+          sum[dir].udp     = row.udp;
+          sum[dir].jitter += row.jitter;
+          iperf_udp_stats_add(&sum[dir].stats, &row.stats);
+          nflows[dir]++;
+        }
+    }
+
+  /* A single flow is its own sum in the human readable report */
+
+  if (ctrl->cfg.output != IPERF_OUTPUT_HUMAN || nrows > 1)
+    {
+      for (dir = IPERF_RX; dir <= IPERF_TX; dir++)
+        {
+          if (nflows[dir] > 0)
+            {
+              sum[dir].id      = -1;
+              sum[dir].dir     = dir;
+              sum[dir].jitter /= nflows[dir];
+              iperf_print_row(ctrl, t0, t1, &sum[dir], nrows++ == 0);
+            }
+        }
+    }
+
+  if (ctrl->cfg.output == IPERF_OUTPUT_JSON)
+    {
+      printf("]}\n");
+    }
+
+  return sum[IPERF_RX].bytes + sum[IPERF_TX].bytes;
+}
+
+/****************************************************************************
+ * Name: iperf_report_task
+ *
+ * Description:
+ *   Start iperf report task
+ *
+ ****************************************************************************/
+
+static FAR void *iperf_report_task(FAR void *arg)
+{
+  FAR struct iperf_ctrl_t *ctrl = arg;
+  uint32_t interval = ctrl->cfg.interval;
+  uint32_t time = ctrl->cfg.time;
+  struct timespec now;
+  struct timespec start;
+  int ret;
+
+  prctl(PR_SET_NAME, IPERF_REPORT_TASK_NAME);
+
+  ret = clock_gettime(CLOCK_MONOTONIC, &now);
+  if (ret != 0)
+    {
+      fprintf(stderr, "clock_gettime failed\n");
+      exit(EXIT_FAILURE);
+    }
+
+  start = now;
+  iperf_print_header(ctrl);
+  while (!ctrl->finish)
+    {
+      struct timespec last;
+
+      sleep(interval);
+      last = now;
+      ret = clock_gettime(CLOCK_MONOTONIC, &now);
+      if (ret != 0)
+        {
+          fprintf(stderr, "clock_gettime failed\n");
+          exit(EXIT_FAILURE);
+        }
+
+      iperf_report(ctrl, ts_diff(&last, &start), ts_diff(&now, &start),
+                   false);
+      if (time != 0 && ts_diff(&now, &start) >= time)
+        {
+          break;
+        }
+    }
+
+  if (ts_diff(&now, &start) > 0)
+    {
+      uintmax_t bytes = iperf_report(ctrl, 0, ts_diff(&now, &start), true);
+
+      if (ctrl->cfg.result != NULL)
+        {
+          ctrl->cfg.result->bytes   = bytes;
+          ctrl->cfg.result->seconds = ts_diff(&now, &start);
+        }
+    }
+
+  ctrl->finish = true;
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: iperf_start_report
+ *
+ * Description:
+ *   Start iperf report, once the first stream is under way
+ *
+ ****************************************************************************/
+
+static int iperf_start_report(FAR struct iperf_ctrl_t *ctrl)
+{
+  int ret = 0;
+
+  pthread_mutex_lock(&ctrl->lock);
+  if (!ctrl->report_started)
+    {
+      ret = iperf_create_thread(&ctrl->report_thread, iperf_report_task,
+                                ctrl, IPERF_REPORT_TASK_PRIORITY,
+                                IPERF_REPORT_TASK_STACK, -1);
+      if (ret != 0)
+        {
+          printf("iperf_thread: pthread_create failed: %d, %s\n",
+                 ret, IPERF_REPORT_TASK_NAME);
+          ret = -1;
+        }
+      else
+        {
+          ctrl->report_started = true;
+        }
+    }
+
+  pthread_mutex_unlock(&ctrl->lock);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: iperf_start_stream
+ *
+ * Description:
+ *   Start the traffic threads of a newly connected stream.  The UDP server
+ *   receives for every stream in iperf_task_udp_server().
+ *
+ ****************************************************************************/
+
+static int iperf_start_stream(FAR struct iperf_ctrl_t *ctrl,
+                              FAR struct iperf_stream_t *stream)
+{
+  FAR struct iperf_flow_t *flow;
+  int ret;
+  int dir;
+
+  pthread_mutex_lock(&ctrl->lock);
+  ctrl->nstreams = stream->id + 1;
+  pthread_mutex_unlock(&ctrl->lock);
+
+  for (dir = IPERF_RX; dir <= IPERF_TX; dir++)
+    {
+      flow = &stream->flow[dir];
+      if (dir == IPERF_RX ? !iperf_receives(ctrl) : !iperf_sends(ctrl))
+        {
+          continue;
+        }
+
+      flow->active = true;
+      if (dir == IPERF_RX && iperf_is_udp_server(ctrl))
+        {
+          continue;
+        }
+
+      /* sendfile() needs no buffer, only the length of each call */
+
+      flow->buffer_len = iperf_get_buffer_len(ctrl, dir);
+      if (dir != IPERF_TX || ctrl->cfg.filename == NULL)
+        {
+          flow->buffer = (FAR uint8_t *)calloc(1, flow->buffer_len);
+          if (flow->buffer == NULL)
+            {
+              printf("create buffer: not enough memory\n");
+              flow->done = true;
+              continue;
+            }
+        }
+
+      ret = iperf_create_thread(&flow->thread, iperf_task_traffic, flow,
+                                IPERF_TRAFFIC_TASK_PRIORITY,
+                                IPERF_TRAFFIC_TASK_STACK,
+                                iperf_stream_cpu(ctrl, stream));
+      if (ret != 0)
+        {
+          printf("iperf_task_traffic: create task failed: %d\n", ret);
+          flow->done = true;
+          continue;
+        }
+
+      flow->has_thread = true;
+    }
+
+  return iperf_start_report(ctrl);
+}
+
+/****************************************************************************
+ * Name: iperf_run_tcp_server
+ *
+ * Description:
+ *   Start tcp server, accepting one connection per stream
+ *
+ ****************************************************************************/
+
+static int iperf_run_tcp_server(FAR struct iperf_ctrl_t *ctrl)
+{
+  socklen_t addr_len = sizeof(struct sockaddr);
+  FAR struct iperf_stream_t *stream;
+  struct sockaddr_in remote_addr;
+  struct sockaddr_in addr;
+  struct pollfd fds;
+  int listen_socket;
+  struct timeval t;
+  int sockfd;
+  int opt = 1;
+  int ret;
+
+  listen_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (listen_socket < 0)
+    {
+      iperf_show_socket_error_reason("tcp server create", listen_socket);
+      return -1;
+    }
+
+  ctrl->sockfd = listen_socket;
+  setsockopt(listen_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(ctrl->cfg.sport);
+  addr.sin_addr.s_addr = ctrl->cfg.sip;
+  if (bind(listen_socket, (FAR struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+      iperf_show_socket_error_reason("tcp server bind", listen_socket);
+      return -1;
+    }
+
+  if (listen(listen_socket, 5) < 0)
+    {
+      iperf_show_socket_error_reason("tcp server listen", listen_socket);
+      return -1;
+    }
+
+  while (!ctrl->finish && ctrl->nstreams < ctrl->cfg.nstreams)
+    {
+      /* Poll so that iperf_stop() is noticed while waiting */
+
+      fds.fd = listen_socket;
+      fds.events = POLLIN;
+      fds.revents = 0;
+      ret = poll(&fds, 1, IPERF_ACCEPT_POLL_MS);
+      if (ret <= 0)
+        {
+          continue;
+        }
+
+      addr_len = sizeof(remote_addr);
+      sockfd = accept(listen_socket, (FAR struct sockaddr *)&remote_addr,
+                      &addr_len);
+      if (sockfd < 0)
+        {
+          iperf_show_socket_error_reason("tcp server accept", listen_socket);
+          return ctrl->nstreams > 0 ? 0 : -1;
+        }
+      else
+        {
+          char inetaddr[INET_ADDRSTRLEN];
+
+          printf("accept: %s,%d\n",
+                 inet_ntoa_r(remote_addr.sin_addr, inetaddr,
+                             sizeof(inetaddr)),
+                 htons(remote_addr.sin_port));
+
+          t.tv_sec = IPERF_SOCKET_RX_TIMEOUT;
+          t.tv_usec = 0;
+          setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &t, sizeof(t));
+        }
+
+      /* Note: unlike the original iperf, this implementation exits after
+       * finishing the connections of a single test.
+       */
+
+      stream = &ctrl->streams[ctrl->nstreams];
+      stream->sockfd = sockfd;
+      stream->peer = remote_addr;
+      iperf_start_stream(ctrl, stream);
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: iperf_udp_peer
+ *
+ * Description:
+ *   Find the stream of the UDP client a datagram came from, starting a new
+ *   stream for a new client.  Returns NULL once every stream is in use.
+ *
+ ****************************************************************************/
+
+static FAR struct iperf_stream_t *
+iperf_udp_peer(FAR struct iperf_ctrl_t *ctrl,
+               FAR const struct sockaddr_in *addr)
+{
+  FAR struct iperf_stream_t *stream;
+  char inetaddr[INET_ADDRSTRLEN];
+  int i;
+
+  for (i = 0; i < ctrl->nstreams; i++)
+    {
+      stream = &ctrl->streams[i];
+      if (stream->peer.sin_addr.s_addr == addr->sin_addr.s_addr &&
+          stream->peer.sin_port == addr->sin_port)
+        {
+          return stream;
+        }
+    }
+
+  if (ctrl->nstreams >= ctrl->cfg.nstreams)
+    {
+      return NULL;
+    }
+
+  printf("udp peer: %s,%d\n",
+         inet_ntoa_r(addr->sin_addr, inetaddr, sizeof(inetaddr)),
+         htons(addr->sin_port));
+
+  stream = &ctrl->streams[ctrl->nstreams];
+  stream->sockfd = ctrl->sockfd;
+  stream->peer = *addr;
+  iperf_start_stream(ctrl, stream);
+  return stream;
+}
+
+/****************************************************************************
+ * Name: iperf_task_udp_server
+ *
+ * Description:
+ *   Receive for every stream of the udp server, telling the streams apart
+ *   by the address of the client.
+ *
+ ****************************************************************************/
+
+static FAR void *iperf_task_udp_server(FAR void *arg)
+{
+  FAR struct iperf_flow_t *first = arg;
+  FAR struct iperf_ctrl_t *ctrl = first->ctrl;
+  FAR struct iperf_udp_pkt_t *udp;
+  FAR struct iperf_stream_t *stream;
+  struct sockaddr_in addr;
+  socklen_t addr_len;
+  int actual_recv;
+  int nfinished = 0;
+  int32_t id;
+  int i;
+
+  prctl(PR_SET_NAME, IPERF_TRAFFIC_TASK_NAME);
+
+  udp = (FAR struct iperf_udp_pkt_t *)first->buffer;
+  while (!ctrl->finish)
+    {
+      addr_len = sizeof(addr);
+      actual_recv = recvfrom(ctrl->sockfd, first->buffer, first->buffer_len,
+                             0, (FAR struct sockaddr *)&addr, &addr_len);
+      if (actual_recv < 0)
+        {
+          if (errno != EAGAIN && errno != EINTR)
+            {
+              iperf_show_socket_error_reason("udp server recv",
+                                             ctrl->sockfd);
+            }
+
+          continue;
+        }
+
+      if (actual_recv < sizeof(struct iperf_udp_pkt_t))
+        {
+          continue;
+        }
+
+      stream = iperf_udp_peer(ctrl, &addr);
+      if (stream == NULL)
+        {
+          continue;
+        }
+
+      id = ntohl(udp->id);
+      if (id < 0)
+        {
+          /* The client has finished; stop sending to it too */
+
+          if (!stream->flow[IPERF_RX].done)
+            {
+              stream->flow[IPERF_RX].done = true;
+              stream->flow[IPERF_TX].done = true;
+              if (++nfinished >= ctrl->cfg.nstreams)
+                {
+                  break;
+                }
+            }
+        }
+      else if (id > 0 && stream->flow[IPERF_RX].active)
+        {
+          stream->flow[IPERF_RX].total_len += actual_recv;
+          iperf_udp_account(&stream->flow[IPERF_RX], udp);
+        }
+    }
+
+  for (i = 0; i < ctrl->nstreams; i++)
+    {
+      iperf_udp_publish(&ctrl->streams[i].flow[IPERF_RX]);
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: iperf_run_udp_server
+ *
+ * Description:
+ *   Start udp server
+ *
+ ****************************************************************************/
+
+static int iperf_run_udp_server(FAR struct iperf_ctrl_t *ctrl)
+{
+  FAR struct iperf_flow_t *first = &ctrl->streams[0].flow[IPERF_RX];
+  struct sockaddr_in addr;
+  struct timeval t;
+  int sockfd;
+  int opt = 1;
+  int ret;
+
+  sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (sockfd < 0)
+    {
+      iperf_show_socket_error_reason("udp server create", sockfd);
+      return -1;
+    }
+
+  ctrl->sockfd = sockfd;
+  setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(ctrl->cfg.sport);
+  addr.sin_addr.s_addr = ctrl->cfg.sip;
+  if (bind(sockfd, (FAR struct sockaddr *)&addr, sizeof(addr)) != 0)
+    {
+      iperf_show_socket_error_reason("udp server bind", sockfd);
+      return -1;
+    }
+
+  t.tv_sec = IPERF_SOCKET_RX_TIMEOUT;
+  t.tv_usec = 0;
+  setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &t, sizeof(t));
+
+  /* Every datagram arrives on this one socket, so a single thread
+   * receives them all, using the buffer of the first stream.
+   */
+
+  first->buffer_len = iperf_get_buffer_len(ctrl, IPERF_RX);
+  first->buffer = (FAR uint8_t *)calloc(1, first->buffer_len);
+  if (first->buffer == NULL)
+    {
+      printf("create buffer: not enough memory\n");
+      return -1;
+    }
+
+  printf("want recv=%" PRIu32 "\n", first->buffer_len);
+
+  ret = iperf_create_thread(&first->thread, iperf_task_udp_server, first,
+                            IPERF_TRAFFIC_TASK_PRIORITY,
+                            IPERF_TRAFFIC_TASK_STACK,
+                            iperf_stream_cpu(ctrl, &ctrl->streams[0]));
+  if (ret != 0)
+    {
+      printf("iperf_task_udp_server: create task failed: %d\n", ret);
+      return -1;
+    }
+
+  first->has_thread = true;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: iperf_udp_send_ctrl
+ *
+ * Description:
+ *   Send an iperf 2 control datagram from a udp client: id 0 to introduce
+ *   a receiving client, or a negative id to end the stream.
+ *
+ ****************************************************************************/
+
+static void iperf_udp_send_ctrl(FAR struct iperf_stream_t *stream,
+                                int32_t id)
+{
+  struct iperf_udp_pkt_t pkt;
+  int i;
+
+  memset(&pkt, 0, sizeof(pkt));
+  pkt.id = htonl(id);
+
+  for (i = 0; i < IPERF_UDP_CTRL_REPEAT; i++)
+    {
+      send(stream->sockfd, &pkt, sizeof(pkt), 0);
+    }
+}
+
+/****************************************************************************
+ * Name: iperf_run_udp_client
+ *
+ * Description:
+ *   Start udp client, with one socket per stream
+ *
+ ****************************************************************************/
+
+static int iperf_run_udp_client(FAR struct iperf_ctrl_t *ctrl)
+{
+  FAR struct iperf_stream_t *stream;
+  struct sockaddr_in addr;
+  struct timeval t;
+  int sockfd;
+  int opt = 1;
+  int i;
+
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(ctrl->cfg.dport);
+  addr.sin_addr.s_addr = ctrl->cfg.dip;
+
+  for (i = 0; i < ctrl->cfg.nstreams && !ctrl->finish; i++)
+    {
+      sockfd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+      if (sockfd < 0)
+        {
+          iperf_show_socket_error_reason("udp client create", sockfd);
+          break;
+        }
+
+      setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+      /* Connect, so that only the server's datagrams are received */
+
+      if (connect(sockfd, (FAR struct sockaddr *)&addr, sizeof(addr)) < 0)
+        {
+          iperf_show_socket_error_reason("udp client connect", sockfd);
+          close(sockfd);
+          break;
+        }
+
+      stream = &ctrl->streams[i];
+      stream->sockfd = sockfd;
+      stream->peer = addr;
+
+      if (iperf_receives(ctrl))
+        {
+          t.tv_sec = IPERF_SOCKET_RX_TIMEOUT;
+          t.tv_usec = 0;
+          setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &t, sizeof(t));
+          iperf_udp_send_ctrl(stream, 0);
+        }
+
+      iperf_start_stream(ctrl, stream);
+    }
+
+  return i > 0 ? 0 : -1;
+}
+
+/****************************************************************************
+ * Name: iperf_run_tcp_client
+ *
+ * Description:
+ *   Start tcp client, with one connection per stream
+ *
+ ****************************************************************************/
+
+static int iperf_run_tcp_client(FAR struct iperf_ctrl_t *ctrl)
+{
+  FAR struct iperf_stream_t *stream;
+  struct sockaddr_in remote_addr;
+  struct timeval t;
+  int sockfd;
+  int i;
+
+  memset(&remote_addr, 0, sizeof(remote_addr));
+  remote_addr.sin_family = AF_INET;
+  remote_addr.sin_port = htons(ctrl->cfg.dport);
+  remote_addr.sin_addr.s_addr = ctrl->cfg.dip;
+
+  for (i = 0; i < ctrl->cfg.nstreams && !ctrl->finish; i++)
+    {
+      sockfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+      if (sockfd < 0)
+        {
+          iperf_show_socket_error_reason("tcp client create", sockfd);
+          break;
+        }
+
+      if (connect(sockfd, (FAR struct sockaddr *)&remote_addr,
+                  sizeof(remote_addr)) < 0)
+        {
+          iperf_show_socket_error_reason("tcp client connect", sockfd);
+          close(sockfd);
+          break;
+        }
+
+      if (iperf_receives(ctrl))
+        {
+          t.tv_sec = IPERF_SOCKET_RX_TIMEOUT;
+          t.tv_usec = 0;
+          setsockopt(sockfd, SOL_SOCKET, SO_RCVTIMEO, &t, sizeof(t));
+        }
+
+      stream = &ctrl->streams[i];
+      stream->sockfd = sockfd;
+      stream->peer = remote_addr;
+      iperf_start_stream(ctrl, stream);
+    }
+
+  return i > 0 ? 0 : -1;
+}
+
+/****************************************************************************
+ * Name: iperf_tcp_send / iperf_tcp_recv
+ *
+ * Description:
+ *   Move data over one tcp stream until the test or the stream ends.
+ *
+ ****************************************************************************/
+
+static void iperf_tcp_send(FAR struct iperf_flow_t *flow)
+{
+  FAR struct iperf_ctrl_t *ctrl = flow->ctrl;
+  int sockfd = flow->stream->sockfd;
+  uint32_t nsends = 0;
+  int actual_send;
+  int flags;
+
+  while (!ctrl->finish && !flow->done)
+    {
+      /* With --more n, hold back all but every n'th send for coalescing */
+
+      flags = 0;
+      if (ctrl->cfg.more > 1 && ++nsends % ctrl->cfg.more != 0)
+        {
+          flags = MSG_MORE;
+        }
+
+      actual_send = send(sockfd, flow->buffer, flow->buffer_len, flags);
+      if (actual_send <= 0)
+        {
+          if (errno == EPIPE || errno == ECONNRESET)
+            {
+              printf("stream %d closed by the peer\n", flow->stream->id);
+            }
+          else if (!ctrl->finish)
+            {
+              iperf_show_socket_error_reason("tcp send", sockfd);
+            }
+
+          break;
+        }
+
+      flow->total_len += actual_send;
+    }
+}
+
+/****************************************************************************
+ * Name: iperf_tcp_sendfile
+ *
+ * Description:
+ *   Send cfg.filename over one tcp stream with sendfile(), from the start
+ *   again each time the end is reached, so that no data is copied through
+ *   an application buffer.
+ *
+ ****************************************************************************/
+
+static void iperf_tcp_sendfile(FAR struct iperf_flow_t *flow)
+{
+  FAR struct iperf_ctrl_t *ctrl = flow->ctrl;
+  int sockfd = flow->stream->sockfd;
+  ssize_t actual_send;
+  struct stat sb;
+  off_t offset = 0;
+  size_t want_send;
+  int fd;
+
+  fd = open(ctrl->cfg.filename, O_RDONLY);
+  if (fd < 0)
+    {
+      printf("open %s failed: %d\n", ctrl->cfg.filename, errno);
+      return;
+    }
+
+  if (fstat(fd, &sb) < 0 || sb.st_size == 0)
+    {
+      printf("%s is empty or cannot be stat'ed\n", ctrl->cfg.filename);
+      close(fd);
+      return;
+    }
+
+  while (!ctrl->finish && !flow->done)
+    {
+      want_send = flow->buffer_len;
+      if (want_send > sb.st_size - offset)
+        {
+          want_send = sb.st_size - offset;
+        }
+
+      actual_send = sendfile(sockfd, fd, &offset, want_send);
+      if (actual_send <= 0)
+        {
+          if (errno == EPIPE || errno == ECONNRESET)
+            {
+              printf("stream %d closed by the peer\n", flow->stream->id);
+            }
+          else if (!ctrl->finish)
+            {
+              iperf_show_socket_error_reason("tcp sendfile", sockfd);
+            }
+
+          break;
+        }
+
+      flow->total_len += actual_send;
+      if (offset >= sb.st_size)
+        {
+          offset = 0;
+        }
+    }
+
+  close(fd);
+}
+
+static void iperf_tcp_recv(FAR struct iperf_flow_t *flow)
+{
+  FAR struct iperf_ctrl_t *ctrl = flow->ctrl;
+  int sockfd = flow->stream->sockfd;
+  int actual_recv;
+
+  while (!ctrl->finish && !flow->done)
+    {
+      actual_recv = recv(sockfd, flow->buffer, flow->buffer_len, 0);
+      if (actual_recv == 0)
+        {
+          char inetaddr[INET_ADDRSTRLEN];
+
+          printf("closed by the peer: %s,%d\n",
+                 inet_ntoa_r(flow->stream->peer.sin_addr, inetaddr,
+                             sizeof(inetaddr)),
+                 htons(flow->stream->peer.sin_port));
+          break;
+        }
+      else if (actual_recv < 0)
+        {
+          if (errno == EAGAIN || errno == EINTR)
+            {
+              continue;
+            }
+
+          iperf_show_socket_error_reason("tcp recv", sockfd);
+          break;
+        }
+
+      flow->total_len += actual_recv;
+    }
+}
+
+/****************************************************************************
+ * Name: iperf_udp_send / iperf_udp_recv
+ *
+ * Description:
+ *   Move data over one udp stream until the test or the stream ends.  The
+ *   udp server sends to its client with sendto() on the shared socket;
+ *   clients have connected sockets.
+ *
+ ****************************************************************************/
+
+static void iperf_udp_send(FAR struct iperf_flow_t *flow)
+{
+  FAR struct iperf_ctrl_t *ctrl = flow->ctrl;
+  FAR struct iperf_stream_t *stream = flow->stream;
+  FAR struct iperf_udp_pkt_t *udp;
+  struct timespec now;
+  int actual_send = 0;
+  bool retry = false;
+  uint32_t delay = 1;
+  int want_send;
+  int err;
+  int32_t id = 0;
+
+  udp = (FAR struct iperf_udp_pkt_t *)flow->buffer;
+  want_send = flow->buffer_len;
+
+  while (!ctrl->finish && !flow->done)
     {
       if (false == retry)
         {
           id++;
+          clock_gettime(CLOCK_REALTIME, &now);
           udp->id = htonl(id);
+          udp->sec = htonl(now.tv_sec);
+          udp->usec = htonl(now.tv_nsec / 1000);
           delay = 1;
         }
 
       retry = false;
-      actual_send = sendto(sockfd, buffer, want_send, 0,
-                           (FAR struct sockaddr *)&addr, sizeof(addr));
+      if (iperf_is_udp_server(ctrl))
+        {
+          actual_send = sendto(stream->sockfd, flow->buffer, want_send, 0,
+                               (FAR struct sockaddr *)&stream->peer,
+                               sizeof(stream->peer));
+        }
+      else
+        {
+          actual_send = send(stream->sockfd, flow->buffer, want_send, 0);
+        }
 
       if (actual_send != want_send)
         {
-          err = iperf_get_socket_error_code(sockfd);
+          err = iperf_get_socket_error_code(stream->sockfd);
           if (err == ENOMEM)
             {
               usleep(delay * 10000);
@@ -588,109 +1646,93 @@ static int iperf_run_udp_client(FAR struct iperf_ctrl_t *ctrl)
             }
           else
             {
-              printf("udp client send abort: err=%d\n", err);
+              printf("udp send abort: err=%d\n", err);
               break;
             }
         }
       else
         {
-          ctrl->total_len += actual_send;
+          flow->total_len += actual_send;
         }
     }
 
-  ctrl->finish = true;
-  close(sockfd);
-
-  return 0;
+  flow->last_id = id;
 }
 
-/****************************************************************************
- * Name: iperf_run_tcp_client
- *
- * Description:
- *   Start tcp client
- *
- ****************************************************************************/
-
-static int iperf_run_tcp_client(FAR struct iperf_ctrl_t *ctrl)
+static void iperf_udp_recv(FAR struct iperf_flow_t *flow)
 {
-  struct sockaddr_in remote_addr;
-  FAR uint8_t *buffer;
-  int actual_send = 0;
-  int want_send = 0;
-  int sockfd;
-
-  sockfd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-  if (sockfd < 0)
-    {
-      iperf_show_socket_error_reason("tcp client create", sockfd);
-      return -1;
-    }
-
-  memset(&remote_addr, 0, sizeof(remote_addr));
-  remote_addr.sin_family = AF_INET;
-  remote_addr.sin_port = htons(ctrl->cfg.dport);
-  remote_addr.sin_addr.s_addr = ctrl->cfg.dip;
-  if (connect(sockfd, (FAR struct sockaddr *)&remote_addr,
-              sizeof(remote_addr)) < 0)
-    {
-      iperf_show_socket_error_reason("tcp client connect", sockfd);
-      return -1;
-    }
+  FAR struct iperf_ctrl_t *ctrl = flow->ctrl;
+  FAR struct iperf_udp_pkt_t *udp;
+  int actual_recv;
 
-  iperf_start_report(ctrl);
-  buffer = ctrl->buffer;
-  want_send = ctrl->buffer_len;
+  udp = (FAR struct iperf_udp_pkt_t *)flow->buffer;
 
-  while (!ctrl->finish)
+  while (!ctrl->finish && !flow->done)
     {
-      actual_send = send(sockfd, buffer, want_send, 0);
-      if (actual_send <= 0)
+      actual_recv = recv(flow->stream->sockfd, flow->buffer,
+                         flow->buffer_len, 0);
+      if (actual_recv < 0)
         {
-          iperf_show_socket_error_reason("tcp client send", sockfd);
+          if (errno == EAGAIN || errno == EINTR)
+            {
+              continue;
+            }
+
+          iperf_show_socket_error_reason("udp recv", flow->stream->sockfd);
           break;
         }
-      else
+
+      if (actual_recv >= sizeof(struct iperf_udp_pkt_t) &&
+          ntohl(udp->id) > 0)
         {
-          ctrl->total_len += actual_send;
+          flow->total_len += actual_recv;
+          iperf_udp_account(flow, udp);
         }
     }
 
-  ctrl->finish = true;
-  close(sockfd);
-
-  return 0;
+  iperf_udp_publish(flow);
 }
 
 /****************************************************************************
  * Name: iperf_task_traffic
  *
  * Description:
- *   Select to run tcp or udp.
+ *   Run one flow, selecting tcp or udp and the direction.
  *
  ****************************************************************************/
 
-static void iperf_task_traffic(FAR void *arg)
+static FAR void *iperf_task_traffic(FAR void *arg)
 {
-  FAR struct iperf_ctrl_t *ctrl = arg;
+  FAR struct iperf_flow_t *flow = arg;
+  FAR struct iperf_ctrl_t *ctrl = flow->ctrl;
 
   prctl(PR_SET_NAME, IPERF_TRAFFIC_TASK_NAME);
 
-  if (iperf_is_udp_client(ctrl))
-    {
-      iperf_run_udp_client(ctrl);
-    }
-  else if (iperf_is_udp_server(ctrl))
+  if (ctrl->cfg.flag & IPERF_FLAG_UDP)
     {
-      iperf_run_udp_server(ctrl);
-    }
-  else if (iperf_is_tcp_client(ctrl))
-    {
-      iperf_run_tcp_client(ctrl);
+      if (flow->dir == IPERF_TX)
+        {
+          iperf_udp_send(flow);
+        }
+      else
+        {
+          iperf_udp_recv(flow);
+        }
     }
-  else if (iperf_is_tcp_server(ctrl))
+  else if (ctrl->cfg.flag & IPERF_FLAG_TCP)
     {
-      iperf_run_tcp_server(ctrl);
+      if (flow->dir == IPERF_TX && ctrl->cfg.filename != NULL)
+        {
+          iperf_tcp_sendfile(flow);
+        }
+      else if (flow->dir == IPERF_TX)
+        {
+          iperf_tcp_send(flow);
+        }
+      else
+        {
+          iperf_tcp_recv(flow);
+        }
     }
   else
     {
@@ -699,37 +1741,113 @@ static void iperf_task_traffic(FAR void *arg)
       assert(false);
     }
 
-  if (ctrl->buffer)
+  flow->done = true;
+  return NULL;
+}
+
+static uint32_t iperf_get_buffer_len(FAR struct iperf_ctrl_t *ctrl,
+                                     enum iperf_dir_e dir)
+{
+  /* -l sets the size of every TCP read and write, and of UDP datagrams
+   * sent; UDP always receives into a buffer large enough for any datagram.
+   */
+
+  if (ctrl->cfg.length != 0 &&
+      (dir == IPERF_TX || (ctrl->cfg.flag & IPERF_FLAG_TCP)))
     {
-      free(ctrl->buffer);
-      ctrl->buffer = NULL;
+      return ctrl->cfg.length;
     }
 
-  printf("iperf exit\n");
-
-  pthread_exit(NULL);
+  if (ctrl->cfg.flag & IPERF_FLAG_UDP)
+    {
+      return dir == IPERF_TX ? IPERF_UDP_TX_LEN : IPERF_UDP_RX_LEN;
+    }
+  else
+    {
+      return dir == IPERF_TX ? IPERF_TCP_TX_LEN : IPERF_TCP_RX_LEN;
+    }
 }
 
-static uint32_t iperf_get_buffer_len(FAR struct iperf_ctrl_t *ctrl)
+/****************************************************************************
+ * Name: iperf_wait
+ *
+ * Description:
+ *   Wait for every flow to finish, then for the final report.  Stream 0's
+ *   receiving flow comes first: on a udp server it is the thread that
+ *   starts all of the others.
+ *
+ ****************************************************************************/
+
+static void iperf_wait(FAR struct iperf_ctrl_t *ctrl)
 {
-  if (iperf_is_udp_client(ctrl))
+  FAR struct iperf_flow_t *flow;
+  FAR void *retval;
+  int dir;
+  int i;
+
+  for (i = 0; i < ctrl->cfg.nstreams; i++)
     {
-      return IPERF_UDP_TX_LEN;
+      for (dir = IPERF_RX; dir <= IPERF_TX; dir++)
+        {
+          flow = &ctrl->streams[i].flow[dir];
+          if (flow->has_thread)
+            {
+              pthread_join(flow->thread, &retval);
+            }
+        }
     }
-  else if (iperf_is_udp_server(ctrl))
+
+  ctrl->finish = true;
+
+  if (ctrl->report_started)
     {
-      return IPERF_UDP_RX_LEN;
+      pthread_join(ctrl->report_thread, &retval);
     }
-  else if (iperf_is_tcp_client(ctrl))
+}
+
+/****************************************************************************
+ * Name: iperf_cleanup
+ *
+ * Description:
+ *   Close the sockets and free the streams.
+ *
+ ****************************************************************************/
+
+static void iperf_cleanup(FAR struct iperf_ctrl_t *ctrl)
+{
+  FAR struct iperf_stream_t *stream;
+  int dir;
+  int i;
+
+  for (i = 0; i < ctrl->cfg.nstreams; i++)
     {
-      return IPERF_TCP_TX_LEN;
+      stream = &ctrl->streams[i];
+
+      if (stream->sockfd >= 0 && stream->sockfd != ctrl->sockfd)
+        {
+          if (iperf_is_udp_client(ctrl))
+            {
+              iperf_udp_send_ctrl(stream,
+                                  -(stream->flow[IPERF_TX].last_id + 1));
+            }
+
+          close(stream->sockfd);
+        }
+
+      for (dir = IPERF_RX; dir <= IPERF_TX; dir++)
+        {
+          free(stream->flow[dir].buffer);
+          pthread_mutex_destroy(&stream->flow[dir].lock);
+        }
     }
-  else
+
+  if (ctrl->sockfd >= 0)
     {
-      return IPERF_TCP_RX_LEN;
+      close(ctrl->sockfd);
     }
 
-  return 0;
+  free(ctrl->streams);
+  pthread_mutex_destroy(&ctrl->lock);
 }
 
 /****************************************************************************
@@ -746,12 +1864,11 @@ static uint32_t iperf_get_buffer_len(FAR struct iperf_ctrl_t *ctrl)
 
 int iperf_start(FAR struct iperf_cfg_t *cfg)
 {
+  FAR struct iperf_stream_t *stream;
   struct iperf_ctrl_t ctrl;
-  struct sched_param param;
-  pthread_attr_t attr;
-  pthread_t thread;
-  FAR void *retval;
   int ret;
+  int dir;
+  int i;
 
   if (!cfg)
     {
@@ -760,42 +1877,69 @@ int iperf_start(FAR struct iperf_cfg_t *cfg)
 
   memset(&ctrl, 0, sizeof(ctrl));
   memcpy(&ctrl.cfg, cfg, sizeof(*cfg));
+  if (ctrl.cfg.nstreams == 0)
+    {
+      ctrl.cfg.nstreams = 1;
+    }
+
   ctrl.finish = false;
-  ctrl.buffer_len = iperf_get_buffer_len(&ctrl);
-  ctrl.buffer = (FAR uint8_t *)malloc(ctrl.buffer_len);
-  if (ctrl.buffer == NULL)
+  ctrl.sockfd = -1;
+  ctrl.streams = (FAR struct iperf_stream_t *)
+    calloc(ctrl.cfg.nstreams, sizeof(struct iperf_stream_t));
+  if (ctrl.streams == NULL)
     {
-      printf("create buffer: not enough memory\n");
+      printf("create streams: not enough memory\n");
       return -1;
     }
 
-  memset(ctrl.buffer, 0, ctrl.buffer_len);
-  pthread_attr_init(&attr);
-  param.sched_priority = IPERF_TRAFFIC_TASK_PRIORITY;
-  pthread_attr_setschedparam(&attr, &param);
-  pthread_attr_setstacksize(&attr, IPERF_TRAFFIC_TASK_STACK);
-  ret = pthread_create(&thread, &attr, (FAR void *)iperf_task_traffic,
-                       &ctrl);
-
-  if (ret != 0)
+  pthread_mutex_init(&ctrl.lock, NULL);
+  for (i = 0; i < ctrl.cfg.nstreams; i++)
     {
-      printf("iperf_task_traffic: create task failed: %d\n", ret);
-      free(ctrl.buffer);
-      ctrl.buffer = NULL;
-      return -1;
+      stream = &ctrl.streams[i];
+      stream->id = i;
+      stream->sockfd = -1;
+
+      for (dir = IPERF_RX; dir <= IPERF_TX; dir++)
+        {
+          stream->flow[dir].ctrl = &ctrl;
+          stream->flow[dir].stream = stream;
+          stream->flow[dir].dir = dir;
+          pthread_mutex_init(&stream->flow[dir].lock, NULL);
+        }
     }
 
   pthread_mutex_lock(&g_iperf_ctrl_mutex);
   sq_addlast((FAR sq_entry_t *)&ctrl, &g_iperf_ctrl_list);
   pthread_mutex_unlock(&g_iperf_ctrl_mutex);
 
-  pthread_join(thread, &retval);
+  if (iperf_is_udp_client(&ctrl))
+    {
+      ret = iperf_run_udp_client(&ctrl);
+    }
+  else if (iperf_is_udp_server(&ctrl))
+    {
+      ret = iperf_run_udp_server(&ctrl);
+    }
+  else if (iperf_is_tcp_client(&ctrl))
+    {
+      ret = iperf_run_tcp_client(&ctrl);
+    }
+  else
+    {
+      ret = iperf_run_tcp_server(&ctrl);
+    }
+
+  iperf_wait(&ctrl);
 
   pthread_mutex_lock(&g_iperf_ctrl_mutex);
   sq_rem((FAR sq_entry_t *)&ctrl, &g_iperf_ctrl_list);
   pthread_mutex_unlock(&g_iperf_ctrl_mutex);
 
-  return 0;
+  iperf_cleanup(&ctrl);
+
+  printf("iperf exit\n");
+
+  return ret;
 }
 
 /****************************************************************************
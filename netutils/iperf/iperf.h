@@ -25,6 +25,9 @@
  * Included Files
  ****************************************************************************/
 
+#include <sys/socket.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -48,11 +51,36 @@ extern "C"
 #define IPERF_FLAG_SERVER (1 << 1)
 #define IPERF_FLAG_TCP (1 << 2)
 #define IPERF_FLAG_UDP (1 << 3)
+#define IPERF_FLAG_REVERSE (1 << 4)   /* Server sends, client receives */
+#define IPERF_FLAG_BIDIR (1 << 5)     /* Both directions at once */
+
+#define IPERF_OUTPUT_HUMAN 0
+#define IPERF_OUTPUT_CSV   1
+#define IPERF_OUTPUT_JSON  2          /* One JSON object per line */
+
+#define IPERF_MAX_STREAMS  16
+#define IPERF_NO_AFFINITY  (-1)
+
+/* Without MSG_MORE every TCP send goes out on its own and --more is
+ * ignored.
+ */
+
+#ifndef MSG_MORE
+#  define MSG_MORE         0
+#endif
 
 /****************************************************************************
  * Public Types
  ****************************************************************************/
 
+/* Totals of a test, for callers that run several */
+
+struct iperf_result_t
+{
+  uintmax_t bytes;     /* Moved by all streams, in both directions */
+  double seconds;
+};
+
 struct iperf_cfg_t
 {
   uint32_t flag;
@@ -62,6 +90,14 @@ struct iperf_cfg_t
   uint16_t sport;
   uint32_t interval;
   uint32_t time;
+  uint16_t nstreams;   /* Parallel streams, 0 means 1 */
+  int16_t affinity;    /* CPU for the first stream, or IPERF_NO_AFFINITY */
+  uint8_t output;      /* IPERF_OUTPUT_* */
+  bool histogram;      /* Report UDP jitter and loss histograms */
+  uint32_t length;     /* Bytes per read or write, 0 for the default */
+  uint16_t more;       /* TCP: MSG_MORE on all but every n'th send */
+  FAR const char *filename;         /* TCP: send this file with sendfile() */
+  FAR struct iperf_result_t *result; /* Filled in at the end, or NULL */
 };
 
 /****************************************************************************
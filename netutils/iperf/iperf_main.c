@@ -23,9 +23,12 @@
  ****************************************************************************/
 
 #include <nuttx/config.h>
+#include <sys/socket.h>
 #include <sys/time.h>
 #include <arpa/inet.h>
 #include <net/if.h>
+#include <limits.h>
+#include <unistd.h>
 #include "netutils/netlib.h"
 #include "argtable3.h"
 #include "iperf.h"
@@ -44,6 +47,11 @@
 #define IPERF_DEFAULT_INTERVAL 3
 #define IPERF_DEFAULT_TIME     30
 
+/* A --sweep runs one test per power of two between its limits */
+
+#define IPERF_SWEEP_MAX        32
+#define IPERF_UDP_MIN_LEN      12
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -56,6 +64,16 @@ struct wifi_iperf_t
   FAR struct arg_int *port;
   FAR struct arg_int *interval;
   FAR struct arg_int *time;
+  FAR struct arg_int *parallel;
+  FAR struct arg_int *affinity;
+  FAR struct arg_lit *reverse;
+  FAR struct arg_lit *bidir;
+  FAR struct arg_str *reportstyle;
+  FAR struct arg_lit *histogram;
+  FAR struct arg_int *length;
+  FAR struct arg_str *file;
+  FAR struct arg_int *more;
+  FAR struct arg_str *sweep;
   FAR struct arg_lit *abort;
   FAR struct arg_end *end;
 };
@@ -74,8 +92,10 @@ struct wifi_iperf_t
 
 static void iperf_showusage(FAR const char *progname, int exitcode)
 {
-  printf("USAGE: %s [-sua] [-c <ip>] [-p <port>]\
-         [-i <interval>] [-t <time>]\n", progname);
+  printf("USAGE: %s [-suaRdH] [-c <ip>] [-p <port>]\
+         [-i <interval>] [-t <time>] [-P <n>] [-A <cpu>]\
+         [-y <C|J>] [-l <len>] [-F <file>] [--more=<n>]\
+         [--sweep=<min>:<max>]\n", progname);
   printf("iperf command:\n");
   printf("  -c, --client=<ip>  run in client mode,\
          connecting to <host>\n");
@@ -86,6 +106,19 @@ static void iperf_showusage(FAR const char *progname, int exitcode)
          seconds between periodic bandwidth reports\n");
   printf("  -t, --time=<time>\
          time in seconds to transmit for (default 10 secs)\n");
+  printf("  -P, --parallel=<n>  number of parallel streams (max %d)\n",
+         IPERF_MAX_STREAMS);
+  printf("  -A, --affinity=<cpu>  pin stream n to CPU <cpu> + n\n");
+  printf("  -R, --reverse  the server sends and the client receives\n");
+  printf("  -d, --bidir  send and receive at the same time\n");
+  printf("  -y, --reportstyle=<C|J>  report as CSV or JSON lines\n");
+  printf("  -H, --histogram  report UDP jitter and loss histograms\n");
+  printf("  -l, --len=<len>  bytes per read/write or UDP datagram\n");
+  printf("  -F, --file=<file>  TCP client: send <file> with sendfile()\n");
+  printf("  --more=<n>  TCP client: set MSG_MORE on all but every n'th"
+         " send\n");
+  printf("  --sweep=<min>:<max>  TCP client: one test per power of two"
+         " length\n");
   printf("  -a, --abort  abort running iperf\n");
   printf("\n");
   exit(exitcode);
@@ -97,10 +130,17 @@ static void iperf_showusage(FAR const char *progname, int exitcode)
 
 int main(int argc, FAR char *argv[])
 {
+  struct iperf_result_t results[IPERF_SWEEP_MAX];
   struct wifi_iperf_t iperf_args;
+  FAR char *filename = NULL;
   struct iperf_cfg_t cfg;
   struct in_addr addr;
+  unsigned int sweepmin = 0;
+  unsigned int sweepmax = 0;
+  unsigned int len;
   int nerrors;
+  int nruns;
+  int i;
   char inetaddr[INET_ADDRSTRLEN];
 
   bzero(&addr, sizeof(struct in_addr));
@@ -116,6 +156,26 @@ int main(int argc, FAR char *argv[])
                             "seconds between periodic bandwidth reports");
   iperf_args.time = arg_int0("t", "time", "<time>",
                         "time in seconds to transmit for (default 10 secs)");
+  iperf_args.parallel = arg_int0("P", "parallel", "<n>",
+                                 "number of parallel streams");
+  iperf_args.affinity = arg_int0("A", "affinity", "<cpu>",
+                                 "pin stream n to CPU <cpu> + n");
+  iperf_args.reverse = arg_lit0("R", "reverse",
+                                "the server sends and the client receives");
+  iperf_args.bidir = arg_lit0("d", "bidir",
+                              "send and receive at the same time");
+  iperf_args.reportstyle = arg_str0("y", "reportstyle", "<C|J>",
+                                    "report as CSV or JSON lines");
+  iperf_args.histogram = arg_lit0("H", "histogram",
+                                  "report UDP jitter and loss histograms");
+  iperf_args.length = arg_int0("l", "len", "<len>",
+                               "bytes per read/write or UDP datagram");
+  iperf_args.file = arg_str0("F", "file", "<file>",
+                             "TCP client: send <file> with sendfile()");
+  iperf_args.more = arg_int0(NULL, "more", "<n>",
+                             "TCP client: MSG_MORE on all but every n'th");
+  iperf_args.sweep = arg_str0(NULL, "sweep", "<min>:<max>",
+                              "TCP client: one test per power of two");
   iperf_args.abort = arg_lit0("a", "abort", "abort running iperf");
   iperf_args.end = arg_end(1);
 
@@ -225,21 +285,185 @@ int main(int argc, FAR char *argv[])
         }
     }
 
+  cfg.nstreams = 1;
+  if (iperf_args.parallel->count != 0)
+    {
+      if (iperf_args.parallel->ival[0] < 1 ||
+          iperf_args.parallel->ival[0] > IPERF_MAX_STREAMS)
+        {
+          printf("ERROR: -P must be between 1 and %d\n", IPERF_MAX_STREAMS);
+          iperf_showusage(argv[0], 0);
+        }
+
+      cfg.nstreams = iperf_args.parallel->ival[0];
+    }
+
+  cfg.affinity = IPERF_NO_AFFINITY;
+  if (iperf_args.affinity->count != 0)
+    {
+#ifdef CONFIG_SMP
+      if (iperf_args.affinity->ival[0] < 0 ||
+          iperf_args.affinity->ival[0] >= CONFIG_SMP_NCPUS)
+        {
+          printf("ERROR: -A must be between 0 and %d\n",
+                 CONFIG_SMP_NCPUS - 1);
+          iperf_showusage(argv[0], 0);
+        }
+
+      cfg.affinity = iperf_args.affinity->ival[0];
+#else
+      printf("WARNING: -A ignored, CONFIG_SMP is not enabled\n");
+#endif
+    }
+
+  if (iperf_args.reverse->count != 0 && iperf_args.bidir->count != 0)
+    {
+      printf("ERROR: -R and -d are mutually exclusive\n");
+      iperf_showusage(argv[0], 0);
+    }
+
+  if (iperf_args.reverse->count != 0)
+    {
+      cfg.flag |= IPERF_FLAG_REVERSE;
+    }
+
+  if (iperf_args.bidir->count != 0)
+    {
+      cfg.flag |= IPERF_FLAG_BIDIR;
+    }
+
+  cfg.output = IPERF_OUTPUT_HUMAN;
+  if (iperf_args.reportstyle->count != 0)
+    {
+      switch (iperf_args.reportstyle->sval[0][0])
+        {
+          case 'c':
+          case 'C':
+            cfg.output = IPERF_OUTPUT_CSV;
+            break;
+
+          case 'j':
+          case 'J':
+            cfg.output = IPERF_OUTPUT_JSON;
+            break;
+
+          default:
+            printf("ERROR: unknown report style %s\n",
+                   iperf_args.reportstyle->sval[0]);
+            iperf_showusage(argv[0], 0);
+        }
+    }
+
+  cfg.histogram = iperf_args.histogram->count != 0;
+
+  if (iperf_args.length->count != 0)
+    {
+      if (iperf_args.length->ival[0] <= 0 ||
+          ((cfg.flag & IPERF_FLAG_UDP) &&
+           iperf_args.length->ival[0] < IPERF_UDP_MIN_LEN))
+        {
+          printf("ERROR: invalid length %d\n", iperf_args.length->ival[0]);
+          iperf_showusage(argv[0], 0);
+        }
+
+      cfg.length = iperf_args.length->ival[0];
+    }
+
+  if (iperf_args.file->count != 0 || iperf_args.more->count != 0 ||
+      iperf_args.sweep->count != 0)
+    {
+      if ((cfg.flag & (IPERF_FLAG_CLIENT | IPERF_FLAG_TCP)) !=
+          (IPERF_FLAG_CLIENT | IPERF_FLAG_TCP))
+        {
+          printf("ERROR: -F, --more and --sweep are TCP client options\n");
+          iperf_showusage(argv[0], 0);
+        }
+    }
+
+  if (iperf_args.file->count != 0)
+    {
+      filename = strdup(iperf_args.file->sval[0]);
+      cfg.filename = filename;
+    }
+
+  if (iperf_args.more->count != 0)
+    {
+#if MSG_MORE == 0
+      printf("WARNING: --more ignored, MSG_MORE is not supported\n");
+#else
+      cfg.more = iperf_args.more->ival[0] > 1 ? iperf_args.more->ival[0] : 0;
+#endif
+    }
+
+  if (iperf_args.sweep->count != 0)
+    {
+      if (sscanf(iperf_args.sweep->sval[0], "%u:%u",
+                 &sweepmin, &sweepmax) != 2 ||
+          sweepmin == 0 || sweepmax < sweepmin)
+        {
+          printf("ERROR: --sweep wants <min>:<max>\n");
+          iperf_showusage(argv[0], 0);
+        }
+    }
+
   arg_freetable((FAR void **)&iperf_args,
                 sizeof(iperf_args) / sizeof(FAR void *));
 
   printf("\n mode=%s-%s "
          "sip=%" PRId32 ".%" PRId32 ".%" PRId32 ".%" PRId32 ":%d,"
          "dip=%" PRId32 ".%" PRId32 ".%" PRId32 ".%" PRId32 ":%d, "
-         "interval=%" PRId32 ", time=%" PRId32 "\n",
+         "interval=%" PRId32 ", time=%" PRId32 ", streams=%d%s\n",
          cfg.flag & IPERF_FLAG_TCP ?"tcp":"udp",
          cfg.flag & IPERF_FLAG_SERVER ?"server":"client",
          cfg.sip & 0xff, (cfg.sip >> 8) & 0xff, (cfg.sip >> 16) & 0xff,
          (cfg.sip >> 24) & 0xff, cfg.sport,
          cfg.dip & 0xff, (cfg.dip >> 8) & 0xff, (cfg.dip >> 16) & 0xff,
          (cfg.dip >> 24) & 0xff, cfg.dport,
-         cfg.interval, cfg.time);
-  iperf_start(&cfg);
+         cfg.interval, cfg.time, cfg.nstreams,
+         cfg.flag & IPERF_FLAG_REVERSE ? ", reverse" :
+         cfg.flag & IPERF_FLAG_BIDIR ? ", bidir" : "");
+
+  if (sweepmin == 0)
+    {
+      iperf_start(&cfg);
+      free(filename);
+      return 0;
+    }
+
+  /* Run one test per length, then compare them */
+
+  nruns = 0;
+  for (len = sweepmin; len <= sweepmax && nruns < IPERF_SWEEP_MAX;
+       len <<= 1)
+    {
+      printf("\n--- length %u ---\n", len);
+
+      memset(&results[nruns], 0, sizeof(results[nruns]));
+      cfg.length = len;
+      cfg.result = &results[nruns++];
+      if (iperf_start(&cfg) < 0)
+        {
+          break;
+        }
+
+      /* Give the server time to get ready for the next test */
+
+      sleep(1);
+
+      if (len > UINT_MAX / 2)
+        {
+          break;
+        }
+    }
+
+  printf("\n%10s %14s %12s\n", "Length", "Bytes", "Mbits/sec");
+  for (i = 0, len = sweepmin; i < nruns; i++, len <<= 1)
+    {
+      printf("%10u %14ju %12.2f\n", len, results[i].bytes,
+             results[i].seconds > 0 ?
+             (double)results[i].bytes * 8 / 1e6 / results[i].seconds : 0);
+    }
 
+  free(filename);
   return 0;
 }
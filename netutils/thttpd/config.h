@@ -213,6 +213,40 @@
 #    define CONFIG_THTTPD_IDLE_SEND_LIMIT_SEC 300
 #  endif
 
+/* How many seconds an idle persistent connection is kept open, and how
+ * many requests are served on it before it is closed (0 = no limit).
+ */
+
+#  ifdef CONFIG_THTTPD_KEEPALIVE
+#    ifndef CONFIG_THTTPD_KEEPALIVE_TIMEOUT_SEC
+#      define CONFIG_THTTPD_KEEPALIVE_TIMEOUT_SEC 15
+#    endif
+#    ifndef CONFIG_THTTPD_KEEPALIVE_MAXREQ
+#      define CONFIG_THTTPD_KEEPALIVE_MAXREQ 100
+#    endif
+#  endif
+
+/* Static file cache.  Cached entries are keyed by URL path only, so the
+ * cache cannot be used with per-host document roots or per-directory
+ * authentication.
+ */
+
+#  if defined(CONFIG_THTTPD_VHOST) || defined(CONFIG_THTTPD_AUTH_FILE)
+#    undef CONFIG_THTTPD_CACHE
+#  endif
+
+#  ifdef CONFIG_THTTPD_CACHE
+#    ifndef CONFIG_THTTPD_CACHE_SIZE
+#      define CONFIG_THTTPD_CACHE_SIZE 32768
+#    endif
+#    ifndef CONFIG_THTTPD_CACHE_MAXOBJECT
+#      define CONFIG_THTTPD_CACHE_MAXOBJECT 4096
+#    endif
+#    ifndef CONFIG_THTTPD_CACHE_CHECK_SEC
+#      define CONFIG_THTTPD_CACHE_CHECK_SEC 2
+#    endif
+#  endif
+
 /* Memory debug instrumentation depends on other debug options
  */
 
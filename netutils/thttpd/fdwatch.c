@@ -42,6 +42,8 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
 #include <debug.h>
 #include <poll.h>
 #include <debug.h>
@@ -108,23 +110,59 @@ static void fdwatch_dump(const char *msg, FAR struct fdwatch_s *fw)
 #  define fdwatch_dump(m,f)
 #endif
 
+/* Get the index associated with the fd.  This is a direct lookup in the
+ * fd-to-index table so that the cost does not grow with the number of
+ * watched descriptors.
+ */
+
 static int fdwatch_pollndx(FAR struct fdwatch_s *fw, int fd)
 {
-  int pollndx;
+  if (fd >= 0 && fd < fw->nfdndx && fw->fdndx[fd] >= 0)
+    {
+      fwinfo("pollndx: %d\n", fw->fdndx[fd]);
+      return fw->fdndx[fd];
+    }
 
-  /* Get the index associated with the fd */
+  fwerr("ERROR: No poll index for fd %d\n", fd);
+  return -1;
+}
+
+/* Record the index associated with the fd, growing the fd-to-index table
+ * if the descriptor number is beyond its current end.
+ */
+
+static int fdwatch_setndx(FAR struct fdwatch_s *fw, int fd, int pollndx)
+{
+  int16_t *fdndx;
+  int nfdndx;
+  int i;
 
-  for (pollndx = 0; pollndx < fw->nwatched; pollndx++)
+  if (fd < 0)
     {
-      if (fw->pollfds[pollndx].fd == fd)
+      return -1;
+    }
+
+  if (fd >= fw->nfdndx)
+    {
+      nfdndx = fd + fw->nfds;
+      fdndx  = RENEW(fw->fdndx, int16_t, fw->nfdndx, nfdndx);
+      if (!fdndx)
         {
-          fwinfo("pollndx: %d\n", pollndx);
-          return pollndx;
+          fwerr("ERROR: Failed to grow the fd index table\n");
+          return -1;
         }
+
+      for (i = fw->nfdndx; i < nfdndx; i++)
+        {
+          fdndx[i] = -1;
+        }
+
+      fw->fdndx  = fdndx;
+      fw->nfdndx = nfdndx;
     }
 
-  fwerr("ERROR: No poll index for fd %d\n", fd);
-  return -1;
+  fw->fdndx[fd] = pollndx;
+  return 0;
 }
 
 /****************************************************************************
@@ -136,6 +174,7 @@ static int fdwatch_pollndx(FAR struct fdwatch_s *fw, int fd)
 struct fdwatch_s *fdwatch_initialize(int nfds)
 {
   FAR struct fdwatch_s *fw;
+  int i;
 
   /* Allocate the fdwatch data structure */
 
@@ -149,6 +188,9 @@ struct fdwatch_s *fdwatch_initialize(int nfds)
   /* Initialize the fdwatch data structures. */
 
   fw->nfds = nfds;
+#ifdef CONFIG_THTTPD_FDWATCH_EPOLL
+  fw->epfd = -1;
+#endif
 
   fw->client = (void **)httpd_malloc(sizeof(void *) * nfds);
   if (!fw->client)
@@ -162,12 +204,44 @@ struct fdwatch_s *fdwatch_initialize(int nfds)
       goto errout_with_allocations;
     }
 
-  fw->ready = (uint8_t *)httpd_malloc(sizeof(uint8_t) * nfds);
+  fw->ready = (int *)httpd_malloc(sizeof(int) * nfds);
   if (!fw->ready)
     {
       goto errout_with_allocations;
     }
 
+  /* The fd-to-index table starts out covering the first nfds descriptor
+   * numbers and is grown on demand by fdwatch_setndx().
+   */
+
+  fw->fdndx = (int16_t *)httpd_malloc(sizeof(int16_t) * nfds);
+  if (!fw->fdndx)
+    {
+      goto errout_with_allocations;
+    }
+
+  fw->nfdndx = nfds;
+  for (i = 0; i < nfds; i++)
+    {
+      fw->fdndx[i] = -1;
+    }
+
+#ifdef CONFIG_THTTPD_FDWATCH_EPOLL
+  fw->events = (struct epoll_event *)
+    httpd_malloc(sizeof(struct epoll_event) * nfds);
+  if (!fw->events)
+    {
+      goto errout_with_allocations;
+    }
+
+  fw->epfd = epoll_create(nfds);
+  if (fw->epfd < 0)
+    {
+      fwerr("ERROR: epoll_create failed: %d\n", errno);
+      goto errout_with_allocations;
+    }
+#endif
+
   fdwatch_dump("Initial state:", fw);
   return fw;
 
@@ -198,6 +272,23 @@ void fdwatch_uninitialize(struct fdwatch_s *fw)
           httpd_free(fw->ready);
         }
 
+      if (fw->fdndx)
+        {
+          httpd_free(fw->fdndx);
+        }
+
+#ifdef CONFIG_THTTPD_FDWATCH_EPOLL
+      if (fw->events)
+        {
+          httpd_free(fw->events);
+        }
+
+      if (fw->epfd >= 0)
+        {
+          close(fw->epfd);
+        }
+#endif
+
       httpd_free(fw);
     }
 }
@@ -206,6 +297,10 @@ void fdwatch_uninitialize(struct fdwatch_s *fw)
 
 void fdwatch_add_fd(struct fdwatch_s *fw, int fd, void *client_data)
 {
+#ifdef CONFIG_THTTPD_FDWATCH_EPOLL
+  struct epoll_event ev;
+#endif
+
   fwinfo("fd: %d client_data: %p\n", fd, client_data);
   fdwatch_dump("Before adding:", fw);
 
@@ -215,11 +310,28 @@ void fdwatch_add_fd(struct fdwatch_s *fw, int fd, void *client_data)
       return;
     }
 
+  if (fdwatch_setndx(fw, fd, fw->nwatched) < 0)
+    {
+      return;
+    }
+
+#ifdef CONFIG_THTTPD_FDWATCH_EPOLL
+  ev.events  = EPOLLIN;
+  ev.data.fd = fd;
+  if (epoll_ctl(fw->epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+      fwerr("ERROR: epoll_ctl(ADD) failed: %d\n", errno);
+      fw->fdndx[fd] = -1;
+      return;
+    }
+#endif
+
   /* Save the new fd at the end of the list */
 
-  fw->pollfds[fw->nwatched].fd     = fd;
-  fw->pollfds[fw->nwatched].events = POLLIN;
-  fw->client[fw->nwatched]         = client_data;
+  fw->pollfds[fw->nwatched].fd      = fd;
+  fw->pollfds[fw->nwatched].events  = POLLIN;
+  fw->pollfds[fw->nwatched].revents = 0;
+  fw->client[fw->nwatched]          = client_data;
 
   /* Increment the count of watched descriptors */
 
@@ -241,9 +353,14 @@ void fdwatch_del_fd(struct fdwatch_s *fw, int fd)
   pollndx = fdwatch_pollndx(fw, fd);
   if (pollndx >= 0)
     {
+#ifdef CONFIG_THTTPD_FDWATCH_EPOLL
+      epoll_ctl(fw->epfd, EPOLL_CTL_DEL, fd, NULL);
+#endif
+
       /* Decrement the number of fds in the poll table */
 
       fw->nwatched--;
+      fw->fdndx[fd] = -1;
 
       /* Replace the deleted one with the one at the end
        * of the list.
@@ -253,6 +370,7 @@ void fdwatch_del_fd(struct fdwatch_s *fw, int fd)
         {
           fw->pollfds[pollndx] = fw->pollfds[fw->nwatched];
           fw->client[pollndx]  = fw->client[fw->nwatched];
+          fw->fdndx[fw->pollfds[pollndx].fd] = pollndx;
         }
     }
 
@@ -264,6 +382,55 @@ void fdwatch_del_fd(struct fdwatch_s *fw, int fd)
  * wait indefinitely.
  */
 
+#ifdef CONFIG_THTTPD_FDWATCH_EPOLL
+int fdwatch(struct fdwatch_s *fw, long timeout_msecs)
+{
+  int pollndx;
+  int ret;
+  int i;
+
+  /* Clear the events reported by the previous wait.  Only the descriptors
+   * that were ready need to be visited.
+   */
+
+  for (i = 0; i < fw->nactive; i++)
+    {
+      pollndx = fdwatch_pollndx(fw, fw->ready[i]);
+      if (pollndx >= 0)
+        {
+          fw->pollfds[pollndx].revents = 0;
+        }
+    }
+
+  /* Wait for activity.  epoll_wait() only returns the descriptors that have
+   * activity so there is no need to scan the whole watch list.
+   */
+
+  fdwatch_dump("Before waiting:", fw);
+  fwinfo("Waiting... (timeout %ld)\n", timeout_msecs);
+  fw->nactive = 0;
+  fw->next    = 0;
+  ret         = epoll_wait(fw->epfd, fw->events, fw->nfds,
+                           (int)timeout_msecs);
+  fwinfo("Awakened: %d\n", ret);
+
+  for (i = 0; i < ret; i++)
+    {
+      pollndx = fdwatch_pollndx(fw, fw->events[i].data.fd);
+      if (pollndx >= 0)
+        {
+          fw->pollfds[pollndx].revents = (pollevent_t)fw->events[i].events;
+          fw->ready[fw->nactive++]     = fw->events[i].data.fd;
+        }
+    }
+
+  /* Return the number of descriptors with activity */
+
+  fwinfo("nactive: %d\n", fw->nactive);
+  fdwatch_dump("After wakeup:", fw);
+  return ret;
+}
+#else
 int fdwatch(struct fdwatch_s *fw, long timeout_msecs)
 {
   int ret;
@@ -316,6 +483,7 @@ int fdwatch(struct fdwatch_s *fw, long timeout_msecs)
   fdwatch_dump("After wakeup:", fw);
   return ret;
 }
+#endif
 
 /* Check if a descriptor was ready. */
 
@@ -338,17 +506,28 @@ int fdwatch_check_fd(struct fdwatch_s *fw, int fd)
   return 0;
 }
 
+/* Return the client data of the descriptors that had activity.  Only the
+ * short list of ready descriptors is walked; descriptors that were removed
+ * from the watch list since the last fdwatch() are skipped.
+ */
+
 void *fdwatch_get_next_client_data(struct fdwatch_s *fw)
 {
+  int pollndx;
+
   fdwatch_dump("Before getting client data:", fw);
-  if (fw->next >= fw->nwatched)
+  while (fw->next < fw->nactive)
     {
-      fwinfo("All client data returned: %d\n", fw->next);
-      return (void *)(uintptr_t)-1;
+      pollndx = fdwatch_pollndx(fw, fw->ready[fw->next++]);
+      if (pollndx >= 0)
+        {
+          fwinfo("client_data[%d]: %p\n", pollndx, fw->client[pollndx]);
+          return fw->client[pollndx];
+        }
     }
 
-  fwinfo("client_data[%d]: %p\n", fw->next, fw->client[fw->next]);
-  return fw->client[fw->next++];
+  fwinfo("All client data returned: %d\n", fw->next);
+  return (void *)(uintptr_t)-1;
 }
 
 #endif /* CONFIG_THTTPD */
@@ -42,6 +42,11 @@
 
 #include <nuttx/config.h>
 #include <stdint.h>
+#include <poll.h>
+
+#ifdef CONFIG_THTTPD_FDWATCH_EPOLL
+#  include <sys/epoll.h>
+#endif
 
 /****************************************************************************
  * Pre-Processor Definitions
@@ -63,11 +68,17 @@ struct fdwatch_s
 {
   struct pollfd *pollfds;          /* Poll data (allocated) */
   void         **client;           /* Client data (allocated) */
-  uint8_t       *ready;            /* The list of fds with activity (allocated) */
-  uint8_t        nfds;             /* The configured maximum number of fds */
-  uint8_t        nwatched;         /* The number of fds currently watched */
-  uint8_t        nactive;          /* The number of fds with activity */
-  uint8_t        next;             /* The index to the next client data */
+  int           *ready;            /* The list of fds with activity (allocated) */
+  int16_t       *fdndx;            /* Maps fd to pollfds index, -1 if unwatched (allocated) */
+#ifdef CONFIG_THTTPD_FDWATCH_EPOLL
+  struct epoll_event *events;      /* epoll_wait() results (allocated) */
+  int            epfd;             /* The epoll instance */
+#endif
+  int            nfdndx;           /* The number of entries in fdndx */
+  uint16_t       nfds;             /* The configured maximum number of fds */
+  uint16_t       nwatched;         /* The number of fds currently watched */
+  uint16_t       nactive;          /* The number of fds with activity */
+  uint16_t       next;             /* The index to the next ready fd */
 };
 
 /****************************************************************************
@@ -101,8 +112,8 @@ extern int fdwatch(struct fdwatch_s *fw, long timeout_msecs);
 
 extern int fdwatch_check_fd(struct fdwatch_s *fw, int fd);
 
-/* Get the client data for the next returned event.  Returns -1 when there
- * are no more events.
+/* Get the client data for the next descriptor that was ready.  Returns -1
+ * when there are no more events.
  */
 
 extern void *fdwatch_get_next_client_data(struct fdwatch_s *fw);
@@ -67,6 +67,7 @@
 #include "timers.h"
 #include "libhttpd.h"
 #include "thttpd_alloc.h"
+#include "thttpd_cache.h"
 #include "thttpd_strings.h"
 #include "thttpd_cgi.h"
 #include "tdate_parse.h"
@@ -132,6 +133,7 @@ static void send_authenticate(httpd_conn *hc, char *realm);
 static int  b64_decode(const char *str, unsigned char *space, int size);
 static int  auth_check(httpd_conn *hc, char *dirname);
 static int  auth_check2(httpd_conn *hc, char *dirname);
+static int  auth_file_check(httpd_conn *hc);
 #endif
 static void send_dirredirect(httpd_conn *hc);
 #ifdef CONFIG_THTTPD_TILDE_MAP1
@@ -144,10 +146,19 @@ static int httpd_tilde_map2(httpd_conn *hc);
 static int  vhost_map(httpd_conn *hc);
 #endif
 static char *expand_filename(char *path, char **restp, bool tildemapped);
+static void init_request(httpd_conn *hc);
 static char *bufgets(httpd_conn *hc);
 static void de_dotdot(char *file);
 static void init_mime(void);
 static void figure_mime(httpd_conn *hc);
+#ifdef CONFIG_THTTPD_GZIP
+static bool accepts_gzip(httpd_conn *hc);
+static void gzip_sibling(httpd_conn *hc);
+#else
+#  define accepts_gzip(hc) (false)
+#endif
+static bool not_modified(httpd_conn *hc);
+static int  send_file(httpd_conn *hc);
 #ifdef CONFIG_THTTPD_GENERATE_INDICES
 static void ls_child(int argc, char **argv);
 static int  ls(httpd_conn *hc);
@@ -360,7 +371,34 @@ static void send_mime(httpd_conn *hc, int status, const char *title,
       snprintf(buf, sizeof(buf), "Last-Modified: %s\r\n", tmbuf);
       add_response(hc, buf);
       add_response(hc, "Accept-Ranges: bytes\r\n");
-      add_response(hc, "Connection: close\r\n");
+
+#ifdef CONFIG_THTTPD_KEEPALIVE
+      /* The connection can only be reused if the client can tell where
+       * this response ends, and only until the request limit is reached.
+       */
+
+      if (hc->keep_alive && length < 0 && status != 304 &&
+          hc->method != METHOD_HEAD)
+        {
+          hc->keep_alive = false;
+        }
+
+#  if CONFIG_THTTPD_KEEPALIVE_MAXREQ > 0
+      if (hc->nrequests + 1 >= CONFIG_THTTPD_KEEPALIVE_MAXREQ)
+        {
+          hc->keep_alive = false;
+        }
+#  endif
+
+      if (hc->keep_alive)
+        {
+          add_response(hc, "Connection: keep-alive\r\n");
+        }
+      else
+#endif
+        {
+          add_response(hc, "Connection: close\r\n");
+        }
 
       s100 = status / 100;
       if (s100 != 2 && s100 != 3)
@@ -869,6 +907,73 @@ static int auth_check2(httpd_conn *hc, char *dirname)
   send_authenticate(hc, dirname);
   return -1;
 }
+
+/* Check authorization for the directory holding hc->expnfilename and
+ * refuse to serve the authorization file itself.  Returns -1 if the
+ * request was rejected and an error has been sent.
+ */
+
+static int auth_file_check(httpd_conn *hc)
+{
+  static char *dirname;
+  static size_t maxdirname = 0;
+  size_t expnlen;
+  char *cp;
+
+  expnlen = strlen(hc->expnfilename);
+  httpd_realloc_str(&dirname, &maxdirname, expnlen);
+  strcpy(dirname, hc->expnfilename);
+  cp = strrchr(dirname, '/');
+  if (!cp)
+    {
+      strcpy(dirname, httpd_root);
+    }
+  else
+    {
+      *cp = '\0';
+    }
+
+  if (auth_check(hc, dirname) == -1)
+    {
+      return -1;
+    }
+
+  /* Check if the filename is the CONFIG_THTTPD_AUTH_FILE itself -
+   * that's verboten.
+   */
+
+  if (expnlen == sizeof(CONFIG_THTTPD_AUTH_FILE) - 1)
+    {
+      if (strcmp(hc->expnfilename, CONFIG_THTTPD_AUTH_FILE) == 0)
+        {
+          nwarn("WARNING: %s URL \"%s\" tried to retrieve an auth file\n",
+                httpd_ntoa(&hc->client_addr), hc->encodedurl);
+          httpd_send_err(hc, 403, err403title, "",
+                         ERROR_FORM(err403form,
+                                    "The requested URL '%s' is an "
+                                    "authorization file, retrieving it is "
+                                    "not permitted.\n"),
+                         hc->encodedurl);
+          return -1;
+        }
+    }
+  else if (expnlen >= sizeof(CONFIG_THTTPD_AUTH_FILE) &&
+           strcmp(&hc->expnfilename[expnlen - sizeof(CONFIG_THTTPD_AUTH_FILE)
+                  + 1], CONFIG_THTTPD_AUTH_FILE) == 0 &&
+          hc->expnfilename[expnlen - sizeof(CONFIG_THTTPD_AUTH_FILE)] == '/')
+    {
+      nwarn("WARNING: %s URL \"%s\" tried to retrieve an auth file\n",
+            httpd_ntoa(&hc->client_addr), hc->encodedurl);
+      httpd_send_err(hc, 403, err403title, "",
+                     ERROR_FORM(err403form,
+                                "The requested URL '%s' is an authorization "
+                                "file, retrieving it is not permitted.\n"),
+                     hc->encodedurl);
+      return -1;
+    }
+
+  return 0;
+}
 #endif /* CONFIG_THTTPD_AUTH_FILE */
 
 static void send_dirredirect(httpd_conn *hc)
@@ -1574,6 +1679,182 @@ done:
     }
 }
 
+#ifdef CONFIG_THTTPD_GZIP
+/* Look for gzip in an Accept-Encoding list such as "br, gzip;q=0.5".  An
+ * entry with a q-value of zero means that the coding is not acceptable.
+ */
+
+static bool accepts_gzip(httpd_conn *hc)
+{
+  const char *p = hc->accepte;
+  bool match;
+  bool refused;
+  size_t len;
+
+  while (*p != '\0')
+    {
+      p     += strspn(p, " \t,");
+      len    = strcspn(p, " \t;,");
+      match  = (len == 4 && strncasecmp(p, "gzip", 4) == 0) ||
+               (len == 6 && strncasecmp(p, "x-gzip", 6) == 0);
+      p     += len;
+
+      /* Parameters of this entry, up to the next comma */
+
+      refused = false;
+      while (*p != '\0' && *p != ',')
+        {
+          p += strspn(p, " \t;");
+          if ((*p == 'q' || *p == 'Q') && p[1] == '=')
+            {
+              /* "0", "0." or "0.000" and nothing else before the next
+               * separator.
+               */
+
+              p += 2;
+              if (*p == '0')
+                {
+                  p++;
+                  if (*p == '.')
+                    {
+                      p++;
+                      p += strspn(p, "0");
+                    }
+
+                  refused = strchr(" \t;,", *p) != NULL;
+                }
+            }
+
+          p += strcspn(p, ";,");
+        }
+
+      if (match)
+        {
+          return !refused;
+        }
+    }
+
+  return false;
+}
+
+/* If a readable file with the expanded name plus ".gz" exists, serve it
+ * instead.  figure_mime() then takes the type from the original extension
+ * and adds the gzip encoding.
+ */
+
+static void gzip_sibling(httpd_conn *hc)
+{
+  struct stat sb;
+  size_t len;
+
+  len = strlen(hc->expnfilename);
+  httpd_realloc_str(&hc->expnfilename, &hc->maxexpnfilename, len + 3);
+  strcpy(&hc->expnfilename[len], ".gz");
+
+  if (stat(hc->expnfilename, &sb) == 0 && S_ISREG(sb.st_mode) &&
+      (sb.st_mode & S_IROTH) != 0 && (sb.st_mode & S_IXOTH) == 0)
+    {
+      ninfo("Sending %s\n", hc->expnfilename);
+      hc->sb = sb;
+    }
+  else
+    {
+      hc->expnfilename[len] = '\0';
+    }
+}
+#endif
+
+/* Check the request's conditional headers against the file.  A matching
+ * If-None-Match takes precedence over If-Modified-Since.
+ */
+
+static bool not_modified(httpd_conn *hc)
+{
+#ifdef CONFIG_THTTPD_ETAG
+  char etag[40];
+
+  if (hc->if_none_match[0] != '\0')
+    {
+      snprintf(etag, sizeof(etag), "\"%lx-%lx\"",
+               (unsigned long)hc->sb.st_mtime,
+               (unsigned long)hc->sb.st_size);
+      return strcmp(hc->if_none_match, "*") == 0 ||
+             strstr(hc->if_none_match, etag) != NULL;
+    }
+#endif
+
+  return hc->if_modified_since != (time_t)-1 &&
+         hc->if_modified_since >= hc->sb.st_mtime;
+}
+
+/* Send the headers for the resolved static file in hc->expnfilename and
+ * set up hc->file_fd (or the cached body) for the data that follows.
+ */
+
+static int send_file(httpd_conn *hc)
+{
+#if defined(CONFIG_THTTPD_ETAG) || defined(CONFIG_THTTPD_GZIP)
+  char extraheads[80];
+#else
+  const char *extraheads = "";
+#endif
+
+  /* Fill in range_end, if necessary. */
+
+  if (hc->got_range &&
+      (hc->range_end == -1 || hc->range_end >= hc->sb.st_size))
+    {
+      hc->range_end = hc->sb.st_size - 1;
+    }
+
+#if defined(CONFIG_THTTPD_ETAG) || defined(CONFIG_THTTPD_GZIP)
+  extraheads[0] = '\0';
+#  ifdef CONFIG_THTTPD_ETAG
+  snprintf(extraheads, sizeof(extraheads), "ETag: \"%lx-%lx\"\r\n",
+           (unsigned long)hc->sb.st_mtime, (unsigned long)hc->sb.st_size);
+#  endif
+#  ifdef CONFIG_THTTPD_GZIP
+  strcat(extraheads, "Vary: Accept-Encoding\r\n");
+#  endif
+#endif
+
+  if (hc->method == METHOD_HEAD)
+    {
+      send_mime(hc, 200, ok200title, hc->encodings, extraheads, hc->type,
+                hc->sb.st_size, hc->sb.st_mtime);
+    }
+  else if (not_modified(hc))
+    {
+      send_mime(hc, 304, err304title, hc->encodings, extraheads,
+                hc->type, (off_t) - 1, hc->sb.st_mtime);
+    }
+  else
+    {
+#ifdef CONFIG_THTTPD_CACHE
+      if (hc->cached != NULL && hc->cached->body != NULL)
+        {
+          hc->body = hc->cached->body;
+        }
+      else
+#endif
+        {
+          hc->file_fd = open(hc->expnfilename, O_RDONLY);
+          if (hc->file_fd < 0)
+            {
+              INTERNALERROR(hc->expnfilename);
+              httpd_send_err(hc, 500, err500title, "", err500form,
+                             hc->encodedurl);
+              return -1;
+            }
+        }
+
+      send_mime(hc, 200, ok200title, hc->encodings, extraheads, hc->type,
+                hc->sb.st_size, hc->sb.st_mtime);
+    }
+
+  return 0;
+}
+
 /* qsort comparison routine. */
 
 #ifdef CONFIG_THTTPD_GENERATE_INDICES
@@ -1919,6 +2200,7 @@ static int ls(httpd_conn *hc)
 
       hc->bytes_sent = CONFIG_THTTPD_CGI_BYTECOUNT;
       hc->should_linger = false;
+      hc->keep_alive = false;
     }
   else
     {
@@ -2380,6 +2662,23 @@ int httpd_get_conn(httpd_server *hs, int listen_fd, httpd_conn *hc)
   memset(&hc->client_addr, 0, sizeof(hc->client_addr));
   memmove(&hc->client_addr, &sa, sockaddr_len(&sa));
   hc->read_idx          = 0;
+  hc->file_fd           = -1;
+#ifdef CONFIG_THTTPD_KEEPALIVE
+  hc->nrequests         = 0;
+#endif
+
+  init_request(hc);
+
+  ninfo("New connection accepted on %d\n", hc->conn_fd);
+  return GC_OK;
+}
+
+/* Resets the per-request state of a connection.  The connection socket,
+ * client address and the contents of read_buf are left alone.
+ */
+
+static void init_request(httpd_conn *hc)
+{
   hc->checked_idx       = 0;
   hc->checked_state     = CHST_FIRSTWORD;
   hc->method            = METHOD_UNKNOWN;
@@ -2405,6 +2704,13 @@ int httpd_get_conn(httpd_server *hs, int listen_fd, httpd_conn *hc)
   hc->hostdir[0]        = '\0';
   hc->authorization     = "";
   hc->remoteuser[0]     = '\0';
+#ifdef CONFIG_THTTPD_ETAG
+  hc->if_none_match     = "";
+#endif
+#ifdef CONFIG_THTTPD_CACHE
+  hc->cached            = NULL;
+  hc->body              = NULL;
+#endif
   hc->buffer[0]         = '\0';
 #ifdef CONFIG_THTTPD_TILDE_MAP2
   hc->altdir[0]         = '\0';
@@ -2425,10 +2731,6 @@ int httpd_get_conn(httpd_server *hs, int listen_fd, httpd_conn *hc)
   hc->range_end         = -1;
   hc->keep_alive        = false;
   hc->should_linger     = false;
-  hc->file_fd           = -1;
-
-  ninfo("New connection accepted on %d\n", hc->conn_fd);
-  return GC_OK;
 }
 
 /* Checks hc->read_buf to see whether a complete request has been read so
@@ -2700,6 +3002,11 @@ int httpd_parse_request(httpd_conn *hc)
           if (strcasecmp(protocol, "HTTP/1.0") != 0)
             {
               hc->one_one = true;
+#ifdef CONFIG_THTTPD_KEEPALIVE
+              /* HTTP/1.1 connections persist unless "Connection: close" */
+
+              hc->keep_alive = true;
+#endif
             }
         }
     }
@@ -2920,6 +3227,14 @@ int httpd_parse_request(httpd_conn *hc)
                   nerr("ERROR: unparsable time: %s\n", cp);
                 }
             }
+#ifdef CONFIG_THTTPD_ETAG
+          else if (strncasecmp(buf, "If-None-Match:", 14) == 0)
+            {
+              cp = &buf[14];
+              cp += strspn(cp, " \t");
+              hc->if_none_match = cp;
+            }
+#endif
           else if (strncasecmp(buf, "Cookie:", 7) == 0)
             {
               cp = &buf[7];
@@ -2992,6 +3307,12 @@ int httpd_parse_request(httpd_conn *hc)
                 {
                   hc->keep_alive = true;
                 }
+#ifdef CONFIG_THTTPD_KEEPALIVE
+              else if (strcasecmp(cp, "close") == 0)
+                {
+                  hc->keep_alive = false;
+                }
+#endif
             }
 #ifdef LOG_UNKNOWN_HEADERS
           else if (strncasecmp(buf, "Accept-Charset:", 15) == 0 ||
@@ -3045,10 +3366,9 @@ int httpd_parse_request(httpd_conn *hc)
         }
 
       /* If the client wants to do keep-alive, it might also be doing
-       * pipelining.  There's no way for us to tell.  Since we don't
-       * implement keep-alive yet, if we close such a connection there
-       * might be unread pipelined requests waiting.  So, we have to do a
-       * lingering close.
+       * pipelining.  There's no way for us to tell.  If we end up closing
+       * such a connection there might be unread pipelined requests
+       * waiting.  So, we have to do a lingering close.
        */
 
       if (hc->keep_alive)
@@ -3057,6 +3377,17 @@ int httpd_parse_request(httpd_conn *hc)
         }
     }
 
+#ifdef CONFIG_THTTPD_KEEPALIVE
+  /* Only GET and HEAD requests are kept alive.  A request body would have
+   * to be consumed before the next request could be found in read_buf.
+   */
+
+  if (hc->method != METHOD_GET && hc->method != METHOD_HEAD)
+    {
+      hc->keep_alive = false;
+    }
+#endif
+
   /* Ok, the request has been parsed.  Now we resolve stuff that may require
    * the entire request.
    */
@@ -3102,6 +3433,20 @@ int httpd_parse_request(httpd_conn *hc)
     }
 #endif
 
+#ifdef CONFIG_THTTPD_CACHE
+  /* A cached static file needs none of the filename resolution below.
+   * Virtual host mapping has set up hc->hostdir, which is part of the key.
+   */
+
+  if ((hc->method == METHOD_GET || hc->method == METHOD_HEAD) &&
+      !hc->tildemapped && hc->origfilename[0] != '~' &&
+      httpd_cache_lookup(hc, accepts_gzip(hc)))
+    {
+      ninfo("Cache hit: %s\n", hc->expnfilename);
+      return 0;
+    }
+#endif
+
   /* Expand the filename */
 
   cp = expand_filename(hc->expnfilename, &pi, hc->tildemapped);
@@ -3165,6 +3510,45 @@ int httpd_parse_request(httpd_conn *hc)
   return 0;
 }
 
+#ifdef CONFIG_THTTPD_KEEPALIVE
+void httpd_reset_conn(httpd_conn *hc)
+{
+  size_t pipelined;
+
+  if (hc->file_fd >= 0)
+    {
+      close(hc->file_fd);
+      hc->file_fd = -1;
+    }
+
+#ifdef CONFIG_THTTPD_CACHE
+  httpd_cache_release(hc);
+#endif
+
+  /* httpd_parse_request() leaves checked_idx just past the blank line that
+   * ends the request.  Anything after that is the next pipelined request.
+   */
+
+  pipelined = hc->read_idx - hc->checked_idx;
+  if (pipelined > 0)
+    {
+      memmove(hc->read_buf, &hc->read_buf[hc->checked_idx], pipelined);
+    }
+
+  hc->read_idx = pipelined;
+
+  /* Saturate, so that the idle checks still see a served connection with
+   * no request limit configured.
+   */
+
+  if (hc->nrequests < UINT16_MAX)
+    {
+      hc->nrequests++;
+    }
+  init_request(hc);
+}
+#endif
+
 void httpd_close_conn(httpd_conn *hc)
 {
   if (hc->file_fd >= 0)
@@ -3173,6 +3557,10 @@ void httpd_close_conn(httpd_conn *hc)
       hc->file_fd = -1;
     }
 
+#ifdef CONFIG_THTTPD_CACHE
+  httpd_cache_release(hc);
+#endif
+
   if (hc->conn_fd >= 0)
     {
       close(hc->conn_fd);
@@ -3207,10 +3595,6 @@ int httpd_start_request(httpd_conn *hc, struct timeval *nowp)
 {
   static char *indexname;
   static size_t maxindexname = 0;
-#ifdef CONFIG_THTTPD_AUTH_FILE
-  static char *dirname;
-  static size_t maxdirname = 0;
-#endif /* CONFIG_THTTPD_AUTH_FILE */
   size_t expnlen;
   size_t indxlen;
   char *cp;
@@ -3229,6 +3613,29 @@ int httpd_start_request(httpd_conn *hc, struct timeval *nowp)
       return -1;
     }
 
+#ifdef CONFIG_THTTPD_CACHE
+  /* The file was found in the cache and has already been resolved, but
+   * the authorization and referer checks still apply to every request.
+   */
+
+  if (hc->cached != NULL)
+    {
+#  ifdef CONFIG_THTTPD_AUTH_FILE
+      if (auth_file_check(hc) == -1)
+        {
+          return -1;
+        }
+#  endif
+
+      if (!check_referer(hc))
+        {
+          return -1;
+        }
+
+      return send_file(hc);
+    }
+#endif
+
   /* Stat the file. */
 
   if (stat(hc->expnfilename, &hc->sb) < 0)
@@ -3396,56 +3803,10 @@ int httpd_start_request(httpd_conn *hc, struct timeval *nowp)
   /* Check authorization for this directory. */
 
 #ifdef CONFIG_THTTPD_AUTH_FILE
-  httpd_realloc_str(&dirname, &maxdirname, expnlen);
-  strcpy(dirname, hc->expnfilename);
-  cp = strrchr(dirname, '/');
-  if (!cp)
-    {
-      strcpy(dirname, httpd_root);
-    }
-  else
-    {
-      *cp = '\0';
-    }
-
-  if (auth_check(hc, dirname) == -1)
+  if (auth_file_check(hc) == -1)
     {
       return -1;
     }
-
-  /* Check if the filename is the CONFIG_THTTPD_AUTH_FILE itself -
-   * that's verboten.
-   */
-
-  if (expnlen == sizeof(CONFIG_THTTPD_AUTH_FILE) - 1)
-    {
-      if (strcmp(hc->expnfilename, CONFIG_THTTPD_AUTH_FILE) == 0)
-        {
-          nwarn("WARNING: %s URL \"%s\" tried to retrieve an auth file\n",
-                httpd_ntoa(&hc->client_addr), hc->encodedurl);
-          httpd_send_err(hc, 403, err403title, "",
-                         ERROR_FORM(err403form,
-                                    "The requested URL '%s' is an "
-                                    "authorization file, retrieving it is "
-                                    "not permitted.\n"),
-                         hc->encodedurl);
-          return -1;
-        }
-    }
-  else if (expnlen >= sizeof(CONFIG_THTTPD_AUTH_FILE) &&
-           strcmp(&hc->expnfilename[expnlen - sizeof(CONFIG_THTTPD_AUTH_FILE)
-                  + 1], CONFIG_THTTPD_AUTH_FILE) == 0 &&
-          hc->expnfilename[expnlen - sizeof(CONFIG_THTTPD_AUTH_FILE)] == '/')
-    {
-      nwarn("WARNING: %s URL \"%s\" tried to retrieve an auth file\n",
-            httpd_ntoa(&hc->client_addr), hc->encodedurl);
-      httpd_send_err(hc, 403, err403title, "",
-                     ERROR_FORM(err403form,
-                                "The requested URL '%s' is an authorization "
-                                "file, retrieving it is not permitted.\n"),
-                     hc->encodedurl);
-      return -1;
-    }
 #endif /* CONFIG_THTTPD_AUTH_FILE */
 
   /* Referer check. */
@@ -3495,43 +3856,25 @@ int httpd_start_request(httpd_conn *hc, struct timeval *nowp)
       return -1;
     }
 
-  /* Fill in range_end, if necessary. */
+#ifdef CONFIG_THTTPD_GZIP
+  /* Switch to a pre-compressed sibling if the client can take it */
 
-  if (hc->got_range &&
-      (hc->range_end == -1 || hc->range_end >= hc->sb.st_size))
+  if (accepts_gzip(hc))
     {
-      hc->range_end = hc->sb.st_size - 1;
+      gzip_sibling(hc);
     }
+#endif
 
   figure_mime(hc);
 
-  if (hc->method == METHOD_HEAD)
-    {
-      send_mime(hc, 200, ok200title, hc->encodings, "", hc->type,
-                hc->sb.st_size, hc->sb.st_mtime);
-    }
-  else if (hc->if_modified_since != (time_t) - 1 &&
-           hc->if_modified_since >= hc->sb.st_mtime)
-    {
-      send_mime(hc, 304, err304title, hc->encodings, "",
-                hc->type, (off_t) - 1, hc->sb.st_mtime);
-    }
-  else
+#ifdef CONFIG_THTTPD_CACHE
+  if (hc->method == METHOD_GET || hc->method == METHOD_HEAD)
     {
-      hc->file_fd = open(hc->expnfilename, O_RDONLY);
-      if (hc->file_fd < 0)
-        {
-          INTERNALERROR(hc->expnfilename);
-          httpd_send_err(hc, 500, err500title, "", err500form,
-                         hc->encodedurl);
-          return -1;
-        }
-
-      send_mime(hc, 200, ok200title, hc->encodings, "", hc->type,
-                hc->sb.st_size, hc->sb.st_mtime);
+      httpd_cache_insert(hc, accepts_gzip(hc));
     }
+#endif
 
-  return 0;
+  return send_file(hc);
 }
 
 char *httpd_ntoa(httpd_sockaddr *sap)
@@ -178,6 +178,10 @@ typedef struct
   int   listen_fd;
 } httpd_server;
 
+/* A cached static file (see thttpd_cache.h) */
+
+struct httpd_cache_s;
+
 /* A connection. */
 
 typedef struct
@@ -213,6 +217,9 @@ typedef struct
   char *hostdir;
   char *authorization;
   char *remoteuser;
+#ifdef CONFIG_THTTPD_ETAG
+  char *if_none_match;         /* not malloc()ed */
+#endif
   size_t maxdecodedurl;
   size_t maxorigfilename;
   size_t maxexpnfilename;
@@ -242,8 +249,15 @@ typedef struct
   bool tildemapped;            /* this connection got tilde-mapped */
   bool keep_alive;
   bool should_linger;
+#ifdef CONFIG_THTTPD_KEEPALIVE
+  uint16_t nrequests;          /* Requests completed, saturates */
+#endif
   int conn_fd;                 /* Connection to the client */
   int file_fd;                 /* Descriptor for open, outgoing file */
+#ifdef CONFIG_THTTPD_CACHE
+  struct httpd_cache_s *cached; /* Cache entry used by this request */
+  const uint8_t *body;         /* Cached file contents to send, if any */
+#endif
   off_t range_start;           /* File range start from Range= */
   off_t range_end;             /* File range end from Range= */
   struct stat sb;
@@ -320,6 +334,16 @@ extern int httpd_start_request(httpd_conn *hc, struct timeval *nowp);
 
 extern void httpd_write_response(httpd_conn *hc);
 
+#ifdef CONFIG_THTTPD_KEEPALIVE
+/* Prepares a persistent connection for its next request once the current
+ * response has been sent.  The connection socket stays open; any pipelined
+ * request bytes that followed the current request are moved to the start
+ * of hc->read_buf so that httpd_got_request() can check them right away.
+ */
+
+extern void httpd_reset_conn(httpd_conn *hc);
+#endif
+
 /* Call this to close down a connection and free the data. */
 
 extern void httpd_close_conn(httpd_conn *hc);
@@ -124,9 +124,16 @@ static struct fdwatch_s *fw;
 static void shut_down(void);
 static int  handle_newconnect(struct timeval *tv, int listen_fd);
 static void handle_read(struct connect_s *conn, struct timeval *tv);
+static bool handle_request(struct connect_s *conn, struct timeval *tv);
 static void handle_send(struct connect_s *conn, struct timeval *tv);
+#ifdef CONFIG_THTTPD_CACHE
+static void handle_send_body(struct connect_s *conn, struct timeval *tv);
+#endif
 static void handle_linger(struct connect_s *conn, struct timeval *tv);
 static void finish_connection(struct connect_s *conn, struct timeval *tv);
+#ifdef CONFIG_THTTPD_KEEPALIVE
+static void keepalive_connection(struct connect_s *conn, struct timeval *tv);
+#endif
 static void clear_connection(struct connect_s *conn, struct timeval *tv);
 static void really_clear_connection(struct connect_s *conn);
 static void idle(ClientData client_data, struct timeval *nowp);
@@ -260,7 +267,6 @@ static int handle_newconnect(FAR struct timeval *tv, int listen_fd)
 static void handle_read(struct connect_s *conn, struct timeval *tv)
 {
   httpd_conn *hc = conn->hc;
-  off_t actual;
   int sz;
 
   /* Is there room in our buffer to read more bytes? */
@@ -283,6 +289,16 @@ static void handle_read(struct connect_s *conn, struct timeval *tv)
             hc->read_size - hc->read_idx);
   if (sz == 0)
     {
+#ifdef CONFIG_THTTPD_KEEPALIVE
+      /* The client closed an idle persistent connection */
+
+      if (hc->nrequests > 0 && hc->read_idx == 0)
+        {
+          clear_connection(conn, tv);
+          return;
+        }
+#endif
+
       BADREQUEST("EOF");
       goto errout_with_400;
     }
@@ -308,12 +324,47 @@ static void handle_read(struct connect_s *conn, struct timeval *tv)
   hc->read_idx += sz;
   conn->active_at = tv->tv_sec;
 
+  /* Serve the request.  A persistent connection comes back here in
+   * CNST_READING with any pipelined requests already at the start of
+   * read_buf, so keep going until no complete request is left.
+   */
+
+  while (handle_request(conn, tv))
+    {
+      if (conn->conn_state == CNST_SENDING)
+        {
+          handle_send(conn, tv);
+        }
+
+      if (conn->conn_state != CNST_READING || hc->read_idx == 0)
+        {
+          break;
+        }
+    }
+
+  return;
+
+errout_with_400:
+  BADREQUEST("errout");
+  httpd_send_err(hc, 400, httpd_err400title, "", httpd_err400form, "");
+  finish_connection(conn, tv);
+}
+
+/* Parse and start the request in hc->read_buf.  Returns false if no
+ * complete request has been received yet.
+ */
+
+static bool handle_request(struct connect_s *conn, struct timeval *tv)
+{
+  httpd_conn *hc = conn->hc;
+  off_t actual;
+
   /* Do we have a complete request yet? */
 
   switch (httpd_got_request(hc))
     {
     case GR_NO_REQUEST:
-      return;
+      return false;
     case GR_BAD_REQUEST:
      BADREQUEST("httpd_got_request");
      goto errout_with_400;
@@ -358,7 +409,11 @@ static void handle_read(struct connect_s *conn, struct timeval *tv)
 
   /* Check if it's already handled */
 
+#ifdef CONFIG_THTTPD_CACHE
+  if (hc->file_fd < 0 && hc->body == NULL)
+#else
   if (hc->file_fd < 0)
+#endif
     {
       /* No file descriptor means someone else is handling it */
 
@@ -373,22 +428,29 @@ static void handle_read(struct connect_s *conn, struct timeval *tv)
       goto errout_with_connection;
     }
 
-  /* Seek to the offset of the next byte to send */
+  /* Seek to the offset of the next byte to send.  A cached body is sent
+   * straight from memory.
+   */
 
-  actual = lseek(hc->file_fd, conn->offset, SEEK_SET);
-  if (actual != conn->offset)
+#ifdef CONFIG_THTTPD_CACHE
+  if (hc->body == NULL)
+#endif
     {
-       nerr("ERROR: fseek to %jd failed: offset=%jd errno=%d\n",
-            (intmax_t)conn->offset, (intmax_t)actual, errno);
-       BADREQUEST("lseek");
-       goto errout_with_400;
+      actual = lseek(hc->file_fd, conn->offset, SEEK_SET);
+      if (actual != conn->offset)
+        {
+          nerr("ERROR: fseek to %jd failed: offset=%jd errno=%d\n",
+               (intmax_t)conn->offset, (intmax_t)actual, errno);
+          BADREQUEST("lseek");
+          goto errout_with_400;
+        }
     }
 
   /* We have a valid connection and a file to send to it */
 
   conn->conn_state = CNST_SENDING;
   fdwatch_del_fd(fw, hc->conn_fd);
-  return;
+  return true;
 
 errout_with_400:
   BADREQUEST("errout");
@@ -396,6 +458,7 @@ errout_with_400:
 
 errout_with_connection:
   finish_connection(conn, tv);
+  return true;
 }
 
 static inline int read_buffer(struct connect_s *conn)
@@ -429,6 +492,14 @@ static void handle_send(struct connect_s *conn, struct timeval *tv)
   int nwritten;
   int nread;
 
+#ifdef CONFIG_THTTPD_CACHE
+  if (hc->body != NULL)
+    {
+      handle_send_body(conn, tv);
+      return;
+    }
+#endif
+
   /* Read until the entire file is sent -- this could take awhile!! */
 
   while (conn->offset < conn->end_offset)
@@ -491,6 +562,62 @@ errout_clear_connection:
   clear_connection(conn, tv);
 }
 
+#ifdef CONFIG_THTTPD_CACHE
+/* Send a cached file body straight from memory.  As much of it as fits is
+ * appended to the buffered response headers so that a small file goes out
+ * in a single write.
+ */
+
+static void handle_send_body(struct connect_s *conn, struct timeval *tv)
+{
+  httpd_conn *hc = conn->hc;
+  size_t nbytes;
+  int nwritten;
+
+  nbytes = conn->end_offset - conn->offset;
+  if (nbytes > CONFIG_THTTPD_IOBUFFERSIZE - hc->buflen)
+    {
+      nbytes = CONFIG_THTTPD_IOBUFFERSIZE - hc->buflen;
+    }
+
+  memcpy(&hc->buffer[hc->buflen], &hc->body[conn->offset], nbytes);
+  hc->buflen += nbytes;
+
+  nwritten = httpd_write(hc->conn_fd, hc->buffer, hc->buflen);
+  if (nwritten < 0)
+    {
+      goto errout_clear_connection;
+    }
+
+  hc->buflen      = 0;
+  conn->offset   += nbytes;
+  hc->bytes_sent += nbytes;
+
+  /* Then the rest of the body, if any, in one write */
+
+  if (conn->offset < conn->end_offset)
+    {
+      nwritten = httpd_write(hc->conn_fd, &hc->body[conn->offset],
+                             conn->end_offset - conn->offset);
+      if (nwritten < 0)
+        {
+          goto errout_clear_connection;
+        }
+
+      conn->offset   += nwritten;
+      hc->bytes_sent += nwritten;
+    }
+
+  conn->active_at = tv->tv_sec;
+  finish_connection(conn, tv);
+  return;
+
+errout_clear_connection:
+  nerr("ERROR: Error sending %s: %d\n", hc->encodedurl, errno);
+  clear_connection(conn, tv);
+}
+#endif
+
 static void handle_linger(struct connect_s *conn, struct timeval *tv)
 {
   httpd_conn *hc = conn->hc;
@@ -518,11 +645,50 @@ static void finish_connection(struct connect_s *conn, struct timeval *tv)
 
   httpd_write_response(conn->hc);
 
+#ifdef CONFIG_THTTPD_KEEPALIVE
+  /* Keep the connection for the next request if the response allows it */
+
+  if (conn->hc->keep_alive && conn->conn_state != CNST_LINGERING)
+    {
+      keepalive_connection(conn, tv);
+      return;
+    }
+#endif
+
   /* And clear */
 
   clear_connection(conn, tv);
 }
 
+#ifdef CONFIG_THTTPD_KEEPALIVE
+static void keepalive_connection(struct connect_s *conn, struct timeval *tv)
+{
+  if (conn->wakeup_timer != NULL)
+    {
+      tmr_cancel(conn->wakeup_timer);
+      conn->wakeup_timer = NULL;
+    }
+
+  httpd_reset_conn(conn->hc);
+
+  conn->active_at  = tv->tv_sec;
+  conn->offset     = 0;
+  conn->end_offset = 0;
+  conn->eof        = false;
+
+  /* A connection that was sending was removed from the fdwatch set */
+
+  if (conn->conn_state == CNST_SENDING)
+    {
+      conn->conn_state = CNST_READING;
+      fdwatch_add_fd(fw, conn->hc->conn_fd, conn);
+    }
+
+  ninfo("Keep-alive fd %d, %d request(s) served, %d byte(s) pipelined\n",
+        conn->hc->conn_fd, conn->hc->nrequests, (int)conn->hc->read_idx);
+}
+#endif
+
 static void clear_connection(struct connect_s *conn, struct timeval *tv)
 {
   ClientData client_data;
@@ -606,6 +772,25 @@ static void idle(ClientData client_data, struct timeval *nowp)
       switch (conn->conn_state)
         {
         case CNST_READING:
+#ifdef CONFIG_THTTPD_KEEPALIVE
+          /* A persistent connection waiting for its next request is simply
+           * closed when the keep-alive timeout expires.
+           */
+
+          if (conn->hc->nrequests > 0 && conn->hc->read_idx == 0)
+            {
+              if (nowp->tv_sec - conn->active_at >=
+                  CONFIG_THTTPD_KEEPALIVE_TIMEOUT_SEC)
+                {
+                  ninfo("%s keep-alive connection timed out\n",
+                        httpd_ntoa(&conn->hc->client_addr));
+                  clear_connection(conn, nowp);
+                }
+
+              break;
+            }
+#endif
+
           if (nowp->tv_sec - conn->active_at >=
               CONFIG_THTTPD_IDLE_READ_LIMIT_SEC)
             {
@@ -832,27 +1017,14 @@ int thttpd_main(int argc, char **argv)
                     {
                       case CNST_READING:
                         {
-                          handle_read(conn, &tv);
-
                           /* If a GET request was received and a file is
-                           * ready to be sent, then fall through to send
-                           * the file.
+                           * ready to be sent, handle_read() also sends the
+                           * file -- this really should be performed on a
+                           * separate thread to keep the serve from locking
+                           * up during the write.
                            */
 
-                          if (conn->conn_state != CNST_SENDING)
-                            {
-                              break;
-                            }
-                        }
-
-                      case CNST_SENDING:
-                        {
-                          /* Send a file -- this really should be performed
-                           * on a separate thread to keep the serve from
-                           * locking up during the write.
-                           */
-
-                          handle_send(conn, &tv);
+                          handle_read(conn, &tv);
                         }
                         break;
 
@@ -0,0 +1,372 @@
+/****************************************************************************
+ * apps/netutils/thttpd/thttpd_cache.c
+ * LRU cache of resolved static files
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <debug.h>
+
+#include "config.h"
+#include "libhttpd.h"
+#include "thttpd_alloc.h"
+#include "thttpd_cache.h"
+
+#if defined(CONFIG_THTTPD) && defined(CONFIG_THTTPD_CACHE)
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The LRU list: most recently used entry at the head */
+
+static FAR struct httpd_cache_s *g_cache_head;
+static FAR struct httpd_cache_s *g_cache_tail;
+static size_t g_cache_used;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/* The key is hc->hostdir and hc->origfilename joined by a slash, which is
+ * how the two make up the path of the file when virtual hosts are in use.
+ */
+
+static uint32_t cache_hash(httpd_conn *hc, bool gzip)
+{
+  uint32_t hash = gzip ? 5381 * 33 : 5381;
+  FAR const char *cp;
+
+  for (cp = hc->hostdir; *cp != '\0'; cp++)
+    {
+      hash = hash * 33 + (uint8_t)*cp;
+    }
+
+  hash = hash * 33 + '/';
+  for (cp = hc->origfilename; *cp != '\0'; cp++)
+    {
+      hash = hash * 33 + (uint8_t)*cp;
+    }
+
+  return hash;
+}
+
+static bool cache_match(FAR const struct httpd_cache_s *entry,
+                        httpd_conn *hc)
+{
+  size_t len = strlen(hc->hostdir);
+
+  return strncmp(entry->key, hc->hostdir, len) == 0 &&
+         entry->key[len] == '/' &&
+         strcmp(&entry->key[len + 1], hc->origfilename) == 0;
+}
+
+static void cache_unlink(FAR struct httpd_cache_s *entry)
+{
+  if (entry->prev != NULL)
+    {
+      entry->prev->next = entry->next;
+    }
+  else
+    {
+      g_cache_head = entry->next;
+    }
+
+  if (entry->next != NULL)
+    {
+      entry->next->prev = entry->prev;
+    }
+  else
+    {
+      g_cache_tail = entry->prev;
+    }
+
+  entry->prev = NULL;
+  entry->next = NULL;
+}
+
+static void cache_push(FAR struct httpd_cache_s *entry)
+{
+  entry->prev = NULL;
+  entry->next = g_cache_head;
+  if (g_cache_head != NULL)
+    {
+      g_cache_head->prev = entry;
+    }
+  else
+    {
+      g_cache_tail = entry;
+    }
+
+  g_cache_head = entry;
+}
+
+static void cache_free(FAR struct httpd_cache_s *entry)
+{
+  httpd_free(entry->body);
+  httpd_free(entry->filename);
+  httpd_free(entry->encodings);
+  httpd_free(entry);
+}
+
+/* Take an entry out of the cache.  An entry that a connection is still
+ * sending from is freed when the last reference is released.
+ */
+
+static void cache_remove(FAR struct httpd_cache_s *entry)
+{
+  cache_unlink(entry);
+  g_cache_used -= entry->cost;
+
+  if (entry->refs > 0)
+    {
+      entry->stale = true;
+    }
+  else
+    {
+      cache_free(entry);
+    }
+}
+
+/* Evict least recently used entries until 'needed' more bytes fit */
+
+static bool cache_reserve(size_t needed)
+{
+  FAR struct httpd_cache_s *entry;
+  FAR struct httpd_cache_s *prev;
+
+  for (entry = g_cache_tail;
+       entry != NULL && g_cache_used + needed > CONFIG_THTTPD_CACHE_SIZE;
+       entry = prev)
+    {
+      prev = entry->prev;
+      if (entry->refs == 0)
+        {
+          ninfo("Evict %s\n", entry->key);
+          cache_remove(entry);
+        }
+    }
+
+  return g_cache_used + needed <= CONFIG_THTTPD_CACHE_SIZE;
+}
+
+static FAR uint8_t *cache_load(FAR const char *filename, off_t size)
+{
+  FAR uint8_t *body;
+  ssize_t nread;
+  off_t ntotal = 0;
+  int fd;
+
+  body = httpd_malloc(size > 0 ? size : 1);
+  if (body == NULL)
+    {
+      return NULL;
+    }
+
+  fd = open(filename, O_RDONLY);
+  if (fd < 0)
+    {
+      goto errout_with_body;
+    }
+
+  while (ntotal < size)
+    {
+      nread = read(fd, &body[ntotal], size - ntotal);
+      if (nread <= 0)
+        {
+          close(fd);
+          goto errout_with_body;
+        }
+
+      ntotal += nread;
+    }
+
+  close(fd);
+  return body;
+
+errout_with_body:
+  httpd_free(body);
+  return NULL;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+bool httpd_cache_lookup(httpd_conn *hc, bool gzip)
+{
+  FAR struct httpd_cache_s *entry;
+  struct stat sb;
+  uint32_t hash;
+  time_t now;
+
+  hash = cache_hash(hc, gzip);
+  for (entry = g_cache_head; entry != NULL; entry = entry->next)
+    {
+      if (entry->hash == hash && entry->gzip == gzip &&
+          cache_match(entry, hc))
+        {
+          break;
+        }
+    }
+
+  if (entry == NULL)
+    {
+      return false;
+    }
+
+  /* Check that the file has not changed if the entry is old enough */
+
+  now = time(NULL);
+  if (now - entry->checked >= CONFIG_THTTPD_CACHE_CHECK_SEC)
+    {
+      if (stat(entry->filename, &sb) < 0 ||
+          sb.st_mtime != entry->sb.st_mtime ||
+          sb.st_size != entry->sb.st_size ||
+          sb.st_mode != entry->sb.st_mode)
+        {
+          ninfo("Stale %s\n", entry->key);
+          cache_remove(entry);
+          return false;
+        }
+
+      entry->checked = now;
+    }
+
+  /* Move the entry to the head of the LRU list */
+
+  if (entry != g_cache_head)
+    {
+      cache_unlink(entry);
+      cache_push(entry);
+    }
+
+  httpd_realloc_str(&hc->expnfilename, &hc->maxexpnfilename,
+                    strlen(entry->filename));
+  strcpy(hc->expnfilename, entry->filename);
+  httpd_realloc_str(&hc->encodings, &hc->maxencodings,
+                    strlen(entry->encodings));
+  strcpy(hc->encodings, entry->encodings);
+  hc->type        = entry->type;
+  hc->sb          = entry->sb;
+  hc->pathinfo[0] = '\0';
+
+  entry->refs++;
+  hc->cached = entry;
+  return true;
+}
+
+void httpd_cache_insert(httpd_conn *hc, bool gzip)
+{
+  FAR struct httpd_cache_s *entry;
+  size_t keylen;
+  size_t cost;
+  bool hold;
+
+  keylen = strlen(hc->hostdir) + 1 + strlen(hc->origfilename);
+  hold   = hc->sb.st_size <= CONFIG_THTTPD_CACHE_MAXOBJECT;
+  cost   = sizeof(struct httpd_cache_s) + keylen +
+           strlen(hc->expnfilename) + 1 + strlen(hc->encodings) + 1;
+  if (hold)
+    {
+      cost += hc->sb.st_size;
+    }
+
+  if (cost > CONFIG_THTTPD_CACHE_SIZE || !cache_reserve(cost))
+    {
+      return;
+    }
+
+  entry = (FAR struct httpd_cache_s *)
+    httpd_malloc(sizeof(struct httpd_cache_s) + keylen);
+  if (entry == NULL)
+    {
+      return;
+    }
+
+  memset(entry, 0, sizeof(struct httpd_cache_s));
+  sprintf(entry->key, "%s/%s", hc->hostdir, hc->origfilename);
+  entry->filename  = httpd_strdup(hc->expnfilename);
+  entry->encodings = httpd_strdup(hc->encodings);
+  if (entry->filename == NULL || entry->encodings == NULL)
+    {
+      goto errout_with_entry;
+    }
+
+  if (hold)
+    {
+      entry->body = cache_load(hc->expnfilename, hc->sb.st_size);
+      if (entry->body == NULL)
+        {
+          goto errout_with_entry;
+        }
+    }
+
+  entry->hash    = cache_hash(hc, gzip);
+  entry->gzip    = gzip;
+  entry->checked = time(NULL);
+  entry->cost    = cost;
+  entry->sb      = hc->sb;
+  entry->type    = hc->type;
+  entry->refs    = 1;
+
+  cache_push(entry);
+  g_cache_used += cost;
+
+  ninfo("Cached %s as %s (%jd bytes%s), %zu/%d used\n",
+        entry->key, entry->filename, (intmax_t)hc->sb.st_size,
+        hold ? " in memory" : "", g_cache_used, CONFIG_THTTPD_CACHE_SIZE);
+
+  hc->cached = entry;
+  return;
+
+errout_with_entry:
+  cache_free(entry);
+}
+
+void httpd_cache_release(httpd_conn *hc)
+{
+  FAR struct httpd_cache_s *entry = hc->cached;
+
+  if (entry != NULL)
+    {
+      hc->cached = NULL;
+      hc->body   = NULL;
+
+      if (--entry->refs == 0 && entry->stale)
+        {
+          cache_free(entry);
+        }
+    }
+}
+
+#endif /* CONFIG_THTTPD && CONFIG_THTTPD_CACHE */
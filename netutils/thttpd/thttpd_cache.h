@@ -0,0 +1,92 @@
+/****************************************************************************
+ * apps/netutils/thttpd/thttpd_cache.h
+ * LRU cache of resolved static files
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APPS_NETUTILS_THTTPD_THTTPD_CACHE_H
+#define __APPS_NETUTILS_THTTPD_THTTPD_CACHE_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/stat.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "config.h"
+#include "libhttpd.h"
+
+#if defined(CONFIG_THTTPD) && defined(CONFIG_THTTPD_CACHE)
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+/* One cached static file.  The key is the virtual host directory and the
+ * URL path (hc->hostdir and hc->origfilename) plus whether the client
+ * accepted gzip, since that selects between a file and its pre-compressed
+ * sibling.
+ */
+
+struct httpd_cache_s
+{
+  FAR struct httpd_cache_s *prev; /* LRU list, most recently used first */
+  FAR struct httpd_cache_s *next;
+  uint32_t hash;                  /* Hash of the key, checked first */
+  bool gzip;                      /* Entry for clients accepting gzip */
+  bool stale;                     /* Removed from the list while in use */
+  uint16_t refs;                  /* Connections using this entry */
+  time_t checked;                 /* When the file was last stat()ed */
+  size_t cost;                    /* Bytes charged against the budget */
+  struct stat sb;                 /* File status when cached */
+  FAR char *type;                 /* MIME type, not malloc()ed */
+  FAR char *encodings;            /* Content-Encoding value */
+  FAR char *filename;             /* Expanded file name */
+  FAR uint8_t *body;              /* File contents, NULL if too large */
+  char key[1];                    /* "hostdir/path", allocated with entry */
+};
+
+/****************************************************************************
+ * Public Function Prototypes
+ ****************************************************************************/
+
+/* Look up hc->origfilename on the virtual host in hc->hostdir.  On a hit,
+ * hc->cached holds a reference to the entry and hc->expnfilename, hc->sb,
+ * hc->type and hc->encodings are set up as if the request had been
+ * resolved.  Returns false on a miss or if the cached file has changed.
+ */
+
+extern bool httpd_cache_lookup(httpd_conn *hc, bool gzip);
+
+/* Add the file that httpd_start_request() resolved for hc to the cache.
+ * On success hc->cached holds a reference to the new entry.
+ */
+
+extern void httpd_cache_insert(httpd_conn *hc, bool gzip);
+
+/* Drop the reference held in hc->cached, if any. */
+
+extern void httpd_cache_release(httpd_conn *hc);
+
+#endif /* CONFIG_THTTPD && CONFIG_THTTPD_CACHE */
+#endif /* __APPS_NETUTILS_THTTPD_THTTPD_CACHE_H */
@@ -1078,6 +1078,7 @@ int cgi(httpd_conn *hc)
 
       hc->bytes_sent    = CONFIG_THTTPD_CGI_BYTECOUNT;
       hc->should_linger = false;
+      hc->keep_alive    = false;
     }
   else
     {
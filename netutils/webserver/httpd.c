@@ -51,6 +51,7 @@
 #include <sys/socket.h>
 #include <sys/time.h>
 #include <stdint.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <strings.h>
@@ -64,6 +65,12 @@
 #  include <pthread.h>
 #endif
 
+#ifdef CONFIG_NETUTILS_HTTPD_POLL
+#  include <fcntl.h>
+#  include <poll.h>
+#  include <time.h>
+#endif
+
 #include <arpa/inet.h>
 
 #include "netutils/netlib.h"
@@ -130,10 +137,49 @@
 #  endif
 #endif
 
+#ifdef CONFIG_NETUTILS_HTTPD_POLL
+#  ifndef CONFIG_NETUTILS_HTTPD_POLL_MAXCONN
+#    define CONFIG_NETUTILS_HTTPD_POLL_MAXCONN 8
+#  endif
+#  ifndef CONFIG_NETUTILS_HTTPD_POLL_MAXPEND
+#    define CONFIG_NETUTILS_HTTPD_POLL_MAXPEND 16384
+#  endif
+#endif
+
+/* Length of the "Error %d\n" body sent when there is no error page */
+
+#define HTTPD_ERRMSG_LEN 10
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+enum httpd_parsestate_e
+{
+  STATE_METHOD,
+  STATE_HEADER,
+  STATE_BODY
+};
+
+#ifdef CONFIG_NETUTILS_HTTPD_POLL
+enum httpd_connstate_e
+{
+  CONN_RECV,                  /* Receiving the request */
+  CONN_SEND                   /* Sending the queued response */
+};
+#endif
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
 
+#ifdef CONFIG_NETUTILS_HTTPD_POLL
+/* The connections being served by poll_server() */
+
+static FAR struct httpd_state *g_conns[CONFIG_NETUTILS_HTTPD_POLL_MAXCONN];
+static int g_nconns;
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -269,10 +315,12 @@ static int handle_script(struct httpd_state *pstate)
                                             pstate->ht_file.data,
                                             pstate->ht_file.len,
                                             chunked_http_tx);
-              DEBUGASSERT(status >= 0);
-              UNUSED(status);
 
               httpd_close(&pstate->ht_file);
+              if (status < 0)
+                {
+                  return ERROR;
+                }
             }
           else
             {
@@ -330,8 +378,10 @@ static int handle_script(struct httpd_state *pstate)
           status = httpd_send_datachunk(pstate->ht_sockfd,
                                         pstate->ht_file.data,
                                         len, chunked_http_tx);
-          DEBUGASSERT(status >= 0);
-          UNUSED(status);
+          if (status < 0)
+            {
+              return ERROR;
+            }
 
           pstate->ht_file.data += len;
           pstate->ht_file.len  -= len;
@@ -342,329 +392,625 @@ static int handle_script(struct httpd_state *pstate)
   /* Chunked encoding terminator */
 
   status = httpd_send_datachunk(pstate->ht_sockfd, 0, 0, chunked_http_tx);
-  DEBUGASSERT(status >= 0);
-  UNUSED(status);
+  if (status < 0)
+    {
+      return ERROR;
+    }
 #endif
 
   return OK;
 }
 #endif
 
-static int send_chunk(struct httpd_state *pstate, const char *buf, int len)
-{
-  int ret;
+/****************************************************************************
+ * Name: httpd_format_headers
+ *
+ * Description:
+ *   Format the response headers into 'header', which must hold
+ *   HTTPD_MAX_HEADERLEN bytes, and return their length.
+ *
+ ****************************************************************************/
 
-  do
+static int httpd_format_headers(struct httpd_state *pstate, int status,
+                                int len, FAR char *header)
+{
+  const char *mime;
+  const char *ptr;
+  char contentlen[HTTPD_MAX_CONTENTLEN] =
     {
-      httpd_dumpbuffer("Outgoing chunk", buf, len);
-      ret = send(pstate->ht_sockfd, buf, len, 0);
-      if (ret < 0)
-        {
-          return ERROR;
-        }
-
-      buf += ret;
-      len -= ret;
-    }
-  while (len > 0);
-
-  return OK;
-}
+      0
+    };
 
-static int httpd_senderror(struct httpd_state *pstate, int status)
-{
-  int ret;
-  char msg[10 + 1];
+  int hdrlen;
+  int i;
 
-  ninfo("[%d] sending error '%d'\n", pstate->ht_sockfd, status);
+  static const struct
+  {
+    const char *ext;
+    const char *mime;
+  }
 
-  if (status < 400 || status >= 600)
+  a[] =
     {
-      status = 500;
-    }
-
-#ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
-  if (status != 404)
+#ifndef CONFIG_NETUTILS_HTTPD_SCRIPT_DISABLE
     {
-      pstate->ht_keepalive = false;
-    }
+      "shtml", "text/html"
+    },
 #endif
 
-  snprintf(pstate->ht_filename, sizeof pstate->ht_filename,
-           "%s/%d.html", CONFIG_NETUTILS_HTTPD_ERRPATH, status);
+    {
+      "html",  "text/html"
+    },
 
-  ret = httpd_openindex(pstate);
+    {
+      "css",   "text/css"
+    },
 
-  if (httpd_send_headers(pstate, status,
-                   ret == OK ? pstate->ht_file.len : sizeof msg - 1) != OK)
     {
-      return ERROR;
-    }
+      "txt",   "text/plain"
+    },
 
-  if (ret != OK)
     {
-      snprintf(msg, sizeof msg, "Error %d\n", status);
+      "json",  "application/json"
+    },
 
-      ret = send_chunk(pstate, msg, sizeof msg - 1);
-    }
-  else
     {
-#ifdef CONFIG_NETUTILS_HTTPD_CLASSIC
-      ret = send_chunk(pstate, pstate->ht_file.data, pstate->ht_file.len);
-#else
-#ifdef CONFIG_NETUTILS_HTTPD_SENDFILE
-      ret = httpd_sendfile_send(pstate->ht_sockfd, &pstate->ht_file);
-#endif
-#endif
+      "js",    "text/javascript"
+    },
 
-      httpd_close(&pstate->ht_file);
-    }
+    {
+      "png",   "image/png"
+    },
 
-  return ret;
-}
+    {
+      "gif",   "image/gif"
+    },
 
-static int httpd_sendfile(struct httpd_state *pstate)
-{
-#ifndef CONFIG_NETUTILS_HTTPD_SCRIPT_DISABLE
-  char *ptr;
-#endif
-  int ret = ERROR;
+    {
+      "jpeg",  "image/jpeg"
+    },
 
-  pstate->ht_sndlen = 0;
+    {
+      "jpg",   "image/jpeg"
+    },
 
-  ninfo("[%d] sending file '%s'\n", pstate->ht_sockfd, pstate->ht_filename);
+    {
+      "mp3",   "audio/mpeg"
+    },
+    };
 
-#ifdef CONFIG_NETUTILS_HTTPD_CGIPATH
+  ptr = strrchr(pstate->ht_filename, ISO_PERIOD);
+  if (ptr == NULL)
     {
-      httpd_cgifunction f;
+      mime = "application/octet-stream";
+    }
+  else
+    {
+      mime = "text/plain";
 
-      f = httpd_cgi(pstate->ht_filename);
-      if (f != NULL)
+      for (i = 0; i < sizeof a / sizeof *a; i++)
         {
-#ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
-          pstate->ht_keepalive = false;
-#endif
-          f(pstate, pstate->ht_filename);
-
-          return OK;
+          if (strncmp(a[i].ext, ptr + 1, strlen(a[i].ext)) == 0)
+            {
+              mime = a[i].mime;
+              break;
+            }
         }
     }
-#endif
 
-  if (httpd_openindex(pstate) != OK)
+#ifdef CONFIG_NETUTILS_HTTPD_DIRLIST
+  if (false == httpd_is_file(pstate->ht_filename))
     {
-      nwarn("WARNING: [%d] '%s' not found\n",
-           pstate->ht_sockfd, pstate->ht_filename);
-      return httpd_senderror(pstate, 404);
+      /* we assume that it's a directory */
+
+      mime = "text/html";
     }
+#endif
 
-#ifndef CONFIG_NETUTILS_HTTPD_SCRIPT_DISABLE
-  ptr = strchr(pstate->ht_filename, ISO_PERIOD);
-  if (ptr != NULL &&
-      strncmp(ptr, ".shtml", strlen(".shtml")) == 0)
+  if (len >= 0)
+    {
+      snprintf(contentlen, HTTPD_MAX_CONTENTLEN,
+               "Content-Length: %d\r\n", len);
+    }
+  else
     {
 #ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
+      /* Length unknown ahead of time */
+
       pstate->ht_keepalive = false;
 #endif
-      if (httpd_send_headers(pstate, 200, -1) != OK)
-        {
-          goto done;
-        }
+#if defined(CONFIG_NETUTILS_HTTPD_ENABLE_CHUNKED_ENCODING)
+      /* Turn on chunked encoding */
 
-      ret = handle_script(pstate);
-      goto done;
-    }
+      snprintf(contentlen, HTTPD_MAX_CONTENTLEN,
+               "Transfer-Encoding: chunked\r\n");
+      pstate->ht_chunked = true;
 #endif
-
-#ifdef CONFIG_NETUTILS_HTTPD_DIRLIST
-  if (httpd_send_headers(pstate, 200, -1) != OK)
-    {
-      goto done;
     }
-#else
-  if (httpd_send_headers(pstate, pstate->ht_file.len == 0 ? 204 : 200,
-                         pstate->ht_file.len) != OK)
+
+  if (status == 413)
     {
-      goto done;
+      /* TODO: here we "SHOULD" include a Retry-After header */
     }
-#endif
 
-#ifdef CONFIG_NETUTILS_HTTPD_CLASSIC
-  ret = send_chunk(pstate, pstate->ht_file.data, pstate->ht_file.len);
-#else
-#ifdef CONFIG_NETUTILS_HTTPD_SENDFILE
-  ret = httpd_sendfile_send(pstate->ht_sockfd, &pstate->ht_file);
+  /* Construct the header */
+
+  hdrlen = snprintf(header, HTTPD_MAX_HEADERLEN,
+                    "HTTP/1.0 %d %s\r\n"
+#ifndef CONFIG_NETUTILS_HTTPD_SERVERHEADER_DISABLE
+                    "Server: uIP/NuttX http://nuttx.org/\r\n"
 #endif
+                    "Connection: %s\r\n"
+                    "Content-type: %s\r\n"
+                    "%s"
+                    "\r\n",
+                    status,
+                    status >= 400 ? "Error" : "OK",
+#ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
+                    pstate->ht_keepalive ? "keep-alive" : "close",
+#else
+                    "close",
 #endif
+                    mime,
+                    contentlen
+                    );
 
-done:
-  httpd_close(&pstate->ht_file);
-  return ret;
+  return hdrlen < HTTPD_MAX_HEADERLEN ? hdrlen : HTTPD_MAX_HEADERLEN - 1;
 }
 
-static inline int httpd_parse(struct httpd_state *pstate)
+#ifdef CONFIG_NETUTILS_HTTPD_POLL
+/* Find the connection using sockfd.  CGI functions only pass the socket
+ * to httpd_send_datachunk(), so this is how their output is matched with
+ * the connection's pending data.
+ */
+
+static FAR struct httpd_state *poll_lookup(int sockfd)
 {
-  char *o;
+  int i;
 
-  enum
+  for (i = 0; i < g_nconns; i++)
     {
-      STATE_METHOD,
-      STATE_HEADER,
-      STATE_BODY
-    } state;
+      if (g_conns[i]->ht_sockfd == sockfd)
+        {
+          return g_conns[i];
+        }
+    }
 
-  state = STATE_METHOD;
-  o = pstate->ht_buffer;
+  return NULL;
+}
 
-  do
+/* Keep data that the socket would not take, for poll_send() to send once
+ * it is writable.
+ */
+
+static int poll_pend(FAR struct httpd_state *pstate, FAR const char *buf,
+                     int len)
+{
+  FAR char *newbuf;
+  size_t newsize;
+  size_t need;
+
+  need = pstate->ht_pendlen + len;
+  if (need > CONFIG_NETUTILS_HTTPD_POLL_MAXPEND)
     {
-      char *start;
-      char *end;
+      nerr("ERROR: [%d] pending output overflow\n", pstate->ht_sockfd);
+      errno = ENOBUFS;
+      return ERROR;
+    }
 
-      if (o == pstate->ht_buffer + sizeof pstate->ht_buffer)
+  if (pstate->ht_pendoff + need > pstate->ht_pendsize)
+    {
+      if (pstate->ht_pendoff > 0)
         {
-          nerr("ERROR: ht_buffer overflow\n");
-          return 413;
+          memmove(pstate->ht_pend, pstate->ht_pend + pstate->ht_pendoff,
+                  pstate->ht_pendlen);
+          pstate->ht_pendoff = 0;
         }
 
+      if (need > pstate->ht_pendsize)
         {
-          ssize_t r;
+          newsize = pstate->ht_pendsize * 2;
+          if (newsize < need)
+            {
+              newsize = need;
+            }
 
-          r = recv(pstate->ht_sockfd, o,
-            sizeof pstate->ht_buffer - (o - pstate->ht_buffer), 0);
-          if (r == 0)
+          if (newsize > CONFIG_NETUTILS_HTTPD_POLL_MAXPEND)
             {
-              nwarn("WARNING: [%d] connection lost\n", pstate->ht_sockfd);
+              newsize = CONFIG_NETUTILS_HTTPD_POLL_MAXPEND;
+            }
+
+          newbuf = realloc(pstate->ht_pend, newsize);
+          if (newbuf == NULL)
+            {
+              nerr("ERROR: [%d] out of memory\n", pstate->ht_sockfd);
+              errno = ENOMEM;
               return ERROR;
             }
 
-#if CONFIG_NETUTILS_HTTPD_TIMEOUT > 0
-          if (r == -1 && errno == EWOULDBLOCK)
+          pstate->ht_pend     = newbuf;
+          pstate->ht_pendsize = newsize;
+        }
+    }
+
+  memcpy(pstate->ht_pend + pstate->ht_pendoff + pstate->ht_pendlen, buf,
+         len);
+  pstate->ht_pendlen += len;
+  return OK;
+}
+#endif
+
+/* Send all of buf.  In poll mode whatever a full socket will not take is
+ * left with the connection instead.
+ */
+
+static int httpd_send_all(int sockfd, FAR const void *buf, int len)
+{
+  FAR const char *ptr = buf;
+  ssize_t ret;
+#ifdef CONFIG_NETUTILS_HTTPD_POLL
+  FAR struct httpd_state *pstate;
+
+  /* Anything sent now would overtake the data already waiting */
+
+  pstate = poll_lookup(sockfd);
+  if (pstate != NULL && pstate->ht_pendlen > 0)
+    {
+      return len > 0 ? poll_pend(pstate, ptr, len) : OK;
+    }
+#endif
+
+  while (len > 0)
+    {
+      ret = send(sockfd, ptr, len, 0);
+      if (ret < 0)
+        {
+#ifdef CONFIG_NETUTILS_HTTPD_POLL
+          if (pstate != NULL && (errno == EAGAIN || errno == EWOULDBLOCK))
             {
-              nwarn("WARNING: recv timeout\n");
-              return 408;
+              return poll_pend(pstate, ptr, len);
             }
 #endif
 
-          if (r == -1)
+          if (errno == EINTR)
             {
-              nerr("ERROR: [%d] recv failed: %d\n",
-                   pstate->ht_sockfd, errno);
-              return 400;
+              continue;
             }
 
-          o += r;
+          return ERROR;
         }
 
-      /* Here o marks the end of the total block currently awaiting
-       * processing.  There may be multiple lines in a block; next we deal
-       * with each in turn.
-       */
+      ptr += ret;
+      len -= ret;
+    }
+
+  return OK;
+}
+
+static int send_chunk(struct httpd_state *pstate, const char *buf, int len)
+{
+  httpd_dumpbuffer("Outgoing chunk", buf, len);
+  return httpd_send_all(pstate->ht_sockfd, buf, len);
+}
+
+/* The headers and any generated body are sent straight away.  In poll mode
+ * the body of a file is left to poll_send(), which sends it as the socket
+ * becomes writable, and ht_file stays open until then.
+ */
+
+static int httpd_putfile(struct httpd_state *pstate)
+{
+  int ret = ERROR;
+
+#ifdef CONFIG_NETUTILS_HTTPD_POLL
+  pstate->ht_fileopen = true;
+#ifdef CONFIG_NETUTILS_HTTPD_SENDFILE
+#ifdef CONFIG_NETUTILS_HTTPD_DIRLIST
+  if (pstate->ht_file.fd == -1)
+    {
+      /* A directory listing is generated now, like CGI output */
+
+      return httpd_sendfile_send(pstate->ht_sockfd, &pstate->ht_file);
+    }
+#endif
+
+  pstate->ht_sendfile = true;
+#else
+  pstate->ht_dataptr  = pstate->ht_file.data;
+  pstate->ht_datalen  = pstate->ht_file.len;
+#endif
+  ret = OK;
+#else
+#ifdef CONFIG_NETUTILS_HTTPD_CLASSIC
+  ret = send_chunk(pstate, pstate->ht_file.data, pstate->ht_file.len);
+#else
+#ifdef CONFIG_NETUTILS_HTTPD_SENDFILE
+  ret = httpd_sendfile_send(pstate->ht_sockfd, &pstate->ht_file);
+#endif
+#endif
+#endif
+
+  return ret;
+}
+
+static void httpd_release(struct httpd_state *pstate)
+{
+#ifdef CONFIG_NETUTILS_HTTPD_POLL
+  if (pstate->ht_fileopen)
+    {
+      /* Closed by the poll loop once the response has been sent */
+
+      return;
+    }
+#endif
+
+  httpd_close(&pstate->ht_file);
+}
+
+static int httpd_senderror(struct httpd_state *pstate, int status)
+{
+  char msg[HTTPD_ERRMSG_LEN + 1];
+  int ret;
+
+  ninfo("[%d] sending error '%d'\n", pstate->ht_sockfd, status);
+
+  if (status < 400 || status >= 600)
+    {
+      status = 500;
+    }
+
+#ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
+  if (status != 404)
+    {
+      pstate->ht_keepalive = false;
+    }
+#endif
 
-      for (start = pstate->ht_buffer;
-           (end = memchr(start, '\r', o - start)), end != NULL;
-           start = end)
+  snprintf(pstate->ht_filename, sizeof pstate->ht_filename,
+           "%s/%d.html", CONFIG_NETUTILS_HTTPD_ERRPATH, status);
+
+  ret = httpd_openindex(pstate);
+
+  if (httpd_send_headers(pstate, status,
+                         ret == OK ? pstate->ht_file.len :
+                                     HTTPD_ERRMSG_LEN) != OK)
+    {
+      if (ret == OK)
         {
-          *end = '\0';
-          end++;
+          httpd_close(&pstate->ht_file);
+        }
 
-          /* Here start and end are a single line within the current block */
+      return ERROR;
+    }
 
-          httpd_dumpbuffer("Incoming HTTP line", start, end - start);
+  if (ret != OK)
+    {
+      snprintf(msg, HTTPD_ERRMSG_LEN + 1, "Error %d\n", status);
 
-          if (*end != '\n')
-            {
-              nwarn("WARNING: expected CRLF\n");
-              return 400;
-            }
+      ret = send_chunk(pstate, msg, HTTPD_ERRMSG_LEN);
+    }
+  else
+    {
+      ret = httpd_putfile(pstate);
+      httpd_release(pstate);
+    }
 
-          end++;
-
-          switch (state)
-          {
-          char *v;
-
-          case STATE_METHOD:
-            if (0 != strncmp(start, "GET ", 4))
-              {
-                nwarn("WARNING: method not supported\n");
-                return 501;
-              }
-
-            start += 4;
-            v = start + strcspn(start, " ");
-
-            if (0 != strcmp(v, " HTTP/1.0") && 0 != strcmp(v, " HTTP/1.1"))
-              {
-                nwarn("WARNING: HTTP version not supported\n");
-                return 505;
-              }
-
-            /* TODO: url decoding */
-
-            if (v - start >= sizeof pstate->ht_filename)
-              {
-                nerr("ERROR: ht_filename overflow\n");
-                return 414;
-              }
-
-            *v = '\0';
-            strcpy(pstate->ht_filename, start);
-            state = STATE_HEADER;
-            break;
-
-          case STATE_HEADER:
-            if (*start == '\0')
-              {
-                state = STATE_BODY;
-                break;
-              }
-
-            v = start + strcspn(start, ":");
-            if (*v != '\0')
-              {
-                *v = '\0', v++;
-                v += strspn(v, ": ");
-              }
-
-            if (*start == '\0' || *v == '\0')
-              {
-                nwarn("WARNING: header parse error\n");
-                return 400;
-              }
-
-            ninfo("[%d] Request header %s: %s\n",
-                  pstate->ht_sockfd, start, v);
-
-            if (0 == strcasecmp(start, "Content-Length") && 0 != atoi(v))
-              {
-                nwarn("WARNING: non-zero request length\n");
-                return 413;
-              }
+  return ret;
+}
+
+static int httpd_sendfile(struct httpd_state *pstate)
+{
+#ifndef CONFIG_NETUTILS_HTTPD_SCRIPT_DISABLE
+  char *ptr;
+#endif
+  int ret = ERROR;
+
+  pstate->ht_sndlen = 0;
+
+  ninfo("[%d] sending file '%s'\n", pstate->ht_sockfd, pstate->ht_filename);
+
+#ifdef CONFIG_NETUTILS_HTTPD_CGIPATH
+    {
+      httpd_cgifunction f;
+
+      f = httpd_cgi(pstate->ht_filename);
+      if (f != NULL)
+        {
 #ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
-            else if (0 == strcasecmp(start, "Connection") &&
-                     0 == strcasecmp(v, "keep-alive"))
-              {
-                pstate->ht_keepalive = true;
-              }
+          pstate->ht_keepalive = false;
 #endif
-            break;
+          f(pstate, pstate->ht_filename);
 
-          case STATE_BODY:
+          return OK;
+        }
+    }
+#endif
 
-            /* Not implemented */
+  if (httpd_openindex(pstate) != OK)
+    {
+      nwarn("WARNING: [%d] '%s' not found\n",
+           pstate->ht_sockfd, pstate->ht_filename);
+      return httpd_senderror(pstate, 404);
+    }
 
-            break;
-          }
-       }
+#ifndef CONFIG_NETUTILS_HTTPD_SCRIPT_DISABLE
+  ptr = strchr(pstate->ht_filename, ISO_PERIOD);
+  if (ptr != NULL &&
+      strncmp(ptr, ".shtml", strlen(".shtml")) == 0)
+    {
+#ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
+      pstate->ht_keepalive = false;
+#endif
+      if (httpd_send_headers(pstate, 200, -1) != OK)
+        {
+          goto done;
+        }
 
-      /* Shuffle down for the next block */
+      ret = handle_script(pstate);
+      goto done;
+    }
+#endif
 
-      memmove(pstate->ht_buffer, start, o - start);
-      o -= (start - pstate->ht_buffer);
+#ifdef CONFIG_NETUTILS_HTTPD_DIRLIST
+  if (httpd_send_headers(pstate, 200, -1) != OK)
+    {
+      goto done;
     }
-  while (state != STATE_BODY);
+#else
+  if (httpd_send_headers(pstate, pstate->ht_file.len == 0 ? 204 : 200,
+                         pstate->ht_file.len) != OK)
+    {
+      goto done;
+    }
+#endif
+
+  ret = httpd_putfile(pstate);
+
+done:
+  httpd_release(pstate);
+  return ret;
+}
 
+/* Handle one request line, returning 200 to carry on or an error status */
+
+static int httpd_parse_line(struct httpd_state *pstate, FAR char *start,
+                            FAR enum httpd_parsestate_e *state)
+{
+  char *v;
+
+  switch (*state)
+  {
+  case STATE_METHOD:
+    if (0 != strncmp(start, "GET ", 4))
+      {
+        nwarn("WARNING: method not supported\n");
+        return 501;
+      }
+
+    start += 4;
+    v = start + strcspn(start, " ");
+
+    if (0 != strcmp(v, " HTTP/1.0") && 0 != strcmp(v, " HTTP/1.1"))
+      {
+        nwarn("WARNING: HTTP version not supported\n");
+        return 505;
+      }
+
+    /* TODO: url decoding */
+
+    if (v - start >= sizeof pstate->ht_filename)
+      {
+        nerr("ERROR: ht_filename overflow\n");
+        return 414;
+      }
+
+    *v = '\0';
+    strcpy(pstate->ht_filename, start);
+    *state = STATE_HEADER;
+    break;
+
+  case STATE_HEADER:
+    if (*start == '\0')
+      {
+        *state = STATE_BODY;
+        break;
+      }
+
+    v = start + strcspn(start, ":");
+    if (*v != '\0')
+      {
+        *v = '\0', v++;
+        v += strspn(v, ": ");
+      }
+
+    if (*start == '\0' || *v == '\0')
+      {
+        nwarn("WARNING: header parse error\n");
+        return 400;
+      }
+
+    ninfo("[%d] Request header %s: %s\n",
+          pstate->ht_sockfd, start, v);
+
+    if (0 == strcasecmp(start, "Content-Length") && 0 != atoi(v))
+      {
+        nwarn("WARNING: non-zero request length\n");
+        return 413;
+      }
+#ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
+    else if (0 == strcasecmp(start, "Connection") &&
+             0 == strcasecmp(v, "keep-alive"))
+      {
+        pstate->ht_keepalive = true;
+      }
+#endif
+    break;
+
+  case STATE_BODY:
+
+    /* Not implemented */
+
+    break;
+  }
+
+  return 200;
+}
+
+/* Parse the complete lines received so far.  *po marks the end of the data
+ * in ht_buffer; any partial line is shuffled down to the start of the
+ * buffer and *po is moved back to match.
+ */
+
+static int httpd_parse_block(struct httpd_state *pstate, FAR char **po,
+                             FAR enum httpd_parsestate_e *state)
+{
+  char *o = *po;
+  char *start;
+  char *end;
+  int status;
+
+  /* Stop at the end of the headers; anything after them belongs to the
+   * next request on the connection.
+   */
+
+  for (start = pstate->ht_buffer;
+       *state != STATE_BODY &&
+       (end = memchr(start, '\r', o - start)) != NULL;
+       start = end)
+    {
+      *end = '\0';
+      end++;
+
+      /* Here start and end are a single line within the current block */
+
+      httpd_dumpbuffer("Incoming HTTP line", start, end - start);
+
+      if (*end != '\n')
+        {
+          nwarn("WARNING: expected CRLF\n");
+          return 400;
+        }
+
+      end++;
+
+      status = httpd_parse_line(pstate, start, state);
+      if (status != 200)
+        {
+          return status;
+        }
+    }
+
+  /* Shuffle down for the next block */
+
+  memmove(pstate->ht_buffer, start, o - start);
+  *po = o - (start - pstate->ht_buffer);
+  return 200;
+}
+
+/* Called once all of the request headers have been parsed */
+
+static void httpd_parse_done(struct httpd_state *pstate)
+{
 #ifdef CONFIG_NETUTILS_HTTPD_CLASSIC
   if (0 == strcmp(pstate->ht_filename, "/"))
     {
@@ -674,7 +1020,69 @@ static inline int httpd_parse(struct httpd_state *pstate)
 #endif
 
   ninfo("[%d] Filename: %s\n", pstate->ht_sockfd, pstate->ht_filename);
+}
+
+#ifndef CONFIG_NETUTILS_HTTPD_POLL
+static inline int httpd_parse(struct httpd_state *pstate)
+{
+  enum httpd_parsestate_e state;
+  char *o;
+  int status;
+
+  state = STATE_METHOD;
+  o = pstate->ht_buffer;
+
+  do
+    {
+      if (o == pstate->ht_buffer + sizeof pstate->ht_buffer)
+        {
+          nerr("ERROR: ht_buffer overflow\n");
+          return 413;
+        }
+
+        {
+          ssize_t r;
+
+          r = recv(pstate->ht_sockfd, o,
+            sizeof pstate->ht_buffer - (o - pstate->ht_buffer), 0);
+          if (r == 0)
+            {
+              nwarn("WARNING: [%d] connection lost\n", pstate->ht_sockfd);
+              return ERROR;
+            }
+
+#if CONFIG_NETUTILS_HTTPD_TIMEOUT > 0
+          if (r == -1 && errno == EWOULDBLOCK)
+            {
+              nwarn("WARNING: recv timeout\n");
+              return 408;
+            }
+#endif
+
+          if (r == -1)
+            {
+              nerr("ERROR: [%d] recv failed: %d\n",
+                   pstate->ht_sockfd, errno);
+              return 400;
+            }
+
+          o += r;
+        }
+
+      /* Here o marks the end of the total block currently awaiting
+       * processing.  There may be multiple lines in a block; next we deal
+       * with each in turn.
+       */
+
+      status = httpd_parse_block(pstate, &o, &state);
+      if (status != 200)
+        {
+          return status;
+        }
+    }
+  while (state != STATE_BODY);
 
+  httpd_parse_done(pstate);
   return 200;
 }
 
@@ -726,35 +1134,392 @@ static void *httpd_handler(void *arg)
 
 #ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
         }
-      while (pstate->ht_keepalive);
-#endif
+      while (pstate->ht_keepalive);
+#endif
+
+      /* End of command processing -- Clean up and exit */
+
+      free(pstate);
+    }
+
+  /* Exit the task */
+
+  ninfo("[%d] Exiting\n", sockfd);
+  close(sockfd);
+  return NULL;
+}
+#endif /* !CONFIG_NETUTILS_HTTPD_POLL */
+
+#ifdef CONFIG_NETUTILS_HTTPD_SINGLECONNECT
+static void single_server(uint16_t portno, pthread_startroutine_t handler,
+                          int stacksize)
+{
+  struct sockaddr_in myaddr;
+  socklen_t addrlen;
+  int listensd;
+  int acceptsd;
+#ifdef CONFIG_NET_SOLINGER
+  struct linger ling;
+#endif
+#if CONFIG_NETUTILS_HTTPD_TIMEOUT > 0
+  struct timeval tv;
+#endif
+
+  listensd = netlib_listenon(portno);
+  if (listensd < 0)
+    {
+      return;
+    }
+
+  /* Begin serving connections */
+
+  for (; ; )
+    {
+      addrlen = sizeof(struct sockaddr_in);
+      acceptsd = accept(listensd, (FAR struct sockaddr *)&myaddr, &addrlen);
+
+      if (acceptsd < 0)
+        {
+          nerr("ERROR: accept failure: %d\n", errno);
+          break;
+        }
+
+      ninfo("Connection accepted -- serving sd=%d\n", acceptsd);
+
+      /* Configure to "linger" until all data is sent
+       * when the socket is closed
+       */
+
+#ifdef CONFIG_NET_SOLINGER
+      ling.l_onoff  = 1;
+      ling.l_linger = 30;     /* timeout is seconds */
+      if (setsockopt(acceptsd, SOL_SOCKET, SO_LINGER, &ling,
+                     sizeof(struct linger)) < 0)
+        {
+          close(acceptsd);
+          nerr("ERROR: setsockopt SO_LINGER failure: %d\n", errno);
+          break;
+        }
+#endif
+
+#if CONFIG_NETUTILS_HTTPD_TIMEOUT > 0
+      /* Set up a receive timeout */
+
+      tv.tv_sec  = CONFIG_NETUTILS_HTTPD_TIMEOUT;
+      tv.tv_usec = 0;
+      if (setsockopt(acceptsd, SOL_SOCKET, SO_RCVTIMEO, &tv,
+                     sizeof(struct timeval)) < 0)
+        {
+          close(acceptsd);
+          nerr("ERROR: setsockopt SO_RCVTIMEO failure: %d\n", errno);
+          break;
+        }
+#endif
+
+      /* Handle the request. This blocks until complete. */
+
+      httpd_handler((FAR void *)acceptsd);
+    }
+
+  /* Close the sockets */
+
+  close(acceptsd);
+  close(listensd);
+}
+#endif
+
+#ifdef CONFIG_NETUTILS_HTTPD_POLL
+/* Get ready for the next request on a connection.  Bytes of a pipelined
+ * request may already be waiting in ht_buffer, so ht_rcvlen is kept.
+ */
+
+static void poll_reset(struct httpd_state *pstate)
+{
+  pstate->ht_connstate  = CONN_RECV;
+  pstate->ht_parsestate = STATE_METHOD;
+  pstate->ht_datalen    = 0;
+  pstate->ht_fileopen   = false;
+  pstate->ht_sendfile   = false;
+#ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
+  pstate->ht_keepalive  = false;
+#endif
+#if defined(CONFIG_NETUTILS_HTTPD_ENABLE_CHUNKED_ENCODING)
+  pstate->ht_chunked    = false;
+#endif
+}
+
+/* Parse the request bytes in ht_buffer.  Returns 0 while the request is
+ * incomplete, otherwise 200 or an error status.
+ */
+
+static int poll_parse(struct httpd_state *pstate)
+{
+  enum httpd_parsestate_e state;
+  char *o;
+  int status;
+
+  o     = pstate->ht_buffer + pstate->ht_rcvlen;
+  state = pstate->ht_parsestate;
+
+  status = httpd_parse_block(pstate, &o, &state);
+
+  pstate->ht_parsestate = state;
+  pstate->ht_rcvlen     = o - pstate->ht_buffer;
+
+  if (status != 200)
+    {
+      return status;
+    }
+
+  if (state != STATE_BODY)
+    {
+      return 0;
+    }
+
+  httpd_parse_done(pstate);
+  return 200;
+}
+
+/* Receive and parse whatever has arrived.  Returns as poll_parse(), or
+ * ERROR if the connection has gone.
+ */
+
+static int poll_recv(struct httpd_state *pstate)
+{
+  ssize_t r;
+
+  if (pstate->ht_rcvlen == sizeof pstate->ht_buffer)
+    {
+      nerr("ERROR: ht_buffer overflow\n");
+      return 413;
+    }
+
+  r = recv(pstate->ht_sockfd, pstate->ht_buffer + pstate->ht_rcvlen,
+           sizeof pstate->ht_buffer - pstate->ht_rcvlen, 0);
+  if (r == 0)
+    {
+      ninfo("[%d] connection closed\n", pstate->ht_sockfd);
+      return ERROR;
+    }
+
+  if (r < 0)
+    {
+      if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        {
+          return 0;
+        }
+
+      nerr("ERROR: [%d] recv failed: %d\n", pstate->ht_sockfd, errno);
+      return 400;
+    }
+
+  pstate->ht_rcvlen += r;
+  return poll_parse(pstate);
+}
+
+/* Send as much of the response as the socket will take: first the pending
+ * headers and generated output, then the file.  Returns OK when it has all
+ * gone, -EAGAIN if the socket is full, or ERROR.
+ */
+
+static int poll_send(struct httpd_state *pstate)
+{
+  ssize_t nsent;
+
+  while (pstate->ht_pendlen > 0)
+    {
+      nsent = send(pstate->ht_sockfd, pstate->ht_pend + pstate->ht_pendoff,
+                   pstate->ht_pendlen, 0);
+      if (nsent < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          return errno == EAGAIN || errno == EWOULDBLOCK ? -EAGAIN : ERROR;
+        }
+
+      pstate->ht_pendoff += nsent;
+      pstate->ht_pendlen -= nsent;
+    }
+
+  /* Don't hold on to the buffer while the connection is idle */
+
+  free(pstate->ht_pend);
+  pstate->ht_pend     = NULL;
+  pstate->ht_pendoff  = 0;
+  pstate->ht_pendsize = 0;
+
+  while (pstate->ht_datalen > 0)
+    {
+      httpd_dumpbuffer("Outgoing chunk", pstate->ht_dataptr,
+                       pstate->ht_datalen);
+      nsent = send(pstate->ht_sockfd, pstate->ht_dataptr,
+                   pstate->ht_datalen, 0);
+      if (nsent < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          return errno == EAGAIN || errno == EWOULDBLOCK ? -EAGAIN : ERROR;
+        }
+
+      pstate->ht_dataptr += nsent;
+      pstate->ht_datalen -= nsent;
+    }
+
+#ifdef CONFIG_NETUTILS_HTTPD_SENDFILE
+  if (pstate->ht_sendfile)
+    {
+      if (httpd_sendfile_send(pstate->ht_sockfd, &pstate->ht_file) != OK)
+        {
+          return errno == EAGAIN || errno == EWOULDBLOCK ? -EAGAIN : ERROR;
+        }
+    }
+#endif
+
+  return OK;
+}
+
+/* Make progress on one connection.  Returns false once it should be
+ * closed.
+ */
+
+static bool poll_service(struct httpd_state *pstate, short revents,
+                         time_t now)
+{
+  int status = 0;
+  int ret;
+
+  if (revents == 0)
+    {
+#if CONFIG_NETUTILS_HTTPD_TIMEOUT > 0
+      if (now - pstate->ht_active >= CONFIG_NETUTILS_HTTPD_TIMEOUT)
+        {
+          nwarn("WARNING: [%d] timeout\n", pstate->ht_sockfd);
+          return false;
+        }
+#endif
+
+      return true;
+    }
+
+  pstate->ht_active = now;
+
+  if (pstate->ht_connstate == CONN_RECV)
+    {
+      status = poll_recv(pstate);
+    }
+
+  for (; ; )
+    {
+      if (pstate->ht_connstate == CONN_RECV)
+        {
+          if (status == 0)
+            {
+              return true;
+            }
+          else if (status < 0)
+            {
+              return false;
+            }
+
+          /* Start the response, then send what the socket will take */
+
+          if (status >= 400)
+            {
+              ret = httpd_senderror(pstate, status);
+            }
+          else
+            {
+              ret = httpd_sendfile(pstate);
+            }
+
+          if (ret < 0)
+            {
+              /* The response could not be completed */
+
+              return false;
+            }
+
+          pstate->ht_connstate = CONN_SEND;
+        }
+
+      ret = poll_send(pstate);
+      if (ret == -EAGAIN)
+        {
+          return true;
+        }
+
+      if (pstate->ht_fileopen)
+        {
+          httpd_close(&pstate->ht_file);
+          pstate->ht_fileopen = false;
+        }
+
+      if (ret < 0)
+        {
+          nerr("ERROR: [%d] send failed: %d\n", pstate->ht_sockfd, errno);
+          return false;
+        }
+
+#ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
+      if (!pstate->ht_keepalive)
+        {
+          return false;
+        }
 
-      /* End of command processing -- Clean up and exit */
+      /* The next request may already have been received in full, in
+       * which case no further POLLIN will come for it.
+       */
 
-      free(pstate);
+      poll_reset(pstate);
+      status = poll_parse(pstate);
+#else
+      return false;
+#endif
     }
+}
 
-  /* Exit the task */
+static void poll_close(struct httpd_state *pstate)
+{
+  ninfo("[%d] Closing\n", pstate->ht_sockfd);
 
-  ninfo("[%d] Exiting\n", sockfd);
-  close(sockfd);
-  return NULL;
+  if (pstate->ht_fileopen)
+    {
+      httpd_close(&pstate->ht_file);
+    }
+
+  close(pstate->ht_sockfd);
+  free(pstate->ht_pend);
+  free(pstate);
 }
 
-#ifdef CONFIG_NETUTILS_HTTPD_SINGLECONNECT
-static void single_server(uint16_t portno, pthread_startroutine_t handler,
-                          int stacksize)
+/****************************************************************************
+ * Name: poll_server
+ *
+ * Description:
+ *   Serve up to CONFIG_NETUTILS_HTTPD_POLL_MAXCONN connections from the
+ *   calling task.  Each connection steps through receiving its request and
+ *   sending the response as poll() reports the socket ready, so no thread
+ *   is created per connection.
+ *
+ ****************************************************************************/
+
+static void poll_server(uint16_t portno)
 {
+  struct pollfd fds[CONFIG_NETUTILS_HTTPD_POLL_MAXCONN + 1];
+  FAR struct httpd_state *pstate;
   struct sockaddr_in myaddr;
   socklen_t addrlen;
+  time_t now;
   int listensd;
   int acceptsd;
-#ifdef CONFIG_NET_SOLINGER
-  struct linger ling;
-#endif
-#if CONFIG_NETUTILS_HTTPD_TIMEOUT > 0
-  struct timeval tv;
-#endif
+  int ret;
+  int i;
 
   listensd = netlib_listenon(portno);
   if (listensd < 0)
@@ -762,62 +1527,109 @@ static void single_server(uint16_t portno, pthread_startroutine_t handler,
       return;
     }
 
-  /* Begin serving connections */
-
   for (; ; )
     {
-      addrlen = sizeof(struct sockaddr_in);
-      acceptsd = accept(listensd, (FAR struct sockaddr *)&myaddr, &addrlen);
+      /* The listening socket is only polled while there is room for
+       * another connection; the rest wait in the backlog.
+       */
 
-      if (acceptsd < 0)
+      fds[0].fd      = listensd;
+      fds[0].events  = g_nconns < CONFIG_NETUTILS_HTTPD_POLL_MAXCONN ?
+                       POLLIN : 0;
+      fds[0].revents = 0;
+
+      for (i = 0; i < g_nconns; i++)
         {
-          nerr("ERROR: accept failure: %d\n", errno);
+          fds[i + 1].fd      = g_conns[i]->ht_sockfd;
+          fds[i + 1].events  = g_conns[i]->ht_connstate == CONN_RECV ?
+                               POLLIN : POLLOUT;
+          fds[i + 1].revents = 0;
+        }
+
+#if CONFIG_NETUTILS_HTTPD_TIMEOUT > 0
+      ret = poll(fds, g_nconns + 1, g_nconns > 0 ? 1000 : -1);
+#else
+      ret = poll(fds, g_nconns + 1, -1);
+#endif
+      if (ret < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          nerr("ERROR: poll failure: %d\n", errno);
           break;
         }
 
-      ninfo("Connection accepted -- serving sd=%d\n", acceptsd);
+      now = time(NULL);
 
-      /* Configure to "linger" until all data is sent
-       * when the socket is closed
+      /* Walk backwards so that a closed connection can be replaced by the
+       * last one, which has already been serviced.
        */
 
-#ifdef CONFIG_NET_SOLINGER
-      ling.l_onoff  = 1;
-      ling.l_linger = 30;     /* timeout is seconds */
-      if (setsockopt(acceptsd, SOL_SOCKET, SO_LINGER, &ling,
-                     sizeof(struct linger)) < 0)
+      for (i = g_nconns - 1; i >= 0; i--)
         {
-          close(acceptsd);
-          nerr("ERROR: setsockopt SO_LINGER failure: %d\n", errno);
+          if (!poll_service(g_conns[i], fds[i + 1].revents, now))
+            {
+              poll_close(g_conns[i]);
+              g_conns[i] = g_conns[--g_nconns];
+            }
+        }
+
+      if ((fds[0].revents & POLLIN) == 0)
+        {
+          continue;
+        }
+
+      addrlen  = sizeof(struct sockaddr_in);
+      acceptsd = accept(listensd, (FAR struct sockaddr *)&myaddr, &addrlen);
+      if (acceptsd < 0)
+        {
+          if (errno == EINTR || errno == EAGAIN)
+            {
+              continue;
+            }
+
+          nerr("ERROR: accept failure: %d\n", errno);
           break;
         }
-#endif
 
-#if CONFIG_NETUTILS_HTTPD_TIMEOUT > 0
-      /* Set up a receive timeout */
+      pstate = (FAR struct httpd_state *)malloc(sizeof(struct httpd_state));
+      if (pstate == NULL)
+        {
+          nerr("ERROR: [%d] out of memory\n", acceptsd);
+          close(acceptsd);
+          continue;
+        }
 
-      tv.tv_sec  = CONFIG_NETUTILS_HTTPD_TIMEOUT;
-      tv.tv_usec = 0;
-      if (setsockopt(acceptsd, SOL_SOCKET, SO_RCVTIMEO, &tv,
-                     sizeof(struct timeval)) < 0)
+      ret = fcntl(acceptsd, F_GETFL, 0);
+      if (ret < 0 || fcntl(acceptsd, F_SETFL, ret | O_NONBLOCK) < 0)
         {
+          nerr("ERROR: [%d] fcntl failure: %d\n", acceptsd, errno);
+          free(pstate);
           close(acceptsd);
-          nerr("ERROR: setsockopt SO_RCVTIMEO failure: %d\n", errno);
-          break;
+          continue;
         }
-#endif
 
-      /* Handle the request. This blocks until complete. */
+      ninfo("Connection accepted -- serving sd=%d\n", acceptsd);
 
-      httpd_handler((FAR void *)acceptsd);
+      memset(pstate, 0, sizeof(struct httpd_state));
+      pstate->ht_sockfd = acceptsd;
+      pstate->ht_active = now;
+      poll_reset(pstate);
+
+      g_conns[g_nconns++] = pstate;
     }
 
-  /* Close the sockets */
+  while (g_nconns > 0)
+    {
+      poll_close(g_conns[--g_nconns]);
+    }
 
-  close(acceptsd);
   close(listensd);
 }
-#endif
+#endif /* CONFIG_NETUTILS_HTTPD_POLL */
 
 /****************************************************************************
  * Public Functions
@@ -842,8 +1654,10 @@ int httpd_listen(void)
 {
   /* Execute httpd_handler on each connection to port 80 */
 
-#ifdef CONFIG_NETUTILS_HTTPD_SINGLECONNECT
+#if defined(CONFIG_NETUTILS_HTTPD_SINGLECONNECT)
   single_server(HTONS(80), httpd_handler, CONFIG_NETUTILS_HTTPDSTACKSIZE);
+#elif defined(CONFIG_NETUTILS_HTTPD_POLL)
+  poll_server(HTONS(80));
 #else
   netlib_server(HTONS(80), httpd_handler, CONFIG_NETUTILS_HTTPDSTACKSIZE);
 #endif
@@ -871,24 +1685,13 @@ int httpd_send_datachunk(int sockfd, void *data, int len, bool chunked)
     {
       int chunked_info_len = snprintf(chunked_info, HTTPD_MAX_CHUNKEDLEN,
            "%X\r\n", len);
-      ret = send(sockfd, chunked_info, chunked_info_len, 0);
-      DEBUGASSERT(ret == chunked_info_len);
+      ret = httpd_send_all(sockfd, chunked_info, chunked_info_len);
     }
 #endif
 
   if (ret >= 0)
     {
-      if (len == 0)
-        {
-          /* Lower layer does not tolerate buf = NULL even if len = 0
-           * so just pass a dummy pointer.
-           */
-
-          data = &len;
-        }
-
-      ret = send(sockfd, data, len, 0);
-      DEBUGASSERT(ret == len);
+      ret = httpd_send_all(sockfd, data, len);
     }
 
 #if defined(CONFIG_NETUTILS_HTTPD_ENABLE_CHUNKED_ENCODING)
@@ -898,8 +1701,7 @@ int httpd_send_datachunk(int sockfd, void *data, int len, bool chunked)
     {
       if (chunked)
         {
-          ret = send(sockfd, "\r\n", 2, 0);
-          DEBUGASSERT(ret == 2);
+          ret = httpd_send_all(sockfd, "\r\n", 2);
         }
     }
 #endif
@@ -913,151 +1715,9 @@ int httpd_send_datachunk(int sockfd, void *data, int len, bool chunked)
 
 int httpd_send_headers(struct httpd_state *pstate, int status, int len)
 {
-  const char *mime;
-  const char *ptr;
-  char contentlen[HTTPD_MAX_CONTENTLEN] =
-    {
-      0
-    };
-
   char header[HTTPD_MAX_HEADERLEN];
   int hdrlen;
-  int i;
-
-  static const struct
-  {
-    const char *ext;
-    const char *mime;
-  }
-
-  a[] =
-    {
-#ifndef CONFIG_NETUTILS_HTTPD_SCRIPT_DISABLE
-    {
-      "shtml", "text/html"
-    },
-#endif
-
-    {
-      "html",  "text/html"
-    },
-
-    {
-      "css",   "text/css"
-    },
-
-    {
-      "txt",   "text/plain"
-    },
-
-    {
-      "json",  "application/json"
-    },
-
-    {
-      "js",    "text/javascript"
-    },
-
-    {
-      "png",   "image/png"
-    },
-
-    {
-      "gif",   "image/gif"
-    },
-
-    {
-      "jpeg",  "image/jpeg"
-    },
-
-    {
-      "jpg",   "image/jpeg"
-    },
-
-    {
-      "mp3",   "audio/mpeg"
-    },
-    };
-
-  ptr = strrchr(pstate->ht_filename, ISO_PERIOD);
-  if (ptr == NULL)
-    {
-      mime = "application/octet-stream";
-    }
-  else
-    {
-      mime = "text/plain";
-
-      for (i = 0; i < sizeof a / sizeof *a; i++)
-        {
-          if (strncmp(a[i].ext, ptr + 1, strlen(a[i].ext)) == 0)
-            {
-              mime = a[i].mime;
-              break;
-            }
-        }
-    }
-
-#ifdef CONFIG_NETUTILS_HTTPD_DIRLIST
-  if (false == httpd_is_file(pstate->ht_filename))
-    {
-      /* we assume that it's a directory */
-
-      mime = "text/html";
-    }
-#endif
-
-  if (len >= 0)
-    {
-      snprintf(contentlen, HTTPD_MAX_CONTENTLEN,
-               "Content-Length: %d\r\n", len);
-    }
-  else
-    {
-#ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
-      /* Length unknown ahead of time */
-
-      pstate->ht_keepalive = false;
-#endif
-#if defined(CONFIG_NETUTILS_HTTPD_ENABLE_CHUNKED_ENCODING)
-      /* Turn on chunked encoding */
-
-      snprintf(contentlen, HTTPD_MAX_CONTENTLEN,
-               "Transfer-Encoding: chunked\r\n");
-      pstate->ht_chunked = true;
-#endif
-    }
-
-  if (status == 413)
-    {
-      /* TODO: here we "SHOULD" include a Retry-After header */
-    }
-
-  /* Construct the header.
-   *
-   * REVISIT:  Wouldn't asprintf be a better option than a large stack
-   * array?
-   */
-
-  hdrlen = snprintf(header, HTTPD_MAX_HEADERLEN,
-                    "HTTP/1.0 %d %s\r\n"
-#ifndef CONFIG_NETUTILS_HTTPD_SERVERHEADER_DISABLE
-                    "Server: uIP/NuttX http://nuttx.org/\r\n"
-#endif
-                    "Connection: %s\r\n"
-                    "Content-type: %s\r\n"
-                    "%s"
-                    "\r\n",
-                    status,
-                    status >= 400 ? "Error" : "OK",
-#ifndef CONFIG_NETUTILS_HTTPD_KEEPALIVE_DISABLE
-                    pstate->ht_keepalive ? "keep-alive" : "close",
-#else
-                    "close",
-#endif
-                    mime,
-                    contentlen
-                    );
 
+  hdrlen = httpd_format_headers(pstate, status, len, header);
   return send_chunk(pstate, header, hdrlen);
 }
@@ -62,6 +62,12 @@
 
 int httpd_sendfile_open(const char *name, struct httpd_fs_file *file);
 int httpd_sendfile_close(struct httpd_fs_file *file);
+
+/* httpd_sendfile_send() keeps its progress in file->offset.  If the socket
+ * is non-blocking it returns ERROR with errno set to EAGAIN when the socket
+ * is full; calling it again resumes the transfer.
+ */
+
 int httpd_sendfile_send(int outfd, struct httpd_fs_file *file);
 
 #elif defined(CONFIG_NETUTILS_HTTPD_MMAP)
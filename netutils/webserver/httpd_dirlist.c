@@ -97,6 +97,32 @@
   "</body>\n" \
   "</html>\n"
 
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: httpd_dirlist_write
+ *
+ * Description:
+ *   Send one piece of the listing through httpd_send_datachunk(), so that
+ *   a full socket in CONFIG_NETUTILS_HTTPD_POLL mode is handled by the
+ *   server loop.  Returns the length sent or -1.
+ *
+ ****************************************************************************/
+
+static ssize_t httpd_dirlist_write(int outfd, FAR char *str)
+{
+  int len = strlen(str);
+
+  if (httpd_send_datachunk(outfd, str, len, false) < 0)
+    {
+      return -1;
+    }
+
+  return len;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -168,7 +194,7 @@ ssize_t httpd_dirlist(int outfd, FAR struct httpd_fs_file *file)
                path, path);
     }
 
-  ret = write(outfd, tmp, strlen(tmp));
+  ret = httpd_dirlist_write(outfd, tmp);
 
   if (-1 == ret)
     {
@@ -228,7 +254,7 @@ ssize_t httpd_dirlist(int outfd, FAR struct httpd_fs_file *file)
                    );
         }
 
-      ret = write(outfd, tmp, strlen(tmp));
+      ret = httpd_dirlist_write(outfd, tmp);
 
       if (-1 == ret)
         {
@@ -251,7 +277,7 @@ errout_with_hdr:
            info.machine,
            BOARD_NAME);
 
-  ret = write(outfd, tmp, strlen(tmp));
+  ret = httpd_dirlist_write(outfd, tmp);
 
   if (-1 != ret)
     {
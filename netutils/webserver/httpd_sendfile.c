@@ -81,7 +81,8 @@ int httpd_sendfile_open(const char *name, struct httpd_fs_file *file)
       return ERROR;
     }
 
-  file->len = (int) st.st_size;
+  file->len    = (int) st.st_size;
+  file->offset = 0;
 
   if (S_ISDIR(st.st_mode))
     {
@@ -139,9 +140,33 @@ int httpd_sendfile_send(int outfd, struct httpd_fs_file *file)
     }
 #endif
 
-  if (-1 == sendfile(outfd, file->fd, 0, file->len))
+  /* Continue from wherever an earlier call stopped.  On a non-blocking
+   * socket this fails with EAGAIN once the socket is full and may be
+   * called again when it becomes writable.
+   */
+
+  while (file->offset < file->len)
     {
-      return ERROR;
+      ssize_t nsent;
+
+      nsent = sendfile(outfd, file->fd, &file->offset,
+                       file->len - file->offset);
+      if (nsent < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          return ERROR;
+        }
+      else if (nsent == 0)
+        {
+          /* The file is shorter than it was when it was opened */
+
+          errno = EIO;
+          return ERROR;
+        }
     }
 
   return OK;
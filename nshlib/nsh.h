@@ -32,7 +32,9 @@
 #include <stdio.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <time.h>
 #include <unistd.h>
+#include <spawn.h>
 #include <errno.h>
 
 #ifdef CONFIG_NSH_STRERROR
@@ -58,6 +60,13 @@
 #ifndef CONFIG_FILE_STREAM
 #  undef CONFIG_NSH_FILE_APPS
 #  undef CONFIG_NSH_CMDPARMS
+#  undef CONFIG_NSH_SCRIPT_CACHE
+#endif
+
+/* Pipeline stages run on cloned front-ends, like background commands */
+
+#if defined(CONFIG_NSH_DISABLEBG) || !defined(CONFIG_FILE_STREAM)
+#  undef CONFIG_NSH_PIPELINE
 #endif
 
 /* rmdir, mkdir, rm, and mv are only available if mountpoints are enabled
@@ -70,11 +79,12 @@
 #  define NSH_HAVE_DIROPTS 1
 #endif
 
-/* If CONFIG_NSH_CMDPARMS is selected, then the path to a directory to
- * hold temporary files must be provided.
+/* If CONFIG_NSH_CMDPARMS is selected without pipeline support, then the
+ * path to a directory to hold temporary files must be provided.
  */
 
-#if defined(CONFIG_NSH_CMDPARMS) && !defined(CONFIG_LIBC_TMPDIR)
+#if defined(CONFIG_NSH_CMDPARMS) && !defined(CONFIG_NSH_PIPELINE) && \
+    !defined(CONFIG_LIBC_TMPDIR)
 #  define CONFIG_LIBC_TMPDIR "/tmp"
 #endif
 
@@ -548,6 +558,7 @@
 #define NSH_HAVE_FOREACH_DIRENTRY 1
 #define NSH_HAVE_TRIMDIR          1
 #define NSH_HAVE_TRIMSPACES       1
+#define NSH_HAVE_XFERSTATS        1
 
 #if !defined(CONFIG_FS_PROCFS) || defined(CONFIG_DISABLE_ENVIRON) || \
      defined(CONFIG_FS_PROCFS_EXCLUDE_ENVIRON) || !defined(NSH_HAVE_CATFILE)
@@ -593,6 +604,14 @@
 #  undef NSH_HAVE_TRIMSPACES
 #endif
 
+/* nsh_xferstats used by the dd and cp commands */
+
+#if (defined(CONFIG_NSH_DISABLE_DD) || \
+     !defined(CONFIG_NSH_CMDOPT_DD_STATS)) && \
+    (defined(CONFIG_NSH_DISABLE_CP) || !defined(CONFIG_NSH_CMDOPT_CP_STATS))
+#  undef NSH_HAVE_XFERSTATS
+#endif
+
 #ifndef CONFIG_NSH_DISABLESCRIPT
 #  define NSH_NP_SET_OPTIONS "ex"    /* Maintain order see nsh_npflags_e */
 #  define NSH_NP_SET_OPTIONS_INIT    (NSH_PFLAG_SILENT)
@@ -680,6 +699,25 @@ enum nsh_npflags_e
 };
 #endif
 
+/* This structure describes where a command takes its standard input from
+ * and sends its standard output to.  An output file takes precedence over
+ * an output file descriptor; -1 means that the stream is not redirected.
+ */
+
+struct nsh_param_s
+{
+  int fd_in;                  /* Standard input descriptor */
+  int fd_out;                 /* Standard output descriptor */
+  int oflags;                 /* Open flags of file_out */
+  FAR const char *file_out;   /* Standard output file */
+};
+
+/* A script held in memory, see nsh_script.c */
+
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+struct nsh_script_s;
+#endif
+
 /* These structure provides the overall state of the parser */
 
 struct nsh_parser_s
@@ -700,6 +738,10 @@ struct nsh_parser_s
 
 #ifndef CONFIG_NSH_DISABLESCRIPT
   FILE    *np_stream;   /* Stream of current script */
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+  FAR struct nsh_script_s *np_script; /* Current script held in memory */
+  long     np_spos;     /* Offset of the next line in np_script */
+#endif
 #ifndef CONFIG_NSH_DISABLE_LOOPS
   long     np_foffs;    /* File offset to the beginning of a line */
 #ifndef NSH_DISABLE_SEMICOLON
@@ -859,14 +901,19 @@ int nsh_telnetlogin(FAR struct console_stdio_s *pstate);
 
 int nsh_command(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char *argv[]);
 
+#if defined(CONFIG_NSH_BUILTIN_APPS) || defined(CONFIG_NSH_FILE_APPS)
+int nsh_fileactions(FAR posix_spawn_file_actions_t *actions,
+                    FAR const struct nsh_param_s *param);
+#endif
+
 #ifdef CONFIG_NSH_BUILTIN_APPS
 int nsh_builtin(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
-                FAR char **argv, FAR const char *redirfile, int oflags);
+                FAR char **argv, FAR const struct nsh_param_s *param);
 #endif
 
 #ifdef CONFIG_NSH_FILE_APPS
 int nsh_fileapp(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
-                FAR char **argv, FAR const char *redirfile, int oflags);
+                FAR char **argv, FAR const struct nsh_param_s *param);
 #endif
 
 #ifndef CONFIG_DISABLE_ENVIRON
@@ -1316,6 +1363,25 @@ int nsh_writefile(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
                   FAR const char *filepath);
 #endif
 
+/****************************************************************************
+ * Name: nsh_xferstats
+ *
+ * Description:
+ *   Report the size, duration and throughput of a completed copy in the
+ *   style of GNU dd, e.g. "1048576 bytes copied, 0.104857 s, 10.00 MB/s".
+ *
+ * Input Parameters:
+ *   vtbl   - The console vtable
+ *   nbytes - The number of bytes copied
+ *   start  - The CLOCK_MONOTONIC time at which the copy started
+ *
+ ****************************************************************************/
+
+#ifdef NSH_HAVE_XFERSTATS
+void nsh_xferstats(FAR struct nsh_vtbl_s *vtbl, uint64_t nbytes,
+                   FAR const struct timespec *start);
+#endif
+
 /****************************************************************************
  * Name: nsh_foreach_direntry
  *
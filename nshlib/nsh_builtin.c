@@ -67,14 +67,34 @@
  ****************************************************************************/
 
 int nsh_builtin(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
-                FAR char **argv, FAR const char *redirfile, int oflags)
+                FAR char **argv, FAR const struct nsh_param_s *param)
 {
 #if !defined(CONFIG_NSH_DISABLEBG) && defined(CONFIG_SCHED_CHILD_STATUS)
   struct sigaction act;
   struct sigaction old;
 #endif
+  posix_spawn_file_actions_t file_actions;
   int ret = OK;
 
+  /* Set up the redirection of the standard input and output.  These
+   * return a positive errno value on failure.
+   */
+
+  ret = posix_spawn_file_actions_init(&file_actions);
+  if (ret != 0)
+    {
+      errno = ret;
+      return ERROR;
+    }
+
+  ret = nsh_fileactions(&file_actions, param);
+  if (ret != 0)
+    {
+      posix_spawn_file_actions_destroy(&file_actions);
+      errno = ret;
+      return ERROR;
+    }
+
   /* Lock the scheduler in an attempt to prevent the application from
    * running until waitpid() has been called.
    */
@@ -99,7 +119,7 @@ int nsh_builtin(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
    * applications.
    */
 
-  ret = exec_builtin(cmd, argv, redirfile, oflags);
+  ret = exec_builtin(cmd, argv, &file_actions);
   if (ret >= 0)
     {
       /* The application was successfully started with pre-emption disabled.
@@ -244,6 +264,7 @@ int nsh_builtin(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
     }
 
   sched_unlock();
+  posix_spawn_file_actions_destroy(&file_actions);
 
   /* If exec_builtin() or waitpid() failed, then return -1 (ERROR) with the
    * errno value set appropriately.
@@ -243,6 +243,10 @@ static int cmd_codecs_proc(FAR struct nsh_vtbl_s *vtbl, int argc,
   FAR unsigned char *src;
   FAR char *dest;
 #endif
+#if defined(HAVE_CODECS_BASE64ENC) || defined(HAVE_CODECS_BASE64DEC)
+  struct base64_context_s b64ctx;
+  ssize_t b64len;
+#endif
 
   FAR char *localfile = NULL;
   FAR char *srcbuf = NULL;
@@ -372,6 +376,24 @@ static int cmd_codecs_proc(FAR struct nsh_vtbl_s *vtbl, int argc,
           goto errout;
         }
 
+      /* Base64 goes through the incremental interfaces, so that groups
+       * may span reads and line breaks in the input are skipped.
+       */
+
+#ifdef HAVE_CODECS_BASE64ENC
+      if (mode == CODEC_MODE_BASE64ENC)
+        {
+          base64_encode_init(&b64ctx, iswebsafe);
+        }
+#endif
+
+#ifdef HAVE_CODECS_BASE64DEC
+      if (mode == CODEC_MODE_BASE64DEC)
+        {
+          base64_decode_init(&b64ctx, iswebsafe);
+        }
+#endif
+
       while (true)
         {
           memset(srcbuf, 0, srclen + 2);
@@ -402,6 +424,24 @@ static int cmd_codecs_proc(FAR struct nsh_vtbl_s *vtbl, int argc,
 
 #endif
           memset(destbuf, 0, buflen);
+#ifdef HAVE_CODECS_BASE64ENC
+          if (mode == CODEC_MODE_BASE64ENC)
+            {
+              b64len = base64_encode_update(&b64ctx, srcbuf, ret, destbuf);
+              destbuf[b64len] = '\0';
+              nsh_output(vtbl, "%s", destbuf);
+            }
+          else
+#endif
+#ifdef HAVE_CODECS_BASE64DEC
+          if (mode == CODEC_MODE_BASE64DEC)
+            {
+              b64len = base64_decode_update(&b64ctx, srcbuf, ret, destbuf);
+              destbuf[b64len] = '\0';
+              nsh_output(vtbl, "%s", destbuf);
+            }
+          else
+#endif
           if (func)
             {
 #ifdef HAVE_CODECS_HASH_MD5
@@ -420,6 +460,32 @@ static int cmd_codecs_proc(FAR struct nsh_vtbl_s *vtbl, int argc,
           buflen = calc_codec_buffsize(srclen + 2, mode);
         }
 
+#ifdef HAVE_CODECS_BASE64ENC
+      if (mode == CODEC_MODE_BASE64ENC)
+        {
+          b64len = base64_encode_final(&b64ctx, destbuf);
+          destbuf[b64len] = '\0';
+          nsh_output(vtbl, "%s", destbuf);
+        }
+#endif
+
+#ifdef HAVE_CODECS_BASE64DEC
+      if (mode == CODEC_MODE_BASE64DEC)
+        {
+          b64len = base64_decode_final(&b64ctx, destbuf);
+          if (b64len < 0)
+            {
+              nsh_error(vtbl, g_fmtcmdfailed, argv[0], "decode",
+                        NSH_ERRNO_OF(-b64len));
+              ret = ERROR;
+              goto exit;
+            }
+
+          destbuf[b64len] = '\0';
+          nsh_output(vtbl, "%s", destbuf);
+        }
+#endif
+
 #ifdef HAVE_CODECS_HASH_MD5
       if (mode == CODEC_MODE_HASH_MD5)
         {
@@ -156,7 +156,7 @@ static const struct cmdmap_s g_cmdmap[] =
 
 #ifndef CONFIG_NSH_DISABLE_DD
   { "dd",       cmd_dd,       3, 7,
-    "if=<infile> of=<outfile> [bs=<sectsize>] [count=<sectors>] "
+    "if=<infile> of=<outfile> [bs=<sectsize>[k|M]] [count=<sectors>] "
     "[skip=<sectors>] [verify]" },
 # endif
 
@@ -30,6 +30,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
@@ -37,6 +38,12 @@
 #include <errno.h>
 #include <time.h>
 
+#ifdef CONFIG_NSH_CMDOPT_DD_THREAD
+#  include <pthread.h>
+#  include <sched.h>
+#  include <semaphore.h>
+#endif
+
 #include "nsh.h"
 #include "nsh_console.h"
 
@@ -52,6 +59,17 @@
 
 #define DEFAULT_SECTSIZE 512
 
+/* The largest BS= accepted.  read() and write() report a sector's length
+ * as an ssize_t, and with CONFIG_NSH_CMDOPT_DD_THREAD two sectors are
+ * allocated in one block.
+ */
+
+#ifdef CONFIG_NSH_CMDOPT_DD_THREAD
+#  define MAX_SECTSIZE (SSIZE_MAX / 2)
+#else
+#  define MAX_SECTSIZE SSIZE_MAX
+#endif
+
 /* At present, piping of input and output are not support, i.e., both of=
  * and if= arguments are required.
  */
@@ -62,6 +80,19 @@
  * Private Types
  ****************************************************************************/
 
+#ifdef CONFIG_NSH_CMDOPT_DD_THREAD
+/* With CONFIG_NSH_CMDOPT_DD_THREAD, a reader thread fills two of these
+ * buffers in turn while the dd command itself writes them out in the same
+ * order.  A buffer with no data marks the end of the transfer.
+ */
+
+struct dd_buffer_s
+{
+  FAR uint8_t *data;       /* One sector of data */
+  size_t       nbytes;     /* Number of valid bytes in data[] */
+};
+#endif
+
 struct dd_s
 {
   FAR struct nsh_vtbl_s *vtbl;
@@ -70,11 +101,19 @@ struct dd_s
   int          outfd;      /* File descriptor of the output device */
   uint32_t     nsectors;   /* Number of sectors to transfer */
   uint32_t     skip;       /* The number of sectors skipped on input */
+  uint32_t     sector;     /* The number of sectors transferred */
+  uint64_t     total;      /* The number of bytes transferred */
   bool         eof;        /* true: The end of the input or output file has been hit */
   bool         verify;     /* true: Verify infile and outfile correctness */
-  uint16_t     sectsize;   /* Size of one sector */
-  uint16_t     nbytes;     /* Number of valid bytes in the buffer */
+  size_t       sectsize;   /* Size of one sector */
+  size_t       nbytes;     /* Number of valid bytes in the buffer */
   FAR uint8_t *buffer;     /* Buffer of data to write to the output file */
+#ifdef CONFIG_NSH_CMDOPT_DD_THREAD
+  struct dd_buffer_s bufs[2];
+  sem_t        empty;      /* Counts the buffers the reader may fill */
+  sem_t        full;       /* Counts the buffers waiting to be written */
+  volatile bool abort;     /* true: Writing failed, the reader must stop */
+#endif
 };
 
 /****************************************************************************
@@ -91,64 +130,253 @@ static const char g_dd[] = "dd";
  * Name: dd_write
  ****************************************************************************/
 
-static int dd_write(FAR struct dd_s *dd)
+static int dd_write(FAR struct dd_s *dd, FAR const uint8_t *buffer,
+                    size_t nbytes)
 {
-  FAR uint8_t *buffer = dd->buffer;
-  uint16_t written ;
-  ssize_t nbytes;
+  size_t written;
+  ssize_t ret;
 
   /* Is the out buffer full (or is this the last one)? */
 
   written = 0;
   do
     {
-      nbytes = write(dd->outfd, buffer, dd->nbytes - written);
-      if (nbytes < 0)
+      ret = write(dd->outfd, buffer, nbytes - written);
+      if (ret < 0)
         {
           FAR struct nsh_vtbl_s *vtbl = dd->vtbl;
-          nsh_error(vtbl, g_fmtcmdfailed, g_dd, "write",
-                    NSH_ERRNO_OF(-nbytes));
+          nsh_error(vtbl, g_fmtcmdfailed, g_dd, "write", NSH_ERRNO);
           return ERROR;
         }
 
-      written += nbytes;
-      buffer  += nbytes;
+      written += ret;
+      buffer  += ret;
     }
-  while (written < dd->nbytes);
+  while (written < nbytes);
 
+  dd->total += nbytes;
   return OK;
 }
 
 /****************************************************************************
  * Name: dd_read
+ *
+ * Description:
+ *   Read up to one sector into 'buffer', returning the number of bytes
+ *   read in 'nbytes'.  Zero bytes means that the end of the input has been
+ *   reached.
+ *
  ****************************************************************************/
 
-static int dd_read(FAR struct dd_s *dd)
+static int dd_read(FAR struct dd_s *dd, FAR uint8_t *buffer,
+                   FAR size_t *nbytes)
 {
-  FAR uint8_t *buffer = dd->buffer;
-  ssize_t nbytes;
+  ssize_t ret;
 
-  dd->nbytes = 0;
+  *nbytes = 0;
   do
     {
-      nbytes = read(dd->infd, buffer, dd->sectsize - dd->nbytes);
-      if (nbytes < 0)
+      ret = read(dd->infd, buffer, dd->sectsize - *nbytes);
+      if (ret < 0)
         {
           FAR struct nsh_vtbl_s *vtbl = dd->vtbl;
-          nsh_error(vtbl, g_fmtcmdfailed, g_dd, "read",
-                    NSH_ERRNO_OF(-nbytes));
+          nsh_error(vtbl, g_fmtcmdfailed, g_dd, "read", NSH_ERRNO);
           return ERROR;
         }
 
-      dd->nbytes += nbytes;
-      buffer     += nbytes;
+      *nbytes += ret;
+      buffer  += ret;
     }
-  while (dd->nbytes < dd->sectsize && nbytes > 0);
+  while (*nbytes < dd->sectsize && ret > 0);
 
-  dd->eof |= (dd->nbytes == 0);
+  dd->eof |= (*nbytes == 0);
   return OK;
 }
 
+/****************************************************************************
+ * Name: dd_copy
+ *
+ * Description:
+ *   Copy sectors from the input to the output one at a time.
+ *
+ ****************************************************************************/
+
+#ifndef CONFIG_NSH_CMDOPT_DD_THREAD
+static int dd_copy(FAR struct dd_s *dd)
+{
+  int ret;
+
+  while (!dd->eof && dd->sector < dd->nsectors)
+    {
+      /* Read one sector from from the input */
+
+      ret = dd_read(dd, dd->buffer, &dd->nbytes);
+      if (ret < 0)
+        {
+          return ret;
+        }
+
+      /* Has the incoming data stream ended? */
+
+      if (!dd->eof)
+        {
+          /* Write one sector to the output file */
+
+          ret = dd_write(dd, dd->buffer, dd->nbytes);
+          if (ret < 0)
+            {
+              return ret;
+            }
+
+          /* Increment the sector number */
+
+          dd->sector++;
+        }
+    }
+
+  return OK;
+}
+#else
+
+/****************************************************************************
+ * Name: dd_semwait
+ ****************************************************************************/
+
+static void dd_semwait(FAR sem_t *sem)
+{
+  while (sem_wait(sem) < 0)
+    {
+      DEBUGASSERT(errno == EINTR || errno == ECANCELED);
+    }
+}
+
+/****************************************************************************
+ * Name: dd_reader
+ *
+ * Description:
+ *   The reader thread.  Fills the buffers in turn until the end of the
+ *   input, the sector count or a read error, and then hands over one empty
+ *   buffer to stop the writer.
+ *
+ ****************************************************************************/
+
+static pthread_addr_t dd_reader(pthread_addr_t arg)
+{
+  FAR struct dd_s *dd = (FAR struct dd_s *)arg;
+  FAR struct dd_buffer_s *buf;
+  uint32_t sector = 0;
+  int ret = OK;
+  int i = 0;
+
+  do
+    {
+      dd_semwait(&dd->empty);
+      if (dd->abort)
+        {
+          break;
+        }
+
+      buf = &dd->bufs[i];
+      buf->nbytes = 0;
+
+      if (sector < dd->nsectors)
+        {
+          ret = dd_read(dd, buf->data, &buf->nbytes);
+          if (ret < 0)
+            {
+              buf->nbytes = 0;
+            }
+        }
+
+      sem_post(&dd->full);
+      sector++;
+      i ^= 1;
+    }
+  while (buf->nbytes > 0);
+
+  return (pthread_addr_t)(intptr_t)ret;
+}
+
+/****************************************************************************
+ * Name: dd_copy
+ *
+ * Description:
+ *   Copy sectors from the input to the output, reading the next sector on
+ *   a separate thread while the current one is written.
+ *
+ ****************************************************************************/
+
+static int dd_copy(FAR struct dd_s *dd)
+{
+  FAR struct nsh_vtbl_s *vtbl = dd->vtbl;
+  FAR struct dd_buffer_s *buf;
+  struct sched_param param;
+  pthread_attr_t attr;
+  pthread_addr_t value;
+  pthread_t reader;
+  int ret;
+  int i;
+
+  sem_init(&dd->empty, 0, 2);
+  sem_init(&dd->full, 0, 0);
+  sem_setprotocol(&dd->empty, SEM_PRIO_NONE);
+  sem_setprotocol(&dd->full, SEM_PRIO_NONE);
+  dd->abort = false;
+
+  /* Run the reader at the priority of the shell */
+
+  sched_getparam(0, &param);
+  pthread_attr_init(&attr);
+  pthread_attr_setschedpolicy(&attr, SCHED_NSH);
+  pthread_attr_setschedparam(&attr, &param);
+
+  ret = pthread_create(&reader, &attr, dd_reader, dd);
+  pthread_attr_destroy(&attr);
+  if (ret != 0)
+    {
+      nsh_error(vtbl, g_fmtcmdfailed, g_dd, "pthread_create",
+                NSH_ERRNO_OF(ret));
+      ret = ERROR;
+      goto errout;
+    }
+
+  for (i = 0; ; i ^= 1)
+    {
+      dd_semwait(&dd->full);
+
+      buf = &dd->bufs[i];
+      if (buf->nbytes == 0)
+        {
+          break;
+        }
+
+      ret = dd_write(dd, buf->data, buf->nbytes);
+      if (ret < 0)
+        {
+          /* Wake up the reader so that it sees the abort */
+
+          dd->abort = true;
+          sem_post(&dd->empty);
+          break;
+        }
+
+      dd->sector++;
+      sem_post(&dd->empty);
+    }
+
+  pthread_join(reader, &value);
+  if (ret == OK)
+    {
+      ret = (int)(intptr_t)value;
+    }
+
+errout:
+  sem_destroy(&dd->full);
+  sem_destroy(&dd->empty);
+  return ret;
+}
+#endif
+
 /****************************************************************************
  * Name: dd_infopen
  ****************************************************************************/
@@ -191,7 +419,7 @@ static int dd_verify(FAR const char *infile, FAR const char *outfile,
   int sector = 0;
   int ret = OK;
 
-  ret = lseek(dd->infd, dd->skip ? dd->skip * dd->sectsize : 0, SEEK_SET);
+  ret = lseek(dd->infd, (off_t)dd->skip * dd->sectsize, SEEK_SET);
   if (ret < 0)
     {
       nsh_error(dd->vtbl, g_fmtcmdfailed, g_dd, "lseek", NSH_ERRNO);
@@ -214,14 +442,14 @@ static int dd_verify(FAR const char *infile, FAR const char *outfile,
 
   while (!dd->eof && sector < dd->nsectors)
     {
-      ret = dd_read(dd);
+      ret = dd_read(dd, dd->buffer, &dd->nbytes);
       if (ret < 0)
         {
           break;
         }
 
       ret = read(dd->outfd, buffer, dd->nbytes);
-      if (ret != dd->nbytes)
+      if (ret != (ssize_t)dd->nbytes)
         {
           nsh_error(dd->vtbl, g_fmtcmdfailed, g_dd, "read", NSH_ERRNO);
           break;
@@ -278,6 +506,53 @@ static int dd_verify(FAR const char *infile, FAR const char *outfile,
   return ret;
 }
 
+/****************************************************************************
+ * Name: dd_getnum
+ *
+ * Description:
+ *   Convert a numeric argument with an optional binary multiplier suffix:
+ *   'k' or 'K' for 1024 and 'M' for 1024 * 1024.
+ *
+ ****************************************************************************/
+
+static int dd_getnum(FAR const char *str, FAR uint32_t *value)
+{
+  FAR char *endptr;
+  unsigned long num;
+  unsigned long mult = 1;
+
+  num = strtoul(str, &endptr, 0);
+  if (endptr == str)
+    {
+      return ERROR;
+    }
+
+  switch (*endptr)
+    {
+      case 'k':
+      case 'K':
+        mult = 1024;
+        endptr++;
+        break;
+
+      case 'M':
+        mult = 1024 * 1024;
+        endptr++;
+        break;
+
+      default:
+        break;
+    }
+
+  if (*endptr != '\0' || num > UINT32_MAX / mult)
+    {
+      return ERROR;
+    }
+
+  *value = num * mult;
+  return OK;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -292,12 +567,9 @@ int cmd_dd(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv)
   FAR char *infile = NULL;
   FAR char *outfile = NULL;
 #ifdef CONFIG_NSH_CMDOPT_DD_STATS
-  struct timespec ts0;
-  struct timespec ts1;
-  uint64_t elapsed;
-  uint64_t total;
+  struct timespec start;
 #endif
-  uint32_t sector = 0;
+  uint32_t sectsize = DEFAULT_SECTSIZE;
   int ret = ERROR;
   int i;
 
@@ -305,7 +577,6 @@ int cmd_dd(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv)
 
   memset(&dd, 0, sizeof(struct dd_s));
   dd.vtbl      = vtbl;              /* For nsh_output */
-  dd.sectsize  = DEFAULT_SECTSIZE;  /* Sector size if 'bs=' not provided */
   dd.nsectors  = 0xffffffff;        /* MAX_UINT32 */
 
   /* If no IF= option is provided on the command line, then read
@@ -348,15 +619,28 @@ int cmd_dd(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv)
         }
       else if (strncmp(argv[i], "bs=", 3) == 0)
         {
-          dd.sectsize = atoi(&argv[i][3]);
+          if (dd_getnum(&argv[i][3], &sectsize) < 0 || sectsize == 0 ||
+              sectsize > MAX_SECTSIZE)
+            {
+              nsh_error(vtbl, g_fmtarginvalid, g_dd);
+              goto errout_with_paths;
+            }
         }
       else if (strncmp(argv[i], "count=", 6) == 0)
         {
-          dd.nsectors = atoi(&argv[i][6]);
+          if (dd_getnum(&argv[i][6], &dd.nsectors) < 0)
+            {
+              nsh_error(vtbl, g_fmtarginvalid, g_dd);
+              goto errout_with_paths;
+            }
         }
       else if (strncmp(argv[i], "skip=", 5) == 0)
         {
-          dd.skip = atoi(&argv[i][5]);
+          if (dd_getnum(&argv[i][5], &dd.skip) < 0)
+            {
+              nsh_error(vtbl, g_fmtarginvalid, g_dd);
+              goto errout_with_paths;
+            }
         }
       else if (strncmp(argv[i], "verify", 6) == 0)
         {
@@ -372,9 +656,18 @@ int cmd_dd(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv)
     }
 #endif
 
-  /* Allocate the I/O buffer */
+  /* Allocate the I/O buffer.  Large block sizes let each read() and
+   * write() move several sectors at once.
+   */
 
+  dd.sectsize = sectsize;
+#ifdef CONFIG_NSH_CMDOPT_DD_THREAD
+  dd.buffer = malloc(2 * dd.sectsize);
+  dd.bufs[0].data = dd.buffer;
+  dd.bufs[1].data = dd.buffer + dd.sectsize;
+#else
   dd.buffer = malloc(dd.sectsize);
+#endif
   if (!dd.buffer)
     {
       nsh_error(vtbl, g_fmtcmdoutofmemory, g_dd);
@@ -386,7 +679,7 @@ int cmd_dd(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv)
   ret = dd_infopen(infile, &dd);
   if (ret < 0)
     {
-      goto errout_with_paths;
+      goto errout_with_buffer;
     }
 
   /* Open the output file */
@@ -400,13 +693,12 @@ int cmd_dd(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv)
   /* Then perform the data transfer */
 
 #ifdef CONFIG_NSH_CMDOPT_DD_STATS
-  clock_gettime(CLOCK_MONOTONIC, &ts0);
+  clock_gettime(CLOCK_MONOTONIC, &start);
 #endif
 
   if (dd.skip)
     {
-      ret = lseek(dd.infd, dd.skip * dd.sectsize, SEEK_SET);
-      if (ret < -1)
+      if (lseek(dd.infd, (off_t)dd.skip * dd.sectsize, SEEK_SET) < 0)
         {
           nsh_error(vtbl, g_fmtcmdfailed, g_dd, "lseek", NSH_ERRNO);
           ret = ERROR;
@@ -414,53 +706,17 @@ int cmd_dd(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv)
         }
     }
 
-  while (!dd.eof && sector < dd.nsectors)
+  ret = dd_copy(&dd);
+  if (ret < 0)
     {
-      /* Read one sector from from the input */
-
-      ret = dd_read(&dd);
-      if (ret < 0)
-        {
-          goto errout_with_outf;
-        }
-
-      /* Has the incoming data stream ended? */
-
-      if (!dd.eof)
-        {
-          /* Write one sector to the output file */
-
-          ret = dd_write(&dd);
-          if (ret < 0)
-            {
-              goto errout_with_outf;
-            }
-
-          /* Increment the sector number */
-
-          sector++;
-        }
+      goto errout_with_outf;
     }
 
-  ret = OK;
-
 #ifdef CONFIG_NSH_CMDOPT_DD_STATS
-  clock_gettime(CLOCK_MONOTONIC, &ts1);
-
-  elapsed  = (((uint64_t)ts1.tv_sec * NSEC_PER_SEC) + ts1.tv_nsec);
-  elapsed -= (((uint64_t)ts0.tv_sec * NSEC_PER_SEC) + ts0.tv_nsec);
-  elapsed /= NSEC_PER_USEC; /* usec */
-
-  total = ((uint64_t)sector * (uint64_t)dd.sectsize);
-
-  nsh_output(vtbl, "%llu bytes copied, %u usec, ",
-             total, (unsigned int)elapsed);
-  nsh_output(vtbl, "%u KB/s\n" ,
-             (unsigned int)(((double)total / 1024)
-             / ((double)elapsed / USEC_PER_SEC)));
+  nsh_xferstats(vtbl, dd.total, &start);
 #endif
 
-  if (ret == 0 && dd.verify)
+  if (dd.verify)
     {
       ret = dd_verify(infile, outfile, &dd);
     }
@@ -470,6 +726,8 @@ errout_with_outf:
 
 errout_with_inf:
   close(dd.infd);
+
+errout_with_buffer:
   free(dd.buffer);
 
 errout_with_paths:
@@ -68,7 +68,7 @@
  ****************************************************************************/
 
 int nsh_fileapp(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
-                FAR char **argv, FAR const char *redirfile, int oflags)
+                FAR char **argv, FAR const struct nsh_param_s *param)
 {
   posix_spawn_file_actions_t file_actions;
   posix_spawnattr_t attr;
@@ -104,23 +104,16 @@ int nsh_fileapp(FAR struct nsh_vtbl_s *vtbl, FAR const char *cmd,
       goto errout_with_actions;
     }
 
-  /* Handle re-direction of output */
+  /* Handle re-direction of input and output */
 
-  if (redirfile)
+  ret = nsh_fileactions(&file_actions, param);
+  if (ret != 0)
     {
-      ret = posix_spawn_file_actions_addopen(&file_actions, 1, redirfile,
-                                             oflags, 0644);
-      if (ret != 0)
-        {
-          /* posix_spawn_file_actions_addopen returns a positive errno
-           * value on failure.
-           */
+      /* nsh_fileactions returns a positive errno value on failure. */
 
-          nsh_error(vtbl, g_fmtcmdfailed, cmd,
-                     "posix_spawn_file_actions_addopen",
-                     NSH_ERRNO);
-          goto errout_with_attrs;
-        }
+      nsh_error(vtbl, g_fmtcmdfailed, cmd, "posix_spawn_file_actions",
+                NSH_ERRNO_OF(ret));
+      goto errout_with_attrs;
     }
 
 #ifdef CONFIG_BUILTIN
@@ -481,6 +481,12 @@ int cmd_cp(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv)
   FAR char *srcpath  = NULL;
   FAR char *destpath = NULL;
   FAR char *allocpath = NULL;
+  FAR char *iobuffer;
+  size_t bufsize;
+#ifdef CONFIG_NSH_CMDOPT_CP_STATS
+  struct timespec start;
+  uint64_t total = 0;
+#endif
   int oflags = O_WRONLY | O_CREAT | O_TRUNC;
   int rdfd;
   int wrfd;
@@ -567,21 +573,46 @@ int cmd_cp(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv)
       goto errout_with_allocpath;
     }
 
-  /* Now copy the file */
+  /* Now copy the file.  Fewer, larger transfers are much faster on most
+   * file systems and block drivers, so use a bigger buffer than the shared
+   * I/O buffer if there is memory for it.
+   */
+
+  bufsize  = IOBUFFERSIZE;
+  iobuffer = vtbl->iobuffer;
+
+#if CONFIG_NSH_CMDOPT_CP_BUFSIZE > IOBUFFERSIZE
+  iobuffer = malloc(CONFIG_NSH_CMDOPT_CP_BUFSIZE);
+  if (iobuffer != NULL)
+    {
+      bufsize = CONFIG_NSH_CMDOPT_CP_BUFSIZE;
+    }
+  else
+    {
+      iobuffer = vtbl->iobuffer;
+    }
+#endif
+
+#ifdef CONFIG_NSH_CMDOPT_CP_STATS
+  clock_gettime(CLOCK_MONOTONIC, &start);
+#endif
 
   for (; ; )
     {
-      int nbytesread;
-      int nbyteswritten;
-      FAR char *iobuffer = vtbl->iobuffer;
+      ssize_t nbytesread;
+      ssize_t nbyteswritten;
+      FAR char *ptr = iobuffer;
 
       do
         {
-          nbytesread = read(rdfd, iobuffer, IOBUFFERSIZE);
+          nbytesread = read(rdfd, iobuffer, bufsize);
           if (nbytesread == 0)
             {
               /* End of file */
 
+#ifdef CONFIG_NSH_CMDOPT_CP_STATS
+              nsh_xferstats(vtbl, total, &start);
+#endif
               ret = OK;
               goto errout_with_wrfd;
             }
@@ -606,13 +637,17 @@ int cmd_cp(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv)
         }
       while (nbytesread <= 0);
 
+#ifdef CONFIG_NSH_CMDOPT_CP_STATS
+      total += nbytesread;
+#endif
+
       do
         {
-          nbyteswritten = write(wrfd, iobuffer, nbytesread);
+          nbyteswritten = write(wrfd, ptr, nbytesread);
           if (nbyteswritten >= 0)
             {
               nbytesread -= nbyteswritten;
-              iobuffer += nbyteswritten;
+              ptr += nbyteswritten;
             }
           else
             {
@@ -637,6 +672,11 @@ int cmd_cp(FAR struct nsh_vtbl_s *vtbl, int argc, FAR char **argv)
     }
 
 errout_with_wrfd:
+  if (iobuffer != vtbl->iobuffer)
+    {
+      free(iobuffer);
+    }
+
   close(wrfd);
 
 errout_with_allocpath:
@@ -29,11 +29,15 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
+#include <time.h>
 #include <ctype.h>
 #include <fcntl.h>
 #include <dirent.h>
 #include <assert.h>
 
+#include <nuttx/clock.h>
+
 #include "nsh.h"
 #include "nsh_console.h"
 
@@ -516,3 +520,47 @@ FAR char *nsh_getdirpath(FAR struct nsh_vtbl_s *vtbl,
   return strdup(vtbl->iobuffer);
 }
 #endif
+
+/****************************************************************************
+ * Name: nsh_xferstats
+ *
+ * Description:
+ *   Report the size, duration and throughput of a completed copy in the
+ *   style of GNU dd.  Integer arithmetic only, so that no floating point
+ *   support is pulled in.
+ *
+ * Input Parameters:
+ *   vtbl   - The console vtable
+ *   nbytes - The number of bytes copied
+ *   start  - The CLOCK_MONOTONIC time at which the copy started
+ *
+ ****************************************************************************/
+
+#ifdef NSH_HAVE_XFERSTATS
+void nsh_xferstats(FAR struct nsh_vtbl_s *vtbl, uint64_t nbytes,
+                   FAR const struct timespec *start)
+{
+  struct timespec now;
+  uint64_t elapsed;
+  uint64_t rate;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  elapsed  = (uint64_t)now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+  elapsed -= (uint64_t)start->tv_sec * NSEC_PER_SEC + start->tv_nsec;
+  elapsed /= NSEC_PER_USEC;
+  if (elapsed == 0)
+    {
+      elapsed = 1;
+    }
+
+  /* Bytes per microsecond is MB/s (10^6 bytes), kept in hundredths */
+
+  rate = nbytes * 100 / elapsed;
+
+  nsh_output(vtbl, "%" PRIu64 " bytes copied, %" PRIu64 ".%06" PRIu64
+             " s, %" PRIu64 ".%02" PRIu64 " MB/s\n",
+             nbytes, elapsed / USEC_PER_SEC, elapsed % USEC_PER_SEC,
+             rate / 100, rate % 100);
+}
+#endif
@@ -30,10 +30,6 @@
 #include <errno.h>
 #include <debug.h>
 
-#ifdef CONFIG_NSH_CMDPARMS
-#  include <sys/stat.h>
-#endif
-
 #include <nuttx/version.h>
 #include "nshlib/nshlib.h"
 
@@ -76,6 +72,12 @@
 #  define NSH_MEMLIST_FREE(m)
 #endif
 
+/* The most stages a pipeline can have on one command line */
+
+#ifdef CONFIG_NSH_PIPELINE
+#  define NSH_MAXSTAGES         (MAX_ARGV_ENTRIES / 2)
+#endif
+
 /* Do we need g_nullstring[]? */
 
 #undef NEED_NULLSTRING
@@ -101,6 +103,22 @@ struct cmdarg_s
 };
 #endif
 
+/* This structure describes a command that runs on its own thread, as a
+ * stage of a pipeline or as a command parameter.
+ */
+
+#ifdef CONFIG_NSH_PIPELINE
+struct nsh_stage_s
+{
+  FAR struct nsh_vtbl_s *vtbl;      /* Cloned front-end of the stage */
+  FAR char *cmdline;                /* Command line to parse, or NULL */
+  int argc;                         /* Number of arguments in argv */
+  FAR char **argv;                  /* Argument list */
+  struct nsh_param_s param;         /* Standard input and output */
+  pthread_t thread;                 /* The thread running the stage */
+};
+#endif
+
 /* This structure describes the allocation list */
 
 #ifdef HAVE_MEMLIST
@@ -130,12 +148,21 @@ static struct cmdarg_s *nsh_cloneargs(FAR struct nsh_vtbl_s *vtbl,
 
 static int nsh_saveresult(FAR struct nsh_vtbl_s *vtbl, bool result);
 static int nsh_execute(FAR struct nsh_vtbl_s *vtbl,
-               int argc, FAR char *argv[], FAR const char *redirfile,
-               int oflags);
+               int argc, FAR char *argv[],
+               FAR const struct nsh_param_s *param);
+
+#ifdef CONFIG_NSH_PIPELINE
+static pthread_addr_t nsh_stage(pthread_addr_t arg);
+static int nsh_startstage(FAR struct nsh_vtbl_s *vtbl,
+               FAR struct nsh_stage_s *stage);
+static int nsh_joinstage(FAR struct nsh_stage_s *stage);
+static int nsh_pipeline(FAR struct nsh_vtbl_s *vtbl, int argc,
+               FAR char *argv[], FAR struct nsh_param_s *param);
+#endif
 
 #ifdef CONFIG_NSH_CMDPARMS
-static FAR char *nsh_filecat(FAR struct nsh_vtbl_s *vtbl, FAR char *s1,
-               FAR const char *filename);
+static FAR char *nsh_fdcat(FAR struct nsh_vtbl_s *vtbl, FAR char *s1,
+               int fd);
 static FAR char *nsh_cmdparm(FAR struct nsh_vtbl_s *vtbl, FAR char *cmdline,
                FAR char **allocation);
 #endif
@@ -194,7 +221,7 @@ static int nsh_nice(FAR struct nsh_vtbl_s *vtbl, FAR char **ppcmd,
 
 #ifdef CONFIG_NSH_CMDPARMS
 static int nsh_parse_cmdparm(FAR struct nsh_vtbl_s *vtbl, FAR char *cmdline,
-               FAR const char *redirfile);
+               FAR const struct nsh_param_s *param);
 #endif
 
 static int nsh_parse_command(FAR struct nsh_vtbl_s *vtbl, FAR char *cmdline);
@@ -212,6 +239,9 @@ static const char g_arg_separator[]   = "`$";
 #endif
 static const char g_redirect1[]       = ">";
 static const char g_redirect2[]       = ">>";
+#ifdef CONFIG_NSH_PIPELINE
+static const char g_pipeline[]        = "|";
+#endif
 #ifdef NSH_HAVE_VARS
 static const char g_exitstatus[]      = "?";
 static const char g_success[]         = "0";
@@ -484,7 +514,7 @@ static int nsh_saveresult(FAR struct nsh_vtbl_s *vtbl, bool result)
 
 static int nsh_execute(FAR struct nsh_vtbl_s *vtbl,
                        int argc, FAR char *argv[],
-                       FAR const char *redirfile, int oflags)
+                       FAR const struct nsh_param_s *param)
 {
 #if defined(CONFIG_FILE_STREAM) || !defined(CONFIG_NSH_DISABLEBG)
   int fd = -1;
@@ -526,11 +556,7 @@ static int nsh_execute(FAR struct nsh_vtbl_s *vtbl,
    */
 
 #ifdef CONFIG_NSH_BUILTIN_APPS
-#ifdef CONFIG_FILE_STREAM
-  ret = nsh_builtin(vtbl, argv[0], argv, redirfile, oflags);
-#else
-  ret = nsh_builtin(vtbl, argv[0], argv, NULL, 0);
-#endif
+  ret = nsh_builtin(vtbl, argv[0], argv, param);
   if (ret >= 0)
     {
       /* nsh_builtin() returned 0 or 1.  This means that the built-in
@@ -567,7 +593,7 @@ static int nsh_execute(FAR struct nsh_vtbl_s *vtbl,
    */
 
 #ifdef CONFIG_NSH_FILE_APPS
-  ret = nsh_fileapp(vtbl, argv[0], argv, redirfile, oflags);
+  ret = nsh_fileapp(vtbl, argv[0], argv, param);
   if (ret >= 0)
     {
       /* nsh_fileapp() returned 0 or 1.  This means that the built-in
@@ -589,7 +615,7 @@ static int nsh_execute(FAR struct nsh_vtbl_s *vtbl,
 #ifdef CONFIG_FILE_STREAM
   /* Redirected output? */
 
-  if (vtbl->np.np_redirect)
+  if (param->file_out != NULL)
     {
       /* Open the redirection file.  This file will eventually
        * be closed by a call to either nsh_release (if the command
@@ -597,13 +623,28 @@ static int nsh_execute(FAR struct nsh_vtbl_s *vtbl,
        * command is executed in the foreground.
        */
 
-      fd = open(redirfile, oflags, 0666);
+      fd = open(param->file_out, param->oflags, 0666);
       if (fd < 0)
         {
           nsh_error(vtbl, g_fmtcmdfailed, argv[0], "open", NSH_ERRNO);
           goto errout;
         }
     }
+#ifdef CONFIG_NSH_PIPELINE
+  else if (param->fd_out >= 0)
+    {
+      /* Output into a pipe.  nsh_undirect closes this copy of the
+       * descriptor, the original still belongs to the caller.
+       */
+
+      fd = dup(param->fd_out);
+      if (fd < 0)
+        {
+          nsh_error(vtbl, g_fmtcmdfailed, argv[0], "dup", NSH_ERRNO);
+          goto errout;
+        }
+    }
+#endif
 #endif
 
   /* Handle the case where the command is executed in background.
@@ -643,7 +684,7 @@ static int nsh_execute(FAR struct nsh_vtbl_s *vtbl,
 #ifdef CONFIG_FILE_STREAM
       /* Handle redirection of output via a file descriptor */
 
-      if (vtbl->np.np_redirect)
+      if (fd >= 0)
         {
           nsh_redirect(bkgvtbl, fd, NULL);
         }
@@ -727,7 +768,7 @@ static int nsh_execute(FAR struct nsh_vtbl_s *vtbl,
 
       /* Handle redirection of output via a file descriptor */
 
-      if (vtbl->np.np_redirect)
+      if (fd >= 0)
         {
           nsh_redirect(vtbl, fd, save);
         }
@@ -747,7 +788,7 @@ static int nsh_execute(FAR struct nsh_vtbl_s *vtbl,
        * file descriptor.
        */
 
-      if (vtbl->np.np_redirect)
+      if (fd >= 0)
         {
           nsh_undirect(vtbl, save);
         }
@@ -772,7 +813,7 @@ static int nsh_execute(FAR struct nsh_vtbl_s *vtbl,
 #ifndef CONFIG_NSH_DISABLEBG
 errout_with_redirect:
 #ifdef CONFIG_FILE_STREAM
-  if (vtbl->np.np_redirect)
+  if (fd >= 0)
     {
       close(fd);
     }
@@ -784,99 +825,314 @@ errout:
 }
 
 /****************************************************************************
- * Name: nsh_filecat
+ * Name: nsh_stage
+ *
+ * Description:
+ *   The thread that runs one stage of a pipeline or a command parameter.
+ *   The stage owns the descriptors in its parameters and closes them when
+ *   the command completes, so that its neighbours see the end of file.
+ *
  ****************************************************************************/
 
+#ifdef CONFIG_NSH_PIPELINE
+static pthread_addr_t nsh_stage(pthread_addr_t arg)
+{
+  FAR struct nsh_stage_s *stage = (FAR struct nsh_stage_s *)arg;
+  int ret;
+
 #ifdef CONFIG_NSH_CMDPARMS
-static FAR char *nsh_filecat(FAR struct nsh_vtbl_s *vtbl, FAR char *s1,
-                             FAR const char *filename)
+  if (stage->cmdline != NULL)
+    {
+      ret = nsh_parse_cmdparm(stage->vtbl, stage->cmdline, &stage->param);
+    }
+  else
+#endif
+    {
+      ret = nsh_execute(stage->vtbl, stage->argc, stage->argv,
+                        &stage->param);
+    }
+
+  if (stage->param.fd_in >= 0)
+    {
+      close(stage->param.fd_in);
+    }
+
+  if (stage->param.fd_out >= 0)
+    {
+      close(stage->param.fd_out);
+    }
+
+  nsh_release(stage->vtbl);
+  return (pthread_addr_t)((uintptr_t)ret);
+}
+#endif
+
+/****************************************************************************
+ * Name: nsh_startstage
+ *
+ * Description:
+ *   Start a stage on its own thread, at the priority of the shell.  On
+ *   success the stage takes over the descriptors in its parameters,
+ *   otherwise they still belong to the caller.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NSH_PIPELINE
+static int nsh_startstage(FAR struct nsh_vtbl_s *vtbl,
+                          FAR struct nsh_stage_s *stage)
 {
-  struct stat buf;
-  size_t s1size = 0;
-  size_t allocsize;
-  ssize_t nbytesread;
-  FAR char *argument;
-  unsigned index;
-  int fd;
+  FAR const char *name = stage->argv ? stage->argv[0] : "``";
+  struct sched_param param;
+  pthread_attr_t attr;
   int ret;
 
-  /* Get the size of the string */
+  /* Each stage gets a front-end of its own so that its output can be
+   * redirected independently.  It never owns the terminal.
+   */
 
-  if (s1)
+  stage->vtbl = nsh_clone(vtbl);
+  if (stage->vtbl == NULL)
     {
-      s1size = (size_t)strlen(s1);
+      nsh_error(vtbl, g_fmtcmdoutofmemory, name);
+      return ERROR;
     }
 
-  /* Get the size of file */
+  stage->vtbl->isctty = false;
 
-  ret = stat(filename, &buf);
+  ret = sched_getparam(0, &param);
   if (ret != 0)
     {
-      nsh_error(vtbl, g_fmtcmdfailed, "``", "stat", NSH_ERRNO);
-      return NULL;
+      nsh_error(vtbl, g_fmtcmdfailed, name, "sched_getparm", NSH_ERRNO);
+      goto errout_with_vtbl;
     }
 
-  /* Get the total allocation size */
+  pthread_attr_init(&attr);
+  pthread_attr_setschedpolicy(&attr, SCHED_NSH);
+  pthread_attr_setschedparam(&attr, &param);
 
-  allocsize = s1size + (size_t)buf.st_size + 1;
-  argument = (FAR char *)realloc(s1, allocsize);
-  if (!argument)
+  ret = pthread_create(&stage->thread, &attr, nsh_stage,
+                       (pthread_addr_t)stage);
+  pthread_attr_destroy(&attr);
+  if (ret != 0)
     {
-      nsh_error(vtbl, g_fmtcmdoutofmemory, "``");
-      return NULL;
+      nsh_error(vtbl, g_fmtcmdfailed, name, "pthread_create",
+                NSH_ERRNO_OF(ret));
+      goto errout_with_vtbl;
     }
 
-  /* Open the source file for reading */
+  return OK;
+
+errout_with_vtbl:
+  nsh_release(stage->vtbl);
+  return ERROR;
+}
+#endif
+
+/****************************************************************************
+ * Name: nsh_joinstage
+ *
+ * Description:
+ *   Wait for a stage to complete and return the result of its command.
+ *
+ ****************************************************************************/
 
-  fd = open(filename, O_RDONLY);
-  if (fd < 0)
+#ifdef CONFIG_NSH_PIPELINE
+static int nsh_joinstage(FAR struct nsh_stage_s *stage)
+{
+  pthread_addr_t value;
+
+  if (pthread_join(stage->thread, &value) != 0)
     {
-      nsh_error(vtbl, g_fmtcmdfailed, "``", "open", NSH_ERRNO);
-      goto errout_with_alloc;
+      return ERROR;
     }
 
-  /* Now copy the file.  Loop until the entire file has been transferred to
-   * the allocated string (after the original contents of s1size bytes.
-   */
+  return (int)((intptr_t)value);
+}
+#endif
 
-  for (index = s1size; index < allocsize - 1; )
+/****************************************************************************
+ * Name: nsh_pipeline
+ *
+ * Description:
+ *   Run the commands of a pipeline, separated by '|' in argv.  Every stage
+ *   but the last is started on its own thread with its standard output
+ *   going into a pipe.  The last stage runs here, with the output
+ *   redirection of the whole command line, and provides the result.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NSH_PIPELINE
+static int nsh_pipeline(FAR struct nsh_vtbl_s *vtbl, int argc,
+                        FAR char *argv[], FAR struct nsh_param_s *param)
+{
+  struct nsh_stage_s stages[NSH_MAXSTAGES];
+  FAR struct nsh_stage_s *stage;
+  int nstages = 0;
+  int start = 0;
+  int infd = -1;
+  int fd[2];
+  int ret;
+  int i;
+
+  for (i = 0; i < argc; i++)
     {
-      /* Loop until we successfully read something , we encounter the
-       * end-of-file, or until a read error occurs
+      if (strcmp(argv[i], g_pipeline) != 0)
+        {
+          continue;
+        }
+
+      /* argv[start] through argv[i - 1] is the next stage */
+
+      if (i == start || i == argc - 1 || nstages >= NSH_MAXSTAGES)
+        {
+          nsh_error(vtbl, g_fmtsyntax, g_pipeline);
+          ret = nsh_saveresult(vtbl, true);
+          goto errout;
+        }
+
+      argv[i] = NULL;
+
+      /* Spawned programs only get the ends that are dup'ed onto their
+       * standard input and output.  Any other copy would keep the pipe
+       * open after its stage has finished.
        */
 
-      do
+      ret = pipe2(fd, O_CLOEXEC);
+      if (ret < 0)
         {
-          nbytesread = read(fd, &argument[index], IOBUFFERSIZE);
-          if (nbytesread == 0)
-            {
-              /* Unexpected end of file -- Break out of the loop */
+          nsh_error(vtbl, g_fmtcmdfailed, argv[start], "pipe2", NSH_ERRNO);
+          ret = nsh_saveresult(vtbl, true);
+          goto errout;
+        }
+
+      stage                 = &stages[nstages];
+      stage->cmdline        = NULL;
+      stage->argc           = i - start;
+      stage->argv           = &argv[start];
+      stage->param.fd_in    = infd;
+      stage->param.fd_out   = fd[1];
+      stage->param.oflags   = 0;
+      stage->param.file_out = NULL;
+
+      ret = nsh_startstage(vtbl, stage);
+      if (ret < 0)
+        {
+          close(fd[0]);
+          close(fd[1]);
+          ret = nsh_saveresult(vtbl, true);
+          goto errout;
+        }
+
+      nstages++;
+      infd  = fd[0];
+      start = i + 1;
+    }
+
+  /* Run the last stage in the foreground */
+
+  param->fd_in = infd;
+  ret = nsh_execute(vtbl, argc - start, &argv[start], param);
+
+errout:
+
+  /* Close our end of the pipe before waiting, a stage may be blocked
+   * writing into it.
+   */
+
+  if (infd >= 0)
+    {
+      close(infd);
+    }
+
+  while (nstages > 0)
+    {
+      nsh_joinstage(&stages[--nstages]);
+    }
+
+  return ret;
+}
+#endif
+
+/****************************************************************************
+ * Name: nsh_fdcat
+ *
+ * Description:
+ *   Append everything that can be read from 'fd' to the string 's1' and
+ *   remove the trailing whitespace.  The string is reallocated, and is
+ *   returned even if reading stopped early on an error.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NSH_CMDPARMS
+static FAR char *nsh_fdcat(FAR struct nsh_vtbl_s *vtbl, FAR char *s1, int fd)
+{
+  FAR char *argument;
+  FAR char *tmp;
+  size_t s1size = 0;
+  size_t allocsize;
+  size_t index;
+  ssize_t nbytesread;
+
+  /* Get the size of the string */
+
+  if (s1)
+    {
+      s1size = strlen(s1);
+    }
+
+  /* The output is not known in advance.  Start with room for one buffer
+   * and double the allocation whenever it fills up.
+   */
+
+  allocsize = s1size + IOBUFFERSIZE + 1;
+  argument  = (FAR char *)realloc(s1, allocsize);
+  if (!argument)
+    {
+      nsh_error(vtbl, g_fmtcmdoutofmemory, "``");
+      return NULL;
+    }
+
+  for (index = s1size; ; index += nbytesread)
+    {
+      /* Always keep room for the NUL terminator */
 
+      if (index + 1 >= allocsize)
+        {
+          tmp = (FAR char *)realloc(argument, 2 * allocsize);
+          if (!tmp)
+            {
+              nsh_error(vtbl, g_fmtcmdoutofmemory, "``");
               break;
             }
-          else if (nbytesread < 0)
-            {
-              /* EINTR is not an error (but will still stop the copy) */
 
-              if (errno == EINTR)
-                {
-                  nsh_error(vtbl, g_fmtsignalrecvd, "``");
-                }
-              else
-                {
-                  /* Read error */
+          argument   = tmp;
+          allocsize *= 2;
+        }
 
-                  nsh_error(vtbl, g_fmtcmdfailed, "``", "read", NSH_ERRNO);
-                }
+      nbytesread = read(fd, &argument[index], allocsize - index - 1);
+      if (nbytesread == 0)
+        {
+          /* End of file, the command has completed */
 
-              goto errout_with_fd;
-            }
+          break;
         }
-      while (nbytesread <= 0);
+      else if (nbytesread < 0)
+        {
+          /* EINTR is not an error (but will still stop the copy) */
+
+          if (errno == EINTR)
+            {
+              nsh_error(vtbl, g_fmtsignalrecvd, "``");
+            }
+          else
+            {
+              /* Read error */
 
-      /* Update the index based upon the number of bytes read */
+              nsh_error(vtbl, g_fmtcmdfailed, "``", "read", NSH_ERRNO);
+            }
 
-      index += nbytesread;
+          break;
+        }
     }
 
   /* Remove trailing whitespace */
@@ -889,18 +1145,7 @@ static FAR char *nsh_filecat(FAR struct nsh_vtbl_s *vtbl, FAR char *s1,
   /* Make sure that the new string is null terminated */
 
   argument[index] = '\0';
-
-  /* Close the temporary file and return the concatenated value */
-
-  close (fd);
   return argument;
-
-errout_with_fd:
-  close(fd);
-
-errout_with_alloc:
-  free(argument);
-  return NULL;
 }
 #endif
 
@@ -912,8 +1157,15 @@ errout_with_alloc:
 static FAR char *nsh_cmdparm(FAR struct nsh_vtbl_s *vtbl, FAR char *cmdline,
                              FAR char **allocation)
 {
+#ifdef CONFIG_NSH_PIPELINE
+  struct nsh_stage_s stage;
+  int fd[2];
+#else
+  struct nsh_param_s param;
   FAR char *tmpfile;
-  FAR char *argument;
+  int fd;
+#endif
+  FAR char *argument = NULL;
   int ret;
 
   /* We cannot process the command argument if there is no allocation
@@ -925,6 +1177,39 @@ static FAR char *nsh_cmdparm(FAR struct nsh_vtbl_s *vtbl, FAR char *cmdline,
       return (FAR char *)g_nullstring;
     }
 
+#ifdef CONFIG_NSH_PIPELINE
+  /* Run the command on its own thread with its output going into a pipe,
+   * and collect the output here while it is produced.
+   */
+
+  ret = pipe2(fd, O_CLOEXEC);
+  if (ret < 0)
+    {
+      nsh_error(vtbl, g_fmtcmdfailed, "``", "pipe2", NSH_ERRNO);
+      return (FAR char *)g_nullstring;
+    }
+
+  stage.cmdline        = cmdline;
+  stage.argc           = 0;
+  stage.argv           = NULL;
+  stage.param.fd_in    = -1;
+  stage.param.fd_out   = fd[1];
+  stage.param.oflags   = 0;
+  stage.param.file_out = NULL;
+
+  ret = nsh_startstage(vtbl, &stage);
+  if (ret < 0)
+    {
+      close(fd[0]);
+      close(fd[1]);
+      return (FAR char *)g_nullstring;
+    }
+
+  argument = nsh_fdcat(vtbl, *allocation, fd[0]);
+  close(fd[0]);
+
+  ret = nsh_joinstage(&stage);
+#else
   /* Create a unique file name using the task ID */
 
   tmpfile = NULL;
@@ -940,38 +1225,55 @@ static FAR char *nsh_cmdparm(FAR struct nsh_vtbl_s *vtbl, FAR char *cmdline,
    * options.
    */
 
-  ret = nsh_parse_cmdparm(vtbl, cmdline, tmpfile);
-  if (ret != OK)
+  param.fd_in    = -1;
+  param.fd_out   = -1;
+  param.oflags   = O_WRONLY | O_CREAT | O_TRUNC;
+  param.file_out = tmpfile;
+
+  ret = nsh_parse_cmdparm(vtbl, cmdline, &param);
+  if (ret == OK)
     {
-      /* Report the failure */
+      /* Concatenate the file contents with the current allocation */
 
-      nsh_error(vtbl, g_fmtcmdfailed, "``", "exec", NSH_ERRNO);
-      free(tmpfile);
-      return (FAR char *)g_nullstring;
-    }
+      fd = open(tmpfile, O_RDONLY);
+      if (fd < 0)
+        {
+          nsh_error(vtbl, g_fmtcmdfailed, "``", "open", NSH_ERRNO);
+          argument = NULL;
+        }
+      else
+        {
+          argument = nsh_fdcat(vtbl, *allocation, fd);
+          close(fd);
+        }
 
-  /* Concatenate the file contents with the current allocation */
+      /* We can now unlink the tmpfile */
 
-  argument = nsh_filecat(vtbl, *allocation, tmpfile);
-  if (argument == NULL)
-    {
-      argument = (FAR char *)g_nullstring;
+      if (unlink(tmpfile) < 0)
+        {
+          nsh_error(vtbl, g_fmtcmdfailed, "``", "unlink", NSH_ERRNO);
+        }
     }
-  else
+
+  free(tmpfile);
+#endif
+
+  /* The allocation may have moved even if the command failed */
+
+  if (argument != NULL)
     {
       *allocation = argument;
     }
 
-  /* We can now unlink the tmpfile and free the tmpfile string */
-
-  ret = unlink(tmpfile);
-  if (ret < 0)
+  if (ret != OK)
     {
-      nsh_error(vtbl, g_fmtcmdfailed, "``", "unlink", NSH_ERRNO);
+      /* Report the failure */
+
+      nsh_error(vtbl, g_fmtcmdfailed, "``", "exec", NSH_ERRNO);
+      return (FAR char *)g_nullstring;
     }
 
-  free(tmpfile);
-  return argument;
+  return argument != NULL ? argument : (FAR char *)g_nullstring;
 }
 #endif
 
@@ -1878,7 +2180,12 @@ static int nsh_loop(FAR struct nsh_vtbl_s *vtbl, FAR char **ppcmd,
 #endif
               np->np_lpstate[np->np_lpndx].lp_state == NSH_LOOP_WHILE ||
               np->np_lpstate[np->np_lpndx].lp_state == NSH_LOOP_UNTIL ||
-              np->np_stream == NULL || np->np_foffs < 0)
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+              (np->np_stream == NULL && np->np_script == NULL) ||
+#else
+              np->np_stream == NULL ||
+#endif
+              np->np_foffs < 0)
             {
               nsh_error(vtbl, g_fmtcontext, cmd);
               goto errout;
@@ -1968,15 +2275,30 @@ static int nsh_loop(FAR struct nsh_vtbl_s *vtbl, FAR char **ppcmd,
 
           if (np->np_lpstate[np->np_lpndx].lp_enable)
             {
-              /* Set the new file position to the top of the loop offset */
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+              /* A script in memory just continues from the top of the
+               * loop offset in its text.
+               */
 
-              ret = fseek(np->np_stream,
-                          np->np_lpstate[np->np_lpndx].lp_topoffs,
-                          SEEK_SET);
-              if (ret < 0)
+              if (np->np_script != NULL)
+                {
+                  np->np_spos = np->np_lpstate[np->np_lpndx].lp_topoffs;
+                }
+              else
+#endif
                 {
-                  nsh_error(vtbl, g_fmtcmdfailed, "done", "fseek",
-                            NSH_ERRNO);
+                  /* Set the new file position to the top of the loop
+                   * offset
+                   */
+
+                  ret = fseek(np->np_stream,
+                              np->np_lpstate[np->np_lpndx].lp_topoffs,
+                              SEEK_SET);
+                  if (ret < 0)
+                    {
+                      nsh_error(vtbl, g_fmtcmdfailed, "done", "fseek",
+                                NSH_ERRNO);
+                    }
                 }
 
 #ifndef NSH_DISABLE_SEMICOLON
@@ -2264,7 +2586,7 @@ static int nsh_nice(FAR struct nsh_vtbl_s *vtbl, FAR char **ppcmd,
 
 #ifdef CONFIG_NSH_CMDPARMS
 static int nsh_parse_cmdparm(FAR struct nsh_vtbl_s *vtbl, FAR char *cmdline,
-                             FAR const char *redirfile)
+                             FAR const struct nsh_param_s *param)
 {
   NSH_MEMLIST_TYPE memlist;
   FAR char *argv[MAX_ARGV_ENTRIES];
@@ -2357,8 +2679,7 @@ static int nsh_parse_cmdparm(FAR struct nsh_vtbl_s *vtbl, FAR char *cmdline,
 
   /* Then execute the command */
 
-  ret = nsh_execute(vtbl, argc, argv, redirfile,
-                    O_WRONLY | O_CREAT | O_TRUNC);
+  ret = nsh_execute(vtbl, argc, argv, param);
 
   /* Restore the backgrounding and redirection state */
 
@@ -2388,9 +2709,12 @@ static int nsh_parse_command(FAR struct nsh_vtbl_s *vtbl, FAR char *cmdline)
   FAR char *saveptr;
   FAR char *cmd;
   FAR char *redirfile = NULL;
-  int       oflags = 0;
+  struct nsh_param_s param;
   int       argc;
   int       ret;
+#ifdef CONFIG_NSH_PIPELINE
+  int       i;
+#endif
 #ifdef CONFIG_FILE_STREAM
   bool      redirect_save = false;
 #endif
@@ -2400,6 +2724,11 @@ static int nsh_parse_command(FAR struct nsh_vtbl_s *vtbl, FAR char *cmdline)
   memset(argv, 0, MAX_ARGV_ENTRIES*sizeof(FAR char *));
   NSH_MEMLIST_INIT(memlist);
 
+  param.fd_in    = -1;
+  param.fd_out   = -1;
+  param.oflags   = 0;
+  param.file_out = NULL;
+
 #ifndef CONFIG_NSH_DISABLEBG
   vtbl->np.np_bg       = false;
 #endif
@@ -2560,7 +2889,7 @@ static int nsh_parse_command(FAR struct nsh_vtbl_s *vtbl, FAR char *cmdline)
         {
           redirect_save        = vtbl->np.np_redirect;
           vtbl->np.np_redirect = true;
-          oflags               = O_WRONLY | O_CREAT | O_TRUNC;
+          param.oflags         = O_WRONLY | O_CREAT | O_TRUNC;
           redirfile            = nsh_getfullpath(vtbl, argv[argc - 1]);
           argc                -= 2;
         }
@@ -2571,11 +2900,13 @@ static int nsh_parse_command(FAR struct nsh_vtbl_s *vtbl, FAR char *cmdline)
         {
           redirect_save        = vtbl->np.np_redirect;
           vtbl->np.np_redirect = true;
-          oflags               = O_WRONLY | O_CREAT | O_APPEND;
+          param.oflags         = O_WRONLY | O_CREAT | O_APPEND;
           redirfile            = nsh_getfullpath(vtbl, argv[argc - 1]);
           argc                -= 2;
         }
     }
+
+  param.file_out = redirfile;
 #endif
 
   /* Last argument vector must be empty */
@@ -2589,9 +2920,38 @@ static int nsh_parse_command(FAR struct nsh_vtbl_s *vtbl, FAR char *cmdline)
       nsh_error(vtbl, g_fmttoomanyargs, cmd);
     }
 
-  /* Then execute the command */
+#ifdef CONFIG_NSH_PIPELINE
+  /* Check if the command is a pipeline */
+
+  for (i = 1; i < argc; i++)
+    {
+      if (strcmp(argv[i], g_pipeline) == 0)
+        {
+          break;
+        }
+    }
 
-  ret = nsh_execute(vtbl, argc, argv, redirfile, oflags);
+  if (i < argc)
+    {
+      /* A pipeline cannot be run in background */
+
+      if (vtbl->np.np_bg)
+        {
+          nsh_error(vtbl, g_fmtcontext, "&");
+          ret = nsh_saveresult(vtbl, true);
+        }
+      else
+        {
+          ret = nsh_pipeline(vtbl, argc, argv, &param);
+        }
+    }
+  else
+#endif
+    {
+      /* Then execute the command */
+
+      ret = nsh_execute(vtbl, argc, argv, &param);
+    }
 
   /* Free any allocated resources */
 
@@ -2613,6 +2973,44 @@ static int nsh_parse_command(FAR struct nsh_vtbl_s *vtbl, FAR char *cmdline)
  * Public Functions
  ****************************************************************************/
 
+/****************************************************************************
+ * Name: nsh_fileactions
+ *
+ * Description:
+ *   Add the file actions that redirect the standard input and output of a
+ *   spawned program as described by 'param'.
+ *
+ * Returned Value:
+ *   Zero on success, or a positive errno value on failure, like the
+ *   posix_spawn_file_actions_*() interfaces.
+ *
+ ****************************************************************************/
+
+#if defined(CONFIG_NSH_BUILTIN_APPS) || defined(CONFIG_NSH_FILE_APPS)
+int nsh_fileactions(FAR posix_spawn_file_actions_t *actions,
+                    FAR const struct nsh_param_s *param)
+{
+  int ret = 0;
+
+  if (param->fd_in >= 0)
+    {
+      ret = posix_spawn_file_actions_adddup2(actions, param->fd_in, 0);
+    }
+
+  if (ret == 0 && param->file_out != NULL)
+    {
+      ret = posix_spawn_file_actions_addopen(actions, 1, param->file_out,
+                                             param->oflags, 0644);
+    }
+  else if (ret == 0 && param->fd_out >= 0)
+    {
+      ret = posix_spawn_file_actions_adddup2(actions, param->fd_out, 1);
+    }
+
+  return ret;
+}
+#endif
+
 /****************************************************************************
  * Name: nsh_parse
  *
@@ -25,11 +25,56 @@
 #include <nuttx/config.h>
 #include <fcntl.h>
 
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+#  include <sys/stat.h>
+#  include <semaphore.h>
+#  include <stdlib.h>
+#  include <string.h>
+#endif
+
+#ifdef CONFIG_NSH_SCRIPT_TIMING
+#  include <time.h>
+#endif
+
 #include "nsh.h"
 #include "nsh_console.h"
 
 #if defined(CONFIG_FILE_STREAM) && !defined(CONFIG_NSH_DISABLESCRIPT)
 
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* A script held in memory.  The text holds the command lines of the
+ * script without blank lines, comment lines, or leading white space.  It
+ * is shared by all sessions running the script and never changes once
+ * loaded; a script that changed on disk is loaded again.
+ */
+
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+struct nsh_script_s
+{
+  FAR struct nsh_script_s *sc_flink; /* Next script in the cache */
+  FAR char *sc_path;                 /* Full path of the script */
+  FAR char *sc_text;                 /* The command lines */
+  size_t    sc_len;                  /* Length of sc_text */
+  time_t    sc_mtime;                /* Modification time when loaded */
+  off_t     sc_size;                 /* File size when loaded */
+  uint8_t   sc_crefs;                /* References, the cache holds one */
+};
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+/* The cached scripts, most recently used first */
+
+static FAR struct nsh_script_s *g_scripts;
+static sem_t g_scriptsem = SEM_INITIALIZER(1);
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -67,113 +112,539 @@ static int nsh_script_redirect(FAR struct nsh_vtbl_s *vtbl,
 #endif
 
 /****************************************************************************
- * Public Functions
+ * Name: nsh_script_lock and nsh_script_unlock
+ *
+ * Description:
+ *   Serialize access to the cache between NSH sessions.
+ *
  ****************************************************************************/
 
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+static void nsh_script_lock(void)
+{
+  while (sem_wait(&g_scriptsem) < 0)
+    {
+      /* Only interrupted by a signal, try again */
+    }
+}
+
+static void nsh_script_unlock(void)
+{
+  sem_post(&g_scriptsem);
+}
+#endif
+
 /****************************************************************************
- * Name: nsh_script
+ * Name: nsh_script_release
  *
  * Description:
- *   Execute the NSH script at path.
+ *   Drop a reference to a cached script, freeing it with the last one.
+ *   Must be called with g_scriptsem held.
  *
  ****************************************************************************/
 
-int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const FAR char *cmd,
-               FAR const char *path)
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+static void nsh_script_release(FAR struct nsh_script_s *script)
 {
-  FAR char *fullpath;
-  FAR FILE *savestream;
-  FAR char *buffer;
-  FAR char *pret;
-  int ret = ERROR;
+  if (--script->sc_crefs == 0)
+    {
+      free(script);
+    }
+}
+#endif
 
-  /* The path to the script may relative to the current working directory */
+/****************************************************************************
+ * Name: nsh_script_compact
+ *
+ * Description:
+ *   Remove blank lines, comment lines, and leading white space from the
+ *   text of a script, in place.  Returns the new length.
+ *
+ ****************************************************************************/
 
-  fullpath = nsh_getfullpath(vtbl, path);
-  if (!fullpath)
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+static size_t nsh_script_compact(FAR char *text, size_t len)
+{
+  FAR char *end = text + len;
+  FAR char *src = text;
+  FAR char *dest = text;
+  FAR char *eol;
+
+  while (src < end)
     {
-      return ERROR;
+      eol = memchr(src, '\n', end - src);
+      eol = eol != NULL ? eol + 1 : end;
+
+      while (src < eol && (*src == ' ' || *src == '\t'))
+        {
+          src++;
+        }
+
+      if (src < eol && *src != '\n' && *src != '#')
+        {
+          memmove(dest, src, eol - src);
+          dest += eol - src;
+        }
+
+      src = eol;
     }
 
-  /* Get a reference to the common input buffer */
+  return dest - text;
+}
+#endif
 
-  buffer = nsh_linebuffer(vtbl);
-  if (buffer)
+/****************************************************************************
+ * Name: nsh_script_load
+ *
+ * Description:
+ *   Return a referenced copy of the script at 'fullpath' in memory,
+ *   reading it in if it is not in the cache or has changed on disk.
+ *   Returns NULL if the script should be run from the file instead.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+static FAR struct nsh_script_s *nsh_script_load(FAR const char *fullpath,
+                                                FAR bool *cached)
+{
+  FAR struct nsh_script_s *script;
+  FAR struct nsh_script_s *prev;
+  struct stat buf;
+  size_t pathlen;
+  ssize_t nread;
+  size_t len;
+  int count;
+  int fd;
+
+  if (stat(fullpath, &buf) < 0 || !S_ISREG(buf.st_mode) ||
+      buf.st_size > CONFIG_NSH_SCRIPT_CACHE_MAXSIZE)
     {
-      /* Save the parent stream in case of nested script processing */
+      return NULL;
+    }
 
-      savestream = vtbl->np.np_stream;
+  /* Look for the script in the cache */
 
-      /* Open the file containing the script */
+  nsh_script_lock();
 
-      vtbl->np.np_stream = fopen(fullpath, "r");
-      if (!vtbl->np.np_stream)
+  for (prev = NULL, script = g_scripts; script != NULL;
+       prev = script, script = script->sc_flink)
+    {
+      if (strcmp(script->sc_path, fullpath) == 0)
         {
-          nsh_error(vtbl, g_fmtcmdfailed, cmd, "fopen", NSH_ERRNO);
+          break;
+        }
+    }
 
-          /* Free the allocated path */
+  if (script != NULL)
+    {
+      /* Remove it from the list, it either moves to the head or goes */
 
-          nsh_freefullpath(fullpath);
+      if (prev != NULL)
+        {
+          prev->sc_flink = script->sc_flink;
+        }
+      else
+        {
+          g_scripts = script->sc_flink;
+        }
 
-          /* Restore the parent script stream */
+      if (script->sc_mtime == buf.st_mtime && script->sc_size == buf.st_size)
+        {
+          script->sc_flink = g_scripts;
+          g_scripts        = script;
+          script->sc_crefs++;
+          nsh_script_unlock();
 
-          vtbl->np.np_stream = savestream;
-          return ERROR;
+          *cached = true;
+          return script;
         }
 
-      /* Loop, processing each command line in the script file (or
-       * until an error occurs)
-       */
+      nsh_script_release(script);
+    }
+
+  nsh_script_unlock();
+
+  /* Read the script into a single allocation holding the path too */
+
+  pathlen = strlen(fullpath) + 1;
+  script  = malloc(sizeof(struct nsh_script_s) + pathlen + buf.st_size);
+  if (script == NULL)
+    {
+      return NULL;
+    }
+
+  script->sc_path = (FAR char *)(script + 1);
+  script->sc_text = script->sc_path + pathlen;
+  memcpy(script->sc_path, fullpath, pathlen);
+
+  fd = open(fullpath, O_RDONLY);
+  if (fd < 0)
+    {
+      free(script);
+      return NULL;
+    }
+
+  for (len = 0; len < (size_t)buf.st_size; len += nread)
+    {
+      nread = read(fd, script->sc_text + len, (size_t)buf.st_size - len);
+      if (nread <= 0)
+        {
+          break;
+        }
+    }
+
+  close(fd);
+
+  if (len < (size_t)buf.st_size)
+    {
+      free(script);
+      return NULL;
+    }
+
+  script->sc_len   = nsh_script_compact(script->sc_text, len);
+  script->sc_mtime = buf.st_mtime;
+  script->sc_size  = buf.st_size;
+  script->sc_crefs = 2;
+
+  /* Add it to the cache, dropping the least recently used scripts */
+
+  nsh_script_lock();
+
+  script->sc_flink = g_scripts;
+  g_scripts        = script;
 
-      do
+  for (count = 1, prev = script; prev->sc_flink != NULL; count++)
+    {
+      if (count >= CONFIG_NSH_SCRIPT_CACHE_NSCRIPTS)
+        {
+          FAR struct nsh_script_s *oldest = prev->sc_flink;
+
+          prev->sc_flink = oldest->sc_flink;
+          nsh_script_release(oldest);
+        }
+      else
         {
-          /* Flush any output generated by the previous line */
+          prev = prev->sc_flink;
+        }
+    }
+
+  nsh_script_unlock();
+
+  *cached = false;
+  return script;
+}
+#endif
+
+/****************************************************************************
+ * Name: nsh_script_gets
+ *
+ * Description:
+ *   Get the next line of a script in memory, like fgets() does from the
+ *   file.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+static FAR char *nsh_script_gets(FAR struct nsh_parser_s *np,
+                                 FAR char *buffer)
+{
+  FAR struct nsh_script_s *script = np->np_script;
+  FAR const char *line;
+  FAR const char *eol;
+  size_t len;
+
+  if (np->np_spos < 0 || np->np_spos >= script->sc_len)
+    {
+      return NULL;
+    }
 
-          fflush(stdout);
+  line = script->sc_text + np->np_spos;
+  len  = script->sc_len - np->np_spos;
+  eol  = memchr(line, '\n', len);
+  if (eol != NULL)
+    {
+      len = eol - line + 1;
+    }
+
+  if (len > CONFIG_NSH_LINELEN - 1)
+    {
+      len = CONFIG_NSH_LINELEN - 1;
+    }
+
+  memcpy(buffer, line, len);
+  buffer[len] = '\0';
+  np->np_spos += len;
+  return buffer;
+}
+#endif
+
+/****************************************************************************
+ * Name: nsh_script_memory
+ *
+ * Description:
+ *   Execute a script held in memory.  'while' and 'until' loops jump back
+ *   by resetting the position in the text rather than seeking in a file.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+static int nsh_script_memory(FAR struct nsh_vtbl_s *vtbl,
+                             FAR struct nsh_script_s *script,
+                             FAR char *buffer, FAR unsigned int *nlines)
+{
+  FAR struct nsh_parser_s *np = &vtbl->np;
+  FAR struct nsh_script_s *savescript;
+  FAR FILE *savestream;
+  FAR char *pret;
+  long savepos;
+  int ret = OK;
+
+  /* Save the parent script in case of nested script processing */
+
+  savescript    = np->np_script;
+  savestream    = np->np_stream;
+  savepos       = np->np_spos;
+
+  np->np_script = script;
+  np->np_stream = NULL;
+  np->np_spos   = 0;
+
+  do
+    {
+      /* Flush any output generated by the previous line */
+
+      fflush(stdout);
 
 #ifndef CONFIG_NSH_DISABLE_LOOPS
-          /* Get the current file position.  This is used to control
-           * looping.  If a loop begins in the next line, then this file
-           * offset will be needed to locate the top of the loop in the
-           * script file.  Note that ftell will return -1 on failure.
-           */
+      /* The position in the text is the top of a loop that may begin in
+       * the next line.
+       */
 
-          vtbl->np.np_foffs = ftell(vtbl->np.np_stream);
-          vtbl->np.np_loffs = 0;
+      np->np_foffs = np->np_spos;
+      np->np_loffs = 0;
+#endif
 
-          if (vtbl->np.np_foffs < 0)
+      pret = nsh_script_gets(np, buffer);
+      if (pret)
+        {
+          if ((np->np_flags & NSH_PFLAG_SILENT) == 0)
             {
-              nsh_error(vtbl, g_fmtcmdfailed, "loop", "ftell", NSH_ERRNO);
+              nsh_output(vtbl, "%s", buffer);
             }
+
+          (*nlines)++;
+          ret = nsh_parse(vtbl, buffer);
+        }
+    }
+  while (pret && (ret == OK || (np->np_flags & NSH_PFLAG_IGNORE)));
+
+  /* Restore the parent script */
+
+  np->np_script = savescript;
+  np->np_stream = savestream;
+  np->np_spos   = savepos;
+  return ret;
+}
 #endif
 
-          /* Now read the next line from the script file */
+/****************************************************************************
+ * Name: nsh_script_file
+ *
+ * Description:
+ *   Execute a script reading it line by line from the file.
+ *
+ ****************************************************************************/
 
-          pret = fgets(buffer, CONFIG_NSH_LINELEN, vtbl->np.np_stream);
-          if (pret)
-            {
-              /* Parse process the command.  NOTE:  this is recursive...
-               * we got to cmd_source via a call to nsh_parse.  So some
-               * considerable amount of stack may be used.
-               */
+static int nsh_script_file(FAR struct nsh_vtbl_s *vtbl,
+                           FAR const char *cmd, FAR const char *fullpath,
+                           FAR char *buffer, FAR unsigned int *nlines)
+{
+  FAR FILE *savestream;
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+  FAR struct nsh_script_s *savescript;
+#endif
+  FAR char *pret;
+  int ret = ERROR;
 
-              if ((vtbl->np.np_flags & NSH_PFLAG_SILENT) == 0)
-                {
-                  nsh_output(vtbl, "%s", buffer);
-                }
+  /* Save the parent stream in case of nested script processing */
 
-              ret = nsh_parse(vtbl, buffer);
-            }
-        }
-      while (pret && (ret == OK || (vtbl->np.np_flags & NSH_PFLAG_IGNORE)));
+  savestream = vtbl->np.np_stream;
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+  savescript = vtbl->np.np_script;
+#endif
 
-      /* Close the script file */
+  /* Open the file containing the script */
 
-      fclose(vtbl->np.np_stream);
+  vtbl->np.np_stream = fopen(fullpath, "r");
+  if (!vtbl->np.np_stream)
+    {
+      nsh_error(vtbl, g_fmtcmdfailed, cmd, "fopen", NSH_ERRNO);
 
       /* Restore the parent script stream */
 
       vtbl->np.np_stream = savestream;
+      return ERROR;
+    }
+
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+  vtbl->np.np_script = NULL;
+#endif
+
+  /* Loop, processing each command line in the script file (or
+   * until an error occurs)
+   */
+
+  do
+    {
+      /* Flush any output generated by the previous line */
+
+      fflush(stdout);
+
+#ifndef CONFIG_NSH_DISABLE_LOOPS
+      /* Get the current file position.  This is used to control
+       * looping.  If a loop begins in the next line, then this file
+       * offset will be needed to locate the top of the loop in the
+       * script file.  Note that ftell will return -1 on failure.
+       */
+
+      vtbl->np.np_foffs = ftell(vtbl->np.np_stream);
+      vtbl->np.np_loffs = 0;
+
+      if (vtbl->np.np_foffs < 0)
+        {
+          nsh_error(vtbl, g_fmtcmdfailed, "loop", "ftell", NSH_ERRNO);
+        }
+#endif
+
+      /* Now read the next line from the script file */
+
+      pret = fgets(buffer, CONFIG_NSH_LINELEN, vtbl->np.np_stream);
+      if (pret)
+        {
+          /* Parse process the command.  NOTE:  this is recursive...
+           * we got to cmd_source via a call to nsh_parse.  So some
+           * considerable amount of stack may be used.
+           */
+
+          if ((vtbl->np.np_flags & NSH_PFLAG_SILENT) == 0)
+            {
+              nsh_output(vtbl, "%s", buffer);
+            }
+
+          (*nlines)++;
+          ret = nsh_parse(vtbl, buffer);
+        }
+    }
+  while (pret && (ret == OK || (vtbl->np.np_flags & NSH_PFLAG_IGNORE)));
+
+  /* Close the script file */
+
+  fclose(vtbl->np.np_stream);
+
+  /* Restore the parent script stream */
+
+  vtbl->np.np_stream = savestream;
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+  vtbl->np.np_script = savescript;
+#endif
+  return ret;
+}
+
+/****************************************************************************
+ * Name: nsh_script_report
+ *
+ * Description:
+ *   Report how long a script took to run and where it was run from.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_NSH_SCRIPT_TIMING
+static void nsh_script_report(FAR struct nsh_vtbl_s *vtbl,
+                              FAR const char *cmd, FAR const char *path,
+                              FAR const char *from, unsigned int nlines,
+                              FAR const struct timespec *start)
+{
+  struct timespec end;
+  unsigned long usec;
+
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  usec = (end.tv_sec - start->tv_sec) * 1000000 +
+         (end.tv_nsec - start->tv_nsec) / 1000;
+
+  nsh_output(vtbl, "%s: %s: %u lines in %lu usec from %s\n",
+             cmd, path, nlines, usec, from);
+}
+#endif
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: nsh_script
+ *
+ * Description:
+ *   Execute the NSH script at path.
+ *
+ ****************************************************************************/
+
+int nsh_script(FAR struct nsh_vtbl_s *vtbl, FAR const FAR char *cmd,
+               FAR const char *path)
+{
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+  FAR struct nsh_script_s *script;
+  bool cached;
+#endif
+#ifdef CONFIG_NSH_SCRIPT_TIMING
+  FAR const char *from = "file";
+  struct timespec start;
+#endif
+  unsigned int nlines = 0;
+  FAR char *fullpath;
+  FAR char *buffer;
+  int ret = ERROR;
+
+#ifdef CONFIG_NSH_SCRIPT_TIMING
+  clock_gettime(CLOCK_MONOTONIC, &start);
+#endif
+
+  /* The path to the script may relative to the current working directory */
+
+  fullpath = nsh_getfullpath(vtbl, path);
+  if (!fullpath)
+    {
+      return ERROR;
+    }
+
+  /* Get a reference to the common input buffer */
+
+  buffer = nsh_linebuffer(vtbl);
+  if (buffer)
+    {
+#ifdef CONFIG_NSH_SCRIPT_CACHE
+      /* Run the script from memory if it can be cached */
+
+      script = nsh_script_load(fullpath, &cached);
+      if (script != NULL)
+        {
+#ifdef CONFIG_NSH_SCRIPT_TIMING
+          from = cached ? "cache" : "memory";
+#endif
+          ret = nsh_script_memory(vtbl, script, buffer, &nlines);
+
+          nsh_script_lock();
+          nsh_script_release(script);
+          nsh_script_unlock();
+        }
+      else
+#endif
+        {
+          ret = nsh_script_file(vtbl, cmd, fullpath, buffer, &nlines);
+        }
+
+#ifdef CONFIG_NSH_SCRIPT_TIMING
+      nsh_script_report(vtbl, cmd, fullpath, from, nlines, &start);
+#endif
     }
 
   /* Free the allocated path */
@@ -0,0 +1,562 @@
+/****************************************************************************
+ * apps/system/codecspeed/codecspeed_main.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+#include "netutils/base64.h"
+#include "netutils/md5.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define CODECSPEED_PREFIX "Codec Speed: "
+
+/* Chunk size for the incremental base64 runs.  Deliberately not a
+ * multiple of 3 or 4, so that groups span calls.
+ */
+
+#define CODECSPEED_CHUNK  61
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct codecspeed_s
+{
+  FAR uint8_t *data;       /* Input, offset by one byte with -u */
+  FAR uint8_t *text;       /* base64 of data */
+  FAR uint8_t *out;        /* Scratch output */
+  FAR uint8_t *ref;        /* Scratch output of the reference code */
+  size_t size;             /* Bytes of data */
+  size_t textlen;          /* Characters of text */
+  uint32_t repeat_num;
+  bool unaligned;
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: show_usage
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname, int exitcode)
+{
+  printf("\nUsage: %s -s <decimal-size>[4096] -n <decimal-repeat>[1000]"
+         " -u\n", progname);
+  printf("\nWhere:\n");
+  printf("  -s <decimal-size> bytes of data per run.\n");
+  printf("  -n <decimal-repeat> number of runs.\n");
+  printf("  -u use a buffer that is not word aligned.\n");
+  exit(exitcode);
+}
+
+/****************************************************************************
+ * Name: get_time_us
+ ****************************************************************************/
+
+static uint64_t get_time_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/****************************************************************************
+ * Name: print_rate
+ ****************************************************************************/
+
+static void print_rate(uint64_t bytes, uint64_t us)
+{
+  uint64_t rate;
+
+  if (us == 0)
+    {
+      us = 1;
+    }
+
+  /* Bytes per microsecond is MB/s; keep two decimals */
+
+  rate = bytes * 100 / us;
+  printf(" %7" PRIu64 ".%02" PRIu64, rate / 100, rate % 100);
+}
+
+/****************************************************************************
+ * Name: report
+ ****************************************************************************/
+
+static void report(FAR const char *name, uint64_t bytes, uint64_t ref_us,
+                   uint64_t new_us)
+{
+  printf("%-18s", name);
+  if (ref_us > 0)
+    {
+      print_rate(bytes, ref_us);
+    }
+  else
+    {
+      printf(" %10s", "-");
+    }
+
+  print_rate(bytes, new_us);
+  if (ref_us > 0)
+    {
+      /* Times the old rate, two decimals */
+
+      ref_us = ref_us * 100 / (new_us > 0 ? new_us : 1);
+      printf(" %5" PRIu64 ".%02" PRIu64 "x", ref_us / 100, ref_us % 100);
+    }
+
+  printf("\n");
+}
+
+#ifdef CONFIG_CODECS_HASH_MD5
+
+/****************************************************************************
+ * Name: ref_md5
+ *
+ * Description:
+ *   MD5 as md5_update() used to do it: every block is copied into the
+ *   context and byte-reversed in place on big-endian CPUs before
+ *   md5_transform().  The padding is left to the current code, since it
+ *   only runs once per message.
+ *
+ ****************************************************************************/
+
+static void ref_md5(FAR const uint8_t *buf, size_t len,
+                    FAR uint8_t *digest)
+{
+  struct md5_context_s ctx;
+  size_t done;
+#ifdef CONFIG_ENDIAN_BIG
+  FAR uint8_t *p;
+  uint32_t t;
+  int i;
+#endif
+
+  md5_init(&ctx);
+  for (done = 0; len - done >= 64; done += 64)
+    {
+      memcpy(ctx.in, &buf[done], 64);
+#ifdef CONFIG_ENDIAN_BIG
+      for (i = 0, p = ctx.in; i < 16; i++, p += 4)
+        {
+          t = (uint32_t)p[3] << 24 | (uint32_t)p[2] << 16 |
+              (uint32_t)p[1] << 8 | p[0];
+          *(FAR uint32_t *)p = t;
+        }
+#endif
+
+      md5_transform(ctx.buf, (FAR uint32_t *)ctx.in);
+    }
+
+  ctx.bits[0] = (uint32_t)done << 3;
+  ctx.bits[1] = (uint32_t)((uint64_t)done >> 29);
+  md5_update(&ctx, &buf[done], len - done);
+  md5_final(digest, &ctx);
+}
+
+/****************************************************************************
+ * Name: test_md5
+ ****************************************************************************/
+
+static int test_md5(FAR struct codecspeed_s *cs)
+{
+  uint64_t ref_us;
+  uint64_t new_us;
+  uint64_t start;
+  uint32_t i;
+
+  ref_md5(cs->data, cs->size, cs->ref);
+  md5_sum(cs->data, cs->size, cs->out);
+  if (memcmp(cs->ref, cs->out, 16) != 0)
+    {
+      printf(CODECSPEED_PREFIX "md5 digests differ\n");
+      return -1;
+    }
+
+  start = get_time_us();
+  for (i = 0; i < cs->repeat_num; i++)
+    {
+      ref_md5(cs->data, cs->size, cs->ref);
+    }
+
+  ref_us = get_time_us() - start;
+
+  start = get_time_us();
+  for (i = 0; i < cs->repeat_num; i++)
+    {
+      md5_sum(cs->data, cs->size, cs->out);
+    }
+
+  new_us = get_time_us() - start;
+
+  report("md5", (uint64_t)cs->size * cs->repeat_num, ref_us, new_us);
+  return 0;
+}
+#endif /* CONFIG_CODECS_HASH_MD5 */
+
+#ifdef CONFIG_CODECS_BASE64
+
+/****************************************************************************
+ * Name: ref_base64_encode
+ *
+ * Description:
+ *   base64_encode() before it worked on 3-byte words.
+ *
+ ****************************************************************************/
+
+static size_t ref_base64_encode(FAR const uint8_t *in, size_t len,
+                                FAR uint8_t *pos)
+{
+  static FAR const char *tab =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  FAR const uint8_t *end = in + len;
+  FAR uint8_t *out = pos;
+
+  while (end - in >= 3)
+    {
+      *pos++ = tab[in[0] >> 2];
+      *pos++ = tab[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+      *pos++ = tab[((in[1] & 0x0f) << 2) | (in[2] >> 6)];
+      *pos++ = tab[in[2] & 0x3f];
+      in += 3;
+    }
+
+  if (end - in != 0)
+    {
+      *pos++ = tab[in[0] >> 2];
+      if (end - in == 1)
+        {
+          *pos++ = tab[(in[0] & 0x03) << 4];
+          *pos++ = '=';
+        }
+      else
+        {
+          *pos++ = tab[((in[0] & 0x03) << 4) | (in[1] >> 4)];
+          *pos++ = tab[(in[1] & 0x0f) << 2];
+        }
+
+      *pos++ = '=';
+    }
+
+  return pos - out;
+}
+
+/****************************************************************************
+ * Name: ref_base64_decode
+ *
+ * Description:
+ *   base64_decode() before it used a decoding table: one strchr() through
+ *   the alphabet per character.
+ *
+ ****************************************************************************/
+
+static size_t ref_base64_decode(FAR const uint8_t *src, size_t len,
+                                FAR uint8_t *pos)
+{
+  static FAR const char *tab =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+  FAR uint8_t *out = pos;
+  uint8_t block[4];
+  FAR char *tmp;
+  size_t count = 0;
+  size_t i;
+
+  for (i = 0; i < len; i++)
+    {
+      tmp = strchr(tab, src[i]);
+      block[count] = tmp ? tmp - tab : 0;
+      count++;
+
+      if (count == 4)
+        {
+          *pos++ = (block[0] << 2) | (block[1] >> 4);
+          if (src[i - 1] == '=')
+            {
+              break;
+            }
+
+          *pos++ = (block[1] << 4) | (block[2] >> 2);
+          if (src[i] == '=')
+            {
+              break;
+            }
+
+          *pos++ = (block[2] << 6) | block[3];
+          count = 0;
+        }
+    }
+
+  return pos - out;
+}
+
+/****************************************************************************
+ * Name: stream_encode
+ ****************************************************************************/
+
+static size_t stream_encode(FAR const uint8_t *in, size_t len,
+                            FAR uint8_t *out)
+{
+  struct base64_context_s ctx;
+  size_t chunk;
+  size_t n = 0;
+
+  base64_encode_init(&ctx, false);
+  while (len > 0)
+    {
+      chunk = len < CODECSPEED_CHUNK ? len : CODECSPEED_CHUNK;
+      n    += base64_encode_update(&ctx, in, chunk, &out[n]);
+      in   += chunk;
+      len  -= chunk;
+    }
+
+  return n + base64_encode_final(&ctx, &out[n]);
+}
+
+/****************************************************************************
+ * Name: stream_decode
+ ****************************************************************************/
+
+static size_t stream_decode(FAR const uint8_t *in, size_t len,
+                            FAR uint8_t *out)
+{
+  struct base64_context_s ctx;
+  size_t chunk;
+  size_t n = 0;
+
+  base64_decode_init(&ctx, false);
+  while (len > 0)
+    {
+      chunk = len < CODECSPEED_CHUNK ? len : CODECSPEED_CHUNK;
+      n    += base64_decode_update(&ctx, in, chunk, &out[n]);
+      in   += chunk;
+      len  -= chunk;
+    }
+
+  return n + base64_decode_final(&ctx, &out[n]);
+}
+
+/****************************************************************************
+ * Name: test_base64
+ ****************************************************************************/
+
+static int test_base64(FAR struct codecspeed_s *cs)
+{
+  uint64_t bytes = (uint64_t)cs->size * cs->repeat_num;
+  uint64_t ref_us;
+  uint64_t new_us;
+  uint64_t start;
+  size_t len;
+  uint32_t i;
+
+  /* Check that the versions agree before timing them */
+
+  if (ref_base64_encode(cs->data, cs->size, cs->ref) != cs->textlen ||
+      memcmp(cs->ref, cs->text, cs->textlen) != 0 ||
+      stream_encode(cs->data, cs->size, cs->out) != cs->textlen ||
+      memcmp(cs->out, cs->text, cs->textlen) != 0)
+    {
+      printf(CODECSPEED_PREFIX "base64 encodings differ\n");
+      return -1;
+    }
+
+  base64_decode(cs->text, cs->textlen, cs->out, &len);
+  if (ref_base64_decode(cs->text, cs->textlen, cs->ref) != cs->size ||
+      len != cs->size || memcmp(cs->ref, cs->data, cs->size) != 0 ||
+      memcmp(cs->out, cs->data, cs->size) != 0 ||
+      stream_decode(cs->text, cs->textlen, cs->out) != cs->size ||
+      memcmp(cs->out, cs->data, cs->size) != 0)
+    {
+      printf(CODECSPEED_PREFIX "base64 decodings differ\n");
+      return -1;
+    }
+
+  start = get_time_us();
+  for (i = 0; i < cs->repeat_num; i++)
+    {
+      ref_base64_encode(cs->data, cs->size, cs->ref);
+    }
+
+  ref_us = get_time_us() - start;
+
+  start = get_time_us();
+  for (i = 0; i < cs->repeat_num; i++)
+    {
+      base64_encode(cs->data, cs->size, cs->out, &len);
+    }
+
+  new_us = get_time_us() - start;
+  report("base64 encode", bytes, ref_us, new_us);
+
+  start = get_time_us();
+  for (i = 0; i < cs->repeat_num; i++)
+    {
+      stream_encode(cs->data, cs->size, cs->out);
+    }
+
+  new_us = get_time_us() - start;
+  report("base64 enc stream", bytes, ref_us, new_us);
+
+  /* Decoding rates are per byte of decoded data, like the encoding */
+
+  start = get_time_us();
+  for (i = 0; i < cs->repeat_num; i++)
+    {
+      ref_base64_decode(cs->text, cs->textlen, cs->ref);
+    }
+
+  ref_us = get_time_us() - start;
+
+  start = get_time_us();
+  for (i = 0; i < cs->repeat_num; i++)
+    {
+      base64_decode(cs->text, cs->textlen, cs->out, &len);
+    }
+
+  new_us = get_time_us() - start;
+  report("base64 decode", bytes, ref_us, new_us);
+
+  start = get_time_us();
+  for (i = 0; i < cs->repeat_num; i++)
+    {
+      stream_decode(cs->text, cs->textlen, cs->out);
+    }
+
+  new_us = get_time_us() - start;
+  report("base64 dec stream", bytes, ref_us, new_us);
+  return 0;
+}
+#endif /* CONFIG_CODECS_BASE64 */
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * codecspeed_main
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct codecspeed_s cs;
+  FAR uint8_t *alloc;
+  size_t outsize;
+  size_t i;
+  int ret = 0;
+  int ch;
+
+  memset(&cs, 0, sizeof(cs));
+  cs.size       = 4096;
+  cs.repeat_num = 1000;
+
+  while ((ch = getopt(argc, argv, "s:n:uh")) != ERROR)
+    {
+      switch (ch)
+        {
+          case 's':
+            cs.size = strtoul(optarg, NULL, 10);
+            break;
+
+          case 'n':
+            cs.repeat_num = strtoul(optarg, NULL, 10);
+            break;
+
+          case 'u':
+            cs.unaligned = true;
+            break;
+
+          case 'h':
+            show_usage(argv[0], EXIT_SUCCESS);
+            break;
+
+          default:
+            printf(CODECSPEED_PREFIX "Unknown option: %c\n", (char)optopt);
+            show_usage(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+
+  if (cs.size == 0 || cs.repeat_num == 0)
+    {
+      printf(CODECSPEED_PREFIX "<size> and <repeat> must be > 0\n");
+      show_usage(argv[0], EXIT_FAILURE);
+    }
+
+  /* One allocation for the data, its encoding and two output buffers */
+
+#ifdef CONFIG_CODECS_BASE64
+  cs.textlen = base64_encode_length(cs.size);
+#endif
+  outsize    = cs.textlen + 16;
+
+  alloc = malloc(cs.size + 1 + 3 * outsize);
+  if (alloc == NULL)
+    {
+      printf(CODECSPEED_PREFIX "Out of memory\n");
+      return EXIT_FAILURE;
+    }
+
+  cs.data = alloc + (cs.unaligned ? 1 : 0);
+  cs.text = alloc + cs.size + 1;
+  cs.out  = cs.text + outsize;
+  cs.ref  = cs.out + outsize;
+
+  srand(1);
+  for (i = 0; i < cs.size; i++)
+    {
+      cs.data[i] = rand();
+    }
+
+#ifdef CONFIG_CODECS_BASE64
+  base64_encode(cs.data, cs.size, cs.text, NULL);
+#endif
+
+  printf("%" PRIu32 " runs of %zu bytes%s\n", cs.repeat_num, cs.size,
+         cs.unaligned ? ", unaligned" : "");
+  printf("%-18s %10s %10s %8s\n", "MB/s", "before", "now", "speedup");
+
+#ifdef CONFIG_CODECS_HASH_MD5
+  ret |= test_md5(&cs);
+#endif
+
+#ifdef CONFIG_CODECS_BASE64
+  ret |= test_base64(&cs);
+#endif
+
+  free(alloc);
+  return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
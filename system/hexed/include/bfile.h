@@ -54,12 +54,34 @@
 /* Buffered File flags */
 
 #define BFILE_FL_DIRTY 0x00000001
+#define BFILE_FL_PAGED 0x00000002
+
+/* Paged mode piece types */
+
+#define BFILE_PIECE_FILE    0   /* Data from the file */
+#define BFILE_PIECE_JOURNAL 1   /* Data from the journal */
+#define BFILE_PIECE_ZERO    2   /* Zero fill past the old end of file */
 
 /****************************************************************************
  * Public Types
  ****************************************************************************/
 
-/* Buffered File */
+/* Paged mode: a range of the file contents */
+
+struct bfile_piece_s
+{
+  long off;                 /* Offset in the file or the journal */
+  long len;                 /* Length in bytes */
+  int type;                 /* BFILE_PIECE_* */
+};
+
+/* Buffered File
+ *
+ * Small files are read into buf and edited there.  Large files are opened
+ * in paged mode: the contents are described by a list of pieces that refer
+ * to the file on disk or to data appended to a journal kept in buf.  The
+ * file is read a page at a time and only rewritten by bfflush().
+ */
 
 struct bfile_s
 {
@@ -69,6 +91,16 @@ struct bfile_s
   int flags;
   long bufsz;
   FAR char *buf;
+
+  /* Paged mode */
+
+  long journal;             /* Bytes of buf used by the journal */
+  FAR struct bfile_piece_s *pieces;
+  int npieces;
+  int maxpieces;
+  FAR char *page;           /* Window onto the file */
+  long pageoff;
+  long pagelen;
 };
 
 /****************************************************************************
@@ -83,6 +115,7 @@ long   bfclip(FAR struct bfile_s *bf, long off, long sz);
 long   bfcopy(FAR struct bfile_s *bf, long dest, long src, long sz);
 long   bfinsert(FAR struct bfile_s *bf, long off, FAR void *mem, long sz);
 long   bfmove(FAR struct bfile_s *bf, long dest, long src, long sz);
+long   bfpeek(FAR struct bfile_s *bf, long off, FAR void *mem, long sz);
 long   bfread(FAR struct bfile_s *bf);
 long   bftruncate(FAR struct bfile_s *bf, long sz);
 long   bfwrite(FAR struct bfile_s *bf, long off, FAR void *mem, long sz);
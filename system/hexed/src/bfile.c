@@ -36,13 +36,23 @@
  * Included Files
  ****************************************************************************/
 
+#include <sys/stat.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <errno.h>
 
 #include "bfile.h"
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Paged mode piece table growth */
+
+#define BFILE_PIECES_GULP 16
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -102,10 +112,615 @@ static int bffree(FAR struct bfile_s *bf)
       free(bf->name);
     }
 
+  /* Free paged mode data */
+
+  if (bf->pieces != NULL)
+    {
+      free(bf->pieces);
+    }
+
+  if (bf->page != NULL)
+    {
+      free(bf->page);
+    }
+
   free(bf);
   return 0;
 }
 
+/* Paged mode: make room for n more pieces */
+
+static int bfpreserve(FAR struct bfile_s *bf, int n)
+{
+  FAR struct bfile_piece_s *pieces;
+  int maxpieces;
+
+  if (bf->npieces + n <= bf->maxpieces)
+    {
+      return 0;
+    }
+
+  maxpieces = bf->npieces + n + BFILE_PIECES_GULP;
+  pieces    = realloc(bf->pieces, maxpieces * sizeof(struct bfile_piece_s));
+  if (pieces == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  bf->pieces    = pieces;
+  bf->maxpieces = maxpieces;
+  return 0;
+}
+
+/* Paged mode: describe the file as it is on disk */
+
+static long bfpreset(FAR struct bfile_s *bf)
+{
+  bf->size     = fsize(bf->fp);
+  bf->npieces  = 0;
+  bf->pagelen  = 0;
+  bf->flags   &= ~BFILE_FL_DIRTY;
+
+  /* Drop the journal */
+
+  if (bf->buf != NULL)
+    {
+      free(bf->buf);
+      bf->buf = NULL;
+    }
+
+  bf->bufsz   = 0;
+  bf->journal = 0;
+
+  /* One piece for the whole file */
+
+  if (bf->size > 0)
+    {
+      if (bfpreserve(bf, 1) < 0)
+        {
+          return EOF;
+        }
+
+      bf->pieces[0].off  = 0;
+      bf->pieces[0].len  = bf->size;
+      bf->pieces[0].type = BFILE_PIECE_FILE;
+      bf->npieces        = 1;
+    }
+
+  return bf->size;
+}
+
+/* Paged mode: split the pieces at off
+ *
+ * Returns the index of the piece that starts at off.  There must be room
+ * for one more piece and off must not be past EOF.
+ */
+
+static int bfpsplit(FAR struct bfile_s *bf, long off)
+{
+  FAR struct bfile_piece_s *pc;
+  long pos = 0;
+  int i;
+
+  for (i = 0; i < bf->npieces; i++)
+    {
+      pc = &bf->pieces[i];
+      if (off == pos)
+        {
+          return i;
+        }
+
+      if (off < pos + pc->len)
+        {
+          memmove(pc + 1, pc, (bf->npieces - i) * sizeof(*pc));
+          bf->npieces++;
+
+          pc[0].len  = off - pos;
+          pc[1].len -= off - pos;
+          if (pc[1].type != BFILE_PIECE_ZERO)
+            {
+              pc[1].off += off - pos;
+            }
+
+          return i + 1;
+        }
+
+      pos += pc->len;
+    }
+
+  return bf->npieces;
+}
+
+/* Paged mode: join neighbouring pieces that continue each other */
+
+static void bfpmerge(FAR struct bfile_s *bf)
+{
+  FAR struct bfile_piece_s *pc = bf->pieces;
+  int n = 0;
+  int i;
+
+  for (i = 0; i < bf->npieces; i++)
+    {
+      if (pc[i].len == 0)
+        {
+          continue;
+        }
+
+      if (n > 0 && pc[n - 1].type == pc[i].type &&
+          (pc[i].type == BFILE_PIECE_ZERO ||
+           pc[n - 1].off + pc[n - 1].len == pc[i].off))
+        {
+          pc[n - 1].len += pc[i].len;
+        }
+      else
+        {
+          pc[n++] = pc[i];
+        }
+    }
+
+  bf->npieces = n;
+}
+
+/* Paged mode: insert pieces at off
+ *
+ * The file is zero filled up to off if off is past EOF.
+ */
+
+static long bfpinsert(FAR struct bfile_s *bf, long off,
+                      FAR const struct bfile_piece_s *pcs, int n)
+{
+  FAR struct bfile_piece_s *pc;
+  long sz = 0;
+  int i;
+
+  if (bfpreserve(bf, n + 2) < 0)
+    {
+      return EOF;
+    }
+
+  /* Zero fill from EOF */
+
+  if (off > bf->size)
+    {
+      pc       = &bf->pieces[bf->npieces++];
+      pc->off  = 0;
+      pc->len  = off - bf->size;
+      pc->type = BFILE_PIECE_ZERO;
+      bf->size = off;
+    }
+
+  /* Insert the pieces */
+
+  i  = bfpsplit(bf, off);
+  pc = &bf->pieces[i];
+  memmove(pc + n, pc, (bf->npieces - i) * sizeof(*pc));
+  memcpy(pc, pcs, n * sizeof(*pc));
+  bf->npieces += n;
+
+  for (i = 0; i < n; i++)
+    {
+      sz += pcs[i].len;
+    }
+
+  bf->size  += sz;
+  bf->flags |= BFILE_FL_DIRTY;
+  bfpmerge(bf);
+  return sz;
+}
+
+/* Paged mode: remove sz bytes at off, which must be within the file */
+
+static int bfpremove(FAR struct bfile_s *bf, long off, long sz)
+{
+  int i;
+  int j;
+
+  if (bfpreserve(bf, 2) < 0)
+    {
+      return -ENOMEM;
+    }
+
+  i = bfpsplit(bf, off);
+  j = bfpsplit(bf, off + sz);
+  memmove(&bf->pieces[i], &bf->pieces[j],
+          (bf->npieces - j) * sizeof(struct bfile_piece_s));
+
+  bf->npieces -= j - i;
+  bf->size    -= sz;
+  bf->flags   |= BFILE_FL_DIRTY;
+  bfpmerge(bf);
+  return 0;
+}
+
+/* Paged mode: copy the pieces that make up sz bytes at off
+ *
+ * The range must be within the file and not empty.  The copy must be freed
+ * by the caller.
+ */
+
+static FAR struct bfile_piece_s *bfpextract(FAR struct bfile_s *bf,
+                                            long off, long sz, FAR int *n)
+{
+  FAR struct bfile_piece_s *pcs;
+  int i;
+  int j;
+
+  if (bfpreserve(bf, 2) < 0)
+    {
+      return NULL;
+    }
+
+  i = bfpsplit(bf, off);
+  j = bfpsplit(bf, off + sz);
+
+  pcs = malloc((j - i) * sizeof(struct bfile_piece_s));
+  if (pcs != NULL)
+    {
+      memcpy(pcs, &bf->pieces[i], (j - i) * sizeof(struct bfile_piece_s));
+      *n = j - i;
+    }
+
+  bfpmerge(bf);
+  return pcs;
+}
+
+/* Paged mode: append data to the journal
+ *
+ * Returns the offset of the data in the journal.
+ */
+
+static long bfpjournal(FAR struct bfile_s *bf, FAR const void *mem, long sz)
+{
+  long off = bf->journal;
+
+  if (bf->bufsz < off + sz)
+    {
+      if (bfallocbuf(bf, off + sz) == NULL)
+        {
+          return EOF;
+        }
+    }
+
+  memcpy(bf->buf + off, mem, sz);
+  bf->journal += sz;
+  return off;
+}
+
+/* Paged mode: read data from the file through the page */
+
+static long bfpload(FAR struct bfile_s *bf, long off, FAR char *mem,
+                    long sz)
+{
+  long cnt;
+  long len;
+
+  for (cnt = 0; cnt < sz; cnt += len)
+    {
+      /* Load the page holding off */
+
+      if (off < bf->pageoff || off >= bf->pageoff + bf->pagelen)
+        {
+          bf->pageoff = off - off % BFILE_BUF_MIN;
+          bf->pagelen = 0;
+          if (fseek(bf->fp, bf->pageoff, SEEK_SET) < 0)
+            {
+              break;
+            }
+
+          bf->pagelen = fread(bf->page, 1, BFILE_BUF_MIN, bf->fp);
+          if (off >= bf->pageoff + bf->pagelen)
+            {
+              break;
+            }
+        }
+
+      len = bf->pageoff + bf->pagelen - off;
+      if (len > sz - cnt)
+        {
+          len = sz - cnt;
+        }
+
+      memcpy(mem + cnt, bf->page + off - bf->pageoff, len);
+      off += len;
+    }
+
+  return cnt;
+}
+
+/* Paged mode: read sz bytes at off, which must be within the file */
+
+static long bfppeek(FAR struct bfile_s *bf, long off, FAR char *mem,
+                    long sz)
+{
+  FAR struct bfile_piece_s *pc;
+  long pos = 0;
+  long cnt = 0;
+  long skip;
+  long len;
+  int i;
+
+  for (i = 0; i < bf->npieces && cnt < sz; i++)
+    {
+      pc   = &bf->pieces[i];
+      pos += pc->len;
+      if (off + cnt >= pos)
+        {
+          continue;
+        }
+
+      skip = off + cnt - (pos - pc->len);
+      len  = pc->len - skip;
+      if (len > sz - cnt)
+        {
+          len = sz - cnt;
+        }
+
+      switch (pc->type)
+        {
+        case BFILE_PIECE_FILE:
+          if (bfpload(bf, pc->off + skip, mem + cnt, len) != len)
+            {
+              return EOF;
+            }
+          break;
+
+        case BFILE_PIECE_JOURNAL:
+          memcpy(mem + cnt, bf->buf + pc->off + skip, len);
+          break;
+
+        default:
+          memset(mem + cnt, 0, len);
+          break;
+        }
+
+      cnt += len;
+    }
+
+  return cnt;
+}
+
+/* Paged mode: write a piece at the current position of a stream */
+
+static int bfpput(FAR struct bfile_s *bf, FAR FILE *fp,
+                  FAR const struct bfile_piece_s *pc)
+{
+  long off = pc->off;
+  long cnt;
+  long len;
+
+  if (pc->type == BFILE_PIECE_JOURNAL)
+    {
+      len = fwrite(bf->buf + pc->off, 1, pc->len, fp);
+      return len == pc->len ? 0 : -EIO;
+    }
+
+  /* File data and zeroes go through the page */
+
+  bf->pagelen = 0;
+  if (pc->type == BFILE_PIECE_ZERO)
+    {
+      memset(bf->page, 0, BFILE_BUF_MIN);
+    }
+
+  for (cnt = pc->len; cnt > 0; cnt -= len)
+    {
+      len = cnt < BFILE_BUF_MIN ? cnt : BFILE_BUF_MIN;
+      if (pc->type == BFILE_PIECE_FILE)
+        {
+          if (fseek(bf->fp, off, SEEK_SET) < 0 ||
+              fread(bf->page, 1, len, bf->fp) != len)
+            {
+              return -EIO;
+            }
+
+          off += len;
+        }
+
+      if (fwrite(bf->page, 1, len, fp) != len)
+        {
+          return -EIO;
+        }
+    }
+
+  return 0;
+}
+
+/* Paged mode: move len bytes of the file from src to dest
+ *
+ * Works from the end when moving towards the end so that overlapping data
+ * is read before it is overwritten.
+ */
+
+static int bfpmovefile(FAR struct bfile_s *bf, long dest, long src,
+                       long len)
+{
+  long cnt;
+  long off;
+  long n;
+
+  bf->pagelen = 0;
+  for (cnt = 0; cnt < len; cnt += n)
+    {
+      n   = len - cnt < BFILE_BUF_MIN ? len - cnt : BFILE_BUF_MIN;
+      off = dest > src ? len - cnt - n : cnt;
+
+      if (fseek(bf->fp, src + off, SEEK_SET) < 0 ||
+          fread(bf->page, 1, n, bf->fp) != n ||
+          fseek(bf->fp, dest + off, SEEK_SET) < 0 ||
+          fwrite(bf->page, 1, n, bf->fp) != n)
+        {
+          return -EIO;
+        }
+    }
+
+  return 0;
+}
+
+/* Paged mode: write the file through a temporary copy
+ *
+ * Used when the file data has been reordered or duplicated, so that
+ * rewriting it in place could overwrite data that is still needed.
+ */
+
+static int bfpflushcopy(FAR struct bfile_s *bf)
+{
+  FAR char *name;
+  FAR FILE *fp;
+  int ret = 0;
+  int i;
+
+  if ((name = malloc(strlen(bf->name) + 2)) == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  sprintf(name, "%s~", bf->name);
+  if ((fp = fopen(name, "wb")) == NULL)
+    {
+      ret = -errno;
+      free(name);
+      return ret;
+    }
+
+  for (i = 0; ret == 0 && i < bf->npieces; i++)
+    {
+      ret = bfpput(bf, fp, &bf->pieces[i]);
+    }
+
+  if (fclose(fp) < 0 && ret == 0)
+    {
+      ret = -errno;
+    }
+
+  /* Replace the file with the copy */
+
+  if (ret == 0)
+    {
+      fclose(bf->fp);
+      if (rename(name, bf->name) < 0)
+        {
+          ret = -errno;
+        }
+
+      if ((bf->fp = fopen(bf->name, "r+b")) == NULL && ret == 0)
+        {
+          ret = -errno;
+        }
+    }
+
+  if (ret < 0)
+    {
+      unlink(name);
+    }
+
+  free(name);
+  return ret;
+}
+
+/* Paged mode: apply the journal to the file
+ *
+ * If the file data is still in its original order, only the parts that
+ * moved or changed are written: first data moving towards the start of the
+ * file, then data moving towards the end, then the new data.
+ */
+
+static int bfpflush(FAR struct bfile_s *bf)
+{
+  FAR struct bfile_piece_s *pc;
+  long oldsz;
+  long dest;
+  long end = 0;
+  int ret = 0;
+  int i;
+
+  oldsz = fsize(bf->fp);
+
+  for (i = 0; i < bf->npieces; i++)
+    {
+      pc = &bf->pieces[i];
+      if (pc->type == BFILE_PIECE_FILE)
+        {
+          if (pc->off < end)
+            {
+              break;
+            }
+
+          end = pc->off + pc->len;
+        }
+    }
+
+  if (i < bf->npieces)
+    {
+      struct stat st;
+
+      /* The copy is made next to the file and renamed over it, which is
+       * not possible for a device such as a flash partition.
+       */
+
+      if (fstat(fileno(bf->fp), &st) == 0 && !S_ISREG(st.st_mode))
+        {
+          fprintf(stderr, "ERROR: %s is not a regular file.  Data that "
+                  "was moved or copied can only be saved to a regular "
+                  "file, through a temporary copy.\n", bf->name);
+          return -ENOTSUP;
+        }
+
+      ret = bfpflushcopy(bf);
+    }
+  else
+    {
+      for (dest = 0, i = 0; ret == 0 && i < bf->npieces; i++)
+        {
+          pc = &bf->pieces[i];
+          if (pc->type == BFILE_PIECE_FILE && pc->off > dest)
+            {
+              ret = bfpmovefile(bf, dest, pc->off, pc->len);
+            }
+
+          dest += pc->len;
+        }
+
+      for (dest = bf->size, i = bf->npieces - 1; ret == 0 && i >= 0; i--)
+        {
+          pc    = &bf->pieces[i];
+          dest -= pc->len;
+          if (pc->type == BFILE_PIECE_FILE && pc->off < dest)
+            {
+              ret = bfpmovefile(bf, dest, pc->off, pc->len);
+            }
+        }
+
+      for (dest = 0, i = 0; ret == 0 && i < bf->npieces; i++)
+        {
+          pc = &bf->pieces[i];
+          if (pc->type != BFILE_PIECE_FILE)
+            {
+              ret = fseek(bf->fp, dest, SEEK_SET) < 0 ? -EIO :
+                    bfpput(bf, bf->fp, pc);
+            }
+
+          dest += pc->len;
+        }
+
+      /* Cut the file if it got shorter */
+
+      fflush(bf->fp);
+      if (ret == 0 && bf->size < oldsz &&
+          ftruncate(fileno(bf->fp), bf->size) < 0)
+        {
+          ret = -errno;
+        }
+    }
+
+  if (ret < 0)
+    {
+      fprintf(stderr, "ERROR: Write to file failed: %d\n", ret);
+      return ret;
+    }
+
+  return bfpreset(bf) == EOF ? -ENOMEM : OK;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -137,9 +752,22 @@ long bftruncate(FAR struct bfile_s *bf, long sz)
       return -EBADF;
     }
 
-  /* Reopen file with truncate */
+  /* A paged file is rewritten in place, then cut to size */
+
+  if (bf->flags & BFILE_FL_PAGED)
+    {
+      if (sz < bf->size)
+        {
+          bfclip(bf, sz, bf->size - sz);
+        }
+
+      return bfflush(bf);
+    }
+
+  /* Reopen file with truncate, the whole buffer must be written back */
 
   bf->fp = freopen(bf->name, "w+", bf->fp);
+  bf->flags |= BFILE_FL_DIRTY;
   return bfflush(bf);
 }
 
@@ -147,7 +775,7 @@ long bftruncate(FAR struct bfile_s *bf, long sz)
 
 int bfflush(FAR struct bfile_s *bf)
 {
-  ssize_t nread;
+  ssize_t nwritten;
   int ret = OK;
 
   if (bf == NULL)
@@ -162,17 +790,24 @@ int bfflush(FAR struct bfile_s *bf)
       return 0;
     }
 
+  /* Apply the journal of a paged file */
+
+  if (bf->flags & BFILE_FL_PAGED)
+    {
+      return bfpflush(bf);
+    }
+
   /* Write file */
 
   fseek(bf->fp, 0, SEEK_SET);
-  nread = fwrite(bf->buf, 1, bf->size, bf->fp);
-  if (nread < 0)
+  nwritten = fwrite(bf->buf, 1, bf->size, bf->fp);
+  if (nwritten < 0)
     {
       int errcode = errno;
       fprintf(stderr, "ERROR: Write to file failed: %d\n", errcode);
       ret = -errcode;
     }
-  else if (fwrite(bf->buf, 1, bf->size, bf->fp) == bf->size)
+  else if (nwritten != bf->size)
     {
       fprintf(stderr, "ERROR: Bad write size\n");
       ret = -EIO;
@@ -227,10 +862,26 @@ FAR struct bfile_s *bfopen(char *name, char *mode)
       return NULL;
     }
 
-  /* Set file buffer */
+  /* Large files are paged in rather than read into the buffer */
 
   bf->buf = NULL;
   bf->size = fsize(bf->fp);
+  if (CONFIG_SYSTEM_HEXED_PAGED_SIZE > 0 &&
+      bf->size >= CONFIG_SYSTEM_HEXED_PAGED_SIZE)
+    {
+      bf->flags |= BFILE_FL_PAGED;
+      if ((bf->page = malloc(BFILE_BUF_MIN)) == NULL ||
+          bfpreset(bf) == EOF)
+        {
+          bfclose(bf);
+          return NULL;
+        }
+
+      return bf;
+    }
+
+  /* Set file buffer */
+
   if (bfallocbuf(bf, bf->size) == NULL)
     {
       bfclose(bf);
@@ -255,7 +906,7 @@ int bfclose(FAR struct bfile_s *bf)
 
   /* Close file */
 
-  r = fclose(bf->fp);
+  r = bf->fp != NULL ? fclose(bf->fp) : EOF;
   bffree(bf);
   return r;
 }
@@ -299,6 +950,11 @@ long bfclip(FAR struct bfile_s *bf, long off, long sz)
   /* Remove from file */
 
   cnt = bf->size - (off + sz);
+  if (bf->flags & BFILE_FL_PAGED)
+    {
+      return bfpremove(bf, off, sz) < 0 ? EOF : cnt;
+    }
+
   memmove(bf->buf + off, bf->buf + off + sz, cnt);
 
   bf->size  -= sz;
@@ -316,6 +972,7 @@ long bfclip(FAR struct bfile_s *bf, long off, long sz)
 
 long bfinsert(FAR struct bfile_s *bf, long off, void *mem, long sz)
 {
+  struct bfile_piece_s pc;
   long cnt;
 
   if (bf == NULL)
@@ -330,6 +987,16 @@ long bfinsert(FAR struct bfile_s *bf, long off, void *mem, long sz)
       return EOF;
     }
 
+  /* Add the data to the journal of a paged file */
+
+  if (bf->flags & BFILE_FL_PAGED)
+    {
+      pc.off  = bfpjournal(bf, mem, sz);
+      pc.len  = sz;
+      pc.type = BFILE_PIECE_JOURNAL;
+      return pc.off == EOF ? EOF : bfpinsert(bf, off, &pc, 1);
+    }
+
   /* Increase buffer size */
 
   if (bf->bufsz < (bf->size + off + sz))
@@ -366,6 +1033,9 @@ long bfinsert(FAR struct bfile_s *bf, long off, void *mem, long sz)
 
 long bfcopy(FAR struct bfile_s *bf, long off, long src, long sz)
 {
+  FAR struct bfile_piece_s *pcs;
+  int n;
+
   if (bf == NULL)
     {
       return EOF;
@@ -378,6 +1048,25 @@ long bfcopy(FAR struct bfile_s *bf, long off, long src, long sz)
       return EOF;
     }
 
+  /* A paged file only copies the description of the data */
+
+  if (bf->flags & BFILE_FL_PAGED)
+    {
+      if (src + sz > bf->size)
+        {
+          sz = bf->size - src;
+        }
+
+      if (sz <= 0 || off < 0 || (pcs = bfpextract(bf, src, sz, &n)) == NULL)
+        {
+          return EOF;
+        }
+
+      sz = bfpinsert(bf, off, pcs, n);
+      free(pcs);
+      return sz;
+    }
+
   /* Adjust sz to EOF */
 
   if ((src > off) && (src + sz > bf->size))
@@ -408,9 +1097,11 @@ long bfcopy(FAR struct bfile_s *bf, long off, long src, long sz)
 
 long bfmove(FAR struct bfile_s *bf, long off, long src, long sz)
 {
+  FAR struct bfile_piece_s *pcs;
   long adj;
   long cnt;
   long len;
+  int n;
 
   if (bf == NULL)
     {
@@ -424,6 +1115,34 @@ long bfmove(FAR struct bfile_s *bf, long off, long src, long sz)
       return EOF;
     }
 
+  /* A paged file only moves the description of the data */
+
+  if (bf->flags & BFILE_FL_PAGED)
+    {
+      if (src + sz > bf->size)
+        {
+          sz = bf->size - src;
+        }
+
+      if (sz <= 0 || off < 0)
+        {
+          return 0;
+        }
+
+      if ((pcs = bfpextract(bf, src, sz, &n)) == NULL)
+        {
+          return EOF;
+        }
+
+      if (bfpremove(bf, src, sz) < 0 || bfpinsert(bf, off, pcs, n) < 0)
+        {
+          sz = EOF;
+        }
+
+      free(pcs);
+      return sz;
+    }
+
   /* Edjust sz to EOF */
 
   if ((src > off) && (src + sz > bf->size))
@@ -480,6 +1199,13 @@ long bfread(FAR struct bfile_s *bf)
       return EOF;
     }
 
+  /* A paged file is read on demand */
+
+  if (bf->flags & BFILE_FL_PAGED)
+    {
+      return bfpreset(bf);
+    }
+
   /* Check buffer size */
 
   bf->size = fsize(bf->fp);
@@ -509,11 +1235,35 @@ long bfread(FAR struct bfile_s *bf)
 
 long bfwrite(FAR struct bfile_s *bf, long off, void *mem, long sz)
 {
+  struct bfile_piece_s pc;
+
   if (bf == NULL)
     {
       return EOF;
     }
 
+  /* A paged file replaces the data with a piece of the journal */
+
+  if (bf->flags & BFILE_FL_PAGED)
+    {
+      if (off < 0 || sz < 0)
+        {
+          return EOF;
+        }
+
+      pc.off  = bfpjournal(bf, mem, sz);
+      pc.len  = sz;
+      pc.type = BFILE_PIECE_JOURNAL;
+      if (pc.off == EOF ||
+          (off < bf->size &&
+           bfpremove(bf, off, sz < bf->size - off ? sz : bf->size - off) < 0))
+        {
+          return EOF;
+        }
+
+      return bfpinsert(bf, off, &pc, 1);
+    }
+
   /* Increase buffer size */
 
   if (bf->bufsz < off + sz)
@@ -536,3 +1286,44 @@ long bfwrite(FAR struct bfile_s *bf, long off, void *mem, long sz)
   bf->flags |= BFILE_FL_DIRTY;
   return sz;
 }
+
+/* Peek into Buffered File
+ *
+ * Copies up to sz bytes at off to mem and returns the number of bytes
+ * copied.
+ */
+
+long bfpeek(FAR struct bfile_s *bf, long off, FAR void *mem, long sz)
+{
+  if (bf == NULL)
+    {
+      return EOF;
+    }
+
+  /* Offset past EOF */
+
+  if (off < 0 || off > bf->size)
+    {
+      return EOF;
+    }
+
+  /* Size past EOF */
+
+  if (sz > bf->size - off)
+    {
+      sz = bf->size - off;
+    }
+
+  if (sz <= 0)
+    {
+      return 0;
+    }
+
+  if (bf->flags & BFILE_FL_PAGED)
+    {
+      return bfppeek(bf, off, mem, sz);
+    }
+
+  memcpy(mem, bf->buf + off, sz);
+  return sz;
+}
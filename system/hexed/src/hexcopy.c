@@ -39,6 +39,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "bfile.h"
 #include "hexed.h"
 
@@ -58,6 +59,12 @@ static int copy(FAR struct command_s *cmd)
 
 static int copyover(FAR struct command_s *cmd)
 {
+  FAR char *buf = (FAR char *)cmd->opts.buf;
+  long cnt;
+  long len;
+  long off;
+  long n;
+
   /* Adjust length for EOF */
 
   if ((cmd->opts.src >= cmd->opts.dest) &&
@@ -66,10 +73,32 @@ static int copyover(FAR struct command_s *cmd)
       cmd->opts.bytes = g_hexfile->size - cmd->opts.src;
     }
 
-  /* Copy overwrite */
+  /* Copy overwrite in chunks, from the end if dest is after src */
+
+  for (cnt = 0; cnt < cmd->opts.bytes; cnt += len)
+    {
+      len = cmd->opts.bytes - cnt;
+      if (len > (long)sizeof(cmd->opts.buf))
+        {
+          len = sizeof(cmd->opts.buf);
+        }
+
+      off = cmd->opts.dest > cmd->opts.src ?
+            cmd->opts.bytes - cnt - len : cnt;
+
+      /* Data past EOF reads as zeroes */
+
+      n = bfpeek(g_hexfile, cmd->opts.src + off, buf, len);
+      if (n < 0)
+        {
+          n = 0;
+        }
+
+      memset(buf + n, 0, len - n);
+
+      bfwrite(g_hexfile, cmd->opts.dest + off, buf, len);
+    }
 
-  bfwrite(g_hexfile, cmd->opts.dest, g_hexfile->buf + cmd->opts.src,
-          cmd->opts.bytes);
   return 0;
 }
 
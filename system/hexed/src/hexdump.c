@@ -40,6 +40,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "bfile.h"
 #include "hexed.h"
 
@@ -51,9 +52,15 @@
 
 static int rundump(FAR struct command_s *cmd)
 {
+  union
+    {
+      uint64_t align;
+      unsigned char data[0x10];
+    } line;
+
   unsigned char *cur;
   int x, i;
-  long off, last;
+  long off, last, len;
 
   /* Error - start is past EOF */
 
@@ -78,12 +85,27 @@ static int rundump(FAR struct command_s *cmd)
 
   /* Show file */
 
-  cur  = (unsigned char *)(g_hexfile->buf + cmd->opts.src);
+  cur  = line.data;
   off  = cmd->opts.src;
   last = cmd->opts.src + cmd->opts.bytes;
 
-  for (; off < last; off += 0x10, cur += 0x10)
+  for (; off < last; off += 0x10)
     {
+      /* Fetch the line, the file may not be in memory */
+
+      len = last - off < 0x10 ? last - off : 0x10;
+      if (len < 0x10)
+        {
+          /* Words straddling the end are printed whole, keep them clean */
+
+          memset(line.data, 0, sizeof(line.data));
+        }
+
+      if (bfpeek(g_hexfile, off, cur, len) != len)
+        {
+          return EOF;
+        }
+
       printf("%08lx ", off);
 
       /* Print hex values */
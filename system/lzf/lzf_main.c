@@ -39,6 +39,7 @@
 #include <sys/stat.h>
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -50,6 +51,8 @@
 #include <limits.h>
 #include <lzf.h>
 
+#include "system/lzf_stream.h"
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -75,8 +78,10 @@ static enum
   } g_mode;
 static bool g_verbose;
 static bool g_force;
+static bool g_index;
+static long g_block;
+static int g_nworkers;
 static unsigned long g_blocksize;
-static lzf_state_t g_htab;
 static uint8_t g_buf1[MAX_BLOCKSIZE + LZF_MAX_HDR_SIZE + 16];
 static uint8_t g_buf2[MAX_BLOCKSIZE + LZF_MAX_HDR_SIZE + 16];
 
@@ -104,14 +109,17 @@ static void usage(int ret)
           " You can find more info at\n"
           "http://liblzf.plan9.de/\n"
           "\n"
-          "usage: lzf [-dufhvb] [file ...]\n\n"
+          "usage: lzf [-dufhvbijx] [file ...]\n\n"
           "-c   Compress\n"
           "-d   Decompress\n"
           "-f   Force overwrite of output file\n"
           "-h   Give this help\n"
           "-v   Verbose mode\n"
           "-b # Set blocksize (max %lu)\n"
-          "\n", (unsigned long)MAX_BLOCKSIZE);
+          "-i   Append a block index when compressing\n"
+          "-j # Compress # blocks in parallel (max %d)\n"
+          "-x # Decompress only block # of an indexed file to stdout\n"
+          "\n", (unsigned long)MAX_BLOCKSIZE, LZF_STREAM_MAXWORKERS);
 
   lzf_exit(ret);
 }
@@ -140,9 +148,9 @@ static inline ssize_t rread(int fd, FAR void *buf, size_t len)
 
 /* Returns 0 if all written else -1 */
 
-static inline ssize_t wwrite(int fd, void *buf, size_t len)
+static inline ssize_t wwrite(int fd, FAR const void *buf, size_t len)
 {
-  FAR char *b = buf;
+  FAR const char *b = buf;
   ssize_t ret;
   size_t l = len;
 
@@ -170,27 +178,104 @@ static inline ssize_t wwrite(int fd, void *buf, size_t len)
  * "ZV\0" 2-byte-usize <uncompressed data>
  * "ZV\1" 2-byte-csize 2-byte-usize <compressed data>
  * "ZV\2" 4-byte-crc32-0xdebb20e3 (NYI)
+ *
+ * With -i, the EOF is followed by a block index, see lzf_stream.h.
  */
 
+static int compress_write(FAR void *arg, FAR const void *buf, size_t len)
+{
+  return wwrite((int)(intptr_t)arg, buf, len) == -1 ? -EIO : OK;
+}
+
 static int compress_fd(int from, int to)
 {
-  FAR struct lzf_header_s *header;
+  struct lzf_stream_s stream;
   ssize_t us;
-  ssize_t len;
+  int ret;
 
   g_nread = g_nwritten = 0;
-  while ((us = rread(from, &g_buf1[LZF_MAX_HDR_SIZE], g_blocksize)) > 0)
+  ret = lzf_stream_init(&stream, g_blocksize, g_nworkers,
+                        g_index ? LZF_STREAM_INDEX : 0, compress_write,
+                        (FAR void *)(intptr_t)to);
+  if (ret < 0)
+    {
+      fprintf(stderr, "%s: cannot set up compression: %d\n",
+              g_imagename, ret);
+      return -1;
+    }
+
+  while ((us = rread(from, g_buf1, g_blocksize)) > 0)
     {
-      len = lzf_compress(&g_buf1[LZF_MAX_HDR_SIZE], us,
-                         &g_buf2[LZF_MAX_HDR_SIZE],
-                         us > 4 ? us - 4 : us, g_htab, &header);
-      if (wwrite(to, header, len) == -1)
+      ret = lzf_stream_feed(&stream, g_buf1, us);
+      if (ret < 0)
         {
-          return -1;
+          break;
         }
     }
 
-  return 0;
+  if (us < 0)
+    {
+      fprintf(stderr, "%s: read error: %d\n", g_imagename, errno);
+      ret = -EIO;
+    }
+
+  if (ret >= 0)
+    {
+      ret = lzf_stream_flush(&stream, true);
+    }
+
+  lzf_stream_deinit(&stream);
+  return ret < 0 ? -1 : 0;
+}
+
+static int extract_block(FAR const char *fname)
+{
+  struct lzf_index_s index;
+  FAR uint8_t *buf;
+  ssize_t us;
+  int ret;
+  int fd;
+
+  fd = open(fname, O_RDONLY);
+  if (fd < 0)
+    {
+      fprintf(stderr, "%s: %s: %d\n", g_imagename, fname, errno);
+      return -1;
+    }
+
+  ret = lzf_index_load(fd, &index);
+  if (ret < 0)
+    {
+      fprintf(stderr, "%s: %s: no block index: %d\n",
+              g_imagename, fname, ret);
+      goto errout_with_fd;
+    }
+
+  buf = malloc(index.blocksize);
+  if (buf == NULL)
+    {
+      ret = -ENOMEM;
+      goto errout_with_fd;
+    }
+
+  us = lzf_block_read(fd, &index, g_block, buf, index.blocksize, NULL);
+  if (us < 0)
+    {
+      fprintf(stderr, "%s: %s: block %ld of %lu: %zd\n",
+              g_imagename, fname, g_block, (unsigned long)index.nblocks,
+              us);
+      ret = us;
+    }
+  else if (wwrite(1, buf, us) == -1)
+    {
+      ret = -EIO;
+    }
+
+  free(buf);
+
+errout_with_fd:
+  close(fd);
+  return ret < 0 ? -1 : 0;
 }
 
 static int uncompress_fd(int from, int to)
@@ -472,6 +557,9 @@ int main(int argc, FAR char *argv[])
   g_mode      = COMPRESS;
   g_verbose   = false;
   g_force     = 0;
+  g_index     = false;
+  g_block     = -1;
+  g_nworkers  = CONFIG_SYSTEM_LZF_WORKERS;
   g_blocksize = BLOCKSIZE;
 
 #ifndef CONFIG_DISABLE_ENVIRON
@@ -495,7 +583,7 @@ int main(int argc, FAR char *argv[])
 
   /* Handle command line options */
 
-  while ((optc = getopt(argc, argv, "cdfhvb:")) != -1)
+  while ((optc = getopt(argc, argv, "cdfhvb:ij:x:")) != -1)
     {
       switch (optc)
         {
@@ -528,12 +616,52 @@ int main(int argc, FAR char *argv[])
 
             break;
 
+          case 'i':
+            g_index = true;
+            break;
+
+          case 'j':
+            g_nworkers = atoi(optarg);
+            if (g_nworkers < 1 || g_nworkers > LZF_STREAM_MAXWORKERS)
+              {
+                usage(1);
+              }
+
+            break;
+
+          case 'x':
+            g_block = strtol(optarg, NULL, 0);
+            if (g_block < 0)
+              {
+                usage(1);
+              }
+
+            g_mode = UNCOMPRESS;
+            break;
+
           default:
             usage(1);
             break;
         }
     }
 
+  if (g_block >= 0)
+    {
+      /* The index is at the end of the file, so stdin cannot be used */
+
+      if (optind == argc)
+        {
+          usage(1);
+        }
+
+      while (optind < argc)
+        {
+          ret |= extract_block(argv[optind++]);
+        }
+
+      lzf_exit(ret ? 1 : 0);
+    }
+
   if (optind == argc)
     {
       /* stdin stdout */
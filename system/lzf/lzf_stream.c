@@ -0,0 +1,685 @@
+/****************************************************************************
+ * apps/system/lzf/lzf_stream.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <errno.h>
+#include <lzf.h>
+
+#include "system/lzf_stream.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* lzf_compress() puts the block header in front of either buffer */
+
+#define LZF_BUFSIZE(b)  ((b) + LZF_MAX_HDR_SIZE + 16)
+
+#define LZF_INDEX_INIT  (16 * LZF_INDEX_ENTRY_SIZE)
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* One block being filled or compressed.  With a single worker, blocks are
+ * compressed by the caller of lzf_stream_feed().  Otherwise each worker
+ * has its own thread and the blocks are handed out round-robin, so the
+ * oldest outstanding block is always the one after the current one.
+ */
+
+struct lzf_worker_s
+{
+  FAR struct lzf_stream_s *stream;
+  FAR struct lzf_header_s *header;     /* Header of the compressed block */
+  FAR uint8_t *inbuf;                  /* Uncompressed data */
+  FAR uint8_t *outbuf;                 /* Compressed data */
+  size_t ulen;                         /* Uncompressed length */
+  size_t clen;                         /* Length including the header */
+  bool busy;                           /* Handed to the thread */
+  bool started;                        /* The thread is running */
+  bool quit;                           /* Tell the thread to exit */
+  pthread_t thread;
+  sem_t start;                         /* Posted with a block to compress */
+  sem_t done;                          /* Posted when it is compressed */
+  lzf_state_t htab;                    /* Compressor hash table */
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static inline void lzf_put16(FAR uint8_t *p, uint16_t value)
+{
+  p[0] = value >> 8;
+  p[1] = value;
+}
+
+static inline void lzf_put32(FAR uint8_t *p, uint32_t value)
+{
+  p[0] = value >> 24;
+  p[1] = value >> 16;
+  p[2] = value >> 8;
+  p[3] = value;
+}
+
+static inline uint16_t lzf_get16(FAR const uint8_t *p)
+{
+  return (uint16_t)p[0] << 8 | p[1];
+}
+
+static inline uint32_t lzf_get32(FAR const uint8_t *p)
+{
+  return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 |
+         (uint32_t)p[2] << 8 | p[3];
+}
+
+static void lzf_sem_wait(FAR sem_t *sem)
+{
+  while (sem_wait(sem) < 0 && errno == EINTR)
+    {
+    }
+}
+
+static void lzf_compress_block(FAR struct lzf_worker_s *worker)
+{
+  size_t ulen = worker->ulen;
+
+  worker->clen = lzf_compress(&worker->inbuf[LZF_MAX_HDR_SIZE], ulen,
+                              &worker->outbuf[LZF_MAX_HDR_SIZE],
+                              ulen > 4 ? ulen - 4 : ulen,
+                              worker->htab, &worker->header);
+}
+
+static FAR void *lzf_worker_thread(FAR void *arg)
+{
+  FAR struct lzf_worker_s *worker = arg;
+
+  for (; ; )
+    {
+      lzf_sem_wait(&worker->start);
+      if (worker->quit)
+        {
+          break;
+        }
+
+      lzf_compress_block(worker);
+      sem_post(&worker->done);
+    }
+
+  return NULL;
+}
+
+static int lzf_index_add(FAR struct lzf_stream_s *stream)
+{
+  FAR uint8_t *entry;
+  size_t used;
+
+  if (stream->nout > UINT32_MAX || stream->nin > UINT32_MAX)
+    {
+      return -EFBIG;
+    }
+
+  used = stream->nblocks * LZF_INDEX_ENTRY_SIZE;
+  if (used + LZF_INDEX_ENTRY_SIZE > stream->indexsize)
+    {
+      size_t newsize = stream->indexsize ? 2 * stream->indexsize :
+                                           LZF_INDEX_INIT;
+      FAR uint8_t *newindex = realloc(stream->index, newsize);
+
+      if (newindex == NULL)
+        {
+          return -ENOMEM;
+        }
+
+      stream->index     = newindex;
+      stream->indexsize = newsize;
+    }
+
+  entry = &stream->index[used];
+  lzf_put32(entry, stream->nout);
+  lzf_put32(entry + 4, stream->nin);
+  return OK;
+}
+
+/* Pass a compressed block to the write callback */
+
+static int lzf_stream_emit(FAR struct lzf_stream_s *stream,
+                           FAR struct lzf_worker_s *worker)
+{
+  int ret;
+
+  if ((stream->flags & LZF_STREAM_INDEX) != 0)
+    {
+      ret = lzf_index_add(stream);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  ret = stream->write(stream->arg, worker->header, worker->clen);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  stream->nin  += worker->ulen;
+  stream->nout += worker->clen;
+  stream->nblocks++;
+  return OK;
+}
+
+/* Wait for a worker to finish its block and write it out */
+
+static int lzf_stream_collect(FAR struct lzf_stream_s *stream,
+                              FAR struct lzf_worker_s *worker)
+{
+  if (!worker->busy)
+    {
+      return OK;
+    }
+
+  lzf_sem_wait(&worker->done);
+  worker->busy = false;
+  return lzf_stream_emit(stream, worker);
+}
+
+/* Compress the current block, or hand it to its worker */
+
+static int lzf_stream_submit(FAR struct lzf_stream_s *stream)
+{
+  FAR struct lzf_worker_s *worker = &stream->workers[stream->current];
+
+  worker->ulen = stream->fill;
+  stream->fill = 0;
+
+  if (stream->nworkers == 1)
+    {
+      lzf_compress_block(worker);
+      return lzf_stream_emit(stream, worker);
+    }
+
+  worker->busy = true;
+  sem_post(&worker->start);
+
+  stream->current = (stream->current + 1) % stream->nworkers;
+  return OK;
+}
+
+static int lzf_stream_trailer(FAR struct lzf_stream_s *stream)
+{
+  uint8_t footer[LZF_INDEX_FOOTER_SIZE];
+  uint8_t eof = 0;
+  int ret;
+
+  if ((stream->flags & LZF_STREAM_INDEX) == 0)
+    {
+      return OK;
+    }
+
+  ret = stream->write(stream->arg, &eof, 1);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (stream->nblocks > 0)
+    {
+      ret = stream->write(stream->arg, stream->index,
+                          stream->nblocks * LZF_INDEX_ENTRY_SIZE);
+      if (ret < 0)
+        {
+          return ret;
+        }
+    }
+
+  footer[0] = 'Z';
+  footer[1] = 'V';
+  footer[2] = 'I';
+  lzf_put16(&footer[3], stream->blocksize);
+  lzf_put32(&footer[5], stream->nblocks);
+
+  return stream->write(stream->arg, footer, sizeof(footer));
+}
+
+static int lzf_pread(int fd, FAR void *buf, size_t len, off_t offset)
+{
+  FAR uint8_t *p = buf;
+  ssize_t nread;
+
+  if (lseek(fd, offset, SEEK_SET) < 0)
+    {
+      return -errno;
+    }
+
+  while (len > 0)
+    {
+      nread = read(fd, p, len);
+      if (nread < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          return -errno;
+        }
+      else if (nread == 0)
+        {
+          return -ENODATA;
+        }
+
+      p   += nread;
+      len -= nread;
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: lzf_stream_init
+ ****************************************************************************/
+
+int lzf_stream_init(FAR struct lzf_stream_s *stream, size_t blocksize,
+                    int nworkers, int flags, lzf_stream_write_t write,
+                    FAR void *arg)
+{
+  FAR struct lzf_worker_s *worker;
+  int ret;
+  int i;
+
+  if (blocksize == 0 || blocksize > LZF_STREAM_MAXBLOCK ||
+      nworkers < 1 || nworkers > LZF_STREAM_MAXWORKERS || write == NULL)
+    {
+      return -EINVAL;
+    }
+
+  memset(stream, 0, sizeof(*stream));
+  stream->write     = write;
+  stream->arg       = arg;
+  stream->blocksize = blocksize;
+  stream->flags     = flags;
+  stream->nworkers  = nworkers;
+
+  stream->workers = calloc(nworkers, sizeof(struct lzf_worker_s));
+  if (stream->workers == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  for (i = 0; i < nworkers; i++)
+    {
+      worker         = &stream->workers[i];
+      worker->stream = stream;
+      worker->inbuf  = malloc(2 * LZF_BUFSIZE(blocksize));
+      if (worker->inbuf == NULL)
+        {
+          ret = -ENOMEM;
+          goto errout;
+        }
+
+      worker->outbuf = worker->inbuf + LZF_BUFSIZE(blocksize);
+
+      if (nworkers > 1)
+        {
+          sem_init(&worker->start, 0, 0);
+          sem_init(&worker->done, 0, 0);
+          sem_setprotocol(&worker->start, SEM_PRIO_NONE);
+          sem_setprotocol(&worker->done, SEM_PRIO_NONE);
+
+          ret = pthread_create(&worker->thread, NULL, lzf_worker_thread,
+                               worker);
+          if (ret != 0)
+            {
+              sem_destroy(&worker->start);
+              sem_destroy(&worker->done);
+              ret = -ret;
+              goto errout;
+            }
+
+          worker->started = true;
+        }
+    }
+
+  return OK;
+
+errout:
+  lzf_stream_deinit(stream);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: lzf_stream_feed
+ ****************************************************************************/
+
+int lzf_stream_feed(FAR struct lzf_stream_s *stream, FAR const void *buf,
+                    size_t len)
+{
+  FAR const uint8_t *src = buf;
+  FAR struct lzf_worker_s *worker;
+  size_t chunk;
+  int ret;
+
+  if (stream->error < 0)
+    {
+      return stream->error;
+    }
+
+  if (stream->finished)
+    {
+      return -EINVAL;
+    }
+
+  while (len > 0)
+    {
+      worker = &stream->workers[stream->current];
+
+      /* The block that was handed to this worker a round ago must be
+       * written out before the buffer can be filled again.
+       */
+
+      if (stream->fill == 0)
+        {
+          ret = lzf_stream_collect(stream, worker);
+          if (ret < 0)
+            {
+              goto errout;
+            }
+        }
+
+      chunk = stream->blocksize - stream->fill;
+      if (chunk > len)
+        {
+          chunk = len;
+        }
+
+      memcpy(&worker->inbuf[LZF_MAX_HDR_SIZE + stream->fill], src, chunk);
+      stream->fill += chunk;
+      src          += chunk;
+      len          -= chunk;
+
+      if (stream->fill == stream->blocksize)
+        {
+          ret = lzf_stream_submit(stream);
+          if (ret < 0)
+            {
+              goto errout;
+            }
+        }
+    }
+
+  return OK;
+
+errout:
+  stream->error = ret;
+  return ret;
+}
+
+/****************************************************************************
+ * Name: lzf_stream_flush
+ ****************************************************************************/
+
+int lzf_stream_flush(FAR struct lzf_stream_s *stream, bool final)
+{
+  int ret;
+  int i;
+
+  if (stream->error < 0)
+    {
+      return stream->error;
+    }
+
+  if (stream->finished)
+    {
+      return final ? OK : -EINVAL;
+    }
+
+  if (stream->fill > 0)
+    {
+      ret = lzf_stream_submit(stream);
+      if (ret < 0)
+        {
+          goto errout;
+        }
+    }
+
+  /* Collect the outstanding blocks, oldest first */
+
+  for (i = 0; i < stream->nworkers; i++)
+    {
+      ret = lzf_stream_collect(stream,
+              &stream->workers[(stream->current + i) % stream->nworkers]);
+      if (ret < 0)
+        {
+          goto errout;
+        }
+    }
+
+  if (final)
+    {
+      stream->finished = true;
+      ret = lzf_stream_trailer(stream);
+      if (ret < 0)
+        {
+          goto errout;
+        }
+    }
+
+  return OK;
+
+errout:
+  stream->error = ret;
+  return ret;
+}
+
+/****************************************************************************
+ * Name: lzf_stream_deinit
+ ****************************************************************************/
+
+void lzf_stream_deinit(FAR struct lzf_stream_s *stream)
+{
+  FAR struct lzf_worker_s *worker;
+  int i;
+
+  if (stream->workers == NULL)
+    {
+      return;
+    }
+
+  for (i = 0; i < stream->nworkers; i++)
+    {
+      worker = &stream->workers[i];
+      if (worker->started)
+        {
+          if (worker->busy)
+            {
+              lzf_sem_wait(&worker->done);
+            }
+
+          worker->quit = true;
+          sem_post(&worker->start);
+          pthread_join(worker->thread, NULL);
+
+          sem_destroy(&worker->start);
+          sem_destroy(&worker->done);
+        }
+
+      free(worker->inbuf);
+    }
+
+  free(stream->workers);
+  free(stream->index);
+
+  stream->workers = NULL;
+  stream->index   = NULL;
+}
+
+/****************************************************************************
+ * Name: lzf_index_load
+ ****************************************************************************/
+
+int lzf_index_load(int fd, FAR struct lzf_index_s *index)
+{
+  uint8_t footer[LZF_INDEX_FOOTER_SIZE];
+  off_t size;
+  off_t need;
+  int ret;
+
+  size = lseek(fd, 0, SEEK_END);
+  if (size < 0)
+    {
+      return -errno;
+    }
+
+  if (size < LZF_INDEX_FOOTER_SIZE + 1)
+    {
+      return -ENOENT;
+    }
+
+  ret = lzf_pread(fd, footer, sizeof(footer), size - sizeof(footer));
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (footer[0] != 'Z' || footer[1] != 'V' || footer[2] != 'I')
+    {
+      return -ENOENT;
+    }
+
+  index->blocksize = lzf_get16(&footer[3]);
+  index->nblocks   = lzf_get32(&footer[5]);
+
+  need = (off_t)index->nblocks * LZF_INDEX_ENTRY_SIZE +
+         LZF_INDEX_FOOTER_SIZE + 1;
+  if (index->blocksize == 0 || need > size)
+    {
+      return -EINVAL;
+    }
+
+  index->base = size - need + 1;
+  return OK;
+}
+
+/****************************************************************************
+ * Name: lzf_block_read
+ ****************************************************************************/
+
+ssize_t lzf_block_read(int fd, FAR const struct lzf_index_s *index,
+                       uint32_t block, FAR void *buf, size_t buflen,
+                       FAR off_t *uoffset)
+{
+  uint8_t entry[LZF_INDEX_ENTRY_SIZE];
+  uint8_t header[LZF_MAX_HDR_SIZE];
+  FAR uint8_t *cbuf;
+  off_t offset;
+  size_t cs;
+  size_t us;
+  int ret;
+
+  if (block >= index->nblocks)
+    {
+      return -ERANGE;
+    }
+
+  ret = lzf_pread(fd, entry, sizeof(entry),
+                  index->base + (off_t)block * LZF_INDEX_ENTRY_SIZE);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  offset = lzf_get32(entry);
+  if (uoffset != NULL)
+    {
+      *uoffset = lzf_get32(&entry[4]);
+    }
+
+  /* A type 0 header is shorter than LZF_MAX_HDR_SIZE, but a whole
+   * LZF_MAX_HDR_SIZE can always be read because the index follows.
+   */
+
+  ret = lzf_pread(fd, header, sizeof(header), offset);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  if (header[0] != 'Z' || header[1] != 'V')
+    {
+      return -EINVAL;
+    }
+
+  if (header[2] == 0)
+    {
+      us = lzf_get16(&header[3]);
+      if (us > buflen)
+        {
+          return -E2BIG;
+        }
+
+      ret = lzf_pread(fd, buf, us, offset + LZF_TYPE0_HDR_SIZE);
+      return ret < 0 ? ret : us;
+    }
+  else if (header[2] != 1)
+    {
+      return -EINVAL;
+    }
+
+  cs = lzf_get16(&header[3]);
+  us = lzf_get16(&header[5]);
+  if (us > buflen)
+    {
+      return -E2BIG;
+    }
+
+  cbuf = malloc(cs);
+  if (cbuf == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  ret = lzf_pread(fd, cbuf, cs, offset + LZF_TYPE1_HDR_SIZE);
+  if (ret >= 0 && lzf_decompress(cbuf, cs, buf, us) != us)
+    {
+      ret = -EINVAL;
+    }
+
+  free(cbuf);
+  return ret < 0 ? ret : us;
+}
@@ -24,6 +24,7 @@
 
 #include <nuttx/config.h>
 #include <nuttx/irq.h>
+#include <sys/param.h>
 #include <stdio.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -31,6 +32,13 @@
 #include <time.h>
 #include <unistd.h>
 #include <inttypes.h>
+#include <sched.h>
+
+#if defined(CONFIG_SMP) && !defined(CONFIG_DISABLE_PTHREAD)
+#  include <pthread.h>
+#  include <semaphore.h>
+#  define RAMSPEED_HAVE_ALLCPUS 1
+#endif
 
 /****************************************************************************
  * Pre-processor Definitions
@@ -50,6 +58,8 @@
 #define COPY8 *d8 = *s8; d8++; s8++;
 #define SET32(x) *d32 = x; d32++;
 #define SET8(x) *d8 = x; d8++;
+#define READ32 sum ^= *s32; s32++;
+#define CHASE p = (FAR void **)*p;
 #define REPEAT8(expr) expr expr expr expr expr expr expr expr
 
 #define OPTARG_TO_VALUE(value, type, base) \
@@ -64,6 +74,24 @@
       } \
   } while (0)
 
+/* Tests selected with -t */
+
+#define TEST_MEMCPY        (1 << 0)
+#define TEST_MEMSET        (1 << 1)
+#define TEST_READ          (1 << 2)
+#define TEST_STRIDE        (1 << 3)
+#define TEST_RANDOM        (1 << 4)
+#define TEST_LATENCY       (1 << 5)
+#define TEST_ALL           0x3f
+
+/* Tests that need the read (-r) or the write (-w) address */
+
+#define TEST_NEED_SRC      (TEST_MEMCPY | TEST_READ | TEST_STRIDE | \
+                            TEST_RANDOM)
+#define TEST_NEED_DEST     (TEST_MEMCPY | TEST_MEMSET | TEST_LATENCY)
+
+#define DEFAULT_STRIDE     64
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -73,15 +101,34 @@ struct ramspeed_s
   FAR void *dest;
   FAR const void *src;
   size_t size;
+  size_t stride;
   uint8_t value;
   uint32_t repeat_num;
+  uint32_t tests;
   bool irq_disable;
+  bool csv;
+  bool allcpus;
+  int cpu;
+  int worker;                  /* Thread number in an allcpus run */
+#ifdef RAMSPEED_HAVE_ALLCPUS
+  FAR pthread_barrier_t *barrier;
+  FAR sem_t *start;
+#endif
 };
 
 /****************************************************************************
  * Private Data
  ****************************************************************************/
 
+static const char *const g_test_names[] =
+{
+  "memcpy", "memset", "read", "stride", "random", "latency"
+};
+
+/* Keeps the results of the read tests alive */
+
+static volatile uintptr_t g_sink;
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -93,8 +140,12 @@ struct ramspeed_s
 static void show_usage(FAR const char *progname, int exitcode)
 {
   printf("\nUsage: %s -r <hex-address> -w <hex-address> -s <decimal-size>"
-         " -v <hex-value>[0x00] -n <decimal-repeat number>[100] -i\n",
-         progname);
+         " -v <hex-value>[0x00] -n <decimal-repeat number>[100] -i"
+         " -t <tests>[memcpy,memset] -S <decimal-stride>[64] -c"
+#ifdef RAMSPEED_HAVE_ALLCPUS
+         " -p"
+#endif
+         "\n", progname);
   printf("\nWhere:\n");
   printf("  -r <hex-address> read address.\n");
   printf("  -w <hex-address> write address.\n");
@@ -105,9 +156,61 @@ static void show_usage(FAR const char *progname, int exitcode)
          " [default value: 100].\n");
   printf("  -i turn off interrupts while testing"
          " [default value: false].\n");
+  printf("  -t <tests> comma separated list of memcpy, memset, read,"
+         " stride, random, latency or all [default value: memcpy,memset]."
+         "\n");
+  printf("     read, stride and random read from <read address>; latency"
+         " builds a\n"
+         "     pointer chain at <write address>.\n");
+  printf("  -S <decimal-stride> access stride of the stride and latency"
+         " tests [default value: 64].\n");
+  printf("  -c print comma separated values:"
+         " test,cpu,size,bytes,usec,kbps,nsop.\n");
+#ifdef RAMSPEED_HAVE_ALLCPUS
+  printf("  -p run simultaneously on every CPU.  CPU n uses the memory at"
+         " <address> + n * <size>.\n");
+#endif
   exit(exitcode);
 }
 
+/****************************************************************************
+ * Name: parse_tests
+ ****************************************************************************/
+
+static uint32_t parse_tests(FAR char *arg)
+{
+  FAR char *saveptr;
+  FAR char *name;
+  uint32_t tests = 0;
+  int i;
+
+  for (name = strtok_r(arg, ",", &saveptr); name != NULL;
+       name = strtok_r(NULL, ",", &saveptr))
+    {
+      if (strcmp(name, "all") == 0)
+        {
+          tests |= TEST_ALL;
+          continue;
+        }
+
+      for (i = 0; i < nitems(g_test_names); i++)
+        {
+          if (strcmp(name, g_test_names[i]) == 0)
+            {
+              tests |= 1 << i;
+              break;
+            }
+        }
+
+      if (i == nitems(g_test_names))
+        {
+          return 0;
+        }
+    }
+
+  return tests;
+}
+
 /****************************************************************************
  * Name: parse_commandline
  ****************************************************************************/
@@ -119,14 +222,10 @@ static void parse_commandline(int argc, FAR char **argv,
 
   memset(info, 0, sizeof(struct ramspeed_s));
   info->repeat_num = 100;
+  info->stride = DEFAULT_STRIDE;
+  info->tests = TEST_MEMCPY | TEST_MEMSET;
 
-  if (argc < 7)
-    {
-      printf(RAMSPEED_PREFIX "Missing required arguments\n");
-      show_usage(argv[0], EXIT_FAILURE);
-    }
-
-  while ((ch = getopt(argc, argv, "r:w:s:v:n:i")) != ERROR)
+  while ((ch = getopt(argc, argv, "r:w:s:v:n:it:S:cp")) != ERROR)
     {
       switch (ch)
         {
@@ -154,58 +253,152 @@ static void parse_commandline(int argc, FAR char **argv,
                 printf(RAMSPEED_PREFIX "<repeat number> must > 0\n");
                 exit(EXIT_FAILURE);
               }
-
+            break;
           case 'i':
             info->irq_disable = true;
             break;
+          case 't':
+            info->tests = parse_tests(optarg);
+            if (info->tests == 0)
+              {
+                printf(RAMSPEED_PREFIX "Parameter error: -%c %s\n",
+                       ch, optarg);
+                show_usage(argv[0], EXIT_FAILURE);
+              }
+            break;
+          case 'S':
+            OPTARG_TO_VALUE(info->stride, size_t, 10);
+            if (info->stride < sizeof(uintptr_t) ||
+                (info->stride & (sizeof(uintptr_t) - 1)) != 0)
+              {
+                printf(RAMSPEED_PREFIX "<stride> must be a multiple of %zu"
+                       "\n", sizeof(uintptr_t));
+                exit(EXIT_FAILURE);
+              }
+            break;
+          case 'c':
+            info->csv = true;
+            break;
+#ifdef RAMSPEED_HAVE_ALLCPUS
+          case 'p':
+            info->allcpus = true;
+            break;
+#endif
           case '?':
+          default:
             printf(RAMSPEED_PREFIX "Unknown option: %c\n", (char)optopt);
             show_usage(argv[0], EXIT_FAILURE);
             break;
         }
     }
 
-  if (info->dest == NULL || info->src == NULL || info->size == 0)
+  if (info->size == 0 ||
+      ((info->tests & TEST_NEED_SRC) != 0 && info->src == NULL) ||
+      ((info->tests & TEST_NEED_DEST) != 0 && info->dest == NULL))
     {
       printf(RAMSPEED_PREFIX "Missing required arguments\n");
       show_usage(argv[0], EXIT_FAILURE);
     }
+
+  if (info->allcpus && info->irq_disable)
+    {
+      /* enter_critical_section() would serialize the CPUs */
+
+      printf(RAMSPEED_PREFIX "-i cannot be used with -p\n");
+      exit(EXIT_FAILURE);
+    }
 }
 
 /****************************************************************************
  * Name: get_timestamp
+ *
+ * Description:
+ *   Return the current time in microseconds.
+ *
  ****************************************************************************/
 
-static uint32_t get_timestamp(void)
+static uint64_t get_timestamp(void)
 {
   struct timespec ts;
-  uint32_t ms;
+
   clock_gettime(CLOCK_MONOTONIC, &ts);
-  ms = ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
-  return ms;
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
 }
 
 /****************************************************************************
  * Name: get_time_elaps
  ****************************************************************************/
 
-static uint32_t get_time_elaps(uint32_t prev_time)
+static uint64_t get_time_elaps(uint64_t prev_time)
 {
-  uint32_t act_time = get_timestamp();
+  return get_timestamp() - prev_time;
+}
 
-  /* If there is no overflow in sys_time simple subtract */
+/****************************************************************************
+ * Name: test_begin
+ *
+ * Description:
+ *   Start one timed measurement.  With -p, every CPU waits here for the
+ *   others so that all of them measure the same step at the same time.
+ *
+ ****************************************************************************/
 
-  if (act_time >= prev_time)
+static uint64_t test_begin(FAR const struct ramspeed_s *info,
+                           FAR irqstate_t *flags)
+{
+#ifdef RAMSPEED_HAVE_ALLCPUS
+  if (info->barrier != NULL)
     {
-      prev_time = act_time - prev_time;
+      pthread_barrier_wait(info->barrier);
     }
-  else
+#endif
+
+  if (info->irq_disable)
     {
-      prev_time = UINT32_MAX - prev_time + 1;
-      prev_time += act_time;
+      *flags = enter_critical_section();
     }
 
-  return prev_time;
+  return get_timestamp();
+}
+
+/****************************************************************************
+ * Name: test_end
+ ****************************************************************************/
+
+static uint64_t test_end(FAR const struct ramspeed_s *info,
+                         uint64_t start_time, irqstate_t flags)
+{
+  uint64_t cost_time = get_time_elaps(start_time);
+
+  if (info->irq_disable)
+    {
+      leave_critical_section(flags);
+    }
+
+  return cost_time;
+}
+
+/****************************************************************************
+ * Name: print_step
+ ****************************************************************************/
+
+static void print_step(FAR const struct ramspeed_s *info, size_t step)
+{
+  /* In an allcpus run only the first thread prints the headings */
+
+  if (info->csv || (info->allcpus && info->worker != 0))
+    {
+      return;
+    }
+
+  if (step < 1024)
+    {
+      printf("______do %zu B operation______\n", step);
+    }
+  else
+    {
+      printf("______do %zu KB operation______\n", step / 1024);
+    }
 }
 
 /****************************************************************************
@@ -332,154 +525,556 @@ static void internal_memset(FAR void *dst, uint8_t v, size_t len)
 }
 
 /****************************************************************************
- * Name: print_rate
+ * Name: internal_read
+ ****************************************************************************/
+
+static uint32_t internal_read(FAR const void *src, size_t len)
+{
+  FAR const uint32_t *s32 = src;
+  uint32_t sum = 0;
+
+  while (len >= 32)
+    {
+      REPEAT8(READ32);
+      len -= 32;
+    }
+
+  while (len >= 4)
+    {
+      READ32;
+      len -= 4;
+    }
+
+  return sum;
+}
+
+/****************************************************************************
+ * Name: internal_stride_read
+ ****************************************************************************/
+
+static uint32_t internal_stride_read(FAR const void *src, size_t len,
+                                     size_t stride)
+{
+  FAR const uint8_t *s8 = src;
+  FAR const uint8_t *end = s8 + len;
+  uint32_t sum = 0;
+
+  for (; s8 < end; s8 += stride)
+    {
+      sum ^= *(FAR const uint32_t *)s8;
+    }
+
+  return sum;
+}
+
+/****************************************************************************
+ * Name: internal_random_read
+ *
+ * Description:
+ *   Read 'count' randomly chosen words of a power of two sized area.  The
+ *   addresses come from a linear congruential generator, so no table of
+ *   offsets competes with the data for the cache.
+ *
+ ****************************************************************************/
+
+static uint32_t internal_random_read(FAR const void *src, size_t len,
+                                     uint32_t count, FAR uint32_t *seed)
+{
+  FAR const uint32_t *s32 = src;
+  uint32_t mask = len / sizeof(uint32_t) - 1;
+  uint32_t x = *seed;
+  uint32_t sum = 0;
+
+  while (count-- > 0)
+    {
+      x = x * 1664525 + 1013904223;
+      sum ^= s32[(x >> 8) & mask];
+    }
+
+  *seed = x;
+  return sum;
+}
+
+/****************************************************************************
+ * Name: build_chain
+ *
+ * Description:
+ *   Link 'nodes' pointers, 'stride' bytes apart, into one cycle in random
+ *   order (Sattolo's algorithm), so that every load depends on the
+ *   previous one and no prefetcher can guess the next address.
+ *
+ ****************************************************************************/
+
+static void build_chain(FAR void *base, size_t nodes, size_t stride)
+{
+  FAR uint8_t *b8 = base;
+  uint32_t seed = 1;
+  uintptr_t tmp;
+  size_t i;
+  size_t j;
+
+#define NODE(n) (*(FAR uintptr_t *)(b8 + (n) * stride))
+
+  for (i = 0; i < nodes; i++)
+    {
+      NODE(i) = i;
+    }
+
+  for (i = nodes - 1; i > 0; i--)
+    {
+      seed = seed * 1664525 + 1013904223;
+      j = (seed >> 8) % i;
+
+      tmp     = NODE(i);
+      NODE(i) = NODE(j);
+      NODE(j) = tmp;
+    }
+
+  /* Replace the indices of the successors with their addresses */
+
+  for (i = 0; i < nodes; i++)
+    {
+      NODE(i) = (uintptr_t)(b8 + NODE(i) * stride);
+    }
+
+#undef NODE
+}
+
+/****************************************************************************
+ * Name: print_result
+ *
+ * Description:
+ *   Report one measurement.  'accesses' is zero for the bandwidth tests,
+ *   otherwise the time per access is reported as well.
+ *
  ****************************************************************************/
 
-static void print_rate(FAR const char *name, size_t bytes,
-                       uint32_t cost_time)
+static void print_result(FAR const struct ramspeed_s *info,
+                         FAR const char *name, FAR const char *id,
+                         size_t size, uint64_t bytes, uint64_t accesses,
+                         uint64_t cost_time)
 {
   uint32_t rate;
+  uint32_t nsop = 0;
+
   if (cost_time == 0)
     {
       printf(RAMSPEED_PREFIX
              "Time-consuming is too short,"
              " please increase the <repeat number>\n");
-      exit(EXIT_FAILURE);
+      return;
     }
 
-  rate = (uint64_t)bytes * 1000 / cost_time / 1024;
-  printf(RAMSPEED_PREFIX
-         "%s Rate = %" PRIu32 " KB/s\t[cost: %" PRIu32 "ms]\n",
-         name, rate, cost_time);
+  rate = (uint32_t)(bytes * 1000000 / cost_time / 1024);
+  if (accesses > 0)
+    {
+      /* In thousandths of a nanosecond */
+
+      nsop = (uint32_t)(cost_time * 1000000 / accesses);
+    }
+
+  if (info->csv)
+    {
+      printf("%s,%d,%zu,%" PRIu64 ",%" PRIu64 ",%" PRIu32 ",",
+             id, info->cpu, size, bytes, cost_time, rate);
+      if (accesses > 0)
+        {
+          printf("%" PRIu32 ".%03" PRIu32, nsop / 1000, nsop % 1000);
+        }
+
+      printf("\n");
+      return;
+    }
+
+  if (info->allcpus)
+    {
+      printf(RAMSPEED_PREFIX "CPU%d ", info->cpu);
+    }
+  else
+    {
+      printf(RAMSPEED_PREFIX);
+    }
+
+  printf("%s Rate = %" PRIu32 " KB/s\t[cost: %" PRIu32 "ms]",
+         name, rate, (uint32_t)(cost_time / 1000));
+  if (accesses > 0)
+    {
+      printf("\t[%" PRIu32 ".%03" PRIu32 " ns/access]",
+             nsop / 1000, nsop % 1000);
+    }
+
+  printf("\n");
+}
+
+/****************************************************************************
+ * Name: print_title
+ ****************************************************************************/
+
+static void print_title(FAR const struct ramspeed_s *info,
+                        FAR const char *title)
+{
+  if (!info->csv && !(info->allcpus && info->worker != 0))
+    {
+      printf("______%s______\n", title);
+    }
 }
 
 /****************************************************************************
  * Name: memcpy_speed_test
  ****************************************************************************/
 
-static void memcpy_speed_test(FAR void *dest, FAR const void *src,
-                              size_t size, uint32_t repeat_cnt,
-                              bool irq_disable)
+static void memcpy_speed_test(FAR const struct ramspeed_s *info)
 {
-  uint32_t start_time;
-  uint32_t cost_time_system;
-  uint32_t cost_time_internal;
+  uint64_t start_time;
+  uint64_t cost_time_system;
+  uint64_t cost_time_internal;
   uint32_t cnt;
-  uint32_t step;
-  size_t total_size;
-  irqstate_t flags;
+  size_t step;
+  uint64_t total_size;
+  irqstate_t flags = 0;
 
-  printf("______memcpy performance______\n");
+  print_title(info, "memcpy performance");
 
-  for (step = 32; step <= size; step <<= 1)
+  for (step = 32; step <= info->size; step <<= 1)
     {
-      total_size = step * repeat_cnt;
+      total_size = (uint64_t)step * info->repeat_num;
 
-      if (step < 1024)
-        {
-          printf("______do %" PRIu32 " B operation______\n", step);
-        }
-      else
-        {
-          printf("______do %" PRIu32  " KB operation______\n", step / 1024);
-        }
+      print_step(info, step);
+
+      start_time = test_begin(info, &flags);
 
-      if (irq_disable)
+      for (cnt = 0; cnt < info->repeat_num; cnt++)
         {
-          flags = enter_critical_section();
+          memcpy(info->dest, info->src, step);
         }
 
-      start_time = get_timestamp();
+      cost_time_system = test_end(info, start_time, flags);
 
-      for (cnt = 0; cnt < repeat_cnt; cnt++)
+      start_time = test_begin(info, &flags);
+
+      for (cnt = 0; cnt < info->repeat_num; cnt++)
         {
-          memcpy(dest, src, step);
+          internal_memcpy(info->dest, info->src, step);
         }
 
-      cost_time_system = get_time_elaps(start_time);
+      cost_time_internal = test_end(info, start_time, flags);
+
+      print_result(info, "system memcpy():\t", "memcpy_system", step,
+                   total_size, 0, cost_time_system);
+      print_result(info, "internal memcpy():\t", "memcpy_internal", step,
+                   total_size, 0, cost_time_internal);
+    }
+}
+
+/****************************************************************************
+ * Name: memset_speed_test
+ ****************************************************************************/
+
+static void memset_speed_test(FAR const struct ramspeed_s *info)
+{
+  uint64_t start_time;
+  uint64_t cost_time_system;
+  uint64_t cost_time_internal;
+  uint32_t cnt;
+  size_t step;
+  uint64_t total_size;
+  irqstate_t flags = 0;
+
+  print_title(info, "memset performance");
+
+  for (step = 32; step <= info->size; step <<= 1)
+    {
+      total_size = (uint64_t)step * info->repeat_num;
+
+      print_step(info, step);
 
-      start_time = get_timestamp();
+      start_time = test_begin(info, &flags);
 
-      for (cnt = 0; cnt < repeat_cnt; cnt++)
+      for (cnt = 0; cnt < info->repeat_num; cnt++)
         {
-          internal_memcpy(dest, src, step);
+          memset(info->dest, info->value, step);
         }
 
-      cost_time_internal = get_time_elaps(start_time);
+      cost_time_system = test_end(info, start_time, flags);
+
+      start_time = test_begin(info, &flags);
 
-      if (irq_disable)
+      for (cnt = 0; cnt < info->repeat_num; cnt++)
         {
-          leave_critical_section(flags);
+          internal_memset(info->dest, info->value, step);
         }
 
-      print_rate("system memcpy():\t", total_size, cost_time_system);
-      print_rate("internal memcpy():\t", total_size, cost_time_internal);
+      cost_time_internal = test_end(info, start_time, flags);
+
+      print_result(info, "system memset():\t", "memset_system", step,
+                   total_size, 0, cost_time_system);
+      print_result(info, "internal memset():\t", "memset_internal", step,
+                   total_size, 0, cost_time_internal);
     }
 }
 
 /****************************************************************************
- * Name: memset_speed_test
+ * Name: read_speed_test
+ *
+ * Description:
+ *   Read-only bandwidth: sequential, one word every <stride> bytes, and
+ *   randomly chosen words, over working sets doubling up to <size>.
+ *
  ****************************************************************************/
 
-static void memset_speed_test(FAR void *dest, uint8_t value,
-                              size_t size, uint32_t repeat_num,
-                              bool irq_disable)
+static void read_speed_test(FAR const struct ramspeed_s *info)
 {
-  uint32_t start_time;
-  uint32_t cost_time_system;
-  uint32_t cost_time_internal;
+  uint64_t start_time;
+  uint64_t cost_time;
+  uint64_t accesses;
+  uint32_t seed = 1;
+  uint32_t sum = 0;
   uint32_t cnt;
-  uint32_t step;
-  size_t total_size;
-  irqstate_t flags;
+  size_t step;
+  irqstate_t flags = 0;
 
-  printf("______memset performance______\n");
+  print_title(info, "read performance");
 
-  for (step = 32; step <= size; step <<= 1)
+  for (step = 32; step <= info->size; step <<= 1)
     {
-      total_size = step * repeat_num;
+      print_step(info, step);
 
-      if (step < 1024)
+      if (info->tests & TEST_READ)
         {
-          printf("______do %" PRIu32 " B operation______\n", step);
+          start_time = test_begin(info, &flags);
+
+          for (cnt = 0; cnt < info->repeat_num; cnt++)
+            {
+              sum ^= internal_read(info->src, step);
+            }
+
+          cost_time = test_end(info, start_time, flags);
+
+          accesses = (uint64_t)(step / 4) * info->repeat_num;
+          print_result(info, "sequential read:\t", "read", step,
+                       accesses * 4, accesses, cost_time);
         }
-      else
+
+      if ((info->tests & TEST_STRIDE) && step >= info->stride)
         {
-          printf("______do %" PRIu32  " KB operation______\n", step / 1024);
+          start_time = test_begin(info, &flags);
+
+          for (cnt = 0; cnt < info->repeat_num; cnt++)
+            {
+              sum ^= internal_stride_read(info->src, step, info->stride);
+            }
+
+          cost_time = test_end(info, start_time, flags);
+
+          accesses = (uint64_t)(step / info->stride) * info->repeat_num;
+          print_result(info, "strided read:\t", "stride", step,
+                       accesses * 4, accesses, cost_time);
         }
 
-      if (irq_disable)
+      if (info->tests & TEST_RANDOM)
         {
-          flags = enter_critical_section();
+          start_time = test_begin(info, &flags);
+
+          for (cnt = 0; cnt < info->repeat_num; cnt++)
+            {
+              sum ^= internal_random_read(info->src, step, step / 4,
+                                          &seed);
+            }
+
+          cost_time = test_end(info, start_time, flags);
+
+          accesses = (uint64_t)(step / 4) * info->repeat_num;
+          print_result(info, "random read:\t", "random", step,
+                       accesses * 4, accesses, cost_time);
         }
+    }
 
-      start_time = get_timestamp();
+  g_sink = sum;
+}
+
+/****************************************************************************
+ * Name: latency_test
+ *
+ * Description:
+ *   Load-to-use latency: follow a randomly ordered pointer chain with one
+ *   node every <stride> bytes over working sets doubling up to <size>.
+ *   The time per access steps up as the working set outgrows each level of
+ *   cache.
+ *
+ ****************************************************************************/
+
+static void latency_test(FAR const struct ramspeed_s *info)
+{
+  uint64_t start_time;
+  uint64_t cost_time;
+  uint64_t accesses;
+  uint64_t cnt;
+  size_t nodes;
+  size_t step;
+  irqstate_t flags = 0;
+  FAR void **p = info->dest;
+
+  print_title(info, "latency");
+
+  for (step = 32; step <= info->size; step <<= 1)
+    {
+      nodes = step / info->stride;
+      if (nodes < 2)
+        {
+          continue;
+        }
+
+      print_step(info, step);
+
+      build_chain(info->dest, nodes, info->stride);
+      p = info->dest;
+
+      /* Follow the chain <repeat num> times, eight loads per iteration */
+
+      cnt = ((uint64_t)nodes * info->repeat_num + 7) / 8;
+      accesses = cnt * 8;
+
+      start_time = test_begin(info, &flags);
+
+      while (cnt-- > 0)
+        {
+          REPEAT8(CHASE);
+        }
+
+      cost_time = test_end(info, start_time, flags);
+
+      print_result(info, "pointer chase:\t", "latency", step,
+                   accesses * sizeof(FAR void *), accesses, cost_time);
+    }
+
+  g_sink = (uintptr_t)p;
+}
+
+/****************************************************************************
+ * Name: ramspeed_run
+ ****************************************************************************/
+
+static void ramspeed_run(FAR struct ramspeed_s *info)
+{
+  info->cpu = sched_getcpu();
+
+  if (info->tests & TEST_MEMCPY)
+    {
+      memcpy_speed_test(info);
+    }
+
+  if (info->tests & TEST_MEMSET)
+    {
+      memset_speed_test(info);
+    }
+
+  if (info->tests & (TEST_READ | TEST_STRIDE | TEST_RANDOM))
+    {
+      read_speed_test(info);
+    }
+
+  if (info->tests & TEST_LATENCY)
+    {
+      latency_test(info);
+    }
+}
+
+#ifdef RAMSPEED_HAVE_ALLCPUS
+/****************************************************************************
+ * Name: ramspeed_thread
+ ****************************************************************************/
+
+static FAR void *ramspeed_thread(FAR void *arg)
+{
+  FAR struct ramspeed_s *info = arg;
+
+  /* Wait until all threads exist and the barrier is set up for them */
+
+  sem_wait(info->start);
+  ramspeed_run(info);
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: ramspeed_allcpus
+ *
+ * Description:
+ *   Run the tests on every CPU at once, each on its own <size> bytes of
+ *   the read and write areas.
+ *
+ ****************************************************************************/
 
-      for (cnt = 0; cnt < repeat_num; cnt++)
+static int ramspeed_allcpus(FAR const struct ramspeed_s *info)
+{
+  struct ramspeed_s cpuinfo[CONFIG_SMP_NCPUS];
+  pthread_t threads[CONFIG_SMP_NCPUS];
+  pthread_barrier_t barrier;
+  pthread_attr_t attr;
+  cpu_set_t cpuset;
+  sem_t start;
+  int nthreads;
+  int ret = 0;
+  int cpu;
+
+  sem_init(&start, 0, 0);
+
+  for (nthreads = 0; nthreads < CONFIG_SMP_NCPUS; nthreads++)
+    {
+      cpu = nthreads;
+      cpuinfo[cpu] = *info;
+      cpuinfo[cpu].worker = cpu;
+      cpuinfo[cpu].barrier = &barrier;
+      cpuinfo[cpu].start = &start;
+      if (info->dest != NULL)
         {
-          memset(dest, value, step);
+          cpuinfo[cpu].dest = (FAR uint8_t *)info->dest + cpu * info->size;
         }
 
-      cost_time_system = get_time_elaps(start_time);
+      if (info->src != NULL)
+        {
+          cpuinfo[cpu].src = (FAR const uint8_t *)info->src +
+                             cpu * info->size;
+        }
 
-      start_time = get_timestamp();
+      pthread_attr_init(&attr);
+      CPU_ZERO(&cpuset);
+      CPU_SET(cpu, &cpuset);
+      pthread_attr_setaffinity_np(&attr, sizeof(cpu_set_t), &cpuset);
 
-      for (cnt = 0; cnt < repeat_num; cnt++)
+      ret = pthread_create(&threads[cpu], &attr, ramspeed_thread,
+                           &cpuinfo[cpu]);
+      pthread_attr_destroy(&attr);
+      if (ret != 0)
         {
-          internal_memset(dest, value, step);
+          printf(RAMSPEED_PREFIX "CPU%d: pthread_create failed: %d\n",
+                 cpu, ret);
+          break;
         }
+    }
+
+  /* Run on the CPUs that did get a thread */
+
+  if (nthreads > 0)
+    {
+      pthread_barrier_init(&barrier, NULL, nthreads);
 
-      cost_time_internal = get_time_elaps(start_time);
+      for (cpu = 0; cpu < nthreads; cpu++)
+        {
+          sem_post(&start);
+        }
 
-      if (irq_disable)
+      for (cpu = 0; cpu < nthreads; cpu++)
         {
-          leave_critical_section(flags);
+          pthread_join(threads[cpu], NULL);
         }
 
-      print_rate("system memset():\t", total_size, cost_time_system);
-      print_rate("internal memset():\t", total_size, cost_time_internal);
+      pthread_barrier_destroy(&barrier);
     }
+
+  sem_destroy(&start);
+  return ret == 0 ? OK : ERROR;
 }
+#endif
 
 /****************************************************************************
  * Public Functions
@@ -495,13 +1090,18 @@ int main(int argc, FAR char *argv[])
 
   parse_commandline(argc, argv, &ramspeed);
 
-  memcpy_speed_test(ramspeed.dest, ramspeed.src,
-                    ramspeed.size, ramspeed.repeat_num,
-                    ramspeed.irq_disable);
+  if (ramspeed.csv)
+    {
+      printf("test,cpu,size,bytes,usec,kbps,nsop\n");
+    }
 
-  memset_speed_test(ramspeed.dest, ramspeed.value,
-                    ramspeed.size, ramspeed.repeat_num,
-                    ramspeed.irq_disable);
+#ifdef RAMSPEED_HAVE_ALLCPUS
+  if (ramspeed.allcpus)
+    {
+      return ramspeed_allcpus(&ramspeed) < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+#endif
 
+  ramspeed_run(&ramspeed);
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,947 @@
+/****************************************************************************
+ * apps/system/sysmon/sysmon.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sched.h>
+#include <time.h>
+#include <errno.h>
+
+#ifdef CONFIG_SYSTEM_SYSMON
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#ifndef CONFIG_SYSTEM_SYSMON_DAEMON_STACKSIZE
+#  define CONFIG_SYSTEM_SYSMON_DAEMON_STACKSIZE 2048
+#endif
+
+#ifndef CONFIG_SYSTEM_SYSMON_DAEMON_PRIORITY
+#  define CONFIG_SYSTEM_SYSMON_DAEMON_PRIORITY 50
+#endif
+
+#ifndef CONFIG_SYSTEM_SYSMON_INTERVAL
+#  define CONFIG_SYSTEM_SYSMON_INTERVAL 2000
+#endif
+
+#ifndef CONFIG_SYSTEM_SYSMON_STACK_THRESHOLD
+#  define CONFIG_SYSTEM_SYSMON_STACK_THRESHOLD 0
+#endif
+
+#ifndef CONFIG_SYSTEM_SYSMON_CSECTION_THRESHOLD
+#  define CONFIG_SYSTEM_SYSMON_CSECTION_THRESHOLD 0
+#endif
+
+#ifndef CONFIG_SYSTEM_SYSMON_MOUNTPOINT
+#  define CONFIG_SYSTEM_SYSMON_MOUNTPOINT "/proc"
+#endif
+
+/* The task table grows by this many entries at a time */
+
+#define SYSMON_TASK_INCR 16
+
+/* Per-CPU figures are kept in the task table with these PIDs */
+
+#define SYSMON_CPU_PID(cpu) (-1 - (cpu))
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+/* What one pass found out about a task, and what was last reported */
+
+struct sysmon_task_s
+{
+  pid_t pid;
+  bool seen;                           /* Found in the current pass */
+  uint32_t stacksize;                  /* Stack size in bytes */
+  uint32_t stackused;                  /* Stack used in bytes */
+  uint32_t preempt;                    /* Longest pre-emption disabled (us) */
+  uint32_t csection;                   /* Longest critical section (us) */
+  uint32_t run;                        /* Longest run without switch (us) */
+  char name[CONFIG_TASK_NAME_SIZE + 1];
+};
+
+struct sysmon_state_s
+{
+  volatile bool started;
+  volatile bool stop;
+  pid_t pid;
+
+  /* Options */
+
+  bool all;                            /* Report every task each pass */
+  bool csv;                            /* Output CSV instead of a table */
+  unsigned int interval;               /* Time between passes (msec) */
+  unsigned int stack_threshold;        /* Stack usage alarm (percent) */
+  uint32_t csection_threshold;         /* Critical section alarm (usec) */
+  FAR char *outfile;                   /* Output file, NULL for stdout */
+  FAR FILE *out;
+
+  /* State of the passes, allocated once and reused */
+
+  FAR struct sysmon_task_s *tasks;     /* Sorted in /proc order */
+  int ntasks;
+  int maxtasks;
+  int cursor;                          /* Where the next lookup starts */
+  bool header;                         /* Header written for this pass */
+  struct timespec now;                 /* Time of this pass */
+  char path[48];
+  char line[256];
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static struct sysmon_state_s g_sysmon;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: sysmon_check_name
+ ****************************************************************************/
+
+static bool sysmon_check_name(FAR const char *name)
+{
+  int i;
+
+  /* Task/thread entries in the /proc directory have all numeric names */
+
+  for (i = 0; i < NAME_MAX && name[i] != '\0'; i++)
+    {
+      if (!isdigit(name[i]))
+        {
+          return false;
+        }
+    }
+
+  return i > 0;
+}
+
+/****************************************************************************
+ * Name: sysmon_read
+ *
+ * Description:
+ *   Read the start of a procfs file into g_sysmon.line.  Plain open/read
+ *   are used, so no stream or path is allocated for each file.
+ *
+ ****************************************************************************/
+
+static int sysmon_read(FAR const char *dir, FAR const char *file)
+{
+  ssize_t nread;
+  int fd;
+
+  if (dir != NULL)
+    {
+      snprintf(g_sysmon.path, sizeof(g_sysmon.path),
+               CONFIG_SYSTEM_SYSMON_MOUNTPOINT "/%s/%s", dir, file);
+    }
+  else
+    {
+      snprintf(g_sysmon.path, sizeof(g_sysmon.path),
+               CONFIG_SYSTEM_SYSMON_MOUNTPOINT "/%s", file);
+    }
+
+  fd = open(g_sysmon.path, O_RDONLY);
+  if (fd < 0)
+    {
+      return -errno;
+    }
+
+  nread = read(fd, g_sysmon.line, sizeof(g_sysmon.line) - 1);
+  if (nread < 0)
+    {
+      nread = -errno;
+    }
+  else
+    {
+      g_sysmon.line[nread] = '\0';
+    }
+
+  close(fd);
+  return nread;
+}
+
+/****************************************************************************
+ * Name: sysmon_find_value
+ *
+ * Description:
+ *   Return the value of a "Key: value" line of g_sysmon.line.
+ *
+ ****************************************************************************/
+
+static FAR char *sysmon_find_value(FAR const char *key)
+{
+  FAR char *ptr;
+
+  ptr = strstr(g_sysmon.line, key);
+  if (ptr == NULL)
+    {
+      return NULL;
+    }
+
+  ptr += strlen(key);
+  while (isblank(*ptr))
+    {
+      ptr++;
+    }
+
+  return ptr;
+}
+
+/****************************************************************************
+ * Name: sysmon_parse_time
+ *
+ * Description:
+ *   Convert a "S.NNNNNNNNN" time of a critmon file to microseconds, and
+ *   return a pointer after the comma that follows it.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_CRITMONITOR
+static FAR char *sysmon_parse_time(FAR char *str, FAR uint32_t *usec)
+{
+  unsigned long sec;
+  unsigned long nsec = 0;
+  int digits = 0;
+
+  sec = strtoul(str, &str, 10);
+  if (*str == '.')
+    {
+      for (str++; isdigit(*str); str++)
+        {
+          if (digits++ < 9)
+            {
+              nsec = nsec * 10 + (*str - '0');
+            }
+        }
+
+      for (; digits < 9; digits++)
+        {
+          nsec *= 10;
+        }
+    }
+
+  *usec = sec * 1000000 + nsec / 1000;
+  return *str == ',' ? str + 1 : str;
+}
+#endif
+
+/****************************************************************************
+ * Name: sysmon_sample
+ *
+ * Description:
+ *   Read the current figures of one task.
+ *
+ ****************************************************************************/
+
+static int sysmon_sample(FAR const char *dir,
+                         FAR struct sysmon_task_s *sample)
+{
+  FAR char *value;
+  int ret;
+
+#ifdef CONFIG_STACK_COLORATION
+  ret = sysmon_read(dir, "stack");
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  value = sysmon_find_value("StackSize:");
+  if (value != NULL)
+    {
+      sample->stacksize = strtoul(value, NULL, 10);
+    }
+
+  value = sysmon_find_value("StackUsed:");
+  if (value != NULL)
+    {
+      sample->stackused = strtoul(value, NULL, 10);
+    }
+#endif
+
+#ifdef CONFIG_SCHED_CRITMONITOR
+  /* Format: X.XXXXXXXXX,X.XXXXXXXXX,X.XXXXXXXXX */
+
+  ret = sysmon_read(dir, "critmon");
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  value = sysmon_parse_time(g_sysmon.line, &sample->preempt);
+  value = sysmon_parse_time(value, &sample->csection);
+  sysmon_parse_time(value, &sample->run);
+#endif
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: sysmon_read_name
+ ****************************************************************************/
+
+static void sysmon_read_name(FAR const char *dir,
+                             FAR struct sysmon_task_s *task)
+{
+#if CONFIG_TASK_NAME_SIZE > 0
+  FAR char *value;
+  size_t len;
+
+  if (sysmon_read(dir, "status") < 0)
+    {
+      return;
+    }
+
+  value = sysmon_find_value("Name:");
+  if (value != NULL)
+    {
+      len = strcspn(value, "\r\n");
+      if (len > CONFIG_TASK_NAME_SIZE)
+        {
+          len = CONFIG_TASK_NAME_SIZE;
+        }
+
+      memcpy(task->name, value, len);
+      task->name[len] = '\0';
+    }
+#endif
+}
+
+/****************************************************************************
+ * Name: sysmon_lookup
+ *
+ * Description:
+ *   Find the entry of a task, or add one.  procfs lists the tasks in the
+ *   same order each time, so the search starts after the last match and
+ *   normally succeeds at once.
+ *
+ ****************************************************************************/
+
+static FAR struct sysmon_task_s *sysmon_lookup(pid_t pid, FAR bool *isnew)
+{
+  FAR struct sysmon_task_s *task;
+  int i;
+  int n;
+
+  for (n = 0, i = g_sysmon.cursor; n < g_sysmon.ntasks; n++, i++)
+    {
+      if (i >= g_sysmon.ntasks)
+        {
+          i = 0;
+        }
+
+      if (g_sysmon.tasks[i].pid == pid)
+        {
+          g_sysmon.cursor = i + 1;
+          *isnew = false;
+          return &g_sysmon.tasks[i];
+        }
+    }
+
+  if (g_sysmon.ntasks >= g_sysmon.maxtasks)
+    {
+      task = realloc(g_sysmon.tasks,
+                     (g_sysmon.maxtasks + SYSMON_TASK_INCR) *
+                     sizeof(struct sysmon_task_s));
+      if (task == NULL)
+        {
+          return NULL;
+        }
+
+      g_sysmon.tasks     = task;
+      g_sysmon.maxtasks += SYSMON_TASK_INCR;
+    }
+
+  task = &g_sysmon.tasks[g_sysmon.ntasks++];
+  memset(task, 0, sizeof(*task));
+  task->pid = pid;
+  g_sysmon.cursor = g_sysmon.ntasks;
+
+  *isnew = true;
+  return task;
+}
+
+/****************************************************************************
+ * Name: sysmon_alarm
+ ****************************************************************************/
+
+static bool sysmon_alarm(FAR const struct sysmon_task_s *task)
+{
+  if (g_sysmon.stack_threshold > 0 && task->stacksize > 0 &&
+      task->stackused * 100 > task->stacksize * g_sysmon.stack_threshold)
+    {
+      return true;
+    }
+
+  if (g_sysmon.csection_threshold > 0 &&
+      (task->preempt > g_sysmon.csection_threshold ||
+       task->csection > g_sysmon.csection_threshold))
+    {
+      return true;
+    }
+
+  return false;
+}
+
+/****************************************************************************
+ * Name: sysmon_header
+ ****************************************************************************/
+
+static void sysmon_header(void)
+{
+  if (g_sysmon.csv)
+    {
+      fprintf(g_sysmon.out, "time,pid,name,stack_size,stack_used,"
+                            "preempt_us,csection_us,run_us,alarm\n");
+    }
+  else
+    {
+      fprintf(g_sysmon.out,
+              "\n%6s %6s %6s %4s %11s %11s %11s %s (%ld.%03ld s)\n",
+              "PID", "SIZE", "USED", "USE%", "PREEMPT(us)", "CSECT(us)",
+              "RUN(us)", "NAME", (long)g_sysmon.now.tv_sec,
+              g_sysmon.now.tv_nsec / 1000000);
+    }
+}
+
+/****************************************************************************
+ * Name: sysmon_report
+ ****************************************************************************/
+
+static void sysmon_report(FAR const struct sysmon_task_s *task, bool alarm)
+{
+  FAR FILE *out = g_sysmon.out;
+  char pid[12];
+
+  if (task->pid < 0)
+    {
+      snprintf(pid, sizeof(pid), "CPU%d", SYSMON_CPU_PID(task->pid));
+    }
+  else
+    {
+      snprintf(pid, sizeof(pid), "%d", task->pid);
+    }
+
+  if (g_sysmon.csv)
+    {
+      fprintf(out, "%ld.%03ld,%s,%s,%" PRIu32 ",%" PRIu32 ",%" PRIu32
+                   ",%" PRIu32 ",%" PRIu32 ",%d\n",
+              (long)g_sysmon.now.tv_sec, g_sysmon.now.tv_nsec / 1000000,
+              pid, task->name, task->stacksize, task->stackused,
+              task->preempt, task->csection, task->run, alarm);
+      return;
+    }
+
+  if (!g_sysmon.header)
+    {
+      sysmon_header();
+      g_sysmon.header = true;
+    }
+
+  fprintf(out, "%c%5s %6" PRIu32 " %6" PRIu32 " %3" PRIu32 "%% %11" PRIu32
+               " %11" PRIu32 " %11" PRIu32 " %s\n",
+          alarm ? '!' : ' ', pid, task->stacksize, task->stackused,
+          task->stacksize ? task->stackused * 100 / task->stacksize : 0,
+          task->preempt, task->csection, task->run, task->name);
+}
+
+/****************************************************************************
+ * Name: sysmon_update
+ *
+ * Description:
+ *   Record the figures of a task and report them if they changed or are
+ *   above a threshold.
+ *
+ ****************************************************************************/
+
+static void sysmon_update(FAR struct sysmon_task_s *task, bool isnew,
+                          FAR const struct sysmon_task_s *sample)
+{
+  bool changed;
+  bool alarm;
+
+  changed = isnew ||
+            task->stacksize != sample->stacksize ||
+            task->stackused != sample->stackused ||
+            task->preempt != sample->preempt ||
+            task->csection != sample->csection ||
+            task->run != sample->run;
+
+  task->stacksize = sample->stacksize;
+  task->stackused = sample->stackused;
+  task->preempt   = sample->preempt;
+  task->csection  = sample->csection;
+  task->run       = sample->run;
+  task->seen      = true;
+
+  alarm = sysmon_alarm(task);
+  if (changed || alarm || g_sysmon.all)
+    {
+      sysmon_report(task, alarm);
+    }
+}
+
+/****************************************************************************
+ * Name: sysmon_global
+ *
+ * Description:
+ *   Process the per-CPU figures of /proc/critmon.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_SCHED_CRITMONITOR
+static void sysmon_global(void)
+{
+  struct sysmon_task_s sample;
+  FAR struct sysmon_task_s *task;
+  FAR char *line;
+  FAR char *next;
+  bool isnew;
+  int cpu;
+
+  if (sysmon_read(NULL, "critmon") < 0)
+    {
+      return;
+    }
+
+  /* Format: X,X.XXXXXXXXX,X.XXXXXXXXX, one line per CPU */
+
+  for (line = g_sysmon.line; *line != '\0'; line = next)
+    {
+      next = strchr(line, '\n');
+      next = next != NULL ? next + 1 : line + strlen(line);
+
+      memset(&sample, 0, sizeof(sample));
+      cpu = strtoul(line, &line, 10);
+      if (*line++ != ',')
+        {
+          continue;
+        }
+
+      line = sysmon_parse_time(line, &sample.preempt);
+      sysmon_parse_time(line, &sample.csection);
+
+      task = sysmon_lookup(SYSMON_CPU_PID(cpu), &isnew);
+      if (task != NULL)
+        {
+          if (isnew)
+            {
+              snprintf(task->name, sizeof(task->name), "CPU %d", cpu);
+            }
+
+          sysmon_update(task, isnew, &sample);
+        }
+    }
+}
+#endif
+
+/****************************************************************************
+ * Name: sysmon_pass
+ *
+ * Description:
+ *   Read every task once, report what changed and forget the tasks that
+ *   are gone.
+ *
+ ****************************************************************************/
+
+static int sysmon_pass(void)
+{
+  struct sysmon_task_s sample;
+  FAR struct sysmon_task_s *task;
+  FAR struct dirent *entryp;
+  FAR DIR *dirp;
+  bool isnew;
+  int errcount = 0;
+  int i;
+  int n;
+
+  clock_gettime(CLOCK_MONOTONIC, &g_sysmon.now);
+  g_sysmon.header = false;
+  g_sysmon.cursor = 0;
+
+  for (i = 0; i < g_sysmon.ntasks; i++)
+    {
+      g_sysmon.tasks[i].seen = false;
+    }
+
+#ifdef CONFIG_SCHED_CRITMONITOR
+  sysmon_global();
+#endif
+
+  dirp = opendir(CONFIG_SYSTEM_SYSMON_MOUNTPOINT);
+  if (dirp == NULL)
+    {
+      fprintf(stderr, "System Monitor: Failed to open directory: %s\n",
+              CONFIG_SYSTEM_SYSMON_MOUNTPOINT);
+      return -ENOENT;
+    }
+
+  while ((entryp = readdir(dirp)) != NULL)
+    {
+      if (!DIRENT_ISDIRECTORY(entryp->d_type) ||
+          !sysmon_check_name(entryp->d_name))
+        {
+          continue;
+        }
+
+      /* A task may exit between readdir() and the reads: skip it then */
+
+      memset(&sample, 0, sizeof(sample));
+      if (sysmon_sample(entryp->d_name, &sample) < 0)
+        {
+          errcount++;
+          continue;
+        }
+
+      task = sysmon_lookup(atoi(entryp->d_name), &isnew);
+      if (task == NULL)
+        {
+          closedir(dirp);
+          return -ENOMEM;
+        }
+
+      /* The name is only read the first time the task is seen */
+
+      if (isnew)
+        {
+          sysmon_read_name(entryp->d_name, task);
+        }
+
+      sysmon_update(task, isnew, &sample);
+    }
+
+  closedir(dirp);
+
+  /* Drop the tasks that have exited */
+
+  for (i = n = 0; i < g_sysmon.ntasks; i++)
+    {
+      task = &g_sysmon.tasks[i];
+      if (!task->seen)
+        {
+          if (!g_sysmon.csv)
+            {
+              if (!g_sysmon.header)
+                {
+                  sysmon_header();
+                  g_sysmon.header = true;
+                }
+
+              fprintf(g_sysmon.out, " %5d exited %s\n",
+                      task->pid, task->name);
+            }
+
+          continue;
+        }
+
+      if (n != i)
+        {
+          g_sysmon.tasks[n] = *task;
+        }
+
+      n++;
+    }
+
+  g_sysmon.ntasks = n;
+  fflush(g_sysmon.out);
+
+  return errcount > 100 ? -EIO : OK;
+}
+
+/****************************************************************************
+ * Name: sysmon_open
+ *
+ * Description:
+ *   Open the output in the task that writes it, since streams belong to
+ *   the task group that opened them.
+ *
+ ****************************************************************************/
+
+static int sysmon_open(void)
+{
+  g_sysmon.out = stdout;
+  if (g_sysmon.outfile != NULL)
+    {
+      /* Append, so that a CSV file accumulates several runs */
+
+      g_sysmon.out = fopen(g_sysmon.outfile, "a");
+      if (g_sysmon.out == NULL)
+        {
+          fprintf(stderr, "System Monitor: Failed to open %s: %d\n",
+                  g_sysmon.outfile, errno);
+          return -errno;
+        }
+    }
+
+  if (g_sysmon.csv)
+    {
+      sysmon_header();
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Name: sysmon_reset
+ ****************************************************************************/
+
+static void sysmon_reset(void)
+{
+  if (g_sysmon.out != NULL && g_sysmon.out != stdout)
+    {
+      fclose(g_sysmon.out);
+    }
+
+  free(g_sysmon.outfile);
+  free(g_sysmon.tasks);
+  g_sysmon.outfile  = NULL;
+  g_sysmon.out      = NULL;
+  g_sysmon.tasks    = NULL;
+  g_sysmon.ntasks   = 0;
+  g_sysmon.maxtasks = 0;
+}
+
+/****************************************************************************
+ * Name: sysmon_daemon
+ ****************************************************************************/
+
+static int sysmon_daemon(int argc, char **argv)
+{
+  int exitcode = EXIT_SUCCESS;
+
+  printf("System Monitor: Running: %d\n", g_sysmon.pid);
+
+  if (sysmon_open() < 0)
+    {
+      g_sysmon.stop = true;
+      exitcode = EXIT_FAILURE;
+    }
+
+  /* Loop until we detect that there is a request to stop. */
+
+  while (!g_sysmon.stop)
+    {
+      if (sysmon_pass() < 0)
+        {
+          fprintf(stderr, "System Monitor: Too many errors ... exiting\n");
+          exitcode = EXIT_FAILURE;
+          break;
+        }
+
+      /* Wait for the next sample interval */
+
+      usleep(g_sysmon.interval * 1000);
+    }
+
+  /* Stopped */
+
+  sysmon_reset();
+  g_sysmon.stop    = false;
+  g_sysmon.started = false;
+  printf("System Monitor: Stopped: %d\n", g_sysmon.pid);
+
+  return exitcode;
+}
+
+/****************************************************************************
+ * Name: sysmon_options
+ ****************************************************************************/
+
+static int sysmon_options(int argc, FAR char **argv)
+{
+  int option;
+
+  g_sysmon.all                = false;
+  g_sysmon.csv                = false;
+  g_sysmon.interval           = CONFIG_SYSTEM_SYSMON_INTERVAL;
+  g_sysmon.stack_threshold    = CONFIG_SYSTEM_SYSMON_STACK_THRESHOLD;
+  g_sysmon.csection_threshold = CONFIG_SYSTEM_SYSMON_CSECTION_THRESHOLD;
+
+  while ((option = getopt(argc, argv, "aci:o:s:t:")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'a':
+            g_sysmon.all = true;
+            break;
+
+          case 'c':
+            g_sysmon.csv = true;
+            break;
+
+          case 'i':
+            g_sysmon.interval = strtoul(optarg, NULL, 0);
+            if (g_sysmon.interval == 0)
+              {
+                /* The sampling loop would never sleep */
+
+                fprintf(stderr, "%s: interval must be at least 1 msec\n",
+                        argv[0]);
+                return -EINVAL;
+              }
+            break;
+
+          case 'o':
+            free(g_sysmon.outfile);
+            g_sysmon.outfile = strdup(optarg);
+            break;
+
+          case 's':
+            g_sysmon.stack_threshold = strtoul(optarg, NULL, 0);
+            break;
+
+          case 't':
+            g_sysmon.csection_threshold = strtoul(optarg, NULL, 0);
+            break;
+
+          default:
+            fprintf(stderr, "Usage: %s [-a][-c][-i <msec>][-o <file>]"
+                            "[-s <percent>][-t <usec>]\n", argv[0]);
+            return -EINVAL;
+        }
+    }
+
+  return OK;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int sysmon_start_main(int argc, char **argv)
+{
+  /* Has the monitor already started? */
+
+  sched_lock();
+  if (!g_sysmon.started)
+    {
+      int ret;
+
+      /* No.. start it now */
+
+      if (sysmon_options(argc, argv) < 0)
+        {
+          sysmon_reset();
+          sched_unlock();
+          return EXIT_FAILURE;
+        }
+
+      g_sysmon.started = true;
+      g_sysmon.stop    = false;
+
+      ret = task_create("System Monitor",
+                        CONFIG_SYSTEM_SYSMON_DAEMON_PRIORITY,
+                        CONFIG_SYSTEM_SYSMON_DAEMON_STACKSIZE,
+                        sysmon_daemon, NULL);
+      if (ret < 0)
+        {
+          int errcode = errno;
+          printf("System Monitor ERROR: "
+                 "Failed to start the system monitor: %d\n",
+                 errcode);
+          sysmon_reset();
+          g_sysmon.started = false;
+        }
+      else
+        {
+          g_sysmon.pid = ret;
+          printf("System Monitor: Started: %d\n", g_sysmon.pid);
+        }
+
+      sched_unlock();
+      return 0;
+    }
+
+  sched_unlock();
+  printf("System Monitor: %s: %d\n",
+         g_sysmon.stop ? "Stopping" : "Running", g_sysmon.pid);
+  return 0;
+}
+
+int sysmon_stop_main(int argc, char **argv)
+{
+  /* Has the monitor already started? */
+
+  if (g_sysmon.started)
+    {
+      /* Stop the monitor.  The next time the monitor wakes up, it will
+       * see the stop indication and will exit.
+       */
+
+      printf("System Monitor: Stopping: %d\n", g_sysmon.pid);
+      g_sysmon.stop = true;
+    }
+
+  printf("System Monitor: Stopped: %d\n", g_sysmon.pid);
+  return 0;
+}
+
+int sysmon_main(int argc, char **argv)
+{
+  int ret;
+
+  if (g_sysmon.started)
+    {
+      printf("System Monitor: Running: %d\n", g_sysmon.pid);
+      return EXIT_FAILURE;
+    }
+
+  /* One pass that reports everything */
+
+  ret = sysmon_options(argc, argv);
+  if (ret >= 0)
+    {
+      ret = sysmon_open();
+    }
+
+  if (ret >= 0)
+    {
+      g_sysmon.all = true;
+      ret = sysmon_pass();
+    }
+
+  sysmon_reset();
+
+  return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif /* CONFIG_SYSTEM_SYSMON */
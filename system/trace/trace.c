@@ -31,15 +31,36 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <fnmatch.h>
+#include <limits.h>
+#include <signal.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
 #include <nuttx/note/notectl_driver.h>
 
+#if defined(CONFIG_NET_TCP) && defined(CONFIG_NET_IPv4)
+#  include <sys/socket.h>
+#  include <netinet/in.h>
+#  include <arpa/inet.h>
+#endif
+
 #include "trace.h"
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Default polling period of 'trace stream' in milliseconds */
+
+#define TRACE_STREAM_INTERVAL 10
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
 
+#ifdef CONFIG_DRIVER_NOTERAM
+static volatile bool g_trace_stop;
+#endif
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -77,6 +98,140 @@ static bool notectl_enable(int flag, int notectlfd)
   return true;
 }
 
+/****************************************************************************
+ * Name: trace_connect
+ ****************************************************************************/
+
+#if defined(CONFIG_DRIVER_NOTERAM) && defined(CONFIG_NET_TCP) && \
+    defined(CONFIG_NET_IPv4)
+static FAR FILE *trace_connect(FAR const char *dest)
+{
+  struct sockaddr_in addr;
+  char host[INET_ADDRSTRLEN];
+  FAR const char *port;
+  FAR FILE *out;
+  int sockfd;
+
+  /* <dest> is <ipaddr>:<port> */
+
+  port = strchr(dest, ':');
+  if (port - dest >= sizeof(host))
+    {
+      return NULL;
+    }
+
+  memcpy(host, dest, port - dest);
+  host[port - dest] = '\0';
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(atoi(port + 1));
+  if (inet_pton(AF_INET, host, &addr.sin_addr) != 1)
+    {
+      return NULL;
+    }
+
+  sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  if (sockfd < 0)
+    {
+      return NULL;
+    }
+
+  if (connect(sockfd, (FAR struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+      close(sockfd);
+      return NULL;
+    }
+
+  out = fdopen(sockfd, "w");
+  if (out == NULL)
+    {
+      close(sockfd);
+    }
+
+  return out;
+}
+#endif
+
+/****************************************************************************
+ * Name: trace_open_output
+ *
+ * Description:
+ *   Open the destination of a dump or a stream: '-' for stdout,
+ *   <ipaddr>:<port> for a TCP connection, or a path.  A binary trace
+ *   written to a path is a CTF trace directory, that holds the 'metadata'
+ *   and the 'stream' files.
+ *
+ ****************************************************************************/
+
+#ifdef CONFIG_DRIVER_NOTERAM
+static FAR FILE *trace_open_output(FAR const char *dest, bool binary)
+{
+  char path[PATH_MAX];
+  FAR FILE *out;
+
+  if (strcmp(dest, "-") == 0)
+    {
+      return stdout;
+    }
+
+#if defined(CONFIG_NET_TCP) && defined(CONFIG_NET_IPv4)
+  if (strchr(dest, ':') != NULL)
+    {
+      out = trace_connect(dest);
+      if (out == NULL)
+        {
+          fprintf(stderr, "trace: cannot connect to '%s'\n", dest);
+        }
+
+      return out;
+    }
+#endif
+
+  if (!binary)
+    {
+      out = fopen(dest, "w");
+    }
+  else
+    {
+      if (mkdir(dest, 0777) < 0 && errno != EEXIST)
+        {
+          fprintf(stderr, "trace: cannot create '%s'\n", dest);
+          return NULL;
+        }
+
+      snprintf(path, sizeof(path), "%s/metadata", dest);
+      out = fopen(path, "w");
+      if (out != NULL)
+        {
+          trace_dump_metadata(out);
+          fclose(out);
+
+          snprintf(path, sizeof(path), "%s/stream", dest);
+          out = fopen(path, "w");
+        }
+    }
+
+  if (out == NULL)
+    {
+      fprintf(stderr, "trace: cannot open '%s'\n", dest);
+      return NULL;
+    }
+
+  setvbuf(out, NULL, _IOFBF, CONFIG_SYSTEM_TRACE_BUFSIZE);
+  return out;
+}
+
+/****************************************************************************
+ * Name: trace_sigint
+ ****************************************************************************/
+
+static void trace_sigint(int signo)
+{
+  g_trace_stop = true;
+}
+#endif
+
 /****************************************************************************
  * Name: trace_cmd_start
  ****************************************************************************/
@@ -148,7 +303,10 @@ static int trace_cmd_dump(int index, int argc, FAR char **argv,
   bool cont = false;
   int ret;
 
-  /* Usage: trace dump [-a] "Custom Format : Android SysTrace" */
+  /* Usage: trace dump [-a] "Custom Format : Android SysTrace"
+   *        trace dump [-b] "Common Trace Format : Generic CTF Trace"
+   *        trace dump [-s] "Summary : Task statistics"
+   */
 
   if (index < argc)
     {
@@ -157,6 +315,16 @@ static int trace_cmd_dump(int index, int argc, FAR char **argv,
           index++;
           type = TRACE_TYPE_ANDROID;
         }
+      else if (strcmp(argv[index], "-b") == 0)
+        {
+          index++;
+          type = TRACE_TYPE_GENERIC_CTF;
+        }
+      else if (strcmp(argv[index], "-s") == 0)
+        {
+          index++;
+          type = TRACE_TYPE_SUMMARY;
+        }
     }
 
   /* Usage: trace dump [-c][<filename>] */
@@ -176,17 +344,13 @@ static int trace_cmd_dump(int index, int argc, FAR char **argv,
 
   if (index < argc)
     {
-      if (strcmp(argv[index], "-") != 0)
-        {
-          /* If <filename> is given, open the file stream for output. */
+      /* If <filename> is given, open the file stream for output. */
 
-          out = fopen(argv[index], "w");
-          if (out == NULL)
-            {
-              fprintf(stderr,
-                      "trace dump: cannot open '%s'\n", argv[index]);
-              return ERROR;
-            }
+      out = trace_open_output(argv[index],
+                              type == TRACE_TYPE_GENERIC_CTF);
+      if (out == NULL)
+        {
+          return ERROR;
         }
 
       index++;
@@ -226,6 +390,159 @@ static int trace_cmd_dump(int index, int argc, FAR char **argv,
 }
 #endif
 
+/****************************************************************************
+ * Name: trace_cmd_stream
+ ****************************************************************************/
+
+#ifdef CONFIG_DRIVER_NOTERAM
+static int trace_cmd_stream(int index, int argc, FAR char **argv,
+                            int notectlfd)
+{
+  trace_dump_t type = TRACE_TYPE_LTTNG_KERNEL;
+  unsigned int interval = TRACE_STREAM_INTERVAL;
+  unsigned int duration = 0;
+  FAR unsigned int *value;
+  FAR char *endptr;
+  FAR FILE *out;
+  bool changed;
+  bool cont = false;
+  int ret;
+
+  /* Usage: trace stream [-a|-b|-s][-c][-i <msec>][-t <duration>] <dest> */
+
+  while (index < argc && argv[index][0] == '-' && argv[index][1] != '\0')
+    {
+      if (strcmp(argv[index], "-a") == 0)
+        {
+          type = TRACE_TYPE_ANDROID;
+        }
+      else if (strcmp(argv[index], "-b") == 0)
+        {
+          type = TRACE_TYPE_GENERIC_CTF;
+        }
+      else if (strcmp(argv[index], "-s") == 0)
+        {
+          type = TRACE_TYPE_SUMMARY;
+        }
+      else if (strcmp(argv[index], "-c") == 0)
+        {
+          cont = true;
+        }
+      else if ((strcmp(argv[index], "-i") == 0 ||
+                strcmp(argv[index], "-t") == 0) && index + 1 < argc)
+        {
+          value = argv[index][1] == 'i' ? &interval : &duration;
+          index++;
+
+          *value = strtoul(argv[index], &endptr, 0);
+          if (endptr == argv[index] || *endptr != '\0')
+            {
+              fprintf(stderr,
+                      "trace stream: invalid argument '%s'\n", argv[index]);
+              return ERROR;
+            }
+        }
+      else
+        {
+          fprintf(stderr,
+                  "trace stream: invalid option '%s'\n", argv[index]);
+          return ERROR;
+        }
+
+      index++;
+    }
+
+  if (index >= argc)
+    {
+      /* <dest> parameter is mandatory. */
+
+      fprintf(stderr,
+              "trace stream: no destination\n");
+      return ERROR;
+    }
+
+  out = trace_open_output(argv[index++], type == TRACE_TYPE_GENERIC_CTF);
+  if (out == NULL)
+    {
+      return ERROR;
+    }
+
+  /* Clear the trace buffer */
+
+  if (!cont)
+    {
+      trace_dump_clear();
+    }
+
+  /* Drain the notes while tracing goes on, until interrupted */
+
+  g_trace_stop = false;
+  signal(SIGINT, trace_sigint);
+
+  changed = notectl_enable(true, notectlfd);
+
+  ret = trace_stream(type, out, interval, duration, &g_trace_stop);
+
+  if (changed)
+    {
+      notectl_enable(false, notectlfd);
+    }
+
+  signal(SIGINT, SIG_DFL);
+
+  if (out != stdout)
+    {
+      fclose(out);
+    }
+
+  if (ret < 0)
+    {
+      fprintf(stderr,
+              "trace stream: stream failed\n");
+      return ERROR;
+    }
+
+  return index;
+}
+
+/****************************************************************************
+ * Name: trace_cmd_metadata
+ ****************************************************************************/
+
+static int trace_cmd_metadata(int index, int argc, FAR char **argv,
+                              int notectlfd)
+{
+  FAR FILE *out = stdout;
+
+  /* Usage: trace metadata [<filename>] */
+
+  if (index < argc)
+    {
+      if (strcmp(argv[index], "-") != 0)
+        {
+          out = fopen(argv[index], "w");
+          if (out == NULL)
+            {
+              fprintf(stderr,
+                      "trace metadata: cannot open '%s'\n", argv[index]);
+              return ERROR;
+            }
+        }
+
+      index++;
+    }
+
+  trace_dump_metadata(out);
+
+  if (out != stdout)
+    {
+      fclose(out);
+    }
+
+  return index;
+}
+#endif
+
 /****************************************************************************
  * Name: trace_cmd_cmd
  ****************************************************************************/
@@ -796,9 +1113,17 @@ static void show_usage(void)
                                 " Get the trace while running <command>\n"
 #endif
 #ifdef CONFIG_DRIVER_NOTERAM
-          " dump    [-a][-c][<filename>]        :"
+          " dump    [-a|-b|-s][-c][<filename>]  :"
                                 " Output the trace result\n"
           "                                       [-a] <Android SysTrace>\n"
+          "                                       [-b] <Binary CTF>\n"
+          "                                       [-s] <Task statistics>\n"
+          " stream  [-a|-b|-s][-c][-i <msec>]   :"
+                                " Output the trace while tracing\n"
+          "         [-t <duration>] <dest>        "
+                                " <dest> is a file, '-' or ip:port\n"
+          " metadata [<filename>]               :"
+                                " Output the CTF metadata\n"
 #endif
           " mode    [{+|-}{o|w|s|a|i|d}...]     :"
                                 " Set task trace options\n"
@@ -870,6 +1195,14 @@ int main(int argc, FAR char *argv[])
         {
           i = trace_cmd_dump(i + 1, argc, argv, notectlfd);
         }
+      else if (strcmp(argv[i], "stream") == 0)
+        {
+          i = trace_cmd_stream(i + 1, argc, argv, notectlfd);
+        }
+      else if (strcmp(argv[i], "metadata") == 0)
+        {
+          i = trace_cmd_metadata(i + 1, argc, argv, notectlfd);
+        }
 #endif
 #ifdef CONFIG_SYSTEM_SYSTEM
       else if (strcmp(argv[i], "cmd") == 0)
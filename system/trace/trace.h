@@ -27,6 +27,8 @@
 
 #include <nuttx/config.h>
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #ifdef __cplusplus
@@ -49,8 +51,38 @@ typedef enum
   TRACE_TYPE_CUSTOM_TEXT  = 3,  /* Custom Text :         TmfGeneric */
   TRACE_TYPE_CUSTOM_XML   = 4,  /* Custom XML :          Custom XML Log */
   TRACE_TYPE_ANDROID      = 5,  /* Custom Format :       Android ATrace */
+  TRACE_TYPE_SUMMARY      = 6,  /* Summary :             Task statistics */
 } trace_dump_t;
 
+/* Event IDs of the TRACE_TYPE_GENERIC_CTF stream */
+
+enum trace_ctf_event_e
+{
+  TRACE_CTF_TASK_NAME = 0,      /* Name of a task, before its first event */
+  TRACE_CTF_SCHED_WAKEUP_NEW,
+  TRACE_CTF_SCHED_SWITCH,
+  TRACE_CTF_SCHED_WAKING,
+  TRACE_CTF_IRQ_ENTRY,
+  TRACE_CTF_IRQ_EXIT,
+  TRACE_CTF_SYSCALL_ENTRY,
+  TRACE_CTF_SYSCALL_EXIT,
+  TRACE_CTF_PRINT,
+  TRACE_CTF_BINARY,
+  TRACE_CTF_NEVENTS
+};
+
+/* One CTF event record being built.  The largest record is a binary dump
+ * note: a 14 byte header and context, then 8 + 1 + 1 + 255 bytes.
+ */
+
+#define TRACE_CTF_EVENT_MAX 288
+
+struct trace_ctf_event_s
+{
+  size_t len;
+  uint8_t buf[TRACE_CTF_EVENT_MAX];
+};
+
 /****************************************************************************
  * Public Function Prototypes
  ****************************************************************************/
@@ -67,6 +99,30 @@ typedef enum
 
 int trace_dump(trace_dump_t type, FAR FILE *out);
 
+/****************************************************************************
+ * Name: trace_stream
+ *
+ * Description:
+ *   Read notes continuously and write them out while tracing goes on,
+ *   until '*stop' is set or 'duration' seconds (if not zero) have passed.
+ *   'interval' is the polling period in milliseconds when no notes are
+ *   pending.
+ *
+ ****************************************************************************/
+
+int trace_stream(trace_dump_t type, FAR FILE *out, unsigned int interval,
+                 unsigned int duration, FAR volatile bool *stop);
+
+/****************************************************************************
+ * Name: trace_dump_metadata
+ *
+ * Description:
+ *   Output the CTF metadata for the TRACE_TYPE_GENERIC_CTF format.
+ *
+ ****************************************************************************/
+
+void trace_dump_metadata(FAR FILE *out);
+
 /****************************************************************************
  * Name: trace_dump_clear
  *
@@ -97,9 +153,32 @@ bool trace_dump_get_overwrite(void);
 
 void trace_dump_set_overwrite(bool mode);
 
+/****************************************************************************
+ * Name: trace_ctf_*
+ *
+ * Description:
+ *   Helpers that write the TRACE_TYPE_GENERIC_CTF format, in trace_ctf.c.
+ *
+ ****************************************************************************/
+
+void trace_ctf_metadata(FAR FILE *out);
+void trace_ctf_packet_header(FAR FILE *out);
+void trace_ctf_begin(FAR struct trace_ctf_event_s *ev, uint8_t id,
+                     uint64_t timestamp, uint8_t cpu, int32_t tid);
+void trace_ctf_u8(FAR struct trace_ctf_event_s *ev, uint8_t value);
+void trace_ctf_u16(FAR struct trace_ctf_event_s *ev, uint16_t value);
+void trace_ctf_i32(FAR struct trace_ctf_event_s *ev, int32_t value);
+void trace_ctf_x64(FAR struct trace_ctf_event_s *ev, uint64_t value);
+void trace_ctf_bytes(FAR struct trace_ctf_event_s *ev,
+                     FAR const uint8_t *data, uint8_t len);
+void trace_ctf_string(FAR struct trace_ctf_event_s *ev, FAR const char *str);
+void trace_ctf_end(FAR struct trace_ctf_event_s *ev, FAR FILE *out);
+
 #else /* CONFIG_DRIVER_NOTERAM */
 
 #define trace_dump(type,out)
+#define trace_stream(type,out,interval,duration,stop)
+#define trace_dump_metadata(out)
 #define trace_dump_clear()
 #define trace_dump_get_overwrite()      0
 #define trace_dump_set_overwrite(mode)  (void)(mode)
@@ -0,0 +1,304 @@
+/****************************************************************************
+ * apps/system/trace/trace_ctf.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "trace.h"
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_SYSCALL
+#  ifdef CONFIG_LIB_SYSCALL
+#    include <syscall.h>
+#  else
+#    define CONFIG_LIB_SYSCALL
+#    include <syscall.h>
+#    undef CONFIG_LIB_SYSCALL
+#  endif
+#endif
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define TRACE_CTF_MAGIC 0xc1fc1fc1
+
+#ifdef CONFIG_ENDIAN_BIG
+#  define TRACE_CTF_BYTE_ORDER "be"
+#else
+#  define TRACE_CTF_BYTE_ORDER "le"
+#endif
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* The TSDL metadata that describes the records written by trace_ctf_*().
+ * Every integer is byte aligned, so records are packed with no padding.
+ */
+
+static const char g_trace_ctf_types[] =
+  "/* CTF 1.8 */\n"
+  "\n"
+  "typealias integer { size = 8; align = 8; signed = false; } := uint8_t;\n"
+  "typealias integer { size = 16; align = 8; signed = false; }"
+  " := uint16_t;\n"
+  "typealias integer { size = 32; align = 8; signed = false; }"
+  " := uint32_t;\n"
+  "typealias integer { size = 32; align = 8; signed = true; }"
+  " := int32_t;\n"
+  "typealias integer { size = 64; align = 8; signed = false; base = 16; }"
+  " := xint64_t;\n"
+  "typealias integer { size = 8; align = 8; signed = false;"
+  " encoding = ASCII; } := state_t;\n"
+  "\n"
+  "trace {\n"
+  "\tmajor = 1;\n"
+  "\tminor = 8;\n"
+  "\tbyte_order = " TRACE_CTF_BYTE_ORDER ";\n"
+  "\tpacket.header := struct {\n"
+  "\t\tuint32_t magic;\n"
+  "\t\tuint32_t stream_id;\n"
+  "\t};\n"
+  "};\n"
+  "\n"
+  "env {\n"
+  "\tsysname = \"NuttX\";\n"
+  "\ttracer_name = \"nuttx-trace\";\n"
+  "};\n"
+  "\n"
+  "clock {\n"
+  "\tname = monotonic;\n"
+  "\tfreq = 1000000000;\n"
+  "\tdescription = \"System time of the notes\";\n"
+  "};\n"
+  "\n"
+  "typealias integer {\n"
+  "\tsize = 64; align = 8; signed = false;\n"
+  "\tmap = clock.monotonic.value;\n"
+  "} := uint64_clock_monotonic_t;\n"
+  "\n"
+  "stream {\n"
+  "\tid = 0;\n"
+  "\tevent.header := struct {\n"
+  "\t\tuint8_t id;\n"
+  "\t\tuint64_clock_monotonic_t timestamp;\n"
+  "\t};\n"
+  "\tevent.context := struct {\n"
+  "\t\tuint8_t cpu_id;\n"
+  "\t\tint32_t tid;\n"
+  "\t};\n"
+  "};\n"
+  "\n";
+
+/* One entry per enum trace_ctf_event_e, in order */
+
+static const char * const g_trace_ctf_events[] =
+{
+  "task_name", "int32_t tid; string comm;",
+  "sched_wakeup_new", "int32_t tid; uint8_t target_cpu;",
+  "sched_switch", "int32_t prev_tid; uint8_t prev_prio; "
+                  "state_t prev_state; int32_t next_tid; uint8_t next_prio;",
+  "sched_waking", "int32_t tid; uint8_t target_cpu;",
+  "irq_handler_entry", "uint8_t irq;",
+  "irq_handler_exit", "uint8_t irq;",
+  "syscall_entry", "enum syscall_e nr; uint8_t argc; xint64_t args[argc];",
+  "syscall_exit", "enum syscall_e nr; xint64_t ret;",
+  "print", "xint64_t ip; string msg;",
+  "binary", "xint64_t ip; uint8_t code; uint8_t count; "
+            "uint8_t data[count];",
+};
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void trace_ctf_put(FAR struct trace_ctf_event_s *ev,
+                          FAR const void *data, size_t len)
+{
+  if (ev->len + len <= sizeof(ev->buf))
+    {
+      memcpy(&ev->buf[ev->len], data, len);
+      ev->len += len;
+    }
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: trace_ctf_metadata
+ *
+ * Description:
+ *   Write the TSDL metadata that describes the binary trace.
+ *
+ ****************************************************************************/
+
+void trace_ctf_metadata(FAR FILE *out)
+{
+  int i;
+
+  fputs(g_trace_ctf_types, out);
+
+  /* System call numbers are written as is and named here */
+
+  fprintf(out, "enum syscall_e : uint16_t {\n");
+#ifdef CONFIG_SCHED_INSTRUMENTATION_SYSCALL
+  for (i = 0; i < SYS_maxsyscall - CONFIG_SYS_RESERVED; i++)
+    {
+      fprintf(out, "\t\"%s\" = %d,\n", g_funcnames[i],
+              i + CONFIG_SYS_RESERVED);
+    }
+#else
+  fprintf(out, "\t\"none\" = 0,\n");
+#endif
+
+  fprintf(out, "};\n\n");
+
+  for (i = 0; i < TRACE_CTF_NEVENTS; i++)
+    {
+      fprintf(out, "event {\n"
+                   "\tname = \"%s\";\n"
+                   "\tid = %d;\n"
+                   "\tstream_id = 0;\n"
+                   "\tfields := struct { %s };\n"
+                   "};\n\n",
+              g_trace_ctf_events[2 * i], i, g_trace_ctf_events[2 * i + 1]);
+    }
+}
+
+/****************************************************************************
+ * Name: trace_ctf_packet_header
+ *
+ * Description:
+ *   Write the header of the single packet that holds the events.
+ *
+ ****************************************************************************/
+
+void trace_ctf_packet_header(FAR FILE *out)
+{
+  uint32_t header[2];
+
+  header[0] = TRACE_CTF_MAGIC;
+  header[1] = 0;
+  fwrite(header, sizeof(header), 1, out);
+}
+
+/****************************************************************************
+ * Name: trace_ctf_begin
+ *
+ * Description:
+ *   Start an event record with the event header and context.
+ *
+ ****************************************************************************/
+
+void trace_ctf_begin(FAR struct trace_ctf_event_s *ev, uint8_t id,
+                     uint64_t timestamp, uint8_t cpu, int32_t tid)
+{
+  ev->len = 0;
+  trace_ctf_u8(ev, id);
+  trace_ctf_put(ev, &timestamp, sizeof(timestamp));
+  trace_ctf_u8(ev, cpu);
+  trace_ctf_i32(ev, tid);
+}
+
+/****************************************************************************
+ * Name: trace_ctf_u8, trace_ctf_u16, trace_ctf_i32, trace_ctf_x64
+ *
+ * Description:
+ *   Append an integer field in host byte order.
+ *
+ ****************************************************************************/
+
+void trace_ctf_u8(FAR struct trace_ctf_event_s *ev, uint8_t value)
+{
+  trace_ctf_put(ev, &value, sizeof(value));
+}
+
+void trace_ctf_u16(FAR struct trace_ctf_event_s *ev, uint16_t value)
+{
+  trace_ctf_put(ev, &value, sizeof(value));
+}
+
+void trace_ctf_i32(FAR struct trace_ctf_event_s *ev, int32_t value)
+{
+  trace_ctf_put(ev, &value, sizeof(value));
+}
+
+void trace_ctf_x64(FAR struct trace_ctf_event_s *ev, uint64_t value)
+{
+  trace_ctf_put(ev, &value, sizeof(value));
+}
+
+/****************************************************************************
+ * Name: trace_ctf_bytes
+ *
+ * Description:
+ *   Append a byte array, after its length field.
+ *
+ ****************************************************************************/
+
+void trace_ctf_bytes(FAR struct trace_ctf_event_s *ev,
+                     FAR const uint8_t *data, uint8_t len)
+{
+  trace_ctf_u8(ev, len);
+  trace_ctf_put(ev, data, len);
+}
+
+/****************************************************************************
+ * Name: trace_ctf_string
+ *
+ * Description:
+ *   Append a NUL terminated string field.
+ *
+ ****************************************************************************/
+
+void trace_ctf_string(FAR struct trace_ctf_event_s *ev, FAR const char *str)
+{
+  size_t len = strlen(str);
+
+  if (ev->len + len + 1 > sizeof(ev->buf))
+    {
+      len = sizeof(ev->buf) - ev->len - 1;
+    }
+
+  trace_ctf_put(ev, str, len);
+  trace_ctf_u8(ev, '\0');
+}
+
+/****************************************************************************
+ * Name: trace_ctf_end
+ *
+ * Description:
+ *   Write out a complete event record.
+ *
+ ****************************************************************************/
+
+void trace_ctf_end(FAR struct trace_ctf_event_s *ev, FAR FILE *out)
+{
+  fwrite(ev->buf, ev->len, 1, out);
+}
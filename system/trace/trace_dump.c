@@ -27,7 +27,9 @@
 #include <assert.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <inttypes.h>
+#include <time.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
@@ -62,6 +64,24 @@
 #define get_task_state(s) ((s) == 0 ? 'X' : \
                           ((s) <= LAST_READY_TO_RUN_STATE ? 'R' : 'S'))
 
+#define is_binary(ctx)    ((ctx)->type == TRACE_TYPE_GENERIC_CTF)
+
+/* Task contexts are hashed by PID.  PIDs are allocated in sequence, so the
+ * low bits spread them evenly over the buckets.
+ */
+
+#define TASK_HASH_SIZE    64
+#define task_hash(pid)    ((pid) & (TASK_HASH_SIZE - 1))
+
+/* Summary statistics: durations are kept in nanoseconds and histograms
+ * have power of two buckets in microseconds, the first one is < 1us and
+ * the last one is >= 2^(HIST_NBUCKETS - 2) us.
+ */
+
+#define HIST_NBUCKETS     16
+#define IRQ_MAXNEST       4
+#define NR_NOTE_IRQS      (UINT8_MAX + 1)
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -77,6 +97,8 @@ struct trace_dump_cpu_context_s
   pid_t next_pid;           /* Task PID of the next line */
   uint8_t current_priority; /* Task Priority of the current line */
   uint8_t next_priority;    /* Task Priority of the next line */
+  uint64_t switch_time;     /* When the current task started to run */
+  uint64_t irq_start[IRQ_MAXNEST]; /* Entry time of the nested IRQs */
 };
 
 struct trace_dump_task_context_s
@@ -84,14 +106,63 @@ struct trace_dump_task_context_s
   FAR struct trace_dump_task_context_s *next;
   pid_t pid;                              /* Task PID */
   int syscall_nest;                       /* Syscall nest level */
+  bool named;                             /* Name written to a CTF stream */
   char name[CONFIG_TASK_NAME_SIZE + 1];   /* Task name (with NULL terminator) */
+
+  /* Summary statistics */
+
+  uint64_t runtime;                       /* Total time running */
+  uint64_t readytime;                     /* When it became ready to run */
+  uint64_t latency;                       /* Total wakeup to run latency */
+  uint64_t maxlatency;                    /* Worst wakeup to run latency */
+  uint64_t syscall_start;                 /* Entry time of the syscall */
+  uint32_t nwakeups;                      /* Number of latencies measured */
+  uint32_t nswitches;                     /* Number of times switched in */
+  uint32_t nsyscalls;                     /* Number of syscalls made */
+  uint8_t syscall_nr;                     /* Number of the current syscall */
+  bool insyscall;                         /* syscall_start is valid */
+};
+
+struct trace_dump_irq_stats_s
+{
+  uint32_t count;                         /* Number of handler calls */
+  uint64_t total;                         /* Total time in the handler */
+  uint64_t min;                           /* Shortest handler call */
+  uint64_t max;                           /* Longest handler call */
+  uint32_t hist[HIST_NBUCKETS];           /* Duration histogram */
+};
+
+struct trace_dump_syscall_stats_s
+{
+  uint32_t count;                         /* Number of calls */
+  uint32_t ndone;                         /* Number of calls returned */
+  uint64_t total;                         /* Total time of those calls */
+};
+
+struct trace_dump_stats_s
+{
+  uint64_t first;                         /* Time stamp of the first note */
+  uint64_t last;                          /* Time stamp of the last note */
+  uint32_t nnotes;                        /* Number of notes processed */
+  FAR struct trace_dump_irq_stats_s *irq[NR_NOTE_IRQS];
+#ifdef CONFIG_SCHED_INSTRUMENTATION_SYSCALL
+  struct trace_dump_syscall_stats_s
+    syscall[SYS_maxsyscall - CONFIG_SYS_RESERVED];
+#endif
 };
 
 struct trace_dump_context_s
 {
   struct trace_dump_cpu_context_s cpu[NCPUS];
-  FAR struct trace_dump_task_context_s *task;
+  FAR struct trace_dump_task_context_s *task[TASK_HASH_SIZE];
+  FAR struct trace_dump_stats_s *stats;   /* Only for TRACE_TYPE_SUMMARY */
+  trace_dump_t type;                      /* Output format */
+  FAR FILE *out;                          /* Output stream */
+  FAR uint8_t *buffer;                    /* Buffer for the notes read */
+  int ntasks;                             /* Number of task contexts */
   int notefd;
+  pid_t selfpid;                          /* Task whose syscalls are left
+                                           * out, or -1 */
 };
 
 /****************************************************************************
@@ -143,14 +214,44 @@ static void note_ioctl(int cmd, unsigned long arg)
  * Name: trace_dump_init_context
  ****************************************************************************/
 
-static void trace_dump_init_context(FAR struct trace_dump_context_s *ctx,
-                                   int fd)
+static int trace_dump_init_context(FAR struct trace_dump_context_s *ctx,
+                                   trace_dump_t type, FAR FILE *out)
 {
   int cpu;
 
+  /* Open note for read */
+
+  ctx->notefd = open("/dev/note/ram", O_RDONLY);
+  if (ctx->notefd < 0)
+    {
+      fprintf(stderr, "trace: cannot open /dev/note/ram\n");
+      return ERROR;
+    }
+
+  ctx->buffer = malloc(CONFIG_SYSTEM_TRACE_BUFSIZE);
+  if (ctx->buffer == NULL)
+    {
+      close(ctx->notefd);
+      return ERROR;
+    }
+
+  ctx->stats = NULL;
+  if (type == TRACE_TYPE_SUMMARY)
+    {
+      ctx->stats = calloc(1, sizeof(struct trace_dump_stats_s));
+      if (ctx->stats == NULL)
+        {
+          free(ctx->buffer);
+          close(ctx->notefd);
+          return ERROR;
+        }
+    }
+
   /* Initialize the trace dump context */
 
-  ctx->notefd = fd;
+  ctx->type = type;
+  ctx->out = out;
+  ctx->selfpid = -1;
 
   for (cpu = 0; cpu < NCPUS; cpu++)
     {
@@ -161,9 +262,20 @@ static void trace_dump_init_context(FAR struct trace_dump_context_s *ctx,
       ctx->cpu[cpu].next_pid = -1;
       ctx->cpu[cpu].current_priority = -1;
       ctx->cpu[cpu].next_priority = -1;
+      ctx->cpu[cpu].switch_time = 0;
+    }
+
+  memset(ctx->task, 0, sizeof(ctx->task));
+  ctx->ntasks = 0;
+
+  /* A binary trace is a single packet that holds all events */
+
+  if (is_binary(ctx))
+    {
+      trace_ctf_packet_header(out);
     }
 
-  ctx->task = NULL;
+  return OK;
 }
 
 /****************************************************************************
@@ -174,17 +286,37 @@ static void trace_dump_fini_context(FAR struct trace_dump_context_s *ctx)
 {
   FAR struct trace_dump_task_context_s *tctx;
   FAR struct trace_dump_task_context_s *ntctx;
+  int i;
 
   /* Finalize the trace dump context */
 
-  tctx = ctx->task;
-  ctx->task = NULL;
-  while (tctx != NULL)
+  for (i = 0; i < TASK_HASH_SIZE; i++)
+    {
+      tctx = ctx->task[i];
+      ctx->task[i] = NULL;
+      while (tctx != NULL)
+        {
+          ntctx = tctx->next;
+          free(tctx);
+          tctx = ntctx;
+        }
+    }
+
+  if (ctx->stats != NULL)
     {
-      ntctx = tctx->next;
-      free(tctx);
-      tctx = ntctx;
+      for (i = 0; i < NR_NOTE_IRQS; i++)
+        {
+          free(ctx->stats->irq[i]);
+        }
+
+      free(ctx->stats);
     }
+
+  free(ctx->buffer);
+
+  /* Close note */
+
+  close(ctx->notefd);
 }
 
 /****************************************************************************
@@ -224,7 +356,7 @@ FAR static struct trace_dump_task_context_s *get_task_context(pid_t pid,
                                       FAR struct trace_dump_context_s *ctx)
 {
   FAR struct trace_dump_task_context_s **tctxp;
-  tctxp = &ctx->task;
+  tctxp = &ctx->task[task_hash(pid)];
   while (*tctxp != NULL)
     {
       if ((*tctxp)->pid == pid)
@@ -238,13 +370,11 @@ FAR static struct trace_dump_task_context_s *get_task_context(pid_t pid,
   /* Create new trace dump task context */
 
   *tctxp = (FAR struct trace_dump_task_context_s *)
-           malloc(sizeof(struct trace_dump_task_context_s));
+           calloc(1, sizeof(struct trace_dump_task_context_s));
   if (*tctxp != NULL)
     {
-      (*tctxp)->next = NULL;
       (*tctxp)->pid = pid;
-      (*tctxp)->syscall_nest = 0;
-      (*tctxp)->name[0] = '\0';
+      ctx->ntasks++;
 
 #if CONFIG_DRIVER_NOTERAM_TASKNAME_BUFSIZE > 0
         {
@@ -282,6 +412,86 @@ static const char *get_task_name(pid_t pid,
   return "<noname>";
 }
 
+/****************************************************************************
+ * Name: trace_dump_systime
+ *
+ * Description:
+ *   Return the time stamp of a note in nanoseconds.
+ *
+ ****************************************************************************/
+
+static uint64_t trace_dump_systime(FAR struct note_common_s *note)
+{
+#ifdef CONFIG_SCHED_INSTRUMENTATION_HIRES
+  uint32_t nsec;
+  uint32_t sec;
+
+  trace_dump_unflatten(&nsec, note->nc_systime_nsec, sizeof(nsec));
+  trace_dump_unflatten(&sec, note->nc_systime_sec, sizeof(sec));
+  return (uint64_t)sec * 1000000000 + nsec;
+#else
+  uint32_t systime;
+
+  trace_dump_unflatten(&systime, note->nc_systime, sizeof(systime));
+  return (uint64_t)systime * CONFIG_USEC_PER_TICK * 1000;
+#endif
+}
+
+/****************************************************************************
+ * Name: trace_dump_ctf_name
+ *
+ * Description:
+ *   Write a task_name event the first time the name of a task is known,
+ *   so that the binary events only need to carry the PID.
+ *
+ ****************************************************************************/
+
+static void trace_dump_ctf_name(pid_t pid, FAR struct note_common_s *note,
+                                FAR struct trace_dump_context_s *ctx)
+{
+  FAR struct trace_dump_task_context_s *tctx;
+  struct trace_ctf_event_s ev;
+#ifdef CONFIG_SMP
+  int cpu = note->nc_cpu;
+#else
+  int cpu = 0;
+#endif
+
+  tctx = get_task_context(pid, ctx);
+  if (tctx == NULL || tctx->named || tctx->name[0] == '\0')
+    {
+      return;
+    }
+
+  trace_ctf_begin(&ev, TRACE_CTF_TASK_NAME, trace_dump_systime(note),
+                  cpu, get_pid(pid));
+  trace_ctf_i32(&ev, get_pid(pid));
+  trace_ctf_string(&ev, tctx->name);
+  trace_ctf_end(&ev, ctx->out);
+
+  tctx->named = true;
+}
+
+/****************************************************************************
+ * Name: trace_dump_ctf_begin
+ ****************************************************************************/
+
+static void trace_dump_ctf_begin(FAR struct trace_ctf_event_s *ev,
+                                 uint8_t id, FAR struct note_common_s *note,
+                                 FAR struct trace_dump_context_s *ctx)
+{
+  pid_t pid;
+#ifdef CONFIG_SMP
+  int cpu = note->nc_cpu;
+#else
+  int cpu = 0;
+#endif
+
+  trace_dump_unflatten(&pid, note->nc_pid, sizeof(pid));
+  trace_dump_ctf_name(pid, note, ctx);
+  trace_ctf_begin(ev, id, trace_dump_systime(note), cpu, get_pid(pid));
+}
+
 /****************************************************************************
  * Name: trace_dump_header
  ****************************************************************************/
@@ -350,13 +560,31 @@ static void trace_dump_sched_switch(FAR FILE *out,
   current_priority = cctx->current_priority;
   next_priority = cctx->next_priority;
 
-  fprintf(out, "sched_switch: "
-               "prev_comm=%s prev_pid=%u prev_prio=%u prev_state=%c ==> "
-               "next_comm=%s next_pid=%u next_prio=%u\n",
-          get_task_name(current_pid, ctx), get_pid(current_pid),
-          current_priority, get_task_state(cctx->current_state),
-          get_task_name(next_pid, ctx), get_pid(next_pid),
-          next_priority);
+  if (is_binary(ctx))
+    {
+      struct trace_ctf_event_s ev;
+
+      trace_dump_ctf_name(current_pid, note, ctx);
+      trace_dump_ctf_name(next_pid, note, ctx);
+      trace_dump_ctf_begin(&ev, TRACE_CTF_SCHED_SWITCH, note, ctx);
+      trace_ctf_i32(&ev, get_pid(current_pid));
+      trace_ctf_u8(&ev, current_priority);
+      trace_ctf_u8(&ev, get_task_state(cctx->current_state));
+      trace_ctf_i32(&ev, get_pid(next_pid));
+      trace_ctf_u8(&ev, next_priority);
+      trace_ctf_end(&ev, out);
+    }
+  else
+    {
+      trace_dump_header(out, note, ctx);
+      fprintf(out, "sched_switch: "
+                   "prev_comm=%s prev_pid=%u prev_prio=%u prev_state=%c ==> "
+                   "next_comm=%s next_pid=%u next_prio=%u\n",
+              get_task_name(current_pid, ctx), get_pid(current_pid),
+              current_priority, get_task_state(cctx->current_state),
+              get_task_name(next_pid, ctx), get_pid(next_pid),
+              next_priority);
+    }
 
   cctx->current_pid = cctx->next_pid;
   cctx->current_priority = cctx->next_priority;
@@ -368,11 +596,14 @@ static void trace_dump_sched_switch(FAR FILE *out,
  * Name: trace_dump_one
  ****************************************************************************/
 
-static int trace_dump_one(trace_dump_t type, FAR FILE *out, FAR uint8_t *p,
+static int trace_dump_one(FAR uint8_t *p,
                           FAR struct trace_dump_context_s *ctx)
 {
   FAR struct note_common_s *note = (FAR struct note_common_s *)p;
   FAR struct trace_dump_cpu_context_s *cctx;
+  struct trace_ctf_event_s ev;
+  trace_dump_t type = ctx->type;
+  FAR FILE *out = ctx->out;
   pid_t pid;
 #ifdef CONFIG_SMP
   int cpu = note->nc_cpu;
@@ -402,9 +633,20 @@ static int trace_dump_one(trace_dump_t type, FAR FILE *out, FAR uint8_t *p,
           if (tctx != NULL)
             {
               copy_task_name(tctx->name, nst->nst_name);
+              tctx->named = false;
             }
 #endif
 
+          if (is_binary(ctx))
+            {
+              trace_dump_ctf_begin(&ev, TRACE_CTF_SCHED_WAKEUP_NEW,
+                                   note, ctx);
+              trace_ctf_i32(&ev, get_pid(pid));
+              trace_ctf_u8(&ev, cpu);
+              trace_ctf_end(&ev, out);
+              break;
+            }
+
           trace_dump_header(out, note, ctx);
           fprintf(out, "sched_wakeup_new: comm=%s pid=%d target_cpu=%d\n",
                   get_task_name(pid, ctx), get_pid(pid), cpu);
@@ -449,7 +691,6 @@ static int trace_dump_one(trace_dump_t type, FAR FILE *out, FAR uint8_t *p,
                * executed immediately.
                */
 
-              trace_dump_header(out, note, ctx);
               trace_dump_sched_switch(out, note, ctx);
             }
           else
@@ -458,10 +699,23 @@ static int trace_dump_one(trace_dump_t type, FAR FILE *out, FAR uint8_t *p,
                * until leaving the interrupt handler.
                */
 
-              trace_dump_header(out, note, ctx);
-              fprintf(out, "sched_waking: comm=%s pid=%d target_cpu=%d\n",
-                      get_task_name(cctx->next_pid, ctx),
-                      get_pid(cctx->next_pid), cpu);
+              if (is_binary(ctx))
+                {
+                  trace_dump_ctf_begin(&ev, TRACE_CTF_SCHED_WAKING,
+                                       note, ctx);
+                  trace_ctf_i32(&ev, get_pid(cctx->next_pid));
+                  trace_ctf_u8(&ev, cpu);
+                  trace_ctf_end(&ev, out);
+                }
+              else
+                {
+                  trace_dump_header(out, note, ctx);
+                  fprintf(out,
+                          "sched_waking: comm=%s pid=%d target_cpu=%d\n",
+                          get_task_name(cctx->next_pid, ctx),
+                          get_pid(cctx->next_pid), cpu);
+                }
+
               cctx->pendingswitch = true;
             }
         }
@@ -505,6 +759,22 @@ static int trace_dump_one(trace_dump_t type, FAR FILE *out, FAR uint8_t *p,
               break;
             }
 
+          if (is_binary(ctx))
+            {
+              trace_dump_ctf_begin(&ev, TRACE_CTF_SYSCALL_ENTRY, note, ctx);
+              trace_ctf_u16(&ev, nsc->nsc_nr);
+              trace_ctf_u8(&ev, nsc->nsc_argc);
+              for (i = j = 0; i < nsc->nsc_argc; i++, j += sizeof(arg))
+                {
+                  trace_dump_unflatten(&arg, &nsc->nsc_args[j],
+                                       sizeof(arg));
+                  trace_ctf_x64(&ev, arg);
+                }
+
+              trace_ctf_end(&ev, out);
+              break;
+            }
+
           trace_dump_header(out, note, ctx);
           if (type == TRACE_TYPE_ANDROID)
             {
@@ -517,9 +787,9 @@ static int trace_dump_one(trace_dump_t type, FAR FILE *out, FAR uint8_t *p,
                       g_funcnames[nsc->nsc_nr - CONFIG_SYS_RESERVED]);
             }
 
-          for (i = j = 0; i < nsc->nsc_argc; i++)
+          for (i = j = 0; i < nsc->nsc_argc; i++, j += sizeof(arg))
             {
-              trace_dump_unflatten(&arg, nsc->nsc_args, sizeof(arg));
+              trace_dump_unflatten(&arg, &nsc->nsc_args[j], sizeof(arg));
               if (i == 0)
                 {
                   fprintf(out, "arg%d: 0x%" PRIxPTR, i, arg);
@@ -570,9 +840,18 @@ static int trace_dump_one(trace_dump_t type, FAR FILE *out, FAR uint8_t *p,
               break;
             }
 
-          trace_dump_header(out, note, ctx);
           trace_dump_unflatten(&result, nsc->nsc_result, sizeof(result));
 
+          if (is_binary(ctx))
+            {
+              trace_dump_ctf_begin(&ev, TRACE_CTF_SYSCALL_EXIT, note, ctx);
+              trace_ctf_u16(&ev, nsc->nsc_nr);
+              trace_ctf_x64(&ev, result);
+              trace_ctf_end(&ev, out);
+              break;
+            }
+
+          trace_dump_header(out, note, ctx);
           if (type == TRACE_TYPE_ANDROID)
             {
               fprintf(out, "tracing_mark_write: E|%d|"
@@ -596,9 +875,19 @@ static int trace_dump_one(trace_dump_t type, FAR FILE *out, FAR uint8_t *p,
           FAR struct note_irqhandler_s *nih;
 
           nih = (FAR struct note_irqhandler_s *)p;
-          trace_dump_header(out, note, ctx);
-          fprintf(out, "irq_handler_entry: irq=%u name=%d\n",
-                  nih->nih_irq, nih->nih_irq);
+          if (is_binary(ctx))
+            {
+              trace_dump_ctf_begin(&ev, TRACE_CTF_IRQ_ENTRY, note, ctx);
+              trace_ctf_u8(&ev, nih->nih_irq);
+              trace_ctf_end(&ev, out);
+            }
+          else
+            {
+              trace_dump_header(out, note, ctx);
+              fprintf(out, "irq_handler_entry: irq=%u name=%d\n",
+                      nih->nih_irq, nih->nih_irq);
+            }
+
           cctx->intr_nest++;
         }
         break;
@@ -608,9 +897,19 @@ static int trace_dump_one(trace_dump_t type, FAR FILE *out, FAR uint8_t *p,
           FAR struct note_irqhandler_s *nih;
 
           nih = (FAR struct note_irqhandler_s *)p;
-          trace_dump_header(out, note, ctx);
-          fprintf(out, "irq_handler_exit: irq=%u ret=handled\n",
-                  nih->nih_irq);
+          if (is_binary(ctx))
+            {
+              trace_dump_ctf_begin(&ev, TRACE_CTF_IRQ_EXIT, note, ctx);
+              trace_ctf_u8(&ev, nih->nih_irq);
+              trace_ctf_end(&ev, out);
+            }
+          else
+            {
+              trace_dump_header(out, note, ctx);
+              fprintf(out, "irq_handler_exit: irq=%u ret=handled\n",
+                      nih->nih_irq);
+            }
+
           cctx->intr_nest--;
 
           if (cctx->intr_nest <= 0)
@@ -620,7 +919,6 @@ static int trace_dump_one(trace_dump_t type, FAR FILE *out, FAR uint8_t *p,
                 {
                   /* If the pending task switch exists, it is executed here */
 
-                  trace_dump_header(out, note, ctx);
                   trace_dump_sched_switch(out, note, ctx);
                 }
             }
@@ -635,9 +933,18 @@ static int trace_dump_one(trace_dump_t type, FAR FILE *out, FAR uint8_t *p,
           uintptr_t ip;
 
           nst = (FAR struct note_string_s *)p;
-          trace_dump_header(out, note, ctx);
           trace_dump_unflatten(&ip, nst->nst_ip, sizeof(ip));
 
+          if (is_binary(ctx))
+            {
+              trace_dump_ctf_begin(&ev, TRACE_CTF_PRINT, note, ctx);
+              trace_ctf_x64(&ev, ip);
+              trace_ctf_string(&ev, nst->nst_data);
+              trace_ctf_end(&ev, out);
+              break;
+            }
+
+          trace_dump_header(out, note, ctx);
           if (type == TRACE_TYPE_ANDROID &&
               nst->nst_data[1] == '\0' &&
               (nst->nst_data[0] == 'B' ||
@@ -661,11 +968,21 @@ static int trace_dump_one(trace_dump_t type, FAR FILE *out, FAR uint8_t *p,
           int i;
 
           nbi = (FAR struct note_binary_s *)p;
-          trace_dump_header(out, note, ctx);
           count = note->nc_length - sizeof(struct note_binary_s) + 1;
 
           trace_dump_unflatten(&ip, nbi->nbi_ip, sizeof(ip));
 
+          if (is_binary(ctx))
+            {
+              trace_dump_ctf_begin(&ev, TRACE_CTF_BINARY, note, ctx);
+              trace_ctf_x64(&ev, ip);
+              trace_ctf_u8(&ev, nbi->nbi_event);
+              trace_ctf_bytes(&ev, nbi->nbi_data, count);
+              trace_ctf_end(&ev, out);
+              break;
+            }
+
+          trace_dump_header(out, note, ctx);
           fprintf(out, "0x%" PRIdPTR ": event=%u count=%u",
                   ip, nbi->nbi_event, count);
           for (i = 0; i < count; i++)
@@ -682,72 +999,664 @@ static int trace_dump_one(trace_dump_t type, FAR FILE *out, FAR uint8_t *p,
         break;
     }
 
-  fflush(out);
-
   /* Return the length of the processed note */
 
   return note->nc_length;
 }
 
 /****************************************************************************
- * Public Functions
- ****************************************************************************/
-
-/****************************************************************************
- * Name: trace_dump
- *
- * Description:
- *   Read notes and dump trace results.
- *
+ * Name: trace_dump_hist
  ****************************************************************************/
 
-int trace_dump(trace_dump_t type, FAR FILE *out)
+static void trace_dump_hist(FAR uint32_t *hist, uint64_t duration)
 {
-  struct trace_dump_context_s ctx;
-  uint8_t tracedata[UCHAR_MAX];
-  FAR uint8_t *p;
-  int size;
-  int ret;
-  int fd;
-
-  /* Open note for read */
+  uint64_t usec = duration / 1000;
+  int i = 0;
 
-  fd = open("/dev/note/ram", O_RDONLY);
-  if (fd < 0)
+  while (usec > 0 && i < HIST_NBUCKETS - 1)
     {
-      fprintf(stderr, "trace: cannot open /dev/note/ram\n");
-      return ERROR;
+      usec >>= 1;
+      i++;
     }
 
-  trace_dump_init_context(&ctx, fd);
+  hist[i]++;
+}
 
-  /* Read and output all notes */
+/****************************************************************************
+ * Name: trace_dump_account_switch
+ ****************************************************************************/
+
+static void trace_dump_account_switch(uint64_t now,
+                                 FAR struct trace_dump_cpu_context_s *cctx,
+                                 FAR struct trace_dump_context_s *ctx)
+{
+  FAR struct trace_dump_task_context_s *tctx;
+  uint64_t latency;
+
+  /* Charge the time since the last switch to the task switched out.  If it
+   * was preempted, it is ready to run again from now on.
+   */
 
-  while (1)
+  tctx = get_task_context(cctx->current_pid, ctx);
+  if (tctx != NULL)
     {
-      ret = read(fd, tracedata, sizeof tracedata);
-      if (ret <= 0)
+      tctx->runtime += now - cctx->switch_time;
+      if (cctx->current_state != 0 &&
+          cctx->current_state <= LAST_READY_TO_RUN_STATE &&
+          tctx->readytime == 0)
         {
-          break;
+          tctx->readytime = now;
         }
+    }
 
-      p = tracedata;
-      do
+  tctx = get_task_context(cctx->next_pid, ctx);
+  if (tctx != NULL)
+    {
+      tctx->nswitches++;
+      if (tctx->readytime != 0)
         {
-          size = trace_dump_one(type, out, p, &ctx);
-          p += size;
-          ret -= size;
+          latency = now - tctx->readytime;
+          tctx->latency += latency;
+          if (latency > tctx->maxlatency)
+            {
+              tctx->maxlatency = latency;
+            }
+
+          tctx->nwakeups++;
+          tctx->readytime = 0;
         }
-      while (ret > 0);
     }
 
-  trace_dump_fini_context(&ctx);
+  cctx->switch_time = now;
+  cctx->current_pid = cctx->next_pid;
+  cctx->current_priority = cctx->next_priority;
+  cctx->pendingswitch = false;
+}
 
-  /* Close note */
+/****************************************************************************
+ * Name: trace_dump_account
+ *
+ * Description:
+ *   Update the summary statistics with one note, instead of writing it
+ *   out.  The task switch logic follows trace_dump_one().
+ *
+ ****************************************************************************/
+
+static int trace_dump_account(FAR uint8_t *p,
+                              FAR struct trace_dump_context_s *ctx)
+{
+  FAR struct note_common_s *note = (FAR struct note_common_s *)p;
+  FAR struct trace_dump_stats_s *stats = ctx->stats;
+  FAR struct trace_dump_cpu_context_s *cctx;
+  FAR struct trace_dump_task_context_s *tctx;
+  uint64_t now;
+  pid_t pid;
+#ifdef CONFIG_SMP
+  int cpu = note->nc_cpu;
+#else
+  int cpu = 0;
+#endif
+
+  now = trace_dump_systime(note);
+  if (stats->nnotes++ == 0)
+    {
+      stats->first = now;
+    }
+
+  stats->last = now;
+
+  cctx = &ctx->cpu[cpu];
+  trace_dump_unflatten(&pid, note->nc_pid, sizeof(pid));
 
-  close(fd);
+  if (cctx->current_pid < 0)
+    {
+      cctx->current_pid = pid;
+      cctx->switch_time = now;
+    }
+
+  switch (note->nc_type)
+    {
+#if CONFIG_TASK_NAME_SIZE > 0
+      case NOTE_START:
+        {
+          FAR struct note_start_s *nst = (FAR struct note_start_s *)p;
 
-  return ret;
+          tctx = get_task_context(pid, ctx);
+          if (tctx != NULL)
+            {
+              copy_task_name(tctx->name, nst->nst_name);
+            }
+        }
+        break;
+#endif
+
+      case NOTE_STOP:
+        cctx->current_state = 0;
+        break;
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_SWITCH
+      case NOTE_SUSPEND:
+        {
+          FAR struct note_suspend_s *nsu = (FAR struct note_suspend_s *)p;
+
+          cctx->current_state = nsu->nsu_state;
+        }
+        break;
+
+      case NOTE_RESUME:
+        {
+          cctx->next_pid = pid;
+          cctx->next_priority = note->nc_priority;
+
+          if (cctx->intr_nest == 0)
+            {
+              trace_dump_account_switch(now, cctx, ctx);
+            }
+          else
+            {
+              /* Woken by an interrupt handler, it runs when the handler
+               * returns.
+               */
+
+              tctx = get_task_context(pid, ctx);
+              if (tctx != NULL && tctx->readytime == 0)
+                {
+                  tctx->readytime = now;
+                }
+
+              cctx->pendingswitch = true;
+            }
+        }
+        break;
+#endif
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_SYSCALL
+      case NOTE_SYSCALL_ENTER:
+        {
+          FAR struct note_syscall_enter_s *nsc;
+
+          nsc = (FAR struct note_syscall_enter_s *)p;
+          tctx = get_task_context(pid, ctx);
+          if (cctx->intr_nest > 0 || tctx == NULL ||
+              tctx->syscall_nest++ > 0 ||
+              nsc->nsc_nr < CONFIG_SYS_RESERVED ||
+              nsc->nsc_nr >= SYS_maxsyscall)
+            {
+              break;
+            }
+
+          stats->syscall[nsc->nsc_nr - CONFIG_SYS_RESERVED].count++;
+          tctx->nsyscalls++;
+          tctx->syscall_nr = nsc->nsc_nr;
+          tctx->syscall_start = now;
+          tctx->insyscall = true;
+        }
+        break;
+
+      case NOTE_SYSCALL_LEAVE:
+        {
+          FAR struct note_syscall_leave_s *nsc;
+          FAR struct trace_dump_syscall_stats_s *sc;
+
+          nsc = (FAR struct note_syscall_leave_s *)p;
+          tctx = get_task_context(pid, ctx);
+          if (cctx->intr_nest > 0 || tctx == NULL ||
+              --tctx->syscall_nest > 0)
+            {
+              break;
+            }
+
+          tctx->syscall_nest = 0;
+          if (tctx->insyscall && tctx->syscall_nr == nsc->nsc_nr)
+            {
+              sc = &stats->syscall[nsc->nsc_nr - CONFIG_SYS_RESERVED];
+              sc->total += now - tctx->syscall_start;
+              sc->ndone++;
+            }
+
+          tctx->insyscall = false;
+        }
+        break;
+#endif
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_IRQHANDLER
+      case NOTE_IRQ_ENTER:
+        {
+          if (cctx->intr_nest < IRQ_MAXNEST)
+            {
+              cctx->irq_start[cctx->intr_nest] = now;
+            }
+
+          cctx->intr_nest++;
+        }
+        break;
+
+      case NOTE_IRQ_LEAVE:
+        {
+          FAR struct note_irqhandler_s *nih;
+          FAR struct trace_dump_irq_stats_s *irq;
+          uint64_t duration;
+
+          nih = (FAR struct note_irqhandler_s *)p;
+          cctx->intr_nest--;
+
+          /* The entry is missing if the trace started in the handler */
+
+          if (cctx->intr_nest >= 0 && cctx->intr_nest < IRQ_MAXNEST)
+            {
+              irq = stats->irq[nih->nih_irq];
+              if (irq == NULL)
+                {
+                  irq = calloc(1, sizeof(struct trace_dump_irq_stats_s));
+                  stats->irq[nih->nih_irq] = irq;
+                }
+
+              if (irq != NULL)
+                {
+                  duration = now - cctx->irq_start[cctx->intr_nest];
+                  if (irq->count == 0 || duration < irq->min)
+                    {
+                      irq->min = duration;
+                    }
+
+                  if (duration > irq->max)
+                    {
+                      irq->max = duration;
+                    }
+
+                  irq->total += duration;
+                  irq->count++;
+                  trace_dump_hist(irq->hist, duration);
+                }
+            }
+
+          if (cctx->intr_nest <= 0)
+            {
+              cctx->intr_nest = 0;
+              if (cctx->pendingswitch)
+                {
+                  trace_dump_account_switch(now, cctx, ctx);
+                }
+            }
+        }
+        break;
+#endif
+
+      default:
+        break;
+    }
+
+  return note->nc_length;
+}
+
+/****************************************************************************
+ * Name: trace_dump_skip
+ *
+ * Description:
+ *   Return true for the syscall notes of ctx->selfpid, i.e. those caused by
+ *   the trace command itself reading the notes and writing them out.
+ *
+ ****************************************************************************/
+
+static bool trace_dump_skip(FAR uint8_t *p,
+                            FAR struct trace_dump_context_s *ctx)
+{
+#ifdef CONFIG_SCHED_INSTRUMENTATION_SYSCALL
+  FAR struct note_common_s *note = (FAR struct note_common_s *)p;
+  pid_t pid;
+
+  if (ctx->selfpid >= 0 && (note->nc_type == NOTE_SYSCALL_ENTER ||
+                            note->nc_type == NOTE_SYSCALL_LEAVE))
+    {
+      trace_dump_unflatten(&pid, note->nc_pid, sizeof(pid));
+      return pid == ctx->selfpid;
+    }
+#endif
+
+  return false;
+}
+
+/****************************************************************************
+ * Name: trace_dump_drain
+ *
+ * Description:
+ *   Read and output the notes until the buffer is empty, or only one
+ *   bufferful if 'once' is set.  Returns the number of bytes processed.
+ *
+ ****************************************************************************/
+
+static ssize_t trace_dump_drain(FAR struct trace_dump_context_s *ctx,
+                                bool once)
+{
+  FAR uint8_t *p;
+  ssize_t total = 0;
+  int size;
+  int ret;
+
+  do
+    {
+      ret = read(ctx->notefd, ctx->buffer, CONFIG_SYSTEM_TRACE_BUFSIZE);
+      if (ret <= 0)
+        {
+          break;
+        }
+
+      total += ret;
+      p = ctx->buffer;
+      do
+        {
+          if (trace_dump_skip(p, ctx))
+            {
+              size = ((FAR struct note_common_s *)p)->nc_length;
+            }
+          else
+            {
+              size = ctx->stats != NULL ? trace_dump_account(p, ctx) :
+                                          trace_dump_one(p, ctx);
+            }
+
+          p += size;
+          ret -= size;
+        }
+      while (ret > 0);
+    }
+  while (!once);
+
+  return ret < 0 ? ret : total;
+}
+
+/****************************************************************************
+ * Name: trace_dump_compare_runtime
+ ****************************************************************************/
+
+static int trace_dump_compare_runtime(FAR const void *a, FAR const void *b)
+{
+  FAR const struct trace_dump_task_context_s *ta =
+    *(FAR struct trace_dump_task_context_s * const *)a;
+  FAR const struct trace_dump_task_context_s *tb =
+    *(FAR struct trace_dump_task_context_s * const *)b;
+
+  if (ta->runtime != tb->runtime)
+    {
+      return ta->runtime < tb->runtime ? 1 : -1;
+    }
+
+  return ta->pid - tb->pid;
+}
+
+/****************************************************************************
+ * Name: trace_dump_summary
+ *
+ * Description:
+ *   Output the statistics gathered by trace_dump_account().
+ *
+ ****************************************************************************/
+
+static void trace_dump_summary(FAR struct trace_dump_context_s *ctx)
+{
+  FAR struct trace_dump_stats_s *stats = ctx->stats;
+  FAR struct trace_dump_task_context_s **tasks;
+  FAR struct trace_dump_task_context_s *tctx;
+  FAR FILE *out = ctx->out;
+  uint64_t elapsed;
+  int ntasks;
+  int cpu;
+  int i;
+
+  elapsed = stats->last - stats->first;
+
+  /* Charge the tasks still running to the end of the trace */
+
+  for (cpu = 0; cpu < NCPUS; cpu++)
+    {
+      if (ctx->cpu[cpu].current_pid >= 0)
+        {
+          tctx = get_task_context(ctx->cpu[cpu].current_pid, ctx);
+          if (tctx != NULL)
+            {
+              tctx->runtime += stats->last - ctx->cpu[cpu].switch_time;
+            }
+        }
+    }
+
+  fprintf(out, "Trace summary: %" PRIu32 " notes in %" PRIu64
+               ".%06" PRIu64 " s\n\n", stats->nnotes,
+          elapsed / 1000000000, elapsed % 1000000000 / 1000);
+
+  /* Tasks, the busiest first.  If there are none, or no memory to sort
+   * them, the table stays empty but the sections below are still shown.
+   */
+
+  tasks = NULL;
+  ntasks = 0;
+
+  if (ctx->ntasks > 0)
+    {
+      tasks = malloc(ctx->ntasks * sizeof(tasks[0]));
+    }
+
+  if (tasks != NULL)
+    {
+      for (i = 0; i < TASK_HASH_SIZE; i++)
+        {
+          for (tctx = ctx->task[i]; tctx != NULL; tctx = tctx->next)
+            {
+              tasks[ntasks++] = tctx;
+            }
+        }
+
+      qsort(tasks, ntasks, sizeof(tasks[0]), trace_dump_compare_runtime);
+    }
+
+  fprintf(out, "%5s %-16s %12s %6s %8s %8s %10s %10s %8s\n",
+          "PID", "NAME", "RUN(us)", "RUN%", "SWITCHES", "WAKEUPS",
+          "AVGLAT(us)", "MAXLAT(us)", "SYSCALLS");
+
+  for (i = 0; i < ntasks; i++)
+    {
+      tctx = tasks[i];
+      fprintf(out, "%5d %-16s %12" PRIu64 " %4" PRIu64 ".%" PRIu64
+                   " %8" PRIu32 " %8" PRIu32 " %10" PRIu64 " %10" PRIu64
+                   " %8" PRIu32 "\n",
+              (int)tctx->pid, get_task_name(tctx->pid, ctx),
+              tctx->runtime / 1000,
+              elapsed ? tctx->runtime * 100 / elapsed : 0,
+              elapsed ? tctx->runtime * 1000 / elapsed % 10 : 0,
+              tctx->nswitches, tctx->nwakeups,
+              tctx->nwakeups ? tctx->latency / tctx->nwakeups / 1000 : 0,
+              tctx->maxlatency / 1000, tctx->nsyscalls);
+    }
+
+  free(tasks);
+
+  /* Interrupt handler durations */
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_IRQHANDLER
+  fprintf(out, "\n%5s %8s %10s %10s %10s  %s\n",
+          "IRQ", "COUNT", "MIN(us)", "AVG(us)", "MAX(us)",
+          "HISTOGRAM (<1us <2us <4us ...)");
+
+  for (i = 0; i < NR_NOTE_IRQS; i++)
+    {
+      FAR struct trace_dump_irq_stats_s *irq = stats->irq[i];
+      int last;
+      int j;
+
+      if (irq == NULL)
+        {
+          continue;
+        }
+
+      fprintf(out, "%5d %8" PRIu32 " %10" PRIu64 " %10" PRIu64
+                   " %10" PRIu64 " ",
+              i, irq->count, irq->min / 1000,
+              irq->total / irq->count / 1000, irq->max / 1000);
+
+      for (last = HIST_NBUCKETS - 1; last > 0; last--)
+        {
+          if (irq->hist[last] != 0)
+            {
+              break;
+            }
+        }
+
+      for (j = 0; j <= last; j++)
+        {
+          fprintf(out, " %" PRIu32, irq->hist[j]);
+        }
+
+      fprintf(out, "\n");
+    }
+#endif
+
+  /* System calls */
+
+#ifdef CONFIG_SCHED_INSTRUMENTATION_SYSCALL
+  fprintf(out, "\n%-24s %8s %12s %10s\n",
+          "SYSCALL", "COUNT", "TOTAL(us)", "AVG(us)");
+
+  for (i = 0; i < SYS_maxsyscall - CONFIG_SYS_RESERVED; i++)
+    {
+      FAR struct trace_dump_syscall_stats_s *sc = &stats->syscall[i];
+
+      if (sc->count == 0)
+        {
+          continue;
+        }
+
+      fprintf(out, "%-24s %8" PRIu32 " %12" PRIu64 " %10" PRIu64 "\n",
+              g_funcnames[i], sc->count, sc->total / 1000,
+              sc->ndone ? sc->total / sc->ndone / 1000 : 0);
+    }
+#endif
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: trace_dump
+ *
+ * Description:
+ *   Read notes and dump trace results.
+ *
+ ****************************************************************************/
+
+int trace_dump(trace_dump_t type, FAR FILE *out)
+{
+  struct trace_dump_context_s ctx;
+  ssize_t ret;
+
+  ret = trace_dump_init_context(&ctx, type, out);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  /* Read and output all notes */
+
+  ret = trace_dump_drain(&ctx, false);
+  if (ctx.stats != NULL)
+    {
+      trace_dump_summary(&ctx);
+    }
+
+  fflush(out);
+
+  trace_dump_fini_context(&ctx);
+  return ret < 0 ? ERROR : OK;
+}
+
+/****************************************************************************
+ * Name: trace_stream
+ *
+ * Description:
+ *   Keep reading notes while tracing goes on, and write them out as they
+ *   arrive.  Output is flushed after every read, so a socket or file sees
+ *   the events within 'interval' milliseconds.
+ *
+ *   The notes are read one bufferful at a time, checking '*stop' and the
+ *   duration in between: with syscall tracing on, the reads and writes of
+ *   this loop add notes of their own, so the buffer may never run empty.
+ *   Those notes are left out of the output.
+ *
+ ****************************************************************************/
+
+int trace_stream(trace_dump_t type, FAR FILE *out, unsigned int interval,
+                 unsigned int duration, FAR volatile bool *stop)
+{
+  struct trace_dump_context_s ctx;
+  struct timespec start;
+  struct timespec now;
+  ssize_t ret;
+
+  ret = trace_dump_init_context(&ctx, type, out);
+  if (ret < 0)
+    {
+      return ret;
+    }
+
+  ctx.selfpid = getpid();
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  while (!*stop)
+    {
+      ret = trace_dump_drain(&ctx, true);
+      if (ret < 0)
+        {
+          break;
+        }
+
+      /* The consumer went away, e.g. the host closed the connection */
+
+      if (fflush(out) == EOF || ferror(out))
+        {
+          ret = ERROR;
+          break;
+        }
+
+      if (duration > 0)
+        {
+          clock_gettime(CLOCK_MONOTONIC, &now);
+          if (now.tv_sec - start.tv_sec >= duration)
+            {
+              break;
+            }
+        }
+
+      /* Sleep only if there was nothing to read, so that a busy system is
+       * drained as fast as the output allows.
+       */
+
+      if (ret == 0)
+        {
+          usleep(interval * 1000);
+        }
+    }
+
+  if (ctx.stats != NULL)
+    {
+      trace_dump_summary(&ctx);
+      fflush(out);
+    }
+
+  trace_dump_fini_context(&ctx);
+  return ret < 0 ? ERROR : OK;
+}
+
+/****************************************************************************
+ * Name: trace_dump_metadata
+ *
+ * Description:
+ *   Output the CTF metadata that describes TRACE_TYPE_GENERIC_CTF streams.
+ *
+ ****************************************************************************/
+
+void trace_dump_metadata(FAR FILE *out)
+{
+  trace_ctf_metadata(out);
+  fflush(out);
 }
 
 /****************************************************************************
@@ -0,0 +1,705 @@
+/****************************************************************************
+ * apps/system/uorb/recorder.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <malloc.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/param.h>
+#include <unistd.h>
+
+#include "recorder.h"
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define RECORD_ALIGN       64
+#define RECORD_POLL_TIME   1000
+#define RECORD_MAX_SAMPLE  1024
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct record_topic_s
+{
+  struct orb_object object;       /* Recorded object */
+  unsigned long     count;        /* Samples recorded */
+};
+
+struct record_s
+{
+  FAR struct record_topic_s *topics;
+  FAR struct pollfd *fds;
+  int               ntopics;
+  int               fd;           /* Log file */
+  FAR uint8_t      *buf;          /* Batch buffer */
+  size_t            len;          /* Bytes pending in buf */
+  orb_abstime       last;         /* Time of the previous sample */
+  uint64_t          written;      /* Bytes written to the log */
+  unsigned long     nsamples;     /* Samples recorded */
+  unsigned long     nwrites;      /* Number of write() calls */
+  orb_abstime       maxwrite;     /* Longest write() in microseconds */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static bool g_should_exit = false;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void usage(void)
+{
+  uorbinfo_raw("\n\
+Record uORB topics to a binary log that uorb_replay can publish again.\n\
+\n\
+Samples are batched in memory and written to the log %d bytes at a\n\
+time.  Recording stops on Ctrl+C, or when -t or -n is reached.\n\
+\n\
+uorb_record [arguments...] <file> [topics]\n\
+\ttopics           Comma separated topic list,\n\
+\t                 e.g. sensor_accel,sensor_gyro0.\n\
+\t                 A topic without an instance records every instance.\n\
+\t                 All topics are recorded if none are given.\n\
+\t[-r <val>  ]     Subscription rate (unlimited if 0), default: 0\n\
+\t[-b <val>  ]     Subscription maximum report latency in us\n\
+\t                 (unlimited if 0), default: 0\n\
+\t[-t <val>  ]     Stop after this many seconds (unlimited if 0),\n\
+\t                 default: 0\n\
+\t[-n <val>  ]     Stop after this many samples (unlimited if 0),\n\
+\t                 default: 0\n\
+\t[-h        ]     Recorder commands help\n\
+  ", CONFIG_UORB_RECORDER_BUFSIZE);
+}
+
+static void exit_handler(int signo)
+{
+  g_should_exit = true;
+}
+
+/****************************************************************************
+ * Name: record_add
+ *
+ * Description:
+ *   Add one topic instance to the recording, ignoring duplicates.
+ *
+ ****************************************************************************/
+
+static int record_add(FAR struct record_s *rec,
+                      FAR const struct orb_metadata *meta, int instance)
+{
+  FAR struct record_topic_s *topics;
+  int i;
+
+  if (strlen(meta->o_name) >= ORB_LOG_NAME_MAX || instance > UINT8_MAX)
+    {
+      return -ENAMETOOLONG;
+    }
+
+  for (i = 0; i < rec->ntopics; i++)
+    {
+      if (rec->topics[i].object.meta == meta &&
+          rec->topics[i].object.instance == instance)
+        {
+          return 0;
+        }
+    }
+
+  if (rec->ntopics >= UINT16_MAX)
+    {
+      return -E2BIG;
+    }
+
+  topics = realloc(rec->topics, (rec->ntopics + 1) * sizeof(*topics));
+  if (topics == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  rec->topics = topics;
+  topics[rec->ntopics].object.meta     = meta;
+  topics[rec->ntopics].object.instance = instance;
+  topics[rec->ntopics].count           = 0;
+  rec->ntopics++;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: record_select
+ *
+ * Description:
+ *   Build the topic list from the filter, or from every topic node when
+ *   there is no filter.  A topic in the filter without an instance number
+ *   selects all of its advertised instances.
+ *
+ ****************************************************************************/
+
+static int record_select(FAR struct record_s *rec, FAR const char *filter)
+{
+  FAR const struct orb_metadata *meta;
+  FAR struct dirent *entry;
+  char name[ORB_PATH_MAX];
+  FAR DIR *dir;
+  size_t len;
+  int instance;
+  int ret;
+
+  if (filter)
+    {
+      FAR const char *member = filter;
+      FAR const char *tmp;
+
+      do
+        {
+          while (*member == ',')
+            {
+              member++;
+            }
+
+          tmp = strchr(member, ',');
+          len = tmp ? tmp - member : strlen(member);
+          if (!len)
+            {
+              break;
+            }
+
+          strlcpy(name, member, MIN(len + 1, sizeof(name)));
+          len = strlen(name);
+          member = tmp;
+
+          meta = orb_get_meta(name);
+          if (meta == NULL)
+            {
+              uorbinfo_raw("Unknown topic %s", name);
+              continue;
+            }
+
+          if (isdigit(name[len - 1]))
+            {
+              ret = record_add(rec, meta, name[len - 1] - '0');
+            }
+          else
+            {
+              ret = 0;
+              for (instance = 0; ret >= 0 &&
+                   orb_exists(meta, instance) == 0; instance++)
+                {
+                  ret = record_add(rec, meta, instance);
+                }
+            }
+
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+      while (tmp);
+
+      return rec->ntopics;
+    }
+
+  dir = opendir(ORB_SENSOR_PATH);
+  if (!dir)
+    {
+      return -errno;
+    }
+
+  while ((entry = readdir(dir)))
+    {
+      if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+        {
+          continue;
+        }
+
+      len = strlen(entry->d_name);
+      if (!len || !isdigit(entry->d_name[len - 1]))
+        {
+          continue;
+        }
+
+      meta = orb_get_meta(entry->d_name);
+      if (meta == NULL)
+        {
+          continue;
+        }
+
+      ret = record_add(rec, meta, entry->d_name[len - 1] - '0');
+      if (ret < 0)
+        {
+          closedir(dir);
+          return ret;
+        }
+    }
+
+  closedir(dir);
+  return rec->ntopics;
+}
+
+/****************************************************************************
+ * Name: record_flush
+ *
+ * Description:
+ *   Write out the pending part of the batch buffer.  Apart from the very
+ *   last one, every write is a full buffer at a buffer aligned offset.
+ *
+ ****************************************************************************/
+
+static int record_flush(FAR struct record_s *rec)
+{
+  FAR const uint8_t *ptr = rec->buf;
+  size_t remain = rec->len;
+  orb_abstime start;
+  orb_abstime elapsed;
+  ssize_t nwritten;
+
+  start = orb_absolute_time();
+  while (remain > 0)
+    {
+      nwritten = write(rec->fd, ptr, remain);
+      if (nwritten < 0)
+        {
+          if (errno == EINTR)
+            {
+              continue;
+            }
+
+          return -errno;
+        }
+
+      ptr    += nwritten;
+      remain -= nwritten;
+    }
+
+  elapsed = orb_elapsed_time(&start);
+  if (elapsed > rec->maxwrite)
+    {
+      rec->maxwrite = elapsed;
+    }
+
+  rec->written += rec->len;
+  rec->nwrites++;
+  rec->len = 0;
+  return 0;
+}
+
+/****************************************************************************
+ * Name: record_append
+ *
+ * Description:
+ *   Copy bytes into the batch buffer, flushing it each time it fills up.
+ *   Records are allowed to straddle two buffers.
+ *
+ ****************************************************************************/
+
+static int record_append(FAR struct record_s *rec, FAR const void *data,
+                         size_t len)
+{
+  FAR const uint8_t *ptr = data;
+  size_t chunk;
+  int ret;
+
+  while (len > 0)
+    {
+      chunk = MIN(len, CONFIG_UORB_RECORDER_BUFSIZE - rec->len);
+      memcpy(rec->buf + rec->len, ptr, chunk);
+      rec->len += chunk;
+      ptr      += chunk;
+      len      -= chunk;
+
+      if (rec->len == CONFIG_UORB_RECORDER_BUFSIZE)
+        {
+          ret = record_flush(rec);
+          if (ret < 0)
+            {
+              return ret;
+            }
+        }
+    }
+
+  return 0;
+}
+
+/****************************************************************************
+ * Name: record_header
+ *
+ * Description:
+ *   Put the log header and topic records in front of the samples.
+ *
+ ****************************************************************************/
+
+static int record_header(FAR struct record_s *rec)
+{
+  struct orb_log_header_s header;
+  struct orb_log_topic_s topic;
+  int ret;
+  int i;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, ORB_LOG_MAGIC, sizeof(ORB_LOG_MAGIC));
+  header.version = ORB_LOG_VERSION;
+  header.ntopics = rec->ntopics;
+  header.start   = rec->last;
+
+  ret = record_append(rec, &header, sizeof(header));
+  for (i = 0; ret >= 0 && i < rec->ntopics; i++)
+    {
+      memset(&topic, 0, sizeof(topic));
+      strlcpy(topic.name, rec->topics[i].object.meta->o_name,
+              sizeof(topic.name));
+      topic.size     = rec->topics[i].object.meta->o_size;
+      topic.instance = rec->topics[i].object.instance;
+      ret = record_append(rec, &topic, sizeof(topic));
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: record_sample
+ *
+ * Description:
+ *   Copy the latest sample of one topic into the log.
+ *
+ ****************************************************************************/
+
+static int record_sample(FAR struct record_s *rec, int id,
+                         FAR uint8_t *data)
+{
+  FAR struct record_topic_s *topic = &rec->topics[id];
+  struct orb_log_sample_s sample;
+  orb_abstime now;
+  ssize_t len;
+  int ret;
+
+  len = orb_copy_multi(rec->fds[id].fd, data, topic->object.meta->o_size);
+  if (len < 0)
+    {
+      return errno == EAGAIN ? 0 : -errno;
+    }
+
+  now = orb_absolute_time();
+  sample.delta = MIN(now - rec->last, UINT32_MAX);
+  sample.id    = id;
+  sample.size  = len;
+  rec->last    = now;
+
+  ret = record_append(rec, &sample, sizeof(sample));
+  if (ret >= 0)
+    {
+      ret = record_append(rec, data, len);
+    }
+
+  if (ret >= 0)
+    {
+      topic->count++;
+      rec->nsamples++;
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: record_loop
+ *
+ * Description:
+ *   Record until interrupted or one of the limits is reached.
+ *
+ ****************************************************************************/
+
+static int record_loop(FAR struct record_s *rec, int timeout,
+                       unsigned long nb_msgs)
+{
+  FAR uint8_t *data;
+  orb_abstime start = rec->last;
+  int ret = 0;
+  int i;
+
+  data = malloc(RECORD_MAX_SAMPLE);
+  if (data == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  while (!g_should_exit && (!nb_msgs || rec->nsamples < nb_msgs))
+    {
+      if (timeout && orb_elapsed_time(&start) >= timeout * 1000000ull)
+        {
+          break;
+        }
+
+      ret = poll(rec->fds, rec->ntopics, RECORD_POLL_TIME);
+      if (ret < 0 && errno != EINTR)
+        {
+          ret = -errno;
+          break;
+        }
+      else if (ret <= 0)
+        {
+          ret = 0;
+          continue;
+        }
+
+      ret = 0;
+      for (i = 0; i < rec->ntopics && ret >= 0; i++)
+        {
+          if (rec->fds[i].revents & POLLIN)
+            {
+              ret = record_sample(rec, i, data);
+            }
+        }
+
+      if (ret < 0)
+        {
+          break;
+        }
+    }
+
+  free(data);
+  return ret;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct record_s rec;
+  unsigned long nb_msgs = 0;
+  int topic_rate    = 0;
+  int topic_latency = 0;
+  int timeout       = 0;
+  FAR char *filter  = NULL;
+  FAR char *path;
+  orb_abstime elapsed;
+  orb_abstime start;
+  int ret;
+  int ch;
+  int i;
+
+  g_should_exit = false;
+  if (signal(SIGINT, exit_handler) == SIG_ERR)
+    {
+      return 1;
+    }
+
+  while ((ch = getopt(argc, argv, "r:b:t:n:h")) != EOF)
+    {
+      switch (ch)
+        {
+          case 'r':
+            topic_rate = strtol(optarg, NULL, 0);
+            if (topic_rate < 0)
+              {
+                goto error;
+              }
+            break;
+
+          case 'b':
+            topic_latency = strtol(optarg, NULL, 0);
+            if (topic_latency < 0)
+              {
+                goto error;
+              }
+            break;
+
+          case 't':
+            timeout = strtol(optarg, NULL, 0);
+            if (timeout < 0)
+              {
+                goto error;
+              }
+            break;
+
+          case 'n':
+            nb_msgs = strtoul(optarg, NULL, 0);
+            break;
+
+          case 'h':
+          default:
+            goto error;
+        }
+    }
+
+  if (optind >= argc)
+    {
+      goto error;
+    }
+
+  path = argv[optind++];
+  if (optind < argc)
+    {
+      filter = argv[optind];
+    }
+
+  memset(&rec, 0, sizeof(rec));
+  rec.fd = -1;
+
+  ret = record_select(&rec, filter);
+  if (ret <= 0)
+    {
+      uorbinfo_raw("No topics to record: %d", ret);
+      goto errout;
+    }
+
+  for (i = 0; i < rec.ntopics; i++)
+    {
+      if (rec.topics[i].object.meta->o_size > RECORD_MAX_SAMPLE)
+        {
+          uorbinfo_raw("Topic %s is too large: %u",
+                       rec.topics[i].object.meta->o_name,
+                       rec.topics[i].object.meta->o_size);
+          ret = -EFBIG;
+          goto errout;
+        }
+    }
+
+  rec.fds = calloc(rec.ntopics, sizeof(struct pollfd));
+  rec.buf = memalign(RECORD_ALIGN, CONFIG_UORB_RECORDER_BUFSIZE);
+  if (rec.fds == NULL || rec.buf == NULL)
+    {
+      ret = -ENOMEM;
+      goto errout;
+    }
+
+  for (i = 0; i < rec.ntopics; i++)
+    {
+      rec.fds[i].fd = -1;
+    }
+
+  rec.fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+  if (rec.fd < 0)
+    {
+      ret = -errno;
+      uorbinfo_raw("Failed to open %s: %d", path, ret);
+      goto errout;
+    }
+
+  for (i = 0; i < rec.ntopics; i++)
+    {
+      FAR struct orb_object *object = &rec.topics[i].object;
+
+      rec.fds[i].fd = orb_subscribe_multi(object->meta, object->instance);
+      if (rec.fds[i].fd < 0)
+        {
+          ret = -errno;
+          uorbinfo_raw("Failed to subscribe %s%d: %d",
+                       object->meta->o_name, object->instance, ret);
+          goto errout;
+        }
+
+      rec.fds[i].events = POLLIN;
+      if (topic_rate != 0)
+        {
+          orb_set_frequency(rec.fds[i].fd, topic_rate);
+        }
+
+      if (topic_latency != 0)
+        {
+          orb_set_batch_interval(rec.fds[i].fd, topic_latency);
+        }
+
+      uorbinfo_raw("Recording %s%d", object->meta->o_name,
+                   object->instance);
+    }
+
+  start = orb_absolute_time();
+  rec.last = start;
+  ret = record_header(&rec);
+  if (ret >= 0)
+    {
+      ret = record_loop(&rec, timeout, nb_msgs);
+    }
+
+  if (rec.len > 0)
+    {
+      int err = record_flush(&rec);
+      ret = ret < 0 ? ret : err;
+    }
+
+  fsync(rec.fd);
+  elapsed = orb_elapsed_time(&start);
+
+  for (i = 0; i < rec.ntopics; i++)
+    {
+      uorbinfo_raw("Object name:%s%d, recorded:%lu",
+                   rec.topics[i].object.meta->o_name,
+                   rec.topics[i].object.instance, rec.topics[i].count);
+    }
+
+  uorbinfo_raw("Recorded %lu samples, %" PRIu64 " bytes in %" PRIu64
+               " ms, %lu writes, longest write %" PRIu64 " us",
+               rec.nsamples, rec.written, (uint64_t)(elapsed / 1000),
+               rec.nwrites, (uint64_t)rec.maxwrite);
+
+  if (ret < 0)
+    {
+      uorbinfo_raw("Recording failed: %d", ret);
+    }
+
+errout:
+  if (rec.fds != NULL)
+    {
+      for (i = 0; i < rec.ntopics; i++)
+        {
+          if (rec.fds[i].fd >= 0)
+            {
+              if (topic_latency != 0)
+                {
+                  orb_set_batch_interval(rec.fds[i].fd, 0);
+                }
+
+              orb_unsubscribe(rec.fds[i].fd);
+            }
+        }
+    }
+
+  if (rec.fd >= 0)
+    {
+      close(rec.fd);
+    }
+
+  free(rec.buf);
+  free(rec.fds);
+  free(rec.topics);
+  return ret < 0 ? 1 : 0;
+
+error:
+  usage();
+  return 1;
+}
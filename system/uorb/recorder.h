@@ -0,0 +1,75 @@
+/****************************************************************************
+ * apps/system/uorb/recorder.h
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+#ifndef __APP_SYSTEM_UORB_RECORDER_H
+#define __APP_SYSTEM_UORB_RECORDER_H
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <stdint.h>
+
+#include <uORB/uORB.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* A log is one orb_log_header_s, then ntopics orb_log_topic_s, then a
+ * stream of samples.  Each sample is an orb_log_sample_s immediately
+ * followed by size bytes of topic data.  Nothing is padded and every
+ * field is in host byte order, so logs are meant to be replayed on the
+ * target that recorded them.
+ */
+
+#define ORB_LOG_MAGIC       "uORBLOG"
+#define ORB_LOG_VERSION     1
+#define ORB_LOG_NAME_MAX    32
+
+/****************************************************************************
+ * Public Types
+ ****************************************************************************/
+
+struct orb_log_header_s
+{
+  char        magic[8];               /* ORB_LOG_MAGIC */
+  uint16_t    version;                /* ORB_LOG_VERSION */
+  uint16_t    ntopics;                /* Number of topic records */
+  uint32_t    reserved;
+  orb_abstime start;                  /* Time the recording started */
+};
+
+struct orb_log_topic_s
+{
+  char        name[ORB_LOG_NAME_MAX]; /* Topic name, without instance */
+  uint16_t    size;                   /* Topic size, i.e. o_size */
+  uint8_t     instance;               /* Recorded instance */
+  uint8_t     reserved;
+};
+
+struct orb_log_sample_s
+{
+  uint32_t    delta;                  /* Microseconds since last sample */
+  uint16_t    id;                     /* Index of the topic record */
+  uint16_t    size;                   /* Bytes of data that follow */
+};
+
+#endif /* __APP_SYSTEM_UORB_RECORDER_H */
@@ -0,0 +1,363 @@
+/****************************************************************************
+ * apps/system/uorb/replayer.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <errno.h>
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "recorder.h"
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+struct replay_topic_s
+{
+  FAR const struct orb_metadata *meta; /* NULL if the topic is skipped */
+  int               fd;           /* Advertiser handle */
+  int               instance;     /* Published instance */
+  unsigned long     count;        /* Samples published */
+};
+
+struct replay_s
+{
+  FAR FILE         *stream;
+  FAR struct replay_topic_s *topics;
+  int               ntopics;
+  long              data;         /* File offset of the first sample */
+  unsigned int      speed;        /* Replay speed in percent, 0 = max */
+  unsigned long     nsamples;     /* Samples published */
+  unsigned long     nlate;        /* Samples published behind schedule */
+  orb_abstime       maxlate;      /* Worst lateness in microseconds */
+};
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+static bool g_should_exit = false;
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void usage(void)
+{
+  uorbinfo_raw("\n\
+Publish the samples of a uorb_record log again, with their original\n\
+timing.\n\
+\n\
+uorb_replay [arguments...] <file>\n\
+\t[-s <val>  ]     Replay speed in percent (as fast as possible if 0),\n\
+\t                 default: 100\n\
+\t[-l <val>  ]     Number of times to play the log (forever if 0),\n\
+\t                 default: 1\n\
+\t[-q <val>  ]     Queue size of the advertised topics, default: 1\n\
+\t[-h        ]     Replayer commands help\n\
+  ");
+}
+
+static void exit_handler(int signo)
+{
+  g_should_exit = true;
+}
+
+/****************************************************************************
+ * Name: replay_open
+ *
+ * Description:
+ *   Check the log header and advertise every recorded topic.  Topics that
+ *   are unknown here, or whose size has changed since the recording, are
+ *   skipped.
+ *
+ ****************************************************************************/
+
+static int replay_open(FAR struct replay_s *rep, unsigned int queue)
+{
+  struct orb_log_header_s header;
+  struct orb_log_topic_s topic;
+  FAR struct replay_topic_s *tmp;
+  int i;
+
+  if (fread(&header, sizeof(header), 1, rep->stream) != 1 ||
+      memcmp(header.magic, ORB_LOG_MAGIC, sizeof(ORB_LOG_MAGIC)) != 0)
+    {
+      uorbinfo_raw("Not a uORB log");
+      return -EINVAL;
+    }
+
+  if (header.version != ORB_LOG_VERSION || header.ntopics == 0)
+    {
+      uorbinfo_raw("Unsupported log version %u, %u topics",
+                   header.version, header.ntopics);
+      return -EINVAL;
+    }
+
+  rep->topics = calloc(header.ntopics, sizeof(struct replay_topic_s));
+  if (rep->topics == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  for (i = 0; i < header.ntopics; i++)
+    {
+      tmp = &rep->topics[i];
+      tmp->fd = -1;
+    }
+
+  rep->ntopics = header.ntopics;
+  for (i = 0; i < header.ntopics; i++)
+    {
+      tmp = &rep->topics[i];
+      if (fread(&topic, sizeof(topic), 1, rep->stream) != 1)
+        {
+          return -EINVAL;
+        }
+
+      topic.name[ORB_LOG_NAME_MAX - 1] = '\0';
+      tmp->meta = orb_get_meta(topic.name);
+      if (tmp->meta == NULL || tmp->meta->o_size != topic.size)
+        {
+          uorbinfo_raw("Skipping %s%u, %s", topic.name, topic.instance,
+                       tmp->meta ? "size mismatch" : "unknown topic");
+          tmp->meta = NULL;
+          continue;
+        }
+
+      tmp->instance = topic.instance;
+      tmp->fd = orb_advertise_multi_queue(tmp->meta, NULL, &tmp->instance,
+                                          queue);
+      if (tmp->fd < 0)
+        {
+          uorbinfo_raw("Failed to advertise %s%u: %d", topic.name,
+                       topic.instance, -errno);
+          tmp->meta = NULL;
+          continue;
+        }
+
+      uorbinfo_raw("Replaying %s%u as %s%d", topic.name, topic.instance,
+                   tmp->meta->o_name, tmp->instance);
+    }
+
+  rep->data = ftell(rep->stream);
+  return rep->data < 0 ? -errno : 0;
+}
+
+/****************************************************************************
+ * Name: replay_once
+ *
+ * Description:
+ *   Publish every sample of the log once.  Each sample is released at its
+ *   recorded offset from the start of the log, scaled by the replay speed,
+ *   so a slow publish does not push the rest of the log back.
+ *
+ ****************************************************************************/
+
+static int replay_once(FAR struct replay_s *rep, FAR uint8_t *data)
+{
+  FAR struct replay_topic_s *topic;
+  struct orb_log_sample_s sample;
+  orb_abstime start;
+  orb_abstime now;
+  uint64_t offset = 0;
+  uint64_t due;
+
+  if (fseek(rep->stream, rep->data, SEEK_SET) < 0)
+    {
+      return -errno;
+    }
+
+  start = orb_absolute_time();
+  while (!g_should_exit &&
+         fread(&sample, sizeof(sample), 1, rep->stream) == 1)
+    {
+      if (sample.id >= rep->ntopics || (sample.size > 0 &&
+          fread(data, sample.size, 1, rep->stream) != 1))
+        {
+          uorbinfo_raw("Truncated or corrupt log");
+          return -EINVAL;
+        }
+
+      offset += sample.delta;
+      topic = &rep->topics[sample.id];
+      if (topic->meta == NULL || sample.size != topic->meta->o_size)
+        {
+          continue;
+        }
+
+      if (rep->speed != 0)
+        {
+          due = offset * 100 / rep->speed;
+          now = orb_elapsed_time(&start);
+          if (due > now)
+            {
+              usleep(due - now);
+            }
+          else if (now - due > rep->maxlate)
+            {
+              rep->maxlate = now - due;
+            }
+
+          if (now > due)
+            {
+              rep->nlate++;
+            }
+        }
+
+      if (orb_publish_multi(topic->fd, data, sample.size) < 0)
+        {
+          return -errno;
+        }
+
+      topic->count++;
+      rep->nsamples++;
+    }
+
+  return ferror(rep->stream) ? -EIO : 0;
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  struct replay_s rep;
+  FAR uint8_t *data = NULL;
+  unsigned int queue = 1;
+  int loops = 1;
+  int loop;
+  int ret;
+  int ch;
+  int i;
+
+  memset(&rep, 0, sizeof(rep));
+  rep.speed = 100;
+
+  g_should_exit = false;
+  if (signal(SIGINT, exit_handler) == SIG_ERR)
+    {
+      return 1;
+    }
+
+  while ((ch = getopt(argc, argv, "s:l:q:h")) != EOF)
+    {
+      switch (ch)
+        {
+          case 's':
+            rep.speed = strtoul(optarg, NULL, 0);
+            break;
+
+          case 'l':
+            loops = strtol(optarg, NULL, 0);
+            if (loops < 0)
+              {
+                goto error;
+              }
+            break;
+
+          case 'q':
+            queue = strtoul(optarg, NULL, 0);
+            if (queue == 0)
+              {
+                goto error;
+              }
+            break;
+
+          case 'h':
+          default:
+            goto error;
+        }
+    }
+
+  if (optind >= argc)
+    {
+      goto error;
+    }
+
+  rep.stream = fopen(argv[optind], "rb");
+  if (rep.stream == NULL)
+    {
+      uorbinfo_raw("Failed to open %s: %d", argv[optind], -errno);
+      return 1;
+    }
+
+  setvbuf(rep.stream, NULL, _IOFBF, CONFIG_UORB_RECORDER_BUFSIZE);
+
+  /* Recorded samples are never larger than UINT16_MAX */
+
+  data = malloc(UINT16_MAX);
+  if (data == NULL)
+    {
+      ret = -ENOMEM;
+      goto errout;
+    }
+
+  ret = replay_open(&rep, queue);
+  for (loop = 0; ret >= 0 && !g_should_exit && (!loops || loop < loops);
+       loop++)
+    {
+      ret = replay_once(&rep, data);
+    }
+
+  for (i = 0; i < rep.ntopics; i++)
+    {
+      if (rep.topics[i].meta != NULL)
+        {
+          uorbinfo_raw("Object name:%s%d, published:%lu",
+                       rep.topics[i].meta->o_name, rep.topics[i].instance,
+                       rep.topics[i].count);
+        }
+    }
+
+  uorbinfo_raw("Published %lu samples, %lu late, worst %" PRIu64 " us",
+               rep.nsamples, rep.nlate, (uint64_t)rep.maxlate);
+
+errout:
+  if (rep.topics != NULL)
+    {
+      for (i = 0; i < rep.ntopics; i++)
+        {
+          if (rep.topics[i].fd >= 0)
+            {
+              orb_unadvertise(rep.topics[i].fd);
+            }
+        }
+    }
+
+  fclose(rep.stream);
+  free(rep.topics);
+  free(data);
+  return ret < 0 ? 1 : 0;
+
+error:
+  usage();
+  return 1;
+}
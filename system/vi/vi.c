@@ -106,6 +106,7 @@
 #define TEXT_GULP_SIZE  512  /* Text buffer allocations are managed with this unit */
 #define TEXT_GULP_MASK  511  /* Mask for aligning buffer allocation sizes */
 #define ALIGN_GULP(x)   (((x) + TEXT_GULP_MASK) & ~TEXT_GULP_MASK)
+#define LINE_GULP_SIZE  64   /* Initial number of entries in the line index */
 
 #define VI_TABSIZE      8    /* A TAB is eight characters */
 #define TABMASK         7    /* Mask for TAB alignment */
@@ -337,6 +338,13 @@ struct vi_s
 
   FAR char *text;           /* Dynamically allocated text buffer */
   size_t txtalloc;          /* Current allocated size of the text buffer */
+  off_t gappos;             /* Offset of the gap in the text buffer */
+  size_t gapsize;           /* Size of the gap in the text buffer */
+  size_t unindexed;         /* Bytes before the gap not in the line index */
+  FAR off_t *lines;         /* Line start index, split at the gap */
+  size_t nlines;            /* Number of lines in the index */
+  size_t linefront;         /* Number of lines starting before the gap */
+  size_t linealloc;         /* Allocated number of line index entries */
   FAR char *yank;           /* Dynamically allocated yank buffer */
   size_t yankalloc;         /* Current allocated size of the yank buffer */
   size_t yanksize;          /* Current size of the text in the yank buffer */
@@ -393,6 +401,25 @@ static void     vi_clrscreen(FAR struct vi_s *vi);
 static void     vi_printf(FAR struct vi_s *vi, FAR const char *prefix,
                   FAR const char *fmt, ...) printf_like(3, 4);
 
+/* Text access */
+
+static char     vi_charat(FAR struct vi_s *vi, off_t pos);
+static size_t   vi_textspan(FAR struct vi_s *vi, off_t pos, FAR char **ptr);
+static void     vi_copytext(FAR struct vi_s *vi, FAR char *dest, off_t pos,
+                  size_t size);
+static void     vi_writetext(FAR struct vi_s *vi, off_t pos, size_t size);
+static bool     vi_matchtext(FAR struct vi_s *vi, off_t pos,
+                  FAR const char *str, size_t len);
+static void     vi_setchar(FAR struct vi_s *vi, off_t pos, char ch);
+
+/* Line index */
+
+static off_t    vi_linestart(FAR struct vi_s *vi, size_t line);
+static void     vi_dropindex(FAR struct vi_s *vi);
+static void     vi_addline(FAR struct vi_s *vi, off_t start);
+static void     vi_indexlines(FAR struct vi_s *vi);
+static size_t   vi_findline(FAR struct vi_s *vi, off_t pos);
+
 /* Line positioning */
 
 static off_t    vi_linebegin(FAR struct vi_s *vi, off_t pos);
@@ -402,6 +429,8 @@ static off_t    vi_nextline(FAR struct vi_s *vi, off_t pos);
 
 /* Text buffer management */
 
+static void     vi_movegap(FAR struct vi_s *vi, off_t pos);
+static bool     vi_reservetext(FAR struct vi_s *vi, size_t increment);
 static bool     vi_extendtext(FAR struct vi_s *vi, off_t pos,
                   size_t increment);
 static void     vi_shrinkpos(FAR struct vi_s *vi, off_t delpos,
@@ -913,6 +942,335 @@ static void vi_printf(FAR struct vi_s *vi, FAR const char *prefix,
   VI_BEL(vi);
 }
 
+/****************************************************************************
+ * Text access
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: vi_charat
+ *
+ * Description:
+ *   Return the character at a logical position in the text buffer, or
+ *   '\0' if the position lies outside of the text.
+ *
+ ****************************************************************************/
+
+static char vi_charat(FAR struct vi_s *vi, off_t pos)
+{
+  if (pos < 0 || pos >= vi->textsize)
+    {
+      return '\0';
+    }
+
+  if (pos >= vi->gappos)
+    {
+      pos += vi->gapsize;
+    }
+
+  return vi->text[pos];
+}
+
+/****************************************************************************
+ * Name: vi_textspan
+ *
+ * Description:
+ *   Return the number of bytes that are contiguous in memory starting at
+ *   the logical position 'pos' and a pointer to the first of them in
+ *   'ptr'.  Zero is returned at the end of the text.
+ *
+ ****************************************************************************/
+
+static size_t vi_textspan(FAR struct vi_s *vi, off_t pos, FAR char **ptr)
+{
+  if (pos < 0 || pos >= vi->textsize)
+    {
+      return 0;
+    }
+
+  if (pos < vi->gappos)
+    {
+      *ptr = &vi->text[pos];
+      return vi->gappos - pos;
+    }
+
+  *ptr = &vi->text[pos + vi->gapsize];
+  return vi->textsize - pos;
+}
+
+/****************************************************************************
+ * Name: vi_copytext
+ *
+ * Description:
+ *   Copy 'size' bytes of text beginning at 'pos' into 'dest'.
+ *
+ ****************************************************************************/
+
+static void vi_copytext(FAR struct vi_s *vi, FAR char *dest, off_t pos,
+                        size_t size)
+{
+  FAR char *ptr;
+  size_t span;
+
+  while (size > 0 && (span = vi_textspan(vi, pos, &ptr)) > 0)
+    {
+      if (span > size)
+        {
+          span = size;
+        }
+
+      memcpy(dest, ptr, span);
+      dest += span;
+      pos  += span;
+      size -= span;
+    }
+}
+
+/****************************************************************************
+ * Name: vi_writetext
+ *
+ * Description:
+ *   Write 'size' bytes of text beginning at 'pos' to the display.
+ *
+ ****************************************************************************/
+
+static void vi_writetext(FAR struct vi_s *vi, off_t pos, size_t size)
+{
+  FAR char *ptr;
+  size_t span;
+
+  while (size > 0 && (span = vi_textspan(vi, pos, &ptr)) > 0)
+    {
+      if (span > size)
+        {
+          span = size;
+        }
+
+      vi_write(vi, ptr, span);
+      pos  += span;
+      size -= span;
+    }
+}
+
+/****************************************************************************
+ * Name: vi_matchtext
+ *
+ * Description:
+ *   Return true if the 'len' characters of 'str' appear in the text at
+ *   position 'pos'.
+ *
+ ****************************************************************************/
+
+static bool vi_matchtext(FAR struct vi_s *vi, off_t pos,
+                         FAR const char *str, size_t len)
+{
+  if (pos < 0 || pos + len > vi->textsize)
+    {
+      return false;
+    }
+
+  while (len-- > 0)
+    {
+      if (vi_charat(vi, pos++) != *str++)
+        {
+          return false;
+        }
+    }
+
+  return true;
+}
+
+/****************************************************************************
+ * Name: vi_setchar
+ *
+ * Description:
+ *   Overwrite the character at position 'pos', keeping the line index
+ *   up to date if a newline is created or removed.
+ *
+ ****************************************************************************/
+
+static void vi_setchar(FAR struct vi_s *vi, off_t pos, char ch)
+{
+  char prev = vi_charat(vi, pos);
+
+  if (pos < 0 || pos >= vi->textsize)
+    {
+      return;
+    }
+
+  if ((prev == '\n') != (ch == '\n') && vi->lines != NULL)
+    {
+      /* The line starting just after 'pos' appears or disappears.  With
+       * the gap moved behind it, that line is the last one before the gap.
+       */
+
+      vi_movegap(vi, pos + 1);
+      if (prev == '\n')
+        {
+          vi->linefront--;
+          vi->nlines--;
+        }
+      else
+        {
+          vi_addline(vi, pos + 1);
+        }
+    }
+
+  if (pos >= vi->gappos)
+    {
+      pos += vi->gapsize;
+    }
+
+  vi->text[pos] = ch;
+  vi->modified  = true;
+}
+
+/****************************************************************************
+ * Line index
+ *
+ * The start offset of every line is kept in vi->lines[], which is split at
+ * the gap in the same way as the text.  The first vi->linefront entries
+ * hold the absolute offsets of the lines that start at or before the gap.
+ * The remaining entries are kept at the end of the array and hold their
+ * distance from the end of the text, so that inserting or deleting at the
+ * gap does not change them.  Lines are numbered from zero and line zero
+ * always starts at offset zero.  If the index cannot be allocated it is
+ * dropped and the line positioning falls back to scanning the text.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: vi_linestart
+ *
+ * Description:
+ *   Return the start offset of line 'line'.
+ *
+ ****************************************************************************/
+
+static off_t vi_linestart(FAR struct vi_s *vi, size_t line)
+{
+  if (line < vi->linefront)
+    {
+      return vi->lines[line];
+    }
+
+  return vi->textsize - vi->lines[vi->linealloc - vi->nlines + line];
+}
+
+/****************************************************************************
+ * Name: vi_dropindex
+ *
+ * Description:
+ *   Discard the line index.
+ *
+ ****************************************************************************/
+
+static void vi_dropindex(FAR struct vi_s *vi)
+{
+  free(vi->lines);
+  vi->lines     = NULL;
+  vi->nlines    = 0;
+  vi->linefront = 0;
+  vi->linealloc = 0;
+}
+
+/****************************************************************************
+ * Name: vi_addline
+ *
+ * Description:
+ *   Record a line starting at 'start', which must lie after every line
+ *   already held before the gap.
+ *
+ ****************************************************************************/
+
+static void vi_addline(FAR struct vi_s *vi, off_t start)
+{
+  FAR off_t *alloc;
+  size_t nback;
+  size_t allocsize;
+
+  if (vi->nlines >= vi->linealloc)
+    {
+      allocsize = vi->linealloc ? 2 * vi->linealloc : LINE_GULP_SIZE;
+      alloc     = realloc(vi->lines, allocsize * sizeof(off_t));
+      if (alloc == NULL)
+        {
+          vi_dropindex(vi);
+          return;
+        }
+
+      /* Keep the lines after the gap at the end of the array */
+
+      nback = vi->nlines - vi->linefront;
+      memmove(&alloc[allocsize - nback], &alloc[vi->linealloc - nback],
+              nback * sizeof(off_t));
+
+      vi->lines     = alloc;
+      vi->linealloc = allocsize;
+    }
+
+  vi->lines[vi->linefront++] = start;
+  vi->nlines++;
+}
+
+/****************************************************************************
+ * Name: vi_indexlines
+ *
+ * Description:
+ *   Add the lines of newly inserted text to the index.  vi_extendtext()
+ *   leaves the inserted bytes just before the gap for the caller to fill
+ *   in, so they are scanned the next time the index is needed.
+ *
+ ****************************************************************************/
+
+static void vi_indexlines(FAR struct vi_s *vi)
+{
+  off_t pos;
+
+  for (pos = vi->gappos - vi->unindexed;
+       pos < vi->gappos && vi->lines != NULL; pos++)
+    {
+      if (vi->text[pos] == '\n')
+        {
+          vi_addline(vi, pos + 1);
+        }
+    }
+
+  vi->unindexed = 0;
+}
+
+/****************************************************************************
+ * Name: vi_findline
+ *
+ * Description:
+ *   Return the number of the line containing position 'pos'.  The line
+ *   index must be present and up to date.
+ *
+ ****************************************************************************/
+
+static size_t vi_findline(FAR struct vi_s *vi, off_t pos)
+{
+  size_t low  = 0;
+  size_t high = vi->nlines;
+  size_t mid;
+
+  /* Find the last line that starts at or before 'pos' */
+
+  while (high - low > 1)
+    {
+      mid = (low + high) / 2;
+      if (vi_linestart(vi, mid) <= pos)
+        {
+          low = mid;
+        }
+      else
+        {
+          high = mid;
+        }
+    }
+
+  return low;
+}
+
 /****************************************************************************
  * Line positioning
  ****************************************************************************/
@@ -927,13 +1285,21 @@ static void vi_printf(FAR struct vi_s *vi, FAR const char *prefix,
 
 static off_t vi_linebegin(FAR struct vi_s *vi, off_t pos)
 {
-  /* Search backward to find the previous newline character (or, possibly,
-   * the beginning of the text buffer).
-   */
-
-  while (pos && vi->text[pos - 1] != '\n')
+  vi_indexlines(vi);
+  if (vi->lines != NULL)
     {
-      pos--;
+      pos = pos > 0 ? vi_linestart(vi, vi_findline(vi, pos)) : 0;
+    }
+  else
+    {
+      /* Search backward to find the previous newline character (or,
+       * possibly, the beginning of the text buffer).
+       */
+
+      while (pos > 0 && vi_charat(vi, pos - 1) != '\n')
+        {
+          pos--;
+        }
     }
 
   viinfo("Return pos=%ld\n", (long)pos);
@@ -977,18 +1343,37 @@ static off_t vi_prevline(FAR struct vi_s *vi, off_t pos)
 
 static off_t vi_lineend(FAR struct vi_s *vi, off_t pos)
 {
-  /* Search forward to find the next newline character. (or, possibly,
-   * the end of the text buffer).
-   */
+  size_t line;
 
-  while (pos < vi->textsize && vi->text[pos] != '\n')
+  vi_indexlines(vi);
+  if (pos >= vi->textsize)
     {
-      pos++;
+      pos = vi->textsize;
     }
+  else if (vi->lines != NULL)
+    {
+      /* The next line starts just after the newline.  There is no newline
+       * if this is the last line.
+       */
 
-  if (vi->text[pos] == '\n')
+      line = vi_findline(vi, pos) + 1;
+      pos  = line < vi->nlines ? vi_linestart(vi, line) - 2 : vi->textsize;
+    }
+  else
     {
-      pos--;
+      /* Search forward to find the next newline character. (or, possibly,
+       * the end of the text buffer).
+       */
+
+      while (pos < vi->textsize && vi_charat(vi, pos) != '\n')
+        {
+          pos++;
+        }
+
+      if (vi_charat(vi, pos) == '\n')
+        {
+          pos--;
+        }
     }
 
   viinfo("Return pos=%ld\n", (long)pos);
@@ -1027,54 +1412,132 @@ static off_t vi_nextline(FAR struct vi_s *vi, off_t pos)
  ****************************************************************************/
 
 /****************************************************************************
- * Name: vi_extendtext
+ * Name: vi_movegap
  *
  * Description:
- *   Reallocate the in-memory file memory by (at least) 'increment' and make
- *   space for new text of size 'increment' at the specified cursor position.
+ *   Move the gap in the text buffer to the logical position 'pos'.  Only
+ *   the text between the old and the new gap position is moved, along with
+ *   the line index entries for that text.
  *
  ****************************************************************************/
 
-static bool vi_extendtext(FAR struct vi_s *vi, off_t pos, size_t increment)
+static void vi_movegap(FAR struct vi_s *vi, off_t pos)
 {
-  FAR char *alloc;
-  int i;
-
-  viinfo("pos=%ld increment=%ld\n", (long)pos, (long)increment);
+  vi_indexlines(vi);
 
-  /* Check if we need to reallocate */
-
-  if (!vi->text || vi->textsize + increment > vi->txtalloc)
+  if (pos < vi->gappos)
     {
-      /* Allocate in chunksize so that we do not have to reallocate so
-       * often.
-       */
+      memmove(&vi->text[pos + vi->gapsize], &vi->text[pos],
+              vi->gappos - pos);
 
-      size_t allocsize = ALIGN_GULP(vi->textsize + increment);
-      alloc = realloc(vi->text, allocsize);
-      if (alloc == NULL)
+      while (vi->lines != NULL && vi->linefront > 0 &&
+             vi->lines[vi->linefront - 1] > pos)
         {
-          /* Reallocation failed */
+          vi->linefront--;
+          vi->lines[vi->linealloc - vi->nlines + vi->linefront] =
+            vi->textsize - vi->lines[vi->linefront];
+        }
+    }
+  else if (pos > vi->gappos)
+    {
+      memmove(&vi->text[vi->gappos], &vi->text[vi->gappos + vi->gapsize],
+              pos - vi->gappos);
 
-          vi_error(vi, g_fmtallocfail);
-          return false;
+      while (vi->lines != NULL && vi->linefront < vi->nlines &&
+             vi_linestart(vi, vi->linefront) <= pos)
+        {
+          vi->lines[vi->linefront] = vi_linestart(vi, vi->linefront);
+          vi->linefront++;
         }
+    }
 
-      /* Save the new buffer information */
+  vi->gappos = pos;
+}
 
-      vi->text    = alloc;
-      vi->txtalloc = allocsize;
+/****************************************************************************
+ * Name: vi_reservetext
+ *
+ * Description:
+ *   Make sure that the gap can hold at least 'increment' more bytes,
+ *   reallocating the text buffer if necessary.
+ *
+ ****************************************************************************/
+
+static bool vi_reservetext(FAR struct vi_s *vi, size_t increment)
+{
+  FAR char *alloc;
+  size_t allocsize;
+  size_t tail;
+
+  if (vi->text != NULL && vi->gapsize >= increment)
+    {
+      return true;
     }
 
-  /* Move text to make space for new text of size 'increment' at the current
-   * cursor position
-   */
+  /* Allocate in chunksize so that we do not have to reallocate so often */
+
+  allocsize = ALIGN_GULP(vi->textsize + increment);
+  alloc     = realloc(vi->text, allocsize);
+  if (alloc == NULL)
+    {
+      /* Reallocation failed */
+
+      vi_error(vi, g_fmtallocfail);
+      return false;
+    }
+
+  /* Start the line index along with the text */
+
+  if (vi->text == NULL)
+    {
+      vi_addline(vi, 0);
+    }
+
+  /* Move the text after the gap to the end of the new buffer */
+
+  tail = vi->textsize - vi->gappos;
+  memmove(&alloc[allocsize - tail], &alloc[vi->gappos + vi->gapsize],
+          tail);
+
+  /* Save the new buffer information */
+
+  vi->text     = alloc;
+  vi->txtalloc = allocsize;
+  vi->gapsize  = allocsize - vi->textsize;
+  return true;
+}
+
+/****************************************************************************
+ * Name: vi_extendtext
+ *
+ * Description:
+ *   Reallocate the in-memory file memory by (at least) 'increment' and make
+ *   space for new text of size 'increment' at the specified cursor position.
+ *   The new space is contiguous at &vi->text[pos] and must be filled in by
+ *   the caller before the text buffer is used again.
+ *
+ ****************************************************************************/
+
+static bool vi_extendtext(FAR struct vi_s *vi, off_t pos, size_t increment)
+{
+  viinfo("pos=%ld increment=%ld\n", (long)pos, (long)increment);
+
+  /* Check if we need to reallocate */
 
-  for (i = vi->textsize - 1; i >= pos; i--)
+  if (!vi_reservetext(vi, increment))
     {
-      vi->text[i + increment] = vi->text[i];
+      return false;
     }
 
+  /* Open the gap at the requested position and take the space for new text
+   * of size 'increment' from its start.
+   */
+
+  vi_movegap(vi, pos);
+  vi->gappos    += increment;
+  vi->gapsize   -= increment;
+  vi->unindexed  = increment;
+
   /* Adjust end of file position */
 
   vi->textsize += increment;
@@ -1143,9 +1606,9 @@ static void vi_shrinkpos(FAR struct vi_s *vi, off_t delpos, size_t delsize,
  * Name: vi_shrinktext
  *
  * Description:
- *   Delete a region in the text buffer by copying the end of the text buffer
- *   over the deleted region and adjusting the size of the region.  The text
- *   region may be reallocated in order to recover the unused memory.
+ *   Delete a region in the text buffer by moving the gap to the end of the
+ *   region and growing it over the deleted text.  The text region may be
+ *   reallocated in order to recover the unused memory.
  *
  ****************************************************************************/
 
@@ -1153,27 +1616,42 @@ static void vi_shrinktext(FAR struct vi_s *vi, off_t pos, size_t size)
 {
   FAR char *alloc;
   size_t allocsize;
-  int i;
+  size_t tail;
 
   viinfo("pos=%ld size=%ld\n", (long)pos, (long)size);
 
-  /* Close up the gap to remove 'size' characters at 'pos' */
+  /* Ensure we are not shrinking more than we have */
 
-  for (i = pos + size; i < vi->textsize; i++)
+  if (pos < 0 || pos >= vi->textsize)
     {
-      vi->text[i - size] = vi->text[i];
+      size = 0;
+    }
+  else if (size > vi->textsize - pos)
+    {
+      size = vi->textsize - pos;
     }
 
-  /* Ensure we are not shrinking more than we have */
+  /* Close up the gap to remove 'size' characters at 'pos'.  The lines that
+   * started inside the deleted region are the last ones before the gap.
+   */
 
-  if (size > vi->textsize)
+  if (size > 0)
     {
-      size = vi->textsize;
+      vi_movegap(vi, pos + size);
+      while (vi->lines != NULL && vi->linefront > 0 &&
+             vi->lines[vi->linefront - 1] > pos)
+        {
+          vi->linefront--;
+          vi->nlines--;
+        }
+
+      vi->gappos    = pos;
+      vi->gapsize  += size;
+      vi->textsize -= size;
     }
 
   /* Adjust sizes and positions */
 
-  vi->textsize -= size;
   vi->modified  = true;
   vi_shrinkpos(vi, pos, size, &vi->curpos);
   vi_shrinkpos(vi, pos, size, &vi->winpos);
@@ -1189,6 +1667,16 @@ static void vi_shrinktext(FAR struct vi_s *vi, off_t pos, size_t size)
 
   if (allocsize < vi->txtalloc)
     {
+      /* Move the text after the gap down to the end of the smaller
+       * buffer first.
+       */
+
+      tail = vi->textsize - vi->gappos;
+      memmove(&vi->text[allocsize - tail],
+              &vi->text[vi->gappos + vi->gapsize], tail);
+      vi->gapsize  = allocsize - vi->textsize;
+      vi->txtalloc = allocsize;
+
       alloc = realloc(vi->text, allocsize);
       if (!alloc)
         {
@@ -1198,8 +1686,7 @@ static void vi_shrinktext(FAR struct vi_s *vi, off_t pos, size_t size)
 
       /* Save the new buffer information */
 
-      vi->text    = alloc;
-      vi->txtalloc = allocsize;
+      vi->text = alloc;
     }
 }
 
@@ -1295,7 +1782,9 @@ static bool vi_savetext(FAR struct vi_s *vi, FAR const char *filename,
                         off_t pos, size_t size)
 {
   FAR FILE *stream;
+  FAR char *ptr;
   size_t nwritten;
+  size_t span;
   int len;
 
   viinfo("filename=\"%s\" pos=%ld size=%ld\n",
@@ -1314,7 +1803,23 @@ static bool vi_savetext(FAR struct vi_s *vi, FAR const char *filename,
    * through pos + size -1.
    */
 
-  nwritten = fwrite(vi->text + pos, 1, size, stream);
+  nwritten = 0;
+  while (nwritten < size &&
+         (span = vi_textspan(vi, pos + nwritten, &ptr)) > 0)
+    {
+      if (span > size - nwritten)
+        {
+          span = size - nwritten;
+        }
+
+      if (fwrite(ptr, 1, span, stream) < span)
+        {
+          break;
+        }
+
+      nwritten += span;
+    }
+
   if (nwritten < size)
     {
       /* Report the error (or partial write).  EINTR is not handled. */
@@ -1509,7 +2014,7 @@ static void vi_windowpos(FAR struct vi_s *vi, off_t start, off_t end,
     {
       /* Is there a newline terminator at this position? */
 
-      if (vi->text[pos] == '\n')
+      if (vi_charat(vi, pos) == '\n')
         {
           /* Yes... break out of the loop return the cursor column */
 
@@ -1525,7 +2030,7 @@ static void vi_windowpos(FAR struct vi_s *vi, off_t start, off_t end,
 
       /* No... Is there a TAB at this position? */
 
-      else if (vi->text[pos] == '\t')
+      else if (vi_charat(vi, pos) == '\t')
         {
           /* Yes.. expand the TAB */
 
@@ -1543,7 +2048,7 @@ static void vi_windowpos(FAR struct vi_s *vi, off_t start, off_t end,
   /* Keep cursor in bounds of text (i.e. not at the '\n') */
 
   if (((pos == vi->textsize && column != 0) ||
-       (vi->text[pos] == '\n' && pos != start)) &&
+       (vi_charat(vi, pos) == '\n' && pos != start)) &&
         vi->mode != MODE_INSERT && vi->mode != MODE_REPLACE)
     {
       pos--;
@@ -1865,20 +2370,20 @@ static void vi_showtext(FAR struct vi_s *vi)
                * last column is encountered.
                */
 
-              if (vi->text[pos] == '\n')
+              if (vi_charat(vi, pos) == '\n')
                 {
                   break;
                 }
 
               /* Perform TAB expansion */
 
-              else if (vi->text[pos] == '\t')
+              else if (vi_charat(vi, pos) == '\t')
                 {
                   /* Write collected characters */
 
                   if (writefrom != pos)
                     {
-                      vi_write(vi, &vi->text[writefrom], pos - writefrom);
+                      vi_writetext(vi, writefrom, pos - writefrom);
                     }
 
                   tabcol = NEXT_TAB(column);
@@ -1914,7 +2419,7 @@ static void vi_showtext(FAR struct vi_s *vi)
 
           if (writefrom != pos)
             {
-              vi_write(vi, &vi->text[writefrom], pos - writefrom);
+              vi_writetext(vi, writefrom, pos - writefrom);
             }
 
           vi_clrtoeol(vi);
@@ -1925,7 +2430,7 @@ static void vi_showtext(FAR struct vi_s *vi)
       pos = vi_nextline(vi, pos);
     }
 
-  if (pos == vi->textsize && vi->text[pos - 1] == '\n')
+  if (pos == vi->textsize && vi_charat(vi, pos - 1) == '\n')
     {
       vi_setcursor(vi, row, 0);
       vi_clrtoeol(vi);
@@ -2099,7 +2604,7 @@ static off_t vi_cursorleft(FAR struct vi_s *vi, off_t curpos, int ncolumns)
    */
 
   for (remaining = (ncolumns < 1 ? 1 : ncolumns);
-       curpos > 0 && remaining > 0 && vi->text[curpos - 1] != '\n';
+       curpos > 0 && remaining > 0 && vi_charat(vi, curpos - 1) != '\n';
        curpos--, remaining--)
     {
     }
@@ -2129,13 +2634,14 @@ static off_t vi_cursorright(FAR struct vi_s *vi, off_t curpos, int ncolumns)
    */
 
   for (remaining = (ncolumns < 1 ? 1 : ncolumns);
-       curpos < vi->textsize && remaining > 0 && vi->text[curpos] != '\n';
+       curpos < vi->textsize && remaining > 0 &&
+       vi_charat(vi, curpos) != '\n';
        curpos++, remaining--)
     {
     }
 
 #if 0
-  if (vi->text[curpos] == '\n' || (curpos == vi->textsize &&
+  if (vi_charat(vi, curpos) == '\n' || (curpos == vi->textsize &&
       vi->mode != MODE_INSERT && vi->mode != MODE_REPLACE))
     {
       curpos--;
@@ -2205,8 +2711,8 @@ static int vi_gotoscreenbottom(FAR struct vi_s *vi, int rows)
 static void vi_gotofirstnonwhite(FAR struct vi_s *vi)
 {
   vi->curpos = vi_linebegin(vi, vi->curpos);
-  while (vi->curpos <= vi->textsize && (vi->text[vi->curpos] == ' ' ||
-         vi->text[vi->curpos] == '\t'))
+  while (vi->curpos <= vi->textsize && (vi_charat(vi, vi->curpos) == ' ' ||
+         vi_charat(vi, vi->curpos) == '\t'))
     {
       vi->curpos++;
     }
@@ -2242,7 +2748,7 @@ static void vi_delforward(FAR struct vi_s *vi)
       /* If at end of file, just return */
 
       if (vi->curpos == vi->textsize ||
-          vi->text[vi->curpos] == '\n')
+          vi_charat(vi, vi->curpos) == '\n')
         {
           return;
         }
@@ -2296,8 +2802,8 @@ static void vi_delbackward(FAR struct vi_s *vi)
 
   /* Test if we are at beginning of line */
 
-  if (vi->curpos == 0 || vi->text[vi->curpos] == '\n' ||
-      vi->text[vi->curpos - 1] == '\n')
+  if (vi->curpos == 0 || vi_charat(vi, vi->curpos) == '\n' ||
+      vi_charat(vi, vi->curpos - 1) == '\n')
     {
       return;
     }
@@ -2323,7 +2829,7 @@ static void vi_delbackward(FAR struct vi_s *vi)
     {
       /* Test if \n' in the range.  Don't delete through \n */
 
-      if (vi->text[x] == '\n')
+      if (vi_charat(vi, x) == '\n')
         {
           start = x + 1;
           break;
@@ -2406,7 +2912,7 @@ static void vi_deltoeol(FAR struct vi_s *vi)
 
   /* If we are at the end of the line, then return */
 
-  if (vi->curpos == vi->textsize || vi->text[vi->curpos] == '\n')
+  if (vi->curpos == vi->textsize || vi_charat(vi, vi->curpos) == '\n')
     {
       return;
     }
@@ -2415,7 +2921,7 @@ static void vi_deltoeol(FAR struct vi_s *vi)
 
   start = vi->curpos;
   end   = vi_lineend(vi, vi->curpos);
-  if (end == vi->textsize || vi->text[end] == '\n')
+  if (end == vi->textsize || vi_charat(vi, end) == '\n')
     {
       end--;
     }
@@ -2423,7 +2929,7 @@ static void vi_deltoeol(FAR struct vi_s *vi)
   /* Yank and remove text from the buffer */
 
   vi_yanktext(vi, start, end, true, true);
-  if (start > 0 && start != vi->textsize && vi->text[start - 1] != '\n')
+  if (start > 0 && start != vi->textsize && vi_charat(vi, start - 1) != '\n')
     {
       vi->curpos = start - 1;
     }
@@ -2452,7 +2958,7 @@ static void vi_yanktext(FAR struct vi_s *vi, off_t start, off_t end,
 
   /* At end of file, in line yank mode, if there is no LF, we append one */
 
-  if (vi->text[end] != '\n' && !yankcharmode)
+  if (vi_charat(vi, end) != '\n' && !yankcharmode)
     {
       append_lf = 1;
     }
@@ -2505,7 +3011,7 @@ static void vi_yanktext(FAR struct vi_s *vi, off_t start, off_t end,
   /* Copy the block from the text buffer to the yank buffer */
 
   vi->yanksize = size;
-  memcpy(vi->yank, &vi->text[start], size);
+  vi_copytext(vi, vi->yank, start, size);
 
   /* Append \n if needed */
 
@@ -2567,7 +3073,7 @@ static void vi_yank(FAR struct vi_s *vi, bool del_after_yank)
 
   yank_end = end;
   if (del_after_yank && end == textsize - 1 && start != end &&
-      vi->text[end] == '\n')
+      vi_charat(vi, end) == '\n')
     {
       yank_end--;
       pos_increment = 1;
@@ -2578,8 +3084,8 @@ static void vi_yank(FAR struct vi_s *vi, bool del_after_yank)
   /* Test if deleting last line with empty line above it */
 
   if ((end > 0 && start == end && end == vi->textsize -1 &&
-      vi->text[end - 1] == '\n') || (start > 1 && end + 1 ==
-      vi->textsize && vi->text[start - 2] == '\n'))
+      vi_charat(vi, end - 1) == '\n') || (start > 1 && end + 1 ==
+      vi->textsize && vi_charat(vi, start - 2) == '\n'))
     {
       empty_last_line = true;
     }
@@ -2652,8 +3158,8 @@ static void vi_paste(FAR struct vi_s *vi, bool paste_before)
 
           /* Paste at next col to the right of cursor */
 
-          if (vi->text[vi->curpos] == '\n' || vi->curpos == vi->textsize ||
-              paste_before)
+          if (vi_charat(vi, vi->curpos) == '\n' ||
+              vi->curpos == vi->textsize || paste_before)
             {
               pos = vi->curpos;
             }
@@ -2673,7 +3179,8 @@ static void vi_paste(FAR struct vi_s *vi, bool paste_before)
               /* Advance the cursor */
 
               vi->curpos = vi->curpos + vi->yanksize;
-              if (vi->curpos > vi->textsize || vi->text[vi->curpos] == '\n')
+              if (vi->curpos > vi->textsize ||
+                  vi_charat(vi, vi->curpos) == '\n')
                 {
                   vi->curpos--;
                 }
@@ -2699,8 +3206,9 @@ static void vi_paste(FAR struct vi_s *vi, bool paste_before)
           /* Test if pasting at end of file */
 
           new_curpos = start;
-          if ((start >= vi->textsize && vi->text[vi->textsize - 1] != '\n')
-              || vi->curpos == vi->textsize)
+          if ((start >= vi->textsize &&
+               vi_charat(vi, vi->textsize - 1) != '\n') ||
+              vi->curpos == vi->textsize)
             {
               off_t textsize = vi->textsize;
               bool at_end = vi->curpos == vi->textsize;
@@ -2712,7 +3220,7 @@ static void vi_paste(FAR struct vi_s *vi, bool paste_before)
 
               /* Don't append the \n' in the yank buffer */
 
-              if (vi->text[textsize - 1] != '\n' || at_end)
+              if (vi_charat(vi, textsize - 1) != '\n' || at_end)
                 {
                   size--;
                 }
@@ -2777,19 +3285,19 @@ static void vi_join(FAR struct vi_s *vi)
 
   /* Ensure the line ends with '\n' */
 
-  if (vi->text[start + 1] != '\n')
+  if (vi_charat(vi, start + 1) != '\n')
     {
       return;
     }
 
   /* Convert the '\n' to a space */
 
-  vi->text[++start] = ' ';
+  vi_setchar(vi, ++start, ' ');
   end = start + 1;
 
   /* Skip all spaces and tabs on next line */
 
-  while ((vi->text[end] == ' ' || vi->text[end] == '\t') &&
+  while ((vi_charat(vi, end) == ' ' || vi_charat(vi, end) == '\t') &&
       end < vi->textsize)
     {
       end++;
@@ -2833,11 +3341,21 @@ static void vi_gotoline(FAR struct vi_s *vi)
 
       /* Got to the line == value */
 
-      for (line = vi->value, vi->curpos = 0;
-          --line > 0 && vi->curpos < vi->textsize;
-          )
+      vi_indexlines(vi);
+      if (vi->lines != NULL)
         {
-          vi->curpos = vi_nextline(vi, vi->curpos);
+          line = vi->value - 1;
+          vi->curpos = line < vi->nlines ? vi_linestart(vi, line) :
+                       vi->textsize;
+        }
+      else
+        {
+          for (line = vi->value, vi->curpos = 0;
+              --line > 0 && vi->curpos < vi->textsize;
+              )
+            {
+              vi->curpos = vi_nextline(vi, vi->curpos);
+            }
         }
     }
 
@@ -2913,14 +3431,14 @@ static off_t vi_findnextword(FAR struct vi_s *vi)
    * next "word" looks like.
    */
 
-  srch_type = vi_chartype(vi->text[vi->curpos]);
+  srch_type = vi_chartype(vi_charat(vi, vi->curpos));
   pos = vi->curpos + 1;
 
   for (; pos < vi->textsize; pos++)
     {
       /* Get type of the next character */
 
-      pos_type = vi_chartype(vi->text[pos]);
+      pos_type = vi_chartype(vi_charat(vi, pos));
 
       /* Skip CR and NL */
 
@@ -3015,13 +3533,14 @@ static void vi_gotonextword(FAR struct vi_s *vi)
       pos     = vi->curpos;
       crfound = false;
 
-      while ((vi->text[pos - 1] == ' ' || vi->text[pos - 1] == '\t' ||
-             vi->text[pos - 1] == '\n') && pos > start)
+      while ((vi_charat(vi, pos - 1) == ' ' ||
+              vi_charat(vi, pos - 1) == '\t' ||
+              vi_charat(vi, pos - 1) == '\n') && pos > start)
         {
           /* We rewind only if '\n' found before non-space */
 
           pos--;
-          if (vi->text[pos] == '\n')
+          if (vi_charat(vi, pos) == '\n')
             {
               crfound = true;
             }
@@ -3044,7 +3563,7 @@ static void vi_gotonextword(FAR struct vi_s *vi)
             {
               /* Test for '\n' */
 
-              if (vi->text[x] == '\n')
+              if (vi_charat(vi, x) == '\n')
                 {
                   /* Modify the yank / delete range */
 
@@ -3070,7 +3589,7 @@ static void vi_gotonextword(FAR struct vi_s *vi)
 
       /* Yank text if it isn't a single \n character */
 
-      if (!(start == end && vi->text[start] == '\n'))
+      if (!(start == end && vi_charat(vi, start) == '\n'))
         {
           vi_yanktext(vi, start, end, 1, vi->delarm | vi->chgarm);
         }
@@ -3136,9 +3655,9 @@ static off_t vi_findprevword(FAR struct vi_s *vi)
    * next "word" looks like.
    */
 
-  srch_type = vi_chartype(vi->text[vi->curpos]);
+  srch_type = vi_chartype(vi_charat(vi, vi->curpos));
   pos       = vi->curpos - 1;
-  pos_type  = vi_chartype(vi->text[pos]);
+  pos_type  = vi_chartype(vi_charat(vi, pos));
 
   /* Test if we are at the beginning of a word */
 
@@ -3148,7 +3667,7 @@ static off_t vi_findprevword(FAR struct vi_s *vi)
 
       while (pos > 0)
         {
-          pos_type = vi_chartype(vi->text[pos - 1]);
+          pos_type = vi_chartype(vi_charat(vi, pos - 1));
 
           if (pos_type != srch_type && pos_type != VI_CHAR_CRLF)
             {
@@ -3168,14 +3687,14 @@ static off_t vi_findprevword(FAR struct vi_s *vi)
        * non-space character.
        */
 
-      pos_type = vi_chartype(vi->text[--pos]);
+      pos_type = vi_chartype(vi_charat(vi, --pos));
     }
 
   /* If the previous char is space, then skip them */
 
   while ((pos_type == VI_CHAR_SPACE || pos_type == VI_CHAR_CRLF) && pos > 0)
     {
-      pos_type = vi_chartype(vi->text[--pos]);
+      pos_type = vi_chartype(vi_charat(vi, --pos));
     }
 
   if (pos == 0)
@@ -3185,8 +3704,8 @@ static off_t vi_findprevword(FAR struct vi_s *vi)
 
   /* Now find beginning of this new type */
 
-  srch_type = vi_chartype(vi->text[pos]);
-  while (pos > 0 && vi_chartype(vi->text[pos - 1]) == srch_type)
+  srch_type = vi_chartype(vi_charat(vi, pos));
+  while (pos > 0 && vi_chartype(vi_charat(vi, pos - 1)) == srch_type)
     {
       pos--;
     }
@@ -3242,19 +3761,19 @@ static void vi_bottom_line_debug(FAR struct vi_s *vi)
 
   while (pos < vi->textsize && column < vi->display.column)
     {
-      if (vi->text[pos] == '\n')
+      if (vi_charat(vi, pos) == '\n')
         {
           vi_putch(vi, '\\');
           vi_putch(vi, 'n');
         }
-      else if (vi->text[pos] == '\t')
+      else if (vi_charat(vi, pos) == '\t')
         {
           vi_putch(vi, '\\');
           vi_putch(vi, 'n');
         }
       else
         {
-          vi_putch(vi, vi->text[pos]);
+          vi_putch(vi, vi_charat(vi, pos));
         }
 
       pos++;
@@ -3578,8 +4097,8 @@ static void vi_cmd_mode(FAR struct vi_s *vi)
         case KEY_CMDMODE_RIGHT: /* Move the cursor right one character */
         case KEY_RIGHT:         /* Move the cursor right one character */
           {
-            if (vi->text[vi->curpos] != '\n' &&
-                vi->text[vi->curpos + 1] != '\n')
+            if (vi_charat(vi, vi->curpos) != '\n' &&
+                vi_charat(vi, vi->curpos + 1) != '\n')
               {
                 vi->curpos = vi_cursorright(vi, vi->curpos, vi->value);
                 if (vi->curpos >= vi->textsize)
@@ -3715,7 +4234,7 @@ static void vi_cmd_mode(FAR struct vi_s *vi)
 
                 /* If we moved to \n on the previous line, skip it */
 
-                if (vi->curpos > 0 && vi->text[vi->curpos] == '\n')
+                if (vi->curpos > 0 && vi_charat(vi, vi->curpos) == '\n')
                   {
                     vi->curpos--;
                   }
@@ -3967,13 +4486,14 @@ static void vi_cmd_mode(FAR struct vi_s *vi)
 #endif
             /* If we are at the end of the line, then delete backward */
 
-            if (vi->text[pos] == '\n')
+            if (vi_charat(vi, pos) == '\n')
               {
                 /* Nothing to do */
 
                 break;
               }
-            else if (pos + 1 != vi->textsize && vi->text[pos + 1] == '\n')
+            else if (pos + 1 != vi->textsize &&
+                     vi_charat(vi, pos + 1) == '\n')
               {
                 if (pos > 0)
                   {
@@ -4727,7 +5247,7 @@ static bool vi_findstring(FAR struct vi_s *vi)
     {
       /* Check for the matching sub-string */
 
-      if (strncmp(vi->text + pos, vi->scratch, len) == 0)
+      if (vi_matchtext(vi, pos, vi->scratch, len))
         {
           /* Found it... save the cursor position and
            * return success.
@@ -4746,7 +5266,7 @@ static bool vi_findstring(FAR struct vi_s *vi)
     {
       /* Check for the matching sub-string */
 
-      if (strncmp(vi->text + pos, vi->scratch, len) == 0)
+      if (vi_matchtext(vi, pos, vi->scratch, len))
         {
           vi_write(vi, g_fmtsrcbot, sizeof(g_fmtsrcbot));
 
@@ -4797,7 +5317,7 @@ static bool vi_revfindstring(FAR struct vi_s *vi)
     {
       /* Check for the matching sub-string */
 
-      if (strncmp(vi->text + pos, vi->scratch, len) == 0)
+      if (vi_matchtext(vi, pos, vi->scratch, len))
         {
           /* Found it... save the cursor position and
            * return success.
@@ -4816,7 +5336,7 @@ static bool vi_revfindstring(FAR struct vi_s *vi)
     {
       /* Check for the matching sub-string */
 
-      if (strncmp(vi->text + pos, vi->scratch, len) == 0)
+      if (vi_matchtext(vi, pos, vi->scratch, len))
         {
           vi_write(vi, g_fmtsrctop, sizeof(g_fmtsrctop));
 
@@ -5009,7 +5529,7 @@ static void vi_replacech(FAR struct vi_s *vi, char ch)
 
   /* Is there a newline at the current cursor position? */
 
-  if (vi->text[vi->curpos] == '\n')
+  if (vi_charat(vi, vi->curpos) == '\n')
     {
       /* Yes, then insert the new character before the newline */
 
@@ -5020,7 +5540,7 @@ static void vi_replacech(FAR struct vi_s *vi, char ch)
     {
       /* No, just replace the character and increment the cursor position */
 
-      vi->text[vi->curpos++] = ch;
+      vi_setchar(vi, vi->curpos++, ch);
       vi->redrawline = true;
     }
 }
@@ -5201,7 +5721,7 @@ static void vi_findinline_mode(FAR struct vi_s *vi)
   pos = vi->curpos + 1;
   count = vi->value > 0 ? vi->value : 1;
 
-  while (count > 0 && pos < vi->textsize - 1 && vi->text[pos] != '\n')
+  while (count > 0 && pos < vi->textsize - 1 && vi_charat(vi, pos) != '\n')
     {
       /* Increment to next character */
 
@@ -5209,7 +5729,7 @@ static void vi_findinline_mode(FAR struct vi_s *vi)
 
       /* Test if this character matches */
 
-      if (vi->text[pos] == ch)
+      if (vi_charat(vi, pos) == ch)
         {
           count--;
         }
@@ -5396,7 +5916,7 @@ static void vi_insert_mode(FAR struct vi_s *vi)
 
           if (vi->cursor.column + 1 < vi->display.column && ch != '\t' &&
               (vi->curpos + 1 == vi->textsize ||
-               vi->text[vi->curpos + 1] == '\n'))
+               vi_charat(vi, vi->curpos + 1) == '\n'))
             {
               vi_putch(vi, ch);
             }
@@ -5431,7 +5951,7 @@ static void vi_insert_mode(FAR struct vi_s *vi)
             {
               if (vi->curpos < vi->textsize)
                 {
-                  if (vi->text[vi->curpos] == '\n')
+                  if (vi_charat(vi, vi->curpos) == '\n')
                     {
                       vi->drawtoeos = true;
                     }
@@ -5451,7 +5971,7 @@ static void vi_insert_mode(FAR struct vi_s *vi)
 
                   if (vi->curpos > 0)
                     {
-                      if (vi->text[vi->curpos - 1] == '\n')
+                      if (vi_charat(vi, vi->curpos - 1) == '\n')
                         {
                           vi->drawtoeos = true;
                         }
@@ -5478,7 +5998,7 @@ static void vi_insert_mode(FAR struct vi_s *vi)
 
               /* Move cursor 1 space to the left when exiting insert mode */
 
-              if (vi->curpos > 0 && vi->text[vi->curpos - 1] != '\n')
+              if (vi->curpos > 0 && vi_charat(vi, vi->curpos - 1) != '\n')
                 {
                   --vi->curpos;
                 }
@@ -5642,6 +6162,11 @@ static void vi_release(FAR struct vi_s *vi)
           free(vi->text);
         }
 
+      if (vi->lines)
+        {
+          free(vi->lines);
+        }
+
       if (vi->yank)
         {
           free(vi->yank);
@@ -5836,9 +6361,7 @@ int main(int argc, FAR char *argv[])
 
   if (vi->text == NULL)
     {
-      vi_extendtext(vi, 0, TEXT_GULP_SIZE);
-      vi->textsize = 0;
-      vi->modified = 0;
+      vi_reservetext(vi, TEXT_GULP_SIZE);
     }
 
   if (optind != argc)
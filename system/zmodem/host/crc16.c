@@ -55,7 +55,7 @@
 
 #include <sys/types.h>
 #include <stdint.h>
-#include <crc16.h>
+#include <nuttx/crc16.h>
 
 /************************************************************************************************
  * Private Data
@@ -99,8 +99,6 @@ static uint16_t crc16_tab[256] =
   0x6e17,  0x7e36,  0x4e55,  0x5e74,  0x2e93,  0x3eb2,  0x0ed1,  0x1ef0
 };
 
-#define updcrc(cp, crc) (crc16_tab[((crc >> 8) & 255)] ^ (crc << 8) ^ cp)
-
 /************************************************************************************************
  * Public Functions
  ************************************************************************************************/
@@ -119,7 +117,7 @@ uint16_t crc16part(const uint8_t *src, size_t len, uint16_t crc16val)
 
   for (i = 0;  i < len;  i++)
     {
-      crc16val = crc16_tab[((crc16val >> 8) & 255)] ^ (crc16val << 8) ^ src[i];
+      crc16val = crc16_tab[((crc16val >> 8) ^ src[i]) & 0xff] ^ (crc16val << 8);
     }
 
   return crc16val;
@@ -0,0 +1,423 @@
+/****************************************************************************
+ * apps/system/zmodem/host/zmtest.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/* Host throughput test: sends a file from sz to rz within one process tree,
+ * optionally through a pair of relays that limit each direction to the
+ * character rate of a UART, and checks that the received file matches.
+ */
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <time.h>
+
+#include <system/zmodem.h>
+
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+#define ZMTEST_FILENAME  "zmtest.bin"
+#define ZMTEST_RELAYSIZE 16   /* Characters forwarded at a time */
+
+/****************************************************************************
+ * Private Functions
+ ****************************************************************************/
+
+static void show_usage(FAR const char *progname, int errcode)
+{
+  fprintf(stderr, "USAGE: %s [OPTIONS]\n", progname);
+  fprintf(stderr, "\nWhere OPTIONS include the following:\n");
+  fprintf(stderr, "\t-s <size>: Size of the test file.  Default: 262144\n");
+  fprintf(stderr,
+          "\t-b <baud>: Limit each direction to this UART rate (8N1).\n"
+          "\t           Default: 0 (no limit)\n");
+  fprintf(stderr,
+          "\t-p <path>: Folder to hold the test files.  Default: %s\n",
+          CONFIG_SYSTEM_ZMODEM_MOUNTPOINT);
+  fprintf(stderr, "\t-h: Show this text and exit\n");
+  exit(errcode);
+}
+
+static double zmtest_now(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/****************************************************************************
+ * Name: zmtest_mkfile
+ *
+ * Description:
+ *   Create a test file of pseudo-random data.  Random data makes about one
+ *   byte in forty need escaping, which is close to a compressed firmware
+ *   image.
+ *
+ ****************************************************************************/
+
+static int zmtest_mkfile(FAR const char *filename, size_t size)
+{
+  uint8_t buffer[4096];
+  uint32_t seed = 0x12345678;
+  size_t nbytes;
+  size_t i;
+  FAR FILE *stream;
+
+  stream = fopen(filename, "wb");
+  if (stream == NULL)
+    {
+      return -1;
+    }
+
+  while (size > 0)
+    {
+      nbytes = size < sizeof(buffer) ? size : sizeof(buffer);
+      for (i = 0; i < nbytes; i++)
+        {
+          seed      = seed * 1103515245 + 12345;
+          buffer[i] = seed >> 24;
+        }
+
+      fwrite(buffer, 1, nbytes, stream);
+      size -= nbytes;
+    }
+
+  return fclose(stream);
+}
+
+/****************************************************************************
+ * Name: zmtest_compare
+ *
+ * Description:
+ *   Return zero if the two files have the same contents.
+ *
+ ****************************************************************************/
+
+static int zmtest_compare(FAR const char *file1, FAR const char *file2)
+{
+  uint8_t buf1[4096];
+  uint8_t buf2[4096];
+  FAR FILE *stream1;
+  FAR FILE *stream2;
+  size_t n1;
+  size_t n2;
+  int ret = -1;
+
+  stream1 = fopen(file1, "rb");
+  stream2 = fopen(file2, "rb");
+  if (stream1 != NULL && stream2 != NULL)
+    {
+      do
+        {
+          n1 = fread(buf1, 1, sizeof(buf1), stream1);
+          n2 = fread(buf2, 1, sizeof(buf2), stream2);
+        }
+      while (n1 == n2 && n1 > 0 && memcmp(buf1, buf2, n1) == 0);
+
+      ret = (n1 == 0 && n2 == 0) ? 0 : -1;
+    }
+
+  if (stream1 != NULL)
+    {
+      fclose(stream1);
+    }
+
+  if (stream2 != NULL)
+    {
+      fclose(stream2);
+    }
+
+  return ret;
+}
+
+/****************************************************************************
+ * Name: zmtest_relay
+ *
+ * Description:
+ *   Forward characters from one descriptor to another no faster than a
+ *   UART running at 'baud' with ten bits per character would.
+ *
+ ****************************************************************************/
+
+static void zmtest_relay(int infd, int outfd, unsigned long baud)
+{
+  uint8_t buffer[ZMTEST_RELAYSIZE];
+  struct timespec next;
+  struct timespec now;
+  ssize_t nread;
+  long nsec;
+
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  while ((nread = read(infd, buffer, sizeof(buffer))) > 0)
+    {
+      /* The line is idle if nothing was sent for a while */
+
+      clock_gettime(CLOCK_MONOTONIC, &now);
+      if (now.tv_sec > next.tv_sec ||
+          (now.tv_sec == next.tv_sec && now.tv_nsec > next.tv_nsec))
+        {
+          next = now;
+        }
+
+      /* The characters arrive once the last one has been shifted out */
+
+      nsec          = (long)(nread * 10 * 1000000000ll / baud);
+      next.tv_nsec += nsec;
+      next.tv_sec  += next.tv_nsec / 1000000000;
+      next.tv_nsec %= 1000000000;
+      clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+      if (write(outfd, buffer, nread) != nread)
+        {
+          break;
+        }
+    }
+
+  exit(EXIT_SUCCESS);
+}
+
+/****************************************************************************
+ * Name: zmtest_receive
+ *
+ * Description:
+ *   Receive files into 'pathname' and exit.
+ *
+ ****************************************************************************/
+
+static void zmtest_receive(int fd, FAR const char *pathname)
+{
+  ZMRHANDLE handle;
+  int ret;
+
+  handle = zmr_initialize(fd);
+  if (handle == NULL)
+    {
+      fprintf(stderr, "ERROR: zmr_initialize failed\n");
+      exit(EXIT_FAILURE);
+    }
+
+  ret = zmr_receive(handle, pathname);
+  zmr_release(handle);
+  exit(ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+}
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+int main(int argc, FAR char *argv[])
+{
+  FAR const char *pathname = CONFIG_SYSTEM_ZMODEM_MOUNTPOINT;
+  ZMSHANDLE handle;
+  char srcname[256 + sizeof(ZMTEST_FILENAME)];
+  char srcdir[256];
+  char dstname[256];
+  unsigned long baud = 0;
+  size_t size = 256 * 1024;
+  pid_t pids[3];
+  int npids = 0;
+  int sndfds[2];
+  int rcvfds[2];
+  int rcvfd;
+  double start;
+  double elapsed;
+  int status;
+  int option;
+  int ret;
+  int i;
+
+  while ((option = getopt(argc, argv, ":b:hp:s:")) != ERROR)
+    {
+      switch (option)
+        {
+          case 'b':
+            baud = strtoul(optarg, NULL, 0);
+            break;
+
+          case 'h':
+            show_usage(argv[0], EXIT_SUCCESS);
+            break;
+
+          case 'p':
+            pathname = optarg;
+            break;
+
+          case 's':
+            size = strtoul(optarg, NULL, 0);
+            break;
+
+          case ':':
+            fprintf(stderr, "ERROR: Missing required argument\n");
+            show_usage(argv[0], EXIT_FAILURE);
+            break;
+
+          default:
+          case '?':
+            fprintf(stderr, "ERROR: Unrecognized option\n");
+            show_usage(argv[0], EXIT_FAILURE);
+            break;
+        }
+    }
+
+  /* The source file is kept in a sub-directory so that it is not
+   * overwritten by the received file.
+   */
+
+  snprintf(srcdir, sizeof(srcdir), "%s/zmtest.src", pathname);
+  snprintf(srcname, sizeof(srcname), "%s/" ZMTEST_FILENAME, srcdir);
+  snprintf(dstname, sizeof(dstname), "%s/" ZMTEST_FILENAME, pathname);
+
+  mkdir(srcdir, 0777);
+  unlink(dstname);
+  if (zmtest_mkfile(srcname, size) < 0)
+    {
+      fprintf(stderr, "ERROR: Failed to create %s\n", srcname);
+      return EXIT_FAILURE;
+    }
+
+  /* The sender and the receiver are connected directly, or through one
+   * relay for each direction.
+   */
+
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, sndfds) < 0 ||
+      socketpair(AF_UNIX, SOCK_STREAM, 0, rcvfds) < 0)
+    {
+      fprintf(stderr, "ERROR: socketpair failed\n");
+      return EXIT_FAILURE;
+    }
+
+  if (baud != 0)
+    {
+      if ((pids[npids++] = fork()) == 0)
+        {
+          zmtest_relay(sndfds[1], rcvfds[0], baud);
+        }
+
+      if ((pids[npids++] = fork()) == 0)
+        {
+          zmtest_relay(rcvfds[0], sndfds[1], baud);
+        }
+
+      close(sndfds[1]);
+      close(rcvfds[0]);
+      rcvfd = rcvfds[1];
+    }
+  else
+    {
+      close(rcvfds[0]);
+      close(rcvfds[1]);
+      rcvfd = sndfds[1];
+    }
+
+  start = zmtest_now();
+  if ((pids[npids++] = fork()) == 0)
+    {
+      close(sndfds[0]);
+      zmtest_receive(rcvfd, pathname);
+    }
+
+  close(rcvfd);
+
+  /* Send the file */
+
+  ret = EXIT_FAILURE;
+  handle = zms_initialize(sndfds[0]);
+  if (handle == NULL)
+    {
+      fprintf(stderr, "ERROR: zms_initialize failed\n");
+    }
+  else
+    {
+      if (zms_send(handle, srcname, ZMTEST_FILENAME, XM_XFERTYPE_BINARY,
+                   XM_OPTION_REPLACE, false) < 0)
+        {
+          fprintf(stderr, "ERROR: zms_send failed\n");
+        }
+      else
+        {
+          ret = EXIT_SUCCESS;
+        }
+
+      zms_release(handle);
+    }
+
+  /* Wait for the receiver to finish, then stop the relays.  The receiver
+   * would wait forever for a transfer that the sender gave up on.
+   */
+
+  if (ret != EXIT_SUCCESS)
+    {
+      kill(pids[npids - 1], SIGTERM);
+    }
+
+  waitpid(pids[npids - 1], &status, 0);
+  elapsed = zmtest_now() - start;
+  if (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+    {
+      fprintf(stderr, "ERROR: Receiver failed\n");
+      ret = EXIT_FAILURE;
+    }
+
+  for (i = 0; i < npids - 1; i++)
+    {
+      kill(pids[i], SIGTERM);
+      waitpid(pids[i], NULL, 0);
+    }
+
+  if (ret == EXIT_SUCCESS && zmtest_compare(srcname, dstname) < 0)
+    {
+      fprintf(stderr, "ERROR: %s differs from %s\n", dstname, srcname);
+      ret = EXIT_FAILURE;
+    }
+
+  if (ret == EXIT_SUCCESS)
+    {
+      printf("%zu bytes in %.3f s: %.1f KiB/s", size, elapsed,
+             size / elapsed / 1024);
+      if (baud != 0)
+        {
+          printf(", %.1f%% of %lu baud", 100.0 * size * 10 / baud / elapsed,
+                 baud);
+        }
+
+      printf("\n");
+    }
+
+  unlink(srcname);
+  rmdir(srcdir);
+  return ret;
+}
@@ -344,9 +344,6 @@ struct zm_state_s
   uint8_t  rcvbuf[CONFIG_SYSTEM_ZMODEM_RCVBUFSIZE];
   uint8_t  pktbuf[ZM_PKTBUFSIZE];
   uint8_t  scratch[CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE];
-#ifdef CONFIG_SYSTEM_ZMODEM_SNDFILEBUF
-  uint8_t  filebuf[CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE];
-#endif
 };
 
 /* Receive state information */
@@ -393,6 +390,9 @@ struct zms_state_s
   uint8_t dpkttype;          /* Streaming data packet type: ZCRCG, ZCRCQ, or ZCRCW */
   uint8_t fflags[4];         /* File xfer flags */
   uint16_t rcvmax;           /* Max packet size the remote can receive. */
+  bool crcvalid;             /* True: filecrc holds the file CRC */
+  uint32_t filecrc;          /* File CRC sent in reply to ZCRC */
+  int32_t window;            /* Max unacknowledged bytes when streaming */
 #ifdef CONFIG_SYSTEM_ZMODEM_TIMESTAMPS
   uint32_t timestamp;        /* Local file timestamp */
 #endif
@@ -609,6 +609,25 @@ void zm_flowc(int fd);
 FAR uint8_t *zm_putzdle(FAR struct zm_state_s *pzm, FAR uint8_t *buffer,
                         uint8_t ch);
 
+/****************************************************************************
+ * Name: zm_putzdlebuf
+ *
+ * Description:
+ *   Transfer a buffer of values to a buffer performing ZDLE escaping as
+ *   necessary.  Runs of characters that need no escaping are copied as a
+ *   whole.
+ *
+ * Input Parameters:
+ *   pzm    - Zmodem session state
+ *   buffer - Buffer in which to add the possibly escaped characters
+ *   src    - The raw, unescaped characters to be added
+ *   srclen - The number of characters in src
+ *
+ ****************************************************************************/
+
+FAR uint8_t *zm_putzdlebuf(FAR struct zm_state_s *pzm, FAR uint8_t *buffer,
+                           FAR const uint8_t *src, size_t srclen);
+
 /****************************************************************************
  * Name: zm_senddata
  *
@@ -30,12 +30,53 @@
 #include <nuttx/config.h>
 
 #include <stdio.h>
+#include <string.h>
 
 #include <nuttx/crc16.h>
 #include <nuttx/crc32.h>
 
 #include "zm.h"
 
+/****************************************************************************
+ * Pre-processor Definitions
+ ****************************************************************************/
+
+/* Bits in g_zdletab[] */
+
+#define ZDLE_ALWAYS      (1 << 0)   /* Always escaped */
+#define ZDLE_CTRL        (1 << 1)   /* Escaped if ZM_FLAG_ESCCTRL */
+#define ZDLE_CR          (1 << 2)   /* Escaped if ZM_FLAG_ATSIGN */
+
+/****************************************************************************
+ * Private Data
+ ****************************************************************************/
+
+/* Escape class of each byte value.  The Zmodem protocol requires that
+ * ZDLE, DLE, XON, XOFF, GS, DEL and 0xff (and their 8-bit counterparts
+ * except for ZDLE) always be escaped, that a CR following '@' be escaped,
+ * and that all control characters be escaped if the receiver asks for it.
+ */
+
+static const uint8_t g_zdletab[256] =
+{
+  2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 6, 2, 2,  /* 0x00-0x0f */
+  3, 3, 2, 3, 2, 2, 2, 2, 3, 2, 2, 2, 2, 3, 2, 2,  /* 0x10-0x1f */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 0x20-0x2f */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 0x30-0x3f */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 0x40-0x4f */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 0x50-0x5f */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 0x60-0x6f */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,  /* 0x70-0x7f */
+  2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 6, 2, 2,  /* 0x80-0x8f */
+  3, 3, 2, 3, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 2, 2,  /* 0x90-0x9f */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 0xa0-0xaf */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 0xb0-0xbf */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 0xc0-0xcf */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 0xd0-0xdf */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,  /* 0xe0-0xef */
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1   /* 0xf0-0xff */
+};
+
 /****************************************************************************
  * Public Data
  ****************************************************************************/
@@ -86,23 +127,13 @@ FAR uint8_t *zm_putzdle(FAR struct zm_state_s *pzm, FAR uint8_t *buffer,
                         uint8_t ch)
 {
   uint8_t ch7 = ch & 0x7f;
+  uint8_t esc = g_zdletab[ch];
 
-  /* Check if this character requires ZDLE escaping.
-   *
-   * The Zmodem protocol requires that CAN(ZDLE), DLE, XON, XOFF and a CR
-   * following '@' be escaped.
-   */
+  /* Check if this character requires ZDLE escaping */
 
-  if (ch   == ZDLE ||
-      ch7  == ASCII_DLE ||
-      ch7  == ASCII_DC1 ||
-      ch7  == ASCII_DC3 ||
-      ch7  == ASCII_GS ||
-      (ch7 == '\r' && (pzm->flags & ZM_FLAG_ATSIGN)  != 0) ||
-      (ch7 <  ' '  && (pzm->flags & ZM_FLAG_ESCCTRL) != 0) ||
-      ch7  == ASCII_DEL ||
-      ch   == 0xff
-      )
+  if ((esc & ZDLE_ALWAYS) != 0 ||
+      ((esc & ZDLE_CR) != 0 && (pzm->flags & ZM_FLAG_ATSIGN) != 0) ||
+      ((esc & ZDLE_CTRL) != 0 && (pzm->flags & ZM_FLAG_ESCCTRL) != 0))
     {
       /* Yes... save the data link escape the character */
 
@@ -142,6 +173,77 @@ FAR uint8_t *zm_putzdle(FAR struct zm_state_s *pzm, FAR uint8_t *buffer,
   return buffer;
 }
 
+/****************************************************************************
+ * Name: zm_putzdlebuf
+ *
+ * Description:
+ *   Transfer a buffer of values to a buffer performing ZDLE escaping as
+ *   necessary.  Runs of characters that need no escaping are copied as a
+ *   whole.
+ *
+ *   The source may lie further on in the same buffer as the destination.
+ *   The output does not overtake unread input as long as the distance
+ *   between the two is at least the number of characters escaped, which
+ *   is never more than 'srclen'.
+ *
+ * Input Parameters:
+ *   pzm    - Zmodem session state
+ *   buffer - Buffer in which to add the possibly escaped characters.  Up
+ *            to 2 * srclen bytes may be written.
+ *   src    - The raw, unescaped characters to be added
+ *   srclen - The number of characters in src
+ *
+ ****************************************************************************/
+
+FAR uint8_t *zm_putzdlebuf(FAR struct zm_state_s *pzm, FAR uint8_t *buffer,
+                           FAR const uint8_t *src, size_t srclen)
+{
+  uint8_t mask = ZDLE_ALWAYS | ZDLE_CR;
+  size_t run;
+
+  /* CR is only escaped after an '@', so every CR ends a run and is passed
+   * to zm_putzdle() which knows about the preceding character.
+   */
+
+  if ((pzm->flags & ZM_FLAG_ESCCTRL) != 0)
+    {
+      mask |= ZDLE_CTRL;
+    }
+
+  while (srclen > 0)
+    {
+      for (run = 0; run < srclen && (g_zdletab[src[run]] & mask) == 0;
+           run++)
+        {
+        }
+
+      if (run > 0)
+        {
+          memmove(buffer, src, run);
+          buffer += run;
+          src    += run;
+          srclen -= run;
+
+          if ((src[-1] & 0x7f) == '@')
+            {
+              pzm->flags |= ZM_FLAG_ATSIGN;
+            }
+          else
+            {
+              pzm->flags &= ~ZM_FLAG_ATSIGN;
+            }
+        }
+
+      if (srclen > 0)
+        {
+          buffer = zm_putzdle(pzm, buffer, *src++);
+          srclen--;
+        }
+    }
+
+  return buffer;
+}
+
 /****************************************************************************
  * Name: zm_senddata
  *
@@ -183,22 +285,25 @@ int zm_senddata(FAR struct zm_state_s *pzm, FAR const uint8_t *buffer,
   zmdbg("zbin=%c, buflen=%zu, term=%c flags=%04x\n",
         zbin, buflen, term, pzm->flags);
 
-  /* Transfer the data to the I/O buffer, accumulating the CRC */
+  /* Accumulate the CRC and transfer the data to the I/O buffer */
 
-  while (buflen-- > 0)
+  if (zbin == ZBIN)
     {
-      if (zbin == ZBIN)
-        {
-          crc = (uint32_t)crc16part(buffer, 1, (uint16_t)crc);
-        }
-      else /* zbin = ZBIN32 */
-        {
-          crc = crc32part(buffer, 1, crc);
-        }
-
-      ptr = zm_putzdle(pzm, ptr, *buffer++);
+      crc = (uint32_t)crc16part(buffer, buflen, (uint16_t)crc);
+    }
+  else /* zbin = ZBIN32 */
+    {
+      crc = crc32part(buffer, buflen, crc);
     }
 
+  /* The data may already be in the I/O buffer.  Move it to the end of the
+   * buffer where it cannot be overwritten by the escaped output.
+   */
+
+  buffer = memmove(pzm->scratch + CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE - buflen,
+                   buffer, buflen);
+  ptr    = zm_putzdlebuf(pzm, ptr, buffer, buflen);
+
   /* Trasnfer the data link escape character (without updating the CRC) */
 
   *ptr++ = ZDLE;
@@ -39,6 +39,7 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
@@ -58,6 +59,18 @@
  * Pre-processor Definitions
  ****************************************************************************/
 
+/* Space reserved at the end of a data packet for ZDLE, the packet type and
+ * up to four escaped CRC bytes.
+ */
+
+#define ZMS_TRAILERSIZE 10
+
+/* File data is read into the I/O buffer in gulps no smaller than this,
+ * except for the end of the file.
+ */
+
+#define ZMS_MINREAD     16
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -135,6 +148,8 @@ static int zms_endoftransfer(FAR struct zm_state_s *pzm);
 static int zms_fileskip(FAR struct zm_state_s *pzm);
 static int zms_sendfiledata(FAR struct zm_state_s *pzm);
 static int zms_sendpacket(FAR struct zm_state_s *pzm);
+static int zms_sendack(FAR struct zm_state_s *pzm);
+static int zms_sendingto(FAR struct zm_state_s *pzm);
 static int zms_filecrc(FAR struct zm_state_s *pzm);
 static int zms_sendwaitack(FAR struct zm_state_s *pzm);
 static int zms_sendnak(FAR struct zm_state_s *pzm);
@@ -249,14 +264,14 @@ static const struct zm_transition_s g_zms_crcwait[] =
 static const struct zm_transition_s g_zmr_sending[] =
 {
   {ZME_SINIT,     false, ZMS_START,    zms_attention},
-  {ZME_ACK,       false, ZMS_SENDING,  zms_sendpacket},
+  {ZME_ACK,       false, ZMS_SENDING,  zms_sendack},
   {ZME_RPOS,      true,  ZMS_SENDING,  zms_sendrpos},
   {ZME_SKIP,      true,  ZMS_FILEWAIT, zms_fileskip},
   {ZME_NAK,       true,  ZMS_SENDING,  zms_sendnak},
   {ZME_RINIT,     true,  ZMS_FILEWAIT, zms_sendfilename},
   {ZME_ABORT,     true,  ZMS_FINISH,   zms_abort},
   {ZME_FERR,      true,  ZMS_FINISH,   zms_abort},
-  {ZME_TIMEOUT,   false, ZMS_SENDING,  zms_sendpacket},
+  {ZME_TIMEOUT,   false, ZMS_SENDING,  zms_sendingto},
   {ZME_ERROR,     false, ZMS_SENDING,  zms_error},
 };
 
@@ -477,6 +492,25 @@ static int zms_zrinit(FAR struct zm_state_s *pzm)
       pzms->dpkttype = ZCRCW;
     }
 
+  /* If the link is full-duplex, the receiver's ZACKs can come back while
+   * we keep sending.  Stream ZCRCQ subpackets, each of which is ACKed,
+   * and only stop when a window of unacknowledged data is outstanding.
+   * The window never exceeds the receiver's buffer.
+   */
+
+  pzms->window = 0;
+#if CONFIG_SYSTEM_ZMODEM_SNDWINDOW > 0
+  if ((rcaps & CANFDX) != 0 && pzms->dpkttype != ZCRCG)
+    {
+      pzms->dpkttype = ZCRCQ;
+      pzms->window   = CONFIG_SYSTEM_ZMODEM_SNDWINDOW;
+      if (pzms->rcvmax != 0 && pzms->rcvmax < pzms->window)
+        {
+          pzms->window = pzms->rcvmax;
+        }
+    }
+#endif
+
 #ifdef CONFIG_SYSTEM_ZMODEM_ALWAYSSINT
   return zms_sendzsinit(pzm);
 #else
@@ -853,7 +887,9 @@ static int zms_sendfiledata(FAR struct zm_state_s *pzm)
 static int zms_sendpacket(FAR struct zm_state_s *pzm)
 {
   FAR struct zms_state_s *pzms = (FAR struct zms_state_s *)pzm;
+  FAR uint8_t *src;
   ssize_t nwritten;
+  ssize_t nread;
   int32_t unacked;
   bool bcrc32;
   uint32_t crc;
@@ -884,13 +920,21 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
       /* Can we still send?  If so, how much?   If rcvmax is zero, then the
        * remote can handle full streaming and we never have to wait.
        * Otherwise, we have to restrict the total number of unacknowledged
-       * bytes to rcvmax.
+       * bytes to rcvmax.  When streaming with a window, the window already
+       * accounts for rcvmax.
        */
 
-      zmdbg("sndsize: %d unacked: %d rcvmax: %d\n",
-            sndsize, unacked, pzms->rcvmax);
+      zmdbg("sndsize: %d unacked: %d rcvmax: %d window: %ld\n",
+            sndsize, unacked, pzms->rcvmax, (long)pzms->window);
 
-      if (pzms->rcvmax != 0)
+      if (pzms->window != 0)
+        {
+          if (sndsize + unacked > pzms->window)
+            {
+              sndsize = pzms->window - unacked;
+            }
+        }
+      else if (pzms->rcvmax != 0)
         {
           /* If we were to send 'sndsize' more bytes,
            * would that exceed recvmax?
@@ -901,7 +945,7 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
               /* Yes... clip the maximum so that we stay within that limit */
 
               int maximum = pzms->rcvmax - unacked;
-              if (sndsize < maximum)
+              if (sndsize > maximum)
                 {
                   sndsize = maximum;
                 }
@@ -915,12 +959,20 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
 
       if (sndsize <= 0)
         {
-          /* No, not now. Keep waiting */
+          /* No, not now. Keep waiting.  A full window is drained by the
+           * ZACKs of the subpackets already sent.
+           */
+
+          pzm->timeout = CONFIG_SYSTEM_ZMODEM_RESPTIME;
+          if (pzms->window != 0 && pzm->state == ZMS_SENDING)
+            {
+              zmdbg("ZMS_STATE %d: Window full\n", pzm->state);
+              return OK;
+            }
 
           zmdbg("ZMS_STATE %d->%d\n", pzm->state, ZMS_SENDWAIT);
 
           pzm->state   = ZMS_SENDWAIT;
-          pzm->timeout = CONFIG_SYSTEM_ZMODEM_RESPTIME;
           return OK;
         }
 
@@ -960,8 +1012,10 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
           type = pzms->dpkttype;
         }
 
-      /* Read characters from file and put into buffer until buffer is full
-       * or file is exhausted
+      /* Read file data into the end of the I/O buffer and escape it
+       * towards the front, accumulating the CRC on the way.  Each read is
+       * limited to half of the free space so that the escaped data always
+       * fits in front of the unread data, with room left for the trailer.
        */
 
       bcrc32      = ((pzm->flags & ZM_FLAG_CRC32) != 0);
@@ -969,55 +1023,51 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
       pzm->flags &= ~ZM_FLAG_ATSIGN;
 
       ptr         = pzm->scratch;
-      pktsize     = 0;
 
-#ifdef CONFIG_SYSTEM_ZMODEM_SNDFILEBUF
-      /* Read multiple bytes of file and store into the temporal buffer */
-
-      zm_read(pzms->infd, pzm->filebuf, CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE);
+      while (sndsize > 0)
+        {
+          nread = (CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE - ZMS_TRAILERSIZE -
+                   (ptr - pzm->scratch)) / 2;
+          if (nread >= sndsize)
+            {
+              nread = sndsize;
+            }
+          else if (nread < ZMS_MINREAD)
+            {
+              break;
+            }
 
-      i = 0;
-#endif
+          src   = pzm->scratch + CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE - nread;
+          nread = zm_read(pzms->infd, src, nread);
+          if (nread <= 0)
+            {
+              zmdbg("ERROR: Failed to read file at %lu: %d\n",
+                    (unsigned long)pzms->offset, (int)nread);
+              return nread < 0 ? (int)nread : -EIO;
+            }
 
-      while (pktsize <= (CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE - 10) &&
-             (pzms->offset < pzms->filesize))
-        {
-          /* Add the new value to the accumulated CRC */
+          /* Add the new data to the accumulated CRC */
 
-#ifdef CONFIG_SYSTEM_ZMODEM_SNDFILEBUF
-          uint8_t ch = pzm->filebuf[i++];
-#else
-          uint8_t ch = zm_getc(pzms->infd);
-#endif
           if (!bcrc32)
             {
-              crc = (uint32_t)crc16part(&ch, 1, (uint16_t)crc);
+              crc = (uint32_t)crc16part(src, nread, (uint16_t)crc);
             }
           else
             {
-              crc = crc32part(&ch, 1, crc);
+              crc = crc32part(src, nread, crc);
             }
 
-          /* Put the character into the buffer, escaping as necessary */
-
-          ptr = zm_putzdle(pzm, ptr, ch);
+          /* Put the data into the buffer, escaping as necessary */
 
-          /* Recalculate the accumulated packet size to handle expansion due
-           * to escaping.
-           */
-
-          pktsize = (int32_t)(ptr - pzm->scratch);
+          ptr = zm_putzdlebuf(pzm, ptr, src, nread);
 
           /* And increment the file offset */
 
-          pzms->offset++;
+          pzms->offset += nread;
+          sndsize      -= nread;
         }
 
-#ifdef CONFIG_SYSTEM_ZMODEM_SNDFILEBUF
-      /* Restore file position to be read next time */
-
-      lseek(pzms->infd, pzms->offset, SEEK_SET);
-#endif
+      pktsize = ptr - pzm->scratch;
 
       /* If we've reached file end, a ZEOF header will follow.  If there's
        * room in the outgoing buffer for it, end the packet with ZCRCE and
@@ -1029,7 +1079,8 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
       if (pzms->offset == pzms->filesize)
         {
           pzm->flags |= ZM_FLAG_EOF;
-          if (wait || (pzms->rcvmax != 0 && pktsize < 24))
+          if (wait || (pzms->window == 0 && pzms->rcvmax != 0 &&
+                       pktsize < 24))
             {
               type = ZCRCW;
             }
@@ -1077,7 +1128,7 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
       /* Get the final packet size */
 
       pktsize = ptr - pzm->scratch;
-      DEBUGASSERT(pktsize < CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE);
+      DEBUGASSERT(pktsize <= CONFIG_SYSTEM_ZMODEM_SNDBUFSIZE);
 
       /* And send the packet */
 
@@ -1138,12 +1189,71 @@ static int zms_sendpacket(FAR struct zm_state_s *pzm)
 #ifdef CONFIG_SYSTEM_ZMODEM_RCVSAMPLE
   while (pzm->state == ZMS_SENDING && !zm_rcvpending(pzm));
 #else
-  while (0);
+  while (pzm->state == ZMS_SENDING && pzms->window != 0);
 #endif
 
   return OK;
 }
 
+/****************************************************************************
+ * Name: zms_sendack
+ *
+ * Description:
+ *   A ZACK arrived for a ZCRCQ subpacket while streaming.  Update the last
+ *   known receiver offset and send more data if the window allows.
+ *
+ ****************************************************************************/
+
+static int zms_sendack(FAR struct zm_state_s *pzm)
+{
+  FAR struct zms_state_s *pzms = (FAR struct zms_state_s *)pzm;
+  off_t offset;
+
+  /* ZACKs for data sent before a ZRPOS may still arrive.  Ignore any
+   * offset beyond what has been sent since.
+   */
+
+  offset = zm_bytobe32(pzm->hdrdata + 1);
+  if (offset > pzms->lastoffs && offset <= pzms->offset)
+    {
+      pzms->lastoffs = offset;
+    }
+
+  zmdbg("ZMS_STATE %d: offset: %lu unacked: %lu\n", pzm->state,
+        (unsigned long)offset, (unsigned long)(pzms->offset - offset));
+
+  if (pzms->window != 0 &&
+      pzms->offset - pzms->lastoffs >= pzms->window)
+    {
+      return OK;
+    }
+
+  return zms_sendpacket(pzm);
+}
+
+/****************************************************************************
+ * Name: zms_sendingto
+ *
+ * Description:
+ *   A timeout occurred while streaming.  Carry on sending unless we are
+ *   waiting for ZACKs to open the window, in which case the receiver has
+ *   stopped responding.
+ *
+ ****************************************************************************/
+
+static int zms_sendingto(FAR struct zm_state_s *pzm)
+{
+  FAR struct zms_state_s *pzms = (FAR struct zms_state_s *)pzm;
+
+  if (pzms->window != 0 &&
+      pzms->offset - pzms->lastoffs >= pzms->window)
+    {
+      return zms_timeout(pzm);
+    }
+
+  return zms_sendpacket(pzm);
+}
+
 /****************************************************************************
  * Name: zms_filecrc
  *
@@ -1156,12 +1266,20 @@ static int zms_filecrc(FAR struct zm_state_s *pzm)
 {
   FAR struct zms_state_s *pzms = (FAR struct zms_state_s *)pzm;
   uint8_t by[4];
-  uint32_t crc;
 
-  crc = zm_filecrc(pzm, pzms->filename);
-  zmdbg("ZMS_STATE %d: CRC %08x\n", pzm->state, crc);
+  /* The receiver may ask again if our reply got lost.  Only read the file
+   * the first time.
+   */
+
+  if (!pzms->crcvalid)
+    {
+      pzms->filecrc  = zm_filecrc(pzm, pzms->filename);
+      pzms->crcvalid = true;
+    }
+
+  zmdbg("ZMS_STATE %d: CRC %08" PRIx32 "\n", pzm->state, pzms->filecrc);
 
-  zm_be32toby(crc, by);
+  zm_be32toby(pzms->filecrc, by);
   return zm_sendhexhdr(pzm, ZCRC, by);
 }
 
@@ -1519,6 +1637,7 @@ static int zms_sendfile(FAR struct zms_state_s *pzms,
   pzms->fflags[0]  = 0;
   pzms->offset     = 0;
   pzms->lastoffs   = 0;
+  pzms->crcvalid   = false;
 
   pzms->filesize   = buf.st_size;
 #ifdef CONFIG_SYSTEM_ZMODEM_TIMESTAMPS
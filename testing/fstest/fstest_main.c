@@ -40,12 +40,17 @@
 #include <fcntl.h>
 #include <dirent.h>
 #include <string.h>
+#include <limits.h>
 #include <errno.h>
 #include <debug.h>
 #include <assert.h>
+#include <time.h>
 
+#include <nuttx/arch.h>
 #include <nuttx/crc32.h>
 
+#include "testing/latencyhist.h"
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -56,6 +61,18 @@
 #  define CONFIG_TESTING_FSTEST_VERBOSE 0
 #endif
 
+/* Benchmark ****************************************************************/
+
+#define FSTEST_BENCH_FILE     "fstest_bench.dat"
+#define FSTEST_BENCH_MINBLOCK 256
+#define FSTEST_BENCH_MAXBLOCK 16384
+
+/* An operation that takes this many times the median is counted as a
+ * stall, typically garbage collection or an erase in the file system.
+ */
+
+#define FSTEST_BENCH_STALL    10
+
 /****************************************************************************
  * Private Types
  ****************************************************************************/
@@ -69,6 +86,12 @@ struct fstest_filedesc_s
   uint32_t crc;
 };
 
+struct fstest_hist_s
+{
+  uint64_t total;             /* Sum of all latencies in nanoseconds */
+  struct latencyhist_s lat;   /* Latencies in microseconds */
+};
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -932,6 +955,340 @@ static int fstest_directory(FAR struct fstest_ctx_s *ctx)
   return OK;
 }
 
+/****************************************************************************
+ * Name: fstest_bench_gettime
+ *
+ * Description:
+ *   Return a high resolution time stamp.
+ *
+ ****************************************************************************/
+
+static clock_t fstest_bench_gettime(void)
+{
+  return up_perf_gettime();
+}
+
+/****************************************************************************
+ * Name: fstest_bench_record
+ *
+ * Description:
+ *   Add the time since 'start' to a histogram, in microseconds.
+ *
+ ****************************************************************************/
+
+static void fstest_bench_record(FAR struct fstest_hist_s *hist,
+                                clock_t start)
+{
+  struct timespec ts;
+  uint64_t nsec;
+
+  up_perf_convert(fstest_bench_gettime() - start, &ts);
+  nsec = (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+
+  hist->total += nsec;
+  latencyhist_record(&hist->lat, nsec / 1000);
+}
+
+/****************************************************************************
+ * Name: fstest_bench_report
+ *
+ * Description:
+ *   Print one result line.  The throughput is only meaningful for the
+ *   data transfers, pass nbytes = 0 for the metadata operations.
+ *
+ ****************************************************************************/
+
+static void fstest_bench_report(FAR const char *name, size_t bsize,
+                                FAR const struct fstest_hist_s *hist,
+                                uint64_t nbytes)
+{
+  uint32_t p50 = latencyhist_percentile(&hist->lat, 500);
+  uint32_t threshold = (p50 > 0 ? p50 : 1) * FSTEST_BENCH_STALL;
+  uint32_t stalls = 0;
+  uint64_t kbps10 = 0;
+  int index;
+
+  /* Count the operations in the buckets entirely above the threshold */
+
+  for (index = 1; index < LATENCYHIST_NBUCKETS; index++)
+    {
+      if (latencyhist_bound(index - 1) >= threshold)
+        {
+          stalls += hist->lat.bucket[index];
+        }
+    }
+
+  if (nbytes > 0 && hist->total > 0)
+    {
+      kbps10 = nbytes * 1000000000 / 1024 * 10 / hist->total;
+    }
+
+  printf("%-9s %6lu %8lu.%lu %8lu %8lu %8lu %8lu %6lu\n",
+         name, (unsigned long)bsize,
+         (unsigned long)(kbps10 / 10), (unsigned long)(kbps10 % 10),
+         (unsigned long)hist->lat.count, (unsigned long)p50,
+         (unsigned long)latencyhist_percentile(&hist->lat, 990),
+         (unsigned long)hist->lat.max, (unsigned long)stalls);
+}
+
+/****************************************************************************
+ * Name: fstest_bench_io
+ *
+ * Description:
+ *   Sequential write, sequential read, random read and random overwrite
+ *   of one file of 'filesize' bytes in 'bsize' blocks.  The final fsync()
+ *   and close() count towards the writes, so that file systems that only
+ *   cache data are not credited with speed they do not have.
+ *
+ ****************************************************************************/
+
+static int fstest_bench_io(FAR const char *path, FAR uint8_t *buffer,
+                           size_t bsize, size_t filesize)
+{
+  struct fstest_hist_s hist;
+  size_t nblocks = filesize / bsize;
+  clock_t start;
+  size_t i;
+  int fd;
+
+  /* Sequential write */
+
+  memset(&hist, 0, sizeof(hist));
+  start = fstest_bench_gettime();
+  fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+  fstest_bench_record(&hist, start);
+  if (fd < 0)
+    {
+      printf("ERROR: Failed to open %s: %d\n", path, errno);
+      return ERROR;
+    }
+
+  for (i = 0; i < nblocks; i++)
+    {
+      start = fstest_bench_gettime();
+      if (write(fd, buffer, bsize) != (ssize_t)bsize)
+        {
+          printf("ERROR: Failed to write %s: %d\n", path, errno);
+          close(fd);
+          return ERROR;
+        }
+
+      fstest_bench_record(&hist, start);
+    }
+
+  start = fstest_bench_gettime();
+  fsync(fd);
+  close(fd);
+  fstest_bench_record(&hist, start);
+  fstest_bench_report("seqwrite", bsize, &hist, nblocks * bsize);
+
+  /* Sequential read */
+
+  memset(&hist, 0, sizeof(hist));
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    {
+      printf("ERROR: Failed to open %s: %d\n", path, errno);
+      return ERROR;
+    }
+
+  for (i = 0; i < nblocks; i++)
+    {
+      start = fstest_bench_gettime();
+      if (read(fd, buffer, bsize) != (ssize_t)bsize)
+        {
+          printf("ERROR: Failed to read %s: %d\n", path, errno);
+          close(fd);
+          return ERROR;
+        }
+
+      fstest_bench_record(&hist, start);
+    }
+
+  fstest_bench_report("seqread", bsize, &hist, nblocks * bsize);
+
+  /* Random read, each operation is a seek and a read */
+
+  memset(&hist, 0, sizeof(hist));
+  for (i = 0; i < nblocks; i++)
+    {
+      start = fstest_bench_gettime();
+      lseek(fd, (off_t)(rand() % nblocks) * bsize, SEEK_SET);
+      if (read(fd, buffer, bsize) != (ssize_t)bsize)
+        {
+          printf("ERROR: Failed to read %s: %d\n", path, errno);
+          close(fd);
+          return ERROR;
+        }
+
+      fstest_bench_record(&hist, start);
+    }
+
+  close(fd);
+  fstest_bench_report("randread", bsize, &hist, nblocks * bsize);
+
+  /* Random overwrite in place */
+
+  memset(&hist, 0, sizeof(hist));
+  fd = open(path, O_WRONLY);
+  if (fd < 0)
+    {
+      printf("ERROR: Failed to open %s: %d\n", path, errno);
+      return ERROR;
+    }
+
+  for (i = 0; i < nblocks; i++)
+    {
+      start = fstest_bench_gettime();
+      lseek(fd, (off_t)(rand() % nblocks) * bsize, SEEK_SET);
+      if (write(fd, buffer, bsize) != (ssize_t)bsize)
+        {
+          printf("ERROR: Failed to write %s: %d\n", path, errno);
+          close(fd);
+          return ERROR;
+        }
+
+      fstest_bench_record(&hist, start);
+    }
+
+  start = fstest_bench_gettime();
+  fsync(fd);
+  close(fd);
+  fstest_bench_record(&hist, start);
+  fstest_bench_report("randwrite", bsize, &hist, nblocks * bsize);
+
+  return unlink(path);
+}
+
+/****************************************************************************
+ * Name: fstest_bench_files
+ *
+ * Description:
+ *   Time the metadata operations on 'nfiles' small files: create (open,
+ *   write 'fsize' bytes and close), open and close, and unlink.
+ *
+ ****************************************************************************/
+
+static int fstest_bench_files(FAR struct fstest_ctx_s *ctx,
+                              FAR uint8_t *buffer, int nfiles, size_t fsize)
+{
+  struct fstest_hist_s create;
+  struct fstest_hist_s reopen;
+  struct fstest_hist_s unlinked;
+  char path[PATH_MAX];
+  clock_t start;
+  int ret = OK;
+  int fd;
+  int i;
+
+  memset(&create, 0, sizeof(create));
+  memset(&reopen, 0, sizeof(reopen));
+  memset(&unlinked, 0, sizeof(unlinked));
+
+  for (i = 0; i < nfiles; i++)
+    {
+      snprintf(path, sizeof(path), "%sfstest_bench%d", ctx->mountdir, i);
+
+      start = fstest_bench_gettime();
+      fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+      if (fd < 0)
+        {
+          printf("ERROR: Failed to create %s: %d\n", path, errno);
+          nfiles = i;
+          ret = ERROR;
+          break;
+        }
+
+      write(fd, buffer, fsize);
+      close(fd);
+      fstest_bench_record(&create, start);
+    }
+
+  for (i = 0; i < nfiles; i++)
+    {
+      snprintf(path, sizeof(path), "%sfstest_bench%d", ctx->mountdir, i);
+
+      start = fstest_bench_gettime();
+      fd = open(path, O_RDONLY);
+      if (fd >= 0)
+        {
+          close(fd);
+        }
+
+      fstest_bench_record(&reopen, start);
+    }
+
+  for (i = 0; i < nfiles; i++)
+    {
+      snprintf(path, sizeof(path), "%sfstest_bench%d", ctx->mountdir, i);
+
+      start = fstest_bench_gettime();
+      unlink(path);
+      fstest_bench_record(&unlinked, start);
+    }
+
+  fstest_bench_report("create", fsize, &create, 0);
+  fstest_bench_report("open", fsize, &reopen, 0);
+  fstest_bench_report("unlink", fsize, &unlinked, 0);
+  return ret;
+}
+
+/****************************************************************************
+ * Name: fstest_benchmark
+ *
+ * Description:
+ *   Measure throughput and per-operation latency of the file system under
+ *   test: data transfers at block sizes from FSTEST_BENCH_MINBLOCK to
+ *   FSTEST_BENCH_MAXBLOCK, then small file metadata operations.
+ *
+ ****************************************************************************/
+
+static int fstest_benchmark(FAR struct fstest_ctx_s *ctx, size_t filesize,
+                            int nfiles)
+{
+  char path[PATH_MAX];
+  FAR uint8_t *buffer;
+  size_t bsize;
+  size_t i;
+  int ret = OK;
+
+  buffer = malloc(FSTEST_BENCH_MAXBLOCK);
+  if (buffer == NULL)
+    {
+      printf("ERROR: Failed to allocate the I/O buffer\n");
+      return -ENOMEM;
+    }
+
+  for (i = 0; i < FSTEST_BENCH_MAXBLOCK; i++)
+    {
+      buffer[i] = rand();
+    }
+
+  snprintf(path, sizeof(path), "%s" FSTEST_BENCH_FILE, ctx->mountdir);
+
+  printf("\n=== BENCHMARK %s: %lu byte file, %d small files ===\n",
+         ctx->mountdir, (unsigned long)filesize, nfiles);
+  printf("%-9s %6s %10s %8s %8s %8s %8s %6s\n", "test", "bsize",
+         "KB/s", "ops", "p50(us)", "p99(us)", "max(us)", "stalls");
+
+  for (bsize = FSTEST_BENCH_MINBLOCK;
+       bsize <= FSTEST_BENCH_MAXBLOCK && bsize <= filesize; bsize <<= 2)
+    {
+      ret = fstest_bench_io(path, buffer, bsize, filesize);
+      if (ret < 0)
+        {
+          goto errout;
+        }
+    }
+
+  ret = fstest_bench_files(ctx, buffer, nfiles, FSTEST_BENCH_MINBLOCK);
+
+errout:
+  fflush(stdout);
+  free(buffer);
+  return ret;
+}
+
 /****************************************************************************
  * Show help Message
  ****************************************************************************/
@@ -943,6 +1300,11 @@ static void show_useage(void)
   printf("-n    num of test loop e.g. [%d]\n", CONFIG_TESTING_FSTEST_NLOOPS);
   printf("-m    mount point to be tested e.g. [%s]\n",
           CONFIG_TESTING_FSTEST_MOUNTPT);
+  printf("-b    run the benchmark instead of the stress test\n");
+  printf("-s    benchmark file size e.g. [%d]\n",
+          CONFIG_TESTING_FSTEST_BENCH_FILESIZE);
+  printf("-f    number of benchmark small files e.g. [%d]\n",
+          CONFIG_TESTING_FSTEST_BENCH_NFILES);
 }
 
 /****************************************************************************
@@ -961,6 +1323,9 @@ int main(int argc, FAR char *argv[])
   int ret;
   int loop_num;
   int option;
+  bool bench = false;
+  size_t bench_size = CONFIG_TESTING_FSTEST_BENCH_FILESIZE;
+  int bench_nfiles = CONFIG_TESTING_FSTEST_BENCH_NFILES;
 
   ctx = malloc(sizeof(struct fstest_ctx_s));
   if (ctx == NULL)
@@ -979,7 +1344,7 @@ int main(int argc, FAR char *argv[])
 
   /* Opt Parse */
 
-  while ((option = getopt(argc, argv, ":m:hn:")) != -1)
+  while ((option = getopt(argc, argv, ":m:hn:bs:f:")) != -1)
     {
       switch (option)
         {
@@ -993,6 +1358,15 @@ int main(int argc, FAR char *argv[])
           case 'n':
             loop_num = atoi(optarg);
             break;
+          case 'b':
+            bench = true;
+            break;
+          case 's':
+            bench_size = strtoul(optarg, NULL, 0);
+            break;
+          case 'f':
+            bench_nfiles = atoi(optarg);
+            break;
           case ':':
             printf("Error: Missing required argument\n");
             free(ctx);
@@ -1009,6 +1383,13 @@ int main(int argc, FAR char *argv[])
       strcat(ctx->mountdir, "/");
     }
 
+  if (bench)
+    {
+      ret = fstest_benchmark(ctx, bench_size, bench_nfiles);
+      free(ctx);
+      return ret < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
   /* Set up memory monitoring */
 
   ctx->mmbefore = mallinfo();
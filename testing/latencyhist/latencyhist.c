@@ -0,0 +1,124 @@
+/****************************************************************************
+ * apps/testing/latencyhist/latencyhist.c
+ *
+ * Licensed to the Apache Software Foundation (ASF) under one or more
+ * contributor license agreements.  See the NOTICE file distributed with
+ * this work for additional information regarding copyright ownership.  The
+ * ASF licenses this file to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance with the
+ * License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ * WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.  See the
+ * License for the specific language governing permissions and limitations
+ * under the License.
+ *
+ ****************************************************************************/
+
+/****************************************************************************
+ * Included Files
+ ****************************************************************************/
+
+#include <nuttx/config.h>
+
+#include <stdint.h>
+
+#include "testing/latencyhist.h"
+
+/****************************************************************************
+ * Public Functions
+ ****************************************************************************/
+
+/****************************************************************************
+ * Name: latencyhist_record
+ ****************************************************************************/
+
+void latencyhist_record(FAR struct latencyhist_s *hist, uint32_t value)
+{
+  int index;
+  int log2;
+
+  if (value < 8)
+    {
+      index = value;
+    }
+  else
+    {
+      log2  = 31 - __builtin_clz(value);
+      index = 8 + (log2 - 3) * 4 + ((value >> (log2 - 2)) & 3);
+    }
+
+  hist->bucket[index]++;
+  hist->count++;
+  if (value > hist->max)
+    {
+      hist->max = value;
+    }
+}
+
+/****************************************************************************
+ * Name: latencyhist_add
+ ****************************************************************************/
+
+void latencyhist_add(FAR struct latencyhist_s *to,
+                     FAR const struct latencyhist_s *from)
+{
+  int index;
+
+  to->count += from->count;
+  if (from->max > to->max)
+    {
+      to->max = from->max;
+    }
+
+  for (index = 0; index < LATENCYHIST_NBUCKETS; index++)
+    {
+      to->bucket[index] += from->bucket[index];
+    }
+}
+
+/****************************************************************************
+ * Name: latencyhist_bound
+ ****************************************************************************/
+
+uint32_t latencyhist_bound(int index)
+{
+  int log2;
+
+  if (index < 8)
+    {
+      return index;
+    }
+
+  log2 = (index - 8) / 4 + 3;
+  return (uint32_t)((((uint64_t)(4 + (index - 8) % 4 + 1)) <<
+                     (log2 - 2)) - 1);
+}
+
+/****************************************************************************
+ * Name: latencyhist_percentile
+ ****************************************************************************/
+
+uint32_t latencyhist_percentile(FAR const struct latencyhist_s *hist,
+                                uint32_t permille)
+{
+  uint64_t target = ((uint64_t)hist->count * permille + 999) / 1000;
+  uint64_t seen = 0;
+  uint32_t bound;
+  int index;
+
+  for (index = 0; index < LATENCYHIST_NBUCKETS - 1; index++)
+    {
+      seen += hist->bucket[index];
+      if (seen >= target && seen > 0)
+        {
+          break;
+        }
+    }
+
+  bound = latencyhist_bound(index);
+  return bound < hist->max ? bound : hist->max;
+}
@@ -26,20 +26,31 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
 #include <malloc.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifndef CONFIG_DISABLE_PTHREAD
+#include <pthread.h>
+#endif
 
 #ifdef CONFIG_TESTING_MM_POWEROFF
 #include <sys/boardctl.h>
 #endif
 
+#include <nuttx/arch.h>
 #include <nuttx/queue.h>
 
 /* Include nuttx/mm/mm_heap/mm.h */
 
 #include <mm.h>
 
+#include "testing/latencyhist.h"
+
 /****************************************************************************
  * Pre-processor Definitions
  ****************************************************************************/
@@ -50,6 +61,54 @@
 
 #define STOP_ON_ERRORS exit(1)
 
+/* Benchmark defaults */
+
+#define BENCH_THREADS   1
+#define BENCH_OPS       10000
+#define BENCH_LIVE      64
+#define BENCH_MAXTHREADS 16
+
+/****************************************************************************
+ * Private Types
+ ****************************************************************************/
+
+enum bench_op_e
+{
+  BENCH_MALLOC = 0,
+  BENCH_REALLOC,
+  BENCH_FREE,
+  BENCH_NOPS
+};
+
+/* Latencies are recorded in ticks */
+
+struct bench_hist_s
+{
+  uint32_t failed;
+  struct latencyhist_s lat;
+};
+
+struct bench_s
+{
+  FAR const char *dist;   /* Name of the size distribution */
+  int nthreads;           /* Number of threads running the mix */
+  int nops;               /* Operations per thread */
+  int nlive;              /* Allocations each thread keeps live */
+  uint32_t seed;          /* Seed of the size and slot sequence */
+  FAR size_t (*getsize)(FAR uint32_t *state);
+#ifndef CONFIG_DISABLE_PTHREAD
+  pthread_barrier_t barrier;
+#endif
+};
+
+struct bench_thread_s
+{
+  FAR struct bench_s *bench;
+  uint32_t state;         /* Random number generator state */
+  FAR void **ptrs;        /* The live allocations, NULL for free slots */
+  struct bench_hist_s hist[BENCH_NOPS];
+};
+
 /****************************************************************************
  * Private Data
  ****************************************************************************/
@@ -119,6 +178,11 @@ static const int g_alignment2[NTEST_ALLOCS / 2] =
 static FAR void       *g_allocs[NTEST_ALLOCS];
 static struct mallinfo g_alloc_info;
 
+static FAR const char * const g_bench_opnames[BENCH_NOPS] =
+{
+  "malloc", "realloc", "free"
+};
+
 /****************************************************************************
  * Private Functions
  ****************************************************************************/
@@ -364,6 +428,411 @@ static int mm_stress_test(int argc, FAR char *argv[])
   return 0;
 }
 
+/****************************************************************************
+ * Name: bench_random
+ *
+ * Description:
+ *   xorshift32.  Each thread has its own state, so runs are repeatable
+ *   for a given seed and no lock is shared between the threads.
+ *
+ ****************************************************************************/
+
+static uint32_t bench_random(FAR uint32_t *state)
+{
+  uint32_t x = *state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+/****************************************************************************
+ * Name: bench_size_small
+ *
+ * Description:
+ *   Mostly small objects, as seen from drivers, protocol stacks and
+ *   application data structures: half 8-64 bytes, 40% 64-256 bytes and
+ *   10% 256-1024 bytes.
+ *
+ ****************************************************************************/
+
+static size_t bench_size_small(FAR uint32_t *state)
+{
+  uint32_t r = bench_random(state);
+  uint32_t pct = r % 100;
+
+  r >>= 8;
+  if (pct < 50)
+    {
+      return 8 + r % 57;
+    }
+  else if (pct < 90)
+    {
+      return 64 + r % 193;
+    }
+  else
+    {
+      return 256 + r % 769;
+    }
+}
+
+/****************************************************************************
+ * Name: bench_size_mixed
+ *
+ * Description:
+ *   Log-uniform from 8 bytes to 16KiB: every power of two is equally
+ *   likely, which stresses the splitting and coalescing of free blocks.
+ *
+ ****************************************************************************/
+
+static size_t bench_size_mixed(FAR uint32_t *state)
+{
+  uint32_t r = bench_random(state);
+  size_t base = (size_t)8 << (r % 11);
+
+  return base + (r >> 8) % base;
+}
+
+/****************************************************************************
+ * Name: bench_size_table
+ *
+ * Description:
+ *   The sizes of the functional test, including its few very large ones.
+ *
+ ****************************************************************************/
+
+static size_t bench_size_table(FAR uint32_t *state)
+{
+  return g_alloc_sizes[bench_random(state) % NTEST_ALLOCS];
+}
+
+/****************************************************************************
+ * Name: bench_ns
+ ****************************************************************************/
+
+static unsigned long bench_ns(uint32_t ticks)
+{
+  struct timespec ts;
+
+  up_perf_convert(ticks, &ts);
+  return ts.tv_sec * 1000000000ul + ts.tv_nsec;
+}
+
+/****************************************************************************
+ * Name: bench_thread
+ *
+ * Description:
+ *   Run a random mix of malloc, realloc and free on a set of live slots.
+ *   An empty slot is filled; a full slot is resized one time in four and
+ *   freed otherwise, so the heap settles around half the slots in use.
+ *
+ ****************************************************************************/
+
+static FAR void *bench_thread(FAR void *arg)
+{
+  FAR struct bench_thread_s *thread = arg;
+  FAR struct bench_s *bench = thread->bench;
+  FAR void *ptr;
+  uint32_t start;
+  uint32_t r;
+  size_t size;
+  int slot;
+  int op;
+  int i;
+
+#ifndef CONFIG_DISABLE_PTHREAD
+  pthread_barrier_wait(&bench->barrier);
+#endif
+
+  for (i = 0; i < bench->nops; i++)
+    {
+      r    = bench_random(&thread->state);
+      slot = r % bench->nlive;
+      ptr  = thread->ptrs[slot];
+
+      if (ptr == NULL)
+        {
+          op = BENCH_MALLOC;
+        }
+      else if (((r >> 16) & 3) == 0)
+        {
+          op = BENCH_REALLOC;
+        }
+      else
+        {
+          op = BENCH_FREE;
+        }
+
+      size = op == BENCH_FREE ? 0 : bench->getsize(&thread->state);
+
+      start = up_perf_gettime();
+      switch (op)
+        {
+          case BENCH_MALLOC:
+            ptr = malloc(size);
+            break;
+
+          case BENCH_REALLOC:
+            ptr = realloc(ptr, size);
+            break;
+
+          default:
+            free(ptr);
+            ptr = NULL;
+            break;
+        }
+
+      latencyhist_record(&thread->hist[op].lat, up_perf_gettime() - start);
+
+      if (op != BENCH_FREE)
+        {
+          if (ptr == NULL)
+            {
+              /* Out of memory.  A failed realloc leaves the old block in
+               * the slot.
+               */
+
+              thread->hist[op].failed++;
+              continue;
+            }
+
+          /* Touch the block as a user would */
+
+          *(FAR uint8_t *)ptr = (uint8_t)i;
+        }
+
+      thread->ptrs[slot] = ptr;
+    }
+
+  return NULL;
+}
+
+/****************************************************************************
+ * Name: mm_benchmark
+ *
+ * Description:
+ *   Time a reproducible mix of heap operations from one or more threads.
+ *   Reports operations per second, latency percentiles per operation and
+ *   how fragmented the free memory is while the allocations are live.
+ *
+ ****************************************************************************/
+
+static int mm_benchmark(int argc, FAR char *argv[])
+{
+  FAR struct bench_thread_s *threads;
+  struct bench_hist_s total[BENCH_NOPS];
+#ifndef CONFIG_DISABLE_PTHREAD
+  pthread_t tids[BENCH_MAXTHREADS];
+#endif
+  struct bench_s bench;
+  struct mallinfo info;
+  struct timespec ts0;
+  struct timespec ts1;
+  uint64_t elapsed;
+  uint64_t nops = 0;
+  unsigned long frag;
+  int ret = 0;
+  int i;
+  int j;
+
+  memset(&bench, 0, sizeof(bench));
+  bench.dist     = "small";
+  bench.nthreads = BENCH_THREADS;
+  bench.nops     = BENCH_OPS;
+  bench.nlive    = BENCH_LIVE;
+  bench.seed     = 1;
+
+  while ((i = getopt(argc, argv, "t:n:l:d:s:")) != ERROR)
+    {
+      switch (i)
+        {
+          case 't':
+            bench.nthreads = atoi(optarg);
+            break;
+
+          case 'n':
+            bench.nops = atoi(optarg);
+            break;
+
+          case 'l':
+            bench.nlive = atoi(optarg);
+            break;
+
+          case 'd':
+            bench.dist = optarg;
+            break;
+
+          case 's':
+            bench.seed = strtoul(optarg, NULL, 0);
+            break;
+
+          default:
+            printf("Usage: %s [-t threads] [-n ops] [-l live]"
+                   " [-d small|mixed|table] [-s seed]\n", argv[0]);
+            return -EINVAL;
+        }
+    }
+
+  if (strcmp(bench.dist, "small") == 0)
+    {
+      bench.getsize = bench_size_small;
+    }
+  else if (strcmp(bench.dist, "mixed") == 0)
+    {
+      bench.getsize = bench_size_mixed;
+    }
+  else if (strcmp(bench.dist, "table") == 0)
+    {
+      bench.getsize = bench_size_table;
+    }
+  else
+    {
+      printf("Unknown distribution: %s\n", bench.dist);
+      return -EINVAL;
+    }
+
+#ifdef CONFIG_DISABLE_PTHREAD
+  bench.nthreads = 1;
+#endif
+
+  if (bench.nthreads < 1 || bench.nthreads > BENCH_MAXTHREADS ||
+      bench.nops < 1 || bench.nlive < 1 || bench.seed == 0)
+    {
+      printf("Invalid parameter\n");
+      return -EINVAL;
+    }
+
+  /* All bookkeeping is allocated up front and stays out of the timing */
+
+  threads = calloc(bench.nthreads, sizeof(struct bench_thread_s));
+  if (threads == NULL)
+    {
+      return -ENOMEM;
+    }
+
+  for (i = 0; i < bench.nthreads; i++)
+    {
+      threads[i].bench = &bench;
+      threads[i].state = bench.seed + i * 0x9e3779b9;
+      if (threads[i].state == 0)
+        {
+          threads[i].state = 1;
+        }
+
+      threads[i].ptrs = calloc(bench.nlive, sizeof(FAR void *));
+      if (threads[i].ptrs == NULL)
+        {
+          ret = -ENOMEM;
+          goto errout;
+        }
+    }
+
+  printf("mm bench: %d thread(s), %d ops each, %d live, %s sizes,"
+         " seed %" PRIu32 "\n", bench.nthreads, bench.nops, bench.nlive,
+         bench.dist, bench.seed);
+
+  clock_gettime(CLOCK_MONOTONIC, &ts0);
+
+#ifdef CONFIG_DISABLE_PTHREAD
+  bench_thread(&threads[0]);
+#else
+  pthread_barrier_init(&bench.barrier, NULL, bench.nthreads);
+
+  for (i = 0; i < bench.nthreads; i++)
+    {
+      ret = pthread_create(&tids[i], NULL, bench_thread, &threads[i]);
+      if (ret != 0)
+        {
+          /* The others would wait for this one forever */
+
+          printf("pthread_create failed: %d\n", ret);
+          exit(1);
+        }
+    }
+
+  for (i = 0; i < bench.nthreads; i++)
+    {
+      pthread_join(tids[i], NULL);
+    }
+
+  pthread_barrier_destroy(&bench.barrier);
+#endif
+
+  clock_gettime(CLOCK_MONOTONIC, &ts1);
+
+  /* Fragmentation with the live set still allocated: the share of the
+   * free memory that is not in the largest free block.
+   */
+
+  info = mallinfo();
+  frag = info.fordblks > 0 ?
+         1000ul - (unsigned long)((uint64_t)info.mxordblk * 1000 /
+                                  info.fordblks) : 0;
+
+  memset(total, 0, sizeof(total));
+  for (i = 0; i < bench.nthreads; i++)
+    {
+      for (j = 0; j < BENCH_NOPS; j++)
+        {
+          total[j].failed += threads[i].hist[j].failed;
+          latencyhist_add(&total[j].lat, &threads[i].hist[j].lat);
+        }
+    }
+
+  elapsed = (uint64_t)(ts1.tv_sec - ts0.tv_sec) * 1000000 +
+            (ts1.tv_nsec - ts0.tv_nsec) / 1000;
+  if (elapsed == 0)
+    {
+      elapsed = 1;
+    }
+
+  for (j = 0; j < BENCH_NOPS; j++)
+    {
+      nops += total[j].lat.count;
+    }
+
+  printf("  elapsed %" PRIu64 " us, %" PRIu64 " ops/sec\n",
+         elapsed, nops * 1000000 / elapsed);
+  printf("  %-8s %8s %6s %8s %8s %8s %8s %8s (ns)\n",
+         "op", "count", "failed", "p50", "p90", "p99", "p99.9", "max");
+
+  for (j = 0; j < BENCH_NOPS; j++)
+    {
+      printf("  %-8s %8" PRIu32 " %6" PRIu32
+             " %8lu %8lu %8lu %8lu %8lu\n",
+             g_bench_opnames[j], total[j].lat.count, total[j].failed,
+             bench_ns(latencyhist_percentile(&total[j].lat, 500)),
+             bench_ns(latencyhist_percentile(&total[j].lat, 900)),
+             bench_ns(latencyhist_percentile(&total[j].lat, 990)),
+             bench_ns(latencyhist_percentile(&total[j].lat, 999)),
+             bench_ns(total[j].lat.max));
+    }
+
+  printf("  free %lu bytes in %lu chunks, largest %lu,"
+         " fragmentation %lu.%lu%%\n",
+         (unsigned long)info.fordblks, (unsigned long)info.ordblks,
+         (unsigned long)info.mxordblk, frag / 10, frag % 10);
+
+errout:
+  for (i = 0; i < bench.nthreads; i++)
+    {
+      if (threads[i].ptrs != NULL)
+        {
+          for (j = 0; j < bench.nlive; j++)
+            {
+              free(threads[i].ptrs[j]);
+            }
+
+          free(threads[i].ptrs);
+        }
+    }
+
+  free(threads);
+  return ret;
+}
+
 /****************************************************************************
  * Public Functions
  ****************************************************************************/
@@ -374,6 +843,11 @@ static int mm_stress_test(int argc, FAR char *argv[])
 
 int main(int argc, FAR char *argv[])
 {
+  if (argc > 1 && strcmp(argv[1], "bench") == 0)
+    {
+      return mm_benchmark(argc - 1, &argv[1]);
+    }
+
   if (argc > 1)
     {
       return mm_stress_test(argc, argv);